@@ -0,0 +1,100 @@
+#include "bench_common.hpp"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "srm/campaign.hpp"
+#include "srm/streaming_stats.hpp"
+#include "srm/thread_pool.hpp"
+
+namespace srm::bench {
+namespace {
+
+constexpr std::size_t kCampaignFiles = 300;
+constexpr std::size_t kChannels = 4;
+constexpr std::size_t kChunkSamples = 2048;
+constexpr std::size_t kChunksPerFile = 16;
+
+/// A campaign directory of kCampaignFiles recordings, written once for the
+/// whole thread sweep and removed at exit.
+struct CampaignFiles {
+    CampaignFiles()
+        : directory(std::filesystem::temp_directory_path() / ("srm_bench_campaign_" + std::to_string(::getpid()))) {
+        std::filesystem::create_directories(directory);
+        const ChannelBuffer<std::int16_t> counts = synthetic_counts(kChannels, kChunkSamples * kChunksPerFile);
+        for (std::size_t f = 0; f < kCampaignFiles; ++f) {
+            CaptureWriter writer(directory / ("run" + std::to_string(f) + ".srmcap"), bench_capture_info(kChannels));
+            for (std::size_t k = 0; k < kChunksPerFile; ++k) {
+                writer.write_chunk(counts.view().subblock(k * kChunkSamples, kChunkSamples));
+            }
+        }
+        files = list_captures(directory);
+    }
+    ~CampaignFiles() {
+        std::error_code ignored;
+        std::filesystem::remove_all(directory, ignored);
+    }
+
+    std::filesystem::path directory;
+    std::vector<std::filesystem::path> files;
+};
+
+const CampaignFiles& campaign_files() {
+    static const CampaignFiles files;
+    return files;
+}
+
+// Levels sized to the synthetic signal, as in BM_StrainStatistics.
+constexpr RainflowConfig kRainflow{-200.0, 200.0, 64};
+
+/// Conversion plus streaming statistics over every chunk of a 300-file
+/// campaign, merged per file in chunk order, on a pool of range(0)
+/// threads. Near-linear scaling means samples_per_second grows with the
+/// thread count up to the physical cores of the machine.
+void BM_Campaign(benchmark::State& state) {
+    const std::vector<std::filesystem::path>& files = campaign_files().files;
+    const std::vector<ConversionParams> params = bench_conversion_params(bench_capture_info(kChannels));
+    WorkStealingPool pool(static_cast<std::size_t>(state.range(0)));
+    CampaignOptions options;
+    options.chunks_per_task = 4;
+    const CampaignProcessor campaign(pool, options);
+
+    const auto map = [&](const CaptureReader& reader, ChunkRange range) {
+        thread_local ChannelBuffer<float> strain;
+        StrainStatistics stats(reader.channel_count(), kRainflow);
+        for (std::size_t k = range.first_chunk; k < range.end_chunk; ++k) {
+            const ChannelBlock<const std::int16_t> counts = reader.chunk_block(k);
+            if (strain.channels() != counts.channels() || strain.samples() != counts.samples()) {
+                strain = ChannelBuffer<float>(counts.channels(), counts.samples());
+            }
+            convert_block(params, counts, strain.view());
+            stats.add(strain.view());
+        }
+        return stats;
+    };
+    const auto merge = [](StrainStatistics& into, StrainStatistics&& part) { into.merge(part); };
+
+    // One untimed pass faults the mappings in, so every thread count starts
+    // from a warm page cache.
+    campaign.run<StrainStatistics>(files, map, merge);
+    Instrumentation::instance().reset();
+    for (auto _ : state) {
+        const std::vector<FileResult<StrainStatistics>> rows =
+            campaign.run<StrainStatistics>(files, map, merge);
+        benchmark::DoNotOptimize(rows.data());
+        if (!rows.front().ok()) {
+            state.SkipWithError(rows.front().error.c_str());
+            return;
+        }
+    }
+    set_sample_counters(state, files.size() * kChunksPerFile * kChunkSamples, kChannels);
+    state.counters["threads"] = static_cast<double>(pool.thread_count());
+}
+
+BENCHMARK(BM_Campaign)->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace srm::bench
@@ -0,0 +1,220 @@
+#include "bench_common.hpp"
+
+#include "srm/async_capture_writer.hpp"
+#include "srm/capture_pyramid.hpp"
+#include "srm/delta_rice.hpp"
+#include "srm/trigger_capture.hpp"
+
+#include <filesystem>
+#include <vector>
+#include <unistd.h>
+
+namespace srm::bench {
+namespace {
+
+std::filesystem::path bench_capture_path() {
+    return std::filesystem::temp_directory_path() /
+           ("srm_bench_" + std::to_string(::getpid()) + ".srmcap");
+}
+
+void BM_CaptureWrite(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t chunk = static_cast<std::size_t>(state.range(0));
+    const std::size_t chunks = 64;
+    const CaptureInfo info = bench_capture_info(channels);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, chunk);
+    const std::filesystem::path path = bench_capture_path();
+    for (auto _ : state) {
+        CaptureWriter writer(path, info);
+        for (std::size_t i = 0; i < chunks; ++i) {
+            writer.write_chunk(counts.view());
+        }
+        writer.finish();
+    }
+    std::filesystem::remove(path);
+    set_sample_counters(state, chunk * chunks, channels);
+}
+
+BENCHMARK(BM_CaptureWrite)->Arg(65536)->UseRealTime();
+
+void BM_DeltaRiceEncode(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t chunk = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, chunk);
+    std::vector<std::byte> out(channels * (sizeof(std::uint32_t) + delta_rice_max_bytes(chunk)));
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        bytes = encode_delta_rice_chunk(counts.view(), out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_sample_counters(state, chunk, channels);
+    state.counters["compression_ratio"] =
+        static_cast<double>(chunk * channels * sizeof(std::int16_t)) / static_cast<double>(bytes);
+}
+
+BENCHMARK(BM_DeltaRiceEncode)->Arg(65536);
+
+void BM_DeltaRiceDecode(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t chunk = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, chunk);
+    std::vector<std::byte> payload(channels * (sizeof(std::uint32_t) + delta_rice_max_bytes(chunk)));
+    payload.resize(encode_delta_rice_chunk(counts.view(), payload));
+    std::vector<std::int16_t> out(chunk);
+    for (auto _ : state) {
+        for (std::size_t c = 0; c < channels; ++c) {
+            decode_delta_rice_chunk(payload, channels, c, out);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_sample_counters(state, chunk, channels);
+}
+
+BENCHMARK(BM_DeltaRiceDecode)->Arg(65536);
+
+/// End to end through the writer thread, including the final drain, so the
+/// rate is what the disk path sustains rather than the enqueue cost.
+void BM_AsyncCaptureWrite(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t chunk = static_cast<std::size_t>(state.range(0));
+    const std::size_t chunks = 64;
+    const CaptureInfo info = bench_capture_info(channels);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, chunk * chunks);
+    const std::filesystem::path path = bench_capture_path();
+    AsyncWriterOptions options;
+    options.max_chunk_samples = chunk;
+    double ratio = 0.0;
+    for (auto _ : state) {
+        AsyncCaptureWriter writer(path, info, options);
+        for (std::size_t i = 0; i < chunks; ++i) {
+            writer.write_chunk(counts.view().subblock(i * chunk, chunk));
+        }
+        writer.finish();
+        ratio = writer.compression_ratio();
+    }
+    std::filesystem::remove(path);
+    set_sample_counters(state, chunk * chunks, channels);
+    state.counters["compression_ratio"] = ratio;
+}
+
+BENCHMARK(BM_AsyncCaptureWrite)->Arg(65536)->UseRealTime();
+
+void BM_PyramidBuild(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t chunk = static_cast<std::size_t>(state.range(0));
+    const std::size_t chunks = 64;
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, chunk);
+    const std::filesystem::path path = pyramid_path(bench_capture_path());
+    for (auto _ : state) {
+        PyramidBuilder builder(path, channels, 1e6);
+        for (std::size_t i = 0; i < chunks; ++i) {
+            builder.add(counts.view(), i * chunk);
+        }
+        builder.finish();
+    }
+    std::filesystem::remove(path);
+    set_sample_counters(state, chunk * chunks, channels);
+}
+
+BENCHMARK(BM_PyramidBuild)->Arg(65536)->UseRealTime();
+
+/// A 2000-column view of the whole recording, the case that would otherwise
+/// decode every chunk.
+void BM_OverviewView(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t chunk = 65536;
+    const std::size_t chunks = 64;
+    const std::filesystem::path path = bench_capture_path();
+    {
+        const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, chunk);
+        AsyncWriterOptions options;
+        options.max_chunk_samples = chunk;
+        options.build_pyramid = true;
+        AsyncCaptureWriter writer(path, bench_capture_info(channels), options);
+        for (std::size_t i = 0; i < chunks; ++i) {
+            writer.write_chunk(counts.view());
+        }
+        writer.finish();
+    }
+    Instrumentation::instance().reset();
+    const CaptureReader capture(path);
+    const PyramidReader pyramid(pyramid_path(path));
+    const CaptureOverview overview(capture, pyramid);
+    std::vector<PyramidBin> columns(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        overview.view(0, 0, capture.total_samples(), columns);
+        benchmark::DoNotOptimize(columns.data());
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(pyramid_path(path));
+    state.counters["ns_per_column"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * columns.size()),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(BM_OverviewView)->Arg(2000);
+
+/// Opens the file and touches every sample of every chunk through the
+/// zero-copy reader.
+void BM_CaptureRead(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t chunk = static_cast<std::size_t>(state.range(0));
+    const std::size_t chunks = 64;
+    const std::filesystem::path path = bench_capture_path();
+    {
+        const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, chunk);
+        CaptureWriter writer(path, bench_capture_info(channels));
+        for (std::size_t i = 0; i < chunks; ++i) {
+            writer.write_chunk(counts.view());
+        }
+    }
+    Instrumentation::instance().reset();
+    for (auto _ : state) {
+        const CaptureReader reader(path);
+        reader.advise_sequential();
+        std::int64_t sum = 0;
+        for (std::size_t k = 0; k < reader.chunk_count(); ++k) {
+            for (std::size_t c = 0; c < reader.channel_count(); ++c) {
+                for (const std::int16_t x : reader.channel(k, c)) {
+                    sum += x;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    std::filesystem::remove(path);
+    set_sample_counters(state, chunk * chunks, channels);
+}
+
+BENCHMARK(BM_CaptureRead)->Arg(65536)->UseRealTime();
+
+/// The armed path of the event trigger: every sample checked against a
+/// level, a slope and a phase-current condition and copied into the
+/// pre-trigger ring, nothing written.
+void BM_TriggerArmed(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = static_cast<std::size_t>(state.range(0));
+    const CaptureInfo info = bench_capture_info(channels);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, block);
+    const std::vector<TriggerCondition> conditions = {
+        TriggerCondition::level_crossing(0, 2000.0),
+        TriggerCondition::slope(1, 1e9),
+        TriggerCondition::phase_current(7, 100.0, CurrentScale{0.01, 0.0}, TriggerEdge::Rising),
+    };
+    TriggeredCapture trigger(info, TriggerConfig{}, conditions);
+    std::uint64_t first = 0;
+    std::uint64_t written = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(trigger.process(counts.view(), first, [&](auto b, std::uint64_t) {
+            written += b.samples();
+        }));
+        first += block;
+    }
+    benchmark::DoNotOptimize(written);
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_TriggerArmed)->Arg(8192);
+
+}  // namespace
+}  // namespace srm::bench
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/channel_block.hpp"
+#include "srm/instrumentation.hpp"
+#include "srm/strain_conversion.hpp"
+#include "srm/synthetic.hpp"
+
+namespace srm::bench {
+
+/// Copies the stage latencies and counters recorded by the library's
+/// instrumentation during this case into the report, then clears them for
+/// the next case.
+inline void add_instrumentation_counters(benchmark::State& state) {
+    Instrumentation& instr = Instrumentation::instance();
+    const InstrumentationSnapshot snap = instr.snapshot();
+    for (const StageStats& s : snap.stages) {
+        if (s.count != 0) {
+            state.counters[s.name + "_p50_ns"] = static_cast<double>(s.p50_ns);
+            state.counters[s.name + "_p99_ns"] = static_cast<double>(s.p99_ns);
+            state.counters[s.name + "_max_ns"] = static_cast<double>(s.max_ns);
+        }
+    }
+    for (const CounterStats& c : snap.counters) {
+        if (c.value != 0) {
+            state.counters[c.name] = static_cast<double>(c.value);
+        }
+    }
+    instr.reset();
+}
+
+/// Reports per-channel sample throughput of one iteration processing
+/// @p samples samples on each of @p channels channels: samples_per_second
+/// counts every channel, ns_per_sample is the inverse (printed with an "s"
+/// suffix on the console, plain nanoseconds in the JSON report), followed
+/// by the instrumentation of the case.
+inline void set_sample_counters(benchmark::State& state, std::size_t samples,
+                                std::size_t channels) {
+    const double total = static_cast<double>(samples * channels);
+    state.counters["samples_per_second"] =
+        benchmark::Counter(total, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["ns_per_sample"] = benchmark::Counter(
+        total * 1e-9, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    add_instrumentation_counters(state);
+}
+
+/// Eight quarter-bridge gauges as recorded on the test stand.
+inline CaptureInfo bench_capture_info(std::size_t channels = 8) {
+    CaptureInfo info;
+    info.sample_rate_hz = 1e6;
+    for (std::size_t c = 0; c < channels; ++c) {
+        ChannelInfo ch;
+        ch.name = "sg" + std::to_string(c);
+        ch.amplifier_gain = 500.0;
+        info.channels.push_back(ch);
+    }
+    return info;
+}
+
+inline std::vector<ConversionParams> bench_conversion_params(const CaptureInfo& info) {
+    std::vector<ConversionParams> params;
+    for (const ChannelInfo& ch : info.channels) {
+        params.push_back(make_conversion_params(ch));
+    }
+    return params;
+}
+
+/// Raw counts of a synthetic recording with commutation harmonics and PWM
+/// ripple.
+inline ChannelBuffer<std::int16_t> synthetic_counts(std::size_t channels, std::size_t samples) {
+    const CaptureInfo info = bench_capture_info(channels);
+    SyntheticSrmConfig config;
+    config.strain_channels = channels;
+    SyntheticSrm srm(config);
+    ChannelBuffer<std::int16_t> counts(channels, samples);
+    srm.generate_counts(bench_conversion_params(info), counts.view());
+    return counts;
+}
+
+inline ChannelBuffer<float> synthetic_strain(std::size_t channels, std::size_t samples) {
+    SyntheticSrmConfig config;
+    config.strain_channels = channels;
+    SyntheticSrm srm(config);
+    ChannelBuffer<float> strain(channels, samples);
+    srm.generate(strain.view(), {}, {});
+    return strain;
+}
+
+}  // namespace srm::bench
@@ -0,0 +1,139 @@
+#include "bench_common.hpp"
+
+#include "srm/calibration_store.hpp"
+#include "srm/deinterleave.hpp"
+
+namespace srm::bench {
+namespace {
+
+void BM_ConvertChannel(benchmark::State& state, SimdPath path) {
+    if (!simd_path_supported(path)) {
+        state.SkipWithError("SIMD path not supported on this CPU");
+        return;
+    }
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(1, n);
+    const ConversionParams params = bench_conversion_params(bench_capture_info(1))[0];
+    std::vector<float> out(n);
+    for (auto _ : state) {
+        convert_channel(path, params, counts.channel(0), out);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    set_sample_counters(state, n, 1);
+}
+
+BENCHMARK_CAPTURE(BM_ConvertChannel, scalar, SimdPath::Scalar)->Arg(4096)->Arg(65536);
+BENCHMARK_CAPTURE(BM_ConvertChannel, avx2, SimdPath::Avx2)->Arg(4096)->Arg(65536);
+BENCHMARK_CAPTURE(BM_ConvertChannel, avx512, SimdPath::Avx512)->Arg(4096)->Arg(65536);
+BENCHMARK_CAPTURE(BM_ConvertChannel, neon, SimdPath::Neon)->Arg(4096)->Arg(65536);
+
+void BM_ConvertBlock(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, n);
+    const std::vector<ConversionParams> params = bench_conversion_params(bench_capture_info(channels));
+    ChannelBuffer<float> out(channels, n);
+    for (auto _ : state) {
+        convert_block(params, counts.view(), out.view());
+        benchmark::ClobberMemory();
+    }
+    set_sample_counters(state, n, channels);
+}
+
+BENCHMARK(BM_ConvertBlock)->Arg(8192);
+
+/// Interleaved frames of the synthetic counts, as a frame-oriented card
+/// delivers them.
+std::vector<std::int16_t> interleaved_counts(std::size_t channels, std::size_t n) {
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, n);
+    std::vector<std::int16_t> frames(channels * n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t c = 0; c < channels; ++c) {
+            frames[i * channels + c] = counts.channel(c)[i];
+        }
+    }
+    return frames;
+}
+
+void BM_Deinterleave(benchmark::State& state, SimdPath path) {
+    if (!simd_path_supported(path)) {
+        state.SkipWithError("SIMD path not supported on this CPU");
+        return;
+    }
+    const std::size_t channels = static_cast<std::size_t>(state.range(0));
+    const std::size_t n = static_cast<std::size_t>(state.range(1));
+    const std::vector<std::int16_t> frames = interleaved_counts(channels, n);
+    ChannelBuffer<std::int16_t> out(channels, n);
+    for (auto _ : state) {
+        deinterleave(path, frames, out.view());
+        benchmark::ClobberMemory();
+    }
+    set_sample_counters(state, n, channels);
+}
+
+BENCHMARK_CAPTURE(BM_Deinterleave, scalar, SimdPath::Scalar)->Args({4, 8192})->Args({8, 8192})->Args({16, 8192});
+BENCHMARK_CAPTURE(BM_Deinterleave, avx2, SimdPath::Avx2)->Args({4, 8192})->Args({8, 8192})->Args({16, 8192});
+BENCHMARK_CAPTURE(BM_Deinterleave, neon, SimdPath::Neon)->Args({4, 8192})->Args({8, 8192})->Args({16, 8192});
+
+// Interleaved frames to microstrain: the whole block transposed and then
+// converted (range(1) == 0), against a tile at a time so the conversion
+// reads the transposed samples from L1.
+void BM_DeinterleaveConvert(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const bool tiled = state.range(1) != 0;
+    const std::vector<std::int16_t> frames = interleaved_counts(channels, n);
+    const std::vector<ConversionParams> params = bench_conversion_params(bench_capture_info(channels));
+    ChannelBuffer<std::int16_t> counts(channels, n);
+    ChannelBuffer<float> out(channels, n);
+    TileDeinterleaver tiler(channels);
+    for (auto _ : state) {
+        if (tiled) {
+            tiler.process(frames, 0, [&](ChannelBlock<const std::int16_t> tile, std::uint64_t first) {
+                convert_block(params, tile, out.view().subblock(first, tile.samples()));
+            });
+        } else {
+            deinterleave(frames, counts.view());
+            convert_block(params, counts.view(), out.view());
+        }
+        benchmark::ClobberMemory();
+    }
+    set_sample_counters(state, n, channels);
+}
+
+BENCHMARK(BM_DeinterleaveConvert)->Args({262144, 0})->Args({262144, 1});
+
+// BM_ConvertBlock plus what a calibrated block adds: entering the store,
+// interpolating every channel's temperature-compensated constants.
+void BM_CalibratedConvertBlock(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, n);
+    const CaptureInfo info = bench_capture_info(channels);
+    std::vector<SensorCalibration> records(channels);
+    for (std::size_t ch = 0; ch < channels; ++ch) {
+        records[ch].channel = static_cast<std::uint16_t>(ch);
+        records[ch].sensor_id = "SG-" + std::to_string(100 + ch);
+        records[ch].thermocouple = static_cast<std::uint16_t>(ch / 4);
+        records[ch].gauge_factor_tc_per_c = 9e-5;
+        records[ch].thermal_output = {{-20.0f, -35.0f}, {20.0f, 0.0f}, {60.0f, 18.0f}, {120.0f, 40.0f}};
+    }
+    CalibrationStore store(CalibrationSnapshot(info.channels, records));
+    CalibrationStore::Reader reader = store.reader();
+    const std::vector<float> thermocouples = {41.3f, 47.9f};
+    std::vector<ConversionParams> params(channels);
+    ChannelBuffer<float> out(channels, n);
+    for (auto _ : state) {
+        const CalibrationStore::ReadGuard calibration = reader.read();
+        calibration->params(thermocouples, params);
+        convert_block(params, counts.view(), out.view());
+        benchmark::ClobberMemory();
+    }
+    set_sample_counters(state, n, channels);
+}
+
+BENCHMARK(BM_CalibratedConvertBlock)->Arg(512)->Arg(8192);
+
+}  // namespace
+}  // namespace srm::bench
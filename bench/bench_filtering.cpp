@@ -0,0 +1,59 @@
+#include "bench_common.hpp"
+
+#include "srm/decimator.hpp"
+#include "srm/harmonic_notch.hpp"
+
+namespace srm::bench {
+namespace {
+
+void BM_DecimationChain(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, block);
+    DecimationChainConfig config;
+    config.max_block = block;
+    DecimationChain chain(config, channels);
+    ChannelBuffer<float> out(channels, chain.max_output(block));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(chain.process(counts.view(), out.view()));
+    }
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_DecimationChain)->Arg(8192);
+
+void BM_CicDecimator(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = 8192;
+    const unsigned ratio = static_cast<unsigned>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, block);
+    CicDecimator cic(ratio, 4, channels);
+    ChannelBuffer<float> out(channels, block / ratio + 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cic.process(counts.view(), out.view()));
+    }
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_CicDecimator)->Arg(8)->Arg(32);
+
+void BM_HarmonicNotch(benchmark::State& state) {
+    const std::size_t channels = static_cast<std::size_t>(state.range(0));
+    const std::size_t block = 8192;
+    const ChannelBuffer<float> strain = synthetic_strain(channels, block);
+    HarmonicNotch notch(HarmonicNotchConfig{}, channels);
+    ChannelBuffer<float> out(channels, block);
+    double rev_per_s = 50.0;
+    for (auto _ : state) {
+        // A slowly moving speed, so every block retunes and ramps.
+        rev_per_s = rev_per_s > 60.0 ? 50.0 : rev_per_s + 0.01;
+        notch.process(strain.view(), out.view(), rev_per_s);
+        benchmark::DoNotOptimize(out.view().data());
+    }
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_HarmonicNotch)->Arg(8)->Arg(32);
+
+}  // namespace
+}  // namespace srm::bench
@@ -0,0 +1,95 @@
+#include "bench_common.hpp"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "srm/network_stream.hpp"
+
+namespace srm::bench {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Loopback subscribers, connected and drained outside the timed region, so
+// the figure is the publisher's cost per block: encode once, sendmmsg() to
+// every subscriber (on loopback the kernel's delivery runs in that call).
+struct LoopbackRig {
+    StreamServer server;
+    std::vector<std::unique_ptr<StreamClient>> clients;
+
+    LoopbackRig(std::size_t channels, std::size_t subscribers)
+        : server(loopback_config(), channels) {
+        for (std::size_t i = 0; i < subscribers; ++i) {
+            clients.push_back(std::make_unique<StreamClient>());
+            clients.back()->subscribe("127.0.0.1", server.port());
+        }
+        while (server.subscriber_count() < subscribers) {
+            std::this_thread::sleep_for(1ms);
+            server.poll();
+        }
+    }
+
+    std::size_t drain() {
+        std::size_t frames = 0;
+        for (auto& client : clients) {
+            for (std::size_t got = 1; got != 0;) {
+                got = client->receive(0ms).size();
+                frames += got;
+            }
+        }
+        return frames;
+    }
+
+    static StreamServerConfig loopback_config() {
+        StreamServerConfig config;
+        config.bind_address = "127.0.0.1";
+        config.port = 0;
+        return config;
+    }
+};
+
+void BM_StreamPublish(benchmark::State& state) {
+    const std::size_t channels = 16;
+    const std::size_t block = 4096;
+    const std::size_t subscribers = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, block);
+    LoopbackRig rig(channels, subscribers);
+    std::uint64_t first = 0;
+    for (auto _ : state) {
+        rig.server.publish(counts.view(), first, first * 1000);
+        first += block;
+        state.PauseTiming();
+        rig.drain();
+        state.ResumeTiming();
+    }
+    state.counters["datagrams_per_block"] = static_cast<double>(rig.server.datagrams_sent()) /
+                                            static_cast<double>(state.iterations());
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_StreamPublish)->Arg(1)->Arg(4)->UseRealTime();
+
+// Publisher and one subscriber, both timed: the CPU the two ends of a
+// 16-channel stream need per sample.
+void BM_StreamRoundTrip(benchmark::State& state) {
+    const std::size_t channels = 16;
+    const std::size_t block = 4096;
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, block);
+    LoopbackRig rig(channels, 1);
+    std::uint64_t first = 0;
+    std::size_t frames = 0;
+    for (auto _ : state) {
+        rig.server.publish(counts.view(), first, first * 1000);
+        first += block;
+        frames += rig.drain();
+    }
+    state.counters["frames_lost"] = static_cast<double>(rig.clients[0]->rig_stats()[0].frames_lost);
+    benchmark::DoNotOptimize(frames);
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_StreamRoundTrip);
+
+}  // namespace
+}  // namespace srm::bench
@@ -0,0 +1,124 @@
+#include "bench_common.hpp"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "srm/channel_pipeline.hpp"
+#include "srm/dashboard_feed.hpp"
+#include "srm/field_reconstruction.hpp"
+
+namespace srm::bench {
+namespace {
+
+// The rig's default chain at 1 MS/s: convert, notch the 4th commutation
+// harmonic (6-pole rotor at 3000 rpm -> 300 Hz electrical), half-band
+// decimate by 2, resample by 1.25 and keep running statistics.
+constexpr BiquadCoefficients kNotch = design_notch(4.0 * 300.0 / 1e6, 8.0);
+constexpr double kResampleStep = 1.25;
+
+void BM_FusedPipeline(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, block);
+    const std::vector<ConversionParams> params = bench_conversion_params(bench_capture_info(channels));
+    FusedPipeline pipeline(channels, ConvertStage(params), BiquadStage(kNotch),
+                           FirDecimateStage(kHalfband31, 2), LinearResampleStage(kResampleStep),
+                           StatsStage{});
+    for (auto _ : state) {
+        pipeline.process(counts.view());
+        benchmark::DoNotOptimize(pipeline.summary<4>(0));
+    }
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_FusedPipeline)->Arg(8192);
+
+void BM_DynamicPipeline(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(channels, block);
+    const std::vector<ConversionParams> params = bench_conversion_params(bench_capture_info(channels));
+    DynamicPipeline pipeline(channels);
+    pipeline.add(ConvertStage(params));
+    pipeline.add(BiquadStage(kNotch));
+    pipeline.add(FirDecimateStage(kHalfband31, 2));
+    pipeline.add(LinearResampleStage(kResampleStep));
+    const auto& stats = pipeline.add(StatsStage{});
+    for (auto _ : state) {
+        pipeline.process(counts.view());
+        benchmark::DoNotOptimize(stats.summary(0));
+    }
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_DynamicPipeline)->Arg(8192);
+
+// Dashboard publication on the processing thread, fed the strain the chain
+// above has already decimated (by 2, then 1.25): the per-sample counters
+// are per raw input sample, so ns_per_sample compares directly with
+// BM_FusedPipeline's. The second argument runs a viewer polling the whole
+// window as fast as it can, which must not change the publisher's cost.
+void BM_DashboardFeed(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = static_cast<std::size_t>(state.range(0));
+    const std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                       ("srm_bench_dashboard_" + std::to_string(::getpid()) + ".srmdash");
+    const auto decimated = static_cast<std::size_t>(static_cast<double>(block) / (2.0 * kResampleStep));
+    const ChannelBuffer<float> strain = synthetic_strain(channels, decimated);
+    {
+        DashboardPublisher publisher(path, channels, 1e6 / (2.0 * kResampleStep));
+        std::atomic<bool> done{false};
+        std::thread viewer;
+        if (state.range(1) != 0) {
+            viewer = std::thread([&] {
+                const DashboardReader reader(path);
+                WaveformWindow window;
+                while (!done.load(std::memory_order_relaxed)) {
+                    benchmark::DoNotOptimize(reader.read_waveform(reader.waveform_capacity(), window));
+                }
+            });
+        }
+        for (auto _ : state) {
+            publisher.add_waveform(strain.view());
+            benchmark::DoNotOptimize(publisher.points_published());
+        }
+        done.store(true, std::memory_order_relaxed);
+        if (viewer.joinable()) {
+            viewer.join();
+        }
+    }
+    std::filesystem::remove(path);
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_DashboardFeed)->Args({8192, 0})->Args({8192, 1});
+
+// Live full-yoke map: twelve stator gauges to a 720-point ring field
+// through the thin-ring basis up to order 4 (nine modes), per block of
+// decimated strain samples.
+void BM_FieldReconstruct(benchmark::State& state) {
+    const std::size_t gauges = 12;
+    const std::size_t outputs = 720;
+    const std::size_t block = static_cast<std::size_t>(state.range(0));
+    std::vector<GaugePlacement> layout;
+    for (std::size_t g = 0; g < gauges; ++g) {
+        layout.push_back({"sg" + std::to_string(g), {{(g * 61 + 7) % outputs, 1.0}}});
+    }
+    const FieldReconstructor reconstructor(ModalBasis::thin_ring(outputs, 4), layout);
+    const ChannelBuffer<float> strain = synthetic_strain(gauges, block);
+    ChannelBuffer<float> field(outputs, block);
+    for (auto _ : state) {
+        reconstructor.reconstruct(strain.view(), field.view());
+        benchmark::ClobberMemory();
+    }
+    set_sample_counters(state, block, gauges);
+}
+
+BENCHMARK(BM_FieldReconstruct)->Arg(64)->Arg(1024);
+
+}  // namespace
+}  // namespace srm::bench
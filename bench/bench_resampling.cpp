@@ -0,0 +1,35 @@
+#include "bench_common.hpp"
+
+#include "srm/angle_resampler.hpp"
+
+namespace srm::bench {
+namespace {
+
+void BM_AngleResampler(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = 8192;
+    SyntheticSrmConfig config;
+    config.strain_channels = channels;
+    config.speed_rpm = static_cast<double>(state.range(0));
+    SyntheticSrm srm(config);
+    ChannelBuffer<float> strain(channels, block);
+    std::vector<float> position(block);
+    srm.generate(strain.view(), position, {});
+
+    AngleResamplerConfig rc;
+    rc.counts_per_revolution = config.encoder_counts_per_rev;
+    AngleResampler resampler(rc, channels);
+    ChannelBuffer<float> out(channels, block);
+    for (auto _ : state) {
+        // Replaying the same block wraps the rotor angle back; reset so every
+        // iteration resamples the same revolution span.
+        resampler.reset();
+        benchmark::DoNotOptimize(resampler.process(position, strain.view(), out.view()));
+    }
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_AngleResampler)->Arg(3000)->Arg(12000);
+
+}  // namespace
+}  // namespace srm::bench
@@ -0,0 +1,48 @@
+#include "bench_common.hpp"
+
+#include <atomic>
+#include <thread>
+
+#include "srm/spsc_ring.hpp"
+
+namespace srm::bench {
+namespace {
+
+/// Producer thread pushing batches of samples to the benchmark thread, the
+/// shape of the ADC reader -> processing hand-off.
+void BM_SpscRingThroughput(benchmark::State& state) {
+    const std::size_t batch = static_cast<std::size_t>(state.range(0));
+    SpscRing<std::int16_t> ring(1u << 16);
+    std::atomic<bool> stop{false};
+    std::thread producer([&] {
+        std::vector<std::int16_t> items(batch, 1);
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (ring.push_batch(items) == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::vector<std::int16_t> out(batch);
+    std::size_t popped = 0;
+    for (auto _ : state) {
+        std::size_t got = 0;
+        while (got < batch) {
+            const std::size_t n = ring.pop_batch(std::span(out).subspan(got));
+            if (n == 0) {
+                std::this_thread::yield();
+            }
+            got += n;
+        }
+        popped += got;
+        benchmark::DoNotOptimize(out.data());
+    }
+    stop.store(true, std::memory_order_relaxed);
+    producer.join();
+    set_sample_counters(state, batch, 1);
+    benchmark::DoNotOptimize(popped);
+}
+
+BENCHMARK(BM_SpscRingThroughput)->Arg(256)->Arg(4096)->UseRealTime();
+
+}  // namespace
+}  // namespace srm::bench
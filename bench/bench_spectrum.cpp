@@ -0,0 +1,140 @@
+#include "bench_common.hpp"
+
+#include <cmath>
+#include <complex>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+#include "srm/fft.hpp"
+#include "srm/order_analysis.hpp"
+#include "srm/spectrum.hpp"
+#include "srm/startup_plans.hpp"
+
+namespace srm::bench {
+namespace {
+
+void BM_FftForward(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const std::shared_ptr<const FftPlan> plan = PlanCache::instance().fft(n);
+    const ChannelBuffer<float> strain = synthetic_strain(1, n);
+    std::vector<std::complex<float>> out(plan->bins());
+    std::vector<std::complex<float>> scratch(plan->scratch_size());
+    for (auto _ : state) {
+        plan->forward(strain.channel(0).data(), out.data(), scratch.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_sample_counters(state, n, 1);
+}
+
+BENCHMARK(BM_FftForward)->Arg(1024)->Arg(4096)->Arg(65536);
+
+void BM_SlidingSpectrum(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = 8192;
+    SpectrumConfig config;
+    config.frame_size = static_cast<std::size_t>(state.range(0));
+    config.hop = config.frame_size / 4;
+    const ChannelBuffer<float> strain = synthetic_strain(channels, block);
+    SlidingSpectrum spectrum(config, channels);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(spectrum.push(strain.view(), [](const SpectrumFrame& frame) {
+            benchmark::DoNotOptimize(frame.amplitude.data());
+        }));
+    }
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_SlidingSpectrum)->Arg(4096);
+
+/// Campaign order analysis of one capture (8 gauges plus the encoder,
+/// 16 chunks of 64 Ki samples) with the backend make_spectral_backend()
+/// picks: the device when one is present, the CPU otherwise.
+void BM_OrderAnalysis(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t chunk = 65536;
+    const std::size_t chunks = 16;
+    const std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                       ("srm_bench_orders_" + std::to_string(::getpid()) + ".srmcap");
+    {
+        CaptureInfo info = bench_capture_info(channels + 1);
+        info.rotor_position_channel = channels;
+        const std::vector<ConversionParams> params = bench_conversion_params(info);
+        SyntheticSrmConfig config;
+        config.strain_channels = channels;
+        SyntheticSrm srm(config);
+        ChannelBuffer<float> strain(channels, chunk);
+        std::vector<float> position(chunk);
+        ChannelBuffer<std::int16_t> counts(channels + 1, chunk);
+        CaptureWriter writer(path, info);
+        for (std::size_t k = 0; k < chunks; ++k) {
+            srm.generate(strain.view(), position, {});
+            for (std::size_t i = 0; i < chunk; ++i) {
+                for (std::size_t c = 0; c < channels; ++c) {
+                    counts.channel(c)[i] =
+                        static_cast<std::int16_t>(std::lround(strain_to_counts(params[c], strain.channel(c)[i])));
+                }
+                counts.channel(channels)[i] = static_cast<std::int16_t>(std::lround(position[i]) % 4096);
+            }
+            writer.write_chunk(std::as_const(counts).view());
+        }
+    }
+    OrderAnalysisConfig config;
+    config.resampler.cycles_per_revolution = 6;
+    config.resampler.points_per_cycle = 256;
+    const std::unique_ptr<SpectralBackend> backend = make_spectral_backend(config);
+    const CaptureReader reader(path);
+    Instrumentation::instance().reset();
+    for (auto _ : state) {
+        const OrderSpectrum orders = backend->analyse(reader, {0, reader.chunk_count()});
+        benchmark::DoNotOptimize(orders.frames());
+    }
+    std::filesystem::remove(path);
+    set_sample_counters(state, chunk * chunks, channels);
+    state.SetLabel(std::string(to_string(backend->kind())));
+}
+
+BENCHMARK(BM_OrderAnalysis)->UseRealTime();
+
+/// Start-up of a 64-gauge rig (five FFT sizes up to 64 Ki with their Hann
+/// windows, the decimation chain and a calibration file of every gauge):
+/// built from scratch (0) against restored from the plan cache (1). Each
+/// iteration starts with an empty PlanCache, as a new process does.
+void BM_StartupPlans(benchmark::State& state) {
+    const std::size_t channels = 64;
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / ("srm_bench_plans_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(directory);
+    RigConfiguration config;
+    config.channels = bench_capture_info(channels).channels;
+    config.calibration_files = {directory / "rig.cal"};
+    {
+        std::ofstream out(config.calibration_files[0]);
+        for (std::size_t c = 0; c < channels; ++c) {
+            out << "channel=" << c << " sensor=SG-" << 100 + c << " thermocouple=" << c % 4
+                << " zero=1.5 gf_tc=1e-4 thermal=-20:-35,0:-12,20:0,60:18,120:40\n";
+        }
+    }
+    for (std::size_t n = 4096; n <= 65536; n *= 2) {
+        config.fft_sizes.push_back(n);
+        config.windows.push_back({WindowType::Hann, n});
+    }
+    const StartupPlanCache cache(directory / "plans");
+    const bool cached = state.range(0) != 0;
+    if (cached) {
+        cache.load_or_build(config);
+    }
+    for (auto _ : state) {
+        PlanCache::instance().clear();
+        const RigPlans plans = cached ? cache.load_or_build(config) : build_rig_plans(config);
+        benchmark::DoNotOptimize(plans.fft.data());
+    }
+    PlanCache::instance().clear();
+    std::filesystem::remove_all(directory);
+    state.SetLabel(cached ? "cached" : "built");
+}
+
+BENCHMARK(BM_StartupPlans)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace srm::bench
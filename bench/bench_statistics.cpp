@@ -0,0 +1,95 @@
+#include "bench_common.hpp"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+#include "srm/results_store.hpp"
+#include "srm/streaming_stats.hpp"
+
+namespace srm::bench {
+namespace {
+
+// Levels sized to the synthetic signal (about +-80 microstrain), so the
+// rainflow counter sees a realistic share of reversals.
+constexpr RainflowConfig kRainflow{-200.0, 200.0, 64};
+
+void BM_StrainStatistics(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const std::size_t block = static_cast<std::size_t>(state.range(0));
+    const ChannelBuffer<float> strain = synthetic_strain(channels, block);
+    StrainStatistics stats(channels, kRainflow);
+    for (auto _ : state) {
+        stats.add(strain.view());
+    }
+    benchmark::DoNotOptimize(stats.summary(0));
+    set_sample_counters(state, block, channels);
+}
+
+BENCHMARK(BM_StrainStatistics)->Arg(8192)->Arg(65536);
+
+// Folding one part into a campaign total: the cost is per channel and
+// independent of how many samples the part covered.
+void BM_StrainStatisticsMerge(benchmark::State& state) {
+    const std::size_t channels = 8;
+    const ChannelBuffer<float> strain = synthetic_strain(channels, 8192);
+    StrainStatistics part(channels, kRainflow);
+    part.add(strain.view());
+    StrainStatistics total(channels, kRainflow);
+    for (auto _ : state) {
+        total.merge(part);
+    }
+    benchmark::DoNotOptimize(total.summary(0));
+}
+
+BENCHMARK(BM_StrainStatisticsMerge);
+
+/// "Peak yoke strain against speed at 10 A" over a 100k-row campaign
+/// summary in sweep order (speed, current, four locations, chunks).
+void BM_ResultsQuery(benchmark::State& state) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                       ("srm_bench_results_" + std::to_string(::getpid()) + ".srmres");
+    const char* locations[] = {"yoke", "pole_a", "pole_b", "tooth"};
+    std::size_t rows = 0;
+    {
+        ResultsWriter writer(path);
+        const std::size_t speed = writer.add_column("speed_rpm", ColumnType::Float64);
+        const std::size_t current = writer.add_column("current_a", ColumnType::Float64);
+        const std::size_t location = writer.add_column("location", ColumnType::Key);
+        const std::size_t rms = writer.add_column("rms_ue", ColumnType::Float64);
+        const std::size_t peak = writer.add_column("peak_ue", ColumnType::Float64);
+        for (int s = 1; s <= 12; ++s) {
+            for (int a = 1; a <= 8; ++a) {
+                for (int k = 0; k < 260; ++k) {
+                    for (int l = 0; l < 4; ++l) {
+                        writer.set(speed, 500.0 * s);
+                        writer.set(current, 5.0 * a);
+                        writer.set(location, locations[l]);
+                        writer.set(rms, 3.0 * a + 0.1 * k);
+                        writer.set(peak, 10.0 * a * (l + 1) + 0.01 * k);
+                        writer.end_row();
+                    }
+                }
+            }
+        }
+        rows = writer.rows();
+        writer.finish();
+    }
+    const ResultsReader store(path);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ResultsQuery(store)
+                                     .where("current_a", Compare::Equal, 10.0)
+                                     .where_key("location", "yoke")
+                                     .group_by("speed_rpm")
+                                     .aggregate(Aggregate::Max, "peak_ue")
+                                     .run());
+    }
+    std::filesystem::remove(path);
+    set_sample_counters(state, rows, 1);
+}
+
+BENCHMARK(BM_ResultsQuery);
+
+}  // namespace
+}  // namespace srm::bench
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "srm/aligned.hpp"
+#include "srm/capture_file.hpp"
+#include "srm/channel_block.hpp"
+#include "srm/synthetic.hpp"
+
+namespace srm {
+
+/// DMA transfers are set up on whole pages.
+inline constexpr std::size_t kDmaAlignment = 4096;
+
+/// Geometry of the DMA buffers posted to the card.
+struct AcquisitionConfig {
+    std::size_t channels = 8;
+    std::size_t samples_per_block = 8192;  ///< per channel
+    /// Two is the minimum for continuous acquisition; three lets one block
+    /// be held by a slow consumer while the card fills the other two.
+    std::size_t buffer_count = 3;
+    /// mlock() the buffers. Failure (RLIMIT_MEMLOCK) is not fatal; see
+    /// DmaAcquisition::memory_locked().
+    bool lock_memory = true;
+    /// NUMA node to bind the buffers to (ThreadPlacement::node() of the
+    /// acquisition); -1 leaves them where they are first touched.
+    int numa_node = -1;
+};
+
+/// One finished transfer as reported by the card.
+struct DmaCompletion {
+    std::size_t buffer = 0;            ///< index given to DmaDriver::post()
+    std::uint64_t first_sample = 0;    ///< per-channel sample counter of the card
+    std::uint64_t timestamp_ns = 0;    ///< hardware clock at the first sample
+    bool overrun = false;              ///< samples were lost before this block
+};
+
+/// Thin abstraction of the DAQ card's DMA interface. Implementations write
+/// straight into the buffers they are given; nothing is copied on the way
+/// to the pipeline.
+class DmaDriver {
+public:
+    virtual ~DmaDriver() = default;
+
+    /// Hands buffer @p index to the card. Called once per buffer before
+    /// start() and again each time a buffer is released; may be called from
+    /// any thread, but never concurrently (DmaAcquisition serialises it).
+    virtual void post(std::size_t index, ChannelBlock<std::int16_t> buffer) = 0;
+
+    virtual void start() = 0;
+    virtual void stop() = 0;
+
+    /// Waits up to @p timeout for the next filled buffer. Completions are
+    /// delivered in acquisition order.
+    virtual bool wait(DmaCompletion& completion, std::chrono::nanoseconds timeout) = 0;
+};
+
+class DmaAcquisition;
+
+/// Reference-counted, read-only handle to a filled DMA buffer. Copying the
+/// handle shares the buffer (no sample data is copied); the buffer goes back
+/// to the card when the last handle is destroyed or reset(). A stage that
+/// must keep the data longer calls copy_to() and releases the handle.
+///
+/// Handles may be passed to and released from any thread, but must not
+/// outlive the DmaAcquisition that issued them.
+class BlockHandle {
+public:
+    BlockHandle() noexcept = default;
+    BlockHandle(const BlockHandle& other) noexcept;
+    BlockHandle(BlockHandle&& other) noexcept;
+    BlockHandle& operator=(const BlockHandle& other) noexcept;
+    BlockHandle& operator=(BlockHandle&& other) noexcept;
+    ~BlockHandle() { reset(); }
+
+    explicit operator bool() const noexcept { return slot_ != nullptr; }
+
+    ChannelBlock<const std::int16_t> block() const noexcept;
+    std::uint64_t first_sample() const noexcept;
+    std::uint64_t timestamp_ns() const noexcept;
+    std::uint64_t sequence() const noexcept;  ///< delivery count, from 0
+    bool overrun() const noexcept;            ///< samples were lost just before this block
+
+    /// Copies the samples into @p out (same shape).
+    /// Throws std::invalid_argument on a shape mismatch.
+    void copy_to(ChannelBlock<std::int16_t> out) const;
+
+    /// Drops this reference; requeues the buffer if it was the last one.
+    void reset() noexcept;
+
+private:
+    friend class DmaAcquisition;
+    struct Slot;
+
+    explicit BlockHandle(Slot* slot) noexcept : slot_(slot) {}
+
+    Slot* slot_ = nullptr;
+};
+
+/// Zero-copy acquisition on top of a DmaDriver: owns page-aligned, pinned
+/// buffers, posts them to the card, and hands each filled buffer to the
+/// pipeline as a BlockHandle until every consumer has released it.
+class DmaAcquisition {
+public:
+    /// Throws std::invalid_argument for fewer than two buffers or an empty
+    /// block shape.
+    DmaAcquisition(std::unique_ptr<DmaDriver> driver, const AcquisitionConfig& config);
+    ~DmaAcquisition();
+
+    DmaAcquisition(const DmaAcquisition&) = delete;
+    DmaAcquisition& operator=(const DmaAcquisition&) = delete;
+
+    const AcquisitionConfig& config() const noexcept { return config_; }
+    bool memory_locked() const noexcept { return locked_; }
+
+    void start();
+    void stop();
+
+    /// Next filled block, or an empty handle if none arrived within
+    /// @p timeout. Call from one thread.
+    BlockHandle next(std::chrono::nanoseconds timeout);
+
+    /// Buffers currently held by consumers (not queued at the card).
+    std::size_t buffers_in_use() const noexcept {
+        return in_use_.load(std::memory_order_relaxed);
+    }
+
+    /// Blocks that arrived flagged as overrun since construction.
+    std::uint64_t overruns() const noexcept { return overruns_; }
+
+private:
+    friend class BlockHandle;
+    using Storage = std::vector<std::int16_t, AlignedAllocator<std::int16_t, kDmaAlignment>>;
+
+    ChannelBlock<std::int16_t> buffer(std::size_t index) noexcept;
+    void release(BlockHandle::Slot* slot) noexcept;
+
+    std::unique_ptr<DmaDriver> driver_;
+    AcquisitionConfig config_;
+    std::size_t stride_ = 0;
+    std::vector<Storage> storage_;
+    std::vector<std::unique_ptr<BlockHandle::Slot>> slots_;
+    std::mutex post_mutex_;
+    std::atomic<std::size_t> in_use_{0};
+    std::uint64_t sequence_ = 0;
+    std::uint64_t overruns_ = 0;
+    bool locked_ = false;
+    bool running_ = false;
+};
+
+/// Driver stand-in for bench and lab-less development: a thread that fills
+/// posted buffers with SyntheticSrm counts, paced to the sample rate (or as
+/// fast as possible), and stamps them with a steady-clock "hardware" time.
+/// When every buffer is held by the consumer it drops the samples and flags
+/// the next block as an overrun, like the real card. All posted buffers
+/// must have the same shape.
+class SimulatedDmaDriver final : public DmaDriver {
+public:
+    struct Options {
+        SyntheticSrmConfig signal;
+        CaptureInfo info;    ///< calibration used to produce raw counts
+        bool real_time = true;
+    };
+
+    explicit SimulatedDmaDriver(Options options);
+    ~SimulatedDmaDriver() override;
+
+    void post(std::size_t index, ChannelBlock<std::int16_t> buffer) override;
+    void start() override;
+    void stop() override;
+    bool wait(DmaCompletion& completion, std::chrono::nanoseconds timeout) override;
+
+    std::uint64_t dropped_samples() const noexcept {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Posted {
+        std::size_t index;
+        ChannelBlock<std::int16_t> buffer;
+    };
+
+    void run();
+
+    Options options_;
+    SyntheticSrm signal_;
+    std::vector<ConversionParams> params_;
+    std::mutex mutex_;
+    std::condition_variable posted_cv_;
+    std::condition_variable done_cv_;
+    std::deque<Posted> posted_;
+    std::deque<DmaCompletion> done_;
+    std::thread thread_;
+    std::atomic<std::uint64_t> dropped_{0};
+    bool stop_ = false;
+};
+
+}  // namespace srm
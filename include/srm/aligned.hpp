@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "srm/common.hpp"
+
+namespace srm {
+
+/// Allocator handing out storage aligned to @p Alignment bytes (a cache line
+/// by default), so SIMD kernels can assume aligned block starts.
+template <typename T, std::size_t Alignment = kCacheLineSize>
+struct AlignedAllocator {
+    static_assert(is_pow2(Alignment) && Alignment >= alignof(T));
+
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    constexpr AlignedAllocator() noexcept = default;
+    template <typename U>
+    constexpr AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t{Alignment});
+    }
+
+    template <typename U>
+    constexpr bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept {
+        return true;
+    }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+/// Number of elements of @p T that fill whole cache lines and hold @p count.
+template <typename T>
+constexpr std::size_t padded_count(std::size_t count) noexcept {
+    constexpr std::size_t per_line = kCacheLineSize / sizeof(T);
+    return (count + per_line - 1) / per_line * per_line;
+}
+
+}  // namespace srm
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+struct AngleResamplerConfig {
+    /// Position channel units per mechanical revolution (decoded encoder
+    /// counts, or 2*pi for a resolver channel in radians). The position is
+    /// expected to wrap at this value.
+    double counts_per_revolution = 4096.0;
+    /// Electrical cycles per mechanical revolution; the rotor pole count for
+    /// an SRM.
+    unsigned cycles_per_revolution = 8;
+    /// Angular grid resolution.
+    unsigned points_per_cycle = 3600;
+};
+
+/// A grid point found by AngleResampler::locate(): it lies @p fraction of
+/// the way from the sample before @p sample to @p sample, where the sample
+/// before sample 0 is the last sample of the previous block.
+struct GridCrossing {
+    std::uint32_t sample;
+    float fraction;
+};
+
+/// Streaming time-to-angle resampler.
+///
+/// Tracks the (possibly wrapping) rotor position channel, unwraps it, and
+/// linearly interpolates every strain channel at each crossing of a fixed
+/// electrical-angle grid. Grid point k sits at electrical angle
+/// k / points_per_cycle cycles from the encoder zero, so output stays phase
+/// locked to the rotor across blocks and through speed ramps. Only forward
+/// rotation produces output; while the rotor stands still or moves backwards
+/// no grid point is emitted twice.
+///
+/// The only state carried between blocks is the previous sample, so output
+/// is available as soon as the grid is crossed.
+class AngleResampler {
+public:
+    AngleResampler(const AngleResamplerConfig& config, std::size_t channels);
+
+    struct Result {
+        std::size_t consumed;  ///< input samples fully processed
+        std::size_t produced;  ///< grid points written to the output block
+    };
+
+    /// Feeds position[i] together with strain sample i of every channel.
+    /// Stops early when @p out is full; call again with the unconsumed tail.
+    /// Throws std::invalid_argument on a channel count or length mismatch.
+    Result process(std::span<const float> position, ChannelBlock<const float> strain,
+                   ChannelBlock<float> out);
+
+    /// Tracks @p position exactly like process() but, instead of
+    /// interpolating, reports where each grid point falls, for callers that
+    /// interpolate elsewhere (e.g. on a GPU). Use a resampler either with
+    /// process() or with locate(), not both.
+    Result locate(std::span<const float> position, std::span<GridCrossing> out);
+
+    /// Absolute grid index of the next point to be produced; the electrical
+    /// cycle is next_grid_index() / points_per_cycle.
+    std::int64_t next_grid_index() const noexcept { return next_grid_; }
+
+    /// Unwrapped electrical angle of the last sample, in grid points.
+    double grid_position() const noexcept { return prev_grid_; }
+
+    const AngleResamplerConfig& config() const noexcept { return config_; }
+
+    /// Forgets the carried sample; the next block re-anchors the grid.
+    void reset() noexcept;
+
+private:
+    template <typename Prime, typename Point, typename Advance>
+    Result track(std::span<const float> position, std::size_t capacity, Prime&& prime, Point&& point,
+                 Advance&& advance);
+
+    AngleResamplerConfig config_;
+    double grid_per_count_;
+    double half_revolution_;
+    bool primed_ = false;
+    float prev_position_ = 0.0f;
+    double unwrapped_counts_ = 0.0;
+    double prev_grid_ = 0.0;
+    std::int64_t next_grid_ = 0;
+    std::vector<float> prev_values_;
+};
+
+}  // namespace srm
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace srm {
+
+/// Monotonic arena for the analysis objects of one operating point.
+///
+/// Allocation is a pointer bump inside the current block; deallocation is a
+/// no-op. reset() rewinds to the first block in O(1) and keeps every block
+/// for the next operating point, so a campaign sweep settles at the peak
+/// working set of its largest point instead of returning memory to malloc
+/// and fetching it again. Blocks go back to the upstream resource only in
+/// release() and the destructor.
+///
+/// Every analysis stage that builds variable-size results takes a
+/// std::pmr::memory_resource*, so passing a RunArena routes all of them here.
+/// Not thread-safe: use one arena per worker.
+class RunArena final : public std::pmr::memory_resource {
+public:
+    explicit RunArena(std::size_t block_size = std::size_t{1} << 20,
+                      std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~RunArena() override;
+
+    RunArena(const RunArena&) = delete;
+    RunArena& operator=(const RunArena&) = delete;
+
+    /// Invalidates everything allocated since the last reset and rewinds to
+    /// the first block. Retained blocks are reused as-is.
+    void reset() noexcept;
+
+    /// reset() plus returning every block to the upstream resource.
+    void release() noexcept;
+
+    /// Bytes handed out since the last reset (including alignment padding).
+    std::size_t bytes_used() const noexcept { return used_before_ + offset_ - kHeaderSize; }
+    /// Bytes of block storage currently held from upstream.
+    std::size_t bytes_reserved() const noexcept { return reserved_; }
+    /// Number of upstream allocations made over the arena's lifetime.
+    std::size_t upstream_allocations() const noexcept { return upstream_allocations_; }
+
+private:
+    struct Block {
+        Block* next;
+        std::size_t size;  // including this header
+    };
+    static constexpr std::size_t kHeaderSize = (sizeof(Block) + alignof(std::max_align_t) - 1) /
+                                               alignof(std::max_align_t) *
+                                               alignof(std::max_align_t);
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) noexcept override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    Block* new_block(std::size_t min_payload, std::size_t alignment);
+
+    std::pmr::memory_resource* upstream_;
+    std::size_t block_size_;
+    Block* head_ = nullptr;
+    Block* tail_ = nullptr;
+    Block* current_ = nullptr;
+    std::size_t offset_ = kHeaderSize;  // within current_
+    std::size_t used_before_ = 0;       // bytes in blocks before current_
+    std::size_t reserved_ = 0;
+    std::size_t upstream_allocations_ = 0;
+};
+
+/// Resets an arena when the scope of an operating point ends.
+class ArenaScope {
+public:
+    explicit ArenaScope(RunArena& arena) noexcept : arena_(arena) {}
+    ~ArenaScope() { arena_.reset(); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    RunArena& arena() const noexcept { return arena_; }
+
+private:
+    RunArena& arena_;
+};
+
+}  // namespace srm
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+#include "srm/aligned.hpp"
+#include "srm/capture_file.hpp"
+#include "srm/capture_format.hpp"
+#include "srm/capture_pyramid.hpp"
+#include "srm/channel_block.hpp"
+#include "srm/spsc_ring.hpp"
+
+namespace srm {
+
+struct AsyncWriterOptions {
+    /// DeltaRice chunks that would not shrink are stored Raw instead.
+    capture::ChunkEncoding encoding = capture::ChunkEncoding::DeltaRice;
+    std::size_t max_chunk_samples = 65536;   ///< per channel; sizes the queue slots
+    std::size_t queue_chunks = 8;
+    bool direct_io = true;                   ///< O_DIRECT, falls back if the filesystem refuses
+    bool use_io_uring = true;                ///< falls back to pwrite() if unavailable
+    /// Size of each of the two staging buffers that alternate between being
+    /// filled and being written. Rounded up to hold at least two chunks.
+    std::size_t write_buffer_bytes = std::size_t{4} << 20;
+    int cpu = -1;                            ///< pin the writer thread; -1 leaves it unpinned
+    /// NUMA node for the queue slots and staging buffers (the writer's,
+    /// ThreadPlacement::node()); -1 leaves them where they are first touched.
+    int numa_node = -1;
+    /// Also write the min/max/mean overview to pyramid_path(path), on the
+    /// writer thread.
+    bool build_pyramid = false;
+    PyramidConfig pyramid;
+};
+
+/// Capture writer that keeps disk I/O and compression off the acquisition
+/// thread.
+///
+/// write_chunk() copies the block into a preallocated queue slot and
+/// returns; a dedicated thread encodes each chunk (DeltaRice by default,
+/// 3-4x on rig data), appends it to a page-aligned staging buffer and writes
+/// full buffers through io_uring with O_DIRECT while the next buffer fills.
+/// The file is a standard capture file readable by CaptureReader; only the
+/// final buffer is padded for O_DIRECT and truncated back afterwards.
+///
+/// One producer thread. Errors on the writer thread are rethrown by the
+/// next write_chunk() or by finish().
+class AsyncCaptureWriter {
+public:
+    /// Throws std::invalid_argument for a bad header or zero-size options,
+    /// std::system_error if the file cannot be created.
+    AsyncCaptureWriter(const std::filesystem::path& path, const CaptureInfo& info,
+                       const AsyncWriterOptions& options = {});
+    ~AsyncCaptureWriter();
+
+    AsyncCaptureWriter(const AsyncCaptureWriter&) = delete;
+    AsyncCaptureWriter& operator=(const AsyncCaptureWriter&) = delete;
+
+    /// Queues a chunk without blocking. Returns false, and counts a dropped
+    /// chunk, if every slot is still waiting for the writer thread.
+    /// Throws std::invalid_argument for a block larger than
+    /// max_chunk_samples or with the wrong channel count, and on
+    /// out-of-order samples.
+    bool try_write_chunk(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample);
+
+    /// Queues a chunk, waiting for a free slot if necessary.
+    void write_chunk(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample);
+    void write_chunk(ChannelBlock<const std::int16_t> block) { write_chunk(block, next_sample_); }
+
+    /// Drains the queue, writes the index and trailer and closes the file.
+    /// Called by the destructor if omitted, but errors are then swallowed.
+    void finish();
+
+    std::uint64_t samples_written() const noexcept { return next_sample_; }
+    std::uint64_t chunks_written() const noexcept { return chunks_.load(std::memory_order_relaxed); }
+    std::uint64_t dropped_chunks() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+    /// Sample payload bytes before and after encoding, for chunks written so far.
+    std::uint64_t raw_bytes() const noexcept { return raw_bytes_.load(std::memory_order_relaxed); }
+    std::uint64_t stored_bytes() const noexcept { return stored_bytes_.load(std::memory_order_relaxed); }
+    double compression_ratio() const noexcept;
+
+    /// "io_uring" or "pwrite".
+    const char* io_backend() const noexcept;
+    bool direct_io() const noexcept;
+
+private:
+    struct Slot {
+        ChannelBuffer<std::int16_t> samples;
+        std::size_t count = 0;
+        std::uint64_t first_sample = 0;
+    };
+    class Sink;
+
+    bool enqueue(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample, bool wait);
+    void run() noexcept;
+    void write_slot(Slot& slot);
+    void rethrow_error();
+
+    AsyncWriterOptions options_;
+    std::size_t channel_count_ = 0;
+    std::unique_ptr<Sink> sink_;
+    std::unique_ptr<PyramidBuilder> pyramid_;
+    std::vector<Slot> slots_;
+    SpscRing<std::uint32_t> filled_;
+    SpscRing<std::uint32_t> free_;
+    std::counting_semaphore<> work_{0};
+    std::counting_semaphore<> free_slots_{0};
+    std::vector<capture::ChunkIndexEntry> index_;
+    std::uint64_t next_sample_ = 0;
+    std::uint64_t total_samples_ = 0;
+    std::atomic<bool> closing_{false};
+    std::atomic<bool> failed_{false};
+    std::exception_ptr error_;
+    std::atomic<std::uint64_t> chunks_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> raw_bytes_{0};
+    std::atomic<std::uint64_t> stored_bytes_{0};
+    std::thread thread_;
+    bool finished_ = false;
+};
+
+}  // namespace srm
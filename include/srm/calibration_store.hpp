@@ -0,0 +1,256 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/common.hpp"
+#include "srm/strain_conversion.hpp"
+
+namespace srm {
+
+inline constexpr std::uint16_t kNoThermocouple = 0xffff;
+
+/// One point of a gauge's thermal output curve: the apparent strain an
+/// unloaded, bonded gauge reads at @p temperature_c (data sheet or oven
+/// run, at the nominal gauge factor).
+struct ThermalOutputPoint {
+    float temperature_c = 0.0f;
+    float apparent_strain_ue = 0.0f;
+};
+
+/// Calibration record of the sensor wired to one channel.
+struct SensorCalibration {
+    std::uint16_t channel = 0;
+    std::string sensor_id;
+    /// Thermocouple input whose reading compensates this gauge, or
+    /// kNoThermocouple for no temperature compensation.
+    std::uint16_t thermocouple = kNoThermocouple;
+    /// Zero offset from the last balance; overrides the capture header's
+    /// value when has_zero_offset is set.
+    bool has_zero_offset = false;
+    float zero_offset_counts = 0.0f;
+    /// Shunt calibration: the strain the shunt resistor simulates and what
+    /// the channel read with it in place. Their ratio corrects the gain of
+    /// the whole signal path; 0/0 means not shunt-calibrated.
+    double shunt_expected_ue = 0.0;
+    double shunt_measured_ue = 0.0;
+    /// Fractional change of the gauge factor per degree away from
+    /// reference_temperature_c.
+    double gauge_factor_tc_per_c = 0.0;
+    float reference_temperature_c = 20.0f;
+    /// Thermal output curve in ascending temperature; empty for none.
+    std::vector<ThermalOutputPoint> thermal_output;
+};
+
+/// Parses calibration records, one per line as whitespace-separated
+/// key=value fields ('#' starts a comment):
+///
+///   channel=3 sensor=SG-104 thermocouple=0 zero=12.5
+///   shunt_expected=1000 shunt_measured=987.4 gf_tc=9.0e-5 reference_c=23
+///   thermal=-20:-35.2,0:-12.0,23:0,60:18.5,120:40.1
+///
+/// (all on one line; only channel and sensor are required). Throws
+/// std::runtime_error naming the line for a malformed record, a duplicate
+/// channel or sensor, or a thermal curve that is not ascending.
+std::vector<SensorCalibration> parse_calibration(std::string_view text);
+
+/// Reads and parses a calibration file; throws std::runtime_error if it
+/// cannot be read or is malformed.
+std::vector<SensorCalibration> load_calibration(const std::string& path);
+
+/// Immutable per-channel conversion constants with the calibration folded
+/// in, ready for convert_block().
+///
+/// Shunt calibration scales ratio_per_count. The gauge-factor drift and the
+/// thermal output (apparent strain, applied as the equivalent shift of the
+/// zero offset in counts so the kernel stays unchanged) depend on
+/// temperature and are tabulated once, at build time, on a uniform grid
+/// over each gauge's thermal curve; a block's constants are then one
+/// clamped index and a linear interpolation per channel instead of a search
+/// of the curve and a redo of the conversion algebra.
+class CalibrationSnapshot {
+public:
+    static constexpr std::size_t kDefaultTablePoints = 256;
+    static constexpr float kMinTemperatureC = -50.0f;
+    static constexpr float kMaxTemperatureC = 150.0f;
+
+    /// Channels without a record keep their header constants. Throws
+    /// std::invalid_argument for a record naming a channel not in
+    /// @p channels or already calibrated, a non-positive shunt reading, a
+    /// gauge factor that drifts through zero, fewer than two table points
+    /// or invalid channel metadata.
+    CalibrationSnapshot(std::span<const ChannelInfo> channels,
+                        std::span<const SensorCalibration> records,
+                        std::size_t table_points = kDefaultTablePoints);
+
+    std::size_t channel_count() const noexcept { return channels_.size(); }
+    /// Set by CalibrationStore::publish(); 0 for a snapshot never published.
+    std::uint64_t generation() const noexcept { return generation_; }
+
+    /// Empty for a channel without a calibration record.
+    const std::string& sensor_id(std::size_t channel) const noexcept { return channels_[channel].sensor_id; }
+    std::uint16_t thermocouple(std::size_t channel) const noexcept { return channels_[channel].thermocouple; }
+    /// Channel the sensor is wired to, or -1 if it is not in this snapshot.
+    std::ptrdiff_t find_sensor(std::string_view sensor_id) const noexcept;
+
+    /// Constants of @p channel at @p temperature_c (ignored for an
+    /// uncompensated channel; clamped to the thermal curve's range, or to
+    /// kMinTemperatureC..kMaxTemperatureC for a gauge without one).
+    ConversionParams params(std::size_t channel, float temperature_c) const noexcept;
+
+    /// Constants of every channel for one block; @p thermocouples_c holds
+    /// the block's reading of each thermocouple input. Throws
+    /// std::invalid_argument if @p out is not one entry per channel or a
+    /// referenced thermocouple is missing.
+    void params(std::span<const float> thermocouples_c, std::span<ConversionParams> out) const;
+
+    /// Appends a flat image of the tables to @p out for the startup plan
+    /// cache; from_image() restores an identical snapshot from it without
+    /// the records. Throws std::runtime_error for a malformed image.
+    void append_image(std::vector<std::byte>& out) const;
+    static CalibrationSnapshot from_image(std::span<const std::byte> image);
+
+private:
+    friend class CalibrationStore;
+
+    CalibrationSnapshot() = default;
+
+    struct Channel {
+        std::string sensor_id;
+        std::uint16_t thermocouple = kNoThermocouple;
+        capture::BridgeConfig bridge = capture::BridgeConfig::Quarter;
+        float ratio_per_count = 0.0f;
+        float first_c = 0.0f;
+        float inv_step = 0.0f;   // grid points per degree
+        std::size_t first = 0;   // into offsets_ / coeffs_
+        std::size_t points = 1;
+    };
+
+    std::vector<Channel> channels_;
+    std::vector<float> offsets_;  // offset_counts per grid point
+    std::vector<float> coeffs_;   // strain_coeff per grid point
+    std::uint64_t generation_ = 0;
+};
+
+/// Publishes calibration snapshots to the processing threads RCU-style.
+///
+/// The current snapshot is an atomic pointer. A reader announces itself in
+/// its own cache line (an odd sequence number) before loading the pointer
+/// and retires (even) when its block is done, so a block costs one store
+/// with a full fence and no lock, and it sees a single snapshot
+/// throughout. publish() swaps the pointer and then waits only for the
+/// readers that were inside a block at the time of the swap before freeing
+/// the old snapshot: once it returns, no block anywhere still uses the old
+/// coefficients, which is what makes a recalibration take effect cleanly.
+class CalibrationStore {
+public:
+    class ReadGuard;
+    class Reader;
+
+    /// Throws std::invalid_argument for zero @p max_readers.
+    explicit CalibrationStore(CalibrationSnapshot initial, std::size_t max_readers = 16);
+    /// Every Reader must have been destroyed.
+    ~CalibrationStore();
+
+    CalibrationStore(const CalibrationStore&) = delete;
+    CalibrationStore& operator=(const CalibrationStore&) = delete;
+
+    /// Registers a reader for one thread. Throws std::runtime_error if all
+    /// max_readers are taken.
+    Reader reader();
+
+    /// Makes @p next current and returns its generation. Blocks until no
+    /// reader is still inside a block that started on the previous
+    /// snapshot (at most one block time), then frees it. Throws
+    /// std::invalid_argument on a channel count change. Publishers are
+    /// serialised; readers are never blocked.
+    std::uint64_t publish(CalibrationSnapshot next);
+
+    std::uint64_t generation() const noexcept;
+    std::size_t channel_count() const noexcept { return channels_; }
+
+private:
+    struct alignas(kCacheLineSize) Slot {
+        std::atomic<std::uint64_t> sequence{0};  // odd while inside a block
+        std::atomic<bool> claimed{false};
+    };
+
+    std::size_t channels_;
+    std::atomic<const CalibrationSnapshot*> current_;
+    std::atomic<std::uint64_t> generation_{1};
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t slot_count_;
+    std::mutex publish_mutex_;
+};
+
+/// The snapshot one block runs on; obtained from Reader::read(). Holding it
+/// across blocks would delay the next publish(), so take one per block.
+class CalibrationStore::ReadGuard {
+public:
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ~ReadGuard() { slot_->sequence.store(sequence_ + 1, std::memory_order_release); }
+
+    const CalibrationSnapshot& operator*() const noexcept { return *snapshot_; }
+    const CalibrationSnapshot* operator->() const noexcept { return snapshot_; }
+
+private:
+    friend class Reader;
+    ReadGuard(Slot* slot, std::uint64_t sequence, const CalibrationSnapshot* snapshot) noexcept
+        : slot_(slot), sequence_(sequence), snapshot_(snapshot) {}
+
+    Slot* slot_;
+    std::uint64_t sequence_;  // odd
+    const CalibrationSnapshot* snapshot_;
+};
+
+/// One thread's registration with a CalibrationStore. Movable, not
+/// shareable: a reader holds at most one ReadGuard at a time.
+class CalibrationStore::Reader {
+public:
+    Reader(Reader&& other) noexcept
+        : store_(std::exchange(other.store_, nullptr)), slot_(std::exchange(other.slot_, nullptr)) {}
+    Reader& operator=(Reader&& other) noexcept {
+        if (this != &other) {
+            release();
+            store_ = std::exchange(other.store_, nullptr);
+            slot_ = std::exchange(other.slot_, nullptr);
+        }
+        return *this;
+    }
+    ~Reader() { release(); }
+
+    /// Enters a block and returns the current snapshot. Lock-free.
+    ReadGuard read() noexcept {
+        const std::uint64_t sequence = slot_->sequence.load(std::memory_order_relaxed) + 1;
+        // seq_cst store then seq_cst load: publish() either sees this slot
+        // odd or this load sees the new pointer.
+        slot_->sequence.store(sequence, std::memory_order_seq_cst);
+        return ReadGuard(slot_, sequence, store_->current_.load(std::memory_order_seq_cst));
+    }
+
+private:
+    friend class CalibrationStore;
+    Reader(CalibrationStore* store, Slot* slot) noexcept : store_(store), slot_(slot) {}
+
+    void release() noexcept {
+        if (slot_ != nullptr) {
+            slot_->claimed.store(false, std::memory_order_release);
+            slot_ = nullptr;
+        }
+    }
+
+    CalibrationStore* store_;
+    Slot* slot_;
+};
+
+}  // namespace srm
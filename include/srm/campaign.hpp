@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/thread_pool.hpp"
+
+namespace srm {
+
+/// Capture files directly inside @p directory with extension @p extension,
+/// sorted by path so that campaign output order never depends on the
+/// directory iteration order.
+std::vector<std::filesystem::path> list_captures(const std::filesystem::path& directory,
+                                                 const std::string& extension = ".srmcap");
+
+/// Contiguous chunk range [first_chunk, end_chunk) of one capture file.
+struct ChunkRange {
+    std::size_t first_chunk = 0;
+    std::size_t end_chunk = 0;
+};
+
+/// Splits @p chunk_count chunks into ranges of at most @p chunks_per_part
+/// chunks. A file with no chunks still yields one (empty) range so every
+/// file produces a result.
+std::vector<ChunkRange> split_chunks(std::size_t chunk_count, std::size_t chunks_per_part);
+
+/// Result row of one campaign file.
+template <typename Result>
+struct FileResult {
+    std::filesystem::path path;
+    Result result{};
+    std::string error;  ///< empty on success
+
+    bool ok() const noexcept { return error.empty(); }
+};
+
+struct CampaignOptions {
+    /// Chunks per task. Large files are split on chunk-index boundaries so
+    /// one long recording cannot leave the other cores idle at the end.
+    std::size_t chunks_per_task = 64;
+};
+
+/// Runs the same analysis over every file of a campaign on a work-stealing
+/// pool.
+///
+/// For each file, map(const CaptureReader&, ChunkRange) produces a partial
+/// Result per chunk range and merge(Result& into, Result&& part) folds the
+/// parts back together in chunk order. Because the fold order is fixed by
+/// the files and the chunk index, not by which worker finished first, the
+/// summary is identical on any number of threads as long as merge() is
+/// deterministic. A file that fails to open or throws during analysis gets
+/// its error recorded in its row; the rest of the campaign continues.
+class CampaignProcessor {
+public:
+    CampaignProcessor(WorkStealingPool& pool, CampaignOptions options = {})
+        : pool_(pool), options_(options) {}
+
+    template <typename Result, typename Map, typename Merge>
+    std::vector<FileResult<Result>> run(const std::vector<std::filesystem::path>& files,
+                                        Map map, Merge merge) const {
+        struct FileState {
+            std::unique_ptr<CaptureReader> reader;
+            std::vector<Result> parts;
+            std::vector<std::exception_ptr> errors;
+            std::exception_ptr open_error;
+        };
+        std::vector<FileState> states(files.size());
+
+        {
+            TaskGroup group(pool_);
+            for (std::size_t f = 0; f < files.size(); ++f) {
+                group.run([&, f] {
+                    FileState& state = states[f];
+                    try {
+                        state.reader = std::make_unique<CaptureReader>(files[f]);
+                    } catch (...) {
+                        state.open_error = std::current_exception();
+                        return;
+                    }
+                    const std::vector<ChunkRange> ranges =
+                        split_chunks(state.reader->chunk_count(), options_.chunks_per_task);
+                    state.parts.resize(ranges.size());
+                    state.errors.resize(ranges.size());
+                    for (std::size_t p = 0; p < ranges.size(); ++p) {
+                        group.run([&, p, range = ranges[p]] {
+                            try {
+                                state.parts[p] = map(std::as_const(*state.reader), range);
+                            } catch (...) {
+                                state.errors[p] = std::current_exception();
+                            }
+                        });
+                    }
+                });
+            }
+            group.wait();
+        }
+
+        std::vector<FileResult<Result>> rows(files.size());
+        TaskGroup group(pool_);
+        for (std::size_t f = 0; f < files.size(); ++f) {
+            group.run([&, f] {
+                FileState& state = states[f];
+                FileResult<Result>& row = rows[f];
+                row.path = files[f];
+                std::exception_ptr error = state.open_error;
+                for (const std::exception_ptr& e : state.errors) {
+                    if (!error && e) {
+                        error = e;
+                    }
+                }
+                if (error) {
+                    row.error = describe(error);
+                } else {
+                    for (std::size_t p = 0; p < state.parts.size(); ++p) {
+                        if (p == 0) {
+                            row.result = std::move(state.parts[0]);
+                        } else {
+                            merge(row.result, std::move(state.parts[p]));
+                        }
+                    }
+                }
+                state = FileState{};
+            });
+        }
+        group.wait();
+        return rows;
+    }
+
+private:
+    static std::string describe(const std::exception_ptr& error);
+
+    WorkStealingPool& pool_;
+    CampaignOptions options_;
+};
+
+}  // namespace srm
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "srm/capture_format.hpp"
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+/// Per-channel metadata stored in a capture header.
+struct ChannelInfo {
+    std::string name;
+    float gauge_factor = 2.0f;
+    float excitation_volts = 5.0f;
+    float amplifier_gain = 1.0f;
+    float volts_per_count = 10.0f / 32768.0f;
+    float zero_offset_counts = 0.0f;
+    capture::BridgeConfig bridge = capture::BridgeConfig::Quarter;
+};
+
+/// Everything in a capture header apart from the chunk layout.
+struct CaptureInfo {
+    double sample_rate_hz = 0.0;
+    std::uint16_t rotor_position_channel = capture::kNoChannel;
+    std::uint64_t start_time_ns = 0;
+    std::vector<ChannelInfo> channels;
+};
+
+namespace capture {
+
+/// Serialises FileHeader + ChannelDescriptors for @p info.
+/// Throws std::invalid_argument if the info cannot be represented.
+std::vector<std::byte> encode_header(const CaptureInfo& info);
+
+/// Parses and validates the header at the start of @p bytes.
+/// Throws std::runtime_error on a malformed or truncated header.
+CaptureInfo decode_header(std::span<const std::byte> bytes);
+
+}  // namespace capture
+
+/// Appends raw chunks to a capture file and writes the chunk index and
+/// trailer on finish(). Not thread-safe; one writer per file.
+class CaptureWriter {
+public:
+    CaptureWriter(const std::filesystem::path& path, const CaptureInfo& info);
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    /// Writes one chunk holding block.samples() samples of every channel,
+    /// continuing right after the previous chunk.
+    void write_chunk(ChannelBlock<const std::int16_t> block);
+
+    /// Writes a chunk whose first sample has index @p first_sample. Chunks
+    /// must be written in increasing sample order but may leave gaps.
+    void write_chunk(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample);
+
+    /// Writes the index and trailer and closes the file. Called by the
+    /// destructor if omitted, but errors are then swallowed.
+    void finish();
+
+    std::uint64_t samples_written() const noexcept { return next_sample_; }
+    std::size_t chunks_written() const noexcept { return index_.size(); }
+
+private:
+    void write_all(const void* data, std::size_t size);
+    void pad_to(std::uint64_t alignment);
+
+    int fd_ = -1;
+    std::size_t channel_count_ = 0;
+    std::uint64_t offset_ = 0;
+    std::uint64_t next_sample_ = 0;
+    std::uint64_t total_samples_ = 0;
+    std::vector<capture::ChunkIndexEntry> index_;
+};
+
+/// Read-only, zero-copy view of a capture file.
+///
+/// The whole file is mapped once; opening only parses the header and the
+/// chunk index, so cost is independent of the recording length. Channel
+/// views point straight into the mapping and stay valid for the reader's
+/// lifetime.
+class CaptureReader {
+public:
+    explicit CaptureReader(const std::filesystem::path& path);
+    ~CaptureReader();
+
+    CaptureReader(CaptureReader&& other) noexcept;
+    CaptureReader& operator=(CaptureReader&& other) noexcept;
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    const CaptureInfo& info() const noexcept { return info_; }
+    std::size_t channel_count() const noexcept { return info_.channels.size(); }
+    std::uint64_t total_samples() const noexcept { return total_samples_; }
+
+    std::span<const capture::ChunkIndexEntry> chunks() const noexcept { return index_; }
+    std::size_t chunk_count() const noexcept { return index_.size(); }
+
+    /// Samples of @p channel in chunk @p chunk, mapped in place.
+    /// Throws std::logic_error for chunks that are not stored raw.
+    std::span<const std::int16_t> channel(std::size_t chunk, std::size_t channel) const;
+
+    /// All channels of chunk @p chunk as a block, mapped in place.
+    /// Throws std::logic_error for chunks that are not stored raw.
+    ChannelBlock<const std::int16_t> chunk_block(std::size_t chunk) const;
+
+    /// True if chunk @p chunk can be viewed in place (channel(), chunk_block()).
+    bool is_raw(std::size_t chunk) const noexcept {
+        return index_[chunk].encoding == capture::ChunkEncoding::Raw;
+    }
+
+    /// Copies (raw) or decodes (compressed) @p channel of chunk @p chunk into
+    /// @p out, which must hold the chunk's sample_count samples. Works for
+    /// every encoding. Throws std::runtime_error on a corrupt payload.
+    void read_channel(std::size_t chunk, std::size_t channel, std::span<std::int16_t> out) const;
+
+    /// Index of the chunk containing per-channel sample @p sample, or
+    /// chunk_count() if no chunk covers it.
+    std::size_t find_chunk(std::uint64_t sample) const noexcept;
+
+    /// Hints the kernel that the mapping will be read front to back.
+    void advise_sequential() const noexcept;
+
+private:
+    void unmap() noexcept;
+
+    const std::byte* base_ = nullptr;
+    std::size_t size_ = 0;
+    CaptureInfo info_;
+    std::span<const capture::ChunkIndexEntry> index_;
+    std::uint64_t total_samples_ = 0;
+};
+
+}  // namespace srm
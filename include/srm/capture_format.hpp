@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+/// On-disk layout of an SRM capture file (*.srmcap).
+///
+///   FileHeader
+///   ChannelDescriptor[channel_count]
+///   chunk payloads ...                 (each starts at kChunkAlignment)
+///   ChunkIndexEntry[chunk_count]
+///   FileTrailer                        (last sizeof(FileTrailer) bytes)
+///
+/// All fields are little-endian. A raw chunk stores channel_count runs of
+/// sample_count int16 ADC counts, channel-major, so every channel of a chunk
+/// is one contiguous array that can be viewed in place through mmap. A
+/// DeltaRice chunk starts with a uint32 byte count per channel followed by
+/// the channels' coded streams back to back; it must be decoded. Readers
+/// locate the index through the trailer and never have to scan payloads.
+namespace srm::capture {
+
+static_assert(std::endian::native == std::endian::little,
+              "capture files are mapped in place and assume a little-endian host");
+
+inline constexpr std::array<char, 8> kFileMagic = {'S', 'R', 'M', 'C', 'A', 'P', '0', '1'};
+inline constexpr std::array<char, 8> kTrailerMagic = {'S', 'R', 'M', 'I', 'D', 'X', '0', '1'};
+inline constexpr std::uint32_t kFormatVersion = 1;
+inline constexpr std::uint32_t kChunkAlignment = 64;
+inline constexpr std::uint16_t kNoChannel = 0xFFFF;
+
+/// Wheatstone bridge arrangement of a gauge channel.
+enum class BridgeConfig : std::uint8_t {
+    Quarter = 1,  ///< one active gauge, nonlinear output
+    Half = 2,     ///< two active gauges in adjacent arms (bending)
+    Full = 4,     ///< four active gauges (bending)
+};
+
+/// How a chunk payload is encoded.
+enum class ChunkEncoding : std::uint16_t {
+    Raw = 0,        ///< channel-major int16 runs, mappable in place
+    DeltaRice = 1,  ///< lossless delta + zig-zag + Rice coding, see delta_rice.hpp
+};
+
+struct FileHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t header_bytes;        ///< FileHeader + all ChannelDescriptors
+    std::uint16_t channel_count;
+    std::uint16_t rotor_position_channel;  ///< kNoChannel when absent
+    std::uint32_t flags;
+    double sample_rate_hz;
+    std::uint64_t start_time_ns;       ///< CLOCK_REALTIME at first sample
+    std::array<std::uint8_t, 24> reserved;
+};
+static_assert(sizeof(FileHeader) == 64);
+
+struct ChannelDescriptor {
+    std::array<char, 24> name;         ///< NUL-padded
+    float gauge_factor;
+    float excitation_volts;
+    float amplifier_gain;
+    float volts_per_count;             ///< ADC LSB referred to the amplifier output
+    float zero_offset_counts;          ///< bridge balance at rest
+    BridgeConfig bridge;
+    std::array<std::uint8_t, 19> reserved;
+};
+static_assert(sizeof(ChannelDescriptor) == 64);
+
+struct ChunkIndexEntry {
+    std::uint64_t offset;              ///< file offset of the payload
+    std::uint64_t first_sample;        ///< per-channel sample index of the chunk start
+    std::uint32_t sample_count;        ///< samples per channel
+    std::uint32_t payload_bytes;
+    ChunkEncoding encoding;
+    std::uint16_t reserved0;
+    std::uint32_t reserved1;
+};
+static_assert(sizeof(ChunkIndexEntry) == 32);
+
+struct FileTrailer {
+    std::uint64_t index_offset;
+    std::uint64_t chunk_count;
+    std::uint64_t total_samples;       ///< per channel
+    std::array<char, 8> magic;
+};
+static_assert(sizeof(FileTrailer) == 32);
+
+}  // namespace srm::capture
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+/// Min/max/mean of a run of raw counts. A bin with no samples (a capture
+/// gap, or past the end) has min > max and a NaN mean.
+struct PyramidBin {
+    std::int16_t min = std::numeric_limits<std::int16_t>::max();
+    std::int16_t max = std::numeric_limits<std::int16_t>::min();
+    float mean = std::numeric_limits<float>::quiet_NaN();
+
+    bool empty() const noexcept { return min > max; }
+};
+static_assert(sizeof(PyramidBin) == 8);
+
+struct PyramidConfig {
+    std::uint32_t finest_factor = 10;  ///< samples per bin of level 0
+    std::uint32_t ratio = 10;          ///< bins of level l per bin of level l + 1
+    /// Level l bins finest_factor * ratio^l samples; the default reaches
+    /// 10^12 samples, over eleven days at 1 MS/s. Level 0 costs 8 bytes per
+    /// finest_factor samples and channel (40% of the raw counts at 10x).
+    std::uint32_t levels = 12;
+};
+
+namespace pyramid {
+
+inline constexpr std::array<char, 8> kFileMagic = {'S', 'R', 'M', 'P', 'Y', 'R', '0', '1'};
+inline constexpr std::array<char, 8> kTrailerMagic = {'S', 'R', 'M', 'P', 'I', 'X', '0', '1'};
+inline constexpr std::uint32_t kFormatVersion = 1;
+/// Bins per channel in one page; a page holds every channel, channel-major.
+inline constexpr std::uint32_t kBinsPerPage = 4096;
+
+// Sidecar layout (little-endian, like the capture file):
+//   FileHeader
+//   pages, each channels * kBinsPerPage PyramidBins, 64-byte aligned, in
+//   the order they filled up (levels interleaved)
+//   per level: uint64 page offsets, 0 for a page with no samples at all
+//   LevelDescriptor[level_count]
+//   FileTrailer
+// A page is written once it is full, so the builder never seeks and memory
+// stays at one page per level however long the recording runs.
+
+struct FileHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint16_t channel_count;
+    std::uint16_t level_count;
+    std::uint32_t finest_factor;
+    std::uint32_t ratio;
+    std::uint32_t bins_per_page;
+    std::uint32_t reserved0;
+    double sample_rate_hz;
+    std::array<std::uint8_t, 24> reserved;
+};
+static_assert(sizeof(FileHeader) == 64);
+
+struct LevelDescriptor {
+    std::uint64_t samples_per_bin;
+    std::uint64_t bin_count;
+    std::uint64_t page_count;
+    std::uint64_t index_offset;  ///< file offset of page_count uint64 page offsets
+};
+static_assert(sizeof(LevelDescriptor) == 32);
+
+struct FileTrailer {
+    std::uint64_t levels_offset;  ///< file offset of the LevelDescriptors
+    std::uint64_t total_samples;  ///< per channel, including gaps
+    std::array<char, 8> reserved;
+    std::array<char, 8> magic;
+};
+static_assert(sizeof(FileTrailer) == 32);
+
+}  // namespace pyramid
+
+/// Sidecar path of a capture: "run.srmcap" -> "run.srmpyr".
+std::filesystem::path pyramid_path(const std::filesystem::path& capture_path);
+
+/// Builds the min/max/mean pyramid of a recording as it streams past and
+/// writes it to a sidecar file.
+///
+/// Chunks are fed in sample order, gaps allowed, exactly as they go into
+/// the capture. Each level accumulates the bins completed by the level
+/// below, so every sample is touched once. Not thread-safe; the capture
+/// writer thread owns one.
+class PyramidBuilder {
+public:
+    /// Throws std::invalid_argument for a zero factor, ratio or level
+    /// count, std::system_error if the file cannot be created.
+    PyramidBuilder(const std::filesystem::path& path, std::size_t channels, double sample_rate_hz,
+                   const PyramidConfig& config = {});
+    ~PyramidBuilder();
+
+    PyramidBuilder(const PyramidBuilder&) = delete;
+    PyramidBuilder& operator=(const PyramidBuilder&) = delete;
+
+    /// Adds the samples of @p block, whose first sample has index
+    /// @p first_sample. Throws std::invalid_argument on out-of-order input.
+    void add(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample);
+
+    /// Flushes every level, writes the index and closes the file. Called by
+    /// the destructor if omitted, but errors are then swallowed.
+    void finish();
+
+    std::uint64_t samples_seen() const noexcept { return next_sample_; }
+
+private:
+    struct Accumulator {
+        std::int32_t min = std::numeric_limits<std::int16_t>::max();
+        std::int32_t max = std::numeric_limits<std::int16_t>::min();
+        std::int64_t sum = 0;
+        std::uint64_t count = 0;
+    };
+    struct Level {
+        std::uint64_t samples_per_bin = 0;
+        std::uint64_t bin = 0;               ///< bin being accumulated
+        bool has_data = false;               ///< any samples in the current bin
+        std::vector<Accumulator> acc;        ///< per channel
+        std::vector<PyramidBin> page;        ///< channels * kBinsPerPage
+        std::uint64_t page_first_bin = 0;
+        bool page_has_data = false;
+        std::vector<std::uint64_t> page_offsets;
+    };
+
+    void merge(std::size_t level, std::uint64_t bin, std::span<const Accumulator> column);
+    void close_bin(std::size_t level);
+    void skip_to(std::size_t level, std::uint64_t bin);
+    void flush_page(std::size_t level);
+    void write_all(const void* data, std::size_t size);
+    void pad_to(std::uint64_t alignment);
+
+    int fd_ = -1;
+    std::size_t channel_count_;
+    std::uint32_t ratio_;
+    std::vector<Level> levels_;
+    std::uint64_t next_sample_ = 0;
+    std::uint64_t offset_ = 0;
+};
+
+/// Builds the sidecar of an existing capture in one pass.
+void build_pyramid(const CaptureReader& capture, const std::filesystem::path& path,
+                   const PyramidConfig& config = {});
+
+/// Read-only mapped view of a pyramid sidecar. Opening parses only the
+/// headers and level table.
+class PyramidReader {
+public:
+    /// Throws std::system_error if the file cannot be opened,
+    /// std::runtime_error if it is malformed.
+    explicit PyramidReader(const std::filesystem::path& path);
+    ~PyramidReader();
+
+    PyramidReader(PyramidReader&& other) noexcept;
+    PyramidReader& operator=(PyramidReader&& other) noexcept;
+    PyramidReader(const PyramidReader&) = delete;
+    PyramidReader& operator=(const PyramidReader&) = delete;
+
+    std::size_t channel_count() const noexcept { return header_.channel_count; }
+    std::size_t level_count() const noexcept { return levels_.size(); }
+    double sample_rate_hz() const noexcept { return header_.sample_rate_hz; }
+    std::uint64_t total_samples() const noexcept { return total_samples_; }
+    std::uint64_t samples_per_bin(std::size_t level) const noexcept {
+        return levels_[level].samples_per_bin;
+    }
+    std::uint64_t bin_count(std::size_t level) const noexcept { return levels_[level].bin_count; }
+
+    /// Bin @p bin of @p channel at @p level; empty past the end or in a gap.
+    PyramidBin bin(std::size_t level, std::size_t channel, std::uint64_t bin) const noexcept;
+
+private:
+    void unmap() noexcept;
+
+    const std::byte* base_ = nullptr;
+    std::size_t size_ = 0;
+    pyramid::FileHeader header_{};
+    std::span<const pyramid::LevelDescriptor> levels_;
+    std::uint64_t total_samples_ = 0;
+};
+
+/// N-pixel views of any range of a capture in time bounded by N, not by the
+/// range: each column is the min/max/mean of its share of the range, read
+/// from the coarsest pyramid level that still has at least one bin per
+/// column, or straight from the capture once a column spans fewer than
+/// finest_factor samples (then at most N * finest_factor samples are
+/// decoded). Columns are in raw counts; min/max map to strain directly as
+/// the conversion is monotonic. Holds references to both readers.
+class CaptureOverview {
+public:
+    /// Throws std::invalid_argument if the two files do not match in
+    /// channel count.
+    CaptureOverview(const CaptureReader& capture, const PyramidReader& pyramid);
+
+    /// Fills out.size() columns covering samples [first, last) of
+    /// @p channel. Columns inside capture gaps are empty. Returns the level
+    /// used, or -1 if the columns came from the raw samples.
+    int view(std::size_t channel, std::uint64_t first, std::uint64_t last,
+             std::span<PyramidBin> out) const;
+
+private:
+    void view_raw(std::size_t channel, std::uint64_t first, std::uint64_t last,
+                  std::span<PyramidBin> out) const;
+
+    const CaptureReader& capture_;
+    const PyramidReader& pyramid_;
+    mutable std::vector<std::int16_t> decoded_;
+};
+
+}  // namespace srm
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "srm/aligned.hpp"
+
+namespace srm {
+
+/// Non-owning structure-of-arrays view over a block of multi-channel samples.
+///
+/// Channel c occupies data[c * stride, c * stride + samples). Every per-channel
+/// stage in the library takes its input and output as ChannelBlocks so a
+/// kernel only ever walks contiguous memory.
+template <typename T>
+class ChannelBlock {
+public:
+    using element_type = T;
+
+    constexpr ChannelBlock() noexcept = default;
+
+    constexpr ChannelBlock(T* data, std::size_t channels, std::size_t samples,
+                           std::size_t stride) noexcept
+        : data_(data), channels_(channels), samples_(samples), stride_(stride) {
+        assert(stride >= samples || channels <= 1);
+    }
+
+    /// Densely packed block (stride == samples).
+    constexpr ChannelBlock(T* data, std::size_t channels, std::size_t samples) noexcept
+        : ChannelBlock(data, channels, samples, samples) {}
+
+    /// Implicit T -> const T conversion.
+    template <typename U>
+        requires(std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+    constexpr ChannelBlock(const ChannelBlock<U>& other) noexcept
+        : ChannelBlock(other.data(), other.channels(), other.samples(), other.stride()) {}
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr std::size_t channels() const noexcept { return channels_; }
+    constexpr std::size_t samples() const noexcept { return samples_; }
+    constexpr std::size_t stride() const noexcept { return stride_; }
+    constexpr bool empty() const noexcept { return channels_ == 0 || samples_ == 0; }
+
+    constexpr std::span<T> channel(std::size_t c) const noexcept {
+        assert(c < channels_);
+        return {data_ + c * stride_, samples_};
+    }
+
+    /// Samples [first, first + count) of every channel.
+    constexpr ChannelBlock subblock(std::size_t first, std::size_t count) const noexcept {
+        assert(first + count <= samples_);
+        return {data_ + first, channels_, count, stride_};
+    }
+
+private:
+    T* data_ = nullptr;
+    std::size_t channels_ = 0;
+    std::size_t samples_ = 0;
+    std::size_t stride_ = 0;
+};
+
+/// Owning, cache-line-aligned multi-channel buffer. Each channel starts on
+/// its own cache line (the stride is padded), so views of it satisfy the
+/// alignment the SIMD kernels prefer.
+template <typename T>
+class ChannelBuffer {
+public:
+    ChannelBuffer() = default;
+
+    ChannelBuffer(std::size_t channels, std::size_t samples)
+        : channels_(channels),
+          samples_(samples),
+          stride_(padded_count<T>(samples)),
+          storage_(channels * stride_) {}
+
+    std::size_t channels() const noexcept { return channels_; }
+    std::size_t samples() const noexcept { return samples_; }
+    std::size_t stride() const noexcept { return stride_; }
+
+    std::span<T> channel(std::size_t c) noexcept { return view().channel(c); }
+    std::span<const T> channel(std::size_t c) const noexcept { return view().channel(c); }
+
+    ChannelBlock<T> view() noexcept { return {storage_.data(), channels_, samples_, stride_}; }
+    ChannelBlock<const T> view() const noexcept {
+        return {storage_.data(), channels_, samples_, stride_};
+    }
+
+private:
+    std::size_t channels_ = 0;
+    std::size_t samples_ = 0;
+    std::size_t stride_ = 0;
+    AlignedVector<T> storage_;
+};
+
+}  // namespace srm
@@ -0,0 +1,477 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "srm/channel_block.hpp"
+#include "srm/filter_design.hpp"
+#include "srm/strain_conversion.hpp"
+
+namespace srm {
+
+// ---- Stages -----------------------------------------------------------------
+//
+// A stage is a copyable type with
+//
+//   template <std::size_t W> struct State;         state of W channels
+//   template <std::size_t W>
+//   State<W> make_state(std::size_t first_channel) const;
+//   template <std::size_t W, typename Emit>
+//   void push(State<W>& state, Lanes<W> x, Emit&& emit) const noexcept;
+//
+// push() consumes one sample of W channels side by side and calls emit(y)
+// zero or more times, so rate changes (decimation, resampling) compose like
+// any other stage. Every channel runs at the same rate, so the control flow
+// is shared and the arithmetic is written on whole vectors of lanes. The
+// same stage types run in both pipelines below:
+// FusedPipeline instantiates them at kPipelineLanes and inlines the whole
+// chain into one loop, DynamicPipeline at W = 1 behind a virtual call per
+// stage and sample. Lanes never interact, so both produce identical results
+// as long as neither is compiled with floating-point contraction: build the
+// translation units that compare them with -ffp-contract=off (GCC contracts
+// to FMA by default wherever the target has it, and may do so differently
+// in the vector and scalar code).
+
+namespace detail {
+// Vector types with a dependent width must be declared in a class template;
+// an alias template would drop the attribute.
+template <std::size_t W>
+struct LaneVectors {
+    typedef float f __attribute__((vector_size(W * sizeof(float))));
+    typedef double d __attribute__((vector_size(W * sizeof(double))));
+};
+// Plain scalars for one lane; compilers handle 1-element vectors poorly.
+template <>
+struct LaneVectors<1> {
+    typedef float f;
+    typedef double d;
+};
+}  // namespace detail
+
+/// One sample of W channels, a GCC/Clang vector (a plain float for W = 1):
+/// arithmetic is elementwise and a scalar operand is broadcast.
+template <std::size_t W>
+using Lanes = typename detail::LaneVectors<W>::f;
+template <std::size_t W>
+using DoubleLanes = typename detail::LaneVectors<W>::d;
+
+/// Channels FusedPipeline processes together: one SSE register, the
+/// baseline x86-64 and NEON width, so no ABI or ISA flags are involved.
+inline constexpr std::size_t kPipelineLanes = 4;
+
+/// Element access that also works on the scalar W = 1 lanes.
+template <std::size_t W, typename V>
+auto get_lane(const V& v, std::size_t lane) noexcept {
+    if constexpr (W == 1) {
+        return v;
+    } else {
+        return v[lane];
+    }
+}
+
+template <std::size_t W, typename V, typename T>
+void set_lane(V& v, std::size_t lane, T value) noexcept {
+    if constexpr (W == 1) {
+        v = value;
+    } else {
+        v[lane] = value;
+    }
+}
+
+/// Raw counts to microstrain, bit-identical to convert_sample(). Must be
+/// the first stage; its input is the count as a float.
+class ConvertStage {
+public:
+    template <std::size_t W>
+    struct State {
+        Lanes<W> offset{};
+        Lanes<W> ratio{};
+        Lanes<W> coeff{};
+        Lanes<W> quarter{};  ///< 1 for quarter bridges, else 0
+    };
+
+    explicit ConvertStage(std::span<const ConversionParams> params)
+        : params_(params.begin(), params.end()) {}
+
+    /// Lanes past the last channel convert to 0.
+    template <std::size_t W>
+    State<W> make_state(std::size_t first_channel) const {
+        State<W> s;
+        for (std::size_t l = 0; l < W && first_channel + l < params_.size(); ++l) {
+            const ConversionParams& p = params_[first_channel + l];
+            set_lane<W>(s.offset, l, p.offset_counts);
+            set_lane<W>(s.ratio, l, p.ratio_per_count);
+            set_lane<W>(s.coeff, l, p.strain_coeff);
+            set_lane<W>(s.quarter, l, p.bridge == capture::BridgeConfig::Quarter ? 1.0f : 0.0f);
+        }
+        return s;
+    }
+
+    template <std::size_t W, typename Emit>
+    void push(State<W>& s, Lanes<W> x, Emit&& emit) const noexcept {
+        const Lanes<W> r = (x - s.offset) * s.ratio;
+        // quarter is 0 or 1, so the denominator is exactly 1 or 1 + 2r.
+        emit((s.coeff * r) / (1.0f + s.quarter * (r + r)));
+    }
+
+private:
+    std::vector<ConversionParams> params_;
+};
+
+/// Transposed direct form II biquad, e.g. a design_notch() at a fixed
+/// commutation harmonic.
+class BiquadStage {
+public:
+    template <std::size_t W>
+    struct State {
+        Lanes<W> z1{};
+        Lanes<W> z2{};
+    };
+
+    explicit BiquadStage(const BiquadCoefficients& c) noexcept : c_(c) {}
+
+    template <std::size_t W>
+    State<W> make_state(std::size_t) const noexcept {
+        return {};
+    }
+
+    template <std::size_t W, typename Emit>
+    void push(State<W>& s, Lanes<W> x, Emit&& emit) const noexcept {
+        const Lanes<W> y = c_.b0 * x + s.z1;
+        s.z1 = c_.b1 * x - c_.a1 * y + s.z2;
+        s.z2 = c_.b2 * x - c_.a2 * y;
+        emit(y);
+    }
+
+private:
+    BiquadCoefficients c_;
+};
+
+/// Decimating FIR with a compile-time tap count: one dot product per
+/// output over a doubled delay line, so the window is always contiguous.
+template <std::size_t Taps>
+class FirDecimateStage {
+public:
+    template <std::size_t W>
+    struct State {
+        std::array<Lanes<W>, 2 * Taps> line{};
+        std::size_t pos = 0;
+        unsigned phase = 0;
+    };
+
+    FirDecimateStage(const std::array<float, Taps>& taps, unsigned factor) : taps_(taps), factor_(factor) {
+        if (factor == 0) {
+            throw std::invalid_argument("pipeline: decimation factor must be positive");
+        }
+    }
+
+    template <std::size_t W>
+    State<W> make_state(std::size_t) const noexcept {
+        return {};
+    }
+
+    template <std::size_t W, typename Emit>
+    void push(State<W>& s, Lanes<W> x, Emit&& emit) const noexcept {
+        s.line[s.pos] = x;
+        s.line[s.pos + Taps] = x;
+        if (++s.phase == factor_) {
+            s.phase = 0;
+            // line[pos + Taps - k] is x[n - k].
+            const Lanes<W>* window = s.line.data() + s.pos + 1;
+            Lanes<W> acc{};
+            for (std::size_t k = 0; k < Taps; ++k) {
+                acc += taps_[Taps - 1 - k] * window[k];
+            }
+            emit(acc);
+        }
+        s.pos = s.pos + 1 == Taps ? 0 : s.pos + 1;
+    }
+
+private:
+    std::array<float, Taps> taps_;
+    unsigned factor_;
+};
+
+/// Linear-interpolation resampler by a fixed ratio: one output every
+/// @p step input samples (step > 1 decimates, < 1 interpolates).
+class LinearResampleStage {
+public:
+    template <std::size_t W>
+    struct State {
+        Lanes<W> prev{};
+        double t = 0.0;  ///< position of the next output past prev, in inputs
+        bool primed = false;
+    };
+
+    explicit LinearResampleStage(double step) : step_(step) {
+        if (!(step > 0.0)) {
+            throw std::invalid_argument("pipeline: resampling step must be positive");
+        }
+    }
+
+    template <std::size_t W>
+    State<W> make_state(std::size_t) const noexcept {
+        return {};
+    }
+
+    template <std::size_t W, typename Emit>
+    void push(State<W>& s, Lanes<W> x, Emit&& emit) const noexcept {
+        if (!s.primed) {
+            s.primed = true;
+            s.prev = x;
+            emit(x);
+            s.t = step_;
+            return;
+        }
+        while (s.t <= 1.0) {
+            emit(s.prev + static_cast<float>(s.t) * (x - s.prev));
+            s.t += step_;
+        }
+        s.t -= 1.0;
+        s.prev = x;
+    }
+
+private:
+    double step_;
+};
+
+/// Running min/max/mean/RMS; passes samples through unchanged.
+class StatsStage {
+public:
+    template <std::size_t W>
+    struct State {
+        Lanes<W> min = Lanes<W>{} + std::numeric_limits<float>::infinity();
+        Lanes<W> max = Lanes<W>{} - std::numeric_limits<float>::infinity();
+        DoubleLanes<W> sum{};
+        DoubleLanes<W> sum_sq{};
+        std::uint64_t count = 0;
+    };
+
+    struct Summary {
+        float min = 0.0f;
+        float max = 0.0f;
+        double mean = 0.0;
+        double rms = 0.0;
+        std::uint64_t count = 0;
+    };
+
+    template <std::size_t W>
+    State<W> make_state(std::size_t) const noexcept {
+        return {};
+    }
+
+    template <std::size_t W, typename Emit>
+    void push(State<W>& s, Lanes<W> x, Emit&& emit) const noexcept {
+        s.min = x < s.min ? x : s.min;
+        s.max = x > s.max ? x : s.max;
+        DoubleLanes<W> wide;
+        if constexpr (W == 1) {
+            wide = x;
+        } else {
+            wide = __builtin_convertvector(x, DoubleLanes<W>);
+        }
+        s.sum += wide;
+        s.sum_sq += wide * wide;
+        ++s.count;
+        emit(x);
+    }
+
+    template <std::size_t W>
+    static Summary summary(const State<W>& s, std::size_t lane) noexcept;
+};
+
+template <std::size_t W>
+StatsStage::Summary StatsStage::summary(const State<W>& s, std::size_t lane) noexcept {
+    Summary out;
+    out.count = s.count;
+    if (s.count != 0) {
+        const auto n = static_cast<double>(s.count);
+        out.min = get_lane<W>(s.min, lane);
+        out.max = get_lane<W>(s.max, lane);
+        out.mean = get_lane<W>(s.sum, lane) / n;
+        out.rms = std::sqrt(get_lane<W>(s.sum_sq, lane) / n);
+    }
+    return out;
+}
+
+// ---- FusedPipeline ----------------------------------------------------------
+
+namespace detail {
+/// Throws std::invalid_argument unless a block has the pipeline's channels.
+void check_channels(std::size_t given, std::size_t expected);
+}  // namespace detail
+
+/// Compile-time composition of stages for a fixed rig configuration.
+///
+/// process() takes kPipelineLanes channels at a time and runs one loop over
+/// the block in which every stage's push() and emit callback is visible to
+/// the compiler, so the chain collapses into a single inlined loop body
+/// operating on whole registers of channels. Class template argument
+/// deduction makes construction read like the chain:
+///
+///   FusedPipeline pipeline(channels, ConvertStage(params),
+///                          BiquadStage(design_notch(f, 8.0)),
+///                          FirDecimateStage(kHalfband31, 2), StatsStage{});
+template <typename... Stages>
+class FusedPipeline {
+    static_assert(sizeof...(Stages) > 0, "a pipeline needs at least one stage");
+    static constexpr std::size_t W = kPipelineLanes;
+
+public:
+    using States = std::tuple<typename Stages::template State<W>...>;
+
+    FusedPipeline(std::size_t channels, Stages... stages)
+        : channels_(channels), stages_(std::move(stages)...) {
+        reset();
+    }
+
+    std::size_t channels() const noexcept { return channels_; }
+
+    /// Pushes every sample of every channel through the chain. Throws
+    /// std::invalid_argument unless @p in has exactly channels() channels.
+    void process(ChannelBlock<const std::int16_t> in) {
+        detail::check_channels(in.channels(), channels_);
+        for (std::size_t g = 0; g < groups_.size(); ++g) {
+            const std::int16_t* src[W];
+            std::size_t live = 0;
+            for (; live < W && g * W + live < channels_; ++live) {
+                src[live] = in.channel(g * W + live).data();
+            }
+            States& st = groups_[g];
+            for (std::size_t i = 0; i < in.samples(); ++i) {
+                Lanes<W> x{};
+                for (std::size_t l = 0; l < live; ++l) {
+                    x[l] = static_cast<float>(src[l][i]);
+                }
+                emit<0>(st, x);
+            }
+        }
+    }
+
+    /// Result of stage @p I for @p channel, for stages that provide
+    /// summary() (StatsStage).
+    template <std::size_t I>
+    auto summary(std::size_t channel) const noexcept {
+        return std::get<I>(stages_).summary(std::get<I>(groups_[channel / W]), channel % W);
+    }
+
+    template <std::size_t I>
+    const auto& stage() const noexcept {
+        return std::get<I>(stages_);
+    }
+
+    void reset() {
+        groups_.clear();
+        for (std::size_t first = 0; first < channels_; first += W) {
+            groups_.push_back(make_states(first, std::index_sequence_for<Stages...>{}));
+        }
+    }
+
+private:
+    template <std::size_t... I>
+    States make_states(std::size_t first_channel, std::index_sequence<I...>) const {
+        return States{std::get<I>(stages_).template make_state<W>(first_channel)...};
+    }
+
+    template <std::size_t I>
+    [[gnu::always_inline]] void emit(States& st, Lanes<W> x) noexcept {
+        if constexpr (I < sizeof...(Stages)) {
+            std::get<I>(stages_).push(std::get<I>(st), x,
+                                      [this, &st](Lanes<W> y) { emit<I + 1>(st, y); });
+        }
+    }
+
+    std::size_t channels_;
+    std::tuple<Stages...> stages_;
+    std::vector<States> groups_;
+};
+
+// ---- DynamicPipeline --------------------------------------------------------
+
+/// Type-erased stage of a DynamicPipeline.
+class DynamicStage {
+public:
+    virtual ~DynamicStage() = default;
+    virtual void push(std::size_t channel, float x) noexcept = 0;
+    virtual void reset() = 0;
+
+    void set_next(DynamicStage* next) noexcept { next_ = next; }
+
+protected:
+    DynamicStage* next_ = nullptr;
+};
+
+template <typename Stage>
+class DynamicStageAdapter final : public DynamicStage {
+public:
+    DynamicStageAdapter(Stage stage, std::size_t channels) : stage_(std::move(stage)), channels_(channels) {
+        reset();
+    }
+
+    void push(std::size_t channel, float x) noexcept override {
+        stage_.push(states_[channel], Lanes<1>{x}, [this, channel](Lanes<1> y) {
+            if (next_ != nullptr) {
+                next_->push(channel, y);
+            }
+        });
+    }
+
+    void reset() override {
+        states_.clear();
+        for (std::size_t c = 0; c < channels_; ++c) {
+            states_.push_back(stage_.template make_state<1>(c));
+        }
+    }
+
+    const Stage& stage() const noexcept { return stage_; }
+
+    /// Same as FusedPipeline::summary().
+    auto summary(std::size_t channel) const noexcept { return stage_.summary(states_[channel], 0); }
+
+private:
+    Stage stage_;
+    std::size_t channels_;
+    std::vector<typename Stage::template State<1>> states_;
+};
+
+/// Runtime-assembled chain of the same stages, for experiments and for
+/// configurations nobody has instantiated a FusedPipeline for. Every stage
+/// boundary is a virtual call per sample, so expect about three times the
+/// per-sample cost of the fused equivalent (see bench_pipeline.cpp).
+class DynamicPipeline {
+public:
+    explicit DynamicPipeline(std::size_t channels) : channels_(channels) {}
+
+    std::size_t channels() const noexcept { return channels_; }
+    std::size_t stage_count() const noexcept { return stages_.size(); }
+
+    /// Appends @p stage and returns it, for reading its state later.
+    template <typename Stage>
+    DynamicStageAdapter<Stage>& add(Stage stage) {
+        auto adapter = std::make_unique<DynamicStageAdapter<Stage>>(std::move(stage), channels_);
+        DynamicStageAdapter<Stage>& ref = *adapter;
+        append(std::move(adapter));
+        return ref;
+    }
+
+    /// Same contract as FusedPipeline::process().
+    void process(ChannelBlock<const std::int16_t> in);
+    void reset();
+
+private:
+    void append(std::unique_ptr<DynamicStage> stage);
+
+    std::size_t channels_;
+    std::vector<std::unique_ptr<DynamicStage>> stages_;
+};
+
+}  // namespace srm
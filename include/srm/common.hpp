@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+namespace srm {
+
+/// Size used to pad shared atomics so producer- and consumer-owned state
+/// never share a cache line. 64 bytes covers x86-64 and the Cortex-A cores
+/// we run on; std::hardware_destructive_interference_size is not stable
+/// across compilers, so we pin it here.
+inline constexpr std::size_t kCacheLineSize = 64;
+
+/// Smallest power of two that is >= @p value (1 for 0).
+constexpr std::size_t round_up_pow2(std::size_t value) noexcept {
+    std::size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+constexpr bool is_pow2(std::size_t value) noexcept {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+/// Spin-wait hint for polling loops (PAUSE / YIELD).
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+}  // namespace srm
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+enum class EdgeKind : std::uint8_t {
+    TurnOn,   ///< phase current rose through the on threshold
+    TurnOff,  ///< phase current fell through the off threshold
+};
+
+/// Hysteresis edge detector settings for one phase-current channel, in the
+/// units of the samples fed to the builder.
+struct EdgeDetectorConfig {
+    float on_threshold = 1.0f;
+    float off_threshold = 0.5f;      ///< must be <= on_threshold
+    std::uint32_t min_dwell = 0;     ///< samples an edge must hold before the next one counts
+};
+
+/// Sorted per-phase turn-on/turn-off sample indices.
+///
+/// Each list is a plain ascending array of absolute sample numbers, so any
+/// range query is a binary search and a span, and every downstream analysis
+/// reads only the windows around the events instead of rescanning the
+/// recording.
+class CommutationIndex {
+public:
+    explicit CommutationIndex(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : on_(memory), off_(memory) {}
+    explicit CommutationIndex(std::size_t phases,
+                              std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : on_(phases, memory), off_(phases, memory) {}
+
+    std::size_t phase_count() const noexcept { return on_.size(); }
+
+    /// All edges of one kind for @p phase, ascending.
+    std::span<const std::uint64_t> edges(std::size_t phase, EdgeKind kind) const noexcept {
+        return kind == EdgeKind::TurnOn ? std::span<const std::uint64_t>(on_[phase])
+                                        : std::span<const std::uint64_t>(off_[phase]);
+    }
+
+    /// Edges of one kind with first_sample <= sample < end_sample.
+    std::span<const std::uint64_t> edges(std::size_t phase, EdgeKind kind,
+                                         std::uint64_t first_sample,
+                                         std::uint64_t end_sample) const noexcept;
+
+    /// Appends an edge; samples per (phase, kind) must be non-decreasing.
+    void append(std::size_t phase, EdgeKind kind, std::uint64_t sample);
+
+    /// Memory held by the edge lists, in bytes.
+    std::size_t memory_bytes() const noexcept;
+
+private:
+    std::pmr::vector<std::pmr::vector<std::uint64_t>> on_;
+    std::pmr::vector<std::pmr::vector<std::uint64_t>> off_;
+};
+
+/// Single-pass builder: feed phase-current blocks in order (one channel per
+/// phase) and read the index at any point.
+class CommutationIndexBuilder {
+public:
+    /// The index's edge lists are allocated from @p memory.
+    /// Throws std::invalid_argument if a threshold pair is inverted.
+    explicit CommutationIndexBuilder(
+        std::span<const EdgeDetectorConfig> phases,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    void push(ChannelBlock<const float> phase_currents);
+
+    std::uint64_t samples_seen() const noexcept { return sample_; }
+    const CommutationIndex& index() const noexcept { return index_; }
+    CommutationIndex take() noexcept { return std::move(index_); }
+
+private:
+    struct PhaseState {
+        EdgeDetectorConfig config;
+        bool conducting = false;
+        std::uint64_t last_edge = 0;
+        bool seen_edge = false;
+    };
+
+    std::vector<PhaseState> phases_;
+    CommutationIndex index_;
+    std::uint64_t sample_ = 0;
+};
+
+}  // namespace srm
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "srm/channel_block.hpp"
+#include "srm/spectrum.hpp"
+#include "srm/streaming_stats.hpp"
+
+namespace srm {
+
+namespace dashboard {
+
+inline constexpr std::array<char, 8> kFileMagic = {'S', 'R', 'M', 'D', 'S', 'H', '0', '1'};
+inline constexpr std::uint32_t kFormatVersion = 1;
+
+// Feed layout (one shared mapping, native byte order, 64-byte aligned):
+//   FileHeader
+//   Control
+//   waveform ring: waveform_capacity points x channels WaveformPoints,
+//                  point-major (point i in slot i % waveform_capacity)
+//   statistics slots: 2 x channels ChannelStatistics
+//   spectrum slots:   2 x (SpectrumMeta + channels x spectrum_points floats)
+// Offsets follow from the header fields alone; see layout().
+
+struct FileHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t channel_count;
+    std::uint32_t waveform_capacity;
+    std::uint32_t spectrum_points;
+    std::uint64_t samples_per_point;
+    double sample_rate_hz;
+    std::uint64_t file_bytes;
+    std::array<std::uint8_t, 16> reserved;
+};
+static_assert(sizeof(FileHeader) == 64);
+
+/// Publication counters of one section. The publisher raises begun before
+/// it touches the data and published after; a reader that copied version
+/// or point v keeps it only if begun had not yet reached the write that
+/// overwrites it. The publisher never looks at readers.
+struct alignas(64) Sequence {
+    std::atomic<std::uint64_t> begun{0};
+    std::atomic<std::uint64_t> published{0};
+};
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "counters are shared between processes");
+
+enum class FeedState : std::uint64_t {
+    Live = 1,
+    Closed = 2,  ///< the publisher is gone; reopen to follow the next run
+};
+
+struct Control {
+    alignas(64) std::atomic<std::uint64_t> state{0};
+    Sequence waveform;    ///< counts points
+    Sequence statistics;  ///< counts snapshots; the latest is in slot published % 2
+    Sequence spectrum;
+};
+static_assert(sizeof(Control) == 256);
+
+struct SpectrumMeta {
+    std::uint64_t frame_index;
+    std::uint64_t end_sample;
+    std::uint32_t source_bins;     ///< bins of the SpectrumFrame
+    std::uint32_t bins_per_point;  ///< source bins max-pooled into each point
+    std::uint32_t points;          ///< valid points per channel
+    std::uint32_t reserved[9];
+};
+static_assert(sizeof(SpectrumMeta) == 64);
+
+struct Layout {
+    std::size_t control;
+    std::size_t waveform;
+    std::size_t statistics;  ///< slot 0; slot 1 follows at statistics_stride
+    std::size_t statistics_stride;
+    std::size_t spectrum;
+    std::size_t spectrum_stride;
+    std::size_t file_bytes;
+};
+
+Layout layout(const FileHeader& header) noexcept;
+
+/// Running min/max/sum of a waveform point being accumulated.
+struct Accumulator {
+    float min;
+    float max;
+    float sum;
+};
+
+}  // namespace dashboard
+
+/// Min/max/mean of samples_per_point strain samples, in microstrain.
+struct WaveformPoint {
+    float min;
+    float max;
+    float mean;
+};
+static_assert(sizeof(WaveformPoint) == 12);
+
+struct DashboardConfig {
+    std::size_t samples_per_point = 1000;  ///< input samples per waveform point
+    /// Points a viewer can always fetch; the ring keeps twice as many so a
+    /// block written during a read only costs the oldest points.
+    std::size_t waveform_points = 8192;
+    std::size_t spectrum_points = 1024;    ///< display bins per channel
+};
+
+/// Live view feed for operator dashboards, published from the processing
+/// thread into a shared mapping (put it under /dev/shm) that any number of
+/// viewer processes map read-only and poll at their own rate.
+///
+/// Nothing a viewer does can slow acquisition: the publisher only ever
+/// writes, with no lock, no wait and no knowledge of who is reading.
+/// Waveforms go into an overwrite ring of decimated points; rarely changing
+/// summaries (statistics, spectra) are double-buffered, written into the
+/// slot readers are not directed to. Every section carries begun/published
+/// counters, so a reader that was overtaken while copying notices,
+/// discards what was overwritten and tries again.
+///
+/// Feed it the strain the processing chain has already decimated, not the
+/// raw-rate stream: samples_per_point and sample_rate_hz are in terms of
+/// what add_waveform() receives. The hot-path cost is then one vectorised
+/// min/max/sum pass over the decimated samples, under 1% of the fused
+/// pipeline that produced them (BM_DashboardFeed against BM_FusedPipeline),
+/// plus a max-pool of each published spectrum frame. Not thread-safe: one
+/// thread publishes each feed.
+class DashboardPublisher {
+public:
+    /// Replaces any feed at @p path (a viewer still mapping the old one sees
+    /// it closed). @p sample_rate_hz is the rate of the strain passed to
+    /// add_waveform(). Throws std::invalid_argument for zero channels or sizes,
+    /// std::system_error if the mapping cannot be created.
+    DashboardPublisher(const std::filesystem::path& path, std::size_t channels, double sample_rate_hz,
+                       const DashboardConfig& config = {});
+    ~DashboardPublisher();
+
+    DashboardPublisher(const DashboardPublisher&) = delete;
+    DashboardPublisher& operator=(const DashboardPublisher&) = delete;
+
+    const std::filesystem::path& path() const noexcept { return path_; }
+    std::size_t channels() const noexcept { return channels_; }
+
+    /// Folds a block of strain (all channels) into the waveform, publishing
+    /// every point it completes. Throws std::invalid_argument on a channel
+    /// count mismatch.
+    void add_waveform(ChannelBlock<const float> block);
+    std::uint64_t points_published() const noexcept { return points_; }
+
+    /// Max-pools @p frame to at most spectrum_points bins per channel and
+    /// publishes it. Throws std::invalid_argument on a channel count
+    /// mismatch.
+    void publish_spectrum(const SpectrumFrame& frame);
+
+    /// Publishes the summary of every channel. Called at the dashboard's
+    /// refresh rate, not per block: the quantiles are estimated on demand.
+    void publish_statistics(const StrainStatistics& statistics);
+
+private:
+    void reset_accumulators() noexcept;
+
+    std::filesystem::path path_;
+    std::size_t channels_;
+    DashboardConfig config_;
+    dashboard::Layout layout_{};
+    std::byte* base_ = nullptr;
+    dashboard::Control* control_ = nullptr;
+    WaveformPoint* ring_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::vector<dashboard::Accumulator> acc_;   // per channel
+    std::vector<dashboard::Accumulator> done_;  // points completed by one channel's pass
+    std::size_t fill_ = 0;                     // samples in the point being accumulated
+    std::uint64_t points_ = 0;
+    std::uint64_t statistics_ = 0;
+    std::uint64_t spectra_ = 0;
+};
+
+/// Latest points of every channel, oldest first.
+struct WaveformWindow {
+    std::uint64_t first_point = 0;  ///< running index; first sample is first_point * samples_per_point
+    std::size_t points = 0;
+    std::size_t channels = 0;
+    std::vector<WaveformPoint> values;  ///< points x channels, point-major
+
+    const WaveformPoint& at(std::size_t point, std::size_t channel) const noexcept {
+        return values[point * channels + channel];
+    }
+};
+
+struct SpectrumSnapshot {
+    std::uint64_t frame_index = 0;
+    std::uint64_t end_sample = 0;
+    std::size_t source_bins = 0;
+    std::size_t bins_per_point = 0;  ///< display point p covers source bins [p * bins_per_point, ...)
+    std::size_t points = 0;
+    std::vector<float> amplitude;    ///< channels x points
+
+    std::span<const float> channel(std::size_t c) const noexcept {
+        return std::span(amplitude).subspan(c * points, points);
+    }
+};
+
+/// A viewer's read-only mapping of a DashboardPublisher's feed.
+///
+/// Reads copy out of the mapping and never block; they return false (or no
+/// points) only when nothing has been published yet or the publisher
+/// overtook every retry, which at dashboard rates does not happen in
+/// practice. Safe to use from several threads.
+class DashboardReader {
+public:
+    /// Throws std::runtime_error if @p path is not a dashboard feed,
+    /// std::system_error if it cannot be mapped.
+    explicit DashboardReader(const std::filesystem::path& path);
+    ~DashboardReader();
+
+    DashboardReader(const DashboardReader&) = delete;
+    DashboardReader& operator=(const DashboardReader&) = delete;
+
+    std::size_t channels() const noexcept { return header_.channel_count; }
+    std::size_t samples_per_point() const noexcept { return header_.samples_per_point; }
+    std::size_t waveform_capacity() const noexcept { return header_.waveform_capacity; }
+    std::size_t spectrum_points() const noexcept { return header_.spectrum_points; }
+    double sample_rate_hz() const noexcept { return header_.sample_rate_hz; }
+
+    /// The publisher has been destroyed (its last data stays readable).
+    bool closed() const noexcept;
+
+    /// The latest (up to) @p points points into @p out; returns how many.
+    std::size_t read_waveform(std::size_t points, WaveformWindow& out) const;
+    bool read_spectrum(SpectrumSnapshot& out) const;
+    bool read_statistics(std::vector<ChannelStatistics>& out) const;
+
+private:
+    dashboard::FileHeader header_{};
+    dashboard::Layout layout_{};
+    const std::byte* base_ = nullptr;
+    std::size_t size_ = 0;
+    const dashboard::Control* control_ = nullptr;
+};
+
+}  // namespace srm
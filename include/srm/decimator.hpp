@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "srm/aligned.hpp"
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+/// Multi-channel CIC decimator on raw ADC counts.
+///
+/// Integrators and combs run in wrapping 64-bit integer arithmetic, so the
+/// filter is exact and free of drift over arbitrarily long runs (bit growth
+/// is order * log2(ratio) + 16 bits). Output is scaled back to counts by
+/// 1 / ratio^order.
+class CicDecimator {
+public:
+    CicDecimator(unsigned ratio, unsigned order, std::size_t channels);
+
+    unsigned ratio() const noexcept { return ratio_; }
+    std::size_t channels() const noexcept { return channels_; }
+
+    /// Outputs at most in.samples() / ratio + 1 samples per channel; @p out
+    /// must have room for that many. Returns the number produced.
+    std::size_t process(ChannelBlock<const std::int16_t> in, ChannelBlock<float> out) noexcept;
+
+    void reset() noexcept;
+
+private:
+    unsigned ratio_;
+    unsigned order_;
+    std::size_t channels_;
+    unsigned phase_ = 0;  // input samples since the last output
+    float gain_;
+    std::vector<std::uint64_t> integrators_;  // channels x order
+    std::vector<std::uint64_t> combs_;        // channels x order
+};
+
+/// Multi-channel decimating FIR. Only every factor-th output is computed,
+/// each as one contiguous dot product against the delay line, so cost per
+/// output is one tap pass. State survives across blocks of any size.
+class FirDecimator {
+public:
+    /// @p max_block bounds the per-call working set; longer inputs are
+    /// processed in pieces.
+    FirDecimator(std::span<const float> taps, unsigned factor, std::size_t channels,
+                 std::size_t max_block);
+
+    unsigned factor() const noexcept { return factor_; }
+
+    /// Outputs at most in.samples() / factor + 1 samples per channel.
+    std::size_t process(ChannelBlock<const float> in, ChannelBlock<float> out) noexcept;
+
+    void reset() noexcept;
+
+private:
+    std::size_t process_piece(ChannelBlock<const float> in, ChannelBlock<float> out,
+                              std::size_t out_offset) noexcept;
+
+    AlignedVector<float> reversed_;
+    unsigned factor_;
+    std::size_t history_;  // taps - 1
+    std::size_t max_block_;
+    ChannelBuffer<float> line_;
+    std::size_t phase_ = 0;  // input samples still to skip before the next output
+};
+
+/// Decimate-by-2 half-band FIR exploiting the zero even-offset taps and the
+/// coefficient symmetry: (taps + 1) / 4 multiplies per output.
+class HalfbandDecimator {
+public:
+    /// @p taps must be a 4k + 3 half-band design (see design_halfband()).
+    HalfbandDecimator(std::span<const float> taps, std::size_t channels, std::size_t max_block);
+
+    /// Outputs at most in.samples() / 2 + 1 samples per channel.
+    std::size_t process(ChannelBlock<const float> in, ChannelBlock<float> out) noexcept;
+
+    void reset() noexcept;
+
+private:
+    std::size_t process_piece(ChannelBlock<const float> in, ChannelBlock<float> out,
+                              std::size_t out_offset) noexcept;
+
+    AlignedVector<float> side_;  // taps at offsets centre-1, centre-3, ...
+    std::size_t history_;
+    std::size_t max_block_;
+    ChannelBuffer<float> line_;
+    std::size_t phase_ = 0;
+};
+
+struct DecimationChainConfig {
+    unsigned cic_ratio = 8;
+    unsigned cic_order = 4;
+    std::size_t compensator_taps = 63;
+    unsigned halfband_stages = 2;
+    std::size_t halfband_taps = 31;
+    std::size_t max_block = 8192;  ///< input samples handled per internal pass
+};
+
+/// Coefficients of a DecimationChain: the compensator, and the half-band
+/// shared by every half-band stage (empty without one).
+struct DecimationTaps {
+    std::vector<float> compensator;
+    std::vector<float> halfband;
+};
+
+/// The constexpr tables for the common ratios, otherwise a design with the
+/// same routines. Throws std::invalid_argument for an unsupported tap count.
+DecimationTaps design_decimation_taps(const DecimationChainConfig& config);
+
+/// CIC front end -> droop-compensating FIR (/2) -> optional half-band
+/// stages (/2 each). Coefficients for the common ratios are the constexpr
+/// tables from filter_design.hpp; other configurations are designed once at
+/// construction with the same routines.
+class DecimationChain {
+public:
+    /// Throws std::invalid_argument for an unsupported configuration.
+    DecimationChain(const DecimationChainConfig& config, std::size_t channels);
+
+    /// With coefficients designed earlier (design_decimation_taps(), or the
+    /// startup plan cache). Also throws std::invalid_argument if their
+    /// lengths do not match @p config.
+    DecimationChain(const DecimationChainConfig& config, std::size_t channels, const DecimationTaps& taps);
+
+    /// Overall decimation factor.
+    unsigned factor() const noexcept { return factor_; }
+    std::size_t channels() const noexcept { return cic_.channels(); }
+
+    /// Output samples per channel that process() may produce for @p input.
+    std::size_t max_output(std::size_t input) const noexcept { return input / factor_ + 1; }
+
+    /// Filters raw counts into @p out (counts, unity DC gain). @p out needs
+    /// room for max_output(in.samples()). Returns samples produced. Throws
+    /// std::invalid_argument unless both blocks have channels() channels.
+    std::size_t process(ChannelBlock<const std::int16_t> in, ChannelBlock<float> out);
+
+    void reset() noexcept;
+
+private:
+    DecimationChainConfig config_;
+    unsigned factor_;
+    CicDecimator cic_;
+    FirDecimator compensator_;
+    std::vector<HalfbandDecimator> halfbands_;
+    std::vector<ChannelBuffer<float>> stage_buffers_;
+};
+
+}  // namespace srm
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include "srm/channel_block.hpp"
+#include "srm/strain_conversion.hpp"
+
+namespace srm {
+
+/// Tile budget: the int16 tile and the float block a conversion of it
+/// writes (twice the size) stay within a 32 KiB L1d, and the frames they
+/// came from within L2.
+inline constexpr std::size_t kDefaultTileBytes = 8 * 1024;
+
+/// Samples per channel of a tile of @p channels that keeps within
+/// @p tile_bytes: whole cache lines per channel (a multiple of 32 int16),
+/// never less than one line.
+std::size_t tile_samples(std::size_t channels, std::size_t tile_bytes = kDefaultTileBytes) noexcept;
+
+/// Transposes interleaved DAQ frames (ch0, ch1, ... ch(N-1) of sample 0,
+/// then of sample 1, ...) into the structure-of-arrays block @p out, where
+/// N = out.channels() and frames.size() == N * out.samples().
+///
+/// 4 channels and any multiple of 8 (8, 16, 24, ...) run register
+/// transposes of unpack shuffles, 16 samples per channel per step with
+/// AVX2 and 8 with NEON; other channel counts and the tails take the
+/// scalar loop. Throws std::invalid_argument on a size mismatch.
+void deinterleave(std::span<const std::int16_t> frames, ChannelBlock<std::int16_t> out);
+
+/// Same with an explicit path; falls back to Scalar if @p path is not
+/// supported. Avx512 runs the AVX2 shuffles. Intended for verification and
+/// benchmarks.
+void deinterleave(SimdPath path, std::span<const std::int16_t> frames, ChannelBlock<std::int16_t> out);
+
+/// De-interleaves a stream of frames a cache-sized tile at a time, so the
+/// per-channel stages that follow (conversion, filtering, statistics) read
+/// contiguous, 64-byte-aligned channels that are still in L1 rather than
+/// striding through the frames or a whole transposed block.
+///
+/// process() hands each tile to the sink as
+/// sink(ChannelBlock<const std::int16_t>, std::uint64_t first_sample), the
+/// contract of TriggeredCapture, so the two chain. A tile is only valid
+/// during the call; the last one of a call may be short.
+class TileDeinterleaver {
+public:
+    /// @p tile_samples of 0 picks tile_samples(channels). Throws
+    /// std::invalid_argument for zero channels.
+    explicit TileDeinterleaver(std::size_t channels, std::size_t tile_samples = 0);
+
+    std::size_t channels() const noexcept { return tile_.channels(); }
+    std::size_t tile_samples() const noexcept { return tile_.samples(); }
+
+    /// Splits @p frames into tiles; @p first_sample is the acquisition index
+    /// of the first frame. Returns the number of frames consumed. Throws
+    /// std::invalid_argument if frames.size() is not a multiple of channels().
+    template <typename Sink>
+    std::size_t process(std::span<const std::int16_t> frames, std::uint64_t first_sample, Sink&& sink);
+
+private:
+    ChannelBuffer<std::int16_t> tile_;
+};
+
+template <typename Sink>
+std::size_t TileDeinterleaver::process(std::span<const std::int16_t> frames, std::uint64_t first_sample,
+                                       Sink&& sink) {
+    const std::size_t n = channels();
+    if (frames.size() % n != 0) {
+        throw std::invalid_argument("deinterleave: partial frame");
+    }
+    const std::size_t total = frames.size() / n;
+    for (std::size_t pos = 0; pos < total;) {
+        const std::size_t count = std::min(tile_.samples(), total - pos);
+        const ChannelBlock<std::int16_t> tile = tile_.view().subblock(0, count);
+        deinterleave(frames.subspan(pos * n, count * n), tile);
+        sink(ChannelBlock<const std::int16_t>(tile), first_sample + pos);
+        pos += count;
+    }
+    return total;
+}
+
+}  // namespace srm
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+/// Lossless coder for slowly varying int16 ADC streams.
+///
+/// Each sample is replaced by its difference to the previous one (the
+/// first by its difference to 0), zig-zag mapped to an unsigned value u and
+/// Rice coded: u >> k in unary (zeros terminated by a one), then the k low
+/// bits. k is chosen per block of kDeltaRiceBlock samples from the block's
+/// mean and stored in front of it as a 5-bit field. A quotient of
+/// kDeltaRiceEscape or more is written as kDeltaRiceEscape zeros, the
+/// terminating one and u in 17 plain bits, so a step between the int16
+/// extremes costs 42 bits instead of blowing up. Bits are packed LSB first.
+///
+/// Strain at the rig's rates moves a few counts per sample, which codes to
+/// roughly 4-6 bits per sample.
+inline constexpr std::size_t kDeltaRiceBlock = 64;
+inline constexpr unsigned kDeltaRiceEscape = 24;
+
+/// Upper bound of the coded size of @p samples samples.
+constexpr std::size_t delta_rice_max_bytes(std::size_t samples) noexcept {
+    const std::size_t blocks = (samples + kDeltaRiceBlock - 1) / kDeltaRiceBlock;
+    return (samples * (kDeltaRiceEscape + 1 + 17) + blocks * 5 + 7) / 8 + 8;
+}
+
+/// Codes @p in into @p out and returns the byte count, or 0 if @p out is
+/// too small (callers then store the data raw).
+std::size_t encode_delta_rice(std::span<const std::int16_t> in, std::span<std::byte> out) noexcept;
+
+/// Decodes exactly out.size() samples. Returns false if @p in is truncated
+/// or malformed.
+bool decode_delta_rice(std::span<const std::byte> in, std::span<std::int16_t> out) noexcept;
+
+/// Chunk payload of ChunkEncoding::DeltaRice: a uint32 byte count per
+/// channel, then every channel's stream. Returns the payload size, or 0 if
+/// it would not fit in @p out.
+std::size_t encode_delta_rice_chunk(ChannelBlock<const std::int16_t> block,
+                                    std::span<std::byte> out) noexcept;
+
+/// Decodes channel @p channel of a DeltaRice chunk payload into @p out
+/// (sample_count elements). Returns false on a malformed payload.
+bool decode_delta_rice_chunk(std::span<const std::byte> payload, std::size_t channels,
+                             std::size_t channel, std::span<std::int16_t> out) noexcept;
+
+}  // namespace srm
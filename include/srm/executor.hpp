@@ -0,0 +1,341 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "srm/thread_pool.hpp"
+
+namespace srm {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> self) const noexcept {
+            return self.promise().continuation;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& v) {
+        value.emplace(std::forward<U>(v));
+    }
+    T result() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+    void result() const {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+}  // namespace detail
+
+/// Lazily started coroutine returning T. Nothing runs until the task is
+/// co_awaited (or handed to Executor::run()); the awaiting coroutine is
+/// resumed by symmetric transfer when it finishes, so chains of awaits
+/// neither grow the stack nor go through the executor's queue. Exceptions
+/// propagate to the awaiter. Move-only; destroying it destroys the frame.
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task() noexcept = default;
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ~Task() { reset(); }
+
+    bool valid() const noexcept { return static_cast<bool>(handle_); }
+    bool done() const noexcept { return !handle_ || handle_.done(); }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) const noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() const { return handle.promise().result(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    friend struct detail::TaskPromise<T>;
+    friend class Executor;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+    void reset() noexcept {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = {};
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+template <typename R>
+using JobValue = std::conditional_t<std::is_void_v<R>, std::monostate, R>;
+
+/// Shared between a pool task and the coroutine awaiting its result.
+template <typename R>
+struct JobState {
+    std::mutex mutex;
+    bool done = false;
+    std::optional<JobValue<R>> value;
+    std::exception_ptr error;
+    std::coroutine_handle<> waiter;
+};
+
+}  // namespace detail
+
+template <typename R>
+class PoolJob;
+
+/// Single-threaded event loop for instrument control. Coroutines run on
+/// the thread that calls run(); they suspend on timers (sleep_for),
+/// descriptor readiness (readable/writable, for serial, socket and SCPI
+/// links) and work offloaded to a WorkStealingPool, and are resumed from
+/// the loop in deadline order. A blocked loop sleeps in poll(2) on its
+/// descriptors plus an eventfd that pool threads signal on completion, so
+/// waiting costs no thread and no polling.
+///
+/// Not thread-safe: use it from the loop thread only. Linux only.
+class Executor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Executor();
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    /// Runs @p task and everything it awaits until it completes; returns
+    /// its value or rethrows its exception. Throws std::logic_error when
+    /// called re-entrantly, or when the task is suspended with nothing
+    /// left that could resume it.
+    template <typename T>
+    T run(Task<T> task) {
+        drive(task.handle_);
+        return task.handle_.promise().result();
+    }
+
+    struct SleepAwaiter {
+        Executor& executor;
+        Clock::time_point deadline;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { executor.add_timer(deadline, handle); }
+        void await_resume() const noexcept {}
+    };
+    SleepAwaiter sleep_until(Clock::time_point deadline) noexcept { return {*this, deadline}; }
+    SleepAwaiter sleep_for(Clock::duration duration) noexcept { return {*this, Clock::now() + duration}; }
+    /// Requeues the caller behind everything already runnable.
+    SleepAwaiter yield() noexcept { return {*this, Clock::time_point::min()}; }
+
+    struct IoAwaiter {
+        Executor& executor;
+        int fd;
+        short events;
+        Clock::time_point deadline;
+        bool ready = false;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { executor.add_io(*this, handle); }
+        bool await_resume() const noexcept { return ready; }
+    };
+    /// Resumes once @p fd is readable (true) or at @p deadline (false).
+    IoAwaiter readable(int fd, Clock::time_point deadline = Clock::time_point::max()) noexcept;
+    IoAwaiter writable(int fd, Clock::time_point deadline = Clock::time_point::max()) noexcept;
+
+    /// Starts @p fn on @p pool now and returns a handle whose co_await
+    /// yields its result (or rethrows) on the loop thread. The work runs
+    /// while the caller goes on awaiting instruments, which is what lets
+    /// analysis overlap acquisition.
+    template <typename Fn>
+    PoolJob<std::invoke_result_t<Fn&>> offload(WorkStealingPool& pool, Fn fn);
+
+    /// Coroutine resumptions since construction.
+    std::uint64_t resumptions() const noexcept { return resumptions_; }
+
+private:
+    template <typename R>
+    friend class PoolJob;
+
+    struct Timer {
+        Clock::time_point deadline;
+        std::uint64_t sequence;  // FIFO among equal deadlines
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& other) const noexcept {
+            return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    /// Resumes @p handle on the loop thread; called from pool threads.
+    void post(std::coroutine_handle<> handle);
+    void drive(std::coroutine_handle<> root);
+    void add_timer(Clock::time_point deadline, std::coroutine_handle<> handle);
+    void add_io(IoAwaiter& awaiter, std::coroutine_handle<> handle);
+    /// Moves posted handles, expired timers and ready descriptors onto the
+    /// run queue, sleeping in ppoll() until the first of them.
+    void gather();
+
+    std::deque<std::coroutine_handle<>> ready_;
+    std::vector<Timer> timers_;  // min-heap
+    std::uint64_t timer_sequence_ = 0;
+    struct IoWait {
+        IoAwaiter* awaiter;
+        std::coroutine_handle<> handle;
+    };
+    std::vector<IoWait> io_;
+    std::size_t remote_waits_ = 0;  // coroutines suspended on pool jobs
+
+    std::mutex remote_mutex_;
+    std::vector<std::coroutine_handle<>> remote_;
+    int wake_fd_ = -1;
+
+    bool running_ = false;
+    std::uint64_t resumptions_ = 0;
+};
+
+/// Result of Executor::offload(). co_await it once, from the loop thread;
+/// every job must have been awaited before its executor is destroyed.
+template <typename R>
+class [[nodiscard]] PoolJob {
+public:
+    PoolJob() noexcept = default;
+
+    bool valid() const noexcept { return static_cast<bool>(state_); }
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            Executor& executor;
+            detail::JobState<R>& state;
+            bool await_ready() const {
+                std::lock_guard lock(state.mutex);
+                return state.done;
+            }
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard lock(state.mutex);
+                if (state.done) {
+                    return false;
+                }
+                state.waiter = handle;
+                ++executor.remote_waits_;
+                return true;
+            }
+            R await_resume() {
+                if (state.error) {
+                    std::rethrow_exception(state.error);
+                }
+                if constexpr (!std::is_void_v<R>) {
+                    return std::move(*state.value);
+                }
+            }
+        };
+        return Awaiter{*executor_, *state_};
+    }
+
+private:
+    friend class Executor;
+
+    PoolJob(Executor& executor, std::shared_ptr<detail::JobState<R>> state) noexcept
+        : executor_(&executor), state_(std::move(state)) {}
+
+    Executor* executor_ = nullptr;
+    std::shared_ptr<detail::JobState<R>> state_;
+};
+
+template <typename Fn>
+PoolJob<std::invoke_result_t<Fn&>> Executor::offload(WorkStealingPool& pool, Fn fn) {
+    using R = std::invoke_result_t<Fn&>;
+    auto state = std::make_shared<detail::JobState<R>>();
+    pool.submit([this, state, fn = std::move(fn)]() mutable {
+        std::optional<detail::JobValue<R>> value;
+        std::exception_ptr error;
+        try {
+            if constexpr (std::is_void_v<R>) {
+                fn();
+                value.emplace();
+            } else {
+                value.emplace(fn());
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard lock(state->mutex);
+            state->value = std::move(value);
+            state->error = error;
+            state->done = true;
+            waiter = std::exchange(state->waiter, {});
+        }
+        if (waiter) {
+            post(waiter);
+        }
+    });
+    return PoolJob<R>(*this, std::move(state));
+}
+
+}  // namespace srm
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+
+#include "srm/aligned.hpp"
+
+namespace srm {
+
+/// Precomputed real-input FFT of a fixed power-of-two size.
+///
+/// A size-N real transform is computed as an N/2-point complex radix-2 FFT
+/// followed by a split step. All tables (bit reversal, per-stage twiddles,
+/// split twiddles) are built once in the constructor; forward() only reads
+/// them, so one plan can be shared by any number of threads as long as each
+/// brings its own scratch buffer.
+class FftPlan {
+public:
+    /// Throws std::invalid_argument unless @p size is a power of two >= 4.
+    explicit FftPlan(std::size_t size);
+
+    /// Restores a plan from the tables of one built earlier (the startup
+    /// plan cache). Throws std::invalid_argument if a table does not have
+    /// the length @p size implies or the bit reversal is not a permutation.
+    FftPlan(std::size_t size, std::span<const std::uint32_t> bit_reversal,
+            std::span<const std::complex<float>> stage_twiddles,
+            std::span<const std::complex<float>> split_twiddles);
+
+    std::size_t size() const noexcept { return size_; }
+    std::size_t bins() const noexcept { return size_ / 2 + 1; }
+    /// Complex elements of scratch space forward() needs.
+    std::size_t scratch_size() const noexcept { return size_ / 2; }
+
+    /// Transforms size() real samples into bins() complex bins (unnormalised).
+    void forward(const float* in, std::complex<float>* out,
+                 std::complex<float>* scratch) const noexcept;
+
+    std::span<const std::uint32_t> bit_reversal() const noexcept { return bitrev_; }
+    std::span<const std::complex<float>> stage_twiddles() const noexcept { return stage_twiddles_; }
+    std::span<const std::complex<float>> split_twiddles() const noexcept { return split_twiddles_; }
+
+private:
+    std::size_t size_;
+    AlignedVector<std::uint32_t> bitrev_;
+    AlignedVector<std::complex<float>> stage_twiddles_;
+    AlignedVector<std::complex<float>> split_twiddles_;
+};
+
+enum class WindowType {
+    Rectangular,
+    Hann,
+    Hamming,
+    BlackmanHarris,
+    FlatTop,
+};
+
+const char* to_string(WindowType window) noexcept;
+
+/// Periodic (DFT-even) window of @p size points.
+AlignedVector<float> make_window(WindowType window, std::size_t size);
+
+/// Process-wide cache of FFT plans and windows, built on first request for a
+/// size and shared afterwards. Lookups lock a mutex and are meant for stage
+/// setup, not for the per-frame path.
+class PlanCache {
+public:
+    static PlanCache& instance();
+
+    std::shared_ptr<const FftPlan> fft(std::size_t size);
+    std::shared_ptr<const AlignedVector<float>> window(WindowType window, std::size_t size);
+
+    /// Seeds the cache with a plan or window built elsewhere (restored from
+    /// the startup plan cache, say); an entry already present is kept.
+    void insert(std::shared_ptr<const FftPlan> plan);
+    void insert(WindowType window, std::shared_ptr<const AlignedVector<float>> values);
+
+    /// Drops every cached entry; plans still held by stages stay alive.
+    void clear();
+
+private:
+    PlanCache() = default;
+
+    std::mutex mutex_;
+    std::map<std::size_t, std::shared_ptr<const FftPlan>> plans_;
+    std::map<std::pair<WindowType, std::size_t>, std::shared_ptr<const AlignedVector<float>>>
+        windows_;
+};
+
+}  // namespace srm
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+/// Reduced basis of the full-yoke field: a few mode shapes, each one value
+/// per field output (strain at a mesh node, radial displacement, ...; any
+/// quantity the FE model exports per output). The live field is taken to
+/// be a combination of these shapes.
+class ModalBasis {
+public:
+    /// @p shapes holds @p modes rows of outputs() values each, as exported
+    /// by an FE modal analysis. Throws std::invalid_argument if its size is
+    /// not a multiple of @p outputs or a shape is all zero.
+    ModalBasis(std::size_t outputs, std::vector<double> shapes);
+
+    /// Proper orthogonal decomposition of FE load-case results (one
+    /// snapshot of outputs() values per row): the leading orthonormal modes
+    /// that together hold @p energy of the snapshots' energy, at most
+    /// @p max_modes of them. Throws std::invalid_argument for an empty or
+    /// ragged snapshot set.
+    static ModalBasis from_snapshots(std::span<const double> snapshots, std::size_t outputs,
+                                     std::size_t max_modes, double energy = 0.9999);
+
+    /// Circumferential bending modes of a thin ring, cos(n theta) and
+    /// sin(n theta) for n = 0..max_order over @p points equally spaced
+    /// outputs: the yoke's dominant shapes, for layout studies before an FE
+    /// model exists.
+    static ModalBasis thin_ring(std::size_t points, std::size_t max_order);
+
+    std::size_t outputs() const noexcept { return outputs_; }
+    std::size_t modes() const noexcept { return outputs_ == 0 ? 0 : shapes_.size() / outputs_; }
+    std::span<const double> mode(std::size_t k) const noexcept {
+        return std::span(shapes_).subspan(k * outputs_, outputs_);
+    }
+    /// Fraction of the snapshot energy up to and including each mode
+    /// (from_snapshots() only; empty otherwise).
+    std::span<const double> cumulative_energy() const noexcept { return cumulative_energy_; }
+
+private:
+    std::size_t outputs_ = 0;
+    std::vector<double> shapes_;  // modes x outputs
+    std::vector<double> cumulative_energy_;
+};
+
+/// A gauge reads a weighted sum of field outputs: the grid's average over
+/// the nodes it covers, resolved along its axis.
+struct GaugeTerm {
+    std::size_t output = 0;
+    double weight = 1.0;
+};
+
+struct GaugePlacement {
+    std::string name;
+    std::vector<GaugeTerm> terms;
+};
+
+struct ReconstructionOptions {
+    /// Tikhonov weight on the modal coordinates, as a fraction of the
+    /// largest diagonal entry of the normal matrix. Lets a layout with
+    /// fewer gauges than modes (or nearly collinear ones) give the
+    /// minimum-energy field instead of failing.
+    double regularisation = 0.0;
+};
+
+/// Maps live gauge readings to the full field for one sensor layout.
+///
+/// Construction does all the linear algebra, once per layout: with A the
+/// gauges x modes matrix of each gauge's reading of each mode, it takes the
+/// Householder QR factorisation of A (stacked on sqrt(lambda) I when
+/// regularised), solves for the least-squares modal coordinates of every
+/// unit gauge reading and folds the result into one outputs x gauges float
+/// matrix. At run time a block of gauge samples is then one small dense
+/// product, field = R * gauges, batched over samples; built with
+/// SRM_ENABLE_BLAS it goes to cblas_sgemm, otherwise to a blocked kernel
+/// that keeps a slice of the gauge samples in L1 across every output.
+class FieldReconstructor {
+public:
+    /// Throws std::invalid_argument for an empty layout, a term outside the
+    /// basis or fewer gauges than modes without regularisation, and
+    /// std::runtime_error if the gauges cannot tell some mode apart from
+    /// the others (rank deficient).
+    FieldReconstructor(const ModalBasis& basis, std::span<const GaugePlacement> gauges,
+                       const ReconstructionOptions& options = {});
+
+    std::size_t gauges() const noexcept { return gauges_; }
+    std::size_t outputs() const noexcept { return outputs_; }
+    std::size_t modes() const noexcept { return modes_; }
+
+    /// Ratio of the largest to the smallest diagonal entry of the QR
+    /// factor: a cheap lower bound on the layout's condition number, to
+    /// compare candidate gauge positions by.
+    double condition_estimate() const noexcept { return condition_; }
+
+    /// The outputs x gauges reconstruction matrix, row-major.
+    std::span<const float> matrix() const noexcept { return matrix_; }
+
+    /// Writes the field of every sample of @p gauges (one channel per gauge,
+    /// in microstrain) to @p field (one channel per output, at least as many
+    /// samples). Safe to call from several threads. Throws
+    /// std::invalid_argument on a shape mismatch.
+    void reconstruct(ChannelBlock<const float> gauges, ChannelBlock<float> field) const;
+
+    /// True when reconstruct() runs on cblas_sgemm.
+    static bool uses_blas() noexcept;
+
+private:
+    std::size_t gauges_ = 0;
+    std::size_t outputs_ = 0;
+    std::size_t modes_ = 0;
+    double condition_ = 0.0;
+    std::vector<float> matrix_;  // outputs x gauges
+};
+
+}  // namespace srm
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+/// constexpr FIR and biquad design for the decimation chain and notches.
+///
+/// Everything here is usable both at compile time, to bake the coefficient
+/// tables for the decimation ratios the rig actually uses, and at run time
+/// for anything else. <cmath> is not constexpr before C++26, hence the small
+/// series implementations in srm::cmath.
+namespace srm {
+
+/// Longest filter the design routines accept.
+inline constexpr std::size_t kMaxDesignTaps = 1024;
+
+namespace cmath {
+
+inline constexpr double kPi = 3.14159265358979323846;
+
+/// Reduces @p x to [-pi, pi].
+constexpr double reduce_angle(double x) {
+    const double two_pi = 2.0 * kPi;
+    const double k = static_cast<double>(static_cast<long long>(x / two_pi + (x >= 0 ? 0.5 : -0.5)));
+    return x - k * two_pi;
+}
+
+constexpr double sin(double x) {
+    x = reduce_angle(x);
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 40 && term != 0.0; ++n) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cos(double x) { return sin(reduce_angle(x) + kPi / 2.0); }
+
+constexpr double sqrt(double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 100; ++i) {
+        const double next = 0.5 * (r + x / r);
+        if (next == r) {
+            break;
+        }
+        r = next;
+    }
+    return r;
+}
+
+constexpr double abs(double x) { return x < 0 ? -x : x; }
+
+/// Modified Bessel function of the first kind, order zero (Kaiser window).
+constexpr double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 200; ++k) {
+        const double q = x / (2.0 * k);
+        term *= q * q;
+        sum += term;
+        if (term < sum * 1e-17) {
+            break;
+        }
+    }
+    return sum;
+}
+
+}  // namespace cmath
+
+/// Kaiser window value for tap @p n of @p taps.
+constexpr double kaiser(std::size_t n, std::size_t taps, double beta) {
+    if (taps == 1) {
+        return 1.0;
+    }
+    const double r = 2.0 * static_cast<double>(n) / static_cast<double>(taps - 1) - 1.0;
+    return cmath::bessel_i0(beta * cmath::sqrt(1.0 - r * r)) / cmath::bessel_i0(beta);
+}
+
+/// Magnitude of an @p order stage CIC decimating by @p ratio (differential
+/// delay 1), normalised to unity at DC, at frequency @p f in cycles per
+/// output sample.
+constexpr double cic_response(double f, unsigned ratio, unsigned order) {
+    if (f == 0.0) {
+        return 1.0;
+    }
+    const double num = cmath::sin(cmath::kPi * f);
+    const double den = static_cast<double>(ratio) * cmath::sin(cmath::kPi * f / ratio);
+    double h = 1.0;
+    for (unsigned i = 0; i < order; ++i) {
+        h *= num / den;
+    }
+    return cmath::abs(h);
+}
+
+/// Windowed-sinc lowpass, @p cutoff in cycles per sample, unity DC gain.
+/// An odd tap count with cutoff 0.25 gives a half-band filter whose
+/// even-offset taps (other than the centre) are exactly zero.
+constexpr void design_lowpass(float* out, std::size_t taps, double cutoff, double beta) {
+    const double centre = static_cast<double>(taps - 1) / 2.0;
+    double h[kMaxDesignTaps] = {};
+    double sum = 0.0;
+    for (std::size_t n = 0; n < taps; ++n) {
+        const double t = static_cast<double>(n) - centre;
+        const double x = 2.0 * cmath::kPi * cutoff * t;
+        const double sinc = t == 0.0 ? 2.0 * cutoff : cmath::sin(x) / (cmath::kPi * t);
+        h[n] = sinc * kaiser(n, taps, beta);
+        sum += h[n];
+    }
+    for (std::size_t n = 0; n < taps; ++n) {
+        out[n] = static_cast<float>(h[n] / sum);
+    }
+}
+
+/// Second-order section, a0 normalised to 1:
+///   y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+struct BiquadCoefficients {
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+};
+
+/// Notch at @p frequency (cycles per sample) with quality factor @p q,
+/// i.e. a -3 dB width of frequency / q (RBJ cookbook). Unity gain at DC
+/// and Nyquist.
+constexpr BiquadCoefficients design_notch(double frequency, double q) {
+    const double w0 = 2.0 * cmath::kPi * frequency;
+    const double cos_w0 = cmath::cos(w0);
+    const double alpha = cmath::sin(w0) / (2.0 * q);
+    const double a0 = 1.0 + alpha;
+    BiquadCoefficients c;
+    c.b0 = static_cast<float>(1.0 / a0);
+    c.b1 = static_cast<float>(-2.0 * cos_w0 / a0);
+    c.b2 = c.b0;
+    c.a1 = c.b1;
+    c.a2 = static_cast<float>((1.0 - alpha) / a0);
+    return c;
+}
+
+/// Half-band lowpass for a decimate-by-2 stage. @p taps must be 4k + 3 so
+/// that the outermost taps are non-zero.
+constexpr void design_halfband(float* out, std::size_t taps, double beta = 6.0) {
+    design_lowpass(out, taps, 0.25, beta);
+    const std::size_t centre = (taps - 1) / 2;
+    for (std::size_t n = 0; n < taps; ++n) {
+        const std::size_t offset = n > centre ? n - centre : centre - n;
+        if (offset != 0 && offset % 2 == 0) {
+            out[n] = 0.0f;
+        }
+    }
+    // Rescale the odd-offset taps to sum to exactly 0.5 so that
+    // H(f) + H(0.5 - f) == 1 holds for the stored coefficients.
+    double side = 0.0;
+    for (std::size_t n = 0; n < taps; ++n) {
+        if (n != centre) {
+            side += out[n];
+        }
+    }
+    for (std::size_t n = 0; n < taps; ++n) {
+        if (n != centre) {
+            out[n] = static_cast<float>(out[n] * (0.5 / side));
+        }
+    }
+    out[centre] = 0.5f;
+}
+
+/// Linear-phase FIR that follows a CIC (at the CIC output rate) and
+/// decimates by two: inverse-CIC droop correction up to 0.1 cycles/sample,
+/// a linear taper to zero at the new Nyquist frequency 0.25, and a Kaiser
+/// window. Designed by integrating the target response on a dense grid.
+constexpr void design_cic_compensator(float* out, std::size_t taps, unsigned ratio,
+                                      unsigned order, double beta = 5.0) {
+    constexpr std::size_t kGrid = 512;
+    constexpr double kPassband = 0.1;
+    constexpr double kStopband = 0.25;
+    const double centre = static_cast<double>(taps - 1) / 2.0;
+    double h[kMaxDesignTaps] = {};
+    for (std::size_t g = 0; g < kGrid; ++g) {
+        const double f = (static_cast<double>(g) + 0.5) * kStopband / kGrid;
+        double target = 1.0 / cic_response(f < kPassband ? f : kPassband, ratio, order);
+        if (f > kPassband) {
+            target *= (kStopband - f) / (kStopband - kPassband);
+        }
+        // h[n] = 2 * integral(A(f) cos(2 pi f (n - c)) df), evaluated for all
+        // taps with one rotation recurrence per grid point.
+        const double w = 2.0 * cmath::kPi * f;
+        const double step_c = cmath::cos(w);
+        const double step_s = cmath::sin(w);
+        double c = cmath::cos(-w * centre);
+        double s = cmath::sin(-w * centre);
+        const double weight = 2.0 * target * kStopband / kGrid;
+        for (std::size_t n = 0; n < taps; ++n) {
+            h[n] += weight * c;
+            const double nc = c * step_c - s * step_s;
+            s = s * step_c + c * step_s;
+            c = nc;
+        }
+    }
+    double sum = 0.0;
+    for (std::size_t n = 0; n < taps; ++n) {
+        h[n] *= kaiser(n, taps, beta);
+        sum += h[n];
+    }
+    for (std::size_t n = 0; n < taps; ++n) {
+        out[n] = static_cast<float>(h[n] / sum);
+    }
+}
+
+template <std::size_t Taps>
+constexpr std::array<float, Taps> make_halfband() {
+    static_assert(Taps % 4 == 3 && Taps <= kMaxDesignTaps, "half-band length must be 4k + 3");
+    std::array<float, Taps> h{};
+    design_halfband(h.data(), Taps);
+    return h;
+}
+
+template <std::size_t Taps>
+constexpr std::array<float, Taps> make_cic_compensator(unsigned ratio, unsigned order) {
+    static_assert(Taps % 2 == 1 && Taps <= kMaxDesignTaps, "compensator must be odd length");
+    std::array<float, Taps> h{};
+    design_cic_compensator(h.data(), Taps, ratio, order);
+    return h;
+}
+
+/// Tap counts of the precomputed tables.
+inline constexpr std::size_t kCompensatorTaps = 63;
+inline constexpr std::size_t kHalfbandTaps = 31;
+inline constexpr unsigned kCicOrder = 4;
+
+/// Baked coefficient tables for the CIC ratios the rig runs at.
+inline constexpr std::array<float, kHalfbandTaps> kHalfband31 = make_halfband<kHalfbandTaps>();
+inline constexpr std::array<float, kCompensatorTaps> kCicComp4 =
+    make_cic_compensator<kCompensatorTaps>(4, kCicOrder);
+inline constexpr std::array<float, kCompensatorTaps> kCicComp8 =
+    make_cic_compensator<kCompensatorTaps>(8, kCicOrder);
+inline constexpr std::array<float, kCompensatorTaps> kCicComp16 =
+    make_cic_compensator<kCompensatorTaps>(16, kCicOrder);
+inline constexpr std::array<float, kCompensatorTaps> kCicComp32 =
+    make_cic_compensator<kCompensatorTaps>(32, kCicOrder);
+
+/// Precomputed compensator for (ratio, order, taps), or an empty span.
+constexpr std::span<const float> precomputed_cic_compensator(unsigned ratio, unsigned order,
+                                                              std::size_t taps) {
+    if (order != kCicOrder || taps != kCompensatorTaps) {
+        return {};
+    }
+    switch (ratio) {
+    case 4:
+        return kCicComp4;
+    case 8:
+        return kCicComp8;
+    case 16:
+        return kCicComp16;
+    case 32:
+        return kCicComp32;
+    default:
+        return {};
+    }
+}
+
+}  // namespace srm
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "srm/common.hpp"
+#include "srm/latency_histogram.hpp"
+
+// SRM_INSTRUMENTATION is set by the SRM_ENABLE_INSTRUMENTATION CMake option.
+// With it off the SRM_* macros below expand to nothing; the registry still
+// exists so exporters keep compiling and report an empty snapshot.
+#ifndef SRM_INSTRUMENTATION
+#define SRM_INSTRUMENTATION 0
+#endif
+
+namespace srm {
+
+inline constexpr bool kInstrumentationEnabled = SRM_INSTRUMENTATION != 0;
+
+/// Raw cycle counter: RDTSC on x86 (invariant TSC assumed), CNTVCT on
+/// AArch64, steady_clock elsewhere. Only differences are meaningful.
+inline std::uint64_t tsc_now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/// Nanoseconds per tsc_now() tick, calibrated against steady_clock on first
+/// call (about 10 ms), then cached.
+double tsc_ns_per_tick() noexcept;
+
+using StageId = std::uint16_t;
+using CounterId = std::uint16_t;
+
+enum class CounterKind : std::uint8_t {
+    Sum,        ///< events: drops, allocations, bytes
+    HighWater,  ///< maximum observed value: ring fill levels
+};
+
+struct StageStats {
+    std::string name;
+    std::uint64_t count = 0;
+    double mean_ns = 0.0;
+    std::uint64_t p50_ns = 0;
+    std::uint64_t p99_ns = 0;
+    std::uint64_t p999_ns = 0;
+    std::uint64_t max_ns = 0;
+};
+
+struct CounterStats {
+    std::string name;
+    CounterKind kind = CounterKind::Sum;
+    std::uint64_t value = 0;
+};
+
+/// Where a thread, buffer or interrupt was placed (thread_placement.hpp).
+struct PlacementStats {
+    std::string name;       ///< "acquisition", "irq 42", ...
+    std::string cpus;       ///< cpu list, "4-7,12"
+    int node = -1;          ///< NUMA node; -1 when the cpus span nodes
+    bool applied = false;   ///< the kernel accepted it
+    std::string detail;     ///< why not, when it was not
+};
+
+struct InstrumentationSnapshot {
+    bool enabled = kInstrumentationEnabled;
+    std::vector<StageStats> stages;
+    std::vector<CounterStats> counters;
+    std::vector<PlacementStats> placements;
+};
+
+/// JSON object {"enabled":..,"stages":[..],"counters":[..],
+/// "placements":[..]} as consumed by the dashboard and embedded in the
+/// benchmark report.
+std::string to_json(const InstrumentationSnapshot& snapshot);
+
+/// Process-wide registry of timed stages and counters.
+///
+/// Stage timings go to per-thread histograms, so recording never contends
+/// between threads; snapshot() merges them on demand. Counters are single
+/// cache-line-padded relaxed atomics shared by all threads. Registration
+/// takes a lock and happens once per call site (the macros cache the id in
+/// a function-local static); everything on the recording path is lock-free
+/// and, after prepare_thread(), allocation-free. Histograms of threads that
+/// have exited are kept, so nothing recorded is lost.
+class Instrumentation {
+public:
+    static constexpr std::size_t kMaxStages = 64;
+    static constexpr std::size_t kMaxCounters = 64;
+
+    static Instrumentation& instance();
+
+    /// Returns the id of @p name, registering it on first use.
+    /// Throws std::length_error once kMaxStages / kMaxCounters are in use.
+    StageId stage(const char* name);
+    CounterId counter(const char* name, CounterKind kind);
+
+    void record(StageId stage, std::uint64_t ticks) noexcept {
+        histogram(stage).record(static_cast<std::uint64_t>(static_cast<double>(ticks) * ns_per_tick_));
+    }
+    void add(CounterId counter, std::uint64_t n = 1) noexcept {
+        counters_[counter].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    void high_water(CounterId counter, std::uint64_t value) noexcept {
+        std::atomic<std::uint64_t>& v = counters_[counter].value;
+        std::uint64_t seen = v.load(std::memory_order_relaxed);
+        while (value > seen && !v.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    /// Allocates the calling thread's histograms for every stage registered
+    /// so far. Real-time threads call this before entering their loop.
+    void prepare_thread();
+
+    /// Records (or replaces, by name) where something was placed. Placements
+    /// describe the configuration rather than the run, so they are reported
+    /// with instrumentation compiled out too and survive reset().
+    void record_placement(PlacementStats placement);
+
+    InstrumentationSnapshot snapshot() const;
+
+    /// Zeroes every histogram and counter (between benchmark cases).
+    void reset() noexcept;
+
+private:
+    struct ThreadStats {
+        std::array<std::atomic<LatencyHistogram*>, kMaxStages> stages{};
+        ~ThreadStats();
+    };
+    struct alignas(kCacheLineSize) CounterSlot {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    Instrumentation();
+
+    LatencyHistogram& histogram(StageId stage) noexcept {
+        thread_local ThreadStats* local = nullptr;
+        if (local == nullptr) [[unlikely]] {
+            local = attach_thread();
+        }
+        LatencyHistogram* h = local->stages[stage].load(std::memory_order_relaxed);
+        if (h == nullptr) [[unlikely]] {
+            h = create_histogram(*local, stage);
+        }
+        return *h;
+    }
+    ThreadStats* attach_thread();
+    static LatencyHistogram* create_histogram(ThreadStats& stats, StageId stage);
+
+    mutable std::mutex mutex_;
+    double ns_per_tick_;
+    std::vector<std::string> stage_names_;
+    std::vector<std::string> counter_names_;
+    std::vector<CounterKind> counter_kinds_;
+    std::vector<PlacementStats> placements_;
+    std::vector<std::unique_ptr<ThreadStats>> threads_;
+    std::array<CounterSlot, kMaxCounters> counters_;
+};
+
+/// Times the enclosing scope into a stage histogram.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(StageId stage) noexcept : stage_(stage), start_(tsc_now()) {}
+    ~ScopedTimer() { Instrumentation::instance().record(stage_, tsc_now() - start_); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    StageId stage_;
+    std::uint64_t start_;
+};
+
+/// Pass-through memory resource that counts upstream allocations and bytes,
+/// e.g. wrapped around a RunArena's upstream to prove the steady state
+/// allocates nothing.
+class CountingMemoryResource final : public std::pmr::memory_resource {
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                                    const char* name = "allocations");
+
+    std::uint64_t allocations() const noexcept { return allocations_.load(std::memory_order_relaxed); }
+    std::uint64_t bytes() const noexcept { return bytes_.load(std::memory_order_relaxed); }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<std::uint64_t> allocations_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+    CounterId allocations_id_;
+    CounterId bytes_id_;
+};
+
+}  // namespace srm
+
+#define SRM_INSTR_CONCAT2(a, b) a##b
+#define SRM_INSTR_CONCAT(a, b) SRM_INSTR_CONCAT2(a, b)
+
+#if SRM_INSTRUMENTATION
+/// Times the rest of the enclosing scope as stage @p name (a string literal).
+#define SRM_SCOPED_TIMER(name)                                                          \
+    static const ::srm::StageId SRM_INSTR_CONCAT(srm_stage_, __LINE__) =                \
+        ::srm::Instrumentation::instance().stage(name);                                 \
+    const ::srm::ScopedTimer SRM_INSTR_CONCAT(srm_timer_, __LINE__)(                    \
+        SRM_INSTR_CONCAT(srm_stage_, __LINE__))
+/// Adds @p n to event counter @p name.
+#define SRM_COUNT(name, n)                                                              \
+    do {                                                                                \
+        static const ::srm::CounterId srm_counter_ =                                    \
+            ::srm::Instrumentation::instance().counter(name, ::srm::CounterKind::Sum);  \
+        ::srm::Instrumentation::instance().add(srm_counter_, n);                        \
+    } while (false)
+/// Raises high-water counter @p name to @p value if it is larger.
+#define SRM_HIGH_WATER(name, value)                                                     \
+    do {                                                                                \
+        static const ::srm::CounterId srm_counter_ = ::srm::Instrumentation::instance() \
+            .counter(name, ::srm::CounterKind::HighWater);                              \
+        ::srm::Instrumentation::instance().high_water(srm_counter_, value);             \
+    } while (false)
+#else
+#define SRM_SCOPED_TIMER(name) static_cast<void>(0)
+// sizeof keeps the arguments "used" without evaluating them.
+#define SRM_COUNT(name, n) static_cast<void>(sizeof(n))
+#define SRM_HIGH_WATER(name, value) static_cast<void>(sizeof(value))
+#endif
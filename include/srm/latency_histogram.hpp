@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace srm {
+
+/// Fixed-size log-linear latency histogram (HDR style): values are bucketed
+/// by power of two and each octave is split into kSubBuckets linear
+/// sub-buckets, so the relative bucket error stays below 1/kSubBuckets from
+/// 1 ns up to about five hours. All storage is inline; record() is a few
+/// integer instructions and never allocates, so it can be used from the
+/// real-time threads.
+///
+/// A single thread records; any thread may read. Counters are relaxed
+/// atomics, so a reader sees a consistent-enough snapshot for reporting
+/// without stalling the writer.
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 4;
+    static constexpr unsigned kSubBuckets = 1u << kSubBucketBits;
+    static constexpr unsigned kOctaves = 40;
+    static constexpr std::size_t kBuckets = (kOctaves + 1) * kSubBuckets;
+
+    LatencyHistogram() noexcept { reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(std::uint64_t value_ns) noexcept {
+        counts_[bucket_of(value_ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value_ns, std::memory_order_relaxed);
+        if (value_ns > max_.load(std::memory_order_relaxed)) {
+            max_.store(value_ns, std::memory_order_relaxed);
+        }
+        if (value_ns < min_.load(std::memory_order_relaxed)) {
+            min_.store(value_ns, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+    /// Smallest recorded value, or 0 when empty.
+    std::uint64_t min() const noexcept { return count() == 0 ? 0 : min_.load(std::memory_order_relaxed); }
+    double mean() const noexcept;
+
+    /// Upper edge of the bucket holding quantile @p q in [0, 1] (so the
+    /// estimate never understates a latency), clamped to max().
+    std::uint64_t percentile(double q) const noexcept;
+
+    /// Adds the counts of @p other (e.g. thread-local histograms).
+    void merge(const LatencyHistogram& other) noexcept;
+
+    void reset() noexcept;
+
+    /// Bucket index of @p value and the largest value of a bucket.
+    static std::size_t bucket_of(std::uint64_t value) noexcept {
+        if (value < kSubBuckets) {
+            return static_cast<std::size_t>(value);
+        }
+        const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(value));
+        const unsigned octave = msb - kSubBucketBits + 1;
+        if (octave > kOctaves) {
+            return kBuckets - 1;
+        }
+        const std::uint64_t sub = (value >> (msb - kSubBucketBits)) & (kSubBuckets - 1);
+        return octave * kSubBuckets + static_cast<std::size_t>(sub);
+    }
+    static std::uint64_t bucket_upper(std::size_t bucket) noexcept;
+
+    std::uint64_t bucket_count(std::size_t bucket) const noexcept {
+        return counts_[bucket].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBuckets> counts_;
+    std::atomic<std::uint64_t> count_;
+    std::atomic<std::uint64_t> sum_;
+    std::atomic<std::uint64_t> max_;
+    std::atomic<std::uint64_t> min_;
+};
+
+}  // namespace srm
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+namespace stream {
+
+static_assert(std::endian::native == std::endian::little,
+              "stream frames are encoded and decoded in place and assume a little-endian host");
+
+inline constexpr std::uint32_t kMagic = 0x534d5253;  ///< "SRMS" on the wire
+inline constexpr std::uint8_t kProtocolVersion = 2;
+/// Largest UDP payload that fits a standard 1500-byte Ethernet frame.
+inline constexpr std::size_t kEthernetDatagram = 1472;
+inline constexpr std::uint16_t kDefaultPort = 47800;
+
+enum class MessageKind : std::uint8_t {
+    Data = 1,         ///< server -> subscriber: one frame of samples
+    Subscribe = 2,    ///< subscriber -> server: start or keep alive
+    Unsubscribe = 3,  ///< subscriber -> server: stop now
+};
+
+inline constexpr std::uint16_t kFlagOverrun = 1;  ///< the rig lost samples before this frame
+
+// Datagram layout (little-endian): FrameHeader, then for a Data message
+// channel_count runs of sample_count int16 raw counts, channel-major like a
+// raw capture chunk. Control messages are a bare header. sequence counts
+// the Data frames of one rig from 0, so a subscriber sees a gap as a jump;
+// session is drawn afresh by every server instance, so a restarted rig is
+// told apart from late frames of its predecessor. first_sample is the rig's
+// per-channel sample counter and timestamp_ns the hardware time of that
+// sample.
+
+struct FrameHeader {
+    std::uint32_t magic;
+    std::uint8_t version;
+    MessageKind kind;
+    std::uint16_t rig_id;
+    std::uint64_t sequence;
+    std::uint64_t first_sample;
+    std::uint64_t timestamp_ns;
+    std::uint16_t channel_count;
+    std::uint16_t sample_count;  ///< per channel
+    std::uint16_t flags;
+    std::uint16_t session;
+};
+static_assert(sizeof(FrameHeader) == 40);
+
+/// Samples per channel that fit one datagram of @p datagram_bytes.
+constexpr std::size_t samples_per_frame(std::size_t channels, std::size_t datagram_bytes) noexcept {
+    return datagram_bytes <= sizeof(FrameHeader) || channels == 0
+               ? 0
+               : (datagram_bytes - sizeof(FrameHeader)) / (channels * sizeof(std::int16_t));
+}
+
+}  // namespace stream
+
+struct StreamServerConfig {
+    std::string bind_address = "0.0.0.0";
+    std::uint16_t port = stream::kDefaultPort;  ///< 0 picks a free port, see StreamServer::port()
+    std::uint16_t rig_id = 0;
+    double sample_rate_hz = 1e6;                ///< spaces the frame timestamps
+    /// UDP payload per frame; raise to ~8972 on a jumbo-frame network to cut
+    /// the packet rate six-fold.
+    std::size_t max_datagram_bytes = stream::kEthernetDatagram;
+    std::size_t max_subscribers = 16;
+    /// A subscriber that has not renewed within this time is dropped.
+    std::chrono::milliseconds subscriber_timeout{5000};
+    int send_buffer_bytes = 4 << 20;
+};
+
+/// Publishes a rig's raw counts to every subscribed workstation.
+///
+/// Each published block is cut into frames that fit one datagram and
+/// encoded once; the same encoded frames are then handed to sendmmsg() for
+/// every subscriber (one mmsghdr per frame and subscriber, all pointing at
+/// the shared buffer), so the cost of another subscriber is a syscall
+/// descriptor, not a copy. Subscribers register by sending Subscribe
+/// datagrams to the server's port; they are picked up, without blocking,
+/// at the next publish() or poll(). Not thread-safe.
+class StreamServer {
+public:
+    /// Throws std::invalid_argument for a datagram too small for one sample
+    /// of every channel, std::system_error if the socket cannot be bound.
+    StreamServer(const StreamServerConfig& config, std::size_t channels);
+    ~StreamServer();
+
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    /// Sends @p counts, whose first sample is the rig's sample
+    /// @p first_sample taken at hardware time @p timestamp_ns. Blocks only
+    /// while the socket send buffer is full. Throws std::invalid_argument on
+    /// a channel count mismatch, std::system_error on a socket error.
+    void publish(ChannelBlock<const std::int16_t> counts, std::uint64_t first_sample,
+                 std::uint64_t timestamp_ns, bool overrun = false);
+
+    /// Handles pending subscription messages and expires silent subscribers.
+    void poll();
+
+    std::uint16_t port() const noexcept { return port_; }
+    std::size_t subscriber_count() const noexcept { return subscribers_.size(); }
+    std::size_t samples_per_frame() const noexcept { return frame_samples_; }
+    std::uint64_t frames_published() const noexcept { return sequence_; }
+    std::uint16_t session() const noexcept { return session_; }
+    std::uint64_t datagrams_sent() const noexcept { return datagrams_sent_; }
+    /// Datagrams reported undeliverable (refused or unreachable). On the
+    /// unconnected socket the kernel reports most of these on a later send,
+    /// so they are included in datagrams_sent() as well.
+    std::uint64_t send_failures() const noexcept { return send_failures_; }
+
+private:
+    struct Subscriber {
+        sockaddr_in address{};
+        std::chrono::steady_clock::time_point last_seen;
+    };
+
+    void send_frames(std::size_t frames);
+
+    StreamServerConfig config_;
+    std::size_t channels_;
+    std::size_t frame_samples_;
+    std::size_t frame_bytes_;
+    int fd_ = -1;
+    std::uint16_t port_ = 0;
+    std::uint16_t session_;
+    std::vector<Subscriber> subscribers_;
+    std::vector<std::byte> frames_;  // encoded frames of the current batch
+    std::vector<iovec> frame_iovecs_;
+    std::vector<mmsghdr> messages_;  // frames x subscribers
+    std::uint64_t sequence_ = 0;
+    std::uint64_t datagrams_sent_ = 0;
+    std::uint64_t send_failures_ = 0;
+};
+
+struct StreamClientConfig {
+    std::size_t receive_batch = 64;         ///< datagrams per recvmmsg()
+    std::size_t max_datagram_bytes = 9000;  ///< larger datagrams are dropped as malformed
+    /// Subscriptions are renewed this often, well inside the server's
+    /// subscriber_timeout.
+    std::chrono::milliseconds heartbeat{1000};
+    int receive_buffer_bytes = 8 << 20;
+};
+
+/// One received Data frame. The sample view points into the client's
+/// receive buffers and is valid until the next receive().
+struct ReceivedFrame {
+    std::uint16_t rig_id = 0;
+    std::uint64_t sequence = 0;
+    std::uint64_t first_sample = 0;
+    std::uint64_t timestamp_ns = 0;
+    bool overrun = false;
+    /// Frames of this rig missing between the previous delivered frame and
+    /// this one.
+    std::uint64_t frames_missing = 0;
+    /// First frame of a restarted stream: sequence and sample numbering
+    /// start over, and nothing is known about what was missed.
+    bool restarted = false;
+    ChannelBlock<const std::int16_t> counts;
+};
+
+/// Per-rig reception counters of a StreamClient.
+struct RigStreamStats {
+    std::uint16_t rig_id = 0;
+    std::uint64_t frames = 0;          ///< delivered
+    std::uint64_t frames_lost = 0;     ///< sequence numbers skipped
+    std::uint64_t frames_late = 0;     ///< older than one already delivered (dropped)
+    std::uint64_t gaps = 0;            ///< distinct losses
+    std::uint64_t restarts = 0;        ///< sequence restarts followed (server restarted)
+    std::uint64_t next_sequence = 0;
+    std::uint16_t session = 0;         ///< of the server currently followed
+    std::uint16_t previous_session = 0;
+};
+
+/// Workstation side: subscribes to one or more rig servers on one socket
+/// and receives their frames in batches with recvmmsg(), checking each
+/// rig's sequence numbers for gaps. Frames that arrive after a newer frame
+/// of the same rig are dropped and counted as late, so a rig's delivered
+/// frames are always in order. A frame of a new session (or sequence 0
+/// behind the newest) comes from a restarted server: the client follows it
+/// at once, and drops stragglers of the session before as late. Not
+/// thread-safe.
+class StreamClient {
+public:
+    /// Throws std::invalid_argument for a zero batch or datagram size,
+    /// std::system_error if the socket cannot be created.
+    explicit StreamClient(const StreamClientConfig& config = {});
+    ~StreamClient();
+
+    StreamClient(const StreamClient&) = delete;
+    StreamClient& operator=(const StreamClient&) = delete;
+
+    /// Subscribes to the server at @p host (numeric IPv4 or a name) and
+    /// keeps the subscription alive from receive(). Throws
+    /// std::invalid_argument if the host does not resolve.
+    void subscribe(const std::string& host, std::uint16_t port = stream::kDefaultPort);
+
+    /// Tells every server to stop sending.
+    void unsubscribe_all();
+
+    /// Waits up to @p timeout for datagrams and returns the valid Data
+    /// frames of one batch (possibly none). Throws std::system_error on a
+    /// socket error.
+    std::span<const ReceivedFrame> receive(std::chrono::milliseconds timeout);
+
+    /// Counters of every rig heard from so far, by rig id.
+    std::span<const RigStreamStats> rig_stats() const noexcept { return rigs_; }
+    /// Datagrams that were not valid frames of this protocol.
+    std::uint64_t malformed() const noexcept { return malformed_; }
+
+private:
+    void send_control(const sockaddr_in& server, stream::MessageKind kind);
+    RigStreamStats& rig(std::uint16_t rig_id);
+
+    StreamClientConfig config_;
+    int fd_ = -1;
+    std::vector<sockaddr_in> servers_;
+    std::chrono::steady_clock::time_point last_heartbeat_;
+    std::vector<std::byte> buffers_;  // receive_batch x max_datagram_bytes
+    std::vector<iovec> iovecs_;
+    std::vector<mmsghdr> messages_;
+    std::vector<ReceivedFrame> frames_;
+    std::vector<RigStreamStats> rigs_;
+    std::uint64_t malformed_ = 0;
+};
+
+}  // namespace srm
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "srm/angle_resampler.hpp"
+#include "srm/campaign.hpp"
+#include "srm/capture_file.hpp"
+#include "srm/channel_block.hpp"
+#include "srm/spectrum.hpp"
+
+namespace srm {
+
+struct OrderAnalysisConfig {
+    AngleResamplerConfig resampler;
+    SpectrumConfig spectrum;
+
+    // Device backends only: capture samples staged per transfer, and the
+    // number of batches that may be in flight at once (one per concurrent
+    // analyse() call; further callers wait for a free one).
+    std::size_t batch_samples = 1 << 16;
+    std::size_t device_lanes = 2;
+};
+
+/// Campaign summary of an order analysis: per strain channel and order bin,
+/// the mean and peak amplitude over every spectrum frame.
+///
+/// Channels are the capture's channels without the rotor position channel,
+/// in capture order. Bin k is order k * order_per_bin of the electrical
+/// frequency.
+class OrderSpectrum {
+public:
+    OrderSpectrum() = default;
+    OrderSpectrum(std::size_t channels, std::size_t bins, double order_per_bin);
+
+    std::size_t channels() const noexcept { return channels_; }
+    std::size_t bins() const noexcept { return bins_; }
+    double order_per_bin() const noexcept { return order_per_bin_; }
+    std::uint64_t frames() const noexcept { return frames_; }
+    bool empty() const noexcept { return channels_ == 0; }
+
+    double mean(std::size_t channel, std::size_t bin) const noexcept;
+    float peak(std::size_t channel, std::size_t bin) const noexcept {
+        return amplitude_peak_[channel * bins_ + bin];
+    }
+
+    /// Folds one spectrum frame (channels x bins amplitudes) in.
+    void add_frame(ChannelBlock<const float> amplitude);
+
+    /// Folds in the summary of a later chunk range. An empty summary adopts
+    /// @p later; otherwise the shapes must match (std::invalid_argument).
+    void merge(const OrderSpectrum& later);
+
+    /// Raw accumulators, channels x bins, for backends that accumulate
+    /// elsewhere and fill the summary in one go.
+    std::span<double> amplitude_sum() noexcept { return amplitude_sum_; }
+    std::span<float> amplitude_peak() noexcept { return amplitude_peak_; }
+    void set_frames(std::uint64_t frames) noexcept { frames_ = frames; }
+
+private:
+    std::size_t channels_ = 0;
+    std::size_t bins_ = 0;
+    double order_per_bin_ = 0.0;
+    std::uint64_t frames_ = 0;
+    std::vector<double> amplitude_sum_;
+    std::vector<float> amplitude_peak_;
+};
+
+enum class SpectralBackendKind : std::uint8_t { Auto, Cpu, Cuda };
+
+std::string_view to_string(SpectralBackendKind kind) noexcept;
+
+/// True when @p kind was compiled in and, for a device backend, a device
+/// is present. Auto and Cpu are always available.
+bool spectral_backend_available(SpectralBackendKind kind) noexcept;
+
+/// Order analysis of capture chunk ranges: convert, resample to the angle
+/// grid, sliding spectrum, and accumulate into an OrderSpectrum. Each call
+/// starts from fresh resampler and spectrum state, so a partial result
+/// depends only on its chunk range, which is what CampaignProcessor needs
+/// for thread-count-independent summaries.
+///
+/// analyse() may be called from several threads at once.
+class SpectralBackend {
+public:
+    virtual ~SpectralBackend() = default;
+
+    virtual SpectralBackendKind kind() const noexcept = 0;
+    const OrderAnalysisConfig& config() const noexcept { return config_; }
+
+    /// Throws std::invalid_argument when the capture has no rotor position
+    /// channel or no strain channels.
+    virtual OrderSpectrum analyse(const CaptureReader& capture, ChunkRange range) const = 0;
+
+protected:
+    explicit SpectralBackend(const OrderAnalysisConfig& config);
+
+    OrderAnalysisConfig config_;
+};
+
+/// Creates the backend for @p kind. Auto picks a device backend when one is
+/// available and the CPU otherwise; asking for an unavailable backend
+/// explicitly throws std::runtime_error. Throws std::invalid_argument for
+/// an invalid configuration.
+std::unique_ptr<SpectralBackend> make_spectral_backend(const OrderAnalysisConfig& config,
+                                                       SpectralBackendKind kind = SpectralBackendKind::Auto);
+
+/// Order analysis of every file of a campaign with @p backend.
+inline std::vector<FileResult<OrderSpectrum>> analyse_orders(const CampaignProcessor& campaign,
+                                                             const std::vector<std::filesystem::path>& files,
+                                                             const SpectralBackend& backend) {
+    return campaign.run<OrderSpectrum>(
+        files, [&](const CaptureReader& capture, ChunkRange range) { return backend.analyse(capture, range); },
+        [](OrderSpectrum& into, OrderSpectrum&& part) { into.merge(part); });
+}
+
+namespace detail {
+
+/// The capture's strain channels (all but the rotor position channel);
+/// throws std::invalid_argument as SpectralBackend::analyse() documents.
+std::vector<std::size_t> order_strain_channels(const CaptureInfo& info);
+
+#if defined(SRM_HAVE_CUDA)
+bool cuda_spectral_backend_available() noexcept;
+std::unique_ptr<SpectralBackend> make_cuda_spectral_backend(const OrderAnalysisConfig& config);
+#endif
+
+}  // namespace detail
+
+}  // namespace srm
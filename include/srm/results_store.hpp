@@ -0,0 +1,265 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace srm {
+
+enum class ColumnType : std::uint8_t {
+    Float64 = 1,
+    Int64 = 2,
+    Key = 3,  ///< dictionary-encoded string: uint32 codes into a sorted dictionary
+};
+
+const char* to_string(ColumnType type) noexcept;
+
+namespace results {
+
+inline constexpr std::array<char, 8> kFileMagic = {'S', 'R', 'M', 'R', 'E', 'S', '0', '1'};
+inline constexpr std::array<char, 8> kTrailerMagic = {'S', 'R', 'M', 'R', 'I', 'X', '0', '1'};
+inline constexpr std::uint32_t kFormatVersion = 1;
+/// Rows per zone-map entry. A query skips a zone on its min/max alone.
+inline constexpr std::uint32_t kZoneRows = 4096;
+inline constexpr std::uint32_t kAlignment = 64;
+
+// Store layout (little-endian, like the capture file):
+//   FileHeader
+//   per column, each 64-byte aligned:
+//     values: row_count doubles, int64s or uint32 codes
+//     zone map: zone_count Zones (double min/max for Float64, int64 for
+//               Int64 and Key codes)
+//     Key only: dictionary_size + 1 uint32 offsets into a string blob, blob
+//   ColumnDescriptor[column_count]
+//   FileTrailer
+// Every column is one contiguous array, so the reader scans it in place
+// through mmap.
+
+struct FileHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t zone_rows;
+    std::uint64_t row_count;
+    std::uint32_t column_count;
+    std::uint32_t reserved0;
+    std::array<std::uint8_t, 32> reserved;
+};
+static_assert(sizeof(FileHeader) == 64);
+
+struct ColumnDescriptor {
+    std::array<char, 40> name;  ///< NUL-padded
+    ColumnType type;
+    std::array<std::uint8_t, 3> reserved0;
+    std::uint32_t dictionary_size;  ///< Key: distinct values
+    std::uint64_t values_offset;
+    std::uint64_t zones_offset;
+    std::uint64_t dictionary_offset;  ///< Key: the dictionary_size + 1 offsets
+    std::uint64_t reserved1;
+};
+static_assert(sizeof(ColumnDescriptor) == 80);
+
+/// Min/max of one zone; a Float64 zone of NaNs only has min > max.
+template <typename T>
+struct Zone {
+    T min;
+    T max;
+};
+static_assert(sizeof(Zone<double>) == 16 && sizeof(Zone<std::int64_t>) == 16);
+
+struct FileTrailer {
+    std::uint64_t columns_offset;
+    std::uint64_t row_count;
+    std::array<char, 8> reserved;
+    std::array<char, 8> magic;
+};
+static_assert(sizeof(FileTrailer) == 32);
+
+}  // namespace results
+
+/// Builds a columnar results store (*.srmres): one row per operating point
+/// and measurement location, say, with key and feature columns.
+///
+/// Columns are declared first, then filled a row at a time. Rows are held in
+/// memory, column by column, until finish() writes the file; key columns
+/// get a sorted dictionary, so codes order like the strings. Summaries of a
+/// campaign are small (100k rows of ten columns is 8 MB), so there is no
+/// streaming mode.
+class ResultsWriter {
+public:
+    explicit ResultsWriter(std::filesystem::path path);
+    ~ResultsWriter();
+
+    ResultsWriter(const ResultsWriter&) = delete;
+    ResultsWriter& operator=(const ResultsWriter&) = delete;
+
+    /// Declares a column and returns its index. Throws std::invalid_argument
+    /// for an empty, overlong (> 39 bytes) or duplicate name, std::logic_error
+    /// once rows have been added.
+    std::size_t add_column(std::string_view name, ColumnType type);
+
+    /// Sets @p column of the current row. Throws std::invalid_argument if
+    /// the column has a different type.
+    void set(std::size_t column, double value);
+    void set(std::size_t column, std::int64_t value);
+    void set(std::size_t column, std::string_view key);
+
+    /// Completes the current row. Throws std::logic_error if a column was
+    /// not set (the row is then discarded).
+    void end_row();
+
+    std::size_t rows() const noexcept { return rows_; }
+
+    /// Writes the file. Called by the destructor if omitted, but errors are
+    /// then swallowed. Throws std::system_error on I/O failure.
+    void finish();
+
+private:
+    struct Column {
+        std::string name;
+        ColumnType type = ColumnType::Float64;
+        std::vector<double> f64;
+        std::vector<std::int64_t> i64;
+        std::vector<std::uint32_t> codes;  // insertion-order codes until finish()
+        std::vector<std::string> dictionary;
+        std::map<std::string, std::uint32_t, std::less<>> lookup;
+        bool set = false;  // in the current row
+    };
+
+    Column& column_for(std::size_t column, ColumnType type);
+
+    std::filesystem::path path_;
+    std::vector<Column> columns_;
+    std::size_t rows_ = 0;
+    bool finished_ = false;
+};
+
+/// Read-only mapped view of a results store. Opening parses the header and
+/// the column table and makes one pass over each Key column's codes, which
+/// queries index by.
+class ResultsReader {
+public:
+    /// Throws std::system_error if the file cannot be opened,
+    /// std::runtime_error if it is malformed.
+    explicit ResultsReader(const std::filesystem::path& path);
+    ~ResultsReader();
+
+    ResultsReader(ResultsReader&& other) noexcept;
+    ResultsReader& operator=(ResultsReader&& other) noexcept;
+    ResultsReader(const ResultsReader&) = delete;
+    ResultsReader& operator=(const ResultsReader&) = delete;
+
+    std::size_t rows() const noexcept { return rows_; }
+    std::size_t column_count() const noexcept { return columns_.size(); }
+    std::size_t zone_count() const noexcept { return (rows_ + results::kZoneRows - 1) / results::kZoneRows; }
+
+    /// Index of the column called @p name; throws std::out_of_range.
+    std::size_t column(std::string_view name) const;
+    std::string_view column_name(std::size_t column) const noexcept;
+    ColumnType column_type(std::size_t column) const noexcept { return columns_[column].type; }
+
+    /// Column values in place. Throw std::invalid_argument on a type mismatch.
+    std::span<const double> f64(std::size_t column) const;
+    std::span<const std::int64_t> i64(std::size_t column) const;
+    std::span<const std::uint32_t> codes(std::size_t column) const;
+    std::span<const results::Zone<double>> f64_zones(std::size_t column) const;
+    /// Int64 and Key columns.
+    std::span<const results::Zone<std::int64_t>> i64_zones(std::size_t column) const;
+
+    std::size_t dictionary_size(std::size_t column) const noexcept { return columns_[column].dictionary_size; }
+    std::string_view key(std::size_t column, std::uint32_t code) const noexcept;
+    /// Code of @p key in a Key column, or -1 when the dictionary lacks it.
+    std::int64_t find_key(std::size_t column, std::string_view key) const noexcept;
+
+private:
+    void unmap() noexcept;
+    const results::ColumnDescriptor& descriptor(std::size_t column, ColumnType type) const;
+
+    const std::byte* base_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t rows_ = 0;
+    std::span<const results::ColumnDescriptor> columns_;
+};
+
+enum class Compare : std::uint8_t { Less, LessEqual, Equal, NotEqual, GreaterEqual, Greater };
+enum class Aggregate : std::uint8_t { Count, Sum, Mean, Min, Max };
+
+/// Answer of a ResultsQuery: one row per group, groups in ascending key
+/// order (dictionary order for a Key column), one column per aggregate.
+struct QueryResult {
+    std::vector<double> group_values;      ///< numeric group column
+    std::vector<std::string> group_keys;   ///< Key group column
+    std::vector<std::uint64_t> counts;     ///< matching rows per group
+    /// [aggregate][group]. Sum and Mean are NaN if any value is; Min and
+    /// Max skip NaNs (NaN if every value is).
+    std::vector<std::vector<double>> values;
+
+    std::size_t zones_scanned = 0;
+    std::size_t zones_skipped = 0;  ///< ruled out by the zone maps
+    std::uint64_t rows_matched = 0;
+
+    std::size_t groups() const noexcept { return counts.size(); }
+};
+
+/// Filter -> group-by -> aggregate over a ResultsReader, e.g. peak yoke
+/// strain against speed at 10 A:
+///
+///   ResultsQuery(store)
+///       .where("current_a", Compare::Equal, 10.0)
+///       .where_key("location", "yoke")
+///       .group_by("speed_rpm")
+///       .aggregate(Aggregate::Max, "peak_ue")
+///       .run();
+///
+/// Predicates are ANDed; NaN matches no comparison, NotEqual included, and
+/// rows with a NaN group value are left out. run() works a zone at a
+/// time. Zones the min/max maps rule out are skipped; in the rest, each
+/// predicate is one branch-free compare loop over the contiguous column
+/// into a byte mask, which the compiler vectorises, and the matches are
+/// compacted to a selection vector the aggregates gather from. Building a
+/// query only records names; they are checked in run(), which throws
+/// std::out_of_range for an unknown column and std::invalid_argument for a
+/// type that does not fit.
+class ResultsQuery {
+public:
+    explicit ResultsQuery(const ResultsReader& store) noexcept : store_(store) {}
+
+    /// Numeric comparison on a Float64 or Int64 column.
+    ResultsQuery& where(std::string_view column, Compare op, double value);
+    /// Inclusive range on a Float64 or Int64 column.
+    ResultsQuery& between(std::string_view column, double lo, double hi);
+    /// Equality on a Key column.
+    ResultsQuery& where_key(std::string_view column, std::string_view key);
+    /// At most one; without it every matching row is in a single group.
+    ResultsQuery& group_by(std::string_view column);
+    /// Count ignores @p column (pass "").
+    ResultsQuery& aggregate(Aggregate op, std::string_view column);
+
+    QueryResult run() const;
+
+private:
+    struct Predicate {
+        std::string column;
+        Compare op;
+        double value;
+        std::string key;
+        bool is_key;
+    };
+    struct Output {
+        Aggregate op;
+        std::string column;
+    };
+
+    const ResultsReader& store_;
+    std::vector<Predicate> predicates_;
+    std::string group_by_;
+    std::vector<Output> outputs_;
+};
+
+}  // namespace srm
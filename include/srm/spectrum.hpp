@@ -0,0 +1,105 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "srm/aligned.hpp"
+#include "srm/channel_block.hpp"
+#include "srm/fft.hpp"
+
+namespace srm {
+
+struct SpectrumConfig {
+    std::size_t frame_size = 4096;  ///< FFT length, power of two
+    std::size_t hop = 1024;         ///< new samples between frames, <= frame_size
+    WindowType window = WindowType::Hann;
+};
+
+/// One multi-channel output frame of SlidingSpectrum.
+struct SpectrumFrame {
+    std::uint64_t index;       ///< running frame number
+    std::uint64_t end_sample;  ///< per-channel sample count consumed when the frame closed
+    /// Single-sided amplitude spectrum, channels x bins; a sinusoid of
+    /// amplitude A centred on a bin reads A. Valid only inside the sink call.
+    ChannelBlock<const float> amplitude;
+};
+
+/// Streaming short-time spectrum over N channels.
+///
+/// Every hop samples one frame per channel is windowed, transformed and
+/// reduced to amplitudes; samples that only shift the window are never
+/// retransformed. Plan and window come from PlanCache, every buffer is
+/// cache-line aligned and allocated in the constructor, so push() does not
+/// touch the heap.
+///
+/// Fed with the output of AngleResampler, bin k is order
+/// k * points_per_cycle / frame_size of the electrical frequency.
+class SlidingSpectrum {
+public:
+    /// Throws std::invalid_argument for an invalid frame size or hop.
+    SlidingSpectrum(const SpectrumConfig& config, std::size_t channels);
+
+    std::size_t channels() const noexcept { return history_.channels(); }
+    std::size_t bins() const noexcept { return plan_->bins(); }
+    const SpectrumConfig& config() const noexcept { return config_; }
+
+    /// Frequency of bin @p bin for input sampled at @p sample_rate.
+    double bin_frequency(std::size_t bin, double sample_rate) const noexcept {
+        return static_cast<double>(bin) * sample_rate / static_cast<double>(config_.frame_size);
+    }
+
+    /// Appends a block (all channels) and calls sink(const SpectrumFrame&)
+    /// for every frame completed by it. Returns the number of frames.
+    template <typename Sink>
+    std::size_t push(ChannelBlock<const float> block, Sink&& sink) {
+        check_block(block);
+        std::size_t frames = 0;
+        std::size_t pos = 0;
+        while (pos < block.samples()) {
+            const std::size_t remaining = block.samples() - pos;
+            const std::size_t take = remaining < until_hop_ ? remaining : until_hop_;
+            append(block.subblock(pos, take));
+            pos += take;
+            until_hop_ -= take;
+            if (until_hop_ == 0) {
+                until_hop_ = config_.hop;
+                if (filled_ >= config_.frame_size) {
+                    compute_frame();
+                    sink(SpectrumFrame{frame_index_++, consumed_, amplitude_.view()});
+                    ++frames;
+                }
+            }
+        }
+        return frames;
+    }
+
+    /// Discards history; the next frame needs a full frame of new samples.
+    void reset() noexcept;
+
+private:
+    void check_block(ChannelBlock<const float> block) const;
+    void append(ChannelBlock<const float> block) noexcept;
+    void compute_frame() noexcept;
+
+    SpectrumConfig config_;
+    std::shared_ptr<const FftPlan> plan_;
+    std::shared_ptr<const AlignedVector<float>> window_;
+    float edge_scale_;
+    float inner_scale_;
+
+    ChannelBuffer<float> history_;  // circular, frame_size per channel
+    std::size_t write_pos_ = 0;
+    std::size_t filled_ = 0;
+    std::size_t until_hop_;
+    std::uint64_t consumed_ = 0;
+    std::uint64_t frame_index_ = 0;
+
+    AlignedVector<float> frame_;
+    AlignedVector<std::complex<float>> scratch_;
+    AlignedVector<std::complex<float>> spectrum_;
+    ChannelBuffer<float> amplitude_;
+};
+
+}  // namespace srm
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "srm/common.hpp"
+
+namespace srm {
+
+/// Bounded single-producer/single-consumer ring buffer.
+///
+/// Sits between the ADC reader thread and the processing thread. All storage
+/// is allocated in the constructor; push/pop never block, never allocate and
+/// never take a lock, so the reader can always return to the driver on time.
+/// When the ring is full the push reports how much was accepted and the
+/// caller decides what an overrun means.
+///
+/// Capacity is rounded up to a power of two so indices wrap with a mask. The
+/// head and tail counters grow monotonically (64-bit, they do not wrap in
+/// practice) and live on separate cache lines together with a cached copy of
+/// the opposite side's counter, so in steady state each side touches the
+/// other's line only when its cached view runs out.
+///
+/// Exactly one thread may call the producer methods (try_push, push_batch)
+/// and exactly one thread the consumer methods (try_pop, pop_batch, front).
+template <typename T>
+class SpscRing {
+    static_assert(std::is_default_constructible_v<T>, "SpscRing slots are preconstructed");
+    static_assert(std::is_nothrow_move_assignable_v<T>, "push/pop must not throw");
+
+public:
+    using value_type = T;
+
+    explicit SpscRing(std::size_t min_capacity)
+        : capacity_(round_up_pow2(min_capacity < 2 ? 2 : min_capacity)),
+          mask_(capacity_ - 1),
+          slots_(std::make_unique<T[]>(capacity_)) {
+        if (min_capacity == 0) {
+            throw std::invalid_argument("SpscRing: capacity must be non-zero");
+        }
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    /// Approximate number of queued elements, always in [0, capacity()];
+    /// exact when called from either endpoint while the other side is idle.
+    std::size_t size() const noexcept {
+        // Tail first: head only grows, so the head read after it is never
+        // behind it, whichever thread calls this. Both may move in between,
+        // hence the clamp.
+        const std::size_t tail = consumer_.tail.load(std::memory_order_acquire);
+        const std::size_t head = producer_.head.load(std::memory_order_acquire);
+        const std::size_t queued = head - tail;
+        return queued < capacity_ ? queued : capacity_;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    // ---- producer side -------------------------------------------------
+
+    bool try_push(T value) noexcept {
+        const std::size_t head = producer_.head.load(std::memory_order_relaxed);
+        if (head - producer_.cached_tail == capacity_) {
+            producer_.cached_tail = consumer_.tail.load(std::memory_order_acquire);
+            if (head - producer_.cached_tail == capacity_) {
+                return false;
+            }
+        }
+        slots_[head & mask_] = std::move(value);
+        producer_.head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pushes as many elements of @p items as fit and returns that count.
+    /// The whole batch is published with a single release store.
+    std::size_t push_batch(std::span<const T> items) noexcept {
+        const std::size_t head = producer_.head.load(std::memory_order_relaxed);
+        std::size_t free_slots = capacity_ - (head - producer_.cached_tail);
+        if (free_slots < items.size()) {
+            producer_.cached_tail = consumer_.tail.load(std::memory_order_acquire);
+            free_slots = capacity_ - (head - producer_.cached_tail);
+        }
+        const std::size_t count = items.size() < free_slots ? items.size() : free_slots;
+        copy_in(head, items.data(), count);
+        producer_.head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // ---- consumer side -------------------------------------------------
+
+    bool try_pop(T& out) noexcept {
+        const std::size_t tail = consumer_.tail.load(std::memory_order_relaxed);
+        if (tail == consumer_.cached_head) {
+            consumer_.cached_head = producer_.head.load(std::memory_order_acquire);
+            if (tail == consumer_.cached_head) {
+                return false;
+            }
+        }
+        out = std::move(slots_[tail & mask_]);
+        consumer_.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pops up to out.size() elements into @p out and returns the count.
+    std::size_t pop_batch(std::span<T> out) noexcept {
+        const std::size_t tail = consumer_.tail.load(std::memory_order_relaxed);
+        std::size_t available = consumer_.cached_head - tail;
+        if (available < out.size()) {
+            consumer_.cached_head = producer_.head.load(std::memory_order_acquire);
+            available = consumer_.cached_head - tail;
+        }
+        const std::size_t count = out.size() < available ? out.size() : available;
+        copy_out(tail, out.data(), count);
+        consumer_.tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /// Peeks at the oldest element without consuming it, or nullptr.
+    T* front() noexcept {
+        const std::size_t tail = consumer_.tail.load(std::memory_order_relaxed);
+        if (tail == consumer_.cached_head) {
+            consumer_.cached_head = producer_.head.load(std::memory_order_acquire);
+            if (tail == consumer_.cached_head) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+
+private:
+    void copy_in(std::size_t head, const T* src, std::size_t count) noexcept {
+        const std::size_t first = head & mask_;
+        const std::size_t until_wrap = capacity_ - first;
+        const std::size_t n1 = count < until_wrap ? count : until_wrap;
+        for (std::size_t i = 0; i < n1; ++i) {
+            slots_[first + i] = src[i];
+        }
+        for (std::size_t i = n1; i < count; ++i) {
+            slots_[i - n1] = src[i];
+        }
+    }
+
+    void copy_out(std::size_t tail, T* dst, std::size_t count) noexcept {
+        const std::size_t first = tail & mask_;
+        const std::size_t until_wrap = capacity_ - first;
+        const std::size_t n1 = count < until_wrap ? count : until_wrap;
+        for (std::size_t i = 0; i < n1; ++i) {
+            dst[i] = std::move(slots_[first + i]);
+        }
+        for (std::size_t i = n1; i < count; ++i) {
+            dst[i] = std::move(slots_[i - n1]);
+        }
+    }
+
+    struct alignas(kCacheLineSize) ProducerState {
+        std::atomic<std::size_t> head{0};
+        std::size_t cached_tail = 0;
+    };
+
+    struct alignas(kCacheLineSize) ConsumerState {
+        std::atomic<std::size_t> tail{0};
+        std::size_t cached_head = 0;
+    };
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<T[]> slots_;
+    ProducerState producer_;
+    ConsumerState consumer_;
+};
+
+}  // namespace srm
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "srm/calibration_store.hpp"
+#include "srm/capture_file.hpp"
+#include "srm/decimator.hpp"
+#include "srm/fft.hpp"
+
+namespace srm {
+
+namespace plans {
+
+inline constexpr std::array<char, 8> kFileMagic = {'S', 'R', 'M', 'P', 'L', 'N', '0', '1'};
+/// Bump with any change to a design routine or table layout, so caches
+/// written by an older build are rebuilt rather than trusted.
+inline constexpr std::uint32_t kFormatVersion = 1;
+inline constexpr std::uint32_t kAlignment = 64;
+
+enum class SectionKind : std::uint32_t {
+    FftBitReversal = 1,    ///< size: transform size
+    FftStageTwiddles = 2,
+    FftSplitTwiddles = 3,
+    Window = 4,            ///< size, window: WindowType
+    CompensatorTaps = 5,
+    HalfbandTaps = 6,
+    Calibration = 7,       ///< CalibrationSnapshot image
+};
+
+// Plan file layout (little-endian, like the capture file):
+//   FileHeader
+//   SectionEntry[section_count]
+//   sections, each 64-byte aligned
+// The checksum covers everything after the header, so a torn or stale
+// file is rebuilt rather than used.
+
+struct FileHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t section_count;
+    std::uint64_t configuration_hash;
+    std::uint64_t file_bytes;
+    std::uint64_t checksum;  ///< four-lane word FNV-1a of bytes [sizeof(FileHeader), file_bytes)
+    std::array<std::uint8_t, 24> reserved;
+};
+static_assert(sizeof(FileHeader) == 64);
+
+struct SectionEntry {
+    SectionKind kind;
+    std::uint32_t window;
+    std::uint64_t size;
+    std::uint64_t offset;
+    std::uint64_t bytes;
+};
+static_assert(sizeof(SectionEntry) == 32);
+
+}  // namespace plans
+
+struct WindowRequest {
+    WindowType window = WindowType::Hann;
+    std::size_t size = 0;
+};
+
+/// Everything the acquisition chain builds before a run starts.
+struct RigConfiguration {
+    std::vector<ChannelInfo> channels;
+    /// Parsed in order into one CalibrationSnapshot; none leaves the
+    /// header constants.
+    std::vector<std::filesystem::path> calibration_files;
+    std::size_t calibration_table_points = CalibrationSnapshot::kDefaultTablePoints;
+    DecimationChainConfig decimation;
+    std::vector<std::size_t> fft_sizes;
+    std::vector<WindowRequest> windows;
+};
+
+/// FNV-1a over every field of @p config, the calibration files' contents
+/// (not their names or times) and plans::kFormatVersion. Throws
+/// std::runtime_error if a calibration file cannot be read.
+std::uint64_t configuration_hash(const RigConfiguration& config);
+
+/// The built plans of one configuration.
+struct RigPlans {
+    std::uint64_t configuration_hash = 0;
+    bool from_cache = false;
+    /// Why the cache was not used or not updated (a missing file is not an
+    /// error); empty otherwise. Neither stops the plans being built.
+    std::string cache_error;
+
+    std::vector<std::shared_ptr<const FftPlan>> fft;  ///< per fft_sizes entry
+    std::vector<std::shared_ptr<const AlignedVector<float>>> windows;  ///< per windows entry
+    DecimationTaps decimation;
+    std::optional<CalibrationSnapshot> calibration;  ///< always set
+};
+
+/// Builds every plan of @p config from scratch: FFT tables, windows,
+/// decimation filters and the calibration snapshot, parsed from the files.
+/// Throws as the individual builders do.
+RigPlans build_rig_plans(const RigConfiguration& config);
+
+/// Versioned on-disk cache of RigPlans, one file per configuration hash
+/// (rig-<hash>.srmplan) in a directory, so switching between known rigs
+/// stays fast too.
+///
+/// load_or_build() maps the file of the configuration's hash and restores
+/// the plans from it with plain copies: no FFT table, filter design or
+/// calibration parse is redone. A missing, stale, truncated or corrupt
+/// file is rebuilt and rewritten (to a temporary name, then renamed, so a
+/// concurrent start never reads half a file). Either way the FFT plans and
+/// windows are also placed in PlanCache::instance(), where the spectrum
+/// stages look them up.
+class StartupPlanCache {
+public:
+    /// The directory is created on first write.
+    explicit StartupPlanCache(std::filesystem::path directory);
+
+    const std::filesystem::path& directory() const noexcept { return directory_; }
+    std::filesystem::path file_for(std::uint64_t configuration_hash) const;
+
+    /// Throws as build_rig_plans() does; cache problems only end up in
+    /// RigPlans::cache_error.
+    RigPlans load_or_build(const RigConfiguration& config) const;
+
+private:
+    std::filesystem::path directory_;
+};
+
+}  // namespace srm
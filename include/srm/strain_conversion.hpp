@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "srm/capture_file.hpp"
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+/// Per-channel constants of the raw-count -> microstrain conversion, folded
+/// so the kernel is one subtract, one multiply and (quarter bridge only) one
+/// divide per sample:
+///
+///   r   = (counts - offset_counts) * ratio_per_count       bridge output / excitation
+///   ue  = strain_coeff * r                                 half and full bridge
+///   ue  = (strain_coeff * r) / (1 + (r + r))               quarter bridge
+///
+/// strain_coeff is -4e6/GF, -2e6/GF or -1e6/GF for quarter, half and full
+/// bridges. Every kernel evaluates exactly these float operations in this
+/// order and without contraction, which is what makes the SIMD paths match
+/// the scalar reference bit for bit.
+struct ConversionParams {
+    float offset_counts = 0.0f;
+    float ratio_per_count = 0.0f;
+    float strain_coeff = 0.0f;
+    capture::BridgeConfig bridge = capture::BridgeConfig::Quarter;
+};
+
+/// Folds a channel's header metadata into conversion constants.
+/// Throws std::invalid_argument for non-positive gain, excitation or gauge factor.
+ConversionParams make_conversion_params(const ChannelInfo& channel);
+
+/// Scalar reference for a single sample.
+inline float convert_sample(const ConversionParams& p, std::int16_t counts) noexcept {
+    const float r = (static_cast<float>(counts) - p.offset_counts) * p.ratio_per_count;
+    const float linear = p.strain_coeff * r;
+    if (p.bridge == capture::BridgeConfig::Quarter) {
+        return linear / (1.0f + (r + r));
+    }
+    return linear;
+}
+
+/// Inverse of convert_sample() in double precision: the (fractional) ADC
+/// count that reads as @p microstrain. Used to express strain limits in
+/// counts and to synthesise raw test signals.
+double strain_to_counts(const ConversionParams& p, double microstrain) noexcept;
+
+/// Instruction-set paths of the conversion kernel.
+enum class SimdPath {
+    Scalar,
+    Avx2,
+    Avx512,
+    Neon,
+};
+
+const char* to_string(SimdPath path) noexcept;
+
+/// True if @p path was compiled in and the running CPU supports it.
+bool simd_path_supported(SimdPath path) noexcept;
+
+/// Widest supported path; chosen once on first use.
+SimdPath best_simd_path() noexcept;
+
+/// Converts one channel with the best available path.
+/// @p out must hold at least in.size() elements.
+void convert_channel(const ConversionParams& params, std::span<const std::int16_t> in,
+                     std::span<float> out) noexcept;
+
+/// Converts one channel with an explicit path; falls back to Scalar if
+/// @p path is not supported. Intended for verification and benchmarks.
+void convert_channel(SimdPath path, const ConversionParams& params,
+                     std::span<const std::int16_t> in, std::span<float> out) noexcept;
+
+/// Converts every channel of a structure-of-arrays block. @p params holds one
+/// entry per channel; @p out must have the same shape as @p in.
+/// Throws std::invalid_argument on a shape mismatch.
+void convert_block(std::span<const ConversionParams> params, ChannelBlock<const std::int16_t> in,
+                   ChannelBlock<float> out);
+
+}  // namespace srm
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "srm/channel_block.hpp"
+
+namespace srm {
+
+/// Count, mean and variance, plus the exact extremes. add() takes the mean
+/// and squared deviations of the block in two passes over it and folds
+/// them in with Chan's pairwise form of Welford's update, which merge()
+/// uses too, so the moments of any split of a series agree with one pass
+/// over it to rounding; the count, min and max are exact.
+struct MomentAccumulator {
+    std::uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;  ///< sum of squared deviations from the mean
+    float min = std::numeric_limits<float>::infinity();
+    float max = -std::numeric_limits<float>::infinity();
+
+    void add(std::span<const float> values) noexcept;
+    void merge(const MomentAccumulator& other) noexcept;
+
+    double variance() const noexcept { return count < 2 ? 0.0 : m2 / static_cast<double>(count - 1); }
+    double rms() const noexcept {
+        return count == 0 ? 0.0 : std::sqrt(mean * mean + m2 / static_cast<double>(count));
+    }
+    double peak_to_peak() const noexcept { return count == 0 ? 0.0 : double(max) - double(min); }
+};
+
+/// Quantiles from a fixed log-linear histogram of the values, in the spirit
+/// of DDSketch and of LatencyHistogram: the bucket of a float is its sign,
+/// exponent and top kSubBucketBits mantissa bits, so any quantile is
+/// reported within 2^-(kSubBucketBits + 1) relative error (0.4%) across
+/// [kMinMagnitude, kMaxMagnitude]; smaller magnitudes share a zero bucket
+/// and larger ones saturate. Unlike a t-digest the storage is fixed (about
+/// 60 KB) and merging adds counts, so a merged sketch is bit-identical to
+/// one built in a single pass, whatever the split or merge order.
+class QuantileSketch {
+public:
+    static constexpr unsigned kSubBucketBits = 7;
+    static constexpr int kMinExponent = -10;  ///< kMinMagnitude = 2^kMinExponent
+    static constexpr int kMaxExponent = 21;   ///< kMaxMagnitude = 2^kMaxExponent
+    static constexpr std::size_t kMagnitudeBuckets =
+        static_cast<std::size_t>(kMaxExponent - kMinExponent) << kSubBucketBits;
+    /// Negative buckets (descending magnitude), zero, positive buckets.
+    static constexpr std::size_t kBuckets = 2 * kMagnitudeBuckets + 1;
+
+    QuantileSketch() : counts_(kBuckets, 0) {}
+
+    void add(std::span<const float> values) noexcept;
+    void merge(const QuantileSketch& other) noexcept;
+
+    std::uint64_t count() const noexcept { return count_; }
+    /// Value at quantile @p q in [0, 1] (the centre of its bucket, clamped
+    /// to the exact extremes); NaN when empty.
+    double quantile(double q) const noexcept;
+
+    void reset() noexcept;
+
+private:
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t count_ = 0;
+    float min_ = std::numeric_limits<float>::infinity();
+    float max_ = -std::numeric_limits<float>::infinity();
+};
+
+/// Levels the rainflow counter quantises strain into. Reversals within one
+/// level are not counted, which also acts as the usual hysteresis gate
+/// against noise.
+struct RainflowConfig {
+    double lower_ue = -2000.0;  ///< values below clamp to level 0
+    double upper_ue = 2000.0;   ///< values above clamp to the top level
+    std::uint32_t levels = 64;
+};
+
+/// Streaming four-point rainflow count (ASTM E1049) into a matrix of
+/// closed cycles by lower and upper level (range and mean), with the
+/// unclosed residue kept as a turning-point stack. Quantising to levels
+/// bounds the residue at 2 * levels points, so memory is constant however
+/// long the test point runs.
+///
+/// Cycles closed inside a chunk stay closed in any longer series, so
+/// counts of consecutive chunks combine exactly: merge() adds the matrices
+/// and replays the later chunk's residue onto this one, which gives the
+/// same matrix and residue as counting the concatenation in one pass.
+class RainflowCounter {
+public:
+    /// Throws std::invalid_argument for an empty range or fewer than two
+    /// levels.
+    explicit RainflowCounter(const RainflowConfig& config = {});
+
+    void add(std::span<const float> values);
+
+    /// Folds in the count of the samples that directly follow this one's.
+    /// Throws std::invalid_argument if the configurations differ.
+    void merge(const RainflowCounter& later);
+
+    /// Closed cycles between levels @p low and @p high (low < high). The
+    /// direction a cycle was traversed in is not kept: it depends on where
+    /// the series was cut, so it would not merge exactly.
+    std::uint64_t cycles(std::uint32_t low, std::uint32_t high) const noexcept {
+        return matrix_[static_cast<std::size_t>(low) * config_.levels + high];
+    }
+    std::uint64_t closed_cycles() const noexcept { return closed_; }
+    /// Unclosed turning points, oldest first, as levels.
+    std::span<const std::uint32_t> residue() const noexcept { return residue_; }
+
+    /// Centre of level @p level in microstrain.
+    double level_value(std::uint32_t level) const noexcept {
+        return config_.lower_ue + (static_cast<double>(level) + 0.5) * width_;
+    }
+    double level_width() const noexcept { return width_; }
+
+    /// Miner's sum of range^@p exponent over all cycles, ranges in
+    /// microstrain, with the residue counted as half cycles. Divide by the
+    /// S-N constant for a damage fraction.
+    double damage(double exponent) const noexcept;
+
+    const RainflowConfig& config() const noexcept { return config_; }
+    void reset() noexcept;
+
+private:
+    void push(std::uint32_t level) noexcept;
+
+    RainflowConfig config_;
+    double width_;
+    double inv_width_;
+    std::vector<std::uint64_t> matrix_;  // levels x levels, [low][high]
+    std::uint64_t closed_ = 0;
+    std::vector<std::uint32_t> residue_;
+};
+
+/// Per-channel summary of one operating point.
+struct ChannelStatistics {
+    std::uint64_t count = 0;
+    double mean = 0.0;
+    double rms = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double peak_to_peak = 0.0;
+    double p01 = 0.0;
+    double p50 = 0.0;
+    double p99 = 0.0;
+    std::uint64_t rainflow_cycles = 0;  ///< closed cycles
+};
+
+/// Single-pass, constant-memory statistics of every channel of a test
+/// point: moments, quantiles and a rainflow count. Chunks may be processed
+/// separately (e.g. as CampaignProcessor parts) and merged in sample order.
+class StrainStatistics {
+public:
+    explicit StrainStatistics(std::size_t channels = 0, const RainflowConfig& rainflow = {});
+
+    /// Throws std::invalid_argument on a channel count mismatch.
+    void add(ChannelBlock<const float> block);
+    /// Folds in the statistics of the samples that follow; throws
+    /// std::invalid_argument on a channel count mismatch.
+    void merge(const StrainStatistics& later);
+
+    std::size_t channel_count() const noexcept { return moments_.size(); }
+    ChannelStatistics summary(std::size_t channel) const noexcept;
+
+    const MomentAccumulator& moments(std::size_t channel) const noexcept { return moments_[channel]; }
+    const QuantileSketch& quantiles(std::size_t channel) const noexcept { return quantiles_[channel]; }
+    const RainflowCounter& rainflow(std::size_t channel) const noexcept { return rainflow_[channel]; }
+
+private:
+    std::vector<MomentAccumulator> moments_;
+    std::vector<QuantileSketch> quantiles_;
+    std::vector<RainflowCounter> rainflow_;
+};
+
+}  // namespace srm
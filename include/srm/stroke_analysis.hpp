@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/channel_block.hpp"
+#include "srm/commutation_index.hpp"
+#include "srm/strain_conversion.hpp"
+
+namespace srm {
+
+/// Random access to sample windows of a recording. Analyses built on the
+/// commutation index only ever ask for the windows around events.
+class SampleSource {
+public:
+    virtual ~SampleSource() = default;
+
+    virtual std::size_t channel_count() const noexcept = 0;
+
+    /// Copies samples [first, first + out.size()) of @p channel into @p out.
+    /// Returns false (leaving @p out unspecified) if any sample is missing.
+    virtual bool read(std::size_t channel, std::uint64_t first, std::span<float> out) const = 0;
+};
+
+/// SampleSource over an in-memory block whose sample 0 is absolute sample
+/// @p origin.
+class BlockSource final : public SampleSource {
+public:
+    explicit BlockSource(ChannelBlock<const float> block, std::uint64_t origin = 0) noexcept
+        : block_(block), origin_(origin) {}
+
+    std::size_t channel_count() const noexcept override { return block_.channels(); }
+    bool read(std::size_t channel, std::uint64_t first, std::span<float> out) const override;
+
+private:
+    ChannelBlock<const float> block_;
+    std::uint64_t origin_;
+};
+
+/// SampleSource over a mapped capture file. Channels are delivered as raw
+/// counts unless a strain conversion has been set for them. Raw chunks are
+/// read in place; compressed chunks are decoded one chunk-channel at a time
+/// into a cache, so a source must not be shared between threads.
+class CaptureSource final : public SampleSource {
+public:
+    explicit CaptureSource(const CaptureReader& reader);
+
+    void set_strain_conversion(std::size_t channel, const ConversionParams& params);
+
+    std::size_t channel_count() const noexcept override { return reader_.channel_count(); }
+    bool read(std::size_t channel, std::uint64_t first, std::span<float> out) const override;
+
+private:
+    std::span<const std::int16_t> counts(std::size_t chunk, std::size_t channel) const;
+
+    const CaptureReader& reader_;
+    std::vector<ConversionParams> params_;
+    std::vector<bool> convert_;
+    mutable std::vector<std::int16_t> decoded_;
+    mutable std::size_t decoded_chunk_ = SIZE_MAX;
+    mutable std::size_t decoded_channel_ = SIZE_MAX;
+};
+
+/// Window placed around each commutation edge: samples
+/// [edge - pre_samples, edge - pre_samples + length).
+struct StrokeWindow {
+    std::uint64_t pre_samples = 0;
+    std::size_t length = 0;
+};
+
+struct StrokeProfile {
+    std::pmr::vector<float> mean;    ///< length samples
+    std::pmr::vector<float> stddev;  ///< length samples
+    std::size_t strokes = 0;         ///< windows that contributed
+};
+
+/// Ensemble average of @p channel over every edge of (phase, kind) with
+/// first_sample <= edge < end_sample. Windows the source cannot fully
+/// provide are skipped. Result and scratch storage come from @p memory.
+StrokeProfile average_stroke_profile(
+    const CommutationIndex& index, std::size_t phase, EdgeKind kind, const SampleSource& source,
+    std::size_t channel, const StrokeWindow& window, std::uint64_t first_sample = 0,
+    std::uint64_t end_sample = UINT64_MAX,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+struct StrokeCorrelation {
+    std::pmr::vector<float> coefficient;  ///< lags -max_lag..+max_lag, Pearson r
+    std::ptrdiff_t max_lag = 0;
+    std::size_t strokes = 0;
+
+    /// Lag (in samples, strain relative to current) of the largest |r|.
+    std::ptrdiff_t peak_lag() const noexcept;
+};
+
+/// Per-stroke normalised cross-correlation between a phase-current channel
+/// and a strain channel over the window around every edge, averaged over
+/// strokes. A positive lag means the strain follows the current. Result and
+/// scratch storage come from @p memory.
+StrokeCorrelation stroke_cross_correlation(
+    const CommutationIndex& index, std::size_t phase, EdgeKind kind, const SampleSource& source,
+    std::size_t current_channel, std::size_t strain_channel, const StrokeWindow& window,
+    std::size_t max_lag, std::uint64_t first_sample = 0, std::uint64_t end_sample = UINT64_MAX,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+}  // namespace srm
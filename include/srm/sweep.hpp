@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "srm/executor.hpp"
+#include "srm/thread_pool.hpp"
+
+namespace srm {
+
+/// One point of an operating-point sweep: dynamometer speed plus the
+/// converter setpoints of the drive under test.
+struct OperatingPoint {
+    double speed_rpm = 0.0;
+    double current_a = 0.0;     ///< phase current reference
+    double turn_on_deg = 0.0;   ///< electrical degrees
+    double turn_off_deg = 0.0;
+};
+
+// ---- Instruments ----
+//
+// Each call is a coroutine on the sweep's Executor: an implementation
+// writes its request, then co_awaits readable() on the link (or
+// sleep_for() for an instrument without one) instead of blocking.
+
+class MotorDrive {
+public:
+    virtual ~MotorDrive() = default;
+    virtual Task<> apply(const OperatingPoint& point) = 0;
+};
+
+class Dynamometer {
+public:
+    virtual ~Dynamometer() = default;
+    virtual Task<> set_speed(double rpm) = 0;
+    virtual Task<double> speed_rpm() = 0;
+};
+
+class TemperatureLogger {
+public:
+    virtual ~TemperatureLogger() = default;
+    /// The reading settling decisions go by (hottest winding, say).
+    virtual Task<double> read_celsius() = 0;
+};
+
+class DaqRecorder {
+public:
+    virtual ~DaqRecorder() = default;
+    /// Records point @p index of the sweep and returns the capture file.
+    virtual Task<std::filesystem::path> capture(const OperatingPoint& point, std::size_t index) = 0;
+};
+
+struct SweepRig {
+    MotorDrive& drive;
+    Dynamometer& dynamometer;
+    TemperatureLogger& temperature;
+    DaqRecorder& daq;
+};
+
+// ---- Settling ----
+
+/// A reading is settled once every sample over the last @c window lies
+/// within @c band of each other (peak to peak) and, when a target is
+/// given, within @c tolerance of it.
+struct SettlingCriterion {
+    std::chrono::nanoseconds poll_interval = std::chrono::milliseconds(100);
+    std::chrono::nanoseconds window = std::chrono::seconds(5);
+    double band = std::numeric_limits<double>::infinity();
+    double tolerance = std::numeric_limits<double>::infinity();
+    std::chrono::nanoseconds timeout = std::chrono::minutes(10);
+};
+
+struct SettlingResult {
+    bool settled = false;                ///< false: timed out
+    double value = 0.0;                  ///< last reading
+    std::chrono::nanoseconds elapsed{};
+    std::size_t readings = 0;
+};
+
+/// Evaluates readings against a SettlingCriterion. Separate from the
+/// coroutine so the decision can be tested on recorded data.
+class SettlingDetector {
+public:
+    using Clock = Executor::Clock;
+
+    /// @p target is NaN when only the band applies. Throws
+    /// std::invalid_argument for a non-positive window or poll interval.
+    explicit SettlingDetector(const SettlingCriterion& criterion,
+                              double target = std::numeric_limits<double>::quiet_NaN());
+
+    /// Adds a reading taken at @p time (non-decreasing) and returns whether
+    /// the value is settled as of it.
+    bool add(Clock::time_point time, double value);
+
+    std::size_t readings() const noexcept { return readings_; }
+
+private:
+    struct Reading {
+        Clock::time_point time;
+        double value;
+    };
+
+    SettlingCriterion criterion_;
+    double target_;
+    std::deque<Reading> window_;  // oldest at or before time - window
+    std::size_t readings_ = 0;
+};
+
+/// Polls @p read (a callable returning Task<double>) every poll_interval
+/// until the criterion holds or the timeout passes.
+template <typename Read>
+Task<SettlingResult> settle(Executor& executor, Read read, SettlingCriterion criterion,
+                            double target = std::numeric_limits<double>::quiet_NaN()) {
+    SettlingDetector detector(criterion, target);
+    const Executor::Clock::time_point start = Executor::Clock::now();
+    SettlingResult result;
+    for (;;) {
+        result.value = co_await read();
+        const Executor::Clock::time_point now = Executor::Clock::now();
+        result.settled = detector.add(now, result.value);
+        result.elapsed = now - start;
+        result.readings = detector.readings();
+        if (result.settled || result.elapsed >= criterion.timeout) {
+            co_return result;
+        }
+        co_await executor.sleep_for(criterion.poll_interval);
+    }
+}
+
+// ---- Sweep ----
+
+enum class UnsettledPolicy : std::uint8_t {
+    Skip,     ///< record the point as not captured and move on
+    Capture,  ///< capture anyway (the result row says it did not settle)
+    Abort,    ///< throw std::runtime_error
+};
+
+struct SweepOptions {
+    SettlingCriterion speed;    ///< tolerance is in rpm around the point's speed
+    SettlingCriterion thermal;  ///< band is in kelvin over the window, no target
+    UnsettledPolicy unsettled = UnsettledPolicy::Skip;
+    /// Analyses still running when the next capture finishes; beyond this
+    /// the sweep waits for the oldest before starting another.
+    std::size_t max_pending_analyses = 2;
+};
+
+template <typename Result>
+struct SweepPointResult {
+    OperatingPoint point;
+    SettlingResult speed;
+    SettlingResult thermal;
+    bool captured = false;
+    std::filesystem::path capture;
+    Result result{};
+    std::string error;  ///< analysis failure; empty on success
+
+    bool ok() const noexcept { return captured && error.empty(); }
+};
+
+namespace detail {
+
+std::string describe_error(const std::exception_ptr& error);
+
+template <typename Result>
+struct SweepAnalysis {
+    Result result{};
+    std::string error;
+};
+
+}  // namespace detail
+
+/// Steps @p rig through @p points: apply the converter setpoints, set and
+/// settle the speed, settle thermally, capture, then hand
+/// analyse(const OperatingPoint&, const std::filesystem::path&) to @p pool
+/// and go straight on to the next point. Analysis of point N therefore
+/// runs while point N+1 settles and records, and the sweep's wall-clock
+/// time approaches that of the instrument steps alone.
+///
+/// Rows come back in sweep order. An analysis that throws has its error
+/// in its row; an instrument that throws ends the sweep (after the
+/// analyses already started have finished) with that exception. @p points
+/// must stay alive until the task completes.
+template <typename Analyse,
+          typename Result = std::invoke_result_t<Analyse&, const OperatingPoint&, const std::filesystem::path&>>
+Task<std::vector<SweepPointResult<Result>>> run_sweep(Executor& executor, WorkStealingPool& pool, SweepRig rig,
+                                                      std::span<const OperatingPoint> points, Analyse analyse,
+                                                      SweepOptions options = {}) {
+    std::vector<SweepPointResult<Result>> rows(points.size());
+    struct Pending {
+        std::size_t index;
+        PoolJob<detail::SweepAnalysis<Result>> job;
+    };
+    std::deque<Pending> pending;
+    const auto collect = [&](Pending& p) -> Task<> {
+        detail::SweepAnalysis<Result> done = co_await p.job;
+        rows[p.index].result = std::move(done.result);
+        rows[p.index].error = std::move(done.error);
+    };
+
+    std::exception_ptr failure;
+    try {
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            SweepPointResult<Result>& row = rows[i];
+            row.point = points[i];
+            co_await rig.drive.apply(row.point);
+            co_await rig.dynamometer.set_speed(row.point.speed_rpm);
+            row.speed = co_await settle(
+                executor, [&] { return rig.dynamometer.speed_rpm(); }, options.speed, row.point.speed_rpm);
+            if (row.speed.settled) {
+                row.thermal = co_await settle(
+                    executor, [&] { return rig.temperature.read_celsius(); }, options.thermal);
+            }
+            if (!row.speed.settled || !row.thermal.settled) {
+                if (options.unsettled == UnsettledPolicy::Abort) {
+                    throw std::runtime_error("sweep: point " + std::to_string(i) + " did not settle");
+                }
+                if (options.unsettled == UnsettledPolicy::Skip) {
+                    continue;
+                }
+            }
+            row.capture = co_await rig.daq.capture(row.point, i);
+            row.captured = true;
+
+            while (!pending.empty() && pending.size() >= std::max<std::size_t>(options.max_pending_analyses, 1)) {
+                co_await collect(pending.front());
+                pending.pop_front();
+            }
+            pending.push_back({i, executor.offload(pool, [&analyse, point = row.point, path = row.capture] {
+                                   detail::SweepAnalysis<Result> out;
+                                   try {
+                                       out.result = analyse(point, path);
+                                   } catch (...) {
+                                       out.error = detail::describe_error(std::current_exception());
+                                   }
+                                   return out;
+                               })});
+        }
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    // The jobs reference analyse, so none may outlive this frame.
+    while (!pending.empty()) {
+        co_await collect(pending.front());
+        pending.pop_front();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    co_return rows;
+}
+
+}  // namespace srm
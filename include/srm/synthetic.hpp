@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "srm/channel_block.hpp"
+#include "srm/strain_conversion.hpp"
+
+namespace srm {
+
+/// Parameters of a synthetic SRM test-stand recording.
+struct SyntheticSrmConfig {
+    double sample_rate_hz = 1e6;
+    double speed_rpm = 3000.0;
+    double accel_rpm_per_s = 0.0;      ///< constant speed ramp
+    unsigned rotor_poles = 6;          ///< 8/6 machine
+    unsigned phases = 4;
+    std::size_t strain_channels = 8;   ///< gauges spread evenly around the yoke
+
+    /// Radial-force strain at multiples of the stroke frequency
+    /// (phases x rotor_poles x shaft frequency), in microstrain.
+    std::vector<double> harmonic_ue = {40.0, 18.0, 8.0, 3.0};
+    double pwm_frequency_hz = 20e3;    ///< converter switching ripple
+    double pwm_ue = 4.0;
+    double noise_ue = 0.5;             ///< approximately Gaussian, RMS
+
+    double phase_current_amps = 12.0;
+    double conduction_fraction = 0.4;  ///< of each phase's electrical cycle
+    double current_rise_fraction = 0.05;
+
+    double encoder_counts_per_rev = 4096.0;
+    std::uint64_t seed = 0x5eed;
+};
+
+/// Deterministic generator of strain, rotor position and phase-current
+/// signals with commutation harmonics, PWM ripple and noise. Consecutive
+/// calls continue the same recording. Shared by the benchmarks and the
+/// regression tests so both exercise realistic spectra.
+class SyntheticSrm {
+public:
+    explicit SyntheticSrm(const SyntheticSrmConfig& config);
+
+    const SyntheticSrmConfig& config() const noexcept { return config_; }
+    std::uint64_t samples_generated() const noexcept { return sample_; }
+
+    /// Fills the next strain.samples() samples. @p strain_ue needs
+    /// strain_channels channels; @p position (encoder counts, wrapping) and
+    /// @p phase_currents (phases channels) may be empty to skip them.
+    void generate(ChannelBlock<float> strain_ue, std::span<float> position,
+                  ChannelBlock<float> phase_currents);
+
+    /// Strain as raw ADC counts through the inverse of @p params (one entry
+    /// per channel), rounded and saturated to int16.
+    void generate_counts(std::span<const ConversionParams> params,
+                         ChannelBlock<std::int16_t> counts);
+
+private:
+    double gaussian() noexcept;
+
+    SyntheticSrmConfig config_;
+    std::uint64_t sample_ = 0;
+    double revolutions_ = 0.0;
+    std::uint64_t rng_;
+    std::vector<float> scratch_;
+};
+
+}  // namespace srm
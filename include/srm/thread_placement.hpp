@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace srm {
+
+/// The threads of a live run that compete for cores and memory bandwidth.
+enum class PipelineStage : std::uint8_t {
+    Acquisition,  ///< DmaAcquisition::next() loop; the DAQ interrupt's consumer
+    Watchdog,     ///< StrainWatchdog
+    Processing,   ///< conversion, filtering, spectra (thread pool workers)
+    Writer,       ///< AsyncCaptureWriter
+    Network,      ///< StreamServer
+};
+inline constexpr std::size_t kPipelineStages = 5;
+
+std::string_view to_string(PipelineStage stage) noexcept;
+
+/// Parses a kernel cpu list ("0-3,8,10-11", as in sysfs and cpusets) into
+/// ascending cpu numbers without duplicates. Throws std::invalid_argument
+/// for a malformed list.
+std::vector<int> parse_cpu_list(std::string_view text);
+/// The inverse of parse_cpu_list(); ranges are collapsed.
+std::string format_cpu_list(std::span<const int> cpus);
+
+/// Online cpus with their NUMA node, socket and physical core, read from
+/// sysfs.
+class CpuTopology {
+public:
+    struct Cpu {
+        int id = 0;
+        int node = 0;
+        int package = 0;
+        int core = 0;  ///< SMT siblings share package and core
+    };
+
+    /// Reads @p sysfs/devices/system/{cpu,node}. A kernel without NUMA
+    /// support puts every cpu on node 0. Throws std::runtime_error if no
+    /// cpu is found.
+    static CpuTopology detect(const std::filesystem::path& sysfs = "/sys");
+
+    /// Throws std::invalid_argument for an empty or duplicated cpu set.
+    explicit CpuTopology(std::vector<Cpu> cpus);
+
+    std::span<const Cpu> cpus() const noexcept { return cpus_; }
+    int node_count() const noexcept { return nodes_; }
+    /// -1 for a cpu not in the topology.
+    int node_of(int cpu) const noexcept;
+    /// Ascending.
+    std::vector<int> cpus_of_node(int node) const;
+
+private:
+    std::vector<Cpu> cpus_;  // ascending id
+    int nodes_ = 0;
+};
+
+/// NUMA node and interrupts of a PCI device directory such as
+/// /sys/bus/pci/devices/0000:3b:00.0.
+struct DeviceLocality {
+    int node = -1;                ///< -1: firmware does not say
+    std::vector<unsigned> irqs;   ///< MSI(-X) vectors, else the legacy line
+};
+
+/// Throws std::runtime_error if @p device does not exist.
+DeviceLocality device_locality(const std::filesystem::path& device);
+
+struct PlacementConfig {
+    /// sysfs directory of the DAQ card; empty places the acquisition on
+    /// node 0 and leaves its interrupts alone.
+    std::filesystem::path daq_device;
+    /// sysfs directory of the capture disk's controller; empty keeps the
+    /// writer on the DAQ node.
+    std::filesystem::path storage_device;
+    /// Explicit cpus per stage (indexed by PipelineStage); an empty entry is
+    /// derived from the topology.
+    std::array<std::vector<int>, kPipelineStages> cpus;
+    /// Keep the first core of node 0 free for the kernel and housekeeping
+    /// when the node has at least four physical cores.
+    bool reserve_housekeeping_core = true;
+    /// Where steer_irqs() writes smp_affinity_list.
+    std::filesystem::path procfs = "/proc";
+};
+
+struct StagePlacement {
+    std::vector<int> cpus;
+    int node = -1;  ///< -1 when the cpus span nodes
+};
+
+struct IrqPlacement {
+    unsigned irq = 0;
+    std::vector<int> cpus;
+    bool applied = false;
+    std::string detail;
+};
+
+/// Topology-aware cpu and memory placement of the pipeline stages.
+///
+/// Stages without explicit cpus are laid out from the topology, one
+/// physical core each for the latency-critical threads (SMT siblings are
+/// left idle so nothing shares their core):
+///   Acquisition, Watchdog  next free cores of the DAQ card's node
+///   Writer                 next free core of the storage controller's node
+///   Processing             every remaining core of the DAQ node, with
+///                          their siblings
+///   Network                the Writer's cores (I/O stays off the
+///                          processing cores)
+/// A stage that finds no free core shares Processing's. The DAQ card's
+/// interrupts go to the Acquisition cores: the thread they wake then runs
+/// on the core that took the interrupt, on the socket the DMA wrote to.
+///
+/// Every pin and interrupt steer is recorded in Instrumentation, so the
+/// JSON snapshot shows where the run actually landed and what the kernel
+/// refused.
+class ThreadPlacement {
+public:
+    /// Throws std::invalid_argument for an explicit cpu not in
+    /// @p topology, and as device_locality() does.
+    ThreadPlacement(CpuTopology topology, const PlacementConfig& config);
+
+    const CpuTopology& topology() const noexcept { return topology_; }
+    const StagePlacement& stage(PipelineStage stage) const noexcept {
+        return stages_[static_cast<std::size_t>(stage)];
+    }
+    /// First cpu of the stage: the `cpu` option of AsyncWriterOptions and
+    /// WatchdogConfig.
+    int cpu(PipelineStage stage) const noexcept { return this->stage(stage).cpus.front(); }
+    /// The numa_node option of AcquisitionConfig and AsyncWriterOptions.
+    int node(PipelineStage stage) const noexcept { return this->stage(stage).node; }
+    std::span<const IrqPlacement> irqs() const noexcept { return irqs_; }
+
+    /// Pins the calling thread (or @p thread) to the stage's cpus and
+    /// records the outcome. Returns false if the kernel refused.
+    bool pin_current_thread(PipelineStage stage) const;
+    bool pin(PipelineStage stage, std::thread& thread) const;
+
+    /// Points every DAQ interrupt at the Acquisition cpus (needs root).
+    /// Returns how many the kernel accepted; each outcome is recorded.
+    std::size_t steer_irqs();
+
+private:
+    bool apply(PipelineStage stage, std::thread::native_handle_type thread) const;
+
+    CpuTopology topology_;
+    std::filesystem::path procfs_;
+    std::array<StagePlacement, kPipelineStages> stages_;
+    std::vector<IrqPlacement> irqs_;
+};
+
+/// Moves the whole pages of [@p data, @p data + @p bytes) to @p node and
+/// binds them there (mbind MPOL_BIND with MPOL_MF_MOVE); pages not yet
+/// touched are allocated there on first touch. Returns false if the kernel
+/// has no NUMA support or refuses; @p node < 0 is a no-op that succeeds.
+bool bind_to_node(void* data, std::size_t bytes, int node) noexcept;
+
+/// Page-granular memory on one NUMA node, for buffers that are sized once
+/// and kept (a RunArena's upstream, say). Falls back to unbound pages when
+/// the kernel cannot bind.
+class NodeMemoryResource final : public std::pmr::memory_resource {
+public:
+    explicit NodeMemoryResource(int node) noexcept : node_(node) {}
+
+    int node() const noexcept { return node_; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    int node_;
+};
+
+}  // namespace srm
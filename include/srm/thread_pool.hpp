@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace srm {
+
+/// Work-stealing thread pool for batch reprocessing.
+///
+/// Each worker owns a deque: tasks submitted from a worker go to the back of
+/// its own deque and are popped LIFO (cache-warm, depth first), idle workers
+/// steal FIFO from the front of the others (oldest, usually largest, work
+/// first). Tasks submitted from outside the pool are distributed round-robin.
+/// The per-deque locks are only contended when a steal actually happens.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    /// @p threads == 0 selects std::thread::hardware_concurrency().
+    explicit WorkStealingPool(std::size_t threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    std::size_t thread_count() const noexcept { return threads_.size(); }
+
+    void submit(Task task);
+
+    /// Runs one queued task on the calling thread if any is available.
+    /// Lets a thread that waits on pool work help instead of blocking.
+    bool try_run_one();
+
+    /// Index of the calling worker in this pool, or -1 for other threads.
+    int current_worker() const noexcept;
+
+    /// Tasks taken from another worker's deque since construction.
+    std::size_t steals() const noexcept { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(std::size_t index);
+    bool pop_local(std::size_t index, Task& task);
+    bool steal(std::size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<std::size_t> next_queue_{0};
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<std::size_t> steals_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
+
+/// Fork/join scope over a pool. Tasks may spawn more tasks into the same
+/// group; wait() returns once all of them have finished, running queued
+/// work on the calling thread meanwhile, and rethrows the first exception
+/// any task raised.
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool& pool) noexcept : pool_(pool) {}
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> fn);
+    void wait();
+
+private:
+    WorkStealingPool& pool_;
+    std::atomic<std::size_t> pending_{0};
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+    std::mutex done_mutex_;
+    std::condition_variable done_;
+};
+
+}  // namespace srm
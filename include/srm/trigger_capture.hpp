@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/channel_block.hpp"
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+enum class TriggerKind : std::uint8_t {
+    Level,         ///< a strain channel crosses a level
+    Slope,         ///< a strain channel changes faster than a rate
+    Pattern,       ///< several strain channels enter an above/below combination together
+    PhaseCurrent,  ///< a phase-current channel crosses a level (spikes, faults)
+};
+
+enum class TriggerEdge : std::uint8_t {
+    Rising,   ///< upwards in physical units (strain, amps)
+    Falling,
+    Either,
+};
+
+const char* to_string(TriggerKind kind) noexcept;
+
+/// One clause of a Pattern condition: channel above (or below) a level.
+struct PatternTerm {
+    std::size_t channel = 0;
+    double level_ue = 0.0;
+    bool above = true;
+};
+
+/// Linear scaling of a phase-current channel's raw counts.
+struct CurrentScale {
+    double amps_per_count = 1.0;
+    double zero_counts = 0.0;
+};
+
+/// A trigger condition. Levels and rates are given in microstrain (amps for
+/// PhaseCurrent) and converted to raw counts once, so the armed check is
+/// integer compares on the int16 data.
+struct TriggerCondition {
+    TriggerKind kind = TriggerKind::Level;
+    std::size_t channel = 0;            ///< Level, Slope, PhaseCurrent
+    TriggerEdge edge = TriggerEdge::Rising;
+    double level = 0.0;                 ///< Level (ue), PhaseCurrent (A)
+    double rate_ue_per_s = 0.0;         ///< Slope, magnitude; the edge gives the sign
+    CurrentScale current;               ///< PhaseCurrent
+    std::vector<PatternTerm> pattern;   ///< Pattern: fires when every term becomes true at once
+
+    static TriggerCondition level_crossing(std::size_t channel, double level_ue,
+                                           TriggerEdge edge = TriggerEdge::Rising);
+    static TriggerCondition slope(std::size_t channel, double rate_ue_per_s,
+                                  TriggerEdge edge = TriggerEdge::Either);
+    static TriggerCondition phase_current(std::size_t channel, double amps, CurrentScale scale,
+                                          TriggerEdge edge = TriggerEdge::Either);
+    static TriggerCondition all_of(std::vector<PatternTerm> terms);
+};
+
+struct TriggerConfig {
+    std::size_t pre_samples = 65536;    ///< history kept before the trigger sample
+    std::size_t post_samples = 262144;  ///< recorded from the (last) trigger sample on
+    /// A match while recording extends the window to post_samples after it;
+    /// otherwise further matches are ignored until the window closes.
+    bool retrigger = true;
+    /// Samples after a window closes during which nothing triggers (the
+    /// history still fills).
+    std::size_t holdoff_samples = 0;
+    std::size_t max_chunk_samples = 65536;  ///< longest block handed to the sink
+    std::size_t max_logged_events = 1024;   ///< event_log() capacity, reserved up front
+};
+
+/// One recorded event.
+struct TriggerEvent {
+    std::size_t condition = 0;     ///< index into the conditions that fired first
+    std::uint64_t sample = 0;      ///< trigger sample
+    std::uint64_t first_sample = 0;
+    std::uint64_t end_sample = 0;  ///< one past the last recorded sample; 0 while open
+    std::uint32_t retriggers = 0;
+};
+
+/// Sparse event capture for endurance runs: stays armed against a
+/// preallocated pre-trigger ring and passes only the samples around each
+/// event on to a capture writer.
+///
+/// process() checks every sample against the trigger conditions. While
+/// armed, samples only go into the ring (pre_samples per channel). On a
+/// match the ring's history (at most pre_samples, and never samples that
+/// an earlier event already wrote) and then the live samples up to
+/// post_samples after the trigger are handed to the sink with their
+/// acquisition sample index, as sink(ChannelBlock<const std::int16_t>,
+/// std::uint64_t first_sample). CaptureWriter::write_chunk(block,
+/// first_sample) and AsyncCaptureWriter::write_chunk() keep the gaps
+/// between events in the file, so the result is a standard capture whose
+/// chunks are the events.
+///
+/// All buffers are allocated in the constructor; process() does not touch
+/// the heap. One thread.
+class TriggeredCapture {
+public:
+    /// @p info gives the channel calibration and sample rate. Throws
+    /// std::invalid_argument for an unknown channel, an empty pattern, a
+    /// non-positive rate or scale, or a zero max_chunk_samples.
+    TriggeredCapture(const CaptureInfo& info, const TriggerConfig& config,
+                     std::span<const TriggerCondition> conditions);
+
+    std::size_t channels() const noexcept { return ring_.channels(); }
+    const TriggerConfig& config() const noexcept { return config_; }
+
+    /// Feeds the next block, whose first sample has acquisition index
+    /// @p first_sample (gaps are allowed, going backwards is not:
+    /// std::invalid_argument). Returns the number of events started in it.
+    template <typename Sink>
+    std::size_t process(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample, Sink&& sink);
+
+    /// Closes an open event at the last sample seen (end of a run).
+    void finish() noexcept;
+
+    bool recording() const noexcept { return state_ == State::Recording; }
+    std::uint64_t events() const noexcept { return events_; }
+    /// Closed events, up to the first max_logged_events of them.
+    std::span<const TriggerEvent> event_log() const noexcept { return log_; }
+
+    std::uint64_t samples_seen() const noexcept { return samples_seen_; }
+    std::uint64_t samples_written() const noexcept { return samples_written_; }
+
+    /// A level in counts: a sample is above it when sign * counts >= bound.
+    struct CountThreshold {
+        std::size_t channel;
+        std::int32_t sign;   ///< +1 when counts rise with the physical value
+        std::int32_t bound;
+    };
+    /// The count thresholds of condition @p condition (for diagnostics).
+    std::span<const CountThreshold> count_thresholds(std::size_t condition) const noexcept {
+        return conditions_[condition].terms;
+    }
+
+private:
+    enum class State : std::uint8_t { Armed, Recording, Holdoff };
+
+    struct Compiled {
+        TriggerKind kind;
+        TriggerEdge edge;
+        // Level/PhaseCurrent/Slope: one; Pattern: one per term, "below"
+        // terms already inverted so that every term must read above.
+        std::vector<CountThreshold> terms;
+        std::int32_t step;  // Slope: count step per sample
+    };
+
+    /// Validates the block and handles a gap before it.
+    void check_block(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample);
+    /// First index in [from, to) of @p block where a condition fires, or
+    /// @p to; @p fired gets the condition index.
+    std::size_t find_trigger(ChannelBlock<const std::int16_t> block, std::size_t from, std::size_t to,
+                             std::size_t& fired) const noexcept;
+    void remember(ChannelBlock<const std::int16_t> block) noexcept;
+    /// Starts an event at @p sample whose history is the ring's contents.
+    void open_event(std::size_t condition, std::uint64_t sample) noexcept;
+    void close_event(std::uint64_t end) noexcept;
+
+    template <typename Sink>
+    void emit(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample, Sink& sink);
+
+    TriggerConfig config_;
+    std::vector<Compiled> conditions_;
+
+    ChannelBuffer<std::int16_t> ring_;  // pre-trigger history, circular
+    std::size_t ring_write_ = 0;
+    std::size_t ring_count_ = 0;
+    std::vector<std::int16_t> previous_;  // last sample per channel, for edges
+    bool have_previous_ = false;
+    std::uint64_t next_sample_ = 0;
+
+    State state_ = State::Armed;
+    std::uint64_t window_end_ = 0;   // Recording: one past the last sample to write
+    std::uint64_t holdoff_end_ = 0;
+    std::uint64_t written_end_ = 0;  // one past the last sample handed to the sink
+    TriggerEvent current_;
+
+    std::uint64_t events_ = 0;
+    std::vector<TriggerEvent> log_;
+    std::uint64_t samples_seen_ = 0;
+    std::uint64_t samples_written_ = 0;
+};
+
+// ---- Implementation ---------------------------------------------------------
+
+template <typename Sink>
+void TriggeredCapture::emit(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample, Sink& sink) {
+    if (block.samples() == 0) {
+        return;
+    }
+    for (std::size_t pos = 0; pos < block.samples(); pos += config_.max_chunk_samples) {
+        const std::size_t n = std::min(config_.max_chunk_samples, block.samples() - pos);
+        sink(block.subblock(pos, n), first_sample + pos);
+    }
+    samples_written_ += block.samples();
+    written_end_ = first_sample + block.samples();
+}
+
+template <typename Sink>
+std::size_t TriggeredCapture::process(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample,
+                                      Sink&& sink) {
+    SRM_SCOPED_TIMER("trigger_block");
+    check_block(block, first_sample);
+    const std::size_t n = block.samples();
+    std::size_t started = 0;
+    std::size_t pos = 0;
+    while (pos < n) {
+        const std::uint64_t at = first_sample + pos;
+        switch (state_) {
+        case State::Armed: {
+            std::size_t fired = 0;
+            const std::size_t t = find_trigger(block, pos, n, fired);
+            remember(block.subblock(pos, t - pos));
+            pos = t;
+            if (t == n) {
+                break;
+            }
+            open_event(fired, first_sample + t);
+            ++started;
+            // The ring holds the samples right before the trigger sample.
+            if (ring_count_ != 0) {
+                const std::size_t size = ring_.samples();
+                const std::size_t begin = (ring_write_ + size - ring_count_) % size;
+                const std::size_t first_part = std::min(ring_count_, size - begin);
+                const ChannelBlock<const std::int16_t> ring = std::as_const(ring_).view();
+                emit(ring.subblock(begin, first_part), current_.first_sample, sink);
+                emit(ring.subblock(0, ring_count_ - first_part), current_.first_sample + first_part, sink);
+                ring_count_ = 0;
+            }
+            // The trigger sample itself is recorded below.
+            break;
+        }
+        case State::Recording: {
+            std::size_t end = static_cast<std::size_t>(std::min<std::uint64_t>(n, window_end_ - first_sample));
+            if (config_.retrigger) {
+                // Sample `pos` in the first step after opening is the trigger sample.
+                std::size_t from = at == current_.sample ? pos + 1 : pos;
+                while (from < end) {
+                    std::size_t fired = 0;
+                    const std::size_t t = find_trigger(block, from, end, fired);
+                    if (t == end) {
+                        break;
+                    }
+                    ++current_.retriggers;
+                    window_end_ = first_sample + t + config_.post_samples;
+                    end = static_cast<std::size_t>(std::min<std::uint64_t>(n, window_end_ - first_sample));
+                    from = t + 1;
+                }
+            }
+            emit(block.subblock(pos, end - pos), at, sink);
+            pos = end;
+            if (first_sample + pos == window_end_) {
+                close_event(window_end_);
+            }
+            break;
+        }
+        case State::Holdoff: {
+            const std::size_t end = static_cast<std::size_t>(std::min<std::uint64_t>(n, holdoff_end_ - first_sample));
+            remember(block.subblock(pos, end - pos));
+            pos = end;
+            if (first_sample + pos == holdoff_end_) {
+                state_ = State::Armed;
+            }
+            break;
+        }
+        }
+    }
+    if (n != 0) {
+        for (std::size_t c = 0; c < previous_.size(); ++c) {
+            previous_[c] = block.channel(c)[n - 1];
+        }
+        have_previous_ = true;
+    }
+    next_sample_ = first_sample + n;
+    samples_seen_ += n;
+    return started;
+}
+
+}  // namespace srm
@@ -0,0 +1,339 @@
+#include "srm/acquisition.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+#include "srm/instrumentation.hpp"
+#include "srm/thread_placement.hpp"
+
+namespace srm {
+
+struct BlockHandle::Slot {
+    DmaAcquisition* owner = nullptr;
+    std::size_t index = 0;
+    ChannelBlock<std::int16_t> buffer;
+    bool queued = false;  ///< at the card; guarded by the owner's post_mutex_
+    DmaCompletion completion;
+    std::uint64_t sequence = 0;
+    std::atomic<std::uint32_t> refs{0};
+};
+
+// ---- BlockHandle ------------------------------------------------------------
+
+BlockHandle::BlockHandle(const BlockHandle& other) noexcept : slot_(other.slot_) {
+    if (slot_ != nullptr) {
+        slot_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+BlockHandle::BlockHandle(BlockHandle&& other) noexcept : slot_(other.slot_) {
+    other.slot_ = nullptr;
+}
+
+BlockHandle& BlockHandle::operator=(const BlockHandle& other) noexcept {
+    if (this != &other) {
+        BlockHandle copy(other);
+        std::swap(slot_, copy.slot_);
+    }
+    return *this;
+}
+
+BlockHandle& BlockHandle::operator=(BlockHandle&& other) noexcept {
+    if (this != &other) {
+        reset();
+        slot_ = other.slot_;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+void BlockHandle::reset() noexcept {
+    Slot* slot = slot_;
+    slot_ = nullptr;
+    // acq_rel: every consumer's reads of the buffer happen before the card
+    // is allowed to overwrite it.
+    if (slot != nullptr && slot->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        slot->owner->release(slot);
+    }
+}
+
+ChannelBlock<const std::int16_t> BlockHandle::block() const noexcept {
+    return slot_ != nullptr ? ChannelBlock<const std::int16_t>(slot_->buffer)
+                            : ChannelBlock<const std::int16_t>();
+}
+
+std::uint64_t BlockHandle::first_sample() const noexcept {
+    return slot_ != nullptr ? slot_->completion.first_sample : 0;
+}
+
+std::uint64_t BlockHandle::timestamp_ns() const noexcept {
+    return slot_ != nullptr ? slot_->completion.timestamp_ns : 0;
+}
+
+std::uint64_t BlockHandle::sequence() const noexcept {
+    return slot_ != nullptr ? slot_->sequence : 0;
+}
+
+bool BlockHandle::overrun() const noexcept {
+    return slot_ != nullptr && slot_->completion.overrun;
+}
+
+void BlockHandle::copy_to(ChannelBlock<std::int16_t> out) const {
+    const ChannelBlock<const std::int16_t> in = block();
+    if (out.channels() != in.channels() || out.samples() != in.samples()) {
+        throw std::invalid_argument("acquisition: copy_to shape mismatch");
+    }
+    for (std::size_t c = 0; c < in.channels(); ++c) {
+        std::memcpy(out.channel(c).data(), in.channel(c).data(), in.samples() * sizeof(std::int16_t));
+    }
+}
+
+// ---- DmaAcquisition ---------------------------------------------------------
+
+DmaAcquisition::DmaAcquisition(std::unique_ptr<DmaDriver> driver, const AcquisitionConfig& config)
+    : driver_(std::move(driver)), config_(config) {
+    if (!driver_) {
+        throw std::invalid_argument("acquisition: driver is null");
+    }
+    if (config.buffer_count < 2 || config.channels == 0 || config.samples_per_block == 0) {
+        throw std::invalid_argument("acquisition: need at least two non-empty buffers");
+    }
+    stride_ = padded_count<std::int16_t>(config.samples_per_block);
+    storage_.resize(config.buffer_count);
+    slots_.reserve(config.buffer_count);
+    locked_ = config.lock_memory;
+    for (std::size_t i = 0; i < config.buffer_count; ++i) {
+        Storage& s = storage_[i];
+        s.resize(config.channels * stride_);
+        bind_to_node(s.data(), s.size() * sizeof(std::int16_t), config.numa_node);
+        if (locked_ && ::mlock(s.data(), s.size() * sizeof(std::int16_t)) != 0) {
+            locked_ = false;
+        }
+        auto slot = std::make_unique<BlockHandle::Slot>();
+        slot->owner = this;
+        slot->index = i;
+        slot->buffer = buffer(i);
+        slots_.push_back(std::move(slot));
+    }
+}
+
+DmaAcquisition::~DmaAcquisition() {
+    stop();
+    if (locked_) {
+        for (Storage& s : storage_) {
+            ::munlock(s.data(), s.size() * sizeof(std::int16_t));
+        }
+    }
+}
+
+ChannelBlock<std::int16_t> DmaAcquisition::buffer(std::size_t index) noexcept {
+    return {storage_[index].data(), config_.channels, config_.samples_per_block, stride_};
+}
+
+void DmaAcquisition::start() {
+    {
+        const std::lock_guard lock(post_mutex_);
+        if (running_) {
+            return;
+        }
+        // Buffers still held by consumers are posted when they come back.
+        for (const auto& slot : slots_) {
+            if (!slot->queued && slot->refs.load(std::memory_order_acquire) == 0) {
+                driver_->post(slot->index, slot->buffer);
+                slot->queued = true;
+            }
+        }
+        running_ = true;
+    }
+    driver_->start();
+}
+
+void DmaAcquisition::stop() {
+    {
+        const std::lock_guard lock(post_mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    // The driver discards posted buffers and undelivered completions.
+    driver_->stop();
+    const std::lock_guard lock(post_mutex_);
+    for (const auto& slot : slots_) {
+        slot->queued = false;
+    }
+}
+
+BlockHandle DmaAcquisition::next(std::chrono::nanoseconds timeout) {
+    DmaCompletion completion;
+    if (!driver_->wait(completion, timeout)) {
+        return {};
+    }
+    if (completion.buffer >= slots_.size()) {
+        throw std::runtime_error("acquisition: driver completed an unknown buffer");
+    }
+    BlockHandle::Slot* slot = slots_[completion.buffer].get();
+    {
+        const std::lock_guard lock(post_mutex_);
+        slot->queued = false;
+    }
+    slot->completion = completion;
+    slot->sequence = sequence_++;
+    if (completion.overrun) {
+        ++overruns_;
+        SRM_COUNT("acquisition_overruns", 1);
+    }
+    slot->refs.store(1, std::memory_order_relaxed);
+    const std::size_t in_use = in_use_.fetch_add(1, std::memory_order_relaxed) + 1;
+    SRM_HIGH_WATER("acquisition_buffers_in_use", in_use);
+    return BlockHandle(slot);
+}
+
+void DmaAcquisition::release(BlockHandle::Slot* slot) noexcept {
+    in_use_.fetch_sub(1, std::memory_order_relaxed);
+    const std::lock_guard lock(post_mutex_);
+    if (running_ && !slot->queued) {
+        driver_->post(slot->index, slot->buffer);
+        slot->queued = true;
+    }
+}
+
+// ---- SimulatedDmaDriver -----------------------------------------------------
+
+SimulatedDmaDriver::SimulatedDmaDriver(Options options)
+    : options_(std::move(options)), signal_(options_.signal) {
+    if (options_.info.channels.size() != options_.signal.strain_channels) {
+        throw std::invalid_argument("acquisition: calibration and signal channel counts differ");
+    }
+    for (const ChannelInfo& ch : options_.info.channels) {
+        params_.push_back(make_conversion_params(ch));
+    }
+}
+
+SimulatedDmaDriver::~SimulatedDmaDriver() { stop(); }
+
+void SimulatedDmaDriver::post(std::size_t index, ChannelBlock<std::int16_t> buffer) {
+    if (buffer.channels() != params_.size()) {
+        throw std::invalid_argument("acquisition: buffer channel count mismatch");
+    }
+    {
+        const std::lock_guard lock(mutex_);
+        posted_.push_back({index, buffer});
+    }
+    posted_cv_.notify_one();
+}
+
+void SimulatedDmaDriver::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    stop_ = false;
+    thread_ = std::thread([this] { run(); });
+}
+
+void SimulatedDmaDriver::stop() {
+    {
+        const std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    posted_cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    const std::lock_guard lock(mutex_);
+    posted_.clear();
+    done_.clear();
+}
+
+bool SimulatedDmaDriver::wait(DmaCompletion& completion, std::chrono::nanoseconds timeout) {
+    std::unique_lock lock(mutex_);
+    if (!done_cv_.wait_for(lock, timeout, [&] { return !done_.empty(); })) {
+        return false;
+    }
+    completion = done_.front();
+    done_.pop_front();
+    return true;
+}
+
+void SimulatedDmaDriver::run() {
+    using clock = std::chrono::steady_clock;
+    const double rate = options_.signal.sample_rate_hz;
+    const auto at_sample = [rate](std::uint64_t sample) {
+        return std::chrono::nanoseconds(
+            static_cast<std::int64_t>(static_cast<double>(sample) * 1e9 / rate));
+    };
+
+    std::size_t block_samples = 0;
+    {
+        // The block length is only known once the first buffer arrives.
+        std::unique_lock lock(mutex_);
+        posted_cv_.wait(lock, [&] { return stop_ || !posted_.empty(); });
+        if (stop_) {
+            return;
+        }
+        block_samples = posted_.front().buffer.samples();
+    }
+    // Samples are synthesised ahead of their due time and "DMA'd" into the
+    // posted buffer when the block completes, so the (slow) signal model
+    // does not show up as acquisition latency.
+    ChannelBuffer<std::int16_t> staging(params_.size(), block_samples);
+
+    const clock::time_point t0 = clock::now();
+    const auto epoch_ns = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count());
+    std::uint64_t sample = 0;
+    bool overrun = false;
+    for (;;) {
+        signal_.generate_counts(params_, staging.view());
+
+        Posted target{};
+        bool have = false;
+        {
+            std::unique_lock lock(mutex_);
+            if (options_.real_time) {
+                // The card finishes a block once its last sample is converted.
+                if (posted_cv_.wait_until(lock, t0 + at_sample(sample + block_samples),
+                                          [&] { return stop_; })) {
+                    return;
+                }
+            } else {
+                posted_cv_.wait(lock, [&] { return stop_ || !posted_.empty(); });
+            }
+            if (stop_) {
+                return;
+            }
+            if (!posted_.empty()) {
+                target = posted_.front();
+                posted_.pop_front();
+                have = true;
+            }
+        }
+
+        if (!have) {
+            // No free buffer at the card: the block's samples are lost, but
+            // the signal (and the sample counter) keeps running.
+            dropped_.fetch_add(block_samples, std::memory_order_relaxed);
+            SRM_COUNT("acquisition_dropped_samples", block_samples);
+            sample += block_samples;
+            overrun = true;
+            continue;
+        }
+
+        for (std::size_t c = 0; c < params_.size(); ++c) {
+            std::memcpy(target.buffer.channel(c).data(), staging.channel(c).data(),
+                        block_samples * sizeof(std::int16_t));
+        }
+        {
+            const std::lock_guard lock(mutex_);
+            done_.push_back({target.index, sample,
+                             epoch_ns + static_cast<std::uint64_t>(at_sample(sample).count()),
+                             overrun});
+        }
+        done_cv_.notify_one();
+        sample += block_samples;
+        overrun = false;
+    }
+}
+
+}  // namespace srm
@@ -0,0 +1,119 @@
+#include "srm/angle_resampler.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+AngleResampler::AngleResampler(const AngleResamplerConfig& config, std::size_t channels)
+    : config_(config), prev_values_(channels, 0.0f) {
+    if (!(config.counts_per_revolution > 0.0) || config.cycles_per_revolution == 0 ||
+        config.points_per_cycle == 0) {
+        throw std::invalid_argument("angle resampler: invalid grid configuration");
+    }
+    if (channels == 0) {
+        throw std::invalid_argument("angle resampler: no channels");
+    }
+    grid_per_count_ = static_cast<double>(config.cycles_per_revolution) *
+                      config.points_per_cycle / config.counts_per_revolution;
+    half_revolution_ = config.counts_per_revolution / 2.0;
+}
+
+void AngleResampler::reset() noexcept { primed_ = false; }
+
+// Unwraps the position and walks the grid; process() and locate() differ
+// only in what happens at the anchor sample, at each grid point and after
+// each sample.
+template <typename Prime, typename Point, typename Advance>
+AngleResampler::Result AngleResampler::track(std::span<const float> position, std::size_t capacity,
+                                             Prime&& prime, Point&& point, Advance&& advance) {
+    std::size_t i = 0;
+    std::size_t produced = 0;
+
+    if (!primed_ && !position.empty()) {
+        prev_position_ = position[0];
+        unwrapped_counts_ = position[0];
+        prev_grid_ = unwrapped_counts_ * grid_per_count_;
+        // The first grid point strictly after the anchor sample; it is
+        // interpolated once the next sample arrives.
+        next_grid_ = static_cast<std::int64_t>(std::floor(prev_grid_)) + 1;
+        prime();
+        primed_ = true;
+        i = 1;
+    }
+
+    for (; i < position.size(); ++i) {
+        double delta = static_cast<double>(position[i]) - prev_position_;
+        if (delta < -half_revolution_) {
+            delta += config_.counts_per_revolution;
+        } else if (delta > half_revolution_) {
+            delta -= config_.counts_per_revolution;
+        }
+        const double grid = (unwrapped_counts_ + delta) * grid_per_count_;
+
+        if (grid > prev_grid_) {
+            const double inv_span = 1.0 / (grid - prev_grid_);
+            while (static_cast<double>(next_grid_) <= grid) {
+                if (produced == capacity) {
+                    return {i, produced};
+                }
+                const float t =
+                    static_cast<float>((static_cast<double>(next_grid_) - prev_grid_) * inv_span);
+                point(i, t, produced);
+                ++produced;
+                ++next_grid_;
+            }
+        }
+
+        prev_position_ = position[i];
+        unwrapped_counts_ += delta;
+        prev_grid_ = grid;
+        advance(i);
+    }
+    return {position.size(), produced};
+}
+
+AngleResampler::Result AngleResampler::process(std::span<const float> position,
+                                               ChannelBlock<const float> strain,
+                                               ChannelBlock<float> out) {
+    SRM_SCOPED_TIMER("resample");
+    const std::size_t channels = prev_values_.size();
+    if (strain.channels() != channels || out.channels() != channels) {
+        throw std::invalid_argument("angle resampler: channel count mismatch");
+    }
+    if (strain.samples() != position.size()) {
+        throw std::invalid_argument("angle resampler: position/strain length mismatch");
+    }
+    return track(
+        position, out.samples(),
+        [&] {
+            for (std::size_t c = 0; c < channels; ++c) {
+                prev_values_[c] = strain.channel(c)[0];
+            }
+        },
+        [&](std::size_t i, float t, std::size_t k) {
+            for (std::size_t c = 0; c < channels; ++c) {
+                const float a = prev_values_[c];
+                out.channel(c)[k] = a + t * (strain.channel(c)[i] - a);
+            }
+        },
+        [&](std::size_t i) {
+            for (std::size_t c = 0; c < channels; ++c) {
+                prev_values_[c] = strain.channel(c)[i];
+            }
+        });
+}
+
+AngleResampler::Result AngleResampler::locate(std::span<const float> position,
+                                              std::span<GridCrossing> out) {
+    return track(
+        position, out.size(), [] {},
+        [&](std::size_t i, float t, std::size_t k) {
+            out[k] = GridCrossing{static_cast<std::uint32_t>(i), t};
+        },
+        [](std::size_t) {});
+}
+
+}  // namespace srm
@@ -0,0 +1,97 @@
+#include "srm/arena.hpp"
+
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+
+namespace srm {
+
+namespace {
+
+std::size_t align_up(std::size_t value, std::size_t alignment) noexcept {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+RunArena::RunArena(std::size_t block_size, std::pmr::memory_resource* upstream)
+    : upstream_(upstream), block_size_(block_size) {
+    if (block_size <= kHeaderSize || upstream == nullptr) {
+        throw std::invalid_argument("arena: block size too small or no upstream resource");
+    }
+}
+
+RunArena::~RunArena() { release(); }
+
+void RunArena::reset() noexcept {
+    current_ = head_;
+    offset_ = kHeaderSize;
+    used_before_ = 0;
+}
+
+void RunArena::release() noexcept {
+    Block* block = head_;
+    while (block != nullptr) {
+        Block* next = block->next;
+        upstream_->deallocate(block, block->size, alignof(std::max_align_t));
+        block = next;
+    }
+    head_ = tail_ = current_ = nullptr;
+    reserved_ = 0;
+    reset();
+}
+
+RunArena::Block* RunArena::new_block(std::size_t min_payload, std::size_t alignment) {
+    std::size_t size = block_size_;
+    const std::size_t needed = kHeaderSize + min_payload + alignment;
+    if (needed > size) {
+        size = needed;
+    }
+    auto* block = static_cast<Block*>(upstream_->allocate(size, alignof(std::max_align_t)));
+    block->next = nullptr;
+    block->size = size;
+    if (tail_ != nullptr) {
+        tail_->next = block;
+    } else {
+        head_ = block;
+    }
+    tail_ = block;
+    reserved_ += size;
+    ++upstream_allocations_;
+    return block;
+}
+
+void* RunArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    if (current_ != nullptr) {
+        const auto base = reinterpret_cast<std::uintptr_t>(current_);
+        const std::size_t start = align_up(base + offset_, alignment) - base;
+        if (start + bytes <= current_->size) {
+            offset_ = start + bytes;
+            return reinterpret_cast<void*>(base + start);
+        }
+    }
+
+    // Move on to the next retained block that fits, or grow the chain.
+    Block* block = current_ != nullptr ? current_->next : head_;
+    std::size_t used = current_ != nullptr ? used_before_ + offset_ - kHeaderSize : 0;
+    while (block != nullptr) {
+        const auto base = reinterpret_cast<std::uintptr_t>(block);
+        const std::size_t start = align_up(base + kHeaderSize, alignment) - base;
+        if (start + bytes <= block->size) {
+            break;
+        }
+        block = block->next;
+    }
+    if (block == nullptr) {
+        block = new_block(bytes, alignment);
+    }
+
+    used_before_ = used;
+    current_ = block;
+    const auto base = reinterpret_cast<std::uintptr_t>(block);
+    const std::size_t start = align_up(base + kHeaderSize, alignment) - base;
+    offset_ = start + bytes;
+    return reinterpret_cast<void*>(base + start);
+}
+
+}  // namespace srm
@@ -0,0 +1,574 @@
+#include "srm/async_capture_writer.hpp"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include "srm/delta_rice.hpp"
+#include "srm/instrumentation.hpp"
+#include "srm/thread_placement.hpp"
+
+namespace srm {
+
+namespace {
+
+constexpr std::size_t kDirectIoAlignment = 4096;
+
+[[noreturn]] void throw_errno(int err, const std::string& what) {
+    throw std::system_error(err, std::generic_category(), what);
+}
+
+std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/// pwrite() until done; the fallback backend and the short-write path.
+void pwrite_all(int fd, const std::byte* data, std::size_t size, std::uint64_t offset) {
+    while (size > 0) {
+        const ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_errno(errno, "capture: write failed");
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        offset += static_cast<std::uint64_t>(n);
+    }
+}
+
+/// Minimal io_uring over the raw syscalls (no liburing dependency): one
+/// submission per write, completions reaped on demand.
+class IoUring {
+public:
+    static std::unique_ptr<IoUring> create(unsigned entries) {
+        io_uring_params params{};
+        const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return nullptr;  // ENOSYS, EPERM (disabled by sysctl/seccomp), ...
+        }
+        auto ring = std::unique_ptr<IoUring>(new IoUring(fd, params));
+        if (!ring->map()) {
+            return nullptr;
+        }
+        return ring;
+    }
+
+    ~IoUring() {
+        if (sqes_ != nullptr) {
+            ::munmap(sqes_, sqes_bytes_);
+        }
+        if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+            ::munmap(cq_ring_, cq_ring_bytes_);
+        }
+        if (sq_ring_ != nullptr) {
+            ::munmap(sq_ring_, sq_ring_bytes_);
+        }
+        ::close(fd_);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /// Queues a writev of @p iov at @p offset and submits it.
+    void write(int file, const iovec* iov, std::uint64_t offset, std::uint64_t user_data) {
+        const unsigned tail = *sq_tail_;
+        const unsigned index = tail & *sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITEV;  // 5.1+, unlike IORING_OP_WRITE
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<std::uint64_t>(iov);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array_[index] = index;
+        std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+        for (;;) {
+            const long r = ::syscall(__NR_io_uring_enter, fd_, 1u, 0u, 0u, nullptr, 0);
+            if (r >= 0) {
+                return;
+            }
+            if (errno != EINTR) {
+                throw_errno(errno, "capture: io_uring submit failed");
+            }
+        }
+    }
+
+    /// Blocks for the next completion.
+    io_uring_cqe wait() {
+        for (;;) {
+            const unsigned head = *cq_head_;
+            if (head != std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire)) {
+                const io_uring_cqe cqe = cqes_[head & *cq_mask_];
+                std::atomic_ref<unsigned>(*cq_head_).store(head + 1, std::memory_order_release);
+                return cqe;
+            }
+            const long r = ::syscall(__NR_io_uring_enter, fd_, 0u, 1u, IORING_ENTER_GETEVENTS,
+                                     nullptr, 0);
+            if (r < 0 && errno != EINTR) {
+                throw_errno(errno, "capture: io_uring wait failed");
+            }
+        }
+    }
+
+private:
+    IoUring(int fd, const io_uring_params& params) : fd_(fd), params_(params) {}
+
+    bool map() {
+        sq_ring_bytes_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+        cq_ring_bytes_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params_.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_ring_bytes_ = cq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+        }
+        void* sq = ::mmap(nullptr, sq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd_, IORING_OFF_SQ_RING);
+        if (sq == MAP_FAILED) {
+            return false;
+        }
+        sq_ring_ = static_cast<char*>(sq);
+        if (single) {
+            cq_ring_ = sq_ring_;
+        } else {
+            void* cq = ::mmap(nullptr, cq_ring_bytes_, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+            if (cq == MAP_FAILED) {
+                return false;
+            }
+            cq_ring_ = static_cast<char*>(cq);
+        }
+        sqes_bytes_ = params_.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        sq_tail_ = reinterpret_cast<unsigned*>(sq_ring_ + params_.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned*>(sq_ring_ + params_.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq_ring_ + params_.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq_ring_ + params_.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq_ring_ + params_.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned*>(cq_ring_ + params_.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring_ + params_.cq_off.cqes);
+        return true;
+    }
+
+    int fd_;
+    io_uring_params params_;
+    char* sq_ring_ = nullptr;
+    char* cq_ring_ = nullptr;
+    std::size_t sq_ring_bytes_ = 0;
+    std::size_t cq_ring_bytes_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqes_bytes_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+}  // namespace
+
+// ---- Sink -------------------------------------------------------------------
+
+/// Append-only file behind two page-aligned staging buffers: one fills
+/// while the other is being written. Only whole pages are written until
+/// close(), as O_DIRECT requires; the tail of a flushed buffer moves to the
+/// front of the next one.
+class AsyncCaptureWriter::Sink {
+public:
+    Sink(const std::filesystem::path& path, bool direct, bool uring, std::size_t buffer_bytes, int numa_node)
+        : capacity_(align_up(buffer_bytes, kDirectIoAlignment)) {
+        const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        if (direct) {
+            fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+            direct_ = fd_ >= 0;
+        }
+        if (fd_ < 0) {
+            // tmpfs and some network filesystems reject O_DIRECT.
+            fd_ = ::open(path.c_str(), flags, 0644);
+        }
+        if (fd_ < 0) {
+            throw_errno(errno, "capture: cannot create " + path.string());
+        }
+        if (uring) {
+            ring_ = IoUring::create(4);
+        }
+        for (Buffer& b : buffers_) {
+            b.storage.resize(capacity_);
+            bind_to_node(b.storage.data(), b.storage.size(), numa_node);
+        }
+    }
+
+    ~Sink() {
+        if (fd_ >= 0) {
+            try {
+                wait(buffers_[0]);
+                wait(buffers_[1]);
+            } catch (...) {
+            }
+            ::close(fd_);
+        }
+    }
+
+    Sink(const Sink&) = delete;
+    Sink& operator=(const Sink&) = delete;
+
+    const char* backend() const noexcept { return ring_ ? "io_uring" : "pwrite"; }
+    bool direct() const noexcept { return direct_; }
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    /// Logical bytes appended so far (the next file offset).
+    std::uint64_t offset() const noexcept { return file_offset_ + fill_; }
+
+    /// Contiguous writable space of at least @p bytes at offset().
+    /// @p bytes must not exceed capacity() - kDirectIoAlignment.
+    std::span<std::byte> reserve(std::size_t bytes) {
+        if (capacity_ - fill_ < bytes) {
+            flush_prefix();
+        }
+        return {current().storage.data() + fill_, capacity_ - fill_};
+    }
+
+    void commit(std::size_t bytes) noexcept { fill_ += bytes; }
+
+    void append(const void* data, std::size_t bytes) {
+        const auto* p = static_cast<const std::byte*>(data);
+        while (bytes > 0) {
+            if (fill_ == capacity_) {
+                flush_prefix();
+            }
+            const std::size_t n = std::min(bytes, capacity_ - fill_);
+            std::memcpy(current().storage.data() + fill_, p, n);
+            fill_ += n;
+            p += n;
+            bytes -= n;
+        }
+    }
+
+    void pad_to(std::size_t alignment) {
+        const std::size_t pad = align_up(offset(), alignment) - offset();
+        std::memset(reserve(pad).data(), 0, pad);
+        commit(pad);
+    }
+
+    /// Writes the rest, trims the O_DIRECT padding and closes the file.
+    void close() {
+        const std::uint64_t logical = offset();
+        Buffer& b = current();
+        std::size_t bytes = fill_;
+        if (direct_) {
+            bytes = align_up(fill_, kDirectIoAlignment);
+            std::memset(b.storage.data() + fill_, 0, bytes - fill_);
+        }
+        if (bytes > 0) {
+            submit(b, bytes, file_offset_);
+        }
+        wait(buffers_[0]);
+        wait(buffers_[1]);
+        if (bytes != fill_ && ::ftruncate(fd_, static_cast<off_t>(logical)) != 0) {
+            throw_errno(errno, "capture: truncate failed");
+        }
+        const int fd = std::exchange(fd_, -1);
+        if (::close(fd) != 0) {
+            throw_errno(errno, "capture: close failed");
+        }
+    }
+
+private:
+    struct Buffer {
+        std::vector<std::byte, AlignedAllocator<std::byte, kDirectIoAlignment>> storage;
+        iovec iov{};
+        std::uint64_t offset = 0;
+        bool in_flight = false;
+    };
+
+    Buffer& current() noexcept { return buffers_[current_]; }
+
+    void flush_prefix() {
+        const std::size_t aligned = direct_ ? fill_ / kDirectIoAlignment * kDirectIoAlignment : fill_;
+        Buffer& full = current();
+        submit(full, aligned, file_offset_);
+        Buffer& next = buffers_[current_ ^ 1];
+        wait(next);
+        // The kernel only reads the in-flight buffer, so copying its tail is safe.
+        std::memcpy(next.storage.data(), full.storage.data() + aligned, fill_ - aligned);
+        fill_ -= aligned;
+        file_offset_ += aligned;
+        current_ ^= 1;
+    }
+
+    void submit(Buffer& b, std::size_t bytes, std::uint64_t offset) {
+        b.iov = {b.storage.data(), bytes};
+        b.offset = offset;
+        if (!ring_) {
+            pwrite_all(fd_, b.storage.data(), bytes, offset);
+            return;
+        }
+        ring_->write(fd_, &b.iov, offset, static_cast<std::uint64_t>(&b - buffers_));
+        b.in_flight = true;
+    }
+
+    void wait(Buffer& b) {
+        while (b.in_flight) {
+            const io_uring_cqe cqe = ring_->wait();
+            Buffer& done = buffers_[cqe.user_data & 1];
+            done.in_flight = false;
+            if (cqe.res < 0) {
+                throw_errno(-cqe.res, "capture: write failed");
+            }
+            const auto written = static_cast<std::size_t>(cqe.res);
+            if (written < done.iov.iov_len) {
+                // Short write: finish it synchronously (still page-aligned,
+                // since O_DIRECT transfers whole blocks).
+                pwrite_all(fd_, done.storage.data() + written, done.iov.iov_len - written,
+                           done.offset + written);
+            }
+        }
+    }
+
+    int fd_ = -1;
+    bool direct_ = false;
+    std::unique_ptr<IoUring> ring_;
+    std::size_t capacity_;
+    Buffer buffers_[2];
+    unsigned current_ = 0;
+    std::size_t fill_ = 0;
+    std::uint64_t file_offset_ = 0;
+};
+
+// ---- AsyncCaptureWriter -----------------------------------------------------
+
+AsyncCaptureWriter::AsyncCaptureWriter(const std::filesystem::path& path, const CaptureInfo& info,
+                                       const AsyncWriterOptions& options)
+    : options_(options),
+      channel_count_(info.channels.size()),
+      filled_(options.queue_chunks == 0 ? 1 : options.queue_chunks),
+      free_(options.queue_chunks == 0 ? 1 : options.queue_chunks) {
+    if (options.queue_chunks == 0 || options.max_chunk_samples == 0) {
+        throw std::invalid_argument("capture: queue and chunk size must be positive");
+    }
+    if (options.encoding != capture::ChunkEncoding::Raw &&
+        options.encoding != capture::ChunkEncoding::DeltaRice) {
+        throw std::invalid_argument("capture: unsupported chunk encoding");
+    }
+    const std::vector<std::byte> header = capture::encode_header(info);
+    const std::size_t chunk_bytes = options.max_chunk_samples * channel_count_ * sizeof(std::int16_t);
+    if (chunk_bytes > UINT32_MAX) {
+        throw std::invalid_argument("capture: chunk too large");
+    }
+    // A chunk (plus its alignment padding) must always fit behind a page tail.
+    const std::size_t buffer_bytes =
+        std::max(options.write_buffer_bytes, 2 * (chunk_bytes + capture::kChunkAlignment) + kDirectIoAlignment);
+    sink_ = std::make_unique<Sink>(path, options.direct_io, options.use_io_uring, buffer_bytes,
+                                   options.numa_node);
+    sink_->append(header.data(), header.size());
+    if (options.build_pyramid) {
+        pyramid_ = std::make_unique<PyramidBuilder>(pyramid_path(path), channel_count_,
+                                                    info.sample_rate_hz, options.pyramid);
+    }
+
+    slots_.resize(options.queue_chunks);
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        slots_[i].samples = ChannelBuffer<std::int16_t>(channel_count_, options.max_chunk_samples);
+        const ChannelBlock<std::int16_t> block = slots_[i].samples.view();
+        bind_to_node(block.data(), block.stride() * channel_count_ * sizeof(std::int16_t), options.numa_node);
+        free_.try_push(static_cast<std::uint32_t>(i));
+    }
+    free_slots_.release(static_cast<std::ptrdiff_t>(slots_.size()));
+
+    thread_ = std::thread([this] { run(); });
+    if (options.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(options.cpu, &set);
+        ::pthread_setaffinity_np(thread_.native_handle(), sizeof(set), &set);
+    }
+}
+
+AsyncCaptureWriter::~AsyncCaptureWriter() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+bool AsyncCaptureWriter::try_write_chunk(ChannelBlock<const std::int16_t> block,
+                                         std::uint64_t first_sample) {
+    return enqueue(block, first_sample, false);
+}
+
+void AsyncCaptureWriter::write_chunk(ChannelBlock<const std::int16_t> block,
+                                     std::uint64_t first_sample) {
+    enqueue(block, first_sample, true);
+}
+
+bool AsyncCaptureWriter::enqueue(ChannelBlock<const std::int16_t> block,
+                                 std::uint64_t first_sample, bool wait) {
+    if (finished_) {
+        throw std::logic_error("capture: write after finish");
+    }
+    rethrow_error();
+    if (block.channels() != channel_count_) {
+        throw std::invalid_argument("capture: chunk channel count mismatch");
+    }
+    if (block.samples() > options_.max_chunk_samples) {
+        throw std::invalid_argument("capture: chunk exceeds max_chunk_samples");
+    }
+    if (first_sample < next_sample_) {
+        throw std::invalid_argument("capture: chunks must be written in sample order");
+    }
+    if (block.samples() == 0) {
+        return true;
+    }
+    if (wait) {
+        free_slots_.acquire();
+    } else if (!free_slots_.try_acquire()) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        SRM_COUNT("capture_dropped_chunks", 1);
+        return false;
+    }
+    if (failed_.load(std::memory_order_acquire)) {
+        free_slots_.release();
+        rethrow_error();
+    }
+
+    std::uint32_t index = 0;
+    free_.try_pop(index);  // a permit guarantees a free slot
+    Slot& slot = slots_[index];
+    for (std::size_t c = 0; c < channel_count_; ++c) {
+        const std::span<const std::int16_t> src = block.channel(c);
+        std::copy(src.begin(), src.end(), slot.samples.channel(c).begin());
+    }
+    slot.count = block.samples();
+    slot.first_sample = first_sample;
+    filled_.try_push(index);
+    work_.release();
+    SRM_HIGH_WATER("capture_queue_chunks", filled_.size());
+    next_sample_ = first_sample + block.samples();
+    return true;
+}
+
+void AsyncCaptureWriter::run() noexcept {
+    try {
+        for (;;) {
+            work_.acquire();
+            std::uint32_t index = 0;
+            if (!filled_.try_pop(index)) {
+                if (closing_.load(std::memory_order_acquire)) {
+                    break;
+                }
+                continue;
+            }
+            write_slot(slots_[index]);
+            free_.try_push(index);
+            free_slots_.release();
+        }
+
+        sink_->pad_to(capture::kChunkAlignment);
+        capture::FileTrailer trailer{};
+        trailer.index_offset = sink_->offset();
+        trailer.chunk_count = index_.size();
+        trailer.total_samples = total_samples_;
+        trailer.magic = capture::kTrailerMagic;
+        sink_->append(index_.data(), index_.size() * sizeof(capture::ChunkIndexEntry));
+        sink_->append(&trailer, sizeof(trailer));
+        sink_->close();
+        if (pyramid_) {
+            pyramid_->finish();
+        }
+    } catch (...) {
+        error_ = std::current_exception();
+        failed_.store(true, std::memory_order_release);
+        // Unblock a producer waiting for a slot; it will see failed_.
+        free_slots_.release(static_cast<std::ptrdiff_t>(slots_.size()));
+    }
+}
+
+void AsyncCaptureWriter::write_slot(Slot& slot) {
+    SRM_SCOPED_TIMER("capture_encode");
+    const ChannelBlock<const std::int16_t> block = slot.samples.view().subblock(0, slot.count);
+    const std::size_t raw = slot.count * channel_count_ * sizeof(std::int16_t);
+
+    sink_->pad_to(capture::kChunkAlignment);
+    capture::ChunkIndexEntry entry{};
+    entry.offset = sink_->offset();
+    entry.first_sample = slot.first_sample;
+    entry.sample_count = static_cast<std::uint32_t>(slot.count);
+    entry.encoding = capture::ChunkEncoding::Raw;
+    entry.payload_bytes = static_cast<std::uint32_t>(raw);
+
+    std::size_t coded = 0;
+    if (options_.encoding == capture::ChunkEncoding::DeltaRice) {
+        // Limiting the coder to the raw size makes it give up (and the chunk
+        // stay raw) exactly when compression would not pay.
+        coded = encode_delta_rice_chunk(block, sink_->reserve(raw).first(raw));
+    }
+    if (coded != 0) {
+        sink_->commit(coded);
+        entry.encoding = capture::ChunkEncoding::DeltaRice;
+        entry.payload_bytes = static_cast<std::uint32_t>(coded);
+    } else {
+        for (std::size_t c = 0; c < channel_count_; ++c) {
+            sink_->append(block.channel(c).data(), slot.count * sizeof(std::int16_t));
+        }
+    }
+    index_.push_back(entry);
+    if (pyramid_) {
+        pyramid_->add(block, slot.first_sample);
+    }
+    total_samples_ += slot.count;
+    raw_bytes_.fetch_add(raw, std::memory_order_relaxed);
+    stored_bytes_.fetch_add(entry.payload_bytes, std::memory_order_relaxed);
+    chunks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncCaptureWriter::finish() {
+    if (finished_) {
+        rethrow_error();
+        return;
+    }
+    finished_ = true;
+    closing_.store(true, std::memory_order_release);
+    work_.release();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    rethrow_error();
+}
+
+void AsyncCaptureWriter::rethrow_error() {
+    if (failed_.load(std::memory_order_acquire)) {
+        std::rethrow_exception(error_);
+    }
+}
+
+double AsyncCaptureWriter::compression_ratio() const noexcept {
+    const std::uint64_t stored = stored_bytes();
+    return stored == 0 ? 1.0 : static_cast<double>(raw_bytes()) / static_cast<double>(stored);
+}
+
+const char* AsyncCaptureWriter::io_backend() const noexcept {
+    return sink_->backend();
+}
+
+bool AsyncCaptureWriter::direct_io() const noexcept { return sink_->direct(); }
+
+}  // namespace srm
@@ -0,0 +1,473 @@
+#include "srm/calibration_store.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace srm {
+
+// ---- calibration file -------------------------------------------------------
+
+namespace {
+
+[[noreturn]] void malformed(std::size_t line, const std::string& what) {
+    throw std::runtime_error("calibration: line " + std::to_string(line) + ": " + what);
+}
+
+template <typename T>
+T parse_number(std::string_view text, std::size_t line, std::string_view key) {
+    T value{};
+    const char* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    if (ec != std::errc() || ptr != end) {
+        malformed(line, "bad value '" + std::string(text) + "' for " + std::string(key));
+    }
+    return value;
+}
+
+std::vector<ThermalOutputPoint> parse_thermal(std::string_view text, std::size_t line) {
+    std::vector<ThermalOutputPoint> points;
+    while (!text.empty()) {
+        const std::size_t comma = text.find(',');
+        const std::string_view point = text.substr(0, comma);
+        const std::size_t colon = point.find(':');
+        if (colon == std::string_view::npos) {
+            malformed(line, "thermal point '" + std::string(point) + "' is not temperature:strain");
+        }
+        ThermalOutputPoint p;
+        p.temperature_c = parse_number<float>(point.substr(0, colon), line, "thermal");
+        p.apparent_strain_ue = parse_number<float>(point.substr(colon + 1), line, "thermal");
+        if (!points.empty() && !(p.temperature_c > points.back().temperature_c)) {
+            malformed(line, "thermal curve must be in ascending temperature");
+        }
+        points.push_back(p);
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+    }
+    return points;
+}
+
+}  // namespace
+
+std::vector<SensorCalibration> parse_calibration(std::string_view text) {
+    std::vector<SensorCalibration> records;
+    std::size_t line_number = 0;
+    while (!text.empty()) {
+        ++line_number;
+        const std::size_t newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text = newline == std::string_view::npos ? std::string_view{} : text.substr(newline + 1);
+        line = line.substr(0, line.find('#'));
+
+        SensorCalibration record;
+        bool has_channel = false;
+        bool empty = true;
+        while (true) {
+            const std::size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string_view::npos) {
+                break;
+            }
+            line.remove_prefix(begin);
+            const std::size_t end = std::min(line.find_first_of(" \t\r"), line.size());
+            const std::string_view field = line.substr(0, end);
+            line.remove_prefix(end);
+            empty = false;
+
+            const std::size_t eq = field.find('=');
+            if (eq == std::string_view::npos) {
+                malformed(line_number, "field '" + std::string(field) + "' is not key=value");
+            }
+            const std::string_view key = field.substr(0, eq);
+            const std::string_view value = field.substr(eq + 1);
+            if (key == "channel") {
+                record.channel = parse_number<std::uint16_t>(value, line_number, key);
+                has_channel = true;
+            } else if (key == "sensor") {
+                record.sensor_id = std::string(value);
+            } else if (key == "thermocouple") {
+                record.thermocouple = parse_number<std::uint16_t>(value, line_number, key);
+            } else if (key == "zero") {
+                record.zero_offset_counts = parse_number<float>(value, line_number, key);
+                record.has_zero_offset = true;
+            } else if (key == "shunt_expected") {
+                record.shunt_expected_ue = parse_number<double>(value, line_number, key);
+            } else if (key == "shunt_measured") {
+                record.shunt_measured_ue = parse_number<double>(value, line_number, key);
+            } else if (key == "gf_tc") {
+                record.gauge_factor_tc_per_c = parse_number<double>(value, line_number, key);
+            } else if (key == "reference_c") {
+                record.reference_temperature_c = parse_number<float>(value, line_number, key);
+            } else if (key == "thermal") {
+                record.thermal_output = parse_thermal(value, line_number);
+            } else {
+                malformed(line_number, "unknown field '" + std::string(key) + "'");
+            }
+        }
+        if (empty) {
+            continue;
+        }
+        if (!has_channel || record.sensor_id.empty()) {
+            malformed(line_number, "a record needs channel= and sensor=");
+        }
+        for (const SensorCalibration& other : records) {
+            if (other.channel == record.channel) {
+                malformed(line_number, "channel " + std::to_string(record.channel) + " calibrated twice");
+            }
+            if (other.sensor_id == record.sensor_id) {
+                malformed(line_number, "sensor " + record.sensor_id + " calibrated twice");
+            }
+        }
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+std::vector<SensorCalibration> load_calibration(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("calibration: cannot open " + path);
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    if (file.bad()) {
+        throw std::runtime_error("calibration: cannot read " + path);
+    }
+    return parse_calibration(text.str());
+}
+
+// ---- CalibrationSnapshot ----------------------------------------------------
+
+namespace {
+
+/// Bridge output / excitation that reads as @p microstrain.
+double strain_to_ratio(const ConversionParams& p, double microstrain) noexcept {
+    const double k = p.strain_coeff;
+    return p.bridge == capture::BridgeConfig::Quarter ? microstrain / (k - 2.0 * microstrain)
+                                                      : microstrain / k;
+}
+
+double apparent_strain(const std::vector<ThermalOutputPoint>& curve, double temperature_c) noexcept {
+    if (curve.empty()) {
+        return 0.0;
+    }
+    if (temperature_c <= curve.front().temperature_c) {
+        return curve.front().apparent_strain_ue;
+    }
+    if (temperature_c >= curve.back().temperature_c) {
+        return curve.back().apparent_strain_ue;
+    }
+    const auto upper = std::upper_bound(
+        curve.begin(), curve.end(), temperature_c,
+        [](double t, const ThermalOutputPoint& p) { return t < p.temperature_c; });
+    const ThermalOutputPoint& a = upper[-1];
+    const ThermalOutputPoint& b = upper[0];
+    const double f = (temperature_c - a.temperature_c) / (double(b.temperature_c) - a.temperature_c);
+    return a.apparent_strain_ue + f * (double(b.apparent_strain_ue) - a.apparent_strain_ue);
+}
+
+}  // namespace
+
+CalibrationSnapshot::CalibrationSnapshot(std::span<const ChannelInfo> channels,
+                                         std::span<const SensorCalibration> records,
+                                         std::size_t table_points) {
+    if (table_points < 2) {
+        throw std::invalid_argument("calibration: need at least two temperature table points");
+    }
+    std::vector<const SensorCalibration*> by_channel(channels.size(), nullptr);
+    for (const SensorCalibration& record : records) {
+        if (record.channel >= channels.size()) {
+            throw std::invalid_argument("calibration: sensor " + record.sensor_id + " is on channel " +
+                                        std::to_string(record.channel) + ", which does not exist");
+        }
+        if (by_channel[record.channel] != nullptr) {
+            throw std::invalid_argument("calibration: channel " + std::to_string(record.channel) +
+                                        " calibrated twice");
+        }
+        by_channel[record.channel] = &record;
+    }
+
+    channels_.resize(channels.size());
+    for (std::size_t ch = 0; ch < channels.size(); ++ch) {
+        ConversionParams base = make_conversion_params(channels[ch]);
+        Channel& out = channels_[ch];
+        out.bridge = base.bridge;
+        out.first = offsets_.size();
+        const SensorCalibration* record = by_channel[ch];
+        if (record == nullptr) {
+            out.ratio_per_count = base.ratio_per_count;
+            offsets_.push_back(base.offset_counts);
+            coeffs_.push_back(base.strain_coeff);
+            continue;
+        }
+
+        out.sensor_id = record->sensor_id;
+        if (record->has_zero_offset) {
+            base.offset_counts = record->zero_offset_counts;
+        }
+        if (record->shunt_expected_ue != 0.0 || record->shunt_measured_ue != 0.0) {
+            if (!(record->shunt_measured_ue * record->shunt_expected_ue > 0.0)) {
+                throw std::invalid_argument("calibration: shunt readings of sensor " + record->sensor_id +
+                                            " must be non-zero and of the same sign");
+            }
+            // The gain error sits between the bridge and the ADC, so correct
+            // the bridge ratio, not the strain (they differ for a quarter bridge).
+            base.ratio_per_count = static_cast<float>(
+                base.ratio_per_count * (strain_to_ratio(base, record->shunt_expected_ue) /
+                                        strain_to_ratio(base, record->shunt_measured_ue)));
+        }
+        out.ratio_per_count = base.ratio_per_count;
+
+        const bool compensated = record->thermocouple != kNoThermocouple &&
+                                 (!record->thermal_output.empty() || record->gauge_factor_tc_per_c != 0.0);
+        if (!compensated) {
+            offsets_.push_back(base.offset_counts);
+            coeffs_.push_back(base.strain_coeff);
+            continue;
+        }
+
+        out.thermocouple = record->thermocouple;
+        const std::vector<ThermalOutputPoint>& curve = record->thermal_output;
+        // Records built in code skip the parser, so hold them to the same rule:
+        // equal or descending points would give a zero or negative table step.
+        for (std::size_t i = 1; i < curve.size(); ++i) {
+            if (!(curve[i].temperature_c > curve[i - 1].temperature_c)) {
+                throw std::invalid_argument("calibration: thermal curve of sensor " + record->sensor_id +
+                                            " must be in ascending temperature");
+            }
+        }
+        const double first_c = curve.size() >= 2 ? curve.front().temperature_c : kMinTemperatureC;
+        const double last_c = curve.size() >= 2 ? curve.back().temperature_c : kMaxTemperatureC;
+        const double step = (last_c - first_c) / static_cast<double>(table_points - 1);
+        out.first_c = static_cast<float>(first_c);
+        out.inv_step = static_cast<float>(1.0 / step);
+        out.points = table_points;
+        for (std::size_t i = 0; i < table_points; ++i) {
+            const double t = first_c + step * static_cast<double>(i);
+            const double gf_scale = 1.0 + record->gauge_factor_tc_per_c * (t - record->reference_temperature_c);
+            if (!(gf_scale > 0.0)) {
+                throw std::invalid_argument("calibration: gauge factor of sensor " + record->sensor_id +
+                                            " drifts through zero inside its temperature range");
+            }
+            // Apparent strain is specified at the nominal gauge factor.
+            offsets_.push_back(static_cast<float>(strain_to_counts(base, apparent_strain(curve, t))));
+            coeffs_.push_back(static_cast<float>(base.strain_coeff / gf_scale));
+        }
+    }
+}
+
+std::ptrdiff_t CalibrationSnapshot::find_sensor(std::string_view sensor_id) const noexcept {
+    if (sensor_id.empty()) {
+        return -1;
+    }
+    for (std::size_t ch = 0; ch < channels_.size(); ++ch) {
+        if (channels_[ch].sensor_id == sensor_id) {
+            return static_cast<std::ptrdiff_t>(ch);
+        }
+    }
+    return -1;
+}
+
+ConversionParams CalibrationSnapshot::params(std::size_t channel, float temperature_c) const noexcept {
+    const Channel& c = channels_[channel];
+    ConversionParams p;
+    p.ratio_per_count = c.ratio_per_count;
+    p.bridge = c.bridge;
+    if (c.points == 1) {
+        p.offset_counts = offsets_[c.first];
+        p.strain_coeff = coeffs_[c.first];
+        return p;
+    }
+    const float last = static_cast<float>(c.points - 1);
+    float x = (temperature_c - c.first_c) * c.inv_step;
+    x = x > 0.0f ? (x < last ? x : last) : 0.0f;  // also maps NaN to the first point
+    const std::size_t i = std::min(static_cast<std::size_t>(x), c.points - 2);
+    const float f = x - static_cast<float>(i);
+    const float* offsets = offsets_.data() + c.first + i;
+    const float* coeffs = coeffs_.data() + c.first + i;
+    p.offset_counts = offsets[0] + f * (offsets[1] - offsets[0]);
+    p.strain_coeff = coeffs[0] + f * (coeffs[1] - coeffs[0]);
+    return p;
+}
+
+void CalibrationSnapshot::params(std::span<const float> thermocouples_c,
+                                 std::span<ConversionParams> out) const {
+    if (out.size() != channels_.size()) {
+        throw std::invalid_argument("calibration: need one conversion entry per channel");
+    }
+    for (std::size_t ch = 0; ch < channels_.size(); ++ch) {
+        const std::uint16_t tc = channels_[ch].thermocouple;
+        float temperature_c = 0.0f;
+        if (tc != kNoThermocouple) {
+            if (tc >= thermocouples_c.size()) {
+                throw std::invalid_argument("calibration: no reading for thermocouple " + std::to_string(tc));
+            }
+            temperature_c = thermocouples_c[tc];
+        }
+        out[ch] = params(ch, temperature_c);
+    }
+}
+
+namespace {
+
+// Fixed part of a channel in a snapshot image; the sensor id follows it.
+struct ChannelImage {
+    std::uint64_t first;
+    std::uint64_t points;
+    float ratio_per_count;
+    float first_c;
+    float inv_step;
+    std::uint16_t thermocouple;
+    std::uint8_t bridge;
+    std::uint8_t reserved0;
+    std::uint32_t sensor_bytes;
+    std::uint32_t reserved1;
+};
+static_assert(sizeof(ChannelImage) == 40);
+
+void append_bytes(std::vector<std::byte>& out, const void* data, std::size_t size) {
+    const auto* p = static_cast<const std::byte*>(data);
+    out.insert(out.end(), p, p + size);
+}
+
+/// Bounds-checked cursor over an image.
+class ImageReader {
+public:
+    explicit ImageReader(std::span<const std::byte> image) noexcept : image_(image) {}
+
+    void read(void* out, std::size_t size) {
+        if (size > image_.size() - pos_) {
+            throw std::runtime_error("calibration: truncated snapshot image");
+        }
+        std::memcpy(out, image_.data() + pos_, size);
+        pos_ += size;
+    }
+
+    template <typename T>
+    T read() {
+        T value;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+private:
+    std::span<const std::byte> image_;
+    std::size_t pos_ = 0;
+};
+
+}  // namespace
+
+void CalibrationSnapshot::append_image(std::vector<std::byte>& out) const {
+    const std::uint64_t counts[2] = {channels_.size(), offsets_.size()};
+    append_bytes(out, counts, sizeof(counts));
+    for (const Channel& c : channels_) {
+        const ChannelImage image{c.first,       c.points, c.ratio_per_count, c.first_c, c.inv_step,
+                                 c.thermocouple, static_cast<std::uint8_t>(c.bridge), 0,
+                                 static_cast<std::uint32_t>(c.sensor_id.size()), 0};
+        append_bytes(out, &image, sizeof(image));
+        append_bytes(out, c.sensor_id.data(), c.sensor_id.size());
+    }
+    append_bytes(out, offsets_.data(), offsets_.size() * sizeof(float));
+    append_bytes(out, coeffs_.data(), coeffs_.size() * sizeof(float));
+}
+
+CalibrationSnapshot CalibrationSnapshot::from_image(std::span<const std::byte> image) {
+    ImageReader in(image);
+    const auto channels = in.read<std::uint64_t>();
+    const auto values = in.read<std::uint64_t>();
+    if (channels > image.size() / sizeof(ChannelImage) || values > image.size() / (2 * sizeof(float))) {
+        throw std::runtime_error("calibration: malformed snapshot image");
+    }
+    CalibrationSnapshot snapshot;
+    snapshot.channels_.resize(channels);
+    for (Channel& c : snapshot.channels_) {
+        const auto fixed = in.read<ChannelImage>();
+        const auto bridge = static_cast<capture::BridgeConfig>(fixed.bridge);
+        if (fixed.points == 0 || fixed.first > values || fixed.points > values - fixed.first ||
+            (bridge != capture::BridgeConfig::Quarter && bridge != capture::BridgeConfig::Half &&
+             bridge != capture::BridgeConfig::Full) ||
+            fixed.sensor_bytes > image.size()) {
+            throw std::runtime_error("calibration: malformed snapshot image");
+        }
+        c.first = fixed.first;
+        c.points = fixed.points;
+        c.ratio_per_count = fixed.ratio_per_count;
+        c.first_c = fixed.first_c;
+        c.inv_step = fixed.inv_step;
+        c.thermocouple = fixed.thermocouple;
+        c.bridge = bridge;
+        c.sensor_id.resize(fixed.sensor_bytes);
+        in.read(c.sensor_id.data(), c.sensor_id.size());
+    }
+    snapshot.offsets_.resize(values);
+    snapshot.coeffs_.resize(values);
+    in.read(snapshot.offsets_.data(), values * sizeof(float));
+    in.read(snapshot.coeffs_.data(), values * sizeof(float));
+    return snapshot;
+}
+
+// ---- CalibrationStore -------------------------------------------------------
+
+CalibrationStore::CalibrationStore(CalibrationSnapshot initial, std::size_t max_readers)
+    : channels_(initial.channel_count()), current_(nullptr), slot_count_(max_readers) {
+    if (max_readers == 0) {
+        throw std::invalid_argument("calibration: a store needs at least one reader slot");
+    }
+    slots_ = std::make_unique<Slot[]>(max_readers);
+    auto snapshot = std::make_unique<CalibrationSnapshot>(std::move(initial));
+    snapshot->generation_ = 1;
+    current_.store(snapshot.release(), std::memory_order_release);
+}
+
+CalibrationStore::~CalibrationStore() {
+    delete current_.load(std::memory_order_acquire);
+}
+
+CalibrationStore::Reader CalibrationStore::reader() {
+    for (std::size_t i = 0; i < slot_count_; ++i) {
+        bool expected = false;
+        if (slots_[i].claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return Reader(this, &slots_[i]);
+        }
+    }
+    throw std::runtime_error("calibration: all " + std::to_string(slot_count_) + " reader slots are taken");
+}
+
+std::uint64_t CalibrationStore::publish(CalibrationSnapshot next) {
+    if (next.channel_count() != channels_) {
+        throw std::invalid_argument("calibration: a new snapshot must keep the channel count");
+    }
+    std::lock_guard lock(publish_mutex_);
+    auto snapshot = std::make_unique<CalibrationSnapshot>(std::move(next));
+    const std::uint64_t generation = generation_.load(std::memory_order_relaxed) + 1;
+    snapshot->generation_ = generation;
+    const CalibrationSnapshot* old = current_.exchange(snapshot.release(), std::memory_order_seq_cst);
+    generation_.store(generation, std::memory_order_release);
+
+    // Grace period: a reader whose slot is odd now may have loaded the old
+    // pointer; one that is even, or moves on, will load the new one.
+    for (std::size_t i = 0; i < slot_count_; ++i) {
+        const std::uint64_t sequence = slots_[i].sequence.load(std::memory_order_seq_cst);
+        if ((sequence & 1) == 0) {
+            continue;
+        }
+        for (unsigned spins = 0; slots_[i].sequence.load(std::memory_order_acquire) == sequence; ++spins) {
+            if (spins < 64) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+    delete old;
+    return generation;
+}
+
+std::uint64_t CalibrationStore::generation() const noexcept {
+    return generation_.load(std::memory_order_acquire);
+}
+
+}  // namespace srm
@@ -0,0 +1,44 @@
+#include "srm/campaign.hpp"
+
+#include <stdexcept>
+
+namespace srm {
+
+std::vector<std::filesystem::path> list_captures(const std::filesystem::path& directory,
+                                                 const std::string& extension) {
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == extension) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<ChunkRange> split_chunks(std::size_t chunk_count, std::size_t chunks_per_part) {
+    if (chunks_per_part == 0) {
+        throw std::invalid_argument("campaign: chunks_per_part must be positive");
+    }
+    std::vector<ChunkRange> ranges;
+    if (chunk_count == 0) {
+        ranges.push_back({0, 0});
+        return ranges;
+    }
+    for (std::size_t first = 0; first < chunk_count; first += chunks_per_part) {
+        ranges.push_back({first, std::min(chunk_count, first + chunks_per_part)});
+    }
+    return ranges;
+}
+
+std::string CampaignProcessor::describe(const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "unknown error";
+    }
+}
+
+}  // namespace srm
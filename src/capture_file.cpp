@@ -0,0 +1,399 @@
+#include "srm/capture_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "srm/delta_rice.hpp"
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+namespace capture {
+
+std::vector<std::byte> encode_header(const CaptureInfo& info) {
+    if (info.channels.empty() || info.channels.size() >= kNoChannel) {
+        throw std::invalid_argument("capture: channel count out of range");
+    }
+    if (!(info.sample_rate_hz > 0.0)) {
+        throw std::invalid_argument("capture: sample rate must be positive");
+    }
+    if (info.rotor_position_channel != kNoChannel &&
+        info.rotor_position_channel >= info.channels.size()) {
+        throw std::invalid_argument("capture: rotor position channel out of range");
+    }
+
+    FileHeader header{};
+    header.magic = kFileMagic;
+    header.version = kFormatVersion;
+    header.header_bytes = static_cast<std::uint32_t>(
+        sizeof(FileHeader) + info.channels.size() * sizeof(ChannelDescriptor));
+    header.channel_count = static_cast<std::uint16_t>(info.channels.size());
+    header.rotor_position_channel = info.rotor_position_channel;
+    header.sample_rate_hz = info.sample_rate_hz;
+    header.start_time_ns = info.start_time_ns;
+
+    std::vector<std::byte> bytes(header.header_bytes);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::byte* out = bytes.data() + sizeof(header);
+    for (const ChannelInfo& ch : info.channels) {
+        if (ch.name.size() >= sizeof(ChannelDescriptor::name)) {
+            throw std::invalid_argument("capture: channel name too long: " + ch.name);
+        }
+        ChannelDescriptor desc{};
+        std::copy(ch.name.begin(), ch.name.end(), desc.name.begin());
+        desc.gauge_factor = ch.gauge_factor;
+        desc.excitation_volts = ch.excitation_volts;
+        desc.amplifier_gain = ch.amplifier_gain;
+        desc.volts_per_count = ch.volts_per_count;
+        desc.zero_offset_counts = ch.zero_offset_counts;
+        desc.bridge = ch.bridge;
+        std::memcpy(out, &desc, sizeof(desc));
+        out += sizeof(desc);
+    }
+    return bytes;
+}
+
+CaptureInfo decode_header(std::span<const std::byte> bytes) {
+    FileHeader header;
+    if (bytes.size() < sizeof(header)) {
+        throw std::runtime_error("capture: file too short for header");
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != kFileMagic) {
+        throw std::runtime_error("capture: bad file magic");
+    }
+    if (header.version != kFormatVersion) {
+        throw std::runtime_error("capture: unsupported format version " +
+                                 std::to_string(header.version));
+    }
+    const std::size_t expected =
+        sizeof(FileHeader) + std::size_t{header.channel_count} * sizeof(ChannelDescriptor);
+    if (header.channel_count == 0 || header.header_bytes != expected ||
+        bytes.size() < expected) {
+        throw std::runtime_error("capture: inconsistent header size");
+    }
+
+    CaptureInfo info;
+    info.sample_rate_hz = header.sample_rate_hz;
+    info.rotor_position_channel = header.rotor_position_channel;
+    info.start_time_ns = header.start_time_ns;
+    info.channels.resize(header.channel_count);
+    const std::byte* in = bytes.data() + sizeof(header);
+    for (ChannelInfo& ch : info.channels) {
+        ChannelDescriptor desc;
+        std::memcpy(&desc, in, sizeof(desc));
+        in += sizeof(desc);
+        const auto end = std::find(desc.name.begin(), desc.name.end(), '\0');
+        ch.name.assign(desc.name.begin(), end);
+        ch.gauge_factor = desc.gauge_factor;
+        ch.excitation_volts = desc.excitation_volts;
+        ch.amplifier_gain = desc.amplifier_gain;
+        ch.volts_per_count = desc.volts_per_count;
+        ch.zero_offset_counts = desc.zero_offset_counts;
+        switch (desc.bridge) {
+        case BridgeConfig::Quarter:
+        case BridgeConfig::Half:
+        case BridgeConfig::Full:
+            break;
+        default:
+            throw std::runtime_error("capture: unknown bridge configuration " +
+                                     std::to_string(static_cast<unsigned>(desc.bridge)) + " on channel " +
+                                     ch.name);
+        }
+        ch.bridge = desc.bridge;
+    }
+    return info;
+}
+
+}  // namespace capture
+
+// ---- CaptureWriter ---------------------------------------------------------
+
+CaptureWriter::CaptureWriter(const std::filesystem::path& path, const CaptureInfo& info)
+    : channel_count_(info.channels.size()) {
+    const std::vector<std::byte> header = capture::encode_header(info);
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw_errno("capture: cannot create " + path.string());
+    }
+    write_all(header.data(), header.size());
+}
+
+CaptureWriter::~CaptureWriter() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+void CaptureWriter::write_chunk(ChannelBlock<const std::int16_t> block) {
+    write_chunk(block, next_sample_);
+}
+
+void CaptureWriter::write_chunk(ChannelBlock<const std::int16_t> block,
+                                std::uint64_t first_sample) {
+    SRM_SCOPED_TIMER("capture_write");
+    if (fd_ < 0) {
+        throw std::logic_error("capture: write after finish");
+    }
+    if (block.channels() != channel_count_) {
+        throw std::invalid_argument("capture: chunk channel count mismatch");
+    }
+    if (first_sample < next_sample_) {
+        throw std::invalid_argument("capture: chunks must be written in sample order");
+    }
+    if (block.samples() == 0) {
+        return;
+    }
+    const std::size_t run_bytes = block.samples() * sizeof(std::int16_t);
+    if (run_bytes * channel_count_ > UINT32_MAX) {
+        throw std::invalid_argument("capture: chunk too large");
+    }
+
+    pad_to(capture::kChunkAlignment);
+    capture::ChunkIndexEntry entry{};
+    entry.offset = offset_;
+    entry.first_sample = first_sample;
+    entry.sample_count = static_cast<std::uint32_t>(block.samples());
+    entry.payload_bytes = static_cast<std::uint32_t>(run_bytes * channel_count_);
+    entry.encoding = capture::ChunkEncoding::Raw;
+
+    if (block.stride() == block.samples()) {
+        write_all(block.data(), entry.payload_bytes);
+    } else {
+        for (std::size_t c = 0; c < channel_count_; ++c) {
+            write_all(block.channel(c).data(), run_bytes);
+        }
+    }
+    index_.push_back(entry);
+    next_sample_ = first_sample + block.samples();
+    total_samples_ += block.samples();
+}
+
+void CaptureWriter::finish() {
+    if (fd_ < 0) {
+        return;
+    }
+    pad_to(capture::kChunkAlignment);
+    capture::FileTrailer trailer{};
+    trailer.index_offset = offset_;
+    trailer.chunk_count = index_.size();
+    trailer.total_samples = total_samples_;
+    trailer.magic = capture::kTrailerMagic;
+    write_all(index_.data(), index_.size() * sizeof(capture::ChunkIndexEntry));
+    write_all(&trailer, sizeof(trailer));
+
+    const int fd = std::exchange(fd_, -1);
+    if (::close(fd) != 0) {
+        throw_errno("capture: close failed");
+    }
+}
+
+void CaptureWriter::write_all(const void* data, std::size_t size) {
+    const auto* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t n = ::write(fd_, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_errno("capture: write failed");
+        }
+        p += n;
+        size -= static_cast<std::size_t>(n);
+        offset_ += static_cast<std::uint64_t>(n);
+    }
+}
+
+void CaptureWriter::pad_to(std::uint64_t alignment) {
+    static constexpr char zeros[capture::kChunkAlignment] = {};
+    const std::uint64_t target = align_up(offset_, alignment);
+    write_all(zeros, target - offset_);
+}
+
+// ---- CaptureReader ---------------------------------------------------------
+
+CaptureReader::CaptureReader(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw_errno("capture: cannot open " + path.string());
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "capture: fstat failed");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ < sizeof(capture::FileHeader) + sizeof(capture::FileTrailer)) {
+        ::close(fd);
+        throw std::runtime_error("capture: file too short: " + path.string());
+    }
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    const int map_err = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::system_error(map_err, std::generic_category(), "capture: mmap failed");
+    }
+    base_ = static_cast<const std::byte*>(map);
+
+    try {
+        info_ = capture::decode_header({base_, size_});
+
+        capture::FileTrailer trailer;
+        std::memcpy(&trailer, base_ + size_ - sizeof(trailer), sizeof(trailer));
+        if (trailer.magic != capture::kTrailerMagic) {
+            throw std::runtime_error("capture: missing trailer (unfinished recording?)");
+        }
+        // Divided rather than multiplied: a corrupt chunk_count must not wrap
+        // the index size into range.
+        const std::uint64_t header_bytes =
+            sizeof(capture::FileHeader) + channel_count() * sizeof(capture::ChannelDescriptor);
+        if (trailer.index_offset % alignof(capture::ChunkIndexEntry) != 0 ||
+            trailer.index_offset < header_bytes || trailer.index_offset > size_ - sizeof(trailer) ||
+            trailer.chunk_count >
+                (size_ - sizeof(trailer) - trailer.index_offset) / sizeof(capture::ChunkIndexEntry)) {
+            throw std::runtime_error("capture: chunk index out of bounds");
+        }
+        index_ = {reinterpret_cast<const capture::ChunkIndexEntry*>(base_ + trailer.index_offset),
+                  static_cast<std::size_t>(trailer.chunk_count)};
+        total_samples_ = trailer.total_samples;
+
+        std::uint64_t next_sample = 0;
+        for (const capture::ChunkIndexEntry& e : index_) {
+            // find_chunk() bisects on first_sample.
+            if (e.first_sample < next_sample ||
+                e.sample_count > std::numeric_limits<std::uint64_t>::max() - e.first_sample) {
+                throw std::runtime_error("capture: chunk index not in sample order");
+            }
+            next_sample = e.first_sample + e.sample_count;
+            if (e.offset < header_bytes || e.offset > trailer.index_offset ||
+                e.payload_bytes > trailer.index_offset - e.offset) {
+                throw std::runtime_error("capture: chunk payload out of bounds");
+            }
+            switch (e.encoding) {
+            case capture::ChunkEncoding::Raw:
+                if (e.offset % alignof(std::int16_t) != 0 ||
+                    e.payload_bytes != std::uint64_t{e.sample_count} * channel_count() *
+                                           sizeof(std::int16_t)) {
+                    throw std::runtime_error("capture: raw chunk size mismatch");
+                }
+                break;
+            case capture::ChunkEncoding::DeltaRice:
+                if (e.payload_bytes < channel_count() * sizeof(std::uint32_t)) {
+                    throw std::runtime_error("capture: compressed chunk too short");
+                }
+                break;
+            default:
+                throw std::runtime_error("capture: unknown chunk encoding " +
+                                         std::to_string(static_cast<unsigned>(e.encoding)));
+            }
+        }
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+CaptureReader::~CaptureReader() { unmap(); }
+
+CaptureReader::CaptureReader(CaptureReader&& other) noexcept
+    : base_(std::exchange(other.base_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      info_(std::move(other.info_)),
+      index_(std::exchange(other.index_, {})),
+      total_samples_(std::exchange(other.total_samples_, 0)) {}
+
+CaptureReader& CaptureReader::operator=(CaptureReader&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        base_ = std::exchange(other.base_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        info_ = std::move(other.info_);
+        index_ = std::exchange(other.index_, {});
+        total_samples_ = std::exchange(other.total_samples_, 0);
+    }
+    return *this;
+}
+
+std::span<const std::int16_t> CaptureReader::channel(std::size_t chunk,
+                                                     std::size_t channel) const {
+    return chunk_block(chunk).channel(channel);
+}
+
+ChannelBlock<const std::int16_t> CaptureReader::chunk_block(std::size_t chunk) const {
+    const capture::ChunkIndexEntry& e = index_[chunk];
+    if (e.encoding != capture::ChunkEncoding::Raw) {
+        throw std::logic_error("capture: chunk is not stored raw");
+    }
+    return {reinterpret_cast<const std::int16_t*>(base_ + e.offset), channel_count(),
+            e.sample_count};
+}
+
+void CaptureReader::read_channel(std::size_t chunk, std::size_t channel,
+                                 std::span<std::int16_t> out) const {
+    const capture::ChunkIndexEntry& e = index_[chunk];
+    if (channel >= channel_count() || out.size() < e.sample_count) {
+        throw std::invalid_argument("capture: read_channel output too small");
+    }
+    out = out.first(e.sample_count);
+    if (e.encoding == capture::ChunkEncoding::Raw) {
+        const std::span<const std::int16_t> in = this->channel(chunk, channel);
+        std::copy(in.begin(), in.end(), out.begin());
+        return;
+    }
+    if (!decode_delta_rice_chunk({base_ + e.offset, e.payload_bytes}, channel_count(), channel, out)) {
+        throw std::runtime_error("capture: corrupt compressed chunk " + std::to_string(chunk));
+    }
+}
+
+std::size_t CaptureReader::find_chunk(std::uint64_t sample) const noexcept {
+    const auto it = std::upper_bound(
+        index_.begin(), index_.end(), sample,
+        [](std::uint64_t s, const capture::ChunkIndexEntry& e) { return s < e.first_sample; });
+    if (it == index_.begin()) {
+        return index_.size();
+    }
+    const auto& e = *(it - 1);
+    if (sample >= e.first_sample + e.sample_count) {
+        return index_.size();
+    }
+    return static_cast<std::size_t>(it - 1 - index_.begin());
+}
+
+void CaptureReader::advise_sequential() const noexcept {
+    if (base_ != nullptr) {
+        ::madvise(const_cast<std::byte*>(base_), size_, MADV_SEQUENTIAL);
+    }
+}
+
+void CaptureReader::unmap() noexcept {
+    if (base_ != nullptr) {
+        ::munmap(const_cast<std::byte*>(base_), size_);
+        base_ = nullptr;
+    }
+}
+
+}  // namespace srm
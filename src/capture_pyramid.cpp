@@ -0,0 +1,532 @@
+#include "srm/capture_pyramid.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+using pyramid::kBinsPerPage;
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::size_t page_bins(std::size_t channels) noexcept { return channels * kBinsPerPage; }
+
+}  // namespace
+
+std::filesystem::path pyramid_path(const std::filesystem::path& capture_path) {
+    std::filesystem::path p = capture_path;
+    p.replace_extension(".srmpyr");
+    return p;
+}
+
+// ---- PyramidBuilder ---------------------------------------------------------
+
+PyramidBuilder::PyramidBuilder(const std::filesystem::path& path, std::size_t channels,
+                               double sample_rate_hz, const PyramidConfig& config)
+    : channel_count_(channels), ratio_(config.ratio) {
+    if (config.finest_factor == 0 || config.ratio < 2 || config.levels == 0) {
+        throw std::invalid_argument("pyramid: factor, ratio and level count must be positive");
+    }
+    if (channels == 0 || channels >= capture::kNoChannel) {
+        throw std::invalid_argument("pyramid: channel count out of range");
+    }
+    levels_.resize(config.levels);
+    std::uint64_t samples_per_bin = config.finest_factor;
+    for (std::size_t l = 0; l < levels_.size(); ++l) {
+        Level& level = levels_[l];
+        level.samples_per_bin = samples_per_bin;
+        level.acc.resize(channels);
+        level.page.resize(page_bins(channels));
+        if (l + 1 < levels_.size() && samples_per_bin > UINT64_MAX / 2 / config.ratio) {
+            throw std::invalid_argument("pyramid: too many levels");
+        }
+        samples_per_bin *= config.ratio;
+    }
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw_errno("pyramid: cannot create " + path.string());
+    }
+    pyramid::FileHeader header{};
+    header.magic = pyramid::kFileMagic;
+    header.version = pyramid::kFormatVersion;
+    header.channel_count = static_cast<std::uint16_t>(channels);
+    header.level_count = static_cast<std::uint16_t>(levels_.size());
+    header.finest_factor = config.finest_factor;
+    header.ratio = config.ratio;
+    header.bins_per_page = kBinsPerPage;
+    header.sample_rate_hz = sample_rate_hz;
+    write_all(&header, sizeof(header));
+}
+
+PyramidBuilder::~PyramidBuilder() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+void PyramidBuilder::add(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample) {
+    SRM_SCOPED_TIMER("pyramid_add");
+    if (fd_ < 0) {
+        throw std::logic_error("pyramid: add after finish");
+    }
+    if (block.channels() != channel_count_) {
+        throw std::invalid_argument("pyramid: channel count mismatch");
+    }
+    if (first_sample < next_sample_) {
+        throw std::invalid_argument("pyramid: samples must be added in order");
+    }
+    Level& base = levels_[0];
+    const std::uint64_t factor = base.samples_per_bin;
+    std::size_t i = 0;
+    while (i < block.samples()) {
+        const std::uint64_t bin = (first_sample + i) / factor;
+        if (bin != base.bin) {
+            if (base.has_data) {
+                close_bin(0);
+            }
+            skip_to(0, bin);
+        }
+        const std::size_t end = static_cast<std::size_t>(
+            std::min<std::uint64_t>(block.samples(), (bin + 1) * factor - first_sample));
+        for (std::size_t c = 0; c < channel_count_; ++c) {
+            const std::int16_t* x = block.channel(c).data();
+            Accumulator& a = base.acc[c];
+            std::int32_t lo = a.min;
+            std::int32_t hi = a.max;
+            std::int64_t sum = 0;
+            for (std::size_t j = i; j < end; ++j) {
+                lo = std::min<std::int32_t>(lo, x[j]);
+                hi = std::max<std::int32_t>(hi, x[j]);
+                sum += x[j];
+            }
+            a.min = lo;
+            a.max = hi;
+            a.sum += sum;
+            a.count += end - i;
+        }
+        base.has_data = true;
+        i = end;
+    }
+    next_sample_ = first_sample + block.samples();
+}
+
+void PyramidBuilder::merge(std::size_t level, std::uint64_t bin,
+                           std::span<const Accumulator> column) {
+    Level& l = levels_[level];
+    if (bin != l.bin) {
+        if (l.has_data) {
+            close_bin(level);
+        }
+        skip_to(level, bin);
+    }
+    for (std::size_t c = 0; c < channel_count_; ++c) {
+        Accumulator& a = l.acc[c];
+        a.min = std::min(a.min, column[c].min);
+        a.max = std::max(a.max, column[c].max);
+        a.sum += column[c].sum;
+        a.count += column[c].count;
+    }
+    l.has_data = true;
+}
+
+void PyramidBuilder::close_bin(std::size_t level) {
+    Level& l = levels_[level];
+    const std::size_t slot = static_cast<std::size_t>(l.bin - l.page_first_bin);
+    for (std::size_t c = 0; c < channel_count_; ++c) {
+        const Accumulator& a = l.acc[c];
+        PyramidBin& out = l.page[c * kBinsPerPage + slot];
+        out.min = static_cast<std::int16_t>(a.min);
+        out.max = static_cast<std::int16_t>(a.max);
+        out.mean = static_cast<float>(static_cast<double>(a.sum) / static_cast<double>(a.count));
+    }
+    l.page_has_data = true;
+    // Parents only ever close their own bins, so l.acc is intact here.
+    if (level + 1 < levels_.size()) {
+        merge(level + 1, l.bin / ratio_, l.acc);
+    }
+    std::fill(l.acc.begin(), l.acc.end(), Accumulator{});
+    l.has_data = false;
+    if (++l.bin == l.page_first_bin + kBinsPerPage) {
+        flush_page(level);
+    }
+}
+
+void PyramidBuilder::skip_to(std::size_t level, std::uint64_t bin) {
+    Level& l = levels_[level];
+    while (l.bin < bin) {
+        const std::uint64_t page_end = l.page_first_bin + kBinsPerPage;
+        if (l.bin == l.page_first_bin && !l.page_has_data && bin >= page_end) {
+            // Whole page inside a gap: index it as empty without writing it.
+            l.page_offsets.push_back(0);
+            l.page_first_bin = page_end;
+            l.bin = page_end;
+            continue;
+        }
+        l.bin = std::min(bin, page_end);
+        if (l.bin == page_end) {
+            flush_page(level);
+        }
+    }
+}
+
+void PyramidBuilder::flush_page(std::size_t level) {
+    Level& l = levels_[level];
+    if (l.page_has_data) {
+        pad_to(capture::kChunkAlignment);
+        l.page_offsets.push_back(offset_);
+        write_all(l.page.data(), l.page.size() * sizeof(PyramidBin));
+        std::fill(l.page.begin(), l.page.end(), PyramidBin{});
+    } else {
+        l.page_offsets.push_back(0);
+    }
+    l.page_first_bin += kBinsPerPage;
+    l.page_has_data = false;
+}
+
+void PyramidBuilder::finish() {
+    if (fd_ < 0) {
+        return;
+    }
+    std::vector<pyramid::LevelDescriptor> descriptors(levels_.size());
+    for (std::size_t level = 0; level < levels_.size(); ++level) {
+        Level& l = levels_[level];
+        const std::uint64_t bins = (next_sample_ + l.samples_per_bin - 1) / l.samples_per_bin;
+        if (l.has_data) {
+            close_bin(level);  // feeds the parent before it is finished below
+        }
+        skip_to(level, bins);
+        if (l.bin > l.page_first_bin) {
+            flush_page(level);
+        }
+        descriptors[level].samples_per_bin = l.samples_per_bin;
+        descriptors[level].bin_count = bins;
+        descriptors[level].page_count = l.page_offsets.size();
+    }
+    for (std::size_t level = 0; level < levels_.size(); ++level) {
+        pad_to(alignof(std::uint64_t));
+        descriptors[level].index_offset = offset_;
+        const std::vector<std::uint64_t>& pages = levels_[level].page_offsets;
+        write_all(pages.data(), pages.size() * sizeof(std::uint64_t));
+    }
+    pyramid::FileTrailer trailer{};
+    trailer.levels_offset = offset_;
+    trailer.total_samples = next_sample_;
+    trailer.magic = pyramid::kTrailerMagic;
+    write_all(descriptors.data(), descriptors.size() * sizeof(pyramid::LevelDescriptor));
+    write_all(&trailer, sizeof(trailer));
+
+    const int fd = std::exchange(fd_, -1);
+    if (::close(fd) != 0) {
+        throw_errno("pyramid: close failed");
+    }
+}
+
+void PyramidBuilder::write_all(const void* data, std::size_t size) {
+    const auto* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t n = ::write(fd_, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_errno("pyramid: write failed");
+        }
+        p += n;
+        size -= static_cast<std::size_t>(n);
+        offset_ += static_cast<std::uint64_t>(n);
+    }
+}
+
+void PyramidBuilder::pad_to(std::uint64_t alignment) {
+    static constexpr char zeros[capture::kChunkAlignment] = {};
+    const std::uint64_t target = align_up(offset_, alignment);
+    write_all(zeros, target - offset_);
+}
+
+void build_pyramid(const CaptureReader& capture, const std::filesystem::path& path,
+                   const PyramidConfig& config) {
+    PyramidBuilder builder(path, capture.channel_count(), capture.info().sample_rate_hz, config);
+    ChannelBuffer<std::int16_t> decoded;
+    for (std::size_t k = 0; k < capture.chunk_count(); ++k) {
+        const capture::ChunkIndexEntry& e = capture.chunks()[k];
+        if (capture.is_raw(k)) {
+            builder.add(capture.chunk_block(k), e.first_sample);
+            continue;
+        }
+        if (decoded.samples() != e.sample_count) {
+            decoded = ChannelBuffer<std::int16_t>(capture.channel_count(), e.sample_count);
+        }
+        for (std::size_t c = 0; c < capture.channel_count(); ++c) {
+            capture.read_channel(k, c, decoded.channel(c));
+        }
+        builder.add(decoded.view(), e.first_sample);
+    }
+    builder.finish();
+}
+
+// ---- PyramidReader ----------------------------------------------------------
+
+PyramidReader::PyramidReader(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw_errno("pyramid: cannot open " + path.string());
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "pyramid: fstat failed");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ < sizeof(pyramid::FileHeader) + sizeof(pyramid::FileTrailer)) {
+        ::close(fd);
+        throw std::runtime_error("pyramid: file too short: " + path.string());
+    }
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    const int map_err = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::system_error(map_err, std::generic_category(), "pyramid: mmap failed");
+    }
+    base_ = static_cast<const std::byte*>(map);
+
+    try {
+        std::memcpy(&header_, base_, sizeof(header_));
+        if (header_.magic != pyramid::kFileMagic) {
+            throw std::runtime_error("pyramid: not a pyramid file");
+        }
+        if (header_.version != pyramid::kFormatVersion) {
+            throw std::runtime_error("pyramid: unsupported version " +
+                                     std::to_string(header_.version));
+        }
+        if (header_.channel_count == 0 || header_.bins_per_page != kBinsPerPage) {
+            throw std::runtime_error("pyramid: malformed header");
+        }
+        pyramid::FileTrailer trailer;
+        std::memcpy(&trailer, base_ + size_ - sizeof(trailer), sizeof(trailer));
+        if (trailer.magic != pyramid::kTrailerMagic) {
+            throw std::runtime_error("pyramid: missing trailer (unfinished recording?)");
+        }
+        const std::uint64_t levels_bytes =
+            std::uint64_t{header_.level_count} * sizeof(pyramid::LevelDescriptor);
+        if (trailer.levels_offset % alignof(pyramid::LevelDescriptor) != 0 ||
+            trailer.levels_offset > size_ - sizeof(trailer) ||
+            levels_bytes > size_ - sizeof(trailer) - trailer.levels_offset) {
+            throw std::runtime_error("pyramid: level table out of bounds");
+        }
+        levels_ = {reinterpret_cast<const pyramid::LevelDescriptor*>(base_ + trailer.levels_offset),
+                   header_.level_count};
+        total_samples_ = trailer.total_samples;
+
+        const std::uint64_t page_bytes = page_bins(channel_count()) * sizeof(PyramidBin);
+        for (const pyramid::LevelDescriptor& d : levels_) {
+            if (d.samples_per_bin == 0 ||
+                d.page_count != (d.bin_count + kBinsPerPage - 1) / kBinsPerPage ||
+                d.index_offset % alignof(std::uint64_t) != 0 ||
+                d.index_offset > trailer.levels_offset ||
+                d.page_count > (trailer.levels_offset - d.index_offset) / sizeof(std::uint64_t)) {
+                throw std::runtime_error("pyramid: level index out of bounds");
+            }
+            const auto* pages = reinterpret_cast<const std::uint64_t*>(base_ + d.index_offset);
+            for (std::uint64_t p = 0; p < d.page_count; ++p) {
+                if (pages[p] != 0 && (pages[p] % alignof(PyramidBin) != 0 ||
+                                      pages[p] > trailer.levels_offset ||
+                                      page_bytes > trailer.levels_offset - pages[p])) {
+                    throw std::runtime_error("pyramid: page out of bounds");
+                }
+            }
+        }
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+PyramidReader::~PyramidReader() { unmap(); }
+
+PyramidReader::PyramidReader(PyramidReader&& other) noexcept
+    : base_(std::exchange(other.base_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      header_(other.header_),
+      levels_(std::exchange(other.levels_, {})),
+      total_samples_(std::exchange(other.total_samples_, 0)) {}
+
+PyramidReader& PyramidReader::operator=(PyramidReader&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        base_ = std::exchange(other.base_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        header_ = other.header_;
+        levels_ = std::exchange(other.levels_, {});
+        total_samples_ = std::exchange(other.total_samples_, 0);
+    }
+    return *this;
+}
+
+PyramidBin PyramidReader::bin(std::size_t level, std::size_t channel,
+                              std::uint64_t bin) const noexcept {
+    const pyramid::LevelDescriptor& d = levels_[level];
+    if (bin >= d.bin_count) {
+        return {};
+    }
+    std::uint64_t page;
+    std::memcpy(&page, base_ + d.index_offset + bin / kBinsPerPage * sizeof(page), sizeof(page));
+    if (page == 0) {
+        return {};
+    }
+    PyramidBin out;
+    std::memcpy(&out, base_ + page + (channel * kBinsPerPage + bin % kBinsPerPage) * sizeof(out),
+                sizeof(out));
+    return out;
+}
+
+void PyramidReader::unmap() noexcept {
+    if (base_ != nullptr) {
+        ::munmap(const_cast<std::byte*>(base_), size_);
+        base_ = nullptr;
+    }
+}
+
+// ---- CaptureOverview --------------------------------------------------------
+
+namespace {
+
+/// Column accumulator shared by the pyramid and raw paths.
+struct Column {
+    std::int16_t min = std::numeric_limits<std::int16_t>::max();
+    std::int16_t max = std::numeric_limits<std::int16_t>::min();
+    double sum = 0.0;
+    std::uint64_t count = 0;
+
+    void add(std::int16_t lo, std::int16_t hi, double value) noexcept {
+        min = std::min(min, lo);
+        max = std::max(max, hi);
+        sum += value;
+        ++count;
+    }
+
+    PyramidBin bin() const noexcept {
+        PyramidBin out;
+        if (count != 0) {
+            out.min = min;
+            out.max = max;
+            out.mean = static_cast<float>(sum / static_cast<double>(count));
+        }
+        return out;
+    }
+};
+
+/// First sample of column @p column of @p columns over @p length samples,
+/// without overflowing for long ranges.
+std::uint64_t column_start(std::uint64_t length, std::size_t columns, std::size_t column) noexcept {
+    return length / columns * column + length % columns * column / columns;
+}
+
+}  // namespace
+
+CaptureOverview::CaptureOverview(const CaptureReader& capture, const PyramidReader& pyramid)
+    : capture_(capture), pyramid_(pyramid) {
+    if (capture.channel_count() != pyramid.channel_count()) {
+        throw std::invalid_argument("pyramid: sidecar does not match the capture");
+    }
+}
+
+int CaptureOverview::view(std::size_t channel, std::uint64_t first, std::uint64_t last,
+                          std::span<PyramidBin> out) const {
+    if (channel >= capture_.channel_count()) {
+        throw std::invalid_argument("pyramid: channel out of range");
+    }
+    if (out.empty()) {
+        return -1;
+    }
+    last = std::max(first, last);
+    const std::uint64_t length = last - first;
+    const std::uint64_t per_column = length / out.size();
+
+    int level = -1;
+    for (std::size_t l = 0; l < pyramid_.level_count(); ++l) {
+        if (pyramid_.samples_per_bin(l) <= per_column) {
+            level = static_cast<int>(l);
+        }
+    }
+    if (level < 0) {
+        view_raw(channel, first, last, out);
+        return -1;
+    }
+
+    // Bins straddling a column edge count towards both columns, so the
+    // envelope never misses a peak; the mean weights bins equally.
+    const std::uint64_t factor = pyramid_.samples_per_bin(static_cast<std::size_t>(level));
+    for (std::size_t p = 0; p < out.size(); ++p) {
+        const std::uint64_t a = first + column_start(length, out.size(), p);
+        const std::uint64_t b = first + column_start(length, out.size(), p + 1);
+        Column column;
+        for (std::uint64_t k = a / factor; k < (b + factor - 1) / factor; ++k) {
+            const PyramidBin bin = pyramid_.bin(static_cast<std::size_t>(level), channel, k);
+            if (!bin.empty()) {
+                column.add(bin.min, bin.max, bin.mean);
+            }
+        }
+        out[p] = column.bin();
+    }
+    return level;
+}
+
+void CaptureOverview::view_raw(std::size_t channel, std::uint64_t first, std::uint64_t last,
+                               std::span<PyramidBin> out) const {
+    const std::uint64_t length = last - first;
+    std::vector<Column> columns(out.size());
+    const std::span<const capture::ChunkIndexEntry> chunks = capture_.chunks();
+    // First chunk ending after `first`.
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), first,
+                               [](std::uint64_t s, const capture::ChunkIndexEntry& e) {
+                                   return s < e.first_sample + e.sample_count;
+                               });
+    for (; it != chunks.end() && it->first_sample < last; ++it) {
+        const auto k = static_cast<std::size_t>(it - chunks.begin());
+        std::span<const std::int16_t> samples;
+        if (capture_.is_raw(k)) {
+            samples = capture_.channel(k, channel);
+        } else {
+            decoded_.resize(it->sample_count);
+            capture_.read_channel(k, channel, decoded_);
+            samples = decoded_;
+        }
+        const std::uint64_t begin = std::max(first, it->first_sample);
+        const std::uint64_t end = std::min(last, it->first_sample + it->sample_count);
+        for (std::uint64_t s = begin; s < end; ++s) {
+            const std::int16_t x = samples[static_cast<std::size_t>(s - it->first_sample)];
+            // The last column starting at or before s (see column_start());
+            // length < out.size() * finest_factor here, so this cannot overflow.
+            const std::uint64_t column = ((s - first + 1) * out.size() - 1) / length;
+            columns[static_cast<std::size_t>(column)].add(x, x, x);
+        }
+    }
+    for (std::size_t p = 0; p < out.size(); ++p) {
+        out[p] = columns[p].bin();
+    }
+}
+
+}  // namespace srm
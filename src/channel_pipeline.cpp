@@ -0,0 +1,44 @@
+#include "srm/channel_pipeline.hpp"
+
+#include <string>
+
+namespace srm {
+
+namespace detail {
+
+void check_channels(std::size_t given, std::size_t expected) {
+    if (given != expected) {
+        throw std::invalid_argument("pipeline: " + std::to_string(given) + " channels for a " +
+                                    std::to_string(expected) + "-channel pipeline");
+    }
+}
+
+}  // namespace detail
+
+void DynamicPipeline::process(ChannelBlock<const std::int16_t> in) {
+    detail::check_channels(in.channels(), channels_);
+    if (stages_.empty()) {
+        return;
+    }
+    DynamicStage& head = *stages_.front();
+    for (std::size_t c = 0; c < channels_; ++c) {
+        for (const std::int16_t x : in.channel(c)) {
+            head.push(c, static_cast<float>(x));
+        }
+    }
+}
+
+void DynamicPipeline::reset() {
+    for (const std::unique_ptr<DynamicStage>& stage : stages_) {
+        stage->reset();
+    }
+}
+
+void DynamicPipeline::append(std::unique_ptr<DynamicStage> stage) {
+    if (!stages_.empty()) {
+        stages_.back()->set_next(stage.get());
+    }
+    stages_.push_back(std::move(stage));
+}
+
+}  // namespace srm
@@ -0,0 +1,71 @@
+#include "srm/commutation_index.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace srm {
+
+std::span<const std::uint64_t> CommutationIndex::edges(std::size_t phase, EdgeKind kind,
+                                                       std::uint64_t first_sample,
+                                                       std::uint64_t end_sample) const noexcept {
+    const std::span<const std::uint64_t> all = edges(phase, kind);
+    const auto begin = std::lower_bound(all.begin(), all.end(), first_sample);
+    const auto end = std::lower_bound(begin, all.end(), end_sample);
+    return {begin, end};
+}
+
+void CommutationIndex::append(std::size_t phase, EdgeKind kind, std::uint64_t sample) {
+    std::pmr::vector<std::uint64_t>& list = kind == EdgeKind::TurnOn ? on_[phase] : off_[phase];
+    if (!list.empty() && sample < list.back()) {
+        throw std::invalid_argument("commutation index: edges must be appended in order");
+    }
+    list.push_back(sample);
+}
+
+std::size_t CommutationIndex::memory_bytes() const noexcept {
+    std::size_t bytes = 0;
+    for (std::size_t p = 0; p < on_.size(); ++p) {
+        bytes += (on_[p].capacity() + off_[p].capacity()) * sizeof(std::uint64_t);
+    }
+    return bytes;
+}
+
+CommutationIndexBuilder::CommutationIndexBuilder(std::span<const EdgeDetectorConfig> phases,
+                                                 std::pmr::memory_resource* memory)
+    : index_(phases.size(), memory) {
+    for (const EdgeDetectorConfig& config : phases) {
+        if (config.off_threshold > config.on_threshold) {
+            throw std::invalid_argument("commutation index: off threshold above on threshold");
+        }
+        phases_.push_back(PhaseState{config});
+    }
+}
+
+void CommutationIndexBuilder::push(ChannelBlock<const float> phase_currents) {
+    if (phase_currents.channels() != phases_.size()) {
+        throw std::invalid_argument("commutation index: phase channel count mismatch");
+    }
+    for (std::size_t p = 0; p < phases_.size(); ++p) {
+        PhaseState& state = phases_[p];
+        const std::span<const float> current = phase_currents.channel(p);
+        for (std::size_t i = 0; i < current.size(); ++i) {
+            const float x = current[i];
+            const bool crossing = state.conducting ? x < state.config.off_threshold
+                                                   : x >= state.config.on_threshold;
+            if (!crossing) {
+                continue;
+            }
+            const std::uint64_t sample = sample_ + i;
+            if (state.seen_edge && sample - state.last_edge < state.config.min_dwell) {
+                continue;
+            }
+            index_.append(p, state.conducting ? EdgeKind::TurnOff : EdgeKind::TurnOn, sample);
+            state.conducting = !state.conducting;
+            state.last_edge = sample;
+            state.seen_edge = true;
+        }
+    }
+    sample_ += phase_currents.samples();
+}
+
+}  // namespace srm
@@ -0,0 +1,517 @@
+#include "srm/dashboard_feed.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "srm/instrumentation.hpp"
+#include "srm/strain_conversion.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SRM_DASHBOARD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace srm {
+
+namespace {
+
+static_assert(std::is_trivially_copyable_v<ChannelStatistics>);
+static_assert(std::is_trivially_copyable_v<WaveformPoint>);
+
+/// Copies that lose a race with the publisher are retried this often
+/// before a read gives up.
+constexpr unsigned kReadRetries = 8;
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+using dashboard::Accumulator;
+
+// A kernel folds @p n samples of one channel into points of @p spp samples,
+// continuing the open point @p e that already holds @p fill of them. It
+// writes the points it completes to @p done and returns their number. Each
+// point's vector lanes are combined at its end, so sums differ from the
+// scalar order only by float reassociation.
+using Kernel = std::size_t (*)(const float* x, std::size_t n, std::size_t spp, Accumulator& e, std::size_t& fill,
+                               Accumulator* done) noexcept;
+
+constexpr Accumulator kEmpty = {std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), 0.0f};
+
+/// The point loop shared by every kernel, inlined into each so that one
+/// point's reduction overlaps the next point's loads.
+template <typename Reduce>
+[[gnu::always_inline]] inline std::size_t fold_points(Reduce reduce, const float* x, std::size_t n, std::size_t spp,
+                                                      Accumulator& e, std::size_t& fill, Accumulator* done) noexcept {
+    // Locals, so the open point stays in registers rather than aliasing
+    // @p done.
+    Accumulator open = e;
+    std::size_t filled = fill;
+    std::size_t points = 0;
+    for (std::size_t pos = 0; pos < n;) {
+        const std::size_t take = std::min(n - pos, spp - filled);
+        reduce(x + pos, take, open);
+        pos += take;
+        filled += take;
+        if (filled == spp) {
+            done[points++] = open;
+            open = kEmpty;
+            filled = 0;
+        }
+    }
+    e = open;
+    fill = filled;
+    return points;
+}
+
+[[gnu::always_inline]] inline void reduce_scalar(const float* x, std::size_t n, Accumulator& e) noexcept {
+    float lo = e.min;
+    float hi = e.max;
+    float sum = 0.0f;
+    for (std::size_t i = 0; i < n; ++i) {
+        lo = x[i] < lo ? x[i] : lo;
+        hi = x[i] > hi ? x[i] : hi;
+        sum += x[i];
+    }
+    e = {lo, hi, e.sum + sum};
+}
+
+std::size_t fold_scalar(const float* x, std::size_t n, std::size_t spp, Accumulator& e, std::size_t& fill,
+                        Accumulator* done) noexcept {
+    return fold_points(reduce_scalar, x, n, spp, e, fill, done);
+}
+
+#if defined(SRM_DASHBOARD_X86)
+
+// Two independent accumulators per quantity hide the add latency; min and
+// max take the accumulator as second operand, so a NaN sample is skipped
+// exactly as in reduce_scalar().
+[[gnu::always_inline]] inline __attribute__((target("avx2"))) void reduce_avx2(const float* x, std::size_t n,
+                                                                              Accumulator& e) noexcept {
+    __m256 lo[2] = {_mm256_set1_ps(e.min), _mm256_set1_ps(e.min)};
+    __m256 hi[2] = {_mm256_set1_ps(e.max), _mm256_set1_ps(e.max)};
+    __m256 sum[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        for (int k = 0; k < 2; ++k) {
+            const __m256 v = _mm256_loadu_ps(x + i + 8 * k);
+            lo[k] = _mm256_min_ps(v, lo[k]);
+            hi[k] = _mm256_max_ps(v, hi[k]);
+            sum[k] = _mm256_add_ps(sum[k], v);
+        }
+    }
+    if (i + 8 <= n) {
+        const __m256 v = _mm256_loadu_ps(x + i);
+        lo[0] = _mm256_min_ps(v, lo[0]);
+        hi[0] = _mm256_max_ps(v, hi[0]);
+        sum[0] = _mm256_add_ps(sum[0], v);
+        i += 8;
+    }
+    alignas(32) float l[8], h[8], s[8];
+    _mm256_store_ps(l, _mm256_min_ps(lo[0], lo[1]));
+    _mm256_store_ps(h, _mm256_max_ps(hi[0], hi[1]));
+    _mm256_store_ps(s, _mm256_add_ps(sum[0], sum[1]));
+    float total = 0.0f;
+    for (int k = 0; k < 8; ++k) {
+        e.min = l[k] < e.min ? l[k] : e.min;
+        e.max = h[k] > e.max ? h[k] : e.max;
+        total += s[k];
+    }
+    e.sum += total;
+    reduce_scalar(x + i, n - i, e);
+}
+
+__attribute__((target("avx2"))) std::size_t fold_avx2(const float* x, std::size_t n, std::size_t spp, Accumulator& e,
+                                                      std::size_t& fill, Accumulator* done) noexcept {
+    return fold_points(reduce_avx2, x, n, spp, e, fill, done);
+}
+
+// GCC 12's avx512fintrin.h trips -W(maybe-)uninitialized on its own
+// _mm512_undefined_* placeholders.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+[[gnu::always_inline]] inline __attribute__((target("avx512f"))) void reduce_avx512(const float* x, std::size_t n,
+                                                                                  Accumulator& e) noexcept {
+    __m512 lo[4], hi[4], sum[4];
+    for (int k = 0; k < 4; ++k) {
+        lo[k] = _mm512_set1_ps(e.min);
+        hi[k] = _mm512_set1_ps(e.max);
+        sum[k] = _mm512_setzero_ps();
+    }
+    // A masked head up to the next cache line: points start anywhere, and
+    // split loads would cost the main loop 40%.
+    std::size_t i = std::min<std::size_t>(n, (64 - reinterpret_cast<std::uintptr_t>(x) % 64) % 64 / sizeof(float));
+    if (i != 0) {
+        const auto m = static_cast<__mmask16>((1u << i) - 1);
+        const __m512 v = _mm512_maskz_loadu_ps(m, x);
+        lo[1] = _mm512_mask_min_ps(lo[1], m, v, lo[1]);
+        hi[1] = _mm512_mask_max_ps(hi[1], m, v, hi[1]);
+        sum[1] = _mm512_add_ps(sum[1], v);
+    }
+    for (; i + 64 <= n; i += 64) {
+        for (int k = 0; k < 4; ++k) {
+            const __m512 v = _mm512_load_ps(x + i + 16 * k);
+            lo[k] = _mm512_min_ps(v, lo[k]);
+            hi[k] = _mm512_max_ps(v, hi[k]);
+            sum[k] = _mm512_add_ps(sum[k], v);
+        }
+    }
+    // At most four more registers, the last one masked. Indexing the
+    // accumulators by a loop variable here would spill them all.
+    for (; i < n; i += 16) {
+        const __mmask16 m = n - i >= 16 ? __mmask16{0xffff} : static_cast<__mmask16>((1u << (n - i)) - 1);
+        const __m512 v = _mm512_maskz_loadu_ps(m, x + i);
+        lo[0] = _mm512_mask_min_ps(lo[0], m, v, lo[0]);
+        hi[0] = _mm512_mask_max_ps(hi[0], m, v, hi[0]);
+        sum[0] = _mm512_add_ps(sum[0], v);
+    }
+    const float l = _mm512_reduce_min_ps(_mm512_min_ps(_mm512_min_ps(lo[0], lo[1]), _mm512_min_ps(lo[2], lo[3])));
+    const float h = _mm512_reduce_max_ps(_mm512_max_ps(_mm512_max_ps(hi[0], hi[1]), _mm512_max_ps(hi[2], hi[3])));
+    e.min = l < e.min ? l : e.min;
+    e.max = h > e.max ? h : e.max;
+    e.sum += _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(sum[0], sum[1]), _mm512_add_ps(sum[2], sum[3])));
+}
+
+__attribute__((target("avx512f"))) std::size_t fold_avx512(const float* x, std::size_t n, std::size_t spp,
+                                                           Accumulator& e, std::size_t& fill,
+                                                           Accumulator* done) noexcept {
+    return fold_points(reduce_avx512, x, n, spp, e, fill, done);
+}
+#pragma GCC diagnostic pop
+
+#endif  // SRM_DASHBOARD_X86
+
+Kernel best_kernel() noexcept {
+    static const Kernel kernel = [] {
+#if defined(SRM_DASHBOARD_X86)
+        switch (best_simd_path()) {
+        case SimdPath::Avx512:
+            return fold_avx512;
+        case SimdPath::Avx2:
+            return fold_avx2;
+        default:
+            break;
+        }
+#endif
+        return fold_scalar;
+    }();
+    return kernel;
+}
+
+}  // namespace
+
+namespace dashboard {
+
+Layout layout(const FileHeader& header) noexcept {
+    const std::size_t channels = header.channel_count;
+    Layout l{};
+    l.control = sizeof(FileHeader);
+    l.waveform = align_up(l.control + sizeof(Control), 64);
+    l.statistics = align_up(l.waveform + std::size_t{header.waveform_capacity} * channels * sizeof(WaveformPoint), 64);
+    l.statistics_stride = align_up(channels * sizeof(ChannelStatistics), 64);
+    l.spectrum = l.statistics + 2 * l.statistics_stride;
+    l.spectrum_stride = align_up(sizeof(SpectrumMeta) + channels * header.spectrum_points * sizeof(float), 64);
+    l.file_bytes = l.spectrum + 2 * l.spectrum_stride;
+    return l;
+}
+
+}  // namespace dashboard
+
+// ---- DashboardPublisher -----------------------------------------------------
+
+DashboardPublisher::DashboardPublisher(const std::filesystem::path& path, std::size_t channels,
+                                       double sample_rate_hz, const DashboardConfig& config)
+    : path_(path), channels_(channels), config_(config), capacity_(2 * config.waveform_points), acc_(channels) {
+    if (channels == 0 || config.samples_per_point == 0 || config.waveform_points == 0 ||
+        config.spectrum_points == 0) {
+        throw std::invalid_argument("dashboard: channels and sizes must be positive");
+    }
+    if (channels > std::numeric_limits<std::uint32_t>::max() ||
+        capacity_ > std::numeric_limits<std::uint32_t>::max() ||
+        config.spectrum_points > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("dashboard: feed too large");
+    }
+    dashboard::FileHeader header{};
+    header.magic = dashboard::kFileMagic;
+    header.version = dashboard::kFormatVersion;
+    header.channel_count = static_cast<std::uint32_t>(channels);
+    header.waveform_capacity = static_cast<std::uint32_t>(capacity_);
+    header.spectrum_points = static_cast<std::uint32_t>(config.spectrum_points);
+    header.samples_per_point = config.samples_per_point;
+    header.sample_rate_hz = sample_rate_hz;
+    layout_ = dashboard::layout(header);
+    header.file_bytes = layout_.file_bytes;
+
+    // A new inode: viewers still mapping the previous feed keep it, marked
+    // closed, instead of having it truncated under them.
+    ::unlink(path.c_str());
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw_errno("dashboard: cannot create " + path.string());
+    }
+    if (::ftruncate(fd, static_cast<off_t>(layout_.file_bytes)) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "dashboard: cannot size " + path.string());
+    }
+    void* map = ::mmap(nullptr, layout_.file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int map_err = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::system_error(map_err, std::generic_category(), "dashboard: cannot map " + path.string());
+    }
+    base_ = static_cast<std::byte*>(map);
+    std::memcpy(base_, &header, sizeof(header));
+    control_ = new (base_ + layout_.control) dashboard::Control();
+    ring_ = reinterpret_cast<WaveformPoint*>(base_ + layout_.waveform);
+    reset_accumulators();
+    control_->state.store(static_cast<std::uint64_t>(dashboard::FeedState::Live), std::memory_order_release);
+}
+
+DashboardPublisher::~DashboardPublisher() {
+    control_->state.store(static_cast<std::uint64_t>(dashboard::FeedState::Closed), std::memory_order_release);
+    ::munmap(base_, layout_.file_bytes);
+}
+
+void DashboardPublisher::reset_accumulators() noexcept {
+    std::fill(acc_.begin(), acc_.end(), kEmpty);
+}
+
+void DashboardPublisher::add_waveform(ChannelBlock<const float> block) {
+    if (block.channels() != channels_) {
+        throw std::invalid_argument("dashboard: " + std::to_string(block.channels()) + " channels for a " +
+                                    std::to_string(channels_) + "-channel feed");
+    }
+    // Not under SRM_SCOPED_TIMER: at about 100 ns a timer would cost as much
+    // as folding a whole block. BM_DashboardFeed measures it instead.
+    const std::size_t spp = config_.samples_per_point;
+    const std::size_t n = block.samples();
+    const std::uint64_t completed = points_ + (fill_ + n) / spp;
+    if (completed > points_) {
+        control_->waveform.begun.store(completed, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    const float scale = 1.0f / static_cast<float>(spp);
+    const Kernel fold = best_kernel();
+    const std::size_t points = completed - points_;
+    if (done_.size() < points) {
+        done_.resize(points);  // once per block size: the first block that long
+    }
+    const std::size_t first_slot = points_ % capacity_;
+    for (std::size_t c = 0; c < channels_; ++c) {
+        std::size_t fill = fill_;
+        fold(block.channel(c).data(), n, spp, acc_[c], fill, done_.data());
+        // Wrapped by hand: a division per point costs more than its fold.
+        std::size_t slot = first_slot;
+        for (std::size_t p = 0; p < points; ++p) {
+            const Accumulator& a = done_[p];
+            ring_[slot * channels_ + c] = {a.min, a.max, a.sum * scale};
+            slot = slot + 1 == capacity_ ? 0 : slot + 1;
+        }
+    }
+    fill_ = (fill_ + n) % spp;
+    if (completed > points_) {
+        points_ = completed;
+        control_->waveform.published.store(completed, std::memory_order_release);
+    }
+}
+
+void DashboardPublisher::publish_spectrum(const SpectrumFrame& frame) {
+    const ChannelBlock<const float> amplitude = frame.amplitude;
+    if (amplitude.channels() != channels_) {
+        throw std::invalid_argument("dashboard: spectrum channel count mismatch");
+    }
+    SRM_SCOPED_TIMER("dashboard_spectrum");
+    const std::size_t bins = amplitude.samples();
+    const std::size_t per_point =
+        std::max<std::size_t>(1, (bins + config_.spectrum_points - 1) / config_.spectrum_points);
+    const std::size_t points = (bins + per_point - 1) / per_point;
+
+    const std::uint64_t version = ++spectra_;
+    control_->spectrum.begun.store(version, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::byte* slot = base_ + layout_.spectrum + (version % 2) * layout_.spectrum_stride;
+    dashboard::SpectrumMeta meta{};
+    meta.frame_index = frame.index;
+    meta.end_sample = frame.end_sample;
+    meta.source_bins = static_cast<std::uint32_t>(bins);
+    meta.bins_per_point = static_cast<std::uint32_t>(per_point);
+    meta.points = static_cast<std::uint32_t>(points);
+    std::memcpy(slot, &meta, sizeof(meta));
+    auto* out = reinterpret_cast<float*>(slot + sizeof(meta));
+    for (std::size_t c = 0; c < channels_; ++c) {
+        const float* a = amplitude.channel(c).data();
+        float* o = out + c * config_.spectrum_points;
+        // Max-pooling keeps every peak visible at display resolution.
+        for (std::size_t p = 0; p < points; ++p) {
+            const std::size_t end = std::min(bins, (p + 1) * per_point);
+            float peak = a[p * per_point];
+            for (std::size_t b = p * per_point + 1; b < end; ++b) {
+                peak = a[b] > peak ? a[b] : peak;
+            }
+            o[p] = peak;
+        }
+    }
+    control_->spectrum.published.store(version, std::memory_order_release);
+}
+
+void DashboardPublisher::publish_statistics(const StrainStatistics& statistics) {
+    if (statistics.channel_count() != channels_) {
+        throw std::invalid_argument("dashboard: statistics channel count mismatch");
+    }
+    // Summaries first: estimating quantiles must not widen the window in
+    // which a reader can be overtaken.
+    std::vector<ChannelStatistics> summaries(channels_);
+    for (std::size_t c = 0; c < channels_; ++c) {
+        summaries[c] = statistics.summary(c);
+    }
+    const std::uint64_t version = ++statistics_;
+    control_->statistics.begun.store(version, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(base_ + layout_.statistics + (version % 2) * layout_.statistics_stride, summaries.data(),
+                channels_ * sizeof(ChannelStatistics));
+    control_->statistics.published.store(version, std::memory_order_release);
+}
+
+// ---- DashboardReader --------------------------------------------------------
+
+DashboardReader::DashboardReader(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw_errno("dashboard: cannot open " + path.string());
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "dashboard: cannot stat " + path.string());
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ < sizeof(dashboard::FileHeader) + sizeof(dashboard::Control)) {
+        ::close(fd);
+        throw std::runtime_error("dashboard: " + path.string() + " is not a dashboard feed");
+    }
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    const int map_err = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::system_error(map_err, std::generic_category(), "dashboard: cannot map " + path.string());
+    }
+    base_ = static_cast<const std::byte*>(map);
+    std::memcpy(&header_, base_, sizeof(header_));
+    layout_ = dashboard::layout(header_);
+    if (header_.magic != dashboard::kFileMagic || header_.version != dashboard::kFormatVersion ||
+        header_.channel_count == 0 || header_.file_bytes != layout_.file_bytes || layout_.file_bytes > size_) {
+        ::munmap(const_cast<std::byte*>(base_), size_);
+        throw std::runtime_error("dashboard: " + path.string() + " is not a version " +
+                                 std::to_string(dashboard::kFormatVersion) + " dashboard feed");
+    }
+    control_ = reinterpret_cast<const dashboard::Control*>(base_ + layout_.control);
+}
+
+DashboardReader::~DashboardReader() { ::munmap(const_cast<std::byte*>(base_), size_); }
+
+bool DashboardReader::closed() const noexcept {
+    return control_->state.load(std::memory_order_acquire) ==
+           static_cast<std::uint64_t>(dashboard::FeedState::Closed);
+}
+
+std::size_t DashboardReader::read_waveform(std::size_t points, WaveformWindow& out) const {
+    const std::size_t channels = header_.channel_count;
+    const std::uint64_t capacity = header_.waveform_capacity;
+    const auto* ring = reinterpret_cast<const WaveformPoint*>(base_ + layout_.waveform);
+    out.channels = channels;
+    for (unsigned attempt = 0; attempt < kReadRetries; ++attempt) {
+        const std::uint64_t written = control_->waveform.published.load(std::memory_order_acquire);
+        const std::uint64_t n = std::min<std::uint64_t>({points, written, capacity});
+        std::uint64_t first = written - n;
+        out.values.resize(n * channels);
+        for (std::uint64_t i = first; i < written; ++i) {
+            std::memcpy(&out.values[(i - first) * channels], ring + (i % capacity) * channels,
+                        channels * sizeof(WaveformPoint));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const std::uint64_t begun = control_->waveform.begun.load(std::memory_order_relaxed);
+        // Points below begun - capacity may have been overwritten mid-copy.
+        const std::uint64_t oldest = begun > capacity ? begun - capacity : 0;
+        if (oldest >= written && n > 0) {
+            continue;
+        }
+        if (first < oldest) {
+            out.values.erase(out.values.begin(),
+                             out.values.begin() + static_cast<std::ptrdiff_t>((oldest - first) * channels));
+            first = oldest;
+        }
+        out.first_point = first;
+        out.points = static_cast<std::size_t>(written - first);
+        return out.points;
+    }
+    out.points = 0;
+    out.values.clear();
+    return 0;
+}
+
+bool DashboardReader::read_spectrum(SpectrumSnapshot& out) const {
+    const std::size_t stride = header_.spectrum_points;
+    for (unsigned attempt = 0; attempt < kReadRetries; ++attempt) {
+        const std::uint64_t version = control_->spectrum.published.load(std::memory_order_acquire);
+        if (version == 0) {
+            return false;
+        }
+        const std::byte* slot = base_ + layout_.spectrum + (version % 2) * layout_.spectrum_stride;
+        dashboard::SpectrumMeta meta;
+        std::memcpy(&meta, slot, sizeof(meta));
+        const std::size_t points = std::min<std::size_t>(meta.points, stride);
+        out.amplitude.resize(header_.channel_count * points);
+        const auto* values = reinterpret_cast<const float*>(slot + sizeof(meta));
+        for (std::size_t c = 0; c < header_.channel_count; ++c) {
+            std::memcpy(&out.amplitude[c * points], values + c * stride, points * sizeof(float));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (control_->spectrum.begun.load(std::memory_order_relaxed) < version + 2) {
+            out.frame_index = meta.frame_index;
+            out.end_sample = meta.end_sample;
+            out.source_bins = meta.source_bins;
+            out.bins_per_point = meta.bins_per_point;
+            out.points = points;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DashboardReader::read_statistics(std::vector<ChannelStatistics>& out) const {
+    for (unsigned attempt = 0; attempt < kReadRetries; ++attempt) {
+        const std::uint64_t version = control_->statistics.published.load(std::memory_order_acquire);
+        if (version == 0) {
+            return false;
+        }
+        out.resize(header_.channel_count);
+        std::memcpy(out.data(), base_ + layout_.statistics + (version % 2) * layout_.statistics_stride,
+                    out.size() * sizeof(ChannelStatistics));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (control_->statistics.begun.load(std::memory_order_relaxed) < version + 2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace srm
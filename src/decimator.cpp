@@ -0,0 +1,319 @@
+#include "srm/decimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "srm/filter_design.hpp"
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+// Eight independent partial sums keep the loop free of a serial dependency,
+// which is what lets the compiler turn it into packed multiply-adds.
+inline float dot(const float* a, const float* b, std::size_t n) noexcept {
+    float acc[8] = {};
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (std::size_t k = 0; k < 8; ++k) {
+            acc[k] += a[i + k] * b[i + k];
+        }
+    }
+    float sum = 0.0f;
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum + ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+}
+
+}  // namespace
+
+// ---- CicDecimator ----------------------------------------------------------
+
+CicDecimator::CicDecimator(unsigned ratio, unsigned order, std::size_t channels)
+    : ratio_(ratio),
+      order_(order),
+      channels_(channels),
+      integrators_(channels * order),
+      combs_(channels * order) {
+    if (ratio < 2 || order == 0 || order * std::log2(static_cast<double>(ratio)) + 16 > 63) {
+        throw std::invalid_argument("cic: ratio/order out of range");
+    }
+    gain_ = static_cast<float>(1.0 / std::pow(static_cast<double>(ratio), order));
+}
+
+void CicDecimator::reset() noexcept {
+    std::fill(integrators_.begin(), integrators_.end(), 0);
+    std::fill(combs_.begin(), combs_.end(), 0);
+    phase_ = 0;
+}
+
+std::size_t CicDecimator::process(ChannelBlock<const std::int16_t> in,
+                                  ChannelBlock<float> out) noexcept {
+    std::size_t produced = 0;
+    unsigned phase = phase_;
+    const double gain = gain_;
+    for (std::size_t c = 0; c < channels_; ++c) {
+        std::uint64_t* integ = &integrators_[c * order_];
+        std::uint64_t* comb = &combs_[c * order_];
+        const std::int16_t* x = in.channel(c).data();
+        float* y = out.channel(c).data();
+        phase = phase_;
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < in.samples(); ++i) {
+            std::uint64_t v = static_cast<std::uint64_t>(static_cast<std::int64_t>(x[i]));
+            for (unsigned o = 0; o < order_; ++o) {
+                integ[o] += v;
+                v = integ[o];
+            }
+            if (++phase == ratio_) {
+                phase = 0;
+                for (unsigned o = 0; o < order_; ++o) {
+                    const std::uint64_t t = v;
+                    v -= comb[o];
+                    comb[o] = t;
+                }
+                y[k++] = static_cast<float>(static_cast<double>(static_cast<std::int64_t>(v)) * gain);
+            }
+        }
+        produced = k;
+    }
+    phase_ = phase;
+    return produced;
+}
+
+// ---- FirDecimator ----------------------------------------------------------
+
+FirDecimator::FirDecimator(std::span<const float> taps, unsigned factor, std::size_t channels,
+                           std::size_t max_block)
+    : reversed_(taps.rbegin(), taps.rend()),
+      factor_(factor),
+      history_(taps.size() - 1),
+      max_block_(max_block),
+      line_(channels, taps.size() - 1 + max_block) {
+    if (taps.empty() || factor == 0 || max_block == 0) {
+        throw std::invalid_argument("fir decimator: empty filter, zero factor or block");
+    }
+}
+
+void FirDecimator::reset() noexcept {
+    for (std::size_t c = 0; c < line_.channels(); ++c) {
+        std::fill_n(line_.channel(c).data(), history_, 0.0f);
+    }
+    phase_ = 0;
+}
+
+std::size_t FirDecimator::process(ChannelBlock<const float> in, ChannelBlock<float> out) noexcept {
+    std::size_t produced = 0;
+    for (std::size_t pos = 0; pos < in.samples(); pos += max_block_) {
+        const std::size_t n = std::min(max_block_, in.samples() - pos);
+        produced += process_piece(in.subblock(pos, n), out, produced);
+    }
+    return produced;
+}
+
+std::size_t FirDecimator::process_piece(ChannelBlock<const float> in, ChannelBlock<float> out,
+                                        std::size_t out_offset) noexcept {
+    const std::size_t n = in.samples();
+    const std::size_t taps = history_ + 1;
+    std::size_t k = 0;
+    for (std::size_t c = 0; c < in.channels(); ++c) {
+        float* line = line_.channel(c).data();
+        std::memcpy(line + history_, in.channel(c).data(), n * sizeof(float));
+        float* y = out.channel(c).data() + out_offset;
+        k = 0;
+        for (std::size_t j = phase_; j < n; j += factor_) {
+            y[k++] = dot(reversed_.data(), line + j, taps);
+        }
+        std::memmove(line, line + n, history_ * sizeof(float));
+    }
+    phase_ = phase_ + k * factor_ - n;
+    return k;
+}
+
+// ---- HalfbandDecimator -----------------------------------------------------
+
+HalfbandDecimator::HalfbandDecimator(std::span<const float> taps, std::size_t channels,
+                                     std::size_t max_block)
+    : history_(taps.size() - 1), max_block_(max_block), line_(channels, taps.size() - 1 + max_block) {
+    if (taps.size() % 4 != 3 || max_block == 0) {
+        throw std::invalid_argument("half-band decimator: taps must be 4k + 3");
+    }
+    const std::size_t centre = history_ / 2;
+    for (std::size_t off = 1; off <= centre; off += 2) {
+        side_.push_back(taps[centre - off]);
+    }
+}
+
+void HalfbandDecimator::reset() noexcept {
+    for (std::size_t c = 0; c < line_.channels(); ++c) {
+        std::fill_n(line_.channel(c).data(), history_, 0.0f);
+    }
+    phase_ = 0;
+}
+
+std::size_t HalfbandDecimator::process(ChannelBlock<const float> in,
+                                       ChannelBlock<float> out) noexcept {
+    std::size_t produced = 0;
+    for (std::size_t pos = 0; pos < in.samples(); pos += max_block_) {
+        const std::size_t n = std::min(max_block_, in.samples() - pos);
+        produced += process_piece(in.subblock(pos, n), out, produced);
+    }
+    return produced;
+}
+
+std::size_t HalfbandDecimator::process_piece(ChannelBlock<const float> in,
+                                             ChannelBlock<float> out,
+                                             std::size_t out_offset) noexcept {
+    const std::size_t n = in.samples();
+    const std::size_t centre = history_ / 2;
+    const std::size_t pairs = side_.size();
+    std::size_t k = 0;
+    for (std::size_t c = 0; c < in.channels(); ++c) {
+        float* line = line_.channel(c).data();
+        std::memcpy(line + history_, in.channel(c).data(), n * sizeof(float));
+        float* y = out.channel(c).data() + out_offset;
+        k = 0;
+        for (std::size_t j = phase_; j < n; j += 2) {
+            const float* mid = line + j + centre;
+            float acc = 0.5f * mid[0];
+            for (std::size_t p = 0; p < pairs; ++p) {
+                const std::size_t off = 2 * p + 1;
+                acc += side_[p] * (mid[-static_cast<std::ptrdiff_t>(off)] + mid[off]);
+            }
+            y[k++] = acc;
+        }
+        std::memmove(line, line + n, history_ * sizeof(float));
+    }
+    phase_ = phase_ + k * 2 - n;
+    return k;
+}
+
+// ---- DecimationChain -------------------------------------------------------
+
+namespace {
+
+std::vector<float> compensator_taps(const DecimationChainConfig& config) {
+    if (config.compensator_taps % 2 == 0 || config.compensator_taps > kMaxDesignTaps) {
+        throw std::invalid_argument("decimation chain: compensator taps must be odd and <= " +
+                                    std::to_string(kMaxDesignTaps));
+    }
+    const std::span<const float> baked = precomputed_cic_compensator(
+        config.cic_ratio, config.cic_order, config.compensator_taps);
+    if (!baked.empty()) {
+        return {baked.begin(), baked.end()};
+    }
+    std::vector<float> taps(config.compensator_taps);
+    design_cic_compensator(taps.data(), taps.size(), config.cic_ratio, config.cic_order);
+    return taps;
+}
+
+std::vector<float> halfband_taps(const DecimationChainConfig& config) {
+    if (config.halfband_taps == kHalfbandTaps) {
+        return {kHalfband31.begin(), kHalfband31.end()};
+    }
+    if (config.halfband_taps % 4 != 3 || config.halfband_taps > kMaxDesignTaps) {
+        throw std::invalid_argument("decimation chain: half-band taps must be 4k + 3");
+    }
+    std::vector<float> taps(config.halfband_taps);
+    design_halfband(taps.data(), taps.size());
+    return taps;
+}
+
+std::size_t cic_block(const DecimationChainConfig& config) {
+    return config.max_block / config.cic_ratio + 1;
+}
+
+std::span<const float> checked_compensator(const DecimationChainConfig& config, const DecimationTaps& taps) {
+    if (taps.compensator.size() != config.compensator_taps) {
+        throw std::invalid_argument("decimation chain: " + std::to_string(taps.compensator.size()) +
+                                    " compensator taps given for " + std::to_string(config.compensator_taps));
+    }
+    return taps.compensator;
+}
+
+}  // namespace
+
+DecimationTaps design_decimation_taps(const DecimationChainConfig& config) {
+    DecimationTaps taps;
+    taps.compensator = compensator_taps(config);
+    if (config.halfband_stages > 0) {
+        taps.halfband = halfband_taps(config);
+    }
+    return taps;
+}
+
+DecimationChain::DecimationChain(const DecimationChainConfig& config, std::size_t channels)
+    : DecimationChain(config, channels, design_decimation_taps(config)) {}
+
+DecimationChain::DecimationChain(const DecimationChainConfig& config, std::size_t channels,
+                                 const DecimationTaps& taps)
+    : config_(config),
+      factor_(config.cic_ratio * (2u << config.halfband_stages)),
+      cic_(config.cic_ratio, config.cic_order, channels),
+      compensator_(checked_compensator(config, taps), 2, channels, cic_block(config)) {
+    if (config.max_block < config.cic_ratio) {
+        throw std::invalid_argument("decimation chain: max_block below CIC ratio");
+    }
+    if (config.halfband_stages > 0 && taps.halfband.size() != config.halfband_taps) {
+        throw std::invalid_argument("decimation chain: " + std::to_string(taps.halfband.size()) +
+                                    " half-band taps given for " + std::to_string(config.halfband_taps));
+    }
+    std::size_t block = cic_block(config);
+    stage_buffers_.emplace_back(channels, block);
+    for (unsigned s = 0; s < config.halfband_stages; ++s) {
+        block = block / 2 + 1;
+        stage_buffers_.emplace_back(channels, block);
+        halfbands_.emplace_back(taps.halfband, channels, block);
+    }
+}
+
+void DecimationChain::reset() noexcept {
+    cic_.reset();
+    compensator_.reset();
+    for (HalfbandDecimator& hb : halfbands_) {
+        hb.reset();
+    }
+}
+
+std::size_t DecimationChain::process(ChannelBlock<const std::int16_t> in,
+                                     ChannelBlock<float> out) {
+    // The stages index their state by channel, so a block of any other
+    // width would read or write past it.
+    if (in.channels() != channels() || out.channels() != channels()) {
+        throw std::invalid_argument("decimation chain: " + std::to_string(in.channels()) + " in and " +
+                                    std::to_string(out.channels()) + " out channels for a " +
+                                    std::to_string(channels()) + "-channel chain");
+    }
+    if (out.samples() < max_output(in.samples())) {
+        throw std::invalid_argument("decimation chain: output block too small");
+    }
+    SRM_SCOPED_TIMER("decimate");
+    std::size_t produced = 0;
+    for (std::size_t pos = 0; pos < in.samples(); pos += config_.max_block) {
+        const std::size_t n = std::min(config_.max_block, in.samples() - pos);
+        std::size_t m = cic_.process(in.subblock(pos, n), stage_buffers_[0].view());
+
+        const ChannelBlock<float> tail = out.subblock(produced, out.samples() - produced);
+        if (halfbands_.empty()) {
+            produced += compensator_.process(stage_buffers_[0].view().subblock(0, m), tail);
+            continue;
+        }
+        m = compensator_.process(stage_buffers_[0].view().subblock(0, m), stage_buffers_[1].view());
+        for (std::size_t s = 0; s < halfbands_.size(); ++s) {
+            const ChannelBlock<const float> src = stage_buffers_[s + 1].view().subblock(0, m);
+            if (s + 1 == halfbands_.size()) {
+                m = halfbands_[s].process(src, tail);
+            } else {
+                m = halfbands_[s].process(src, stage_buffers_[s + 2].view());
+            }
+        }
+        produced += m;
+    }
+    return produced;
+}
+
+}  // namespace srm
@@ -0,0 +1,239 @@
+#include "srm/deinterleave.hpp"
+
+#include <string>
+
+#include "srm/aligned.hpp"
+#include "srm/instrumentation.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SRM_DEINTERLEAVE_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SRM_DEINTERLEAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace srm {
+
+namespace {
+
+// A kernel transposes as many leading samples of @p out as its shuffles
+// cover and leaves the rest to deinterleave_scalar().
+using Kernel = std::size_t (*)(const std::int16_t* frames, ChannelBlock<std::int16_t> out) noexcept;
+
+void deinterleave_scalar(const std::int16_t* frames, ChannelBlock<std::int16_t> out, std::size_t first) noexcept {
+    const std::size_t n = out.channels();
+    std::int16_t* data = out.data();
+    for (std::size_t i = first; i < out.samples(); ++i) {
+        const std::int16_t* frame = frames + i * n;
+        for (std::size_t c = 0; c < n; ++c) {
+            data[c * out.stride() + i] = frame[c];
+        }
+    }
+}
+
+std::size_t kernel_none(const std::int16_t*, ChannelBlock<std::int16_t>) noexcept { return 0; }
+
+#if defined(SRM_DEINTERLEAVE_X86)
+
+// Each 128-bit lane of r[k] holds one 8-channel frame: lane 0 frame k, lane
+// 1 frame 8 + k. Three rounds of interleaving unpacks (16-, 32-, then 64-bit)
+// transpose both 8x8 halves at once, leaving channel c's 16 consecutive
+// samples in r[c].
+__attribute__((target("avx2"))) inline void transpose8x16_avx2(__m256i r[8]) noexcept {
+    __m256i a[8];
+    for (int k = 0; k < 4; ++k) {
+        a[k] = _mm256_unpacklo_epi16(r[2 * k], r[2 * k + 1]);
+        a[k + 4] = _mm256_unpackhi_epi16(r[2 * k], r[2 * k + 1]);
+    }
+    // a[0..3]: channels 0-3 of row pairs (0,1) (2,3) (4,5) (6,7); a[4..7]: 4-7.
+    __m256i b[8];
+    for (int h = 0; h < 2; ++h) {
+        const __m256i* s = a + 4 * h;
+        b[4 * h + 0] = _mm256_unpacklo_epi32(s[0], s[1]);  // ch 0,1 rows 0-3
+        b[4 * h + 1] = _mm256_unpackhi_epi32(s[0], s[1]);  // ch 2,3 rows 0-3
+        b[4 * h + 2] = _mm256_unpacklo_epi32(s[2], s[3]);  // ch 0,1 rows 4-7
+        b[4 * h + 3] = _mm256_unpackhi_epi32(s[2], s[3]);  // ch 2,3 rows 4-7
+    }
+    for (int h = 0; h < 2; ++h) {
+        const __m256i* s = b + 4 * h;
+        r[4 * h + 0] = _mm256_unpacklo_epi64(s[0], s[2]);
+        r[4 * h + 1] = _mm256_unpackhi_epi64(s[0], s[2]);
+        r[4 * h + 2] = _mm256_unpacklo_epi64(s[1], s[3]);
+        r[4 * h + 3] = _mm256_unpackhi_epi64(s[1], s[3]);
+    }
+}
+
+__attribute__((target("avx2"))) inline __m256i load_lanes(const std::int16_t* lo, const std::int16_t* hi) noexcept {
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)), 1);
+}
+
+__attribute__((target("avx2"))) std::size_t deinterleave_avx2(const std::int16_t* frames,
+                                                               ChannelBlock<std::int16_t> out) noexcept {
+    const std::size_t n = out.channels();
+    const std::size_t samples = out.samples() / 16 * 16;
+    if (n == 4) {
+        // Two frames per lane: lanes of r[k] hold frames 2k, 2k+1 and 8+2k, 9+2k.
+        for (std::size_t i = 0; i < samples; i += 16) {
+            const std::int16_t* f = frames + i * 4;
+            __m256i r[4];
+            for (int k = 0; k < 4; ++k) {
+                r[k] = load_lanes(f + 8 * k, f + 32 + 8 * k);
+            }
+            const __m256i t0 = _mm256_unpacklo_epi16(r[0], r[1]);  // frames 0,2
+            const __m256i t1 = _mm256_unpackhi_epi16(r[0], r[1]);  // frames 1,3
+            const __m256i t2 = _mm256_unpacklo_epi16(r[2], r[3]);
+            const __m256i t3 = _mm256_unpackhi_epi16(r[2], r[3]);
+            const __m256i u0 = _mm256_unpacklo_epi16(t0, t1);      // ch 0,1 frames 0-3
+            const __m256i u1 = _mm256_unpackhi_epi16(t0, t1);      // ch 2,3 frames 0-3
+            const __m256i u2 = _mm256_unpacklo_epi16(t2, t3);      // ch 0,1 frames 4-7
+            const __m256i u3 = _mm256_unpackhi_epi16(t2, t3);      // ch 2,3 frames 4-7
+            const __m256i ch[4] = {_mm256_unpacklo_epi64(u0, u2), _mm256_unpackhi_epi64(u0, u2),
+                                   _mm256_unpacklo_epi64(u1, u3), _mm256_unpackhi_epi64(u1, u3)};
+            for (std::size_t c = 0; c < 4; ++c) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.channel(c).data() + i), ch[c]);
+            }
+        }
+        return samples;
+    }
+    if (n % 8 != 0) {
+        return 0;
+    }
+    for (std::size_t g = 0; g < n; g += 8) {
+        for (std::size_t i = 0; i < samples; i += 16) {
+            const std::int16_t* f = frames + i * n + g;
+            __m256i r[8];
+            for (std::size_t k = 0; k < 8; ++k) {
+                r[k] = load_lanes(f + k * n, f + (k + 8) * n);
+            }
+            transpose8x16_avx2(r);
+            for (std::size_t c = 0; c < 8; ++c) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.channel(g + c).data() + i), r[c]);
+            }
+        }
+    }
+    return samples;
+}
+
+#endif  // SRM_DEINTERLEAVE_X86
+
+#if defined(SRM_DEINTERLEAVE_NEON)
+
+// The same unpack rounds as the AVX2 kernel with zip1/zip2, one 8x8 block.
+inline void transpose8x8_neon(int16x8_t r[8]) noexcept {
+    int16x8_t a[8];
+    for (int k = 0; k < 4; ++k) {
+        a[k] = vzip1q_s16(r[2 * k], r[2 * k + 1]);
+        a[k + 4] = vzip2q_s16(r[2 * k], r[2 * k + 1]);
+    }
+    int32x4_t b[8];
+    for (int h = 0; h < 2; ++h) {
+        const int32x4_t s0 = vreinterpretq_s32_s16(a[4 * h + 0]);
+        const int32x4_t s1 = vreinterpretq_s32_s16(a[4 * h + 1]);
+        const int32x4_t s2 = vreinterpretq_s32_s16(a[4 * h + 2]);
+        const int32x4_t s3 = vreinterpretq_s32_s16(a[4 * h + 3]);
+        b[4 * h + 0] = vzip1q_s32(s0, s1);
+        b[4 * h + 1] = vzip2q_s32(s0, s1);
+        b[4 * h + 2] = vzip1q_s32(s2, s3);
+        b[4 * h + 3] = vzip2q_s32(s2, s3);
+    }
+    for (int h = 0; h < 2; ++h) {
+        const int64x2_t s0 = vreinterpretq_s64_s32(b[4 * h + 0]);
+        const int64x2_t s1 = vreinterpretq_s64_s32(b[4 * h + 1]);
+        const int64x2_t s2 = vreinterpretq_s64_s32(b[4 * h + 2]);
+        const int64x2_t s3 = vreinterpretq_s64_s32(b[4 * h + 3]);
+        r[4 * h + 0] = vreinterpretq_s16_s64(vzip1q_s64(s0, s2));
+        r[4 * h + 1] = vreinterpretq_s16_s64(vzip2q_s64(s0, s2));
+        r[4 * h + 2] = vreinterpretq_s16_s64(vzip1q_s64(s1, s3));
+        r[4 * h + 3] = vreinterpretq_s16_s64(vzip2q_s64(s1, s3));
+    }
+}
+
+std::size_t deinterleave_neon(const std::int16_t* frames, ChannelBlock<std::int16_t> out) noexcept {
+    const std::size_t n = out.channels();
+    const std::size_t samples = out.samples() / 8 * 8;
+    if (n == 4) {
+        for (std::size_t i = 0; i < samples; i += 8) {
+            const int16x8x4_t ch = vld4q_s16(frames + i * 4);
+            for (std::size_t c = 0; c < 4; ++c) {
+                vst1q_s16(out.channel(c).data() + i, ch.val[c]);
+            }
+        }
+        return samples;
+    }
+    if (n % 8 != 0) {
+        return 0;
+    }
+    for (std::size_t g = 0; g < n; g += 8) {
+        for (std::size_t i = 0; i < samples; i += 8) {
+            const std::int16_t* f = frames + i * n + g;
+            int16x8_t r[8];
+            for (std::size_t k = 0; k < 8; ++k) {
+                r[k] = vld1q_s16(f + k * n);
+            }
+            transpose8x8_neon(r);
+            for (std::size_t c = 0; c < 8; ++c) {
+                vst1q_s16(out.channel(g + c).data() + i, r[c]);
+            }
+        }
+    }
+    return samples;
+}
+
+#endif  // SRM_DEINTERLEAVE_NEON
+
+Kernel kernel_for(SimdPath path) noexcept {
+    switch (path) {
+#if defined(SRM_DEINTERLEAVE_X86)
+    case SimdPath::Avx2:
+    case SimdPath::Avx512:
+        return deinterleave_avx2;
+#endif
+#if defined(SRM_DEINTERLEAVE_NEON)
+    case SimdPath::Neon:
+        return deinterleave_neon;
+#endif
+    default:
+        return kernel_none;
+    }
+}
+
+void run(Kernel kernel, std::span<const std::int16_t> frames, ChannelBlock<std::int16_t> out) {
+    if (frames.size() != out.channels() * out.samples()) {
+        throw std::invalid_argument("deinterleave: " + std::to_string(frames.size()) + " values do not fill " +
+                                    std::to_string(out.channels()) + " x " + std::to_string(out.samples()));
+    }
+    if (out.empty()) {
+        return;
+    }
+    SRM_SCOPED_TIMER("deinterleave");
+    deinterleave_scalar(frames.data(), out, kernel(frames.data(), out));
+}
+
+}  // namespace
+
+std::size_t tile_samples(std::size_t channels, std::size_t tile_bytes) noexcept {
+    constexpr std::size_t per_line = kCacheLineSize / sizeof(std::int16_t);
+    const std::size_t lines = tile_bytes / (std::max<std::size_t>(channels, 1) * kCacheLineSize);
+    return std::max<std::size_t>(lines, 1) * per_line;
+}
+
+void deinterleave(std::span<const std::int16_t> frames, ChannelBlock<std::int16_t> out) {
+    static const Kernel kernel = kernel_for(best_simd_path());
+    run(kernel, frames, out);
+}
+
+void deinterleave(SimdPath path, std::span<const std::int16_t> frames, ChannelBlock<std::int16_t> out) {
+    run(simd_path_supported(path) ? kernel_for(path) : kernel_none, frames, out);
+}
+
+TileDeinterleaver::TileDeinterleaver(std::size_t channels, std::size_t tile_samples_per_channel)
+    : tile_(channels, tile_samples_per_channel != 0 ? tile_samples_per_channel : srm::tile_samples(channels)) {
+    if (channels == 0) {
+        throw std::invalid_argument("deinterleave: no channels");
+    }
+}
+
+}  // namespace srm
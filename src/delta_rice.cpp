@@ -0,0 +1,233 @@
+#include "srm/delta_rice.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace srm {
+
+namespace {
+
+constexpr unsigned kParamBits = 5;
+constexpr unsigned kMaxParam = 16;
+constexpr unsigned kEscapeBits = 17;
+
+std::uint32_t zigzag(std::int32_t d) noexcept {
+    return (static_cast<std::uint32_t>(d) << 1) ^ static_cast<std::uint32_t>(d >> 31);
+}
+
+std::int32_t unzigzag(std::uint32_t u) noexcept {
+    return static_cast<std::int32_t>(u >> 1) ^ -static_cast<std::int32_t>(u & 1);
+}
+
+/// LSB-first bit packer; flushes 32 bits at a time.
+class BitWriter {
+public:
+    explicit BitWriter(std::byte* out) noexcept : out_(out) {}
+
+    /// @p count <= 32, @p bits has no bits set above @p count.
+    void put(std::uint64_t bits, unsigned count) noexcept {
+        acc_ |= bits << fill_;
+        fill_ += count;
+        if (fill_ >= 32) {
+            const auto word = static_cast<std::uint32_t>(acc_);
+            std::memcpy(out_, &word, sizeof(word));
+            out_ += sizeof(word);
+            acc_ >>= 32;
+            fill_ -= 32;
+        }
+    }
+
+    std::byte* finish() noexcept {
+        while (fill_ > 0) {
+            *out_++ = static_cast<std::byte>(acc_ & 0xFF);
+            acc_ >>= 8;
+            fill_ = fill_ > 8 ? fill_ - 8 : 0;
+        }
+        return out_;
+    }
+
+    const std::byte* position() const noexcept { return out_; }
+
+private:
+    std::byte* out_;
+    std::uint64_t acc_ = 0;
+    unsigned fill_ = 0;
+};
+
+/// LSB-first bit reader with a bounds-checked tail.
+class BitReader {
+public:
+    BitReader(const std::byte* begin, const std::byte* end) noexcept : p_(begin), end_(end) {}
+
+    /// Ensures at least 56 bits are buffered unless the input runs out. Bits
+    /// above available() mirror the following input bytes, so OR-ing a
+    /// reloaded word over them is harmless.
+    void refill() noexcept {
+        if (end_ - p_ >= 8) {
+            std::uint64_t word;
+            std::memcpy(&word, p_, sizeof(word));
+            acc_ |= word << fill_;
+            const unsigned bytes = (63 - fill_) >> 3;
+            p_ += bytes;
+            fill_ += bytes * 8;
+        } else {
+            while (fill_ <= 56 && p_ < end_) {
+                acc_ |= static_cast<std::uint64_t>(*p_++) << fill_;
+                fill_ += 8;
+            }
+        }
+    }
+
+    unsigned available() const noexcept { return fill_; }
+    std::uint64_t peek() const noexcept { return acc_; }
+
+    void skip(unsigned count) noexcept {
+        acc_ >>= count;
+        fill_ -= count;
+    }
+
+    std::uint32_t take(unsigned count) noexcept {
+        const auto bits = static_cast<std::uint32_t>(acc_ & ((std::uint64_t{1} << count) - 1));
+        skip(count);
+        return bits;
+    }
+
+private:
+    const std::byte* p_;
+    const std::byte* end_;
+    std::uint64_t acc_ = 0;
+    unsigned fill_ = 0;
+};
+
+/// Rice parameter for a block whose zig-zag values sum to @p sum.
+unsigned choose_param(std::uint64_t sum, std::size_t count) noexcept {
+    const std::uint64_t mean = sum / count;
+    const unsigned k = mean == 0 ? 0 : static_cast<unsigned>(std::bit_width(mean)) - 1;
+    return std::min(k, kMaxParam);
+}
+
+}  // namespace
+
+std::size_t encode_delta_rice(std::span<const std::int16_t> in, std::span<std::byte> out) noexcept {
+    // Worst case of one block, so the inner loop needs no bounds checks.
+    constexpr std::size_t kBlockMaxBytes = delta_rice_max_bytes(kDeltaRiceBlock);
+    BitWriter writer(out.data());
+    const std::byte* const end = out.data() + out.size();
+    std::uint32_t u[kDeltaRiceBlock];
+    std::int32_t prev = 0;
+    for (std::size_t pos = 0; pos < in.size(); pos += kDeltaRiceBlock) {
+        if (static_cast<std::size_t>(end - writer.position()) < kBlockMaxBytes) {
+            return 0;
+        }
+        const std::size_t n = std::min(kDeltaRiceBlock, in.size() - pos);
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::int32_t x = in[pos + i];
+            u[i] = zigzag(x - prev);
+            sum += u[i];
+            prev = x;
+        }
+        const unsigned k = choose_param(sum, n);
+        writer.put(k, kParamBits);
+        const std::uint32_t low_mask = (std::uint32_t{1} << k) - 1;
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::uint32_t q = u[i] >> k;
+            if (q < kDeltaRiceEscape) {
+                writer.put(std::uint64_t{1} << q, q + 1);
+                writer.put(u[i] & low_mask, k);
+            } else {
+                writer.put(std::uint64_t{1} << kDeltaRiceEscape, kDeltaRiceEscape + 1);
+                writer.put(u[i], kEscapeBits);
+            }
+        }
+    }
+    const std::byte* stop = writer.finish();
+    return static_cast<std::size_t>(stop - out.data());
+}
+
+bool decode_delta_rice(std::span<const std::byte> in, std::span<std::int16_t> out) noexcept {
+    BitReader reader(in.data(), in.data() + in.size());
+    std::int32_t prev = 0;
+    for (std::size_t pos = 0; pos < out.size(); pos += kDeltaRiceBlock) {
+        reader.refill();
+        if (reader.available() < kParamBits) {
+            return false;
+        }
+        const unsigned k = reader.take(kParamBits);
+        if (k > kMaxParam) {
+            return false;
+        }
+        const std::size_t n = std::min(kDeltaRiceBlock, out.size() - pos);
+        for (std::size_t i = 0; i < n; ++i) {
+            // Longest code: 25 unary bits + 17 escape bits = 42 <= 56.
+            reader.refill();
+            const std::uint64_t bits = reader.peek();
+            const unsigned q = bits == 0 ? 64u : static_cast<unsigned>(std::countr_zero(bits));
+            if (q > kDeltaRiceEscape || q + 1 > reader.available()) {
+                return false;
+            }
+            reader.skip(q + 1);
+            std::uint32_t u;
+            if (q == kDeltaRiceEscape) {
+                if (reader.available() < kEscapeBits) {
+                    return false;
+                }
+                u = reader.take(kEscapeBits);
+            } else {
+                if (reader.available() < k) {
+                    return false;
+                }
+                u = (q << k) | reader.take(k);
+            }
+            const std::int32_t x = prev + unzigzag(u);
+            if (x < INT16_MIN || x > INT16_MAX) {
+                return false;
+            }
+            out[pos + i] = static_cast<std::int16_t>(x);
+            prev = x;
+        }
+    }
+    return true;
+}
+
+std::size_t encode_delta_rice_chunk(ChannelBlock<const std::int16_t> block,
+                                    std::span<std::byte> out) noexcept {
+    const std::size_t header = block.channels() * sizeof(std::uint32_t);
+    if (out.size() < header) {
+        return 0;
+    }
+    std::size_t used = header;
+    for (std::size_t c = 0; c < block.channels(); ++c) {
+        const std::size_t bytes = encode_delta_rice(block.channel(c), out.subspan(used));
+        if (bytes == 0 && block.samples() != 0) {
+            return 0;
+        }
+        const auto length = static_cast<std::uint32_t>(bytes);
+        std::memcpy(out.data() + c * sizeof(length), &length, sizeof(length));
+        used += bytes;
+    }
+    return used;
+}
+
+bool decode_delta_rice_chunk(std::span<const std::byte> payload, std::size_t channels,
+                             std::size_t channel, std::span<std::int16_t> out) noexcept {
+    const std::size_t header = channels * sizeof(std::uint32_t);
+    if (channel >= channels || payload.size() < header) {
+        return false;
+    }
+    std::size_t offset = header;
+    std::uint32_t length = 0;
+    for (std::size_t c = 0; c <= channel; ++c) {
+        std::memcpy(&length, payload.data() + c * sizeof(length), sizeof(length));
+        if (c < channel) {
+            offset += length;
+        }
+    }
+    if (offset > payload.size() || length > payload.size() - offset) {
+        return false;
+    }
+    return decode_delta_rice(payload.subspan(offset, length), out);
+}
+
+}  // namespace srm
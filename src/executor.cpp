@@ -0,0 +1,154 @@
+#include "srm/executor.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+#include <stdexcept>
+#include <system_error>
+
+namespace srm {
+
+Executor::Executor() {
+    wake_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "executor: eventfd");
+    }
+}
+
+Executor::~Executor() {
+    ::close(wake_fd_);
+}
+
+Executor::IoAwaiter Executor::readable(int fd, Clock::time_point deadline) noexcept {
+    return {*this, fd, POLLIN, deadline};
+}
+
+Executor::IoAwaiter Executor::writable(int fd, Clock::time_point deadline) noexcept {
+    return {*this, fd, POLLOUT, deadline};
+}
+
+void Executor::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard lock(remote_mutex_);
+        remote_.push_back(handle);
+    }
+    const std::uint64_t one = 1;
+    // Only fails when the counter would overflow, i.e. a wake-up is pending.
+    [[maybe_unused]] const ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+}
+
+void Executor::add_timer(Clock::time_point deadline, std::coroutine_handle<> handle) {
+    timers_.push_back({deadline, timer_sequence_++, handle});
+    std::push_heap(timers_.begin(), timers_.end(), std::greater<>{});
+}
+
+void Executor::add_io(IoAwaiter& awaiter, std::coroutine_handle<> handle) {
+    io_.push_back({&awaiter, handle});
+}
+
+void Executor::drive(std::coroutine_handle<> root) {
+    if (running_) {
+        throw std::logic_error("executor: run() is not re-entrant");
+    }
+    running_ = true;
+    struct Stop {
+        Executor& e;
+        ~Stop() {
+            // Nothing outlives the root task, so whatever is left refers to
+            // frames that are gone.
+            e.ready_.clear();
+            e.timers_.clear();
+            e.io_.clear();
+            e.running_ = false;
+        }
+    } stop{*this};
+
+    ready_.push_back(root);
+    for (;;) {
+        while (!ready_.empty()) {
+            const std::coroutine_handle<> handle = ready_.front();
+            ready_.pop_front();
+            ++resumptions_;
+            handle.resume();
+        }
+        if (root.done()) {
+            return;
+        }
+        if (timers_.empty() && io_.empty() && remote_waits_ == 0) {
+            throw std::logic_error("executor: task suspended with nothing left to resume it");
+        }
+        gather();
+    }
+}
+
+void Executor::gather() {
+    Clock::time_point next = Clock::time_point::max();
+    if (!timers_.empty()) {
+        next = timers_.front().deadline;
+    }
+    for (const IoWait& w : io_) {
+        next = std::min(next, w.awaiter->deadline);
+    }
+
+    timespec timeout{};
+    timespec* wait = &timeout;
+    if (ready_.empty()) {
+        if (next == Clock::time_point::max()) {
+            wait = nullptr;
+        } else if (const Clock::time_point now = Clock::now(); next > now) {
+            // yield() queues at time_point::min(), so only subtract forwards.
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next - now).count();
+            timeout.tv_sec = static_cast<time_t>(ns / 1'000'000'000);
+            timeout.tv_nsec = static_cast<long>(ns % 1'000'000'000);
+        }
+    }
+
+    std::vector<pollfd> fds;
+    fds.reserve(io_.size() + 1);
+    fds.push_back({wake_fd_, POLLIN, 0});
+    for (const IoWait& w : io_) {
+        fds.push_back({w.awaiter->fd, w.awaiter->events, 0});
+    }
+    if (::ppoll(fds.data(), fds.size(), wait, nullptr) < 0 && errno != EINTR) {
+        throw std::system_error(errno, std::generic_category(), "executor: ppoll");
+    }
+
+    if (fds[0].revents != 0) {
+        std::uint64_t count = 0;
+        [[maybe_unused]] const ssize_t n = ::read(wake_fd_, &count, sizeof(count));
+    }
+    {
+        std::lock_guard lock(remote_mutex_);
+        ready_.insert(ready_.end(), remote_.begin(), remote_.end());
+        remote_waits_ -= remote_.size();
+        remote_.clear();
+    }
+
+    const Clock::time_point now = Clock::now();
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < io_.size(); ++i) {
+        const IoWait w = io_[i];
+        // Errors and hang-ups count as ready: the read or write reports them.
+        if ((fds[i + 1].revents & (w.awaiter->events | POLLERR | POLLHUP | POLLNVAL)) != 0) {
+            w.awaiter->ready = true;
+            ready_.push_back(w.handle);
+        } else if (w.awaiter->deadline <= now) {
+            ready_.push_back(w.handle);
+        } else {
+            io_[kept++] = w;
+        }
+    }
+    io_.resize(kept);
+
+    while (!timers_.empty() && timers_.front().deadline <= now) {
+        std::pop_heap(timers_.begin(), timers_.end(), std::greater<>{});
+        ready_.push_back(timers_.back().handle);
+        timers_.pop_back();
+    }
+}
+
+}  // namespace srm
@@ -0,0 +1,215 @@
+#include "srm/fft.hpp"
+
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "srm/common.hpp"
+
+namespace srm {
+
+namespace {
+
+using cf = std::complex<float>;
+
+std::complex<double> unit_root(double numerator, double denominator) {
+    const double angle = -2.0 * std::numbers::pi * numerator / denominator;
+    return {std::cos(angle), std::sin(angle)};
+}
+
+// Plain complex product; std::complex operator* goes through __mulsc3 for
+// C99 Annex G inf/nan handling, which costs more than the FFT itself.
+inline cf mul(cf a, cf b) noexcept {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+}  // namespace
+
+FftPlan::FftPlan(std::size_t size) : size_(size) {
+    if (size < 4 || !is_pow2(size)) {
+        throw std::invalid_argument("fft: size must be a power of two >= 4");
+    }
+    const std::size_t half = size / 2;
+
+    bitrev_.resize(half);
+    unsigned bits = 0;
+    while ((std::size_t{1} << bits) < half) {
+        ++bits;
+    }
+    for (std::size_t i = 0; i < half; ++i) {
+        std::uint32_t r = 0;
+        for (unsigned b = 0; b < bits; ++b) {
+            r |= static_cast<std::uint32_t>(((i >> b) & 1u) << (bits - 1 - b));
+        }
+        bitrev_[i] = r;
+    }
+
+    // Stage with butterfly span `len` reads its len/2 twiddles from offset
+    // len/2 - 1, so every stage walks a contiguous run.
+    stage_twiddles_.resize(half > 1 ? half - 1 : 0);
+    for (std::size_t len = 2; len <= half; len <<= 1) {
+        for (std::size_t j = 0; j < len / 2; ++j) {
+            stage_twiddles_[len / 2 - 1 + j] = cf(unit_root(static_cast<double>(j),
+                                                            static_cast<double>(len)));
+        }
+    }
+
+    split_twiddles_.resize(half);
+    for (std::size_t k = 0; k < half; ++k) {
+        split_twiddles_[k] = cf(unit_root(static_cast<double>(k), static_cast<double>(size)));
+    }
+}
+
+FftPlan::FftPlan(std::size_t size, std::span<const std::uint32_t> bit_reversal,
+                 std::span<const cf> stage_twiddles, std::span<const cf> split_twiddles)
+    : size_(size),
+      bitrev_(bit_reversal.begin(), bit_reversal.end()),
+      stage_twiddles_(stage_twiddles.begin(), stage_twiddles.end()),
+      split_twiddles_(split_twiddles.begin(), split_twiddles.end()) {
+    const std::size_t half = size / 2;
+    if (size < 4 || !is_pow2(size) || bitrev_.size() != half || stage_twiddles_.size() != half - 1 ||
+        split_twiddles_.size() != half) {
+        throw std::invalid_argument("fft: tables do not match a plan of size " + std::to_string(size));
+    }
+    // forward() scatters through the table unchecked, so it must be a
+    // permutation of [0, half); a checksum only rules out accidents.
+    std::vector<bool> seen(half);
+    for (const std::uint32_t r : bitrev_) {
+        if (r >= half || seen[r]) {
+            throw std::invalid_argument("fft: bit-reversal table is not a permutation");
+        }
+        seen[r] = true;
+    }
+}
+
+void FftPlan::forward(const float* in, cf* out, cf* z) const noexcept {
+    const std::size_t half = size_ / 2;
+
+    // Pack even/odd samples as one complex sequence, in bit-reversed order.
+    for (std::size_t i = 0; i < half; ++i) {
+        const std::uint32_t r = bitrev_[i];
+        z[r] = cf(in[2 * i], in[2 * i + 1]);
+    }
+
+    for (std::size_t len = 2; len <= half; len <<= 1) {
+        const std::size_t step = len / 2;
+        const cf* tw = stage_twiddles_.data() + step - 1;
+        for (std::size_t base = 0; base < half; base += len) {
+            cf* a = z + base;
+            cf* b = a + step;
+            for (std::size_t j = 0; j < step; ++j) {
+                const cf t = mul(b[j], tw[j]);
+                b[j] = a[j] - t;
+                a[j] = a[j] + t;
+            }
+        }
+    }
+
+    // Split the packed transform into the spectrum of the real input.
+    out[0] = cf(z[0].real() + z[0].imag(), 0.0f);
+    out[half] = cf(z[0].real() - z[0].imag(), 0.0f);
+    for (std::size_t k = 1; k < half; ++k) {
+        const cf zk = z[k];
+        const cf zc = std::conj(z[half - k]);
+        const cf even = 0.5f * (zk + zc);
+        const cf diff = zk - zc;
+        const cf odd(0.5f * diff.imag(), -0.5f * diff.real());  // -i/2 * diff
+        out[k] = even + mul(split_twiddles_[k], odd);
+    }
+}
+
+const char* to_string(WindowType window) noexcept {
+    switch (window) {
+    case WindowType::Rectangular:
+        return "rectangular";
+    case WindowType::Hann:
+        return "hann";
+    case WindowType::Hamming:
+        return "hamming";
+    case WindowType::BlackmanHarris:
+        return "blackman-harris";
+    case WindowType::FlatTop:
+        return "flat-top";
+    }
+    return "unknown";
+}
+
+AlignedVector<float> make_window(WindowType window, std::size_t size) {
+    AlignedVector<float> w(size);
+    const double n = static_cast<double>(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        const double x = 2.0 * std::numbers::pi * static_cast<double>(i) / n;
+        double v = 1.0;
+        switch (window) {
+        case WindowType::Rectangular:
+            v = 1.0;
+            break;
+        case WindowType::Hann:
+            v = 0.5 - 0.5 * std::cos(x);
+            break;
+        case WindowType::Hamming:
+            v = 0.54 - 0.46 * std::cos(x);
+            break;
+        case WindowType::BlackmanHarris:
+            v = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) -
+                0.01168 * std::cos(3 * x);
+            break;
+        case WindowType::FlatTop:
+            v = 0.21557895 - 0.41663158 * std::cos(x) + 0.277263158 * std::cos(2 * x) -
+                0.083578947 * std::cos(3 * x) + 0.006947368 * std::cos(4 * x);
+            break;
+        }
+        w[i] = static_cast<float>(v);
+    }
+    return w;
+}
+
+PlanCache& PlanCache::instance() {
+    static PlanCache cache;
+    return cache;
+}
+
+std::shared_ptr<const FftPlan> PlanCache::fft(std::size_t size) {
+    std::lock_guard lock(mutex_);
+    auto& slot = plans_[size];
+    if (!slot) {
+        slot = std::make_shared<const FftPlan>(size);
+    }
+    return slot;
+}
+
+std::shared_ptr<const AlignedVector<float>> PlanCache::window(WindowType window,
+                                                              std::size_t size) {
+    std::lock_guard lock(mutex_);
+    auto& slot = windows_[{window, size}];
+    if (!slot) {
+        slot = std::make_shared<const AlignedVector<float>>(make_window(window, size));
+    }
+    return slot;
+}
+
+void PlanCache::insert(std::shared_ptr<const FftPlan> plan) {
+    std::lock_guard lock(mutex_);
+    auto& slot = plans_[plan->size()];
+    if (!slot) {
+        slot = std::move(plan);
+    }
+}
+
+void PlanCache::insert(WindowType window, std::shared_ptr<const AlignedVector<float>> values) {
+    std::lock_guard lock(mutex_);
+    auto& slot = windows_[{window, values->size()}];
+    if (!slot) {
+        slot = std::move(values);
+    }
+}
+
+void PlanCache::clear() {
+    std::lock_guard lock(mutex_);
+    plans_.clear();
+    windows_.clear();
+}
+
+}  // namespace srm
@@ -0,0 +1,362 @@
+#include "srm/field_reconstruction.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "srm/instrumentation.hpp"
+
+#if defined(SRM_HAVE_CBLAS)
+#include <cblas.h>
+#endif
+
+namespace srm {
+
+namespace {
+
+/// Samples per slice of the product: a slice of a dozen gauge channels
+/// (12 KiB) and the output row being written stay in L1 while every output
+/// is computed from them.
+constexpr std::size_t kSampleBlock = 256;
+
+/// Cyclic Jacobi eigendecomposition of the symmetric n x n matrix @p a
+/// (row-major; destroyed). Returns the eigenvalues, eigenvectors in the
+/// columns of @p v.
+std::vector<double> symmetric_eigen(std::vector<double>& a, std::size_t n, std::vector<double>& v) {
+    v.assign(n * n, 0.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        v[i * n + i] = 1.0;
+    }
+    const double scale = std::inner_product(a.begin(), a.end(), a.begin(), 0.0);
+    for (int sweep = 0; sweep < 64; ++sweep) {
+        double off = 0.0;
+        for (std::size_t p = 0; p < n; ++p) {
+            for (std::size_t q = p + 1; q < n; ++q) {
+                off += a[p * n + q] * a[p * n + q];
+            }
+        }
+        if (off <= 1e-30 * scale) {
+            break;
+        }
+        for (std::size_t p = 0; p < n; ++p) {
+            for (std::size_t q = p + 1; q < n; ++q) {
+                const double apq = a[p * n + q];
+                if (apq == 0.0) {
+                    continue;
+                }
+                const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                const double t = std::copysign(1.0, theta) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (std::size_t k = 0; k < n; ++k) {  // A J
+                    const double akp = a[k * n + p];
+                    const double akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (std::size_t k = 0; k < n; ++k) {  // J^T (A J)
+                    const double apk = a[p * n + k];
+                    const double aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (std::size_t k = 0; k < n; ++k) {
+                    const double vkp = v[k * n + p];
+                    const double vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    std::vector<double> values(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        values[i] = a[i * n + i];
+    }
+    return values;
+}
+
+void normalise(std::span<double> shape) {
+    const double norm = std::sqrt(std::inner_product(shape.begin(), shape.end(), shape.begin(), 0.0));
+    if (!(norm > 0.0)) {
+        throw std::invalid_argument("reconstruction: mode shape is all zero");
+    }
+    for (double& x : shape) {
+        x /= norm;
+    }
+}
+
+}  // namespace
+
+// ---- ModalBasis ----
+
+ModalBasis::ModalBasis(std::size_t outputs, std::vector<double> shapes)
+    : outputs_(outputs), shapes_(std::move(shapes)) {
+    if (outputs_ == 0 || shapes_.empty() || shapes_.size() % outputs_ != 0) {
+        throw std::invalid_argument("reconstruction: " + std::to_string(shapes_.size()) +
+                                    " shape values are not whole modes of " + std::to_string(outputs_) +
+                                    " outputs");
+    }
+    for (std::size_t k = 0; k < modes(); ++k) {
+        const std::span<const double> shape = mode(k);
+        if (std::all_of(shape.begin(), shape.end(), [](double x) { return x == 0.0; })) {
+            throw std::invalid_argument("reconstruction: mode " + std::to_string(k) + " is all zero");
+        }
+    }
+}
+
+ModalBasis ModalBasis::from_snapshots(std::span<const double> snapshots, std::size_t outputs,
+                                      std::size_t max_modes, double energy) {
+    if (outputs == 0 || snapshots.empty() || snapshots.size() % outputs != 0 || max_modes == 0) {
+        throw std::invalid_argument("reconstruction: snapshots must be whole rows of outputs");
+    }
+    // Method of snapshots: the eigenvectors of the small snapshot Gram
+    // matrix S S^T give the POD modes S^T v / sqrt(lambda).
+    const std::size_t count = snapshots.size() / outputs;
+    const auto row = [&](std::size_t i) { return snapshots.subspan(i * outputs, outputs); };
+    std::vector<double> gram(count * count);
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t j = i; j < count; ++j) {
+            const double d = std::inner_product(row(i).begin(), row(i).end(), row(j).begin(), 0.0);
+            gram[i * count + j] = d;
+            gram[j * count + i] = d;
+        }
+    }
+    std::vector<double> vectors;
+    const std::vector<double> values = symmetric_eigen(gram, count, vectors);
+    std::vector<std::size_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return values[a] > values[b]; });
+    const double total = std::accumulate(values.begin(), values.end(), 0.0);
+    if (!(total > 0.0)) {
+        throw std::invalid_argument("reconstruction: snapshots are all zero");
+    }
+
+    std::vector<double> shapes;
+    std::vector<double> cumulative;
+    double kept = 0.0;
+    for (const std::size_t k : order) {
+        if (cumulative.size() == max_modes || kept >= energy * total || values[k] <= 1e-12 * values[order[0]]) {
+            break;
+        }
+        const std::size_t first = shapes.size();
+        shapes.resize(first + outputs, 0.0);
+        const std::span<double> shape = std::span(shapes).subspan(first, outputs);
+        for (std::size_t i = 0; i < count; ++i) {
+            const double w = vectors[i * count + k];
+            for (std::size_t o = 0; o < outputs; ++o) {
+                shape[o] += w * row(i)[o];
+            }
+        }
+        normalise(shape);
+        kept += values[k];
+        cumulative.push_back(kept / total);
+    }
+    ModalBasis basis(outputs, std::move(shapes));
+    basis.cumulative_energy_ = std::move(cumulative);
+    return basis;
+}
+
+ModalBasis ModalBasis::thin_ring(std::size_t points, std::size_t max_order) {
+    if (points <= 2 * max_order) {
+        throw std::invalid_argument("reconstruction: " + std::to_string(points) +
+                                    " ring points alias order " + std::to_string(max_order));
+    }
+    std::vector<double> shapes;
+    shapes.reserve((2 * max_order + 1) * points);
+    const auto add = [&](auto shape) {
+        const std::size_t first = shapes.size();
+        for (std::size_t i = 0; i < points; ++i) {
+            shapes.push_back(shape(2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(points)));
+        }
+        normalise(std::span(shapes).subspan(first, points));
+    };
+    add([](double) { return 1.0; });
+    for (std::size_t n = 1; n <= max_order; ++n) {
+        const double order = static_cast<double>(n);
+        add([order](double theta) { return std::cos(order * theta); });
+        add([order](double theta) { return std::sin(order * theta); });
+    }
+    return ModalBasis(points, std::move(shapes));
+}
+
+// ---- FieldReconstructor ----
+
+FieldReconstructor::FieldReconstructor(const ModalBasis& basis, std::span<const GaugePlacement> gauges,
+                                       const ReconstructionOptions& options)
+    : gauges_(gauges.size()), outputs_(basis.outputs()), modes_(basis.modes()) {
+    const std::size_t g = gauges_;
+    const std::size_t m = modes_;
+    if (g == 0 || m == 0) {
+        throw std::invalid_argument("reconstruction: empty gauge layout or basis");
+    }
+    if (g < m && !(options.regularisation > 0.0)) {
+        throw std::invalid_argument("reconstruction: " + std::to_string(g) + " gauges cannot resolve " +
+                                    std::to_string(m) + " modes without regularisation");
+    }
+
+    // Rows 0..g-1 of the least-squares system: what each gauge reads of
+    // each mode. Regularised, m rows of sqrt(lambda) I follow.
+    const std::size_t rows = options.regularisation > 0.0 ? g + m : g;
+    std::vector<double> a(rows * m, 0.0);
+    for (std::size_t i = 0; i < g; ++i) {
+        for (const GaugeTerm& term : gauges[i].terms) {
+            if (term.output >= outputs_) {
+                throw std::invalid_argument("reconstruction: gauge " + gauges[i].name + " reads output " +
+                                            std::to_string(term.output) + " of " + std::to_string(outputs_));
+            }
+            for (std::size_t k = 0; k < m; ++k) {
+                a[i * m + k] += term.weight * basis.mode(k)[term.output];
+            }
+        }
+    }
+    if (rows > g) {
+        double largest = 0.0;
+        for (std::size_t k = 0; k < m; ++k) {
+            double diagonal = 0.0;
+            for (std::size_t i = 0; i < g; ++i) {
+                diagonal += a[i * m + k] * a[i * m + k];
+            }
+            largest = std::max(largest, diagonal);
+        }
+        const double ridge = std::sqrt(options.regularisation * largest);
+        for (std::size_t k = 0; k < m; ++k) {
+            a[(g + k) * m + k] = ridge;
+        }
+    }
+
+    // Householder QR in place: R in the upper triangle, reflector k in
+    // reflectors[k] (rows k..rows-1).
+    std::vector<std::vector<double>> reflectors(m);
+    std::vector<double> diagonal(m);
+    for (std::size_t k = 0; k < m; ++k) {
+        std::vector<double>& v = reflectors[k];
+        v.resize(rows - k);
+        for (std::size_t i = k; i < rows; ++i) {
+            v[i - k] = a[i * m + k];
+        }
+        const double norm = std::sqrt(std::inner_product(v.begin(), v.end(), v.begin(), 0.0));
+        const double alpha = v[0] > 0.0 ? -norm : norm;
+        diagonal[k] = alpha;
+        v[0] -= alpha;
+        const double vv = std::inner_product(v.begin(), v.end(), v.begin(), 0.0);
+        if (vv == 0.0) {
+            continue;  // column already zero below the diagonal (or entirely)
+        }
+        for (std::size_t c = k; c < m; ++c) {
+            double dot = 0.0;
+            for (std::size_t i = k; i < rows; ++i) {
+                dot += v[i - k] * a[i * m + c];
+            }
+            const double f = 2.0 * dot / vv;
+            for (std::size_t i = k; i < rows; ++i) {
+                a[i * m + c] -= f * v[i - k];
+            }
+        }
+    }
+    const auto [smallest, largest] = std::minmax_element(
+        diagonal.begin(), diagonal.end(), [](double x, double y) { return std::fabs(x) < std::fabs(y); });
+    if (!(std::fabs(*smallest) > 1e-10 * std::fabs(*largest))) {
+        throw std::runtime_error("reconstruction: the gauge layout cannot resolve mode " +
+                                 std::to_string(smallest - diagonal.begin()) + " (rank deficient)");
+    }
+    condition_ = std::fabs(*largest) / std::fabs(*smallest);
+
+    // Modal coordinates of each unit gauge reading, q = R^-1 (Q^T e_j)[0..m),
+    // then folded through the mode shapes.
+    std::vector<double> coordinates(m * g);  // m x g
+    std::vector<double> y(rows);
+    for (std::size_t j = 0; j < g; ++j) {
+        std::fill(y.begin(), y.end(), 0.0);
+        y[j] = 1.0;
+        for (std::size_t k = 0; k < m; ++k) {
+            const std::vector<double>& v = reflectors[k];
+            const double vv = std::inner_product(v.begin(), v.end(), v.begin(), 0.0);
+            if (vv == 0.0) {
+                continue;
+            }
+            const auto tail = y.begin() + static_cast<std::ptrdiff_t>(k);
+            const double f = 2.0 * std::inner_product(v.begin(), v.end(), tail, 0.0) / vv;
+            for (std::size_t i = k; i < rows; ++i) {
+                y[i] -= f * v[i - k];
+            }
+        }
+        for (std::size_t k = m; k-- > 0;) {
+            double sum = y[k];
+            for (std::size_t c = k + 1; c < m; ++c) {
+                sum -= a[k * m + c] * coordinates[c * g + j];
+            }
+            coordinates[k * g + j] = sum / a[k * m + k];
+        }
+    }
+    matrix_.resize(outputs_ * g);
+    for (std::size_t o = 0; o < outputs_; ++o) {
+        for (std::size_t j = 0; j < g; ++j) {
+            double sum = 0.0;
+            for (std::size_t k = 0; k < m; ++k) {
+                sum += basis.mode(k)[o] * coordinates[k * g + j];
+            }
+            matrix_[o * g + j] = static_cast<float>(sum);
+        }
+    }
+}
+
+void FieldReconstructor::reconstruct(ChannelBlock<const float> gauges, ChannelBlock<float> field) const {
+    if (gauges.channels() != gauges_ || field.channels() != outputs_ || field.samples() < gauges.samples()) {
+        throw std::invalid_argument("reconstruction: block shape mismatch");
+    }
+    const std::size_t n = gauges.samples();
+    if (n == 0) {
+        return;
+    }
+    SRM_SCOPED_TIMER("reconstruct");
+#if defined(SRM_HAVE_CBLAS)
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, static_cast<int>(outputs_), static_cast<int>(n),
+                static_cast<int>(gauges_), 1.0f, matrix_.data(), static_cast<int>(gauges_), gauges.data(),
+                static_cast<int>(std::max(gauges.stride(), n)), 0.0f, field.data(),
+                static_cast<int>(std::max(field.stride(), n)));
+#else
+    for (std::size_t first = 0; first < n; first += kSampleBlock) {
+        const std::size_t count = std::min(kSampleBlock, n - first);
+        for (std::size_t o = 0; o < outputs_; ++o) {
+            const float* r = matrix_.data() + o * gauges_;
+            float* out = field.channel(o).data() + first;
+            const float* y = gauges.channel(0).data() + first;
+            for (std::size_t i = 0; i < count; ++i) {
+                out[i] = r[0] * y[i];
+            }
+            // Four gauges per pass over the output row.
+            std::size_t j = 1;
+            for (; j + 4 <= gauges_; j += 4) {
+                const float* y0 = gauges.channel(j).data() + first;
+                const float* y1 = gauges.channel(j + 1).data() + first;
+                const float* y2 = gauges.channel(j + 2).data() + first;
+                const float* y3 = gauges.channel(j + 3).data() + first;
+                for (std::size_t i = 0; i < count; ++i) {
+                    out[i] += (r[j] * y0[i] + r[j + 1] * y1[i]) + (r[j + 2] * y2[i] + r[j + 3] * y3[i]);
+                }
+            }
+            for (; j < gauges_; ++j) {
+                const float* y = gauges.channel(j).data() + first;
+                const float w = r[j];
+                for (std::size_t i = 0; i < count; ++i) {
+                    out[i] += w * y[i];
+                }
+            }
+        }
+    }
+#endif
+}
+
+bool FieldReconstructor::uses_blas() noexcept {
+#if defined(SRM_HAVE_CBLAS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+}  // namespace srm
@@ -0,0 +1,338 @@
+#include "srm/harmonic_notch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <stdexcept>
+
+#include "srm/channel_pipeline.hpp"
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+// Eight double lanes: four SSE2 registers per operation on baseline x86-64,
+// which also gives the out-of-order core independent chains to overlap.
+constexpr std::size_t kNotchLanes = 8;
+using NotchLanes = DoubleLanes<kNotchLanes>;
+
+// Samples transposed into lanes at a time; 256 * 64 bytes stays in L1.
+constexpr std::size_t kNotchChunk = 256;
+
+using Quad = detail::LaneVectors<4>::f;
+using Octet = detail::LaneVectors<8>::f;
+
+inline Quad load_quad(const float* p) noexcept {
+    Quad q;
+    std::memcpy(&q, p, sizeof(q));
+    return q;
+}
+
+inline void store_quad(float* p, Quad q) noexcept { std::memcpy(p, &q, sizeof(q)); }
+
+inline void transpose(Quad& a, Quad& b, Quad& c, Quad& d) noexcept {
+    const Quad t0 = __builtin_shufflevector(a, b, 0, 4, 1, 5);
+    const Quad t1 = __builtin_shufflevector(a, b, 2, 6, 3, 7);
+    const Quad t2 = __builtin_shufflevector(c, d, 0, 4, 1, 5);
+    const Quad t3 = __builtin_shufflevector(c, d, 2, 6, 3, 7);
+    a = __builtin_shufflevector(t0, t2, 0, 1, 4, 5);
+    b = __builtin_shufflevector(t0, t2, 2, 3, 6, 7);
+    c = __builtin_shufflevector(t1, t3, 0, 1, 4, 5);
+    d = __builtin_shufflevector(t1, t3, 2, 3, 6, 7);
+}
+
+// Samples [i, i + 4) of eight channels into lanes, four at a time.
+inline void gather(const float* const* src, std::size_t i, NotchLanes* out) noexcept {
+    Quad lo[4] = {load_quad(src[0] + i), load_quad(src[1] + i), load_quad(src[2] + i),
+                  load_quad(src[3] + i)};
+    Quad hi[4] = {load_quad(src[4] + i), load_quad(src[5] + i), load_quad(src[6] + i),
+                  load_quad(src[7] + i)};
+    transpose(lo[0], lo[1], lo[2], lo[3]);
+    transpose(hi[0], hi[1], hi[2], hi[3]);
+    for (std::size_t j = 0; j < 4; ++j) {
+        const Octet v = __builtin_shufflevector(lo[j], hi[j], 0, 1, 2, 3, 4, 5, 6, 7);
+        out[j] = __builtin_convertvector(v, NotchLanes);
+    }
+}
+
+inline void scatter(const NotchLanes* in, std::size_t i, float* const* dst) noexcept {
+    Quad lo[4];
+    Quad hi[4];
+    for (std::size_t j = 0; j < 4; ++j) {
+        const Octet v = __builtin_convertvector(in[j], Octet);
+        lo[j] = __builtin_shufflevector(v, v, 0, 1, 2, 3);
+        hi[j] = __builtin_shufflevector(v, v, 4, 5, 6, 7);
+    }
+    transpose(lo[0], lo[1], lo[2], lo[3]);
+    transpose(hi[0], hi[1], hi[2], hi[3]);
+    for (std::size_t lane = 0; lane < 4; ++lane) {
+        store_quad(dst[lane] + i, lo[lane]);
+        store_quad(dst[4 + lane] + i, hi[lane]);
+    }
+}
+
+}  // namespace
+
+// ---- SpeedEstimator --------------------------------------------------------
+
+SpeedEstimator::SpeedEstimator(double counts_per_revolution, double sample_rate_hz,
+                               double smoothing_s)
+    : counts_per_revolution_(counts_per_revolution),
+      sample_rate_hz_(sample_rate_hz),
+      smoothing_s_(smoothing_s) {
+    if (!(counts_per_revolution > 0.0) || !(sample_rate_hz > 0.0) || !(smoothing_s >= 0.0)) {
+        throw std::invalid_argument("speed estimator: invalid configuration");
+    }
+}
+
+void SpeedEstimator::reset() noexcept {
+    primed_ = false;
+    has_speed_ = false;
+    speed_ = 0.0;
+}
+
+double SpeedEstimator::update(std::span<const float> position) noexcept {
+    if (position.empty()) {
+        return speed_;
+    }
+    std::size_t i = 0;
+    if (!primed_) {
+        prev_ = position[0];
+        primed_ = true;
+        i = 1;
+    }
+    const std::size_t steps = position.size() - i;
+    if (steps == 0) {
+        return speed_;
+    }
+
+    const double half = counts_per_revolution_ / 2.0;
+    double advance = 0.0;
+    float prev = prev_;
+    for (; i < position.size(); ++i) {
+        double delta = static_cast<double>(position[i]) - prev;
+        if (delta < -half) {
+            delta += counts_per_revolution_;
+        } else if (delta > half) {
+            delta -= counts_per_revolution_;
+        }
+        advance += delta;
+        prev = position[i];
+    }
+    prev_ = prev;
+
+    const double seconds = static_cast<double>(steps) / sample_rate_hz_;
+    const double block_speed = advance / counts_per_revolution_ / seconds;
+    if (!has_speed_) {
+        speed_ = block_speed;
+    } else if (smoothing_s_ == 0.0) {
+        // The block mean is the speed half a block ago; carry the trend
+        // between block centres on to the last sample.
+        const double slope = (block_speed - mean_speed_) / (0.5 * (seconds + mean_seconds_));
+        speed_ = block_speed + slope * 0.5 * seconds;
+    } else {
+        const double weight = 1.0 - std::exp(-seconds / smoothing_s_);
+        speed_ += weight * (block_speed - speed_);
+    }
+    has_speed_ = true;
+    mean_speed_ = block_speed;
+    mean_seconds_ = seconds;
+    return speed_;
+}
+
+// ---- HarmonicNotch ---------------------------------------------------------
+
+HarmonicNotch::HarmonicNotch(const HarmonicNotchConfig& config, std::size_t channels)
+    : config_(config), channels_(channels) {
+    if (!(config.sample_rate_hz > 0.0) || !(config.cycles_per_revolution > 0.0) ||
+        !(config.speed_bandwidth_hz > 0.0) || !(config.pwm_bandwidth_hz > 0.0) ||
+        !(config.pwm_frequency_hz >= 0.0) || !(config.max_frequency_fraction > 0.0) ||
+        !(config.max_frequency_fraction < 0.5)) {
+        throw std::invalid_argument("harmonic notch: invalid configuration");
+    }
+    if (channels == 0) {
+        throw std::invalid_argument("harmonic notch: no channels");
+    }
+
+    const auto add_section = [&](unsigned harmonic, double bandwidth_hz) {
+        const double alpha = std::tan(std::numbers::pi * bandwidth_hz / config.sample_rate_hz);
+        Section s;
+        s.harmonic = harmonic;
+        s.b0 = 1.0 / (1.0 + alpha);
+        s.a2 = (1.0 - alpha) / (1.0 + alpha);
+        sections_.push_back(s);
+    };
+    for (unsigned n = 1; n <= config.speed_harmonics; ++n) {
+        add_section(n, config.speed_bandwidth_hz);
+    }
+    if (config.pwm_frequency_hz > 0.0) {
+        for (unsigned n = 1; n <= config.pwm_harmonics; ++n) {
+            add_section(0, config.pwm_bandwidth_hz);
+            sections_.back().frequency = n * config.pwm_frequency_hz;
+        }
+    }
+    target_.resize(sections_.size());
+
+    zeros_.assign(kNotchChunk, 0.0f);
+    discard_.resize(kNotchChunk);
+    const std::size_t groups = (channels + kNotchLanes - 1) / kNotchLanes;
+    state_.assign(groups * sections_.size() * 2 * kNotchLanes, 0.0);
+}
+
+std::size_t HarmonicNotch::active_sections() const noexcept {
+    return static_cast<std::size_t>(
+        std::count_if(sections_.begin(), sections_.end(), [](const Section& s) { return s.active; }));
+}
+
+void HarmonicNotch::reset() noexcept {
+    std::fill(state_.begin(), state_.end(), 0.0);
+    for (Section& s : sections_) {
+        s.active = false;
+        if (s.harmonic != 0) {
+            s.frequency = 0.0;
+        }
+    }
+}
+
+void HarmonicNotch::retune(double rev_per_s, std::vector<double>& target) {
+    const double fs = config_.sample_rate_hz;
+    const double lo = config_.min_frequency_hz;
+    const double hi = config_.max_frequency_fraction * fs;
+    const double fundamental = std::abs(rev_per_s) * config_.cycles_per_revolution;
+
+    // cos(n w) for the tracked harmonics by recurrence; the fixed notches
+    // still need their own cos(), but only while the carrier is configured.
+    const double c1 = std::cos(2.0 * std::numbers::pi * fundamental / fs);
+    double c_prev = 1.0;
+    double c = c1;
+    const std::size_t groups = (channels_ + kNotchLanes - 1) / kNotchLanes;
+    for (std::size_t k = 0; k < sections_.size(); ++k) {
+        Section& s = sections_[k];
+        double cosine;
+        if (s.harmonic != 0) {
+            s.frequency = fundamental * s.harmonic;
+            cosine = c;
+            const double next = 2.0 * c1 * c - c_prev;
+            c_prev = c;
+            c = next;
+        } else {
+            cosine = std::cos(2.0 * std::numbers::pi * s.frequency / fs);
+        }
+        target[k] = -2.0 * cosine * s.b0;
+
+        const bool active = s.frequency >= lo && s.frequency <= hi;
+        if (active && !s.active) {
+            // Entering range: start from rest at the target instead of
+            // sweeping through the band from a stale centre.
+            s.m = target[k];
+            for (std::size_t g = 0; g < groups; ++g) {
+                double* z = state_.data() + (g * sections_.size() + k) * 2 * kNotchLanes;
+                std::fill(z, z + 2 * kNotchLanes, 0.0);
+            }
+        }
+        s.active = active;
+    }
+}
+
+void HarmonicNotch::process(ChannelBlock<const float> in, ChannelBlock<float> out,
+                            double rev_per_s) {
+    SRM_SCOPED_TIMER("harmonic_notch");
+    if (in.channels() != channels_ || out.channels() != channels_ ||
+        in.samples() != out.samples()) {
+        throw std::invalid_argument("harmonic notch: block shape mismatch");
+    }
+    retune(rev_per_s, target_);
+
+    const std::size_t n = in.samples();
+    const std::size_t sections = sections_.size();
+    if (n == 0) {
+        for (std::size_t k = 0; k < sections; ++k) {
+            sections_[k].m = target_[k];
+        }
+        return;
+    }
+    const double inv_n = 1.0 / static_cast<double>(n);
+
+    alignas(64) NotchLanes buffer[kNotchChunk];
+    for (std::size_t first_channel = 0; first_channel < channels_; first_channel += kNotchLanes) {
+        const std::size_t lanes = std::min(kNotchLanes, channels_ - first_channel);
+        double* group_state =
+            state_.data() + first_channel / kNotchLanes * sections * 2 * kNotchLanes;
+
+        for (std::size_t first = 0; first < n; first += kNotchChunk) {
+            const std::size_t count = std::min(kNotchChunk, n - first);
+
+            // Transpose the chunk into lanes; missing lanes of the last
+            // group read zeros and keep their state at rest.
+            const float* src[kNotchLanes];
+            for (std::size_t lane = 0; lane < kNotchLanes; ++lane) {
+                src[lane] = lane < lanes ? in.channel(first_channel + lane).data() + first
+                                         : zeros_.data();
+            }
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                gather(src, i, buffer + i);
+            }
+            for (; i < count; ++i) {
+                for (std::size_t lane = 0; lane < kNotchLanes; ++lane) {
+                    buffer[i][lane] = src[lane][i];
+                }
+            }
+
+            for (std::size_t k = 0; k < sections; ++k) {
+                const Section& s = sections_[k];
+                if (!s.active) {
+                    continue;
+                }
+                // Transposed direct form II with b1 == a1 == m, b2 == b0:
+                //   y = b0 x + z1;  z1 = m (x - y) + z2;  z2 = b0 x - a2 y.
+                double* z = group_state + k * 2 * kNotchLanes;
+                NotchLanes z1;
+                NotchLanes z2;
+                for (std::size_t lane = 0; lane < kNotchLanes; ++lane) {
+                    z1[lane] = z[lane];
+                    z2[lane] = z[kNotchLanes + lane];
+                }
+                const double b0 = s.b0;
+                const double a2 = s.a2;
+                const double dm = (target_[k] - s.m) * inv_n;
+                double m = s.m + static_cast<double>(first) * dm;
+                for (std::size_t t = 0; t < count; ++t) {
+                    m += dm;
+                    const NotchLanes x = buffer[t];
+                    const NotchLanes bx = b0 * x;
+                    const NotchLanes y = bx + z1;
+                    z1 = m * (x - y) + z2;
+                    z2 = bx - a2 * y;
+                    buffer[t] = y;
+                }
+                for (std::size_t lane = 0; lane < kNotchLanes; ++lane) {
+                    z[lane] = z1[lane];
+                    z[kNotchLanes + lane] = z2[lane];
+                }
+            }
+
+            float* dst[kNotchLanes];
+            for (std::size_t lane = 0; lane < kNotchLanes; ++lane) {
+                dst[lane] = lane < lanes ? out.channel(first_channel + lane).data() + first
+                                         : discard_.data();
+            }
+            for (i = 0; i + 4 <= count; i += 4) {
+                scatter(buffer + i, i, dst);
+            }
+            for (; i < count; ++i) {
+                for (std::size_t lane = 0; lane < kNotchLanes; ++lane) {
+                    dst[lane][i] = static_cast<float>(buffer[i][lane]);
+                }
+            }
+        }
+    }
+
+    for (std::size_t k = 0; k < sections; ++k) {
+        sections_[k].m = target_[k];
+    }
+}
+
+}  // namespace srm
@@ -0,0 +1,238 @@
+#include "srm/instrumentation.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace srm {
+
+double tsc_ns_per_tick() noexcept {
+    static const double ns_per_tick = [] {
+        using clock = std::chrono::steady_clock;
+        const clock::time_point t0 = clock::now();
+        const std::uint64_t c0 = tsc_now();
+        clock::time_point t1 = t0;
+        while (t1 - t0 < std::chrono::milliseconds(10)) {
+            t1 = clock::now();
+        }
+        const std::uint64_t c1 = tsc_now();
+        const double ns = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        return c1 > c0 ? ns / static_cast<double>(c1 - c0) : 1.0;
+    }();
+    return ns_per_tick;
+}
+
+// ---- Instrumentation --------------------------------------------------------
+
+Instrumentation::ThreadStats::~ThreadStats() {
+    for (std::atomic<LatencyHistogram*>& h : stages) {
+        delete h.load(std::memory_order_relaxed);
+    }
+}
+
+Instrumentation& Instrumentation::instance() {
+    static Instrumentation registry;
+    return registry;
+}
+
+Instrumentation::Instrumentation() : ns_per_tick_(tsc_ns_per_tick()) {}
+
+StageId Instrumentation::stage(const char* name) {
+    const std::lock_guard lock(mutex_);
+    for (std::size_t i = 0; i < stage_names_.size(); ++i) {
+        if (stage_names_[i] == name) {
+            return static_cast<StageId>(i);
+        }
+    }
+    if (stage_names_.size() == kMaxStages) {
+        throw std::length_error("instrumentation: too many stages");
+    }
+    stage_names_.emplace_back(name);
+    return static_cast<StageId>(stage_names_.size() - 1);
+}
+
+CounterId Instrumentation::counter(const char* name, CounterKind kind) {
+    const std::lock_guard lock(mutex_);
+    for (std::size_t i = 0; i < counter_names_.size(); ++i) {
+        if (counter_names_[i] == name) {
+            return static_cast<CounterId>(i);
+        }
+    }
+    if (counter_names_.size() == kMaxCounters) {
+        throw std::length_error("instrumentation: too many counters");
+    }
+    counter_names_.emplace_back(name);
+    counter_kinds_.push_back(kind);
+    return static_cast<CounterId>(counter_names_.size() - 1);
+}
+
+Instrumentation::ThreadStats* Instrumentation::attach_thread() {
+    auto stats = std::make_unique<ThreadStats>();
+    ThreadStats* raw = stats.get();
+    const std::lock_guard lock(mutex_);
+    threads_.push_back(std::move(stats));
+    return raw;
+}
+
+LatencyHistogram* Instrumentation::create_histogram(ThreadStats& stats, StageId stage) {
+    // Only the owning thread stores into its slots; snapshot() just loads.
+    auto* h = new LatencyHistogram();
+    stats.stages[stage].store(h, std::memory_order_release);
+    return h;
+}
+
+void Instrumentation::prepare_thread() {
+    std::size_t stages = 0;
+    {
+        const std::lock_guard lock(mutex_);
+        stages = stage_names_.size();
+    }
+    for (std::size_t s = 0; s < stages; ++s) {
+        histogram(static_cast<StageId>(s));
+    }
+}
+
+void Instrumentation::record_placement(PlacementStats placement) {
+    const std::lock_guard lock(mutex_);
+    for (PlacementStats& p : placements_) {
+        if (p.name == placement.name) {
+            p = std::move(placement);
+            return;
+        }
+    }
+    placements_.push_back(std::move(placement));
+}
+
+InstrumentationSnapshot Instrumentation::snapshot() const {
+    InstrumentationSnapshot snap;
+    const std::lock_guard lock(mutex_);
+    snap.placements = placements_;
+    if constexpr (!kInstrumentationEnabled) {
+        return snap;
+    }
+    LatencyHistogram merged;
+    for (std::size_t s = 0; s < stage_names_.size(); ++s) {
+        merged.reset();
+        for (const auto& thread : threads_) {
+            if (const LatencyHistogram* h = thread->stages[s].load(std::memory_order_acquire)) {
+                merged.merge(*h);
+            }
+        }
+        snap.stages.push_back({stage_names_[s], merged.count(), merged.mean(), merged.percentile(0.5),
+                               merged.percentile(0.99), merged.percentile(0.999), merged.max()});
+    }
+    for (std::size_t c = 0; c < counter_names_.size(); ++c) {
+        snap.counters.push_back(
+            {counter_names_[c], counter_kinds_[c], counters_[c].value.load(std::memory_order_relaxed)});
+    }
+    return snap;
+}
+
+void Instrumentation::reset() noexcept {
+    const std::lock_guard lock(mutex_);
+    for (const auto& thread : threads_) {
+        for (std::atomic<LatencyHistogram*>& h : thread->stages) {
+            if (LatencyHistogram* p = h.load(std::memory_order_acquire)) {
+                p->reset();
+            }
+        }
+    }
+    for (CounterSlot& c : counters_) {
+        c.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+// ---- Export -----------------------------------------------------------------
+
+namespace {
+
+void append_json_string(std::string& out, const std::string& s) {
+    out += '"';
+    for (const char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(ch));
+            out += buf;
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+}  // namespace
+
+std::string to_json(const InstrumentationSnapshot& snapshot) {
+    std::string out = "{\"enabled\":";
+    out += snapshot.enabled ? "true" : "false";
+    out += ",\"stages\":[";
+    char buf[256];
+    for (std::size_t i = 0; i < snapshot.stages.size(); ++i) {
+        const StageStats& s = snapshot.stages[i];
+        out += i == 0 ? "{\"name\":" : ",{\"name\":";
+        append_json_string(out, s.name);
+        std::snprintf(buf, sizeof(buf),
+                      ",\"count\":%llu,\"mean_ns\":%.1f,\"p50_ns\":%llu,\"p99_ns\":%llu,"
+                      "\"p999_ns\":%llu,\"max_ns\":%llu}",
+                      static_cast<unsigned long long>(s.count), s.mean_ns,
+                      static_cast<unsigned long long>(s.p50_ns), static_cast<unsigned long long>(s.p99_ns),
+                      static_cast<unsigned long long>(s.p999_ns), static_cast<unsigned long long>(s.max_ns));
+        out += buf;
+    }
+    out += "],\"counters\":[";
+    for (std::size_t i = 0; i < snapshot.counters.size(); ++i) {
+        const CounterStats& c = snapshot.counters[i];
+        out += i == 0 ? "{\"name\":" : ",{\"name\":";
+        append_json_string(out, c.name);
+        std::snprintf(buf, sizeof(buf), ",\"kind\":\"%s\",\"value\":%llu}",
+                      c.kind == CounterKind::Sum ? "sum" : "high_water",
+                      static_cast<unsigned long long>(c.value));
+        out += buf;
+    }
+    out += "],\"placements\":[";
+    for (std::size_t i = 0; i < snapshot.placements.size(); ++i) {
+        const PlacementStats& p = snapshot.placements[i];
+        out += i == 0 ? "{\"name\":" : ",{\"name\":";
+        append_json_string(out, p.name);
+        out += ",\"cpus\":";
+        append_json_string(out, p.cpus);
+        std::snprintf(buf, sizeof(buf), ",\"node\":%d,\"applied\":%s,\"detail\":", p.node,
+                      p.applied ? "true" : "false");
+        out += buf;
+        append_json_string(out, p.detail);
+        out += '}';
+    }
+    out += "]}";
+    return out;
+}
+
+// ---- CountingMemoryResource -------------------------------------------------
+
+CountingMemoryResource::CountingMemoryResource(std::pmr::memory_resource* upstream, const char* name)
+    : upstream_(upstream),
+      allocations_id_(Instrumentation::instance().counter(name, CounterKind::Sum)),
+      bytes_id_(Instrumentation::instance().counter((std::string(name) + "_bytes").c_str(),
+                                                    CounterKind::Sum)) {}
+
+void* CountingMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    void* p = upstream_->allocate(bytes, alignment);
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    if constexpr (kInstrumentationEnabled) {
+        Instrumentation::instance().add(allocations_id_);
+        Instrumentation::instance().add(bytes_id_, bytes);
+    }
+    return p;
+}
+
+void CountingMemoryResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+    upstream_->deallocate(p, bytes, alignment);
+}
+
+}  // namespace srm
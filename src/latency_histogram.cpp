@@ -0,0 +1,74 @@
+#include "srm/latency_histogram.hpp"
+
+#include <limits>
+
+namespace srm {
+
+std::uint64_t LatencyHistogram::bucket_upper(std::size_t bucket) noexcept {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const unsigned octave = static_cast<unsigned>(bucket / kSubBuckets);
+    const std::uint64_t sub = bucket % kSubBuckets;
+    const unsigned shift = octave - 1;
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+double LatencyHistogram::mean() const noexcept {
+    const std::uint64_t n = count();
+    return n == 0 ? 0.0
+                  : static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(n);
+}
+
+std::uint64_t LatencyHistogram::percentile(double q) const noexcept {
+    const std::uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+    // Rank of the quantile sample, 1-based; q = 0 is the first sample.
+    std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(n) + 0.5);
+    rank = rank == 0 ? 1 : (rank > n ? n : rank);
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        seen += bucket_count(b);
+        if (seen >= rank) {
+            const std::uint64_t upper = bucket_upper(b);
+            return upper < max() ? upper : max();
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) noexcept {
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        const std::uint64_t c = other.bucket_count(b);
+        if (c != 0) {
+            counts_[b].fetch_add(c, std::memory_order_relaxed);
+        }
+    }
+    const std::uint64_t n = other.count();
+    if (n == 0) {
+        return;
+    }
+    count_.fetch_add(n, std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    if (other.max() > max()) {
+        max_.store(other.max(), std::memory_order_relaxed);
+    }
+    if (other.min() < min_.load(std::memory_order_relaxed)) {
+        min_.store(other.min(), std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::reset() noexcept {
+    for (std::atomic<std::uint64_t>& c : counts_) {
+        c.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+}
+
+}  // namespace srm
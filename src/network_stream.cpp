@@ -0,0 +1,447 @@
+#include "srm/network_stream.hpp"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+[[noreturn]] void throw_errno(int err, const std::string& what) {
+    throw std::system_error(err, std::generic_category(), what);
+}
+
+// Frames encoded per sendmmsg() round; 64 frames of a standard datagram
+// are ~94 KB, comfortably inside the socket send buffer.
+constexpr std::size_t kSendBatchFrames = 64;
+constexpr std::size_t kControlBatch = 16;
+
+stream::FrameHeader control_header(stream::MessageKind kind) noexcept {
+    stream::FrameHeader h{};
+    h.magic = stream::kMagic;
+    h.version = stream::kProtocolVersion;
+    h.kind = kind;
+    return h;
+}
+
+// Consecutive within a process and random across processes, so a restarted
+// server starts a session its subscribers have not just seen.
+std::uint16_t new_session() {
+    static std::atomic<std::uint16_t> next{static_cast<std::uint16_t>(std::random_device{}())};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool same_endpoint(const sockaddr_in& a, const sockaddr_in& b) noexcept {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+int open_udp_socket(const char* what) {
+    const int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw_errno(errno, what);
+    }
+    return fd;
+}
+
+// As root (the rig PCs) the buffer may exceed net.core.[rw]mem_max; as a
+// user, settle for what the sysctl allows.
+void set_buffer_size(int fd, int force_option, int option, int bytes) noexcept {
+    if (bytes <= 0) {
+        return;
+    }
+    if (::setsockopt(fd, SOL_SOCKET, force_option, &bytes, sizeof(bytes)) != 0) {
+        ::setsockopt(fd, SOL_SOCKET, option, &bytes, sizeof(bytes));
+    }
+}
+
+}  // namespace
+
+// ---- StreamServer ----------------------------------------------------------
+
+StreamServer::StreamServer(const StreamServerConfig& config, std::size_t channels)
+    : config_(config),
+      channels_(channels),
+      frame_samples_(std::min<std::size_t>(stream::samples_per_frame(channels, config.max_datagram_bytes),
+                                           0xFFFF)),
+      frame_bytes_(sizeof(stream::FrameHeader) + channels * frame_samples_ * sizeof(std::int16_t)),
+      session_(new_session()) {
+    if (channels == 0 || channels > 0xFFFF || frame_samples_ == 0) {
+        throw std::invalid_argument("stream: datagram too small for the channel count");
+    }
+    if (config.max_subscribers == 0 || !(config.sample_rate_hz > 0.0)) {
+        throw std::invalid_argument("stream: invalid server configuration");
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config.port);
+    if (::inet_pton(AF_INET, config.bind_address.c_str(), &address.sin_addr) != 1) {
+        throw std::invalid_argument("stream: bind address is not a numeric IPv4 address");
+    }
+
+    fd_ = open_udp_socket("stream: cannot create server socket");
+    const int one = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    set_buffer_size(fd_, SO_SNDBUFFORCE, SO_SNDBUF, config.send_buffer_bytes);
+    if (::bind(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const int err = errno;
+        ::close(fd_);
+        throw_errno(err, "stream: cannot bind port " + std::to_string(config.port));
+    }
+    socklen_t length = sizeof(address);
+    ::getsockname(fd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+
+    frames_.resize(kSendBatchFrames * frame_bytes_);
+    frame_iovecs_.resize(kSendBatchFrames);
+    subscribers_.reserve(config.max_subscribers);
+    messages_.reserve(kSendBatchFrames * config.max_subscribers);
+}
+
+StreamServer::~StreamServer() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void StreamServer::poll() {
+    const auto now = std::chrono::steady_clock::now();
+
+    stream::FrameHeader headers[kControlBatch];
+    iovec iov[kControlBatch];
+    sockaddr_in from[kControlBatch];
+    mmsghdr msgs[kControlBatch];
+    for (;;) {
+        for (std::size_t i = 0; i < kControlBatch; ++i) {
+            iov[i] = {&headers[i], sizeof(headers[i])};
+            msgs[i] = {};
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        }
+        const int n = ::recvmmsg(fd_, msgs, kControlBatch, MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED) {
+                break;
+            }
+            throw_errno(errno, "stream: receive on server socket failed");
+        }
+        for (int i = 0; i < n; ++i) {
+            const stream::FrameHeader& h = headers[i];
+            if (msgs[i].msg_len != sizeof(h) || h.magic != stream::kMagic ||
+                h.version != stream::kProtocolVersion) {
+                continue;
+            }
+            const auto match = std::find_if(
+                subscribers_.begin(), subscribers_.end(),
+                [&](const Subscriber& s) { return same_endpoint(s.address, from[i]); });
+            if (h.kind == stream::MessageKind::Subscribe) {
+                if (match != subscribers_.end()) {
+                    match->last_seen = now;
+                } else if (subscribers_.size() < config_.max_subscribers) {
+                    subscribers_.push_back({from[i], now});
+                }
+            } else if (h.kind == stream::MessageKind::Unsubscribe && match != subscribers_.end()) {
+                subscribers_.erase(match);
+            }
+        }
+        if (static_cast<std::size_t>(n) < kControlBatch) {
+            break;
+        }
+    }
+
+    std::erase_if(subscribers_, [&](const Subscriber& s) {
+        return now - s.last_seen > config_.subscriber_timeout;
+    });
+}
+
+void StreamServer::publish(ChannelBlock<const std::int16_t> counts, std::uint64_t first_sample,
+                           std::uint64_t timestamp_ns, bool overrun) {
+    SRM_SCOPED_TIMER("stream_publish");
+    if (counts.channels() != channels_) {
+        throw std::invalid_argument("stream: channel count mismatch");
+    }
+    poll();
+
+    const std::size_t n = counts.samples();
+    const double ns_per_sample = 1e9 / config_.sample_rate_hz;
+    std::size_t batch = 0;
+    for (std::size_t offset = 0; offset < n; offset += frame_samples_) {
+        const std::size_t count = std::min(frame_samples_, n - offset);
+        if (!subscribers_.empty()) {
+            std::byte* frame = frames_.data() + batch * frame_bytes_;
+            stream::FrameHeader h = control_header(stream::MessageKind::Data);
+            h.rig_id = config_.rig_id;
+            h.sequence = sequence_;
+            h.first_sample = first_sample + offset;
+            h.timestamp_ns =
+                timestamp_ns + static_cast<std::uint64_t>(std::llround(offset * ns_per_sample));
+            h.channel_count = static_cast<std::uint16_t>(channels_);
+            h.sample_count = static_cast<std::uint16_t>(count);
+            h.flags = overrun && offset == 0 ? stream::kFlagOverrun : 0;
+            h.session = session_;
+            std::memcpy(frame, &h, sizeof(h));
+            std::byte* payload = frame + sizeof(h);
+            for (std::size_t c = 0; c < channels_; ++c) {
+                std::memcpy(payload + c * count * sizeof(std::int16_t),
+                            counts.channel(c).data() + offset, count * sizeof(std::int16_t));
+            }
+            frame_iovecs_[batch] = {frame, sizeof(h) + channels_ * count * sizeof(std::int16_t)};
+            if (++batch == kSendBatchFrames) {
+                send_frames(batch);
+                batch = 0;
+            }
+        }
+        ++sequence_;
+    }
+    if (batch != 0) {
+        send_frames(batch);
+    }
+}
+
+void StreamServer::send_frames(std::size_t frames) {
+    // Frame-major, so a slow subscriber's share of the send buffer does not
+    // hold one frame back from the others.
+    messages_.clear();
+    for (std::size_t f = 0; f < frames; ++f) {
+        for (Subscriber& s : subscribers_) {
+            mmsghdr m{};
+            m.msg_hdr.msg_name = &s.address;
+            m.msg_hdr.msg_namelen = sizeof(s.address);
+            m.msg_hdr.msg_iov = &frame_iovecs_[f];
+            m.msg_hdr.msg_iovlen = 1;
+            messages_.push_back(m);
+        }
+    }
+
+    std::size_t done = 0;
+    std::size_t failed_at = messages_.size();
+    while (done < messages_.size()) {
+        const int sent = ::sendmmsg(fd_, messages_.data() + done,
+                                    static_cast<unsigned>(messages_.size() - done), 0);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ECONNREFUSED || errno == EHOSTUNREACH || errno == ENETUNREACH) {
+                // Usually the ICMP error of a datagram sent earlier, which this
+                // call has now consumed, so retry the same message. Only if it
+                // fails again is the error its own: skip it, counted already.
+                if (failed_at == done) {
+                    ++done;
+                } else {
+                    ++send_failures_;
+                    failed_at = done;
+                }
+                continue;
+            }
+            throw_errno(errno, "stream: sendmmsg failed");
+        }
+        done += static_cast<std::size_t>(sent);
+        datagrams_sent_ += static_cast<std::uint64_t>(sent);
+    }
+}
+
+// ---- StreamClient ----------------------------------------------------------
+
+StreamClient::StreamClient(const StreamClientConfig& config) : config_(config) {
+    if (config.receive_batch == 0 || config.max_datagram_bytes <= sizeof(stream::FrameHeader)) {
+        throw std::invalid_argument("stream: invalid client configuration");
+    }
+    fd_ = open_udp_socket("stream: cannot create client socket");
+    set_buffer_size(fd_, SO_RCVBUFFORCE, SO_RCVBUF, config.receive_buffer_bytes);
+    sockaddr_in any{};
+    any.sin_family = AF_INET;
+    any.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(fd_, reinterpret_cast<const sockaddr*>(&any), sizeof(any)) != 0) {
+        const int err = errno;
+        ::close(fd_);
+        throw_errno(err, "stream: cannot bind client socket");
+    }
+
+    // Slots start 8-byte aligned so the sample runs after the 40-byte
+    // header are aligned for int16 access.
+    const std::size_t slot = (config.max_datagram_bytes + 7) & ~std::size_t{7};
+    buffers_.resize(config.receive_batch * slot);
+    iovecs_.resize(config.receive_batch);
+    messages_.resize(config.receive_batch);
+    for (std::size_t i = 0; i < config.receive_batch; ++i) {
+        iovecs_[i] = {buffers_.data() + i * slot, config.max_datagram_bytes};
+    }
+    frames_.reserve(config.receive_batch);
+    last_heartbeat_ = std::chrono::steady_clock::now();
+}
+
+StreamClient::~StreamClient() {
+    if (fd_ >= 0) {
+        try {
+            unsubscribe_all();
+        } catch (...) {
+        }
+        ::close(fd_);
+    }
+}
+
+void StreamClient::send_control(const sockaddr_in& server, stream::MessageKind kind) {
+    const stream::FrameHeader h = control_header(kind);
+    while (::sendto(fd_, &h, sizeof(h), 0, reinterpret_cast<const sockaddr*>(&server),
+                    sizeof(server)) < 0) {
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == ECONNREFUSED) {
+            return;  // server not up yet; the next heartbeat retries
+        }
+        throw_errno(errno, "stream: cannot send subscription");
+    }
+}
+
+void StreamClient::subscribe(const std::string& host, std::uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (::getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        throw std::invalid_argument("stream: cannot resolve " + host);
+    }
+    sockaddr_in server{};
+    std::memcpy(&server, result->ai_addr, sizeof(server));
+    ::freeaddrinfo(result);
+    server.sin_port = htons(port);
+
+    if (std::none_of(servers_.begin(), servers_.end(),
+                     [&](const sockaddr_in& s) { return same_endpoint(s, server); })) {
+        servers_.push_back(server);
+    }
+    send_control(server, stream::MessageKind::Subscribe);
+}
+
+void StreamClient::unsubscribe_all() {
+    for (const sockaddr_in& server : servers_) {
+        send_control(server, stream::MessageKind::Unsubscribe);
+    }
+    servers_.clear();
+}
+
+RigStreamStats& StreamClient::rig(std::uint16_t rig_id) {
+    auto it = std::lower_bound(rigs_.begin(), rigs_.end(), rig_id,
+                               [](const RigStreamStats& r, std::uint16_t id) { return r.rig_id < id; });
+    if (it == rigs_.end() || it->rig_id != rig_id) {
+        RigStreamStats stats;
+        stats.rig_id = rig_id;
+        it = rigs_.insert(it, stats);
+    }
+    return *it;
+}
+
+std::span<const ReceivedFrame> StreamClient::receive(std::chrono::milliseconds timeout) {
+    frames_.clear();
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_heartbeat_ >= config_.heartbeat) {
+        for (const sockaddr_in& server : servers_) {
+            send_control(server, stream::MessageKind::Subscribe);
+        }
+        last_heartbeat_ = now;
+    }
+
+    pollfd p{fd_, POLLIN, 0};
+    const int ready = ::poll(&p, 1, static_cast<int>(timeout.count()));
+    if (ready < 0 && errno != EINTR) {
+        throw_errno(errno, "stream: poll failed");
+    }
+    if (ready <= 0) {
+        return {};
+    }
+
+    for (std::size_t i = 0; i < messages_.size(); ++i) {
+        messages_[i] = {};
+        messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+        messages_[i].msg_hdr.msg_iovlen = 1;
+    }
+    int n;
+    do {
+        n = ::recvmmsg(fd_, messages_.data(), static_cast<unsigned>(messages_.size()), MSG_DONTWAIT,
+                       nullptr);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED) {
+            return {};
+        }
+        throw_errno(errno, "stream: recvmmsg failed");
+    }
+
+    for (int i = 0; i < n; ++i) {
+        const std::size_t size = messages_[i].msg_len;
+        const std::byte* data = static_cast<const std::byte*>(iovecs_[i].iov_base);
+        stream::FrameHeader h;
+        if (size < sizeof(h) || (messages_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+            ++malformed_;
+            continue;
+        }
+        std::memcpy(&h, data, sizeof(h));
+        if (h.magic != stream::kMagic || h.version != stream::kProtocolVersion ||
+            h.kind != stream::MessageKind::Data || h.channel_count == 0 || h.sample_count == 0 ||
+            size != sizeof(h) + std::size_t{h.channel_count} * h.sample_count * sizeof(std::int16_t)) {
+            ++malformed_;
+            continue;
+        }
+
+        RigStreamStats& r = rig(h.rig_id);
+        std::uint64_t missing = 0;
+        bool restarted = false;
+        if (r.frames != 0) {
+            if (h.session != r.session && r.restarts != 0 && h.session == r.previous_session) {
+                ++r.frames_late;
+                continue;
+            }
+            if (h.session != r.session || (h.sequence == 0 && r.next_sequence != 0)) {
+                ++r.restarts;
+                restarted = true;
+                r.previous_session = r.session;
+            } else if (h.sequence < r.next_sequence) {
+                ++r.frames_late;
+                continue;
+            } else {
+                missing = h.sequence - r.next_sequence;
+            }
+        }
+        r.session = h.session;
+        if (missing != 0) {
+            r.frames_lost += missing;
+            ++r.gaps;
+        }
+        ++r.frames;
+        r.next_sequence = h.sequence + 1;
+
+        ReceivedFrame f;
+        f.rig_id = h.rig_id;
+        f.sequence = h.sequence;
+        f.first_sample = h.first_sample;
+        f.timestamp_ns = h.timestamp_ns;
+        f.overrun = (h.flags & stream::kFlagOverrun) != 0;
+        f.frames_missing = missing;
+        f.restarted = restarted;
+        f.counts = ChannelBlock<const std::int16_t>(
+            reinterpret_cast<const std::int16_t*>(data + sizeof(h)), h.channel_count, h.sample_count);
+        frames_.push_back(f);
+    }
+    return frames_;
+}
+
+}  // namespace srm
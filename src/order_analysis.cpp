@@ -0,0 +1,191 @@
+#include "srm/order_analysis.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "srm/instrumentation.hpp"
+#include "srm/strain_conversion.hpp"
+
+namespace srm {
+
+// ---- OrderSpectrum -----------------------------------------------------------
+
+OrderSpectrum::OrderSpectrum(std::size_t channels, std::size_t bins, double order_per_bin)
+    : channels_(channels),
+      bins_(bins),
+      order_per_bin_(order_per_bin),
+      amplitude_sum_(channels * bins, 0.0),
+      amplitude_peak_(channels * bins, 0.0f) {}
+
+double OrderSpectrum::mean(std::size_t channel, std::size_t bin) const noexcept {
+    return frames_ == 0 ? 0.0 : amplitude_sum_[channel * bins_ + bin] / static_cast<double>(frames_);
+}
+
+void OrderSpectrum::add_frame(ChannelBlock<const float> amplitude) {
+    if (amplitude.channels() != channels_ || amplitude.samples() != bins_) {
+        throw std::invalid_argument("order spectrum: frame shape mismatch");
+    }
+    for (std::size_t c = 0; c < channels_; ++c) {
+        const std::span<const float> in = amplitude.channel(c);
+        double* sum = amplitude_sum_.data() + c * bins_;
+        float* peak = amplitude_peak_.data() + c * bins_;
+        for (std::size_t k = 0; k < bins_; ++k) {
+            sum[k] += in[k];
+            peak[k] = std::max(peak[k], in[k]);
+        }
+    }
+    ++frames_;
+}
+
+void OrderSpectrum::merge(const OrderSpectrum& later) {
+    if (empty()) {
+        *this = later;
+        return;
+    }
+    if (later.empty()) {
+        return;
+    }
+    if (later.channels_ != channels_ || later.bins_ != bins_ || later.order_per_bin_ != order_per_bin_) {
+        throw std::invalid_argument("order spectrum: merging summaries of different shape");
+    }
+    for (std::size_t i = 0; i < amplitude_sum_.size(); ++i) {
+        amplitude_sum_[i] += later.amplitude_sum_[i];
+        amplitude_peak_[i] = std::max(amplitude_peak_[i], later.amplitude_peak_[i]);
+    }
+    frames_ += later.frames_;
+}
+
+// ---- Backends ----------------------------------------------------------------
+
+std::string_view to_string(SpectralBackendKind kind) noexcept {
+    switch (kind) {
+    case SpectralBackendKind::Auto:
+        return "auto";
+    case SpectralBackendKind::Cpu:
+        return "cpu";
+    case SpectralBackendKind::Cuda:
+        return "cuda";
+    }
+    return "unknown";
+}
+
+bool spectral_backend_available(SpectralBackendKind kind) noexcept {
+    switch (kind) {
+    case SpectralBackendKind::Auto:
+    case SpectralBackendKind::Cpu:
+        return true;
+    case SpectralBackendKind::Cuda:
+#if defined(SRM_HAVE_CUDA)
+        return detail::cuda_spectral_backend_available();
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+SpectralBackend::SpectralBackend(const OrderAnalysisConfig& config) : config_(config) {}
+
+std::vector<std::size_t> detail::order_strain_channels(const CaptureInfo& info) {
+    if (info.rotor_position_channel == capture::kNoChannel) {
+        throw std::invalid_argument("order analysis: capture has no rotor position channel");
+    }
+    std::vector<std::size_t> strain;
+    for (std::size_t c = 0; c < info.channels.size(); ++c) {
+        if (c != info.rotor_position_channel) {
+            strain.push_back(c);
+        }
+    }
+    if (strain.empty()) {
+        throw std::invalid_argument("order analysis: capture has no strain channels");
+    }
+    return strain;
+}
+
+namespace {
+
+// Grid points resampled per step; bounds the angle-domain buffer.
+constexpr std::size_t kResampleBlock = 8192;
+
+class CpuSpectralBackend final : public SpectralBackend {
+public:
+    explicit CpuSpectralBackend(const OrderAnalysisConfig& config) : SpectralBackend(config) {}
+
+    SpectralBackendKind kind() const noexcept override { return SpectralBackendKind::Cpu; }
+
+    OrderSpectrum analyse(const CaptureReader& capture, ChunkRange range) const override {
+        const CaptureInfo& info = capture.info();
+        const std::vector<std::size_t> strain_channels = detail::order_strain_channels(info);
+        const std::size_t channels = strain_channels.size();
+        std::vector<ConversionParams> params;
+        for (const std::size_t c : strain_channels) {
+            params.push_back(make_conversion_params(info.channels[c]));
+        }
+
+        AngleResampler resampler(config_.resampler, channels);
+        SlidingSpectrum spectrum(config_.spectrum, channels);
+        OrderSpectrum result(channels, spectrum.bins(),
+                             static_cast<double>(config_.resampler.points_per_cycle) /
+                                 static_cast<double>(config_.spectrum.frame_size));
+
+        std::size_t longest = 0;
+        for (std::size_t k = range.first_chunk; k < range.end_chunk; ++k) {
+            longest = std::max<std::size_t>(longest, capture.chunks()[k].sample_count);
+        }
+        std::vector<std::int16_t> counts(longest);
+        std::vector<float> position(longest);
+        ChannelBuffer<float> strain(channels, longest);
+        ChannelBuffer<float> angle(channels, kResampleBlock);
+        const auto add = [&](const SpectrumFrame& frame) { result.add_frame(frame.amplitude); };
+
+        for (std::size_t k = range.first_chunk; k < range.end_chunk; ++k) {
+            SRM_SCOPED_TIMER("order_chunk");
+            const std::size_t n = capture.chunks()[k].sample_count;
+            const std::span<std::int16_t> raw = std::span(counts).first(n);
+            capture.read_channel(k, info.rotor_position_channel, raw);
+            std::copy(raw.begin(), raw.end(), position.begin());
+            for (std::size_t c = 0; c < channels; ++c) {
+                capture.read_channel(k, strain_channels[c], raw);
+                convert_channel(params[c], raw, strain.channel(c).first(n));
+            }
+
+            const ChannelBlock<const float> block = std::as_const(strain).view().subblock(0, n);
+            std::size_t pos = 0;
+            while (pos < n) {
+                const AngleResampler::Result step = resampler.process(
+                    std::span<const float>(position).subspan(pos, n - pos), block.subblock(pos, n - pos),
+                    angle.view());
+                spectrum.push(std::as_const(angle).view().subblock(0, step.produced), add);
+                pos += step.consumed;
+            }
+        }
+        return result;
+    }
+};
+
+}  // namespace
+
+std::unique_ptr<SpectralBackend> make_spectral_backend(const OrderAnalysisConfig& config,
+                                                       SpectralBackendKind kind) {
+    // The resampler and spectrum constructors do the validation.
+    static_cast<void>(AngleResampler(config.resampler, 1));
+    static_cast<void>(SlidingSpectrum(config.spectrum, 1));
+    if (config.batch_samples == 0 || config.device_lanes == 0) {
+        throw std::invalid_argument("order analysis: batch_samples and device_lanes must be positive");
+    }
+    if (kind != SpectralBackendKind::Auto && !spectral_backend_available(kind)) {
+        throw std::runtime_error("order analysis: " + std::string(to_string(kind)) +
+                                 " backend is not available");
+    }
+#if defined(SRM_HAVE_CUDA)
+    if (kind == SpectralBackendKind::Cuda ||
+        (kind == SpectralBackendKind::Auto && detail::cuda_spectral_backend_available())) {
+        return detail::make_cuda_spectral_backend(config);
+    }
+#endif
+    return std::make_unique<CpuSpectralBackend>(config);
+}
+
+}  // namespace srm
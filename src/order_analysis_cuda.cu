@@ -0,0 +1,503 @@
+// CUDA backend of order_analysis.hpp, built with -DSRM_ENABLE_CUDA=ON.
+//
+// The host keeps what is inherently sequential: decoding the chunk and
+// tracking the rotor position, which yields, per grid point, the pair of
+// samples it falls between and the fraction (AngleResampler::locate()).
+// Raw counts and crossings go to the device in batches through pinned,
+// double-buffered staging on a copy stream, while the compute stream
+// converts, interpolates into an angle-domain history ring, windows every
+// completed frame, runs one batched cuFFT over all frames and channels and
+// folds the amplitudes into per-(channel, bin) accumulators. Each
+// accumulator is owned by one thread and updated in frame order, so the
+// summary is deterministic.
+
+#include "srm/order_analysis.hpp"
+
+#include <cuda_runtime.h>
+#include <cufft.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "srm/fft.hpp"
+#include "srm/instrumentation.hpp"
+#include "srm/strain_conversion.hpp"
+
+namespace srm {
+
+namespace {
+
+void check(cudaError_t status, const char* what) {
+    if (status != cudaSuccess) {
+        throw std::runtime_error(std::string("order analysis: ") + what + ": " + cudaGetErrorString(status));
+    }
+}
+
+void check(cufftResult status, const char* what) {
+    if (status != CUFFT_SUCCESS) {
+        throw std::runtime_error(std::string("order analysis: ") + what + ": cuFFT error " +
+                                 std::to_string(static_cast<int>(status)));
+    }
+}
+
+struct DeviceParams {
+    float offset_counts;
+    float ratio_per_count;
+    float strain_coeff;
+    int quarter;
+};
+
+// convert_sample() operation for operation; the _rn intrinsics keep nvcc
+// from contracting into FMAs so both backends round alike.
+__device__ float convert(const DeviceParams& p, short counts) {
+    const float r = __fmul_rn(__fsub_rn(static_cast<float>(counts), p.offset_counts), p.ratio_per_count);
+    const float linear = __fmul_rn(p.strain_coeff, r);
+    return p.quarter ? __fdiv_rn(linear, __fadd_rn(1.0f, __fadd_rn(r, r))) : linear;
+}
+
+// One thread per (grid point, channel). Row c of @p counts holds the
+// carried sample followed by the batch, so crossing.sample indexes the
+// sample before the grid point directly.
+__global__ void resample_kernel(const short* counts, std::size_t pitch, const GridCrossing* crossings,
+                                unsigned points, const DeviceParams* params, float* history,
+                                std::size_t ring, unsigned long long first_point) {
+    const unsigned g = blockIdx.x * blockDim.x + threadIdx.x;
+    const unsigned c = blockIdx.y;
+    if (g >= points) {
+        return;
+    }
+    const GridCrossing x = crossings[g];
+    const short* row = counts + c * pitch;
+    const float a = convert(params[c], row[x.sample]);
+    const float b = convert(params[c], row[x.sample + 1]);
+    history[c * ring + ((first_point + g) & (ring - 1))] = __fadd_rn(a, __fmul_rn(x.fraction, __fsub_rn(b, a)));
+}
+
+// Frame f ends at grid point first_end + f * hop; frames are laid out
+// frame-major so one batched transform covers them all.
+__global__ void window_kernel(const float* history, std::size_t ring, const float* window,
+                              std::size_t frame_size, unsigned channels, unsigned long long first_end,
+                              std::size_t hop, float* frames) {
+    const std::size_t n = blockIdx.x * static_cast<std::size_t>(blockDim.x) + threadIdx.x;
+    const unsigned c = blockIdx.y;
+    const unsigned f = blockIdx.z;
+    if (n >= frame_size) {
+        return;
+    }
+    const unsigned long long first = first_end + f * hop - frame_size;
+    frames[(static_cast<std::size_t>(f) * channels + c) * frame_size + n] =
+        __fmul_rn(history[c * ring + ((first + n) & (ring - 1))], window[n]);
+}
+
+__global__ void accumulate_kernel(const cufftComplex* spectrum, unsigned frames, unsigned channels,
+                                  unsigned bins, float edge_scale, float inner_scale, double* sum,
+                                  float* peak) {
+    const unsigned k = blockIdx.x * blockDim.x + threadIdx.x;
+    const unsigned c = blockIdx.y;
+    if (k >= bins) {
+        return;
+    }
+    const float scale = k == 0 || k == bins - 1 ? edge_scale : inner_scale;
+    double s = sum[c * bins + k];
+    float p = peak[c * bins + k];
+    for (unsigned f = 0; f < frames; ++f) {
+        const cufftComplex z = spectrum[(static_cast<std::size_t>(f) * channels + c) * bins + k];
+        const float amplitude = sqrtf(z.x * z.x + z.y * z.y) * scale;
+        s += amplitude;
+        p = fmaxf(p, amplitude);
+    }
+    sum[c * bins + k] = s;
+    peak[c * bins + k] = p;
+}
+
+constexpr unsigned kThreads = 256;
+
+unsigned blocks_for(std::size_t n) {
+    return static_cast<unsigned>((n + kThreads - 1) / kThreads);
+}
+
+std::size_t round_up_pow2(std::size_t n) {
+    std::size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+void free_device(void* p) noexcept { cudaFree(p); }
+void free_pinned(void* p) noexcept { cudaFreeHost(p); }
+void destroy_stream(cudaStream_t s) noexcept { cudaStreamDestroy(s); }
+void destroy_event(cudaEvent_t e) noexcept { cudaEventDestroy(e); }
+
+/// Owns one CUDA resource, so a Lane that fails part-way through setting
+/// itself up releases what it already had.
+template <typename Handle, auto Destroy>
+class Owned {
+public:
+    Owned() noexcept = default;
+    explicit Owned(Handle handle) noexcept : handle_(handle) {}
+    Owned(Owned&& other) noexcept : handle_(std::exchange(other.handle_, Handle{})) {}
+    Owned& operator=(Owned&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, Handle{});
+        }
+        return *this;
+    }
+    ~Owned() { reset(); }
+
+    void reset() noexcept {
+        if (handle_ != Handle{}) {
+            Destroy(handle_);
+            handle_ = Handle{};
+        }
+    }
+    Handle get() const noexcept { return handle_; }
+    operator Handle() const noexcept { return handle_; }
+
+private:
+    Handle handle_{};
+};
+
+template <typename T>
+using DeviceArray = Owned<T*, free_device>;
+template <typename T>
+using PinnedArray = Owned<T*, free_pinned>;
+using Stream = Owned<cudaStream_t, destroy_stream>;
+using Event = Owned<cudaEvent_t, destroy_event>;
+
+template <typename T>
+DeviceArray<T> device_array(std::size_t n) {
+    T* p = nullptr;
+    check(cudaMalloc(&p, n * sizeof(T)), "cudaMalloc");
+    return DeviceArray<T>(p);
+}
+
+template <typename T>
+PinnedArray<T> pinned_array(std::size_t n) {
+    T* p = nullptr;
+    check(cudaMallocHost(&p, n * sizeof(T)), "cudaMallocHost");
+    return PinnedArray<T>(p);
+}
+
+Stream make_stream() {
+    cudaStream_t s = nullptr;
+    check(cudaStreamCreateWithFlags(&s, cudaStreamNonBlocking), "cudaStreamCreate");
+    return Stream(s);
+}
+
+Event make_event() {
+    cudaEvent_t e = nullptr;
+    check(cudaEventCreateWithFlags(&e, cudaEventDisableTiming), "cudaEventCreate");
+    return Event(e);
+}
+
+/// cuFFT plans by batch size. Handle 0 is a valid plan, so these are kept
+/// in a map rather than in Owned.
+struct FftPlans {
+    FftPlans() = default;
+    FftPlans(const FftPlans&) = delete;
+    FftPlans& operator=(const FftPlans&) = delete;
+    ~FftPlans() {
+        for (const auto& [transforms, handle] : handles) {
+            cufftDestroy(handle);
+        }
+    }
+
+    std::map<int, cufftHandle> handles;
+};
+
+/// Streams, staging and device buffers for one analyse() call at a time.
+struct Lane {
+    Lane(std::size_t batch_samples, std::size_t frame_size, std::size_t hop, std::span<const float> window)
+        : batch(batch_samples),
+          pitch(batch_samples + 1),
+          ring(round_up_pow2(frame_size + batch_samples)),
+          max_frames(batch_samples / hop + 1),
+          frame_size(frame_size),
+          bins(frame_size / 2 + 1),
+          copy(make_stream()),
+          compute(make_stream()) {
+        for (int s = 0; s < 2; ++s) {
+            copied[s] = make_event();
+            consumed[s] = make_event();
+            host_crossings[s] = pinned_array<GridCrossing>(batch);
+            dev_crossings[s] = device_array<GridCrossing>(batch);
+        }
+        dev_window = device_array<float>(frame_size);
+        check(cudaMemcpy(dev_window, window.data(), frame_size * sizeof(float), cudaMemcpyHostToDevice),
+              "cudaMemcpy");
+    }
+
+    // Members are released in reverse order, streams last, once both have
+    // drained.
+    ~Lane() {
+        cudaStreamSynchronize(copy);
+        cudaStreamSynchronize(compute);
+    }
+
+    Lane(const Lane&) = delete;
+    Lane& operator=(const Lane&) = delete;
+
+    /// Sizes the channel-dependent buffers for @p n channels.
+    void reserve(std::size_t n) {
+        if (n <= channels) {
+            return;
+        }
+        channels = 0;
+        for (int s = 0; s < 2; ++s) {
+            host_counts[s] = pinned_array<short>(n * pitch);
+            dev_counts[s] = device_array<short>(n * pitch);
+        }
+        dev_params = device_array<DeviceParams>(n);
+        history = device_array<float>(n * ring);
+        frames = device_array<float>(max_frames * n * frame_size);
+        spectrum = device_array<cufftComplex>(max_frames * n * bins);
+        sum = device_array<double>(n * bins);
+        peak = device_array<float>(n * bins);
+        channels = n;
+    }
+
+    /// Batched plan for @p transforms frames.
+    cufftHandle plan(int transforms) {
+        const auto it = plans.handles.find(transforms);
+        if (it != plans.handles.end()) {
+            return it->second;
+        }
+        cufftHandle handle;
+        check(cufftPlan1d(&handle, static_cast<int>(frame_size), CUFFT_R2C, transforms), "cufftPlan1d");
+        plans.handles.emplace(transforms, handle);  // owned from here on
+        check(cufftSetStream(handle, compute), "cufftSetStream");
+        return handle;
+    }
+
+    const std::size_t batch;       // samples and grid points per transfer
+    const std::size_t pitch;       // counts row length: carried sample + batch
+    const std::size_t ring;        // history length, power of two >= frame + batch
+    const std::size_t max_frames;  // frames one batch can complete
+    const std::size_t frame_size;
+    const std::size_t bins;
+    std::size_t channels = 0;
+
+    Stream copy;
+    Stream compute;
+    Event copied[2];    // staging slot s may be refilled
+    Event consumed[2];  // device slot s may be overwritten
+    PinnedArray<short> host_counts[2];
+    PinnedArray<GridCrossing> host_crossings[2];
+    DeviceArray<short> dev_counts[2];
+    DeviceArray<GridCrossing> dev_crossings[2];
+    DeviceArray<DeviceParams> dev_params;
+    DeviceArray<float> dev_window;
+    DeviceArray<float> history;
+    DeviceArray<float> frames;
+    DeviceArray<cufftComplex> spectrum;
+    DeviceArray<double> sum;
+    DeviceArray<float> peak;
+    FftPlans plans;
+};
+
+class CudaSpectralBackend final : public SpectralBackend {
+public:
+    explicit CudaSpectralBackend(const OrderAnalysisConfig& config)
+        : SpectralBackend(config), window_(make_window(config.spectrum.window, config.spectrum.frame_size)) {
+        const double gain = std::accumulate(window_.begin(), window_.end(), 0.0);
+        edge_scale_ = static_cast<float>(1.0 / gain);
+        inner_scale_ = static_cast<float>(2.0 / gain);
+    }
+
+    SpectralBackendKind kind() const noexcept override { return SpectralBackendKind::Cuda; }
+
+    OrderSpectrum analyse(const CaptureReader& capture, ChunkRange range) const override {
+        const CaptureInfo& info = capture.info();
+        const std::vector<std::size_t> strain_channels = detail::order_strain_channels(info);
+        const std::size_t channels = strain_channels.size();
+        std::vector<DeviceParams> params;
+        for (const std::size_t c : strain_channels) {
+            const ConversionParams p = make_conversion_params(info.channels[c]);
+            params.push_back({p.offset_counts, p.ratio_per_count, p.strain_coeff,
+                              p.bridge == capture::BridgeConfig::Quarter ? 1 : 0});
+        }
+        const std::size_t frame_size = config_.spectrum.frame_size;
+        const std::size_t hop = config_.spectrum.hop;
+        OrderSpectrum result(channels, frame_size / 2 + 1,
+                             static_cast<double>(config_.resampler.points_per_cycle) /
+                                 static_cast<double>(frame_size));
+
+        LaneGuard guard(*this);
+        Lane& lane = *guard.lane;
+        lane.reserve(channels);
+        check(cudaMemcpyAsync(lane.dev_params, params.data(), channels * sizeof(DeviceParams),
+                              cudaMemcpyHostToDevice, lane.compute),
+              "cudaMemcpyAsync");
+        check(cudaMemsetAsync(lane.sum, 0, channels * lane.bins * sizeof(double), lane.compute), "cudaMemsetAsync");
+        check(cudaMemsetAsync(lane.peak, 0, channels * lane.bins * sizeof(float), lane.compute), "cudaMemsetAsync");
+
+        std::size_t longest = 0;
+        for (std::size_t k = range.first_chunk; k < range.end_chunk; ++k) {
+            longest = std::max<std::size_t>(longest, capture.chunks()[k].sample_count);
+        }
+        ChannelBuffer<std::int16_t> decoded(channels, longest);
+        std::vector<std::int16_t> raw_position(longest);
+        std::vector<float> position(longest);
+        std::vector<std::int16_t> carry(channels, 0);
+
+        AngleResampler tracker(config_.resampler, 1);
+        std::uint64_t filled = 0;  // grid points written to the history ring
+        std::uint64_t next_end = (frame_size + hop - 1) / hop * hop;
+        std::uint64_t frames = 0;
+        int slot = 0;
+
+        for (std::size_t k = range.first_chunk; k < range.end_chunk; ++k) {
+            SRM_SCOPED_TIMER("order_chunk");
+            const std::size_t n = capture.chunks()[k].sample_count;
+            capture.read_channel(k, info.rotor_position_channel, std::span(raw_position).first(n));
+            std::copy_n(raw_position.begin(), n, position.begin());
+            for (std::size_t c = 0; c < channels; ++c) {
+                capture.read_channel(k, strain_channels[c], decoded.channel(c).first(n));
+            }
+
+            std::size_t pos = 0;
+            while (pos < n) {
+                const std::size_t length = std::min(lane.batch, n - pos);
+                check(cudaEventSynchronize(lane.copied[slot]), "cudaEventSynchronize");
+                const AngleResampler::Result step =
+                    tracker.locate(std::span<const float>(position).subspan(pos, length),
+                                   std::span(lane.host_crossings[slot].get(), lane.batch));
+                // A batch that fills up mid-sample still needs that sample.
+                const std::size_t staged = std::min(length, step.consumed + 1);
+                for (std::size_t c = 0; c < channels; ++c) {
+                    short* row = lane.host_counts[slot].get() + c * lane.pitch;
+                    row[0] = carry[c];
+                    std::copy_n(decoded.channel(c).begin() + static_cast<std::ptrdiff_t>(pos), staged, row + 1);
+                }
+
+                check(cudaStreamWaitEvent(lane.copy, lane.consumed[slot], 0), "cudaStreamWaitEvent");
+                check(cudaMemcpy2DAsync(lane.dev_counts[slot], lane.pitch * sizeof(short), lane.host_counts[slot],
+                                        lane.pitch * sizeof(short), (staged + 1) * sizeof(short), channels,
+                                        cudaMemcpyHostToDevice, lane.copy),
+                      "cudaMemcpy2DAsync");
+                check(cudaMemcpyAsync(lane.dev_crossings[slot], lane.host_crossings[slot],
+                                      step.produced * sizeof(GridCrossing), cudaMemcpyHostToDevice, lane.copy),
+                      "cudaMemcpyAsync");
+                check(cudaEventRecord(lane.copied[slot], lane.copy), "cudaEventRecord");
+
+                check(cudaStreamWaitEvent(lane.compute, lane.copied[slot], 0), "cudaStreamWaitEvent");
+                if (step.produced != 0) {
+                    resample_kernel<<<dim3(blocks_for(step.produced), static_cast<unsigned>(channels)), kThreads, 0,
+                                      lane.compute>>>(lane.dev_counts[slot], lane.pitch, lane.dev_crossings[slot],
+                                                      static_cast<unsigned>(step.produced), lane.dev_params,
+                                                      lane.history, lane.ring, filled);
+                    check(cudaGetLastError(), "resample kernel");
+                    filled += step.produced;
+                }
+                std::size_t completed = 0;
+                while (next_end + completed * hop <= filled) {
+                    ++completed;
+                }
+                if (completed != 0) {
+                    window_kernel<<<dim3(blocks_for(frame_size), static_cast<unsigned>(channels),
+                                         static_cast<unsigned>(completed)),
+                                    kThreads, 0, lane.compute>>>(lane.history, lane.ring, lane.dev_window,
+                                                                 frame_size, static_cast<unsigned>(channels),
+                                                                 next_end, hop, lane.frames);
+                    check(cudaGetLastError(), "window kernel");
+                    check(cufftExecR2C(lane.plan(static_cast<int>(completed * channels)), lane.frames,
+                                       lane.spectrum),
+                          "cufftExecR2C");
+                    accumulate_kernel<<<dim3(blocks_for(lane.bins), static_cast<unsigned>(channels)), kThreads, 0,
+                                        lane.compute>>>(lane.spectrum, static_cast<unsigned>(completed),
+                                                        static_cast<unsigned>(channels),
+                                                        static_cast<unsigned>(lane.bins), edge_scale_,
+                                                        inner_scale_, lane.sum, lane.peak);
+                    check(cudaGetLastError(), "accumulate kernel");
+                    frames += completed;
+                    next_end += completed * hop;
+                }
+                check(cudaEventRecord(lane.consumed[slot], lane.compute), "cudaEventRecord");
+
+                if (step.consumed != 0) {
+                    for (std::size_t c = 0; c < channels; ++c) {
+                        carry[c] = decoded.channel(c)[pos + step.consumed - 1];
+                    }
+                }
+                pos += step.consumed;
+                slot ^= 1;
+            }
+        }
+
+        check(cudaMemcpyAsync(result.amplitude_sum().data(), lane.sum, channels * lane.bins * sizeof(double),
+                              cudaMemcpyDeviceToHost, lane.compute),
+              "cudaMemcpyAsync");
+        check(cudaMemcpyAsync(result.amplitude_peak().data(), lane.peak, channels * lane.bins * sizeof(float),
+                              cudaMemcpyDeviceToHost, lane.compute),
+              "cudaMemcpyAsync");
+        check(cudaStreamSynchronize(lane.compute), "cudaStreamSynchronize");
+        result.set_frames(frames);
+        return result;
+    }
+
+private:
+    /// Borrows a lane for one analyse() call, creating up to device_lanes.
+    struct LaneGuard {
+        explicit LaneGuard(const CudaSpectralBackend& backend) : owner(backend) {
+            std::unique_lock lock(owner.lanes_mutex_);
+            owner.lane_free_.wait(lock, [&] {
+                return !owner.idle_lanes_.empty() || owner.lanes_.size() < owner.config_.device_lanes;
+            });
+            if (owner.idle_lanes_.empty()) {
+                owner.lanes_.push_back(std::make_unique<Lane>(owner.config_.batch_samples,
+                                                              owner.config_.spectrum.frame_size,
+                                                              owner.config_.spectrum.hop, owner.window_));
+                lane = owner.lanes_.back().get();
+            } else {
+                lane = owner.idle_lanes_.back();
+                owner.idle_lanes_.pop_back();
+            }
+        }
+        ~LaneGuard() {
+            // Nothing may still read the staging buffers when the lane is reused.
+            cudaStreamSynchronize(lane->copy);
+            cudaStreamSynchronize(lane->compute);
+            {
+                const std::lock_guard lock(owner.lanes_mutex_);
+                owner.idle_lanes_.push_back(lane);
+            }
+            owner.lane_free_.notify_one();
+        }
+        LaneGuard(const LaneGuard&) = delete;
+        LaneGuard& operator=(const LaneGuard&) = delete;
+
+        const CudaSpectralBackend& owner;
+        Lane* lane = nullptr;
+    };
+
+    AlignedVector<float> window_;
+    float edge_scale_;
+    float inner_scale_;
+
+    mutable std::mutex lanes_mutex_;
+    mutable std::condition_variable lane_free_;
+    mutable std::vector<std::unique_ptr<Lane>> lanes_;
+    mutable std::vector<Lane*> idle_lanes_;
+};
+
+}  // namespace
+
+bool detail::cuda_spectral_backend_available() noexcept {
+    int devices = 0;
+    return cudaGetDeviceCount(&devices) == cudaSuccess && devices > 0;
+}
+
+std::unique_ptr<SpectralBackend> detail::make_cuda_spectral_backend(const OrderAnalysisConfig& config) {
+    return std::make_unique<CudaSpectralBackend>(config);
+}
+
+}  // namespace srm
@@ -0,0 +1,871 @@
+#include "srm/results_store.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+using results::kAlignment;
+using results::kZoneRows;
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/// Sequential writer that tracks the file offset.
+class FileOut {
+public:
+    explicit FileOut(const std::filesystem::path& path) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw_errno("results: cannot create " + path.string());
+        }
+    }
+    ~FileOut() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    std::uint64_t offset() const noexcept { return offset_; }
+
+    void write(const void* data, std::size_t size) {
+        const auto* p = static_cast<const char*>(data);
+        while (size > 0) {
+            const ssize_t n = ::write(fd_, p, size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw_errno("results: write failed");
+            }
+            p += n;
+            size -= static_cast<std::size_t>(n);
+            offset_ += static_cast<std::uint64_t>(n);
+        }
+    }
+
+    template <typename T>
+    std::uint64_t write_array(const std::vector<T>& values) {
+        pad();
+        const std::uint64_t at = offset_;
+        write(values.data(), values.size() * sizeof(T));
+        return at;
+    }
+
+    void pad() {
+        static constexpr std::array<char, kAlignment> zeros{};
+        write(zeros.data(), static_cast<std::size_t>(align_up(offset_, kAlignment) - offset_));
+    }
+
+    void close() {
+        const int fd = std::exchange(fd_, -1);
+        if (::close(fd) != 0) {
+            throw_errno("results: close failed");
+        }
+    }
+
+private:
+    int fd_ = -1;
+    std::uint64_t offset_ = 0;
+};
+
+template <typename T>
+std::vector<results::Zone<T>> zone_map(const std::vector<T>& values) {
+    std::vector<results::Zone<T>> zones;
+    zones.reserve((values.size() + kZoneRows - 1) / kZoneRows);
+    for (std::size_t first = 0; first < values.size(); first += kZoneRows) {
+        const std::size_t end = std::min<std::size_t>(values.size(), first + kZoneRows);
+        T lo = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                    : std::numeric_limits<T>::max();
+        T hi = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity()
+                                                    : std::numeric_limits<T>::lowest();
+        for (std::size_t i = first; i < end; ++i) {
+            // Argument order keeps NaNs out of the bounds.
+            lo = std::min(lo, values[i]);
+            hi = std::max(hi, values[i]);
+        }
+        zones.push_back({lo, hi});
+    }
+    return zones;
+}
+
+}  // namespace
+
+const char* to_string(ColumnType type) noexcept {
+    switch (type) {
+    case ColumnType::Float64:
+        return "float64";
+    case ColumnType::Int64:
+        return "int64";
+    case ColumnType::Key:
+        return "key";
+    }
+    return "unknown";
+}
+
+// ---- ResultsWriter ----------------------------------------------------------
+
+ResultsWriter::ResultsWriter(std::filesystem::path path) : path_(std::move(path)) {}
+
+ResultsWriter::~ResultsWriter() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+std::size_t ResultsWriter::add_column(std::string_view name, ColumnType type) {
+    if (rows_ != 0 || finished_) {
+        throw std::logic_error("results: columns must be declared before the first row");
+    }
+    if (name.empty() || name.size() >= std::tuple_size_v<decltype(results::ColumnDescriptor::name)>) {
+        throw std::invalid_argument("results: column name must be 1 to 39 bytes");
+    }
+    if (type != ColumnType::Float64 && type != ColumnType::Int64 && type != ColumnType::Key) {
+        throw std::invalid_argument("results: unknown column type");
+    }
+    for (const Column& c : columns_) {
+        if (c.name == name) {
+            throw std::invalid_argument("results: duplicate column " + std::string(name));
+        }
+    }
+    Column c;
+    c.name = name;
+    c.type = type;
+    columns_.push_back(std::move(c));
+    return columns_.size() - 1;
+}
+
+ResultsWriter::Column& ResultsWriter::column_for(std::size_t column, ColumnType type) {
+    if (finished_) {
+        throw std::logic_error("results: set after finish");
+    }
+    if (column >= columns_.size()) {
+        throw std::invalid_argument("results: unknown column " + std::to_string(column));
+    }
+    Column& c = columns_[column];
+    if (c.type != type) {
+        throw std::invalid_argument("results: column " + c.name + " is " + to_string(c.type) + ", not " +
+                                    to_string(type));
+    }
+    return c;
+}
+
+void ResultsWriter::set(std::size_t column, double value) {
+    Column& c = column_for(column, ColumnType::Float64);
+    if (c.set) {
+        c.f64.back() = value;
+    } else {
+        c.f64.push_back(value);
+    }
+    c.set = true;
+}
+
+void ResultsWriter::set(std::size_t column, std::int64_t value) {
+    Column& c = column_for(column, ColumnType::Int64);
+    if (c.set) {
+        c.i64.back() = value;
+    } else {
+        c.i64.push_back(value);
+    }
+    c.set = true;
+}
+
+void ResultsWriter::set(std::size_t column, std::string_view key) {
+    Column& c = column_for(column, ColumnType::Key);
+    auto it = c.lookup.find(key);
+    if (it == c.lookup.end()) {
+        if (c.dictionary.size() == std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("results: dictionary of " + c.name + " is full");
+        }
+        it = c.lookup.emplace(std::string(key), static_cast<std::uint32_t>(c.dictionary.size())).first;
+        c.dictionary.emplace_back(key);
+    }
+    if (c.set) {
+        c.codes.back() = it->second;
+    } else {
+        c.codes.push_back(it->second);
+    }
+    c.set = true;
+}
+
+void ResultsWriter::end_row() {
+    const auto missing = std::find_if(columns_.begin(), columns_.end(), [](const Column& c) { return !c.set; });
+    if (missing != columns_.end()) {
+        const std::string name = missing->name;
+        for (Column& c : columns_) {
+            if (c.set) {
+                switch (c.type) {
+                case ColumnType::Float64:
+                    c.f64.pop_back();
+                    break;
+                case ColumnType::Int64:
+                    c.i64.pop_back();
+                    break;
+                case ColumnType::Key:
+                    c.codes.pop_back();
+                    break;
+                }
+            }
+            c.set = false;
+        }
+        throw std::logic_error("results: column " + name + " not set");
+    }
+    for (Column& c : columns_) {
+        c.set = false;
+    }
+    ++rows_;
+}
+
+void ResultsWriter::finish() {
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    SRM_SCOPED_TIMER("results_finish");
+
+    FileOut out(path_);
+    results::FileHeader header{};
+    header.magic = results::kFileMagic;
+    header.version = results::kFormatVersion;
+    header.zone_rows = kZoneRows;
+    header.row_count = rows_;
+    header.column_count = static_cast<std::uint32_t>(columns_.size());
+    out.write(&header, sizeof(header));
+
+    std::vector<results::ColumnDescriptor> descriptors(columns_.size());
+    for (std::size_t k = 0; k < columns_.size(); ++k) {
+        Column& c = columns_[k];
+        // An unfinished row is dropped.
+        c.f64.resize(c.type == ColumnType::Float64 ? rows_ : 0);
+        c.i64.resize(c.type == ColumnType::Int64 ? rows_ : 0);
+        c.codes.resize(c.type == ColumnType::Key ? rows_ : 0);
+
+        results::ColumnDescriptor& d = descriptors[k];
+        d = {};
+        std::copy(c.name.begin(), c.name.end(), d.name.begin());
+        d.type = c.type;
+        switch (c.type) {
+        case ColumnType::Float64:
+            d.values_offset = out.write_array(c.f64);
+            d.zones_offset = out.write_array(zone_map(c.f64));
+            break;
+        case ColumnType::Int64:
+            d.values_offset = out.write_array(c.i64);
+            d.zones_offset = out.write_array(zone_map(c.i64));
+            break;
+        case ColumnType::Key: {
+            // Sort the dictionary and renumber, so codes order like keys.
+            std::vector<std::uint32_t> order(c.dictionary.size());
+            std::iota(order.begin(), order.end(), 0u);
+            std::sort(order.begin(), order.end(),
+                      [&](std::uint32_t a, std::uint32_t b) { return c.dictionary[a] < c.dictionary[b]; });
+            std::vector<std::uint32_t> rank(order.size());
+            for (std::size_t r = 0; r < order.size(); ++r) {
+                rank[order[r]] = static_cast<std::uint32_t>(r);
+            }
+            for (std::uint32_t& code : c.codes) {
+                code = rank[code];
+            }
+            std::vector<std::int64_t> widened(c.codes.begin(), c.codes.end());
+            std::vector<std::uint32_t> offsets{0};
+            std::string blob;
+            for (const std::uint32_t old : order) {
+                blob += c.dictionary[old];
+                if (blob.size() > std::numeric_limits<std::uint32_t>::max()) {
+                    throw std::length_error("results: dictionary of " + c.name + " too large");
+                }
+                offsets.push_back(static_cast<std::uint32_t>(blob.size()));
+            }
+            d.dictionary_size = static_cast<std::uint32_t>(order.size());
+            d.values_offset = out.write_array(c.codes);
+            d.zones_offset = out.write_array(zone_map(widened));
+            d.dictionary_offset = out.write_array(offsets);
+            out.write(blob.data(), blob.size());
+            break;
+        }
+        }
+    }
+
+    results::FileTrailer trailer{};
+    trailer.columns_offset = out.write_array(descriptors);
+    trailer.row_count = rows_;
+    trailer.magic = results::kTrailerMagic;
+    out.write(&trailer, sizeof(trailer));
+    out.close();
+}
+
+// ---- ResultsReader ----------------------------------------------------------
+
+ResultsReader::ResultsReader(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw_errno("results: cannot open " + path.string());
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "results: fstat failed");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ < sizeof(results::FileHeader) + sizeof(results::FileTrailer)) {
+        ::close(fd);
+        throw std::runtime_error("results: file too short: " + path.string());
+    }
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    const int map_err = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::system_error(map_err, std::generic_category(), "results: mmap failed");
+    }
+    base_ = static_cast<const std::byte*>(map);
+
+    try {
+        results::FileHeader header;
+        std::memcpy(&header, base_, sizeof(header));
+        if (header.magic != results::kFileMagic) {
+            throw std::runtime_error("results: not a results store");
+        }
+        if (header.version != results::kFormatVersion) {
+            throw std::runtime_error("results: unsupported version " + std::to_string(header.version));
+        }
+        if (header.zone_rows != kZoneRows) {
+            throw std::runtime_error("results: malformed header");
+        }
+        results::FileTrailer trailer;
+        std::memcpy(&trailer, base_ + size_ - sizeof(trailer), sizeof(trailer));
+        if (trailer.magic != results::kTrailerMagic || trailer.row_count != header.row_count) {
+            throw std::runtime_error("results: missing trailer (unfinished store?)");
+        }
+        const std::uint64_t end = size_ - sizeof(trailer);
+        const std::uint64_t table_bytes = std::uint64_t{header.column_count} * sizeof(results::ColumnDescriptor);
+        if (trailer.columns_offset % alignof(results::ColumnDescriptor) != 0 || trailer.columns_offset > end ||
+            table_bytes > end - trailer.columns_offset) {
+            throw std::runtime_error("results: column table out of bounds");
+        }
+        rows_ = static_cast<std::size_t>(header.row_count);
+        columns_ = {reinterpret_cast<const results::ColumnDescriptor*>(base_ + trailer.columns_offset),
+                    header.column_count};
+
+        const std::uint64_t zones = zone_count();
+        const auto fits = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t size) {
+            return offset % kAlignment == 0 && offset <= trailer.columns_offset &&
+                   count <= (trailer.columns_offset - offset) / size;
+        };
+        for (const results::ColumnDescriptor& d : columns_) {
+            if (d.name.back() != '\0' || d.name[0] == '\0') {
+                throw std::runtime_error("results: malformed column name");
+            }
+            const std::uint64_t value_size = d.type == ColumnType::Key ? sizeof(std::uint32_t) : 8;
+            if ((d.type != ColumnType::Float64 && d.type != ColumnType::Int64 && d.type != ColumnType::Key) ||
+                !fits(d.values_offset, rows_, value_size) || !fits(d.zones_offset, zones, 16)) {
+                throw std::runtime_error("results: column out of bounds");
+            }
+            if (d.type != ColumnType::Key) {
+                continue;
+            }
+            const std::uint64_t n = d.dictionary_size;
+            if (!fits(d.dictionary_offset, n + 1, sizeof(std::uint32_t))) {
+                throw std::runtime_error("results: dictionary out of bounds");
+            }
+            const auto* offsets = reinterpret_cast<const std::uint32_t*>(base_ + d.dictionary_offset);
+            const std::uint64_t blob = d.dictionary_offset + (n + 1) * sizeof(std::uint32_t);
+            for (std::uint64_t i = 0; i < n; ++i) {
+                if (offsets[i] > offsets[i + 1]) {
+                    throw std::runtime_error("results: malformed dictionary");
+                }
+            }
+            if (offsets[0] != 0 || offsets[n] > trailer.columns_offset - blob) {
+                throw std::runtime_error("results: dictionary out of bounds");
+            }
+            // Queries and key() index by the codes themselves, and nothing
+            // ties them to their zones, so each one is checked: a single
+            // vectorised max over four bytes a row.
+            const auto* codes = reinterpret_cast<const std::uint32_t*>(base_ + d.values_offset);
+            std::uint32_t largest = 0;
+            for (std::size_t r = 0; r < rows_; ++r) {
+                largest = codes[r] > largest ? codes[r] : largest;
+            }
+            if (rows_ != 0 && largest >= n) {
+                throw std::runtime_error("results: key code out of range");
+            }
+        }
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+ResultsReader::~ResultsReader() {
+    unmap();
+}
+
+ResultsReader::ResultsReader(ResultsReader&& other) noexcept
+    : base_(std::exchange(other.base_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      rows_(std::exchange(other.rows_, 0)),
+      columns_(std::exchange(other.columns_, {})) {}
+
+ResultsReader& ResultsReader::operator=(ResultsReader&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        base_ = std::exchange(other.base_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        rows_ = std::exchange(other.rows_, 0);
+        columns_ = std::exchange(other.columns_, {});
+    }
+    return *this;
+}
+
+void ResultsReader::unmap() noexcept {
+    if (base_ != nullptr) {
+        ::munmap(const_cast<std::byte*>(base_), size_);
+        base_ = nullptr;
+    }
+}
+
+std::size_t ResultsReader::column(std::string_view name) const {
+    for (std::size_t k = 0; k < columns_.size(); ++k) {
+        if (column_name(k) == name) {
+            return k;
+        }
+    }
+    throw std::out_of_range("results: no column " + std::string(name));
+}
+
+std::string_view ResultsReader::column_name(std::size_t column) const noexcept {
+    return columns_[column].name.data();
+}
+
+const results::ColumnDescriptor& ResultsReader::descriptor(std::size_t column, ColumnType type) const {
+    const results::ColumnDescriptor& d = columns_[column];
+    if (d.type != type) {
+        throw std::invalid_argument("results: column " + std::string(column_name(column)) + " is " +
+                                    to_string(d.type) + ", not " + to_string(type));
+    }
+    return d;
+}
+
+std::span<const double> ResultsReader::f64(std::size_t column) const {
+    const results::ColumnDescriptor& d = descriptor(column, ColumnType::Float64);
+    return {reinterpret_cast<const double*>(base_ + d.values_offset), rows_};
+}
+
+std::span<const std::int64_t> ResultsReader::i64(std::size_t column) const {
+    const results::ColumnDescriptor& d = descriptor(column, ColumnType::Int64);
+    return {reinterpret_cast<const std::int64_t*>(base_ + d.values_offset), rows_};
+}
+
+std::span<const std::uint32_t> ResultsReader::codes(std::size_t column) const {
+    const results::ColumnDescriptor& d = descriptor(column, ColumnType::Key);
+    return {reinterpret_cast<const std::uint32_t*>(base_ + d.values_offset), rows_};
+}
+
+std::span<const results::Zone<double>> ResultsReader::f64_zones(std::size_t column) const {
+    const results::ColumnDescriptor& d = descriptor(column, ColumnType::Float64);
+    return {reinterpret_cast<const results::Zone<double>*>(base_ + d.zones_offset), zone_count()};
+}
+
+std::span<const results::Zone<std::int64_t>> ResultsReader::i64_zones(std::size_t column) const {
+    const results::ColumnDescriptor& d =
+        descriptor(column, columns_[column].type == ColumnType::Key ? ColumnType::Key : ColumnType::Int64);
+    return {reinterpret_cast<const results::Zone<std::int64_t>*>(base_ + d.zones_offset), zone_count()};
+}
+
+std::string_view ResultsReader::key(std::size_t column, std::uint32_t code) const noexcept {
+    const results::ColumnDescriptor& d = columns_[column];
+    if (d.type != ColumnType::Key || code >= d.dictionary_size) {
+        return {};
+    }
+    const auto* offsets = reinterpret_cast<const std::uint32_t*>(base_ + d.dictionary_offset);
+    const auto* blob = reinterpret_cast<const char*>(offsets + d.dictionary_size + 1);
+    return {blob + offsets[code], offsets[code + 1] - offsets[code]};
+}
+
+std::int64_t ResultsReader::find_key(std::size_t column, std::string_view key_value) const noexcept {
+    if (columns_[column].type != ColumnType::Key) {
+        return -1;
+    }
+    const std::uint32_t size = columns_[column].dictionary_size;
+    std::uint32_t lo = 0;
+    std::uint32_t hi = size;
+    while (lo < hi) {
+        const std::uint32_t mid = lo + (hi - lo) / 2;
+        if (key(column, mid) < key_value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < size && key(column, lo) == key_value ? std::int64_t{lo} : -1;
+}
+
+// ---- ResultsQuery -----------------------------------------------------------
+
+ResultsQuery& ResultsQuery::where(std::string_view column, Compare op, double value) {
+    predicates_.push_back({std::string(column), op, value, {}, false});
+    return *this;
+}
+
+ResultsQuery& ResultsQuery::between(std::string_view column, double lo, double hi) {
+    where(column, Compare::GreaterEqual, lo);
+    return where(column, Compare::LessEqual, hi);
+}
+
+ResultsQuery& ResultsQuery::where_key(std::string_view column, std::string_view key) {
+    predicates_.push_back({std::string(column), Compare::Equal, 0.0, std::string(key), true});
+    return *this;
+}
+
+ResultsQuery& ResultsQuery::group_by(std::string_view column) {
+    group_by_ = column;
+    return *this;
+}
+
+ResultsQuery& ResultsQuery::aggregate(Aggregate op, std::string_view column) {
+    outputs_.push_back({op, std::string(column)});
+    return *this;
+}
+
+namespace {
+
+/// Whether any value in [lo, hi] can satisfy `value op v`. An empty zone
+/// (lo > hi) fails every comparison.
+bool zone_may_match(Compare op, double v, double lo, double hi) noexcept {
+    switch (op) {
+    case Compare::Less:
+        return lo < v && lo <= hi;
+    case Compare::LessEqual:
+        return lo <= v && lo <= hi;
+    case Compare::Equal:
+        return lo <= v && v <= hi;
+    case Compare::NotEqual:
+        return lo <= hi && !(lo == v && hi == v);
+    case Compare::GreaterEqual:
+        return hi >= v && lo <= hi;
+    case Compare::Greater:
+        return hi > v && lo <= hi;
+    }
+    return true;
+}
+
+/// mask[i] &= (x[i] op v) over one zone; each case is a plain loop over a
+/// contiguous column that the compiler vectorises.
+template <typename T>
+void filter(const T* x, std::size_t n, Compare op, double v, std::uint8_t* mask) noexcept {
+    switch (op) {
+    case Compare::Less:
+        for (std::size_t i = 0; i < n; ++i) {
+            mask[i] &= static_cast<std::uint8_t>(static_cast<double>(x[i]) < v);
+        }
+        break;
+    case Compare::LessEqual:
+        for (std::size_t i = 0; i < n; ++i) {
+            mask[i] &= static_cast<std::uint8_t>(static_cast<double>(x[i]) <= v);
+        }
+        break;
+    case Compare::Equal:
+        for (std::size_t i = 0; i < n; ++i) {
+            mask[i] &= static_cast<std::uint8_t>(static_cast<double>(x[i]) == v);
+        }
+        break;
+    case Compare::NotEqual:
+        // Not `!=`: NaN would pass, and zone maps cannot see NaNs.
+        for (std::size_t i = 0; i < n; ++i) {
+            const double xi = static_cast<double>(x[i]);
+            mask[i] &= static_cast<std::uint8_t>((xi < v) | (xi > v));
+        }
+        break;
+    case Compare::GreaterEqual:
+        for (std::size_t i = 0; i < n; ++i) {
+            mask[i] &= static_cast<std::uint8_t>(static_cast<double>(x[i]) >= v);
+        }
+        break;
+    case Compare::Greater:
+        for (std::size_t i = 0; i < n; ++i) {
+            mask[i] &= static_cast<std::uint8_t>(static_cast<double>(x[i]) > v);
+        }
+        break;
+    }
+}
+
+void filter_codes(const std::uint32_t* x, std::size_t n, std::uint32_t code, std::uint8_t* mask) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        mask[i] &= static_cast<std::uint8_t>(x[i] == code);
+    }
+}
+
+/// A column resolved for scanning: exactly one of the pointers is set.
+struct ColumnScan {
+    const double* f64 = nullptr;
+    const std::int64_t* i64 = nullptr;
+    const std::uint32_t* codes = nullptr;
+
+    double value(std::size_t row) const noexcept {
+        return f64 != nullptr ? f64[row] : i64 != nullptr ? static_cast<double>(i64[row]) : codes[row];
+    }
+};
+
+ColumnScan numeric_scan(const ResultsReader& store, std::size_t column) {
+    switch (store.column_type(column)) {
+    case ColumnType::Float64:
+        return {store.f64(column).data(), nullptr, nullptr};
+    case ColumnType::Int64:
+        return {nullptr, store.i64(column).data(), nullptr};
+    case ColumnType::Key:
+        break;
+    }
+    throw std::invalid_argument("results: column " + std::string(store.column_name(column)) +
+                                " is a key; compare it with where_key()");
+}
+
+struct AggregateState {
+    std::vector<double> sum;
+    std::vector<double> min;
+    std::vector<double> max;
+    std::vector<std::uint64_t> valid;  // non-NaN values seen
+
+    void resize(std::size_t groups) {
+        sum.resize(groups, 0.0);
+        min.resize(groups, std::numeric_limits<double>::infinity());
+        max.resize(groups, -std::numeric_limits<double>::infinity());
+        valid.resize(groups, 0);
+    }
+};
+
+}  // namespace
+
+QueryResult ResultsQuery::run() const {
+    SRM_SCOPED_TIMER("results_query");
+    struct Resolved {
+        std::size_t column;
+        Compare op;
+        double value;
+        std::int64_t code;  // key predicates; -1 matches nothing
+        ColumnScan scan;
+    };
+    std::vector<Resolved> predicates;
+    bool satisfiable = true;
+    for (const Predicate& p : predicates_) {
+        const std::size_t c = store_.column(p.column);
+        if (p.is_key) {
+            if (store_.column_type(c) != ColumnType::Key) {
+                throw std::invalid_argument("results: where_key() on non-key column " + p.column);
+            }
+            const std::int64_t code = store_.find_key(c, p.key);
+            satisfiable = satisfiable && code >= 0;
+            predicates.push_back({c, Compare::Equal, static_cast<double>(code), code, {nullptr, nullptr,
+                                                                                      store_.codes(c).data()}});
+        } else {
+            if (std::isnan(p.value)) {
+                satisfiable = false;
+            }
+            predicates.push_back({c, p.op, p.value, -1, numeric_scan(store_, c)});
+        }
+    }
+
+    // Group column: dense codes for a key, values mapped to ids on first
+    // sight for a number (sorted at the end).
+    const bool grouped = !group_by_.empty();
+    std::size_t group_column = 0;
+    ColumnScan group_scan;
+    bool key_groups = false;
+    std::size_t groups = grouped ? 0 : 1;
+    std::unordered_map<double, std::uint32_t> group_ids;
+    std::vector<double> group_values;
+    if (grouped) {
+        group_column = store_.column(group_by_);
+        key_groups = store_.column_type(group_column) == ColumnType::Key;
+        if (key_groups) {
+            group_scan.codes = store_.codes(group_column).data();
+            groups = store_.dictionary_size(group_column);
+        } else {
+            group_scan = numeric_scan(store_, group_column);
+        }
+    }
+
+    std::vector<ColumnScan> outputs;
+    for (const Output& o : outputs_) {
+        outputs.push_back(o.op == Aggregate::Count ? ColumnScan{}
+                                                   : numeric_scan(store_, store_.column(o.column)));
+    }
+
+    std::vector<std::uint64_t> counts(groups, 0);
+    std::vector<AggregateState> states(outputs.size());
+    for (AggregateState& s : states) {
+        s.resize(groups);
+    }
+
+    QueryResult result;
+    std::array<std::uint8_t, kZoneRows> mask;
+    std::array<std::uint16_t, kZoneRows> selection;
+    std::array<std::uint32_t, kZoneRows> gid;
+    for (std::size_t z = 0; z < store_.zone_count() && satisfiable; ++z) {
+        const std::size_t first = z * kZoneRows;
+        const std::size_t n = std::min<std::size_t>(kZoneRows, store_.rows() - first);
+
+        bool may_match = true;
+        for (const Resolved& p : predicates) {
+            if (p.scan.f64 != nullptr) {
+                const results::Zone<double> zone = store_.f64_zones(p.column)[z];
+                may_match = zone_may_match(p.op, p.value, zone.min, zone.max);
+            } else {
+                const results::Zone<std::int64_t> zone = store_.i64_zones(p.column)[z];
+                may_match = zone_may_match(p.op, p.value, static_cast<double>(zone.min),
+                                           static_cast<double>(zone.max));
+            }
+            if (!may_match) {
+                break;
+            }
+        }
+        if (!may_match) {
+            ++result.zones_skipped;
+            continue;
+        }
+        ++result.zones_scanned;
+
+        std::fill_n(mask.begin(), n, std::uint8_t{1});
+        for (const Resolved& p : predicates) {
+            if (p.scan.f64 != nullptr) {
+                filter(p.scan.f64 + first, n, p.op, p.value, mask.data());
+            } else if (p.scan.i64 != nullptr) {
+                filter(p.scan.i64 + first, n, p.op, p.value, mask.data());
+            } else {
+                filter_codes(p.scan.codes + first, n, static_cast<std::uint32_t>(p.code), mask.data());
+            }
+        }
+        // Branch-free compaction into a selection vector.
+        std::size_t selected = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            selection[selected] = static_cast<std::uint16_t>(i);
+            selected += mask[i];
+        }
+
+        if (!grouped) {
+            std::fill_n(gid.begin(), selected, 0u);
+        } else if (key_groups) {
+            for (std::size_t j = 0; j < selected; ++j) {
+                gid[j] = group_scan.codes[first + selection[j]];
+            }
+        } else {
+            std::size_t kept = 0;
+            double last = std::numeric_limits<double>::quiet_NaN();
+            std::uint32_t last_id = 0;
+            for (std::size_t j = 0; j < selected; ++j) {
+                const double v = group_scan.value(first + selection[j]);
+                if (std::isnan(v)) {
+                    continue;
+                }
+                // Sweeps store runs of one operating point: most rows hit the
+                // previous group.
+                if (!(v == last)) {
+                    const auto [it, added] = group_ids.try_emplace(v, static_cast<std::uint32_t>(groups));
+                    if (added) {
+                        group_values.push_back(v);
+                        ++groups;
+                        counts.push_back(0);
+                        for (AggregateState& s : states) {
+                            s.resize(groups);
+                        }
+                    }
+                    last = v;
+                    last_id = it->second;
+                }
+                selection[kept] = selection[j];
+                gid[kept++] = last_id;
+            }
+            selected = kept;
+        }
+
+        for (std::size_t j = 0; j < selected; ++j) {
+            ++counts[gid[j]];
+        }
+        result.rows_matched += selected;
+        for (std::size_t o = 0; o < outputs.size(); ++o) {
+            if (outputs_[o].op == Aggregate::Count) {
+                continue;
+            }
+            const ColumnScan& x = outputs[o];
+            AggregateState& s = states[o];
+            for (std::size_t j = 0; j < selected; ++j) {
+                const double v = x.value(first + selection[j]);
+                const std::uint32_t g = gid[j];
+                s.sum[g] += v;
+                s.min[g] = std::min(s.min[g], v);
+                s.max[g] = std::max(s.max[g], v);
+                s.valid[g] += static_cast<std::uint64_t>(!std::isnan(v));
+            }
+        }
+    }
+
+    // Output groups in key order, dropping empty ones (other than the
+    // single group of an ungrouped query).
+    std::vector<std::uint32_t> order;
+    for (std::uint32_t g = 0; g < groups; ++g) {
+        if (!grouped || counts[g] != 0) {
+            order.push_back(g);
+        }
+    }
+    if (grouped && !key_groups) {
+        std::sort(order.begin(), order.end(),
+                  [&](std::uint32_t a, std::uint32_t b) { return group_values[a] < group_values[b]; });
+    }
+    result.values.resize(outputs.size());
+    for (const std::uint32_t g : order) {
+        if (key_groups) {
+            result.group_keys.emplace_back(store_.key(group_column, g));
+        } else if (grouped) {
+            result.group_values.push_back(group_values[g]);
+        }
+        result.counts.push_back(counts[g]);
+        for (std::size_t o = 0; o < outputs.size(); ++o) {
+            const AggregateState& s = states[o];
+            constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+            double v = nan;
+            switch (outputs_[o].op) {
+            case Aggregate::Count:
+                v = static_cast<double>(counts[g]);
+                break;
+            case Aggregate::Sum:
+                v = s.sum[g];
+                break;
+            case Aggregate::Mean:
+                v = counts[g] != 0 ? s.sum[g] / static_cast<double>(counts[g]) : nan;
+                break;
+            case Aggregate::Min:
+                v = s.valid[g] != 0 ? s.min[g] : nan;
+                break;
+            case Aggregate::Max:
+                v = s.valid[g] != 0 ? s.max[g] : nan;
+                break;
+            }
+            result.values[o].push_back(v);
+        }
+    }
+    return result;
+}
+
+}  // namespace srm
@@ -0,0 +1,96 @@
+#include "srm/spectrum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+// std::abs(complex) goes through hypot(); plain sqrt is plenty for amplitudes.
+inline float magnitude(std::complex<float> z) noexcept {
+    return std::sqrt(z.real() * z.real() + z.imag() * z.imag());
+}
+
+}  // namespace
+
+SlidingSpectrum::SlidingSpectrum(const SpectrumConfig& config, std::size_t channels)
+    : config_(config),
+      plan_(PlanCache::instance().fft(config.frame_size)),
+      window_(PlanCache::instance().window(config.window, config.frame_size)),
+      history_(channels, config.frame_size),
+      until_hop_(config.hop),
+      frame_(config.frame_size),
+      scratch_(plan_->scratch_size()),
+      spectrum_(plan_->bins()),
+      amplitude_(channels, plan_->bins()) {
+    if (config.hop == 0 || config.hop > config.frame_size) {
+        throw std::invalid_argument("spectrum: hop must be in [1, frame_size]");
+    }
+    if (channels == 0) {
+        throw std::invalid_argument("spectrum: no channels");
+    }
+    const double gain = std::accumulate(window_->begin(), window_->end(), 0.0);
+    edge_scale_ = static_cast<float>(1.0 / gain);
+    inner_scale_ = static_cast<float>(2.0 / gain);
+}
+
+void SlidingSpectrum::reset() noexcept {
+    write_pos_ = 0;
+    filled_ = 0;
+    until_hop_ = config_.hop;
+}
+
+void SlidingSpectrum::check_block(ChannelBlock<const float> block) const {
+    if (block.channels() != channels()) {
+        throw std::invalid_argument("spectrum: channel count mismatch");
+    }
+}
+
+void SlidingSpectrum::append(ChannelBlock<const float> block) noexcept {
+    const std::size_t n = block.samples();
+    const std::size_t size = config_.frame_size;
+    const std::size_t first = std::min(n, size - write_pos_);
+    for (std::size_t c = 0; c < channels(); ++c) {
+        const float* src = block.channel(c).data();
+        float* dst = history_.channel(c).data();
+        std::copy_n(src, first, dst + write_pos_);
+        std::copy_n(src + first, n - first, dst);
+    }
+    write_pos_ = (write_pos_ + n) % size;
+    filled_ = std::min(size, filled_ + n);
+    consumed_ += n;
+}
+
+void SlidingSpectrum::compute_frame() noexcept {
+    SRM_SCOPED_TIMER("spectrum_frame");
+    const std::size_t size = config_.frame_size;
+    const std::size_t bins = plan_->bins();
+    const float* w = window_->data();
+    // Oldest sample sits at write_pos_ once the history is full.
+    const std::size_t tail = size - write_pos_;
+    for (std::size_t c = 0; c < channels(); ++c) {
+        const float* h = history_.channel(c).data();
+        float* f = frame_.data();
+        for (std::size_t i = 0; i < tail; ++i) {
+            f[i] = h[write_pos_ + i] * w[i];
+        }
+        for (std::size_t i = 0; i < write_pos_; ++i) {
+            f[tail + i] = h[i] * w[tail + i];
+        }
+        plan_->forward(f, spectrum_.data(), scratch_.data());
+
+        float* a = amplitude_.channel(c).data();
+        for (std::size_t k = 0; k < bins; ++k) {
+            a[k] = magnitude(spectrum_[k]) * inner_scale_;
+        }
+        a[0] = magnitude(spectrum_[0]) * edge_scale_;
+        a[bins - 1] = magnitude(spectrum_[bins - 1]) * edge_scale_;
+    }
+}
+
+}  // namespace srm
@@ -0,0 +1,433 @@
+#include "srm/startup_plans.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace srm {
+
+namespace {
+
+using plans::kAlignment;
+using plans::SectionKind;
+
+std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+class Fnv1a {
+public:
+    void bytes(const void* data, std::size_t size) noexcept {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash_ = (hash_ ^ p[i]) * 0x100000001b3ULL;
+        }
+    }
+
+    template <typename T>
+        requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+    void value(T v) noexcept {
+        bytes(&v, sizeof(v));
+    }
+
+    void text(std::string_view s) noexcept {
+        value(static_cast<std::uint64_t>(s.size()));
+        bytes(s.data(), s.size());
+    }
+
+    std::uint64_t digest() const noexcept { return hash_; }
+
+private:
+    std::uint64_t hash_ = 0xcbf29ce484222325ULL;
+};
+
+/// FNV-1a over little-endian 64-bit words in four interleaved lanes
+/// (bytes past the last whole word go to lane 0), folded into one: a byte
+/// at a time the multiply chain made verifying a cached file slower than
+/// rebuilding most of it.
+std::uint64_t checksum(std::span<const std::byte> bytes) noexcept {
+    constexpr std::uint64_t kPrime = 0x100000001b3ULL;
+    std::uint64_t lanes[4] = {0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL, 0x9ce484222325cbf2ULL,
+                              0x2325cbf29ce48422ULL};
+    const std::size_t words = bytes.size() / 8;
+    std::size_t w = 0;
+    for (; w + 4 <= words; w += 4) {
+        for (std::size_t l = 0; l < 4; ++l) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes.data() + (w + l) * 8, 8);
+            lanes[l] = (lanes[l] ^ word) * kPrime;
+        }
+    }
+    for (; w < words; ++w) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes.data() + w * 8, 8);
+        lanes[w % 4] = (lanes[w % 4] ^ word) * kPrime;
+    }
+    for (std::size_t i = words * 8; i < bytes.size(); ++i) {
+        lanes[0] = (lanes[0] ^ static_cast<std::uint64_t>(bytes[i])) * kPrime;
+    }
+    Fnv1a folded;
+    folded.value(static_cast<std::uint64_t>(bytes.size()));
+    for (const std::uint64_t lane : lanes) {
+        folded.value(lane);
+    }
+    return folded.digest();
+}
+
+std::vector<std::string> read_calibration_files(const RigConfiguration& config) {
+    std::vector<std::string> texts;
+    for (const std::filesystem::path& path : config.calibration_files) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("plans: cannot read calibration file " + path.string());
+        }
+        texts.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    return texts;
+}
+
+std::uint64_t hash_configuration(const RigConfiguration& config, const std::vector<std::string>& texts) {
+    Fnv1a h;
+    h.value(plans::kFormatVersion);
+    h.value(static_cast<std::uint64_t>(config.channels.size()));
+    for (const ChannelInfo& ch : config.channels) {
+        h.text(ch.name);
+        h.value(ch.gauge_factor);
+        h.value(ch.excitation_volts);
+        h.value(ch.amplifier_gain);
+        h.value(ch.volts_per_count);
+        h.value(ch.zero_offset_counts);
+        h.value(ch.bridge);
+    }
+    h.value(static_cast<std::uint64_t>(texts.size()));
+    for (const std::string& text : texts) {
+        h.text(text);
+    }
+    h.value(static_cast<std::uint64_t>(config.calibration_table_points));
+    const DecimationChainConfig& d = config.decimation;
+    h.value(d.cic_ratio);
+    h.value(d.cic_order);
+    h.value(static_cast<std::uint64_t>(d.compensator_taps));
+    h.value(d.halfband_stages);
+    h.value(static_cast<std::uint64_t>(d.halfband_taps));
+    h.value(static_cast<std::uint64_t>(d.max_block));
+    h.value(static_cast<std::uint64_t>(config.fft_sizes.size()));
+    for (const std::size_t size : config.fft_sizes) {
+        h.value(static_cast<std::uint64_t>(size));
+    }
+    h.value(static_cast<std::uint64_t>(config.windows.size()));
+    for (const WindowRequest& w : config.windows) {
+        h.value(w.window);
+        h.value(static_cast<std::uint64_t>(w.size));
+    }
+    return h.digest();
+}
+
+RigPlans build(const RigConfiguration& config, const std::vector<std::string>& texts, std::uint64_t hash) {
+    RigPlans plans;
+    plans.configuration_hash = hash;
+    for (const std::size_t size : config.fft_sizes) {
+        plans.fft.push_back(PlanCache::instance().fft(size));
+    }
+    for (const WindowRequest& w : config.windows) {
+        plans.windows.push_back(PlanCache::instance().window(w.window, w.size));
+    }
+    plans.decimation = design_decimation_taps(config.decimation);
+    std::vector<SensorCalibration> records;
+    for (const std::string& text : texts) {
+        std::vector<SensorCalibration> file = parse_calibration(text);
+        records.insert(records.end(), std::make_move_iterator(file.begin()), std::make_move_iterator(file.end()));
+    }
+    plans.calibration.emplace(config.channels, records, config.calibration_table_points);
+    return plans;
+}
+
+// ---- Writing ----
+
+class ImageWriter {
+public:
+    ImageWriter() : image_(sizeof(plans::FileHeader)) {}
+
+    void reserve_sections(std::size_t count) {
+        table_ = image_.size();
+        image_.resize(image_.size() + count * sizeof(plans::SectionEntry));
+    }
+
+    template <typename T>
+    void section(SectionKind kind, std::uint64_t size, std::span<const T> values, std::uint32_t window = 0) {
+        const auto* p = reinterpret_cast<const std::byte*>(values.data());
+        section(kind, size, std::span(p, values.size_bytes()), window);
+    }
+
+    void section(SectionKind kind, std::uint64_t size, std::span<const std::byte> bytes, std::uint32_t window) {
+        image_.resize(align_up(image_.size(), kAlignment));
+        const plans::SectionEntry entry{kind, window, size, image_.size(), bytes.size()};
+        image_.insert(image_.end(), bytes.begin(), bytes.end());
+        std::memcpy(image_.data() + table_ + sections_ * sizeof(entry), &entry, sizeof(entry));
+        ++sections_;
+    }
+
+    std::vector<std::byte> finish(std::uint64_t hash) {
+        plans::FileHeader header{};
+        header.magic = plans::kFileMagic;
+        header.version = plans::kFormatVersion;
+        header.section_count = static_cast<std::uint32_t>(sections_);
+        header.configuration_hash = hash;
+        header.file_bytes = image_.size();
+        header.checksum = checksum(std::span(image_).subspan(sizeof(header)));
+        std::memcpy(image_.data(), &header, sizeof(header));
+        return std::move(image_);
+    }
+
+private:
+    std::vector<std::byte> image_;
+    std::size_t table_ = 0;
+    std::size_t sections_ = 0;
+};
+
+std::vector<std::byte> encode(const RigConfiguration& config, const RigPlans& plans) {
+    ImageWriter out;
+    out.reserve_sections(3 * plans.fft.size() + plans.windows.size() + 3);
+    for (const std::shared_ptr<const FftPlan>& plan : plans.fft) {
+        out.section(SectionKind::FftBitReversal, plan->size(), plan->bit_reversal());
+        out.section(SectionKind::FftStageTwiddles, plan->size(), plan->stage_twiddles());
+        out.section(SectionKind::FftSplitTwiddles, plan->size(), plan->split_twiddles());
+    }
+    for (std::size_t i = 0; i < plans.windows.size(); ++i) {
+        out.section(SectionKind::Window, config.windows[i].size, std::span<const float>(*plans.windows[i]),
+                    static_cast<std::uint32_t>(config.windows[i].window));
+    }
+    out.section(SectionKind::CompensatorTaps, plans.decimation.compensator.size(),
+                std::span<const float>(plans.decimation.compensator));
+    out.section(SectionKind::HalfbandTaps, plans.decimation.halfband.size(),
+                std::span<const float>(plans.decimation.halfband));
+    std::vector<std::byte> calibration;
+    plans.calibration->append_image(calibration);
+    out.section(SectionKind::Calibration, config.channels.size(), std::span<const std::byte>(calibration), 0);
+    return out.finish(plans.configuration_hash);
+}
+
+void write_atomically(const std::filesystem::path& path, std::span<const std::byte> image) {
+    std::filesystem::create_directories(path.parent_path());
+    const std::filesystem::path temporary = path.string() + ".tmp." + std::to_string(::getpid());
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "plans: cannot create " + temporary.string());
+    }
+    const auto* p = reinterpret_cast<const char*>(image.data());
+    std::size_t left = image.size();
+    while (left > 0) {
+        const ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            const int err = errno;
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            throw std::system_error(err, std::generic_category(), "plans: write failed");
+        }
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    if (::close(fd) != 0 || ::rename(temporary.c_str(), path.c_str()) != 0) {
+        const int err = errno;
+        ::unlink(temporary.c_str());
+        throw std::system_error(err, std::generic_category(), "plans: cannot replace " + path.string());
+    }
+}
+
+// ---- Reading ----
+
+/// Read-only mapping of a whole file.
+class Mapping {
+public:
+    explicit Mapping(const std::filesystem::path& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "plans: cannot open " + path.string());
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "plans: fstat failed");
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ < sizeof(plans::FileHeader)) {
+            ::close(fd);
+            throw std::runtime_error("plans: file too short");
+        }
+        void* map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        const int map_err = errno;
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            throw std::system_error(map_err, std::generic_category(), "plans: mmap failed");
+        }
+        base_ = static_cast<const std::byte*>(map);
+    }
+    ~Mapping() { ::munmap(const_cast<std::byte*>(base_), size_); }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    std::span<const std::byte> bytes() const noexcept { return {base_, size_}; }
+
+private:
+    const std::byte* base_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+class PlanFile {
+public:
+    PlanFile(std::span<const std::byte> file, std::uint64_t hash) : file_(file) {
+        plans::FileHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != plans::kFileMagic) {
+            throw std::runtime_error("plans: not a plan cache");
+        }
+        if (header.version != plans::kFormatVersion) {
+            throw std::runtime_error("plans: version " + std::to_string(header.version) + " (expected " +
+                                     std::to_string(plans::kFormatVersion) + ")");
+        }
+        if (header.configuration_hash != hash) {
+            throw std::runtime_error("plans: configuration hash mismatch");
+        }
+        if (header.file_bytes != file.size() ||
+            header.section_count > (file.size() - sizeof(header)) / sizeof(plans::SectionEntry)) {
+            throw std::runtime_error("plans: truncated file");
+        }
+        if (checksum(file.subspan(sizeof(header))) != header.checksum) {
+            throw std::runtime_error("plans: checksum mismatch");
+        }
+        entries_.resize(header.section_count);
+        std::memcpy(entries_.data(), file.data() + sizeof(header), entries_.size() * sizeof(plans::SectionEntry));
+        for (const plans::SectionEntry& e : entries_) {
+            if (e.offset % kAlignment != 0 || e.offset > file.size() || e.bytes > file.size() - e.offset) {
+                throw std::runtime_error("plans: section out of bounds");
+            }
+        }
+    }
+
+    /// The section's values in place (sections are 64-byte aligned in a
+    /// page-aligned mapping).
+    template <typename T>
+    std::span<const T> find(SectionKind kind, std::uint64_t size, std::uint32_t window = 0) const {
+        for (const plans::SectionEntry& e : entries_) {
+            if (e.kind == kind && e.size == size && e.window == window) {
+                if (e.bytes % sizeof(T) != 0) {
+                    break;
+                }
+                return {reinterpret_cast<const T*>(file_.data() + e.offset), e.bytes / sizeof(T)};
+            }
+        }
+        throw std::runtime_error("plans: missing section " + std::to_string(static_cast<std::uint32_t>(kind)));
+    }
+
+private:
+    std::span<const std::byte> file_;
+    std::vector<plans::SectionEntry> entries_;
+};
+
+RigPlans restore(const RigConfiguration& config, const PlanFile& file, std::uint64_t hash) {
+    RigPlans plans;
+    plans.configuration_hash = hash;
+    plans.from_cache = true;
+    for (const std::size_t size : config.fft_sizes) {
+        plans.fft.push_back(std::make_shared<const FftPlan>(
+            size, file.find<std::uint32_t>(SectionKind::FftBitReversal, size),
+            file.find<std::complex<float>>(SectionKind::FftStageTwiddles, size),
+            file.find<std::complex<float>>(SectionKind::FftSplitTwiddles, size)));
+    }
+    for (const WindowRequest& w : config.windows) {
+        const std::span<const float> values =
+            file.find<float>(SectionKind::Window, w.size, static_cast<std::uint32_t>(w.window));
+        if (values.size() != w.size) {
+            throw std::runtime_error("plans: window length mismatch");
+        }
+        plans.windows.push_back(std::make_shared<const AlignedVector<float>>(values.begin(), values.end()));
+    }
+    const DecimationChainConfig& d = config.decimation;
+    const std::span<const float> compensator = file.find<float>(SectionKind::CompensatorTaps, d.compensator_taps);
+    plans.decimation.compensator.assign(compensator.begin(), compensator.end());
+    const std::size_t halfband = d.halfband_stages > 0 ? d.halfband_taps : 0;
+    const std::span<const float> taps = file.find<float>(SectionKind::HalfbandTaps, halfband);
+    plans.decimation.halfband.assign(taps.begin(), taps.end());
+    plans.calibration.emplace(CalibrationSnapshot::from_image(
+        file.find<std::byte>(SectionKind::Calibration, config.channels.size())));
+    if (plans.calibration->channel_count() != config.channels.size()) {
+        throw std::runtime_error("plans: calibration channel count mismatch");
+    }
+    return plans;
+}
+
+void publish(const RigConfiguration& config, const RigPlans& plans) {
+    for (const std::shared_ptr<const FftPlan>& plan : plans.fft) {
+        PlanCache::instance().insert(plan);
+    }
+    for (std::size_t i = 0; i < plans.windows.size(); ++i) {
+        PlanCache::instance().insert(config.windows[i].window, plans.windows[i]);
+    }
+}
+
+}  // namespace
+
+std::uint64_t configuration_hash(const RigConfiguration& config) {
+    return hash_configuration(config, read_calibration_files(config));
+}
+
+RigPlans build_rig_plans(const RigConfiguration& config) {
+    const std::vector<std::string> texts = read_calibration_files(config);
+    return build(config, texts, hash_configuration(config, texts));
+}
+
+StartupPlanCache::StartupPlanCache(std::filesystem::path directory) : directory_(std::move(directory)) {}
+
+std::filesystem::path StartupPlanCache::file_for(std::uint64_t configuration_hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "rig-%016llx.srmplan", static_cast<unsigned long long>(configuration_hash));
+    return directory_ / name;
+}
+
+RigPlans StartupPlanCache::load_or_build(const RigConfiguration& config) const {
+    const std::vector<std::string> texts = read_calibration_files(config);
+    const std::uint64_t hash = hash_configuration(config, texts);
+    const std::filesystem::path path = file_for(hash);
+
+    std::string error;
+    if (std::error_code ec; std::filesystem::exists(path, ec)) {
+        try {
+            const Mapping mapping(path);
+            RigPlans plans = restore(config, PlanFile(mapping.bytes(), hash), hash);
+            publish(config, plans);
+            return plans;
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+    }
+
+    RigPlans plans = build(config, texts, hash);
+    try {
+        write_atomically(path, encode(config, plans));
+    } catch (const std::exception& e) {
+        error += (error.empty() ? "" : "; ") + std::string(e.what());
+    }
+    plans.cache_error = std::move(error);
+    return plans;
+}
+
+}  // namespace srm
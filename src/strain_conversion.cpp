@@ -0,0 +1,242 @@
+// Built with -ffp-contract=off (see CMakeLists.txt): the scalar reference and
+// the vector kernels must round every operation separately to agree bit for bit.
+#include "srm/strain_conversion.hpp"
+
+#include <stdexcept>
+
+#include "srm/instrumentation.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SRM_CONVERSION_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SRM_CONVERSION_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace srm {
+
+ConversionParams make_conversion_params(const ChannelInfo& channel) {
+    if (!(channel.gauge_factor > 0.0f) || !(channel.excitation_volts > 0.0f) ||
+        !(channel.amplifier_gain > 0.0f)) {
+        throw std::invalid_argument("conversion: gauge factor, excitation and gain must be "
+                                    "positive for channel " + channel.name);
+    }
+    ConversionParams p;
+    p.offset_counts = channel.zero_offset_counts;
+    p.ratio_per_count = static_cast<float>(
+        static_cast<double>(channel.volts_per_count) /
+        (static_cast<double>(channel.amplifier_gain) * channel.excitation_volts));
+    double arms = 1.0;
+    switch (channel.bridge) {
+    case capture::BridgeConfig::Quarter:
+        arms = 4.0;
+        break;
+    case capture::BridgeConfig::Half:
+        arms = 2.0;
+        break;
+    case capture::BridgeConfig::Full:
+        arms = 1.0;
+        break;
+    default:
+        throw std::invalid_argument("conversion: unknown bridge configuration");
+    }
+    p.strain_coeff = static_cast<float>(-arms * 1e6 / channel.gauge_factor);
+    p.bridge = channel.bridge;
+    return p;
+}
+
+double strain_to_counts(const ConversionParams& p, double microstrain) noexcept {
+    const double k = p.strain_coeff;
+    // Quarter bridge: ue = k r / (1 + 2 r)  =>  r = ue / (k - 2 ue).
+    const double r = p.bridge == capture::BridgeConfig::Quarter ? microstrain / (k - 2.0 * microstrain)
+                                                                : microstrain / k;
+    return r / p.ratio_per_count + p.offset_counts;
+}
+
+const char* to_string(SimdPath path) noexcept {
+    switch (path) {
+    case SimdPath::Scalar:
+        return "scalar";
+    case SimdPath::Avx2:
+        return "avx2";
+    case SimdPath::Avx512:
+        return "avx512";
+    case SimdPath::Neon:
+        return "neon";
+    }
+    return "unknown";
+}
+
+namespace {
+
+using Kernel = void (*)(const ConversionParams&, const std::int16_t*, float*, std::size_t);
+
+void convert_scalar(const ConversionParams& p, const std::int16_t* in, float* out,
+                    std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = convert_sample(p, in[i]);
+    }
+}
+
+#if defined(SRM_CONVERSION_X86)
+
+__attribute__((target("avx2"))) void convert_avx2(const ConversionParams& p,
+                                                  const std::int16_t* in, float* out,
+                                                  std::size_t n) {
+    const __m256 offset = _mm256_set1_ps(p.offset_counts);
+    const __m256 scale = _mm256_set1_ps(p.ratio_per_count);
+    const __m256 coeff = _mm256_set1_ps(p.strain_coeff);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const bool quarter = p.bridge == capture::BridgeConfig::Quarter;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw));
+        const __m256 r = _mm256_mul_ps(_mm256_sub_ps(x, offset), scale);
+        __m256 ue = _mm256_mul_ps(coeff, r);
+        if (quarter) {
+            ue = _mm256_div_ps(ue, _mm256_add_ps(one, _mm256_add_ps(r, r)));
+        }
+        _mm256_storeu_ps(out + i, ue);
+    }
+    convert_scalar(p, in + i, out + i, n - i);
+}
+
+// GCC 12's avx512fintrin.h trips -Wmaybe-uninitialized on its own
+// _mm512_undefined_* placeholders.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f"))) void convert_avx512(const ConversionParams& p,
+                                                       const std::int16_t* in, float* out,
+                                                       std::size_t n) {
+    const __m512 offset = _mm512_set1_ps(p.offset_counts);
+    const __m512 scale = _mm512_set1_ps(p.ratio_per_count);
+    const __m512 coeff = _mm512_set1_ps(p.strain_coeff);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const bool quarter = p.bridge == capture::BridgeConfig::Quarter;
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m512 x = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(raw));
+        const __m512 r = _mm512_mul_ps(_mm512_sub_ps(x, offset), scale);
+        __m512 ue = _mm512_mul_ps(coeff, r);
+        if (quarter) {
+            ue = _mm512_div_ps(ue, _mm512_add_ps(one, _mm512_add_ps(r, r)));
+        }
+        _mm512_storeu_ps(out + i, ue);
+    }
+    convert_scalar(p, in + i, out + i, n - i);
+}
+#pragma GCC diagnostic pop
+
+#endif  // SRM_CONVERSION_X86
+
+#if defined(SRM_CONVERSION_NEON)
+
+void convert_neon(const ConversionParams& p, const std::int16_t* in, float* out,
+                  std::size_t n) {
+    const float32x4_t offset = vdupq_n_f32(p.offset_counts);
+    const float32x4_t scale = vdupq_n_f32(p.ratio_per_count);
+    const float32x4_t coeff = vdupq_n_f32(p.strain_coeff);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const bool quarter = p.bridge == capture::BridgeConfig::Quarter;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t raw = vld1q_s16(in + i);
+        const float32x4_t xs[2] = {vcvtq_f32_s32(vmovl_s16(vget_low_s16(raw))),
+                                   vcvtq_f32_s32(vmovl_s16(vget_high_s16(raw)))};
+        for (int h = 0; h < 2; ++h) {
+            const float32x4_t r = vmulq_f32(vsubq_f32(xs[h], offset), scale);
+            float32x4_t ue = vmulq_f32(coeff, r);
+            if (quarter) {
+                ue = vdivq_f32(ue, vaddq_f32(one, vaddq_f32(r, r)));
+            }
+            vst1q_f32(out + i + 4 * h, ue);
+        }
+    }
+    convert_scalar(p, in + i, out + i, n - i);
+}
+
+#endif  // SRM_CONVERSION_NEON
+
+Kernel kernel_for(SimdPath path) noexcept {
+    switch (path) {
+#if defined(SRM_CONVERSION_X86)
+    case SimdPath::Avx2:
+        return convert_avx2;
+    case SimdPath::Avx512:
+        return convert_avx512;
+#endif
+#if defined(SRM_CONVERSION_NEON)
+    case SimdPath::Neon:
+        return convert_neon;
+#endif
+    default:
+        return convert_scalar;
+    }
+}
+
+Kernel best_kernel() noexcept {
+    static const Kernel kernel = kernel_for(best_simd_path());
+    return kernel;
+}
+
+}  // namespace
+
+bool simd_path_supported(SimdPath path) noexcept {
+    switch (path) {
+    case SimdPath::Scalar:
+        return true;
+#if defined(SRM_CONVERSION_X86)
+    case SimdPath::Avx2:
+        return __builtin_cpu_supports("avx2");
+    case SimdPath::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+#if defined(SRM_CONVERSION_NEON)
+    case SimdPath::Neon:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+SimdPath best_simd_path() noexcept {
+    static const SimdPath path = [] {
+        for (SimdPath candidate : {SimdPath::Avx512, SimdPath::Avx2, SimdPath::Neon}) {
+            if (simd_path_supported(candidate)) {
+                return candidate;
+            }
+        }
+        return SimdPath::Scalar;
+    }();
+    return path;
+}
+
+void convert_channel(const ConversionParams& params, std::span<const std::int16_t> in,
+                     std::span<float> out) noexcept {
+    best_kernel()(params, in.data(), out.data(), in.size());
+}
+
+void convert_channel(SimdPath path, const ConversionParams& params,
+                     std::span<const std::int16_t> in, std::span<float> out) noexcept {
+    const Kernel kernel = simd_path_supported(path) ? kernel_for(path) : convert_scalar;
+    kernel(params, in.data(), out.data(), in.size());
+}
+
+void convert_block(std::span<const ConversionParams> params, ChannelBlock<const std::int16_t> in,
+                   ChannelBlock<float> out) {
+    if (params.size() != in.channels() || out.channels() != in.channels() ||
+        out.samples() < in.samples()) {
+        throw std::invalid_argument("conversion: block shape mismatch");
+    }
+    SRM_SCOPED_TIMER("convert");
+    const Kernel kernel = best_kernel();
+    for (std::size_t c = 0; c < in.channels(); ++c) {
+        kernel(params[c], in.channel(c).data(), out.channel(c).data(), in.samples());
+    }
+}
+
+}  // namespace srm
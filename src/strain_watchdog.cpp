@@ -0,0 +1,290 @@
+#include "srm/strain_watchdog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <time.h>
+
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+// Outside the int16 range on both sides: the check can never fire.
+constexpr std::int32_t kNoLow = -32769;
+constexpr std::int32_t kNoHigh = 32768;
+constexpr std::int32_t kNoStep = 65536;
+
+#if SRM_INSTRUMENTATION
+// Registered by the constructor, off the watchdog thread, so the thread's
+// prepare_thread() covers it and the first check() takes no lock.
+StageId check_stage() {
+    static const StageId id = Instrumentation::instance().stage("watchdog_check");
+    return id;
+}
+#endif
+
+std::uint64_t monotonic_ns() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+/// |d ue / d count| at raw value @p counts.
+double strain_per_count(const ConversionParams& p, double counts) noexcept {
+    const double slope = std::abs(static_cast<double>(p.strain_coeff) * p.ratio_per_count);
+    if (p.bridge != capture::BridgeConfig::Quarter) {
+        return slope;
+    }
+    const double r = (counts - p.offset_counts) * p.ratio_per_count;
+    return slope / ((1.0 + 2.0 * r) * (1.0 + 2.0 * r));
+}
+
+StrainWatchdog::CountLimits to_counts(const ConversionParams& p, const StrainLimit& limit,
+                                      double sample_rate_hz) {
+    if (!(limit.peak_ue > 0.0) || !(limit.rate_ue_per_s > 0.0)) {
+        throw std::invalid_argument("watchdog: limits must be positive");
+    }
+    StrainWatchdog::CountLimits out{kNoLow, kNoHigh, kNoStep};
+    if (std::isfinite(limit.peak_ue)) {
+        const double a = strain_to_counts(p, limit.peak_ue);
+        const double b = strain_to_counts(p, -limit.peak_ue);
+        // Largest integer range whose every value reads within +-peak.
+        out.low = static_cast<std::int32_t>(std::clamp(std::ceil(std::min(a, b)), -32769.0, 32768.0));
+        out.high = static_cast<std::int32_t>(std::clamp(std::floor(std::max(a, b)), -32769.0, 32768.0));
+    }
+    if (std::isfinite(limit.rate_ue_per_s)) {
+        // The quarter bridge is steepest at one end of the admissible range;
+        // using the steepest slope makes the count step conservative.
+        const double lo = std::max(out.low, -32768);
+        const double hi = std::min(out.high, 32767);
+        const double slope = std::max(strain_per_count(p, lo), strain_per_count(p, hi));
+        const double step = limit.rate_ue_per_s / sample_rate_hz / slope;
+        out.max_step = static_cast<std::int32_t>(std::min(std::floor(step), 65536.0));
+    }
+    return out;
+}
+
+}  // namespace
+
+const char* to_string(TripReason reason) noexcept {
+    switch (reason) {
+    case TripReason::Peak:
+        return "peak";
+    case TripReason::Rate:
+        return "rate";
+    case TripReason::ChannelCount:
+        return "channel count";
+    }
+    return "unknown";
+}
+
+StrainWatchdog::StrainWatchdog(const WatchdogConfig& config,
+                               std::span<const ConversionParams> params,
+                               std::span<const StrainLimit> limits, TripOutput& output)
+    : config_(config),
+      output_(output),
+      previous_(params.size(), 0),
+      inbox_(config.queue_blocks),
+      // The submitter drains the outbox before every push, so it never holds
+      // more than the blocks in flight.
+      outbox_(2 * config.queue_blocks + 2) {
+    if (params.size() != limits.size() || params.empty()) {
+        throw std::invalid_argument("watchdog: one limit per channel required");
+    }
+    if (!(config.sample_rate_hz > 0.0)) {
+        throw std::invalid_argument("watchdog: sample rate must be positive");
+    }
+    for (std::size_t c = 0; c < params.size(); ++c) {
+        limits_.push_back(to_counts(params[c], limits[c], config.sample_rate_hz));
+    }
+#if SRM_INSTRUMENTATION
+    check_stage();
+#endif
+}
+
+StrainWatchdog::~StrainWatchdog() { stop(); }
+
+bool StrainWatchdog::start() {
+    if (thread_.joinable()) {
+        return realtime_;
+    }
+    stop_.store(false, std::memory_order_relaxed);
+    thread_ = std::thread([this] { run(); });
+
+    sched_param param{};
+    param.sched_priority = config_.priority;
+    realtime_ = ::pthread_setschedparam(thread_.native_handle(), SCHED_FIFO, &param) == 0;
+    if (config_.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config_.cpu, &set);
+        realtime_ = ::pthread_setaffinity_np(thread_.native_handle(), sizeof(set), &set) == 0 &&
+                    realtime_;
+    }
+    return realtime_;
+}
+
+void StrainWatchdog::stop() {
+    if (thread_.joinable()) {
+        stop_.store(true, std::memory_order_release);
+        thread_.join();
+    }
+    // With the thread gone both rings can be drained from here; this
+    // releases any block still queued.
+    BlockHandle block;
+    while (inbox_.try_pop(block) || outbox_.try_pop(block)) {
+        block.reset();
+    }
+}
+
+bool StrainWatchdog::submit(BlockHandle block) noexcept {
+    BlockHandle done;
+    while (outbox_.try_pop(done)) {
+        done.reset();
+    }
+    if (!inbox_.try_push(std::move(block))) {
+        missed_.fetch_add(1, std::memory_order_relaxed);
+        SRM_COUNT("watchdog_missed_blocks", 1);
+        return false;
+    }
+    SRM_HIGH_WATER("watchdog_queue_blocks", inbox_.size());
+    return true;
+}
+
+void StrainWatchdog::run() noexcept {
+    Instrumentation::instance().prepare_thread();
+    unsigned idle = 0;
+    BlockHandle block;
+    while (!stop_.load(std::memory_order_acquire)) {
+        if (!inbox_.try_pop(block)) {
+            if (++idle < config_.spin_polls) {
+                cpu_relax();
+            } else {
+                const timespec ts{0, static_cast<long>(config_.idle_sleep_ns)};
+                ::clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, nullptr);
+            }
+            continue;
+        }
+        idle = 0;
+        check(block.block(), block.first_sample(), block.timestamp_ns());
+        if (!outbox_.try_push(std::move(block))) {
+            // Unreachable with the sizing above; releasing here would take
+            // the acquisition lock, which is still better than leaking.
+            block.reset();
+        }
+    }
+}
+
+bool StrainWatchdog::check(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample,
+                           std::uint64_t timestamp_ns) noexcept {
+#if SRM_INSTRUMENTATION
+    const ScopedTimer timer(check_stage());
+#endif
+    const std::size_t n = block.samples();
+    const std::size_t channels = limits_.size();
+    if (block.channels() != channels) {
+        // Some channel would go unchecked (or has no limits): fail safe.
+        SRM_COUNT("watchdog_malformed_blocks", 1);
+        checked_.fetch_add(1, std::memory_order_relaxed);
+        have_previous_ = false;
+        raise(block.channels(), first_sample, TripReason::ChannelCount, 0, timestamp_ns);
+        return true;
+    }
+    if (n == 0) {
+        return false;
+    }
+    // The rate check cannot span a gap in the sample stream.
+    const bool continuous = have_previous_ && first_sample == next_sample_;
+
+    // Fast path: one branch-free pass per channel that only answers "any
+    // violation?"; the exact sample is located afterwards, off the common path.
+    std::size_t worst_channel = channels;
+    std::size_t worst_index = n;
+    TripReason worst_reason = TripReason::Peak;
+    for (std::size_t c = 0; c < channels; ++c) {
+        const std::int16_t* x = block.channel(c).data();
+        const CountLimits lim = limits_[c];
+        const std::int32_t first = x[0];
+        const std::int32_t prev = continuous ? previous_[c] : first;
+        bool bad = first < lim.low || first > lim.high || std::abs(first - prev) > lim.max_step;
+        for (std::size_t i = 1; i < n; ++i) {
+            const std::int32_t v = x[i];
+            const std::int32_t d = v - static_cast<std::int32_t>(x[i - 1]);
+            bad |= (v < lim.low) | (v > lim.high) | ((d < 0 ? -d : d) > lim.max_step);
+        }
+        previous_[c] = x[n - 1];
+        if (!bad) {
+            continue;
+        }
+        std::int32_t p = prev;
+        for (std::size_t i = 0; i < worst_index; ++i) {
+            const std::int32_t v = x[i];
+            const bool peak = v < lim.low || v > lim.high;
+            if (peak || std::abs(v - p) > lim.max_step) {
+                worst_channel = c;
+                worst_index = i;
+                worst_reason = peak ? TripReason::Peak : TripReason::Rate;
+                break;
+            }
+            p = v;
+        }
+    }
+    have_previous_ = true;
+    next_sample_ = first_sample + n;
+
+    // From the first sample, so the time the card took to fill the block
+    // is part of the figure.
+    const std::uint64_t now = monotonic_ns();
+    latency_.record(now > timestamp_ns ? now - timestamp_ns : 0);
+    checked_.fetch_add(1, std::memory_order_relaxed);
+
+    if (worst_channel == channels) {
+        return false;
+    }
+    const double ns_per_sample = 1e9 / config_.sample_rate_hz;
+    raise(worst_channel, first_sample + worst_index, worst_reason,
+          block.channel(worst_channel)[worst_index],
+          timestamp_ns + static_cast<std::uint64_t>(static_cast<double>(worst_index) * ns_per_sample));
+    return true;
+}
+
+void StrainWatchdog::raise(std::size_t channel, std::uint64_t sample, TripReason reason,
+                           std::int16_t counts, std::uint64_t sample_ns) noexcept {
+    if (tripped_.load(std::memory_order_relaxed)) {
+        return;  // latched; the first event stays authoritative
+    }
+    const std::uint64_t now = monotonic_ns();
+    const TripEvent event{channel, sample, reason, counts, now > sample_ns ? now - sample_ns : 0};
+    // Sequence lock: odd while event_ is being written. A reader that saw
+    // the latch before a rearm() may still be copying the previous event.
+    const std::uint64_t version = event_version_.load(std::memory_order_relaxed);
+    event_version_.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&event_, &event, sizeof(event));
+    event_version_.store(version + 2, std::memory_order_release);
+    tripped_.store(true, std::memory_order_release);
+    output_.trip(event);
+}
+
+TripEvent StrainWatchdog::trip_event() const noexcept {
+    TripEvent event;
+    for (;;) {
+        const std::uint64_t version = event_version_.load(std::memory_order_acquire);
+        if (version % 2 == 0) {
+            std::memcpy(&event, &event_, sizeof(event));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event_version_.load(std::memory_order_relaxed) == version) {
+                return event;
+            }
+        }
+        cpu_relax();
+    }
+}
+
+}  // namespace srm
@@ -0,0 +1,347 @@
+#include "srm/streaming_stats.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+// ---- MomentAccumulator -----------------------------------------------------
+
+void MomentAccumulator::add(std::span<const float> values) noexcept {
+    const std::size_t n = values.size();
+    if (n == 0) {
+        return;
+    }
+    // Eight independent lanes keep both passes free of a serial dependency,
+    // as in the decimator's dot product; sums in double so long blocks of
+    // float strain lose nothing.
+    const float* v = values.data();
+    float lo[8];
+    float hi[8];
+    double sum[8] = {};
+    for (std::size_t k = 0; k < 8; ++k) {
+        lo[k] = hi[k] = v[0];
+    }
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (std::size_t k = 0; k < 8; ++k) {
+            lo[k] = v[i + k] < lo[k] ? v[i + k] : lo[k];
+            hi[k] = v[i + k] > hi[k] ? v[i + k] : hi[k];
+            sum[k] += v[i + k];
+        }
+    }
+    for (std::size_t k = 0; i < n; ++i, ++k) {
+        lo[k] = v[i] < lo[k] ? v[i] : lo[k];
+        hi[k] = v[i] > hi[k] ? v[i] : hi[k];
+        sum[k] += v[i];
+    }
+
+    MomentAccumulator block;
+    block.count = n;
+    block.min = *std::min_element(lo, lo + 8);
+    block.max = *std::max_element(hi, hi + 8);
+    block.mean = (((sum[0] + sum[4]) + (sum[1] + sum[5])) + ((sum[2] + sum[6]) + (sum[3] + sum[7]))) /
+                 static_cast<double>(n);
+    double m2[8] = {};
+    for (i = 0; i + 8 <= n; i += 8) {
+        for (std::size_t k = 0; k < 8; ++k) {
+            const double d = static_cast<double>(v[i + k]) - block.mean;
+            m2[k] += d * d;
+        }
+    }
+    for (std::size_t k = 0; i < n; ++i, ++k) {
+        const double d = static_cast<double>(v[i]) - block.mean;
+        m2[k] += d * d;
+    }
+    block.m2 = ((m2[0] + m2[4]) + (m2[1] + m2[5])) + ((m2[2] + m2[6]) + (m2[3] + m2[7]));
+    merge(block);
+}
+
+void MomentAccumulator::merge(const MomentAccumulator& other) noexcept {
+    if (other.count == 0) {
+        return;
+    }
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    const double na = static_cast<double>(count);
+    const double nb = static_cast<double>(other.count);
+    const double n = na + nb;
+    const double delta = other.mean - mean;
+    mean += delta * (nb / n);
+    m2 += other.m2 + delta * delta * (na * nb / n);
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+// ---- QuantileSketch --------------------------------------------------------
+
+namespace {
+
+constexpr unsigned kMantissaShift = 23 - QuantileSketch::kSubBucketBits;
+// Bucket key of the smallest tracked magnitude: its biased exponent with the
+// sub-bucket bits appended, as read straight from the float's bits.
+constexpr std::uint32_t kKeyBase = static_cast<std::uint32_t>(127 + QuantileSketch::kMinExponent)
+                                   << QuantileSketch::kSubBucketBits;
+constexpr std::size_t kZeroBucket = QuantileSketch::kMagnitudeBuckets;
+
+inline std::size_t sketch_bucket(std::uint32_t bits) noexcept {
+    const std::uint32_t key = (bits & 0x7fffffffu) >> kMantissaShift;
+    if (key < kKeyBase) {
+        return kZeroBucket;
+    }
+    const std::size_t k = std::min<std::size_t>(key - kKeyBase, kZeroBucket - 1);
+    return (bits >> 31) != 0 ? kZeroBucket - 1 - k : kZeroBucket + 1 + k;
+}
+
+inline double sketch_value(std::size_t bucket) noexcept {
+    if (bucket == kZeroBucket) {
+        return 0.0;
+    }
+    const bool negative = bucket < kZeroBucket;
+    const std::size_t k = negative ? kZeroBucket - 1 - bucket : bucket - kZeroBucket - 1;
+    // Centre of the bucket: the next mantissa bit set.
+    const std::uint32_t bits = ((static_cast<std::uint32_t>(k) + kKeyBase) << kMantissaShift) |
+                               (1u << (kMantissaShift - 1));
+    const double magnitude = std::bit_cast<float>(bits);
+    return negative ? -magnitude : magnitude;
+}
+
+}  // namespace
+
+void QuantileSketch::add(std::span<const float> values) noexcept {
+    // Strain moves slowly against the bucket width, so consecutive samples
+    // mostly share a bucket; counting runs avoids a read-modify-write chain
+    // through the same counter.
+    std::size_t run_bucket = kZeroBucket;
+    std::uint64_t run = 0;
+    std::uint64_t counted = 0;
+    float lo = min_;
+    float hi = max_;
+    for (const float v : values) {
+        const std::uint32_t bits = std::bit_cast<std::uint32_t>(v);
+        if ((bits & 0x7fffffffu) > 0x7f800000u) {
+            continue;  // NaN
+        }
+        const std::size_t bucket = sketch_bucket(bits);
+        if (bucket != run_bucket) {
+            counts_[run_bucket] += run;
+            counted += run;
+            run_bucket = bucket;
+            run = 0;
+        }
+        ++run;
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+    }
+    counts_[run_bucket] += run;
+    count_ += counted + run;
+    min_ = lo;
+    max_ = hi;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) noexcept {
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        counts_[b] += other.counts_[b];
+    }
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+double QuantileSketch::quantile(double q) const noexcept {
+    if (count_ == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+    // Rank of the quantile sample, 1-based, as in LatencyHistogram.
+    std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(count_) + 0.5);
+    rank = rank == 0 ? 1 : (rank > count_ ? count_ : rank);
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        seen += counts_[b];
+        if (seen >= rank) {
+            return std::clamp(sketch_value(b), static_cast<double>(min_), static_cast<double>(max_));
+        }
+    }
+    return max_;
+}
+
+void QuantileSketch::reset() noexcept {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    min_ = std::numeric_limits<float>::infinity();
+    max_ = -std::numeric_limits<float>::infinity();
+}
+
+// ---- RainflowCounter -------------------------------------------------------
+
+RainflowCounter::RainflowCounter(const RainflowConfig& config) : config_(config) {
+    if (!(config.upper_ue > config.lower_ue) || config.levels < 2) {
+        throw std::invalid_argument("rainflow: invalid level configuration");
+    }
+    width_ = (config.upper_ue - config.lower_ue) / config.levels;
+    inv_width_ = 1.0 / width_;
+    matrix_.assign(static_cast<std::size_t>(config.levels) * config.levels, 0);
+    // A residue that no four-point check can reduce has ranges that first
+    // grow and then shrink, so it never holds more than 2 * levels points.
+    residue_.reserve(2 * static_cast<std::size_t>(config.levels) + 2);
+}
+
+void RainflowCounter::reset() noexcept {
+    std::fill(matrix_.begin(), matrix_.end(), 0);
+    closed_ = 0;
+    residue_.clear();
+}
+
+void RainflowCounter::push(std::uint32_t level) noexcept {
+    std::vector<std::uint32_t>& r = residue_;
+    const std::size_t n = r.size();
+    if (n != 0 && r[n - 1] == level) {
+        return;
+    }
+    if (n >= 2 && (r[n - 1] > r[n - 2]) == (level > r[n - 1])) {
+        r[n - 1] = level;  // still heading the same way: the peak moves on
+    } else {
+        r.push_back(level);
+    }
+
+    // Four-point rule: with turning points a b c d, the inner range b-c is
+    // a closed cycle when neither outer range is smaller. Since the last
+    // point only ever moves outwards, a cycle it closes stays closed.
+    while (r.size() >= 4) {
+        const std::size_t m = r.size();
+        const std::uint32_t a = r[m - 4];
+        const std::uint32_t b = r[m - 3];
+        const std::uint32_t c = r[m - 2];
+        const std::uint32_t d = r[m - 1];
+        const auto range = [](std::uint32_t x, std::uint32_t y) { return x > y ? x - y : y - x; };
+        const std::uint32_t inner = range(b, c);
+        if (inner > range(a, b) || inner > range(c, d)) {
+            break;
+        }
+        ++matrix_[static_cast<std::size_t>(std::min(b, c)) * config_.levels + std::max(b, c)];
+        ++closed_;
+        r[m - 3] = d;
+        r.resize(m - 2);
+    }
+}
+
+void RainflowCounter::add(std::span<const float> values) {
+    // Quantise a chunk at a time in a loop the compiler vectorises; only
+    // level changes (a few percent of samples) reach the scalar push().
+    constexpr std::size_t kChunk = 256;
+    std::uint32_t levels[kChunk];
+    const float lower = static_cast<float>(config_.lower_ue);
+    const float scale = static_cast<float>(inv_width_);
+    const float top = static_cast<float>(config_.levels - 1);
+    std::uint32_t last = residue_.empty() ? config_.levels : residue_.back();
+    for (std::size_t first = 0; first < values.size(); first += kChunk) {
+        const std::size_t count = std::min(kChunk, values.size() - first);
+        const float* v = values.data() + first;
+        for (std::size_t i = 0; i < count; ++i) {
+            float t = (v[i] - lower) * scale;
+            t = t >= 0.0f ? (t < top ? t : top) : 0.0f;  // NaN goes to level 0 too
+            levels[i] = static_cast<std::uint32_t>(static_cast<std::int32_t>(t));
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            if (levels[i] != last) {
+                last = levels[i];
+                push(last);
+            }
+        }
+    }
+}
+
+void RainflowCounter::merge(const RainflowCounter& later) {
+    if (later.config_.levels != config_.levels || later.config_.lower_ue != config_.lower_ue ||
+        later.config_.upper_ue != config_.upper_ue) {
+        throw std::invalid_argument("rainflow: merging counts with different levels");
+    }
+    for (std::size_t i = 0; i < matrix_.size(); ++i) {
+        matrix_[i] += later.matrix_[i];
+    }
+    closed_ += later.closed_;
+    for (const std::uint32_t level : later.residue_) {
+        push(level);
+    }
+}
+
+double RainflowCounter::damage(double exponent) const noexcept {
+    double sum = 0.0;
+    const std::uint32_t levels = config_.levels;
+    for (std::uint32_t low = 0; low < levels; ++low) {
+        for (std::uint32_t high = low + 1; high < levels; ++high) {
+            const std::uint64_t n = cycles(low, high);
+            if (n != 0) {
+                sum += static_cast<double>(n) * std::pow((high - low) * width_, exponent);
+            }
+        }
+    }
+    for (std::size_t i = 1; i < residue_.size(); ++i) {
+        const std::uint32_t a = residue_[i - 1];
+        const std::uint32_t b = residue_[i];
+        sum += 0.5 * std::pow((a > b ? a - b : b - a) * width_, exponent);
+    }
+    return sum;
+}
+
+// ---- StrainStatistics ------------------------------------------------------
+
+StrainStatistics::StrainStatistics(std::size_t channels, const RainflowConfig& rainflow)
+    : moments_(channels), quantiles_(channels), rainflow_(channels, RainflowCounter(rainflow)) {}
+
+void StrainStatistics::add(ChannelBlock<const float> block) {
+    SRM_SCOPED_TIMER("statistics");
+    if (block.channels() != channel_count()) {
+        throw std::invalid_argument("statistics: channel count mismatch");
+    }
+    for (std::size_t c = 0; c < channel_count(); ++c) {
+        const std::span<const float> values = block.channel(c);
+        moments_[c].add(values);
+        quantiles_[c].add(values);
+        rainflow_[c].add(values);
+    }
+}
+
+void StrainStatistics::merge(const StrainStatistics& later) {
+    if (channel_count() == 0) {
+        *this = later;
+        return;
+    }
+    if (later.channel_count() != channel_count()) {
+        throw std::invalid_argument("statistics: channel count mismatch");
+    }
+    for (std::size_t c = 0; c < channel_count(); ++c) {
+        moments_[c].merge(later.moments_[c]);
+        quantiles_[c].merge(later.quantiles_[c]);
+        rainflow_[c].merge(later.rainflow_[c]);
+    }
+}
+
+ChannelStatistics StrainStatistics::summary(std::size_t channel) const noexcept {
+    const MomentAccumulator& m = moments_[channel];
+    const QuantileSketch& q = quantiles_[channel];
+    ChannelStatistics out;
+    out.count = m.count;
+    if (m.count != 0) {
+        out.mean = m.mean;
+        out.rms = m.rms();
+        out.stddev = std::sqrt(m.variance());
+        out.min = m.min;
+        out.max = m.max;
+        out.peak_to_peak = m.peak_to_peak();
+        out.p01 = q.quantile(0.01);
+        out.p50 = q.quantile(0.5);
+        out.p99 = q.quantile(0.99);
+    }
+    out.rainflow_cycles = rainflow_[channel].closed_cycles();
+    return out;
+}
+
+}  // namespace srm
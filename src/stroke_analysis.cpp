@@ -0,0 +1,224 @@
+#include "srm/stroke_analysis.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace srm {
+
+bool BlockSource::read(std::size_t channel, std::uint64_t first, std::span<float> out) const {
+    if (channel >= block_.channels() || first < origin_ ||
+        first - origin_ + out.size() > block_.samples()) {
+        return false;
+    }
+    const std::span<const float> src = block_.channel(channel);
+    std::copy_n(src.begin() + static_cast<std::ptrdiff_t>(first - origin_), out.size(),
+                out.begin());
+    return true;
+}
+
+CaptureSource::CaptureSource(const CaptureReader& reader)
+    : reader_(reader), params_(reader.channel_count()), convert_(reader.channel_count(), false) {}
+
+void CaptureSource::set_strain_conversion(std::size_t channel, const ConversionParams& params) {
+    if (channel >= params_.size()) {
+        throw std::out_of_range("capture source: channel out of range");
+    }
+    params_[channel] = params;
+    convert_[channel] = true;
+}
+
+std::span<const std::int16_t> CaptureSource::counts(std::size_t chunk, std::size_t channel) const {
+    if (reader_.is_raw(chunk)) {
+        return reader_.channel(chunk, channel);
+    }
+    if (chunk != decoded_chunk_ || channel != decoded_channel_) {
+        decoded_.resize(reader_.chunks()[chunk].sample_count);
+        decoded_chunk_ = SIZE_MAX;
+        reader_.read_channel(chunk, channel, decoded_);
+        decoded_chunk_ = chunk;
+        decoded_channel_ = channel;
+    }
+    return decoded_;
+}
+
+bool CaptureSource::read(std::size_t channel, std::uint64_t first, std::span<float> out) const {
+    if (channel >= params_.size()) {
+        return false;
+    }
+    std::size_t done = 0;
+    std::size_t chunk = reader_.find_chunk(first);
+    while (done < out.size()) {
+        if (chunk >= reader_.chunk_count()) {
+            return false;
+        }
+        const capture::ChunkIndexEntry& entry = reader_.chunks()[chunk];
+        const std::uint64_t sample = first + done;
+        if (sample < entry.first_sample || sample >= entry.first_sample + entry.sample_count) {
+            return false;  // gap in a sparse capture
+        }
+        const std::size_t offset = static_cast<std::size_t>(sample - entry.first_sample);
+        const std::size_t n = std::min<std::size_t>(entry.sample_count - offset, out.size() - done);
+        const std::span<const std::int16_t> src = counts(chunk, channel).subspan(offset, n);
+        const std::span<float> dst = out.subspan(done, n);
+        if (convert_[channel]) {
+            convert_channel(params_[channel], src, dst);
+        } else {
+            std::copy(src.begin(), src.end(), dst.begin());
+        }
+        done += n;
+        ++chunk;
+    }
+    return true;
+}
+
+namespace {
+
+// Independent partial sums so the compiler can keep several lanes in flight.
+double dot(const float* a, const float* b, std::size_t n) noexcept {
+    double acc[4] = {};
+    std::size_t t = 0;
+    for (; t + 4 <= n; t += 4) {
+        for (std::size_t k = 0; k < 4; ++k) {
+            acc[k] += static_cast<double>(a[t + k]) * b[t + k];
+        }
+    }
+    double sum = (acc[0] + acc[2]) + (acc[1] + acc[3]);
+    for (; t < n; ++t) {
+        sum += static_cast<double>(a[t]) * b[t];
+    }
+    return sum;
+}
+
+std::span<const std::uint64_t> window_edges(const CommutationIndex& index, std::size_t phase,
+                                            EdgeKind kind, std::uint64_t first_sample,
+                                            std::uint64_t end_sample) {
+    if (phase >= index.phase_count()) {
+        throw std::out_of_range("stroke analysis: phase out of range");
+    }
+    return index.edges(phase, kind, first_sample, end_sample);
+}
+
+}  // namespace
+
+StrokeProfile average_stroke_profile(const CommutationIndex& index, std::size_t phase,
+                                     EdgeKind kind, const SampleSource& source,
+                                     std::size_t channel, const StrokeWindow& window,
+                                     std::uint64_t first_sample, std::uint64_t end_sample,
+                                     std::pmr::memory_resource* memory) {
+    const std::size_t n = window.length;
+    std::pmr::vector<double> sum(n, 0.0, memory);
+    std::pmr::vector<double> sum_sq(n, 0.0, memory);
+    std::pmr::vector<float> buffer(n, memory);
+    StrokeProfile profile{std::pmr::vector<float>(memory), std::pmr::vector<float>(memory), 0};
+
+    for (const std::uint64_t edge : window_edges(index, phase, kind, first_sample, end_sample)) {
+        if (edge < window.pre_samples ||
+            !source.read(channel, edge - window.pre_samples, buffer)) {
+            continue;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            const double x = buffer[i];
+            sum[i] += x;
+            sum_sq[i] += x * x;
+        }
+        ++profile.strokes;
+    }
+
+    profile.mean.assign(n, 0.0f);
+    profile.stddev.assign(n, 0.0f);
+    if (profile.strokes > 0) {
+        const double count = static_cast<double>(profile.strokes);
+        for (std::size_t i = 0; i < n; ++i) {
+            const double mean = sum[i] / count;
+            const double var = std::max(0.0, sum_sq[i] / count - mean * mean);
+            profile.mean[i] = static_cast<float>(mean);
+            profile.stddev[i] = static_cast<float>(std::sqrt(var));
+        }
+    }
+    return profile;
+}
+
+std::ptrdiff_t StrokeCorrelation::peak_lag() const noexcept {
+    if (coefficient.empty()) {
+        return 0;
+    }
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < coefficient.size(); ++i) {
+        if (std::fabs(coefficient[i]) > std::fabs(coefficient[best])) {
+            best = i;
+        }
+    }
+    return static_cast<std::ptrdiff_t>(best) - max_lag;
+}
+
+StrokeCorrelation stroke_cross_correlation(const CommutationIndex& index, std::size_t phase,
+                                           EdgeKind kind, const SampleSource& source,
+                                           std::size_t current_channel,
+                                           std::size_t strain_channel,
+                                           const StrokeWindow& window, std::size_t max_lag,
+                                           std::uint64_t first_sample, std::uint64_t end_sample,
+                                           std::pmr::memory_resource* memory) {
+    const std::size_t n = window.length;
+    const std::size_t lags = 2 * max_lag + 1;
+    std::pmr::vector<float> current(n, memory);
+    std::pmr::vector<float> centred(n, memory);
+    std::pmr::vector<float> strain(n + 2 * max_lag, memory);
+    std::pmr::vector<double> acc(lags, 0.0, memory);
+    StrokeCorrelation result{std::pmr::vector<float>(memory), 0, 0};
+    result.max_lag = static_cast<std::ptrdiff_t>(max_lag);
+
+    for (const std::uint64_t edge : window_edges(index, phase, kind, first_sample, end_sample)) {
+        if (edge < window.pre_samples + max_lag) {
+            continue;
+        }
+        const std::uint64_t start = edge - window.pre_samples;
+        if (!source.read(current_channel, start, current) ||
+            !source.read(strain_channel, start - max_lag, strain)) {
+            continue;
+        }
+
+        double mean_i = 0.0;
+        for (float x : current) {
+            mean_i += x;
+        }
+        mean_i /= static_cast<double>(n);
+        double var_i = 0.0;
+        for (std::size_t t = 0; t < n; ++t) {
+            centred[t] = static_cast<float>(current[t] - mean_i);
+            var_i += static_cast<double>(centred[t]) * centred[t];
+        }
+
+        // The centred current sums to zero, so the covariance at each lag is a
+        // plain dot product; the strain window statistics slide along lags.
+        double sum_s = 0.0;
+        double sum_sq = 0.0;
+        for (std::size_t t = 0; t < n; ++t) {
+            sum_s += strain[t];
+            sum_sq += static_cast<double>(strain[t]) * strain[t];
+        }
+        for (std::size_t l = 0; l < lags; ++l) {
+            if (l > 0) {
+                const double out = strain[l - 1];
+                const double in = strain[l + n - 1];
+                sum_s += in - out;
+                sum_sq += in * in - out * out;
+            }
+            const double cov = dot(centred.data(), strain.data() + l, n);
+            const double var_s = std::max(0.0, sum_sq - sum_s * sum_s / static_cast<double>(n));
+            const double denom = std::sqrt(var_i * var_s);
+            acc[l] += denom > 0.0 ? cov / denom : 0.0;
+        }
+        ++result.strokes;
+    }
+
+    result.coefficient.assign(lags, 0.0f);
+    if (result.strokes > 0) {
+        for (std::size_t l = 0; l < lags; ++l) {
+            result.coefficient[l] = static_cast<float>(acc[l] / static_cast<double>(result.strokes));
+        }
+    }
+    return result;
+}
+
+}  // namespace srm
@@ -0,0 +1,57 @@
+#include "srm/sweep.hpp"
+
+#include <cmath>
+
+namespace srm {
+
+namespace detail {
+
+std::string describe_error(const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "unknown error";
+    }
+}
+
+}  // namespace detail
+
+SettlingDetector::SettlingDetector(const SettlingCriterion& criterion, double target)
+    : criterion_(criterion), target_(target) {
+    if (criterion.window <= std::chrono::nanoseconds::zero() ||
+        criterion.poll_interval <= std::chrono::nanoseconds::zero()) {
+        throw std::invalid_argument("settling: window and poll interval must be positive");
+    }
+}
+
+bool SettlingDetector::add(Clock::time_point time, double value) {
+    if (!window_.empty() && time < window_.back().time) {
+        throw std::invalid_argument("settling: readings out of order");
+    }
+    window_.push_back({time, value});
+    ++readings_;
+    // Keep the newest reading at or before the window start: the window
+    // counts as covered from it on.
+    const Clock::time_point start = time - criterion_.window;
+    while (window_.size() >= 2 && window_[1].time <= start) {
+        window_.pop_front();
+    }
+    if (window_.front().time > start) {
+        return false;
+    }
+    double lo = value;
+    double hi = value;
+    for (const Reading& r : window_) {
+        lo = std::min(lo, r.value);
+        hi = std::max(hi, r.value);
+    }
+    if (!(hi - lo <= criterion_.band)) {
+        return false;
+    }
+    return std::isnan(target_) ||
+           (std::fabs(lo - target_) <= criterion_.tolerance && std::fabs(hi - target_) <= criterion_.tolerance);
+}
+
+}  // namespace srm
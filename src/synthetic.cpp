@@ -0,0 +1,105 @@
+#include "srm/synthetic.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace srm {
+
+SyntheticSrm::SyntheticSrm(const SyntheticSrmConfig& config)
+    : config_(config), rng_(config.seed | 1) {
+    if (!(config.sample_rate_hz > 0.0) || config.rotor_poles == 0 || config.phases == 0 ||
+        config.strain_channels == 0) {
+        throw std::invalid_argument("synthetic: invalid machine configuration");
+    }
+}
+
+double SyntheticSrm::gaussian() noexcept {
+    // Sum of four uniforms (xorshift64*), rescaled to unit variance.
+    double sum = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        rng_ ^= rng_ >> 12;
+        rng_ ^= rng_ << 25;
+        rng_ ^= rng_ >> 27;
+        const std::uint64_t r = rng_ * 0x2545F4914F6CDD1DULL;
+        sum += static_cast<double>(r >> 11) * (1.0 / 9007199254740992.0);
+    }
+    return (sum - 2.0) * std::numbers::sqrt3;
+}
+
+void SyntheticSrm::generate(ChannelBlock<float> strain_ue, std::span<float> position,
+                            ChannelBlock<float> phase_currents) {
+    const std::size_t n = strain_ue.samples();
+    if (strain_ue.channels() != config_.strain_channels ||
+        (!position.empty() && position.size() != n) ||
+        (!phase_currents.empty() &&
+         (phase_currents.channels() != config_.phases || phase_currents.samples() != n))) {
+        throw std::invalid_argument("synthetic: output shape mismatch");
+    }
+    const double two_pi = 2.0 * std::numbers::pi;
+    const double dt = 1.0 / config_.sample_rate_hz;
+    const double strokes_per_rev = static_cast<double>(config_.rotor_poles) * config_.phases;
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const double t = static_cast<double>(sample_ + i) * dt;
+        const double rev_per_s = (config_.speed_rpm + config_.accel_rpm_per_s * t) / 60.0;
+        const double rev = revolutions_;
+        revolutions_ += rev_per_s * dt;
+
+        const double mech = rev - std::floor(rev);
+        if (!position.empty()) {
+            position[i] = static_cast<float>(mech * config_.encoder_counts_per_rev);
+        }
+
+        const double pwm = config_.pwm_ue * std::sin(two_pi * config_.pwm_frequency_hz * t);
+        for (std::size_t c = 0; c < config_.strain_channels; ++c) {
+            const double place = two_pi * static_cast<double>(c) /
+                                 static_cast<double>(config_.strain_channels);
+            double v = pwm + config_.noise_ue * gaussian();
+            for (std::size_t h = 0; h < config_.harmonic_ue.size(); ++h) {
+                const double order = static_cast<double>(h + 1);
+                v += config_.harmonic_ue[h] *
+                     std::cos(order * (two_pi * strokes_per_rev * rev + place));
+            }
+            strain_ue.channel(c)[i] = static_cast<float>(v);
+        }
+
+        if (!phase_currents.empty()) {
+            const double electrical = rev * config_.rotor_poles;
+            for (unsigned p = 0; p < config_.phases; ++p) {
+                double cycle = electrical - static_cast<double>(p) / config_.phases;
+                cycle -= std::floor(cycle);
+                double level = 0.0;
+                const double rise = config_.current_rise_fraction;
+                if (cycle < config_.conduction_fraction) {
+                    level = std::min(1.0, cycle / rise);
+                } else if (cycle < config_.conduction_fraction + rise) {
+                    level = 1.0 - (cycle - config_.conduction_fraction) / rise;
+                }
+                phase_currents.channel(p)[i] = static_cast<float>(level * config_.phase_current_amps);
+            }
+        }
+    }
+    sample_ += n;
+}
+
+void SyntheticSrm::generate_counts(std::span<const ConversionParams> params,
+                                   ChannelBlock<std::int16_t> counts) {
+    if (params.size() != counts.channels()) {
+        throw std::invalid_argument("synthetic: one conversion per channel required");
+    }
+    const std::size_t n = counts.samples();
+    scratch_.resize(config_.strain_channels * n);
+    const ChannelBlock<float> strain(scratch_.data(), config_.strain_channels, n);
+    generate(strain, {}, {});
+    for (std::size_t c = 0; c < counts.channels(); ++c) {
+        const std::span<const float> ue = strain.channel(c);
+        for (std::size_t i = 0; i < n; ++i) {
+            const double x = std::round(strain_to_counts(params[c], ue[i]));
+            counts.channel(c)[i] = static_cast<std::int16_t>(std::clamp(x, -32768.0, 32767.0));
+        }
+    }
+}
+
+}  // namespace srm
@@ -0,0 +1,425 @@
+#include "srm/thread_placement.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <new>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#include "srm/instrumentation.hpp"
+
+namespace srm {
+
+namespace {
+
+// From <linux/mempolicy.h>; mbind is called directly so libnuma is not a
+// dependency.
+constexpr int kMpolBind = 2;
+constexpr unsigned kMpolMfMove = 1u << 1;
+constexpr std::size_t kMaxNodes = 1024;
+
+std::optional<std::string> read_text(const std::filesystem::path& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return std::nullopt;
+    }
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::string_view trim(std::string_view s) noexcept {
+    const auto space = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+    while (!s.empty() && space(s.front())) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && space(s.back())) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+std::optional<int> parse_int(std::string_view s) noexcept {
+    s = trim(s);
+    int value = 0;
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc{} || end != s.data() + s.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+int read_int(const std::filesystem::path& path, int fallback) {
+    const std::optional<std::string> text = read_text(path);
+    const std::optional<int> value = text ? parse_int(*text) : std::nullopt;
+    return value.value_or(fallback);
+}
+
+/// "node12" -> 12.
+std::optional<int> numbered(const std::string& name, std::string_view prefix) noexcept {
+    if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) {
+        return std::nullopt;
+    }
+    return parse_int(std::string_view(name).substr(prefix.size()));
+}
+
+std::size_t page_size() noexcept {
+    static const std::size_t size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+int common_node(const CpuTopology& topology, std::span<const int> cpus) noexcept {
+    int node = cpus.empty() ? -1 : topology.node_of(cpus.front());
+    for (const int cpu : cpus) {
+        if (topology.node_of(cpu) != node) {
+            return -1;
+        }
+    }
+    return node;
+}
+
+}  // namespace
+
+std::string_view to_string(PipelineStage stage) noexcept {
+    switch (stage) {
+        case PipelineStage::Acquisition: return "acquisition";
+        case PipelineStage::Watchdog: return "watchdog";
+        case PipelineStage::Processing: return "processing";
+        case PipelineStage::Writer: return "writer";
+        case PipelineStage::Network: return "network";
+    }
+    return "unknown";
+}
+
+// ---- Cpu lists --------------------------------------------------------------
+
+std::vector<int> parse_cpu_list(std::string_view text) {
+    std::set<int> cpus;
+    text = trim(text);
+    while (!text.empty()) {
+        const std::size_t comma = text.find(',');
+        const std::string_view item = trim(text.substr(0, comma));
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+        const std::size_t dash = item.find('-');
+        const std::optional<int> first = parse_int(item.substr(0, dash));
+        const std::optional<int> last = dash == std::string_view::npos ? first : parse_int(item.substr(dash + 1));
+        if (!first || !last || *first < 0 || *last < *first) {
+            throw std::invalid_argument("placement: bad cpu list entry '" + std::string(item) + "'");
+        }
+        for (int cpu = *first; cpu <= *last; ++cpu) {
+            cpus.insert(cpu);
+        }
+    }
+    return {cpus.begin(), cpus.end()};
+}
+
+std::string format_cpu_list(std::span<const int> cpus) {
+    std::vector<int> sorted(cpus.begin(), cpus.end());
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    std::string out;
+    for (std::size_t i = 0; i < sorted.size();) {
+        std::size_t j = i;
+        while (j + 1 < sorted.size() && sorted[j + 1] == sorted[j] + 1) {
+            ++j;
+        }
+        if (!out.empty()) {
+            out += ',';
+        }
+        out += std::to_string(sorted[i]);
+        if (j > i) {
+            out += '-';
+            out += std::to_string(sorted[j]);
+        }
+        i = j + 1;
+    }
+    return out;
+}
+
+// ---- CpuTopology ------------------------------------------------------------
+
+CpuTopology::CpuTopology(std::vector<Cpu> cpus) : cpus_(std::move(cpus)) {
+    if (cpus_.empty()) {
+        throw std::invalid_argument("placement: no cpus");
+    }
+    std::sort(cpus_.begin(), cpus_.end(), [](const Cpu& a, const Cpu& b) { return a.id < b.id; });
+    for (std::size_t i = 0; i < cpus_.size(); ++i) {
+        if ((i > 0 && cpus_[i].id == cpus_[i - 1].id) || cpus_[i].id < 0 || cpus_[i].node < 0) {
+            throw std::invalid_argument("placement: bad or duplicate cpu " + std::to_string(cpus_[i].id));
+        }
+        nodes_ = std::max(nodes_, cpus_[i].node + 1);
+    }
+}
+
+CpuTopology CpuTopology::detect(const std::filesystem::path& sysfs) {
+    const std::filesystem::path cpu_dir = sysfs / "devices/system/cpu";
+    std::vector<int> online;
+    if (const std::optional<std::string> list = read_text(cpu_dir / "online")) {
+        online = parse_cpu_list(*list);
+    } else {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(cpu_dir, ec)) {
+            if (const std::optional<int> id = numbered(entry.path().filename().string(), "cpu")) {
+                online.push_back(*id);
+            }
+        }
+    }
+    if (online.empty()) {
+        throw std::runtime_error("placement: no cpus under " + cpu_dir.string());
+    }
+
+    std::map<int, int> node_of;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(sysfs / "devices/system/node", ec)) {
+        const std::optional<int> node = numbered(entry.path().filename().string(), "node");
+        const std::optional<std::string> list = node ? read_text(entry.path() / "cpulist") : std::nullopt;
+        if (list) {
+            for (const int cpu : parse_cpu_list(*list)) {
+                node_of[cpu] = *node;
+            }
+        }
+    }
+
+    std::vector<Cpu> cpus;
+    for (const int id : online) {
+        const std::filesystem::path topology = cpu_dir / ("cpu" + std::to_string(id)) / "topology";
+        const auto node = node_of.find(id);
+        cpus.push_back({id, node == node_of.end() ? 0 : node->second,
+                        read_int(topology / "physical_package_id", 0), read_int(topology / "core_id", id)});
+    }
+    return CpuTopology(std::move(cpus));
+}
+
+int CpuTopology::node_of(int cpu) const noexcept {
+    const auto it = std::lower_bound(cpus_.begin(), cpus_.end(), cpu,
+                                     [](const Cpu& c, int id) { return c.id < id; });
+    return it != cpus_.end() && it->id == cpu ? it->node : -1;
+}
+
+std::vector<int> CpuTopology::cpus_of_node(int node) const {
+    std::vector<int> out;
+    for (const Cpu& c : cpus_) {
+        if (c.node == node) {
+            out.push_back(c.id);
+        }
+    }
+    return out;
+}
+
+DeviceLocality device_locality(const std::filesystem::path& device) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(device, ec)) {
+        throw std::runtime_error("placement: no device " + device.string());
+    }
+    DeviceLocality locality;
+    locality.node = read_int(device / "numa_node", -1);
+    for (const auto& entry : std::filesystem::directory_iterator(device / "msi_irqs", ec)) {
+        if (const std::optional<int> irq = parse_int(entry.path().filename().string()); irq && *irq > 0) {
+            locality.irqs.push_back(static_cast<unsigned>(*irq));
+        }
+    }
+    if (locality.irqs.empty()) {
+        if (const int irq = read_int(device / "irq", 0); irq > 0) {
+            locality.irqs.push_back(static_cast<unsigned>(irq));
+        }
+    }
+    std::sort(locality.irqs.begin(), locality.irqs.end());
+    return locality;
+}
+
+// ---- ThreadPlacement --------------------------------------------------------
+
+ThreadPlacement::ThreadPlacement(CpuTopology topology, const PlacementConfig& config)
+    : topology_(std::move(topology)), procfs_(config.procfs) {
+    const DeviceLocality daq = config.daq_device.empty() ? DeviceLocality{} : device_locality(config.daq_device);
+    const DeviceLocality storage =
+        config.storage_device.empty() ? DeviceLocality{} : device_locality(config.storage_device);
+    // A node the firmware does not name, or one with memory but no cpus,
+    // falls back to the first cpu's.
+    const auto usable = [&](int node, int fallback) {
+        return node >= 0 && !topology_.cpus_of_node(node).empty() ? node : fallback;
+    };
+    const int daq_node = usable(daq.node, topology_.cpus().front().node);
+    const int storage_node = usable(storage.node, daq_node);
+
+    // Physical cores in use, by (package, core).
+    std::set<std::pair<int, int>> taken;
+    const auto core_of = [&](int id) {
+        const auto it = std::find_if(topology_.cpus().begin(), topology_.cpus().end(),
+                                     [id](const CpuTopology::Cpu& c) { return c.id == id; });
+        return std::pair(it->package, it->core);
+    };
+    for (std::size_t s = 0; s < kPipelineStages; ++s) {
+        for (const int cpu : config.cpus[s]) {
+            if (topology_.node_of(cpu) < 0) {
+                throw std::invalid_argument("placement: " + std::string(to_string(static_cast<PipelineStage>(s))) +
+                                            " cpu " + std::to_string(cpu) + " is not online");
+            }
+            taken.insert(core_of(cpu));
+        }
+        stages_[s].cpus = config.cpus[s];
+    }
+    if (config.reserve_housekeeping_core) {
+        std::set<std::pair<int, int>> node0_cores;
+        for (const int cpu : topology_.cpus_of_node(0)) {
+            node0_cores.insert(core_of(cpu));
+        }
+        if (node0_cores.size() >= 4) {
+            taken.insert(core_of(topology_.cpus_of_node(0).front()));
+        }
+    }
+
+    const auto take_core = [&](int node) -> std::vector<int> {
+        for (const int cpu : topology_.cpus_of_node(node)) {
+            if (taken.insert(core_of(cpu)).second) {
+                return {cpu};
+            }
+        }
+        return {};
+    };
+    const auto derive = [&](PipelineStage stage, int node) {
+        StagePlacement& p = stages_[static_cast<std::size_t>(stage)];
+        if (p.cpus.empty()) {
+            p.cpus = take_core(node);
+        }
+    };
+    derive(PipelineStage::Acquisition, daq_node);
+    derive(PipelineStage::Watchdog, daq_node);
+    derive(PipelineStage::Writer, storage_node);
+
+    StagePlacement& processing = stages_[static_cast<std::size_t>(PipelineStage::Processing)];
+    if (processing.cpus.empty()) {
+        for (const int cpu : topology_.cpus_of_node(daq_node)) {
+            if (!taken.contains(core_of(cpu))) {
+                processing.cpus.push_back(cpu);
+            }
+        }
+        if (processing.cpus.empty()) {
+            processing.cpus = topology_.cpus_of_node(daq_node);
+        }
+    }
+    for (StagePlacement& p : stages_) {
+        if (p.cpus.empty()) {
+            p.cpus = &p == &stages_[static_cast<std::size_t>(PipelineStage::Network)]
+                         ? stages_[static_cast<std::size_t>(PipelineStage::Writer)].cpus
+                         : processing.cpus;
+        }
+        std::sort(p.cpus.begin(), p.cpus.end());
+        p.cpus.erase(std::unique(p.cpus.begin(), p.cpus.end()), p.cpus.end());
+        p.node = common_node(topology_, p.cpus);
+    }
+
+    for (const unsigned irq : daq.irqs) {
+        irqs_.push_back({irq, stage(PipelineStage::Acquisition).cpus, false, "not steered"});
+    }
+
+    for (std::size_t s = 0; s < kPipelineStages; ++s) {
+        Instrumentation::instance().record_placement({std::string(to_string(static_cast<PipelineStage>(s))),
+                                                     format_cpu_list(stages_[s].cpus), stages_[s].node, false,
+                                                     "not pinned"});
+    }
+    for (const IrqPlacement& irq : irqs_) {
+        Instrumentation::instance().record_placement({"irq " + std::to_string(irq.irq), format_cpu_list(irq.cpus),
+                                                     daq_node, false, irq.detail});
+    }
+}
+
+bool ThreadPlacement::apply(PipelineStage stage, std::thread::native_handle_type thread) const {
+    const StagePlacement& p = this->stage(stage);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : p.cpus) {
+        CPU_SET(cpu, &set);
+    }
+    const int err = ::pthread_setaffinity_np(thread, sizeof(set), &set);
+    Instrumentation::instance().record_placement({std::string(to_string(stage)), format_cpu_list(p.cpus), p.node,
+                                                 err == 0, err == 0 ? "" : std::strerror(err)});
+    return err == 0;
+}
+
+bool ThreadPlacement::pin_current_thread(PipelineStage stage) const { return apply(stage, ::pthread_self()); }
+
+bool ThreadPlacement::pin(PipelineStage stage, std::thread& thread) const {
+    return apply(stage, thread.native_handle());
+}
+
+std::size_t ThreadPlacement::steer_irqs() {
+    std::size_t applied = 0;
+    for (IrqPlacement& irq : irqs_) {
+        const std::filesystem::path path = procfs_ / "irq" / std::to_string(irq.irq) / "smp_affinity_list";
+        const std::string list = format_cpu_list(irq.cpus) + "\n";
+        const int fd = ::open(path.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        int err = fd < 0 ? errno : 0;
+        if (fd >= 0) {
+            if (::write(fd, list.data(), list.size()) != static_cast<ssize_t>(list.size())) {
+                err = errno;
+            }
+            if (::close(fd) != 0 && err == 0) {
+                err = errno;
+            }
+        }
+        irq.applied = err == 0;
+        irq.detail = err == 0 ? "" : path.string() + ": " + std::strerror(err);
+        applied += irq.applied;
+        Instrumentation::instance().record_placement({"irq " + std::to_string(irq.irq), format_cpu_list(irq.cpus),
+                                                     common_node(topology_, irq.cpus), irq.applied, irq.detail});
+    }
+    return applied;
+}
+
+// ---- Memory -----------------------------------------------------------------
+
+bool bind_to_node(void* data, std::size_t bytes, int node) noexcept {
+    if (node < 0) {
+        return true;
+    }
+    if (static_cast<std::size_t>(node) >= kMaxNodes) {
+        return false;
+    }
+    const std::size_t page = page_size();
+    const auto addr = reinterpret_cast<std::uintptr_t>(data);
+    const std::uintptr_t begin = (addr + page - 1) / page * page;
+    const std::uintptr_t end = (addr + bytes) / page * page;
+    if (end <= begin) {
+        return true;
+    }
+    constexpr std::size_t kBits = 8 * sizeof(unsigned long);
+    unsigned long mask[kMaxNodes / kBits] = {};
+    mask[static_cast<std::size_t>(node) / kBits] = 1ul << (static_cast<std::size_t>(node) % kBits);
+    // The kernel drops the last bit of maxnode, hence the + 1.
+    return ::syscall(SYS_mbind, begin, end - begin, kMpolBind, mask, kMaxNodes + 1, kMpolMfMove) == 0;
+}
+
+void* NodeMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    const std::size_t page = page_size();
+    if (alignment > page) {
+        throw std::bad_alloc();
+    }
+    const std::size_t size = (std::max<std::size_t>(bytes, 1) + page - 1) / page * page;
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    // Nothing is touched yet, so every page faults in on the node.
+    bind_to_node(p, size, node_);
+    return p;
+}
+
+void NodeMemoryResource::do_deallocate(void* p, std::size_t bytes, std::size_t) {
+    const std::size_t page = page_size();
+    ::munmap(p, (std::max<std::size_t>(bytes, 1) + page - 1) / page * page);
+}
+
+}  // namespace srm
@@ -0,0 +1,184 @@
+#include "srm/thread_pool.hpp"
+
+#include <chrono>
+#include <utility>
+
+namespace srm {
+
+namespace {
+
+// Identifies the pool and worker slot of the current thread.
+thread_local const WorkStealingPool* tls_pool = nullptr;
+thread_local int tls_worker = -1;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) {
+            threads = 1;
+        }
+    }
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    threads_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i] { run(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& t : threads_) {
+        t.join();
+    }
+}
+
+int WorkStealingPool::current_worker() const noexcept {
+    return tls_pool == this ? tls_worker : -1;
+}
+
+void WorkStealingPool::submit(Task task) {
+    const int self = current_worker();
+    const std::size_t target = self >= 0
+                                   ? static_cast<std::size_t>(self)
+                                   : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                                         workers_.size();
+    {
+        std::lock_guard lock(workers_[target]->mutex);
+        workers_[target]->tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        // Taking the sleep lock orders this wake-up after a sleeper's check
+        // of queued_, so the notification cannot be lost.
+        std::lock_guard lock(sleep_mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool WorkStealingPool::pop_local(std::size_t index, Task& task) {
+    Worker& w = *workers_[index];
+    std::lock_guard lock(w.mutex);
+    if (w.tasks.empty()) {
+        return false;
+    }
+    task = std::move(w.tasks.back());
+    w.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(std::size_t thief, Task& task) {
+    const std::size_t n = workers_.size();
+    for (std::size_t k = 1; k <= n; ++k) {
+        const std::size_t victim = (thief + k) % n;
+        Worker& w = *workers_[victim];
+        std::unique_lock lock(w.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || w.tasks.empty()) {
+            continue;
+        }
+        task = std::move(w.tasks.front());
+        w.tasks.pop_front();
+        if (victim != thief) {
+            steals_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool WorkStealingPool::try_run_one() {
+    const int self = current_worker();
+    Task task;
+    const std::size_t slot = self >= 0 ? static_cast<std::size_t>(self) : 0;
+    if (!(self >= 0 && pop_local(slot, task)) && !steal(slot, task)) {
+        return false;
+    }
+    queued_.fetch_sub(1, std::memory_order_acq_rel);
+    task();
+    return true;
+}
+
+void WorkStealingPool::run(std::size_t index) {
+    tls_pool = this;
+    tls_worker = static_cast<int>(index);
+    for (;;) {
+        Task task;
+        if (pop_local(index, task) || steal(index, task)) {
+            queued_.fetch_sub(1, std::memory_order_acq_rel);
+            task();
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        if (queued_.load(std::memory_order_acquire) == 0) {
+            wake_.wait(lock, [this] {
+                return stopping_ || queued_.load(std::memory_order_acquire) != 0;
+            });
+        }
+    }
+}
+
+// ---- TaskGroup -------------------------------------------------------------
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+void TaskGroup::run(std::function<void()> fn) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.submit([this, fn = std::move(fn)] {
+        try {
+            fn();
+        } catch (...) {
+            std::lock_guard lock(error_mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+        // Decrement under the lock: wait() takes it before returning, so the
+        // group cannot be destroyed while the last task is still in here.
+        std::lock_guard lock(done_mutex_);
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done_.notify_all();
+        }
+    });
+}
+
+void TaskGroup::wait() {
+    while (pending_.load(std::memory_order_acquire) != 0) {
+        if (pool_.try_run_one()) {
+            continue;
+        }
+        // Nothing to help with: the remaining tasks are running elsewhere.
+        std::unique_lock lock(done_mutex_);
+        done_.wait_for(lock, std::chrono::milliseconds(1), [this] {
+            return pending_.load(std::memory_order_acquire) == 0;
+        });
+    }
+    {
+        std::lock_guard lock(done_mutex_);
+    }
+    std::exception_ptr error;
+    {
+        std::lock_guard lock(error_mutex_);
+        error = std::exchange(error_, nullptr);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace srm
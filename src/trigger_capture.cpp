@@ -0,0 +1,327 @@
+#include "srm/trigger_capture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "srm/strain_conversion.hpp"
+
+namespace srm {
+
+namespace {
+
+// Beyond sign * int16 on both sides: a bound that is always or never met.
+constexpr double kBoundLimit = 32769.0;
+
+std::int32_t clamp_bound(double bound) {
+    return static_cast<std::int32_t>(std::clamp(bound, -kBoundLimit, kBoundLimit));
+}
+
+/// "Above" @p level for counts that map to physical units increasing with
+/// @p slope_sign: the smallest count (in sign-adjusted terms) reading at
+/// least the level.
+TriggeredCapture::CountThreshold make_threshold(std::size_t channel, double level_counts, double slope_sign) {
+    if (!std::isfinite(level_counts)) {
+        throw std::invalid_argument("trigger: level outside the channel's range");
+    }
+    if (slope_sign > 0.0) {
+        return {channel, 1, clamp_bound(std::ceil(level_counts))};
+    }
+    return {channel, -1, clamp_bound(-std::floor(level_counts))};
+}
+
+double strain_slope_sign(const ConversionParams& p) noexcept {
+    return static_cast<double>(p.strain_coeff) * p.ratio_per_count > 0.0 ? 1.0 : -1.0;
+}
+
+inline bool above(const TriggeredCapture::CountThreshold& t, std::int32_t counts) noexcept {
+    return t.sign * counts >= t.bound;
+}
+
+inline bool edge_matches(TriggerEdge edge, bool was, bool is) noexcept {
+    switch (edge) {
+    case TriggerEdge::Rising:
+        return is && !was;
+    case TriggerEdge::Falling:
+        return was && !is;
+    case TriggerEdge::Either:
+        return was != is;
+    }
+    return false;
+}
+
+}  // namespace
+
+const char* to_string(TriggerKind kind) noexcept {
+    switch (kind) {
+    case TriggerKind::Level:
+        return "level";
+    case TriggerKind::Slope:
+        return "slope";
+    case TriggerKind::Pattern:
+        return "pattern";
+    case TriggerKind::PhaseCurrent:
+        return "phase_current";
+    }
+    return "unknown";
+}
+
+TriggerCondition TriggerCondition::level_crossing(std::size_t channel, double level_ue, TriggerEdge edge) {
+    TriggerCondition c;
+    c.kind = TriggerKind::Level;
+    c.channel = channel;
+    c.level = level_ue;
+    c.edge = edge;
+    return c;
+}
+
+TriggerCondition TriggerCondition::slope(std::size_t channel, double rate_ue_per_s, TriggerEdge edge) {
+    TriggerCondition c;
+    c.kind = TriggerKind::Slope;
+    c.channel = channel;
+    c.rate_ue_per_s = rate_ue_per_s;
+    c.edge = edge;
+    return c;
+}
+
+TriggerCondition TriggerCondition::phase_current(std::size_t channel, double amps, CurrentScale scale,
+                                                 TriggerEdge edge) {
+    TriggerCondition c;
+    c.kind = TriggerKind::PhaseCurrent;
+    c.channel = channel;
+    c.level = amps;
+    c.current = scale;
+    c.edge = edge;
+    return c;
+}
+
+TriggerCondition TriggerCondition::all_of(std::vector<PatternTerm> terms) {
+    TriggerCondition c;
+    c.kind = TriggerKind::Pattern;
+    c.pattern = std::move(terms);
+    return c;
+}
+
+TriggeredCapture::TriggeredCapture(const CaptureInfo& info, const TriggerConfig& config,
+                                   std::span<const TriggerCondition> conditions)
+    : config_(config),
+      ring_(info.channels.size(), config.pre_samples),
+      previous_(info.channels.size(), 0) {
+    if (info.channels.empty()) {
+        throw std::invalid_argument("trigger: no channels");
+    }
+    if (config.max_chunk_samples == 0) {
+        throw std::invalid_argument("trigger: max_chunk_samples must be positive");
+    }
+    const auto check_channel = [&](std::size_t channel) {
+        if (channel >= info.channels.size()) {
+            throw std::invalid_argument("trigger: unknown channel " + std::to_string(channel));
+        }
+    };
+    const auto channel_params = [&](std::size_t channel) {
+        check_channel(channel);
+        return make_conversion_params(info.channels[channel]);
+    };
+
+    for (const TriggerCondition& condition : conditions) {
+        Compiled compiled{condition.kind, condition.edge, {}, 0};
+        switch (condition.kind) {
+        case TriggerKind::Level: {
+            const ConversionParams p = channel_params(condition.channel);
+            compiled.terms.push_back(
+                make_threshold(condition.channel, strain_to_counts(p, condition.level), strain_slope_sign(p)));
+            break;
+        }
+        case TriggerKind::PhaseCurrent: {
+            // Current channels carry their own scale, not a bridge calibration.
+            check_channel(condition.channel);
+            const CurrentScale& scale = condition.current;
+            if (!(scale.amps_per_count != 0.0) || !std::isfinite(scale.amps_per_count)) {
+                throw std::invalid_argument("trigger: amps_per_count must be finite and non-zero");
+            }
+            compiled.terms.push_back(make_threshold(condition.channel,
+                                                    scale.zero_counts + condition.level / scale.amps_per_count,
+                                                    scale.amps_per_count));
+            break;
+        }
+        case TriggerKind::Slope: {
+            const ConversionParams p = channel_params(condition.channel);
+            if (!(condition.rate_ue_per_s > 0.0)) {
+                throw std::invalid_argument("trigger: slope rate must be positive");
+            }
+            // Slope at zero strain; the quarter bridge's nonlinearity moves
+            // it by well under a percent over the gauge range.
+            const double ue_per_count = std::abs(static_cast<double>(p.strain_coeff) * p.ratio_per_count);
+            const double step = condition.rate_ue_per_s / info.sample_rate_hz / ue_per_count;
+            compiled.terms.push_back({condition.channel, strain_slope_sign(p) > 0.0 ? 1 : -1, 0});
+            compiled.step = static_cast<std::int32_t>(std::clamp(std::ceil(step), 1.0, 65536.0));
+            break;
+        }
+        case TriggerKind::Pattern: {
+            if (condition.pattern.empty()) {
+                throw std::invalid_argument("trigger: empty pattern");
+            }
+            for (const PatternTerm& term : condition.pattern) {
+                const ConversionParams p = channel_params(term.channel);
+                CountThreshold t = make_threshold(term.channel, strain_to_counts(p, term.level_ue),
+                                                  strain_slope_sign(p));
+                if (!term.above) {
+                    // below <=> not (sign * counts >= bound) <=> -sign * counts >= 1 - bound
+                    t.sign = -t.sign;
+                    t.bound = 1 - t.bound;
+                }
+                compiled.terms.push_back(t);
+            }
+            break;
+        }
+        }
+        conditions_.push_back(std::move(compiled));
+    }
+    log_.reserve(config.max_logged_events);
+}
+
+void TriggeredCapture::check_block(ChannelBlock<const std::int16_t> block, std::uint64_t first_sample) {
+    if (block.channels() != channels()) {
+        throw std::invalid_argument("trigger: channel count mismatch");
+    }
+    if (first_sample < next_sample_) {
+        throw std::invalid_argument("trigger: samples out of order");
+    }
+    if (first_sample == next_sample_ || samples_seen_ == 0) {
+        return;
+    }
+    // A gap: no edge spans it, and the history before it is not contiguous
+    // with what follows.
+    have_previous_ = false;
+    ring_count_ = 0;
+    if (state_ == State::Recording && first_sample >= window_end_) {
+        close_event(written_end_);
+    }
+    if (state_ == State::Holdoff && first_sample >= holdoff_end_) {
+        state_ = State::Armed;
+    }
+}
+
+std::size_t TriggeredCapture::find_trigger(ChannelBlock<const std::int16_t> block, std::size_t from,
+                                           std::size_t to, std::size_t& fired) const noexcept {
+    std::size_t best = to;
+    const auto previous = [&](std::size_t channel) -> std::int32_t {
+        const std::span<const std::int16_t> x = block.channel(channel);
+        if (from != 0) {
+            return x[from - 1];
+        }
+        return have_previous_ ? previous_[channel] : x[0];
+    };
+
+    for (std::size_t i = 0; i < conditions_.size(); ++i) {
+        const Compiled& condition = conditions_[i];
+        std::size_t hit = best;
+        switch (condition.kind) {
+        case TriggerKind::Level:
+        case TriggerKind::PhaseCurrent: {
+            const CountThreshold t = condition.terms[0];
+            const std::int16_t* x = block.channel(t.channel).data();
+            bool was = above(t, previous(t.channel));
+            for (std::size_t j = from; j < best; ++j) {
+                const bool is = above(t, x[j]);
+                if (edge_matches(condition.edge, was, is)) {
+                    hit = j;
+                    break;
+                }
+                was = is;
+            }
+            break;
+        }
+        case TriggerKind::Slope: {
+            const CountThreshold t = condition.terms[0];
+            const std::int16_t* x = block.channel(t.channel).data();
+            const std::int32_t step = condition.step;
+            std::int32_t p = previous(t.channel);
+            for (std::size_t j = from; j < best; ++j) {
+                const std::int32_t d = t.sign * (x[j] - p);
+                const bool match = condition.edge == TriggerEdge::Rising    ? d >= step
+                                   : condition.edge == TriggerEdge::Falling ? d <= -step
+                                                                            : (d >= step || d <= -step);
+                if (match) {
+                    hit = j;
+                    break;
+                }
+                p = x[j];
+            }
+            break;
+        }
+        case TriggerKind::Pattern: {
+            bool was = true;
+            for (const CountThreshold& t : condition.terms) {
+                was = was && above(t, previous(t.channel));
+            }
+            for (std::size_t j = from; j < best; ++j) {
+                bool is = true;
+                for (const CountThreshold& t : condition.terms) {
+                    is = is && above(t, block.channel(t.channel)[j]);
+                }
+                if (is && !was) {
+                    hit = j;
+                    break;
+                }
+                was = is;
+            }
+            break;
+        }
+        }
+        if (hit < best) {
+            best = hit;
+            fired = i;
+        }
+    }
+    return best;
+}
+
+void TriggeredCapture::remember(ChannelBlock<const std::int16_t> block) noexcept {
+    const std::size_t size = ring_.samples();
+    const std::size_t n = std::min(block.samples(), size);
+    if (n == 0) {
+        return;
+    }
+    // Only the newest `size` samples can survive.
+    const ChannelBlock<const std::int16_t> tail = block.subblock(block.samples() - n, n);
+    const std::size_t first = std::min(n, size - ring_write_);
+    for (std::size_t c = 0; c < channels(); ++c) {
+        const std::int16_t* src = tail.channel(c).data();
+        std::int16_t* dst = ring_.channel(c).data();
+        std::copy_n(src, first, dst + ring_write_);
+        std::copy_n(src + first, n - first, dst);
+    }
+    ring_write_ = (ring_write_ + n) % size;
+    ring_count_ = std::min(size, ring_count_ + block.samples());
+}
+
+void TriggeredCapture::open_event(std::size_t condition, std::uint64_t sample) noexcept {
+    current_ = TriggerEvent{condition, sample, sample - ring_count_, 0, 0};
+    window_end_ = sample + std::max<std::size_t>(config_.post_samples, 1);
+    state_ = State::Recording;
+    ++events_;
+}
+
+void TriggeredCapture::close_event(std::uint64_t end) noexcept {
+    current_.end_sample = end;
+    if (log_.size() < config_.max_logged_events) {
+        log_.push_back(current_);
+    }
+    if (config_.holdoff_samples != 0) {
+        holdoff_end_ = end + config_.holdoff_samples;
+        state_ = State::Holdoff;
+    } else {
+        state_ = State::Armed;
+    }
+}
+
+void TriggeredCapture::finish() noexcept {
+    if (state_ == State::Recording) {
+        close_event(written_end_);
+    }
+}
+
+}  // namespace srm
@@ -0,0 +1,359 @@
+#include "test_common.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "srm/acquisition.hpp"
+#include "srm/spsc_ring.hpp"
+
+namespace srm::test {
+namespace {
+
+TEST(SpscRing, FifoAcrossTheWrap) {
+    EXPECT_THROW(SpscRing<int>(0), std::invalid_argument);
+    SpscRing<int> ring(5);
+    ASSERT_EQ(ring.capacity(), 8u);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.front(), nullptr);
+
+    int next_in = 0;
+    int next_out = 0;
+    std::vector<int> batch(5);
+    std::vector<int> out(7);
+    // Uneven batch sizes walk the indices through every wrap position.
+    for (int round = 0; round < 50; ++round) {
+        for (int& x : batch) {
+            x = next_in + static_cast<int>(&x - batch.data());
+        }
+        const std::size_t pushed = ring.push_batch(std::span<const int>(batch).first(1 + round % 5));
+        EXPECT_LE(ring.size(), ring.capacity());
+        next_in += static_cast<int>(pushed);
+        if (ring.try_push(next_in)) {
+            ++next_in;
+        }
+        ASSERT_EQ(ring.size(), static_cast<std::size_t>(next_in - next_out));
+        if (const int* head = ring.front()) {
+            EXPECT_EQ(*head, next_out);
+        }
+        const std::size_t popped = ring.pop_batch(std::span<int>(out).first(round % 7));
+        for (std::size_t i = 0; i < popped; ++i) {
+            ASSERT_EQ(out[i], next_out++);
+        }
+        int one = -1;
+        if (round % 3 == 0 && ring.try_pop(one)) {
+            ASSERT_EQ(one, next_out++);
+        }
+    }
+
+    while (ring.try_push(next_in)) {
+        ++next_in;
+    }
+    EXPECT_EQ(ring.size(), ring.capacity());
+    EXPECT_EQ(ring.push_batch(batch), 0u);
+    int x = -1;
+    while (ring.try_pop(x)) {
+        ASSERT_EQ(x, next_out++);
+    }
+    EXPECT_EQ(next_out, next_in);
+    EXPECT_TRUE(ring.empty());
+}
+
+// Producer and consumer on their own threads, a third thread sampling
+// size(): every value arrives once and in order, and size() never leaves
+// [0, capacity].
+TEST(SpscRing, TwoThreadsLoseNothing) {
+    constexpr std::uint64_t kCount = 200'000;
+    SpscRing<std::uint64_t> ring(64);
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> max_size{0};
+
+    std::thread producer([&] {
+        std::uint64_t next = 0;
+        std::vector<std::uint64_t> batch(13);
+        while (next < kCount) {
+            const std::uint64_t before = next;
+            if (next % 2 == 0) {
+                for (std::size_t i = 0; i < batch.size(); ++i) {
+                    batch[i] = next + i;
+                }
+                const std::size_t n = std::min<std::uint64_t>(batch.size(), kCount - next);
+                next += ring.push_batch(std::span<const std::uint64_t>(batch).first(n));
+            } else if (ring.try_push(next)) {
+                ++next;
+            }
+            if (next == before) {
+                std::this_thread::yield();  // lets the consumer in on a single core
+            }
+        }
+    });
+    std::thread observer([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            const std::size_t size = ring.size();
+            if (size > max_size.load(std::memory_order_relaxed)) {
+                max_size.store(size, std::memory_order_relaxed);
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::uint64_t expected = 0;
+    std::uint64_t out_of_order = 0;
+    std::vector<std::uint64_t> out(9);
+    while (expected < kCount) {
+        const std::size_t n = ring.pop_batch(out);
+        for (std::size_t i = 0; i < n; ++i) {
+            out_of_order += out[i] != expected++;
+        }
+        std::uint64_t one = 0;
+        if (ring.try_pop(one)) {
+            out_of_order += one != expected++;
+        } else if (n == 0) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    done = true;
+    observer.join();
+
+    EXPECT_EQ(out_of_order, 0u);
+    EXPECT_EQ(expected, kCount);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_LE(max_size.load(), ring.capacity());
+}
+
+/// Driver under the test's control: posted buffers wait until complete()
+/// fills the oldest with a per-block pattern and reports it.
+class ScriptedDriver final : public DmaDriver {
+public:
+    void post(std::size_t index, ChannelBlock<std::int16_t> buffer) override {
+        const std::lock_guard lock(mutex_);
+        posted_.push_back({index, buffer});
+        ++posts_;
+    }
+    void start() override {}
+    void stop() override {
+        const std::lock_guard lock(mutex_);
+        posted_.clear();
+        done_.clear();
+    }
+    bool wait(DmaCompletion& completion, std::chrono::nanoseconds) override {
+        const std::lock_guard lock(mutex_);
+        if (done_.empty()) {
+            return false;
+        }
+        completion = done_.front();
+        done_.pop_front();
+        return true;
+    }
+
+    /// Fills the oldest posted buffer; false if the card has none.
+    bool complete(bool overrun = false) {
+        const std::lock_guard lock(mutex_);
+        if (posted_.empty()) {
+            return false;
+        }
+        const auto [index, buffer] = posted_.front();
+        posted_.pop_front();
+        for (std::size_t c = 0; c < buffer.channels(); ++c) {
+            for (std::size_t i = 0; i < buffer.samples(); ++i) {
+                buffer.channel(c)[i] = pattern(sample_, c, i);
+            }
+        }
+        done_.push_back({index, sample_, 1000 + sample_, overrun});
+        sample_ += buffer.samples();
+        return true;
+    }
+
+    std::size_t queued() {
+        const std::lock_guard lock(mutex_);
+        return posted_.size();
+    }
+    std::size_t posts() {
+        const std::lock_guard lock(mutex_);
+        return posts_;
+    }
+
+    static std::int16_t pattern(std::uint64_t first_sample, std::size_t channel, std::size_t i) {
+        return static_cast<std::int16_t>((first_sample + i) % 30000 + channel);
+    }
+
+private:
+    struct Posted {
+        std::size_t index;
+        ChannelBlock<std::int16_t> buffer;
+    };
+
+    std::mutex mutex_;
+    std::deque<Posted> posted_;
+    std::deque<DmaCompletion> done_;
+    std::uint64_t sample_ = 0;
+    std::size_t posts_ = 0;
+};
+
+AcquisitionConfig small_config(std::size_t buffers) {
+    AcquisitionConfig config;
+    config.channels = 3;
+    config.samples_per_block = 100;
+    config.buffer_count = buffers;
+    config.lock_memory = false;
+    return config;
+}
+
+TEST(DmaAcquisition, RejectsBadGeometry) {
+    EXPECT_THROW(DmaAcquisition(nullptr, small_config(3)), std::invalid_argument);
+    EXPECT_THROW(DmaAcquisition(std::make_unique<ScriptedDriver>(), small_config(1)), std::invalid_argument);
+    AcquisitionConfig empty = small_config(3);
+    empty.samples_per_block = 0;
+    EXPECT_THROW(DmaAcquisition(std::make_unique<ScriptedDriver>(), empty), std::invalid_argument);
+}
+
+// A buffer goes back to the card exactly when its last handle lets go,
+// whichever handle that is and however it was made.
+TEST(DmaAcquisition, BufferReturnsWithTheLastHandle) {
+    auto owned = std::make_unique<ScriptedDriver>();
+    ScriptedDriver& driver = *owned;
+    DmaAcquisition acquisition(std::move(owned), small_config(3));
+    acquisition.start();
+    ASSERT_EQ(driver.queued(), 3u);
+    EXPECT_FALSE(acquisition.next(std::chrono::milliseconds(0)));
+
+    ASSERT_TRUE(driver.complete());
+    BlockHandle a = acquisition.next(std::chrono::milliseconds(0));
+    ASSERT_TRUE(a);
+    EXPECT_EQ(acquisition.buffers_in_use(), 1u);
+    EXPECT_EQ(a.sequence(), 0u);
+    EXPECT_EQ(a.first_sample(), 0u);
+    EXPECT_EQ(a.timestamp_ns(), 1000u);
+    EXPECT_FALSE(a.overrun());
+    const ChannelBlock<const std::int16_t> block = a.block();
+    ASSERT_EQ(block.channels(), 3u);
+    ASSERT_EQ(block.samples(), 100u);
+    EXPECT_EQ(block.channel(2)[7], ScriptedDriver::pattern(0, 2, 7));
+
+    BlockHandle b = a;                 // copy shares
+    BlockHandle c(std::move(b));       // move transfers
+    EXPECT_FALSE(b);
+    BlockHandle d;
+    d = c;                             // copy-assign shares
+    d = d;                             // self-assignment keeps it
+    a.reset();
+    c = BlockHandle();                 // move-assign drops
+    EXPECT_EQ(acquisition.buffers_in_use(), 1u);
+    EXPECT_EQ(driver.queued(), 2u);
+    EXPECT_EQ(d.block().channel(0).data(), block.channel(0).data());  // zero copy
+
+    ChannelBuffer<std::int16_t> copy(3, 100);
+    d.copy_to(copy.view());
+    ChannelBuffer<std::int16_t> wrong(3, 99);
+    EXPECT_THROW(d.copy_to(wrong.view()), std::invalid_argument);
+    d.reset();
+    d.reset();
+    EXPECT_EQ(acquisition.buffers_in_use(), 0u);
+    EXPECT_EQ(driver.queued(), 3u);
+    for (std::size_t ch = 0; ch < 3; ++ch) {
+        for (std::size_t i = 0; i < 100; ++i) {
+            ASSERT_EQ(copy.channel(ch)[i], ScriptedDriver::pattern(0, ch, i));
+        }
+    }
+    EXPECT_EQ(d.sequence(), 0u);
+    EXPECT_EQ(d.block().samples(), 0u);
+
+    // Held handles keep their buffers off the card; sequence counts
+    // deliveries and overruns are reported on the block they precede.
+    std::vector<BlockHandle> held;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(driver.complete(i == 2));
+        held.push_back(acquisition.next(std::chrono::milliseconds(0)));
+        EXPECT_EQ(held.back().sequence(), static_cast<std::uint64_t>(i + 1));
+        EXPECT_EQ(held.back().first_sample(), static_cast<std::uint64_t>(100 * (i + 1)));
+    }
+    EXPECT_TRUE(held.back().overrun());
+    EXPECT_EQ(acquisition.overruns(), 1u);
+    EXPECT_EQ(acquisition.buffers_in_use(), 3u);
+    EXPECT_FALSE(driver.complete());
+    held.erase(held.begin() + 1);
+    EXPECT_EQ(driver.queued(), 1u);
+    held.clear();
+    EXPECT_EQ(acquisition.buffers_in_use(), 0u);
+    EXPECT_EQ(driver.queued(), 3u);
+
+    // After stop() nothing is reposted; start() posts what came back.
+    ASSERT_TRUE(driver.complete());
+    BlockHandle late = acquisition.next(std::chrono::milliseconds(0));
+    const std::size_t posts = driver.posts();
+    acquisition.stop();
+    late.reset();
+    EXPECT_EQ(driver.posts(), posts);
+    acquisition.start();
+    EXPECT_EQ(driver.queued(), 3u);
+}
+
+// Zero-copy delivery on the simulated card, handles released on another
+// thread: the blocks are the synthetic recording in order, and every
+// buffer comes home.
+TEST(DmaAcquisition, HandlesReleasedOnAnotherThread) {
+    const CaptureInfo info = test_capture_info(4);
+    AcquisitionConfig config = small_config(4);
+    config.channels = info.channels.size();
+    config.samples_per_block = 512;
+    SimulatedDmaDriver::Options options;
+    options.info = info;
+    options.signal.strain_channels = info.channels.size();
+    options.real_time = false;
+    DmaAcquisition acquisition(std::make_unique<SimulatedDmaDriver>(options), config);
+
+    constexpr std::size_t kBlocks = 200;
+    const ChannelBuffer<std::int16_t> reference = synthetic_counts(info, kBlocks * config.samples_per_block);
+    SpscRing<BlockHandle> handoff(2 * config.buffer_count);
+    std::atomic<std::uint64_t> mismatches{0};
+    std::thread consumer([&] {
+        std::size_t received = 0;
+        BlockHandle handle;
+        while (received < kBlocks) {
+            if (!handoff.try_pop(handle)) {
+                std::this_thread::yield();
+                continue;
+            }
+            const ChannelBlock<const std::int16_t> block = handle.block();
+            const std::size_t first = static_cast<std::size_t>(handle.first_sample());
+            mismatches += handle.sequence() != received || first != received * config.samples_per_block;
+            for (std::size_t c = 0; c < block.channels(); ++c) {
+                mismatches += !std::equal(block.channel(c).begin(), block.channel(c).end(),
+                                          reference.channel(c).begin() + static_cast<std::ptrdiff_t>(first));
+            }
+            handle.reset();
+            ++received;
+        }
+    });
+
+    acquisition.start();
+    std::size_t delivered = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (delivered < kBlocks && std::chrono::steady_clock::now() < deadline) {
+        BlockHandle block = acquisition.next(std::chrono::milliseconds(100));
+        if (!block) {
+            continue;
+        }
+        EXPECT_LE(acquisition.buffers_in_use(), config.buffer_count);
+        // Never full: it holds more slots than there are buffers.
+        ASSERT_TRUE(handoff.try_push(std::move(block)));
+        ++delivered;
+    }
+    ASSERT_EQ(delivered, kBlocks);
+    consumer.join();
+    acquisition.stop();
+
+    EXPECT_EQ(mismatches.load(), 0u);
+    EXPECT_EQ(acquisition.buffers_in_use(), 0u);
+    EXPECT_EQ(acquisition.overruns(), 0u);
+}
+
+}  // namespace
+}  // namespace srm::test
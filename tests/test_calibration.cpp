@@ -0,0 +1,163 @@
+#include "test_common.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "srm/calibration_store.hpp"
+
+namespace srm::test {
+namespace {
+
+constexpr const char* kRecords =
+    "# rig 2 yoke gauges\n"
+    "channel=0 sensor=SG-101 thermocouple=1 zero=3.5 gf_tc=1e-4 reference_c=20 "
+    "thermal=-20:-35,0:-12,20:0,60:18,120:40\n"
+    "\n"
+    "channel=1 sensor=SG-102 shunt_expected=1000 shunt_measured=990   # quarter bridge\n"
+    "channel=3 sensor=SG-104 thermocouple=0 thermal=0:-10,100:10\n";
+
+double apparent(double t) {
+    const double curve[][2] = {{-20, -35}, {0, -12}, {20, 0}, {60, 18}, {120, 40}};
+    for (std::size_t i = 1; i < 5; ++i) {
+        if (t <= curve[i][0]) {
+            return curve[i - 1][1] + (t - curve[i - 1][0]) / (curve[i][0] - curve[i - 1][0]) *
+                                         (curve[i][1] - curve[i - 1][1]);
+        }
+    }
+    return curve[4][1];
+}
+
+TEST(Calibration, ParsesRecords) {
+    const std::vector<SensorCalibration> records = parse_calibration(kRecords);
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(records[0].sensor_id, "SG-101");
+    EXPECT_EQ(records[0].thermocouple, 1);
+    EXPECT_TRUE(records[0].has_zero_offset);
+    EXPECT_EQ(records[0].thermal_output.size(), 5u);
+    EXPECT_EQ(records[1].shunt_measured_ue, 990.0);
+    EXPECT_EQ(records[1].thermocouple, kNoThermocouple);
+    EXPECT_EQ(records[2].channel, 3);
+
+    EXPECT_THROW(parse_calibration("channel=1 sensor=a\nchannel=1 sensor=b\n"), std::runtime_error);
+    EXPECT_THROW(parse_calibration("channel=1 sensor=a\nchannel=2 sensor=a\n"), std::runtime_error);
+    EXPECT_THROW(parse_calibration("channel=1 sensor=a thermal=3:1,2:0\n"), std::runtime_error);
+    EXPECT_THROW(parse_calibration("channel=x sensor=a\n"), std::runtime_error);
+    EXPECT_THROW(parse_calibration("channel=1\n"), std::runtime_error);
+    EXPECT_THROW(parse_calibration("channel=1 sensor=a colour=blue\n"), std::runtime_error);
+}
+
+// A gauge reading the true strain e at temperature T shows e times the
+// gauge-factor drift plus the thermal output; the calibrated constants
+// must take both out again.
+TEST(Calibration, CompensationRecoversTrueStrain) {
+    CaptureInfo info = test_capture_info(4);
+    info.channels[0].bridge = capture::BridgeConfig::Full;
+    info.channels[1].bridge = capture::BridgeConfig::Quarter;
+    const std::vector<SensorCalibration> records = parse_calibration(kRecords);
+    const CalibrationSnapshot snapshot(info.channels, records);
+    EXPECT_EQ(snapshot.find_sensor("SG-104"), 3);
+    EXPECT_EQ(snapshot.find_sensor("SG-103"), -1);
+    EXPECT_TRUE(snapshot.sensor_id(2).empty());
+
+    ConversionParams nominal = make_conversion_params(info.channels[0]);
+    nominal.offset_counts = 3.5f;
+    // The table's linear interpolation cuts the corners of the curve's
+    // breakpoints by up to a quarter step times the change of slope.
+    ErrorBudget budget("thermal_compensation", 0.1);
+    for (double t = -30.0; t <= 130.0; t += 0.7) {
+        const double tc = std::clamp(t, -20.0, 120.0);
+        for (const double strain : {-800.0, 0.0, 500.0}) {
+            const double shown = strain * (1.0 + 1e-4 * (tc - 20.0)) + apparent(tc);
+            const ConversionParams p = snapshot.params(0, static_cast<float>(t));
+            const double counts = strain_to_counts(nominal, shown);
+            budget.add(strain, static_cast<float>(p.strain_coeff * (counts - p.offset_counts) * p.ratio_per_count));
+        }
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+
+    // Shunt: the reading that showed 990 ue now shows the shunt's 1000 ue.
+    const ConversionParams shunted = snapshot.params(1, 0.0f);
+    const double counts = strain_to_counts(make_conversion_params(info.channels[1]), 990.0);
+    const double r = (counts - shunted.offset_counts) * shunted.ratio_per_count;
+    EXPECT_NEAR(shunted.strain_coeff * r / (1.0 + 2.0 * r), 1000.0, 1e-2);
+
+    // Uncalibrated channels keep their header constants.
+    const ConversionParams plain = snapshot.params(2, 55.0f);
+    const ConversionParams header = make_conversion_params(info.channels[2]);
+    EXPECT_EQ(plain.offset_counts, header.offset_counts);
+    EXPECT_EQ(plain.ratio_per_count, header.ratio_per_count);
+    EXPECT_EQ(plain.strain_coeff, header.strain_coeff);
+
+    std::vector<ConversionParams> block(info.channels.size());
+    snapshot.params(std::vector<float>{25.0f, 60.0f}, block);
+    EXPECT_EQ(block[0].offset_counts, snapshot.params(0, 60.0f).offset_counts);
+    EXPECT_EQ(block[3].offset_counts, snapshot.params(3, 25.0f).offset_counts);
+    EXPECT_THROW(snapshot.params(std::vector<float>{25.0f}, block), std::invalid_argument);
+}
+
+TEST(Calibration, RejectsInconsistentRecords) {
+    const CaptureInfo info = test_capture_info(2);
+    std::vector<SensorCalibration> records = parse_calibration("channel=5 sensor=a\n");
+    EXPECT_THROW(CalibrationSnapshot(info.channels, records), std::invalid_argument);
+    records = parse_calibration("channel=0 sensor=a shunt_expected=1000\n");
+    EXPECT_THROW(CalibrationSnapshot(info.channels, records), std::invalid_argument);
+    records = parse_calibration("channel=0 sensor=a thermocouple=0 gf_tc=0.1 reference_c=20\n");
+    EXPECT_THROW(CalibrationSnapshot(info.channels, records), std::invalid_argument);
+    // Records built in code bypass the parser's curve check.
+    records = parse_calibration("channel=0 sensor=a thermocouple=0 thermal=20:0,40:5\n");
+    records[0].thermal_output[1].temperature_c = 20.0f;
+    EXPECT_THROW(CalibrationSnapshot(info.channels, records), std::invalid_argument);
+    records[0].thermal_output[1].temperature_c = 0.0f;
+    EXPECT_THROW(CalibrationSnapshot(info.channels, records), std::invalid_argument);
+}
+
+// Readers never see a snapshot go backwards or a freed one; publish()
+// returns only after every block on the old snapshot has finished.
+TEST(CalibrationStore, PublishesWhileReadersRun) {
+    const CaptureInfo info = test_capture_info(4);
+    const std::vector<SensorCalibration> records = parse_calibration(kRecords);
+    CalibrationStore store(CalibrationSnapshot(info.channels, records), 4);
+    EXPECT_EQ(store.generation(), 1u);
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> regressions{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t) {
+        readers.emplace_back([&] {
+            CalibrationStore::Reader reader = store.reader();
+            std::vector<ConversionParams> block(info.channels.size());
+            const std::vector<float> thermocouples = {20.0f, 40.0f};
+            std::uint64_t last = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const CalibrationStore::ReadGuard calibration = reader.read();
+                regressions += calibration->generation() < last;
+                last = calibration->generation();
+                calibration->params(thermocouples, block);
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(store.publish(CalibrationSnapshot(info.channels, records)), static_cast<std::uint64_t>(i + 2));
+    }
+    stop = true;
+    for (std::thread& t : readers) {
+        t.join();
+    }
+    EXPECT_EQ(regressions.load(), 0u);
+    EXPECT_EQ(store.generation(), 201u);
+
+    std::vector<CalibrationStore::Reader> all;
+    for (int i = 0; i < 4; ++i) {
+        all.push_back(store.reader());
+    }
+    EXPECT_THROW(store.reader(), std::runtime_error);
+    all.pop_back();
+    EXPECT_NO_THROW(store.reader());
+    EXPECT_THROW(store.publish(CalibrationSnapshot(test_capture_info(3).channels, {})), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace srm::test
@@ -0,0 +1,225 @@
+#include "test_common.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "srm/campaign.hpp"
+#include "srm/thread_pool.hpp"
+
+namespace srm::test {
+namespace {
+
+// Fork/join down a binary tree: every leaf runs once, whoever runs it.
+TEST(WorkStealingPool, NestedTasksAllRun) {
+    WorkStealingPool pool(3);
+    EXPECT_EQ(pool.thread_count(), 3u);
+    EXPECT_EQ(pool.current_worker(), -1);
+    std::atomic<std::uint64_t> leaves{0};
+    TaskGroup group(pool);
+    std::function<void(int)> split = [&](int depth) {
+        if (depth == 0) {
+            ++leaves;
+            return;
+        }
+        group.run([&, depth] { split(depth - 1); });
+        group.run([&, depth] { split(depth - 1); });
+    };
+    group.run([&] { split(10); });
+    group.wait();
+    EXPECT_EQ(leaves.load(), 1024u);
+}
+
+// Children queued behind a parent that will not yield its worker can only
+// run if another worker steals them.
+TEST(WorkStealingPool, IdleWorkersSteal) {
+    WorkStealingPool pool(2);
+    std::atomic<int> started{0};
+    std::atomic<int> parent_worker{-1};
+    std::atomic<int> same_worker{0};
+    std::atomic<bool> finished{false};
+    TaskGroup group(pool);
+    group.run([&] {
+        parent_worker = pool.current_worker();
+        for (int i = 0; i < 2; ++i) {
+            group.run([&] {
+                same_worker += pool.current_worker() == parent_worker.load();
+                ++started;
+            });
+        }
+        while (started.load() < 2) {
+            std::this_thread::yield();
+        }
+        finished = true;
+    });
+    // Not wait(): the calling thread would help and hide the steals.
+    while (!finished.load()) {
+        std::this_thread::yield();
+    }
+    group.wait();
+    EXPECT_EQ(same_worker.load(), 0);
+    EXPECT_GE(pool.steals(), 2u);
+}
+
+TEST(WorkStealingPool, WaitRethrowsTheFirstError) {
+    WorkStealingPool pool(2);
+    std::atomic<int> ran{0};
+    TaskGroup group(pool);
+    for (int i = 0; i < 20; ++i) {
+        group.run([&, i] {
+            ++ran;
+            if (i % 7 == 3) {
+                throw std::runtime_error("task " + std::to_string(i));
+            }
+        });
+    }
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_EQ(ran.load(), 20);
+    // The error was consumed; the group is reusable.
+    group.run([&] { ++ran; });
+    EXPECT_NO_THROW(group.wait());
+    EXPECT_EQ(ran.load(), 21);
+}
+
+TEST(Campaign, SplitsChunkRanges) {
+    EXPECT_THROW(split_chunks(10, 0), std::invalid_argument);
+    const std::vector<ChunkRange> none = split_chunks(0, 4);
+    ASSERT_EQ(none.size(), 1u);
+    EXPECT_EQ(none[0].first_chunk, none[0].end_chunk);
+    const std::vector<ChunkRange> ranges = split_chunks(10, 4);
+    ASSERT_EQ(ranges.size(), 3u);
+    EXPECT_EQ(ranges[0].first_chunk, 0u);
+    EXPECT_EQ(ranges[1].first_chunk, 4u);
+    EXPECT_EQ(ranges[2].first_chunk, 8u);
+    EXPECT_EQ(ranges[2].end_chunk, 10u);
+    EXPECT_EQ(split_chunks(8, 4).size(), 2u);
+}
+
+/// A campaign directory, removed with everything in it.
+class CampaignDirectory {
+public:
+    CampaignDirectory() : scratch_("_campaign") { std::filesystem::create_directories(scratch_.path()); }
+    ~CampaignDirectory() {
+        std::error_code ignored;
+        std::filesystem::remove_all(scratch_.path(), ignored);
+    }
+
+    const std::filesystem::path& path() const noexcept { return scratch_.path(); }
+
+private:
+    ScratchFile scratch_;
+};
+
+/// Per-file result whose merge is order-sensitive: the chunks in the order
+/// they were folded, and the sum of channel 0.
+struct ChunkLog {
+    std::vector<std::size_t> chunks;
+    std::int64_t sum = 0;
+};
+
+TEST(Campaign, ResultsIndependentOfThreadsAndSplit) {
+    const CampaignDirectory dir;
+    const CaptureInfo info = test_capture_info(2);
+    const std::size_t chunk = 500;
+    std::vector<ChunkLog> expected;
+    for (std::size_t f = 0; f < 6; ++f) {
+        const std::size_t chunks = f == 2 ? 0 : 3 + 4 * f;
+        const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, chunk * (chunks + 1));
+        CaptureWriter writer(dir.path() / ("run" + std::to_string(f) + ".srmcap"), info);
+        ChunkLog log;
+        for (std::size_t k = 0; k < chunks; ++k) {
+            // Offset per file so the rows cannot be swapped unnoticed.
+            writer.write_chunk(counts.view().subblock((f + k) % 2 * chunk, chunk));
+            log.chunks.push_back(k);
+            for (const std::int16_t x : counts.channel(0).subspan((f + k) % 2 * chunk, chunk)) {
+                log.sum += x;
+            }
+        }
+        writer.finish();
+        expected.push_back(log);
+    }
+    std::ofstream(dir.path() / "notes.txt") << "not a capture\n";
+    const std::vector<std::filesystem::path> files = list_captures(dir.path());
+    ASSERT_EQ(files.size(), expected.size());
+    EXPECT_TRUE(std::is_sorted(files.begin(), files.end()));
+
+    const auto map = [](const CaptureReader& reader, ChunkRange range) {
+        ChunkLog log;
+        for (std::size_t k = range.first_chunk; k < range.end_chunk; ++k) {
+            log.chunks.push_back(k);
+            for (const std::int16_t x : reader.channel(k, 0)) {
+                log.sum += x;
+            }
+        }
+        return log;
+    };
+    const auto merge = [](ChunkLog& into, ChunkLog&& part) {
+        into.chunks.insert(into.chunks.end(), part.chunks.begin(), part.chunks.end());
+        into.sum += part.sum;
+    };
+
+    for (const std::size_t threads : {1u, 4u}) {
+        for (const std::size_t per_task : {1u, 3u, 64u}) {
+            WorkStealingPool pool(threads);
+            const CampaignProcessor campaign(pool, {.chunks_per_task = per_task});
+            const std::vector<FileResult<ChunkLog>> rows = campaign.run<ChunkLog>(files, map, merge);
+            ASSERT_EQ(rows.size(), files.size());
+            for (std::size_t f = 0; f < rows.size(); ++f) {
+                EXPECT_EQ(rows[f].path, files[f]);
+                ASSERT_TRUE(rows[f].ok()) << rows[f].error;
+                EXPECT_EQ(rows[f].result.chunks, expected[f].chunks)
+                    << threads << " threads, " << per_task << " chunks per task, file " << f;
+                EXPECT_EQ(rows[f].result.sum, expected[f].sum)
+                    << threads << " threads, " << per_task << " chunks per task, file " << f;
+            }
+        }
+    }
+}
+
+// A file that cannot be opened, or whose analysis throws, gets the error
+// in its own row; the other rows are unaffected.
+TEST(Campaign, ErrorsStayInTheirRow) {
+    const CampaignDirectory dir;
+    const CaptureInfo info = test_capture_info(2);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 1500);
+    std::vector<std::filesystem::path> files;
+    for (const std::size_t chunks : {2u, 3u}) {
+        files.push_back(dir.path() / ("run" + std::to_string(chunks) + ".srmcap"));
+        CaptureWriter writer(files.back(), info);
+        for (std::size_t k = 0; k < chunks; ++k) {
+            writer.write_chunk(counts.view().subblock(k * 500, 500));
+        }
+        writer.finish();
+    }
+    files.insert(files.begin() + 1, dir.path() / "missing.srmcap");
+    files.push_back(dir.path() / "garbage.srmcap");
+    std::ofstream(files.back()) << "garbage";
+
+    WorkStealingPool pool(2);
+    const CampaignProcessor campaign(pool, {.chunks_per_task = 1});
+    const auto rows = campaign.run<std::size_t>(
+        files,
+        [&](const CaptureReader& reader, ChunkRange range) {
+            if (reader.chunk_count() == 3 && range.first_chunk == 1) {
+                throw std::runtime_error("analysis failed");
+            }
+            return range.end_chunk - range.first_chunk;
+        },
+        [](std::size_t& into, std::size_t&& part) { into += part; });
+    ASSERT_EQ(rows.size(), 4u);
+    EXPECT_TRUE(rows[0].ok());
+    EXPECT_EQ(rows[0].result, 2u);
+    EXPECT_FALSE(rows[1].ok());
+    EXPECT_FALSE(rows[2].ok());
+    EXPECT_EQ(rows[2].error, "analysis failed");
+    EXPECT_FALSE(rows[3].ok());
+}
+
+}  // namespace
+}  // namespace srm::test
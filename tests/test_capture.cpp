@@ -0,0 +1,362 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "srm/async_capture_writer.hpp"
+#include "srm/capture_file.hpp"
+#include "srm/capture_pyramid.hpp"
+#include "srm/delta_rice.hpp"
+
+namespace srm::test {
+namespace {
+
+void expect_same_info(const CaptureInfo& a, const CaptureInfo& b) {
+    EXPECT_EQ(a.sample_rate_hz, b.sample_rate_hz);
+    EXPECT_EQ(a.rotor_position_channel, b.rotor_position_channel);
+    EXPECT_EQ(a.start_time_ns, b.start_time_ns);
+    ASSERT_EQ(a.channels.size(), b.channels.size());
+    for (std::size_t c = 0; c < a.channels.size(); ++c) {
+        EXPECT_EQ(a.channels[c].name, b.channels[c].name);
+        EXPECT_EQ(a.channels[c].gauge_factor, b.channels[c].gauge_factor);
+        EXPECT_EQ(a.channels[c].excitation_volts, b.channels[c].excitation_volts);
+        EXPECT_EQ(a.channels[c].amplifier_gain, b.channels[c].amplifier_gain);
+        EXPECT_EQ(a.channels[c].volts_per_count, b.channels[c].volts_per_count);
+        EXPECT_EQ(a.channels[c].zero_offset_counts, b.channels[c].zero_offset_counts);
+        EXPECT_EQ(a.channels[c].bridge, b.channels[c].bridge);
+    }
+}
+
+/// Signals that are hard on the coder: full-scale steps (escapes), white
+/// noise, a constant, and the synthetic strain.
+ChannelBuffer<std::int16_t> awkward_counts(std::size_t samples) {
+    const CaptureInfo info = test_capture_info(4);
+    ChannelBuffer<std::int16_t> counts = synthetic_counts(info, samples);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> any(std::numeric_limits<std::int16_t>::min(),
+                                           std::numeric_limits<std::int16_t>::max());
+    for (std::size_t i = 0; i < samples; ++i) {
+        counts.channel(0)[i] = i % 2 == 0 ? std::numeric_limits<std::int16_t>::min()
+                                          : std::numeric_limits<std::int16_t>::max();
+        counts.channel(1)[i] = static_cast<std::int16_t>(any(rng));
+        counts.channel(2)[i] = -1234;
+    }
+    return counts;
+}
+
+TEST(CaptureFormat, HeaderRoundTrip) {
+    CaptureInfo info = test_capture_info(16);
+    info.rotor_position_channel = 3;
+    const std::vector<std::byte> bytes = capture::encode_header(info);
+    expect_same_info(info, capture::decode_header(bytes));
+    EXPECT_THROW(capture::decode_header(std::span(bytes).first(bytes.size() / 2)), std::runtime_error);
+}
+
+TEST(CaptureFile, RawRoundTripWithGaps) {
+    const ScratchFile file(".srmcap");
+    const CaptureInfo info = test_capture_info(6);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 30000);
+    // Chunks of uneven length, with a gap of 5000 samples after the second.
+    const std::vector<std::pair<std::size_t, std::size_t>> chunks = {{0, 4096}, {4096, 777}, {9873, 20127}};
+    {
+        CaptureWriter writer(file.path(), info);
+        for (const auto& [first, length] : chunks) {
+            writer.write_chunk(counts.view().subblock(first, length), first);
+        }
+        writer.finish();
+    }
+    const CaptureReader reader(file.path());
+    expect_same_info(info, reader.info());
+    ASSERT_EQ(reader.chunk_count(), chunks.size());
+    EXPECT_EQ(reader.total_samples(), 25000u);  // stored samples, gap excluded
+    for (std::size_t k = 0; k < chunks.size(); ++k) {
+        const auto [first, length] = chunks[k];
+        EXPECT_EQ(reader.chunks()[k].first_sample, first);
+        ASSERT_TRUE(reader.is_raw(k));
+        const ChannelBlock<const std::int16_t> block = reader.chunk_block(k);
+        ASSERT_EQ(block.samples(), length);
+        for (std::size_t c = 0; c < info.channels.size(); ++c) {
+            EXPECT_TRUE(std::equal(block.channel(c).begin(), block.channel(c).end(),
+                                   counts.channel(c).begin() + static_cast<std::ptrdiff_t>(first)))
+                << "chunk " << k << " channel " << c;
+        }
+    }
+    EXPECT_EQ(reader.find_chunk(4100), 1u);
+    EXPECT_EQ(reader.find_chunk(6000), reader.chunk_count());
+    EXPECT_EQ(reader.find_chunk(29999), 2u);
+}
+
+TEST(CaptureFile, CorruptIndexIsRejected) {
+    const ScratchFile file(".srmcap");
+    const CaptureInfo info = test_capture_info(2);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 3000);
+    {
+        CaptureWriter writer(file.path(), info);
+        writer.write_chunk(counts.view().subblock(0, 1000), 0);
+        writer.write_chunk(counts.view().subblock(1000, 2000), 1000);
+        writer.finish();
+    }
+    const std::uintmax_t size = std::filesystem::file_size(file.path());
+    capture::FileTrailer trailer;
+    {
+        std::ifstream in(file.path(), std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(size - sizeof(trailer)));
+        in.read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+    }
+    const auto patch = [&](std::uint64_t offset, const void* data, std::size_t bytes) {
+        std::fstream io(file.path(), std::ios::binary | std::ios::in | std::ios::out);
+        io.seekp(static_cast<std::streamoff>(offset));
+        io.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    };
+
+    // 2^59 + 2 entries of 32 bytes wrap to 64 bytes: the real index size.
+    capture::FileTrailer huge = trailer;
+    huge.chunk_count = (std::uint64_t{1} << 59) + 2;
+    patch(size - sizeof(trailer), &huge, sizeof(huge));
+    EXPECT_THROW(CaptureReader{file.path()}, std::runtime_error);
+    patch(size - sizeof(trailer), &trailer, sizeof(trailer));
+    EXPECT_EQ(CaptureReader(file.path()).chunk_count(), 2u);
+
+    // The second chunk claims to start inside the first.
+    const std::uint64_t overlapping = 500;
+    const std::uint64_t second = trailer.index_offset + sizeof(capture::ChunkIndexEntry);
+    const std::uint64_t first_sample = 1000;
+    patch(second + offsetof(capture::ChunkIndexEntry, first_sample), &overlapping, sizeof(overlapping));
+    EXPECT_THROW(CaptureReader{file.path()}, std::runtime_error);
+    patch(second + offsetof(capture::ChunkIndexEntry, first_sample), &first_sample, sizeof(first_sample));
+
+    // A chunk pointing into the channel descriptors.
+    const std::uint64_t into_header = sizeof(capture::FileHeader);
+    patch(trailer.index_offset + offsetof(capture::ChunkIndexEntry, offset), &into_header, sizeof(into_header));
+    EXPECT_THROW(CaptureReader{file.path()}, std::runtime_error);
+}
+
+TEST(CaptureFile, UnknownBridgeIsRejected) {
+    const ScratchFile file(".srmcap");
+    const CaptureInfo info = test_capture_info(2);
+    {
+        CaptureWriter writer(file.path(), info);
+        writer.write_chunk(synthetic_counts(info, 100).view(), 0);
+        writer.finish();
+    }
+    {
+        std::fstream io(file.path(), std::ios::binary | std::ios::in | std::ios::out);
+        io.seekp(static_cast<std::streamoff>(sizeof(capture::FileHeader) + sizeof(capture::ChannelDescriptor) +
+                                             offsetof(capture::ChannelDescriptor, bridge)));
+        io.put('\x03');
+    }
+    EXPECT_THROW(CaptureReader{file.path()}, std::runtime_error);
+}
+
+TEST(DeltaRice, LosslessOnAwkwardSignals) {
+    const ChannelBuffer<std::int16_t> counts = awkward_counts(5000);
+    std::vector<std::byte> coded(delta_rice_max_bytes(counts.samples()));
+    std::vector<std::int16_t> decoded(counts.samples());
+    for (std::size_t c = 0; c < counts.channels(); ++c) {
+        for (const std::size_t n : {counts.samples(), std::size_t{1}, std::size_t{65}}) {
+            const std::span<const std::int16_t> in = counts.channel(c).first(n);
+            const std::size_t bytes = encode_delta_rice(in, coded);
+            ASSERT_GT(bytes, 0u);
+            ASSERT_TRUE(decode_delta_rice(std::span(coded).first(bytes), std::span(decoded).first(n)));
+            EXPECT_TRUE(std::equal(in.begin(), in.end(), decoded.begin())) << "channel " << c << ", " << n;
+            // The worst case must stay inside the advertised bound.
+            EXPECT_LE(bytes, delta_rice_max_bytes(n));
+        }
+    }
+}
+
+TEST(DeltaRice, TruncationAndSmallBuffersAreReported) {
+    const ChannelBuffer<std::int16_t> counts = awkward_counts(2000);
+    std::vector<std::byte> coded(delta_rice_max_bytes(counts.samples()));
+    const std::size_t bytes = encode_delta_rice(counts.channel(1), coded);
+    ASSERT_GT(bytes, 8u);
+    std::vector<std::int16_t> decoded(counts.samples());
+    EXPECT_FALSE(decode_delta_rice(std::span(coded).first(bytes / 2), decoded));
+    EXPECT_EQ(encode_delta_rice(counts.channel(1), std::span(coded).first(bytes / 2)), 0u);
+}
+
+TEST(DeltaRice, ChunkPayloadRoundTrip) {
+    const ChannelBuffer<std::int16_t> counts = awkward_counts(4096);
+    std::vector<std::byte> payload(counts.channels() *
+                                   (sizeof(std::uint32_t) + delta_rice_max_bytes(counts.samples())));
+    payload.resize(encode_delta_rice_chunk(counts.view(), payload));
+    ASSERT_FALSE(payload.empty());
+    std::vector<std::int16_t> decoded(counts.samples());
+    for (std::size_t c = 0; c < counts.channels(); ++c) {
+        ASSERT_TRUE(decode_delta_rice_chunk(payload, counts.channels(), c, decoded));
+        EXPECT_TRUE(std::equal(decoded.begin(), decoded.end(), counts.channel(c).begin())) << "channel " << c;
+    }
+}
+
+// The async writer compresses, pads for O_DIRECT and builds the pyramid on
+// its own thread; what comes back through the readers must be the input,
+// and the pyramid bins must be the min/max/mean of their samples.
+TEST(AsyncCaptureWriter, CompressedRoundTripWithPyramid) {
+    const ScratchFile file(".srmcap");
+    const ScratchFile sidecar(".srmpyr");
+    ASSERT_EQ(pyramid_path(file.path()), sidecar.path());
+    const CaptureInfo info = test_capture_info(4);
+    const std::size_t chunk = 8192;
+    const std::size_t chunks = 7;
+    ChannelBuffer<std::int16_t> counts = synthetic_counts(info, chunk * chunks);
+    std::copy_n(awkward_counts(chunk).channel(0).begin(), chunk, counts.channel(0).begin());
+
+    AsyncWriterOptions options;
+    options.max_chunk_samples = chunk;
+    options.build_pyramid = true;
+    double ratio = 0.0;
+    {
+        AsyncCaptureWriter writer(file.path(), info, options);
+        for (std::size_t k = 0; k < chunks; ++k) {
+            // The last chunk is short.
+            const std::size_t length = k + 1 == chunks ? chunk - 1000 : chunk;
+            writer.write_chunk(counts.view().subblock(k * chunk, length));
+        }
+        writer.finish();
+        ratio = writer.compression_ratio();
+    }
+    RecordProperty("delta_rice_compression_ratio", std::to_string(ratio));
+    EXPECT_GT(ratio, 1.5);
+
+    const CaptureReader reader(file.path());
+    expect_same_info(info, reader.info());
+    ASSERT_EQ(reader.chunk_count(), chunks);
+    const std::uint64_t total = chunk * chunks - 1000;
+    EXPECT_EQ(reader.total_samples(), total);
+    std::vector<std::int16_t> decoded;
+    for (std::size_t k = 0; k < reader.chunk_count(); ++k) {
+        decoded.resize(reader.chunks()[k].sample_count);
+        for (std::size_t c = 0; c < reader.channel_count(); ++c) {
+            reader.read_channel(k, c, decoded);
+            EXPECT_TRUE(std::equal(decoded.begin(), decoded.end(),
+                                   counts.channel(c).begin() + static_cast<std::ptrdiff_t>(k * chunk)))
+                << "chunk " << k << " channel " << c;
+        }
+    }
+
+    const PyramidReader pyramid(sidecar.path());
+    ASSERT_EQ(pyramid.channel_count(), info.channels.size());
+    EXPECT_EQ(pyramid.total_samples(), total);
+    ErrorBudget mean_budget("pyramid_mean", 1e-3, 4);
+    for (std::size_t level = 0; level < 3 && level < pyramid.level_count(); ++level) {
+        const std::uint64_t per_bin = pyramid.samples_per_bin(level);
+        for (std::size_t c = 0; c < info.channels.size(); ++c) {
+            for (std::uint64_t b = 0; b < pyramid.bin_count(level); ++b) {
+                const std::uint64_t first = b * per_bin;
+                const std::uint64_t last = std::min(first + per_bin, total);
+                const std::span<const std::int16_t> run = counts.channel(c).subspan(first, last - first);
+                const PyramidBin bin = pyramid.bin(level, c, b);
+                ASSERT_EQ(bin.min, *std::min_element(run.begin(), run.end())) << level << "/" << c << "/" << b;
+                ASSERT_EQ(bin.max, *std::max_element(run.begin(), run.end())) << level << "/" << c << "/" << b;
+                double sum = 0.0;
+                for (const std::int16_t x : run) {
+                    sum += x;
+                }
+                mean_budget.add(sum / static_cast<double>(run.size()), bin.mean);
+            }
+        }
+    }
+    mean_budget.record();
+    EXPECT_TRUE(mean_budget.within()) << mean_budget;
+
+    // Overview columns must bracket exactly the samples they cover, whether
+    // they come from a pyramid level or from the raw chunks.
+    const CaptureOverview overview(reader, pyramid);
+    for (const std::size_t columns : {std::size_t{7}, std::size_t{640}, std::size_t{9000}}) {
+        std::vector<PyramidBin> out(columns);
+        const std::uint64_t first = 1234;
+        const int level = overview.view(2, first, total, out);
+        std::int16_t lo = std::numeric_limits<std::int16_t>::max();
+        std::int16_t hi = std::numeric_limits<std::int16_t>::min();
+        for (const PyramidBin& bin : out) {
+            ASSERT_FALSE(bin.empty()) << columns << " columns at level " << level;
+            lo = std::min(lo, bin.min);
+            hi = std::max(hi, bin.max);
+        }
+        const std::span<const std::int16_t> run = counts.channel(2).subspan(first, total - first);
+        EXPECT_EQ(lo, *std::min_element(run.begin(), run.end())) << columns << " columns";
+        EXPECT_EQ(hi, *std::max_element(run.begin(), run.end())) << columns << " columns";
+    }
+}
+
+// Every bin of every level against a direct pass over the samples it
+// covers, with uneven blocks, a gap wider than a level-0 page and a
+// partial last bin.
+TEST(PyramidBuilder, BinsMatchReference) {
+    const ScratchFile sidecar(".srmpyr");
+    const CaptureInfo info = test_capture_info(4);
+    const PyramidConfig config{.finest_factor = 4, .ratio = 3, .levels = 6};
+    const std::size_t total = 45'001;
+    const std::uint64_t gap_first = 10'003;
+    const std::uint64_t gap_end = 30'000;  // 5000 level-0 bins: a whole empty page
+    const ChannelBuffer<std::int16_t> counts = awkward_counts(total);
+    {
+        PyramidBuilder builder(sidecar.path(), 4, info.sample_rate_hz, config);
+        for (std::size_t pos = 0, k = 0; pos < total; ++k) {
+            const std::size_t limit = pos < gap_first ? gap_first : total;
+            const std::size_t end = std::min<std::size_t>(pos + 1 + (k * 7919) % 3000, limit);
+            builder.add(counts.view().subblock(pos, end - pos), pos);
+            pos = end == gap_first ? gap_end : end;
+        }
+        EXPECT_EQ(builder.samples_seen(), total);
+        EXPECT_THROW(builder.add(counts.view().subblock(0, 10), 100), std::invalid_argument);
+        builder.finish();
+    }
+
+    const PyramidReader pyramid(sidecar.path());
+    ASSERT_EQ(pyramid.level_count(), config.levels);
+    EXPECT_EQ(pyramid.channel_count(), 4u);
+    EXPECT_EQ(pyramid.total_samples(), total);
+    ErrorBudget mean_budget("pyramid_builder_mean", 1e-3, 4);
+    std::uint64_t per_bin = config.finest_factor;
+    for (std::size_t level = 0; level < pyramid.level_count(); ++level, per_bin *= config.ratio) {
+        ASSERT_EQ(pyramid.samples_per_bin(level), per_bin);
+        ASSERT_EQ(pyramid.bin_count(level), (total + per_bin - 1) / per_bin);
+        for (std::size_t c = 0; c < 4; ++c) {
+            for (std::uint64_t b = 0; b <= pyramid.bin_count(level); ++b) {
+                std::int16_t lo = std::numeric_limits<std::int16_t>::max();
+                std::int16_t hi = std::numeric_limits<std::int16_t>::min();
+                double sum = 0.0;
+                std::size_t present = 0;
+                for (std::uint64_t i = b * per_bin; i < std::min<std::uint64_t>((b + 1) * per_bin, total); ++i) {
+                    if (i >= gap_first && i < gap_end) {
+                        continue;
+                    }
+                    lo = std::min(lo, counts.channel(c)[i]);
+                    hi = std::max(hi, counts.channel(c)[i]);
+                    sum += counts.channel(c)[i];
+                    ++present;
+                }
+                const PyramidBin bin = pyramid.bin(level, c, b);
+                if (present == 0) {
+                    ASSERT_TRUE(bin.empty()) << level << "/" << c << "/" << b;
+                    ASSERT_TRUE(std::isnan(bin.mean)) << level << "/" << c << "/" << b;
+                    continue;
+                }
+                ASSERT_EQ(bin.min, lo) << level << "/" << c << "/" << b;
+                ASSERT_EQ(bin.max, hi) << level << "/" << c << "/" << b;
+                mean_budget.add(sum / static_cast<double>(present), bin.mean);
+            }
+        }
+    }
+    mean_budget.record();
+    EXPECT_TRUE(mean_budget.within()) << mean_budget;
+}
+
+TEST(PyramidBuilder, RejectsBadConfiguration) {
+    const ScratchFile sidecar(".srmpyr");
+    EXPECT_THROW(PyramidBuilder(sidecar.path(), 2, 1e6, {.finest_factor = 0}), std::invalid_argument);
+    EXPECT_THROW(PyramidBuilder(sidecar.path(), 2, 1e6, {.ratio = 0}), std::invalid_argument);
+    EXPECT_THROW(PyramidBuilder(sidecar.path(), 2, 1e6, {.levels = 0}), std::invalid_argument);
+    PyramidBuilder builder(sidecar.path(), 2, 1e6);
+    const ChannelBuffer<std::int16_t> three(3, 10);
+    EXPECT_THROW(builder.add(three.view(), 0), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace srm::test
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/channel_block.hpp"
+#include "srm/strain_conversion.hpp"
+#include "srm/synthetic.hpp"
+
+namespace srm::test {
+
+/// Representable floats between @p a and @p b (0 for equal values, +0 and
+/// -0 included); saturates for NaN against a number.
+inline std::uint32_t ulp_distance(float a, float b) noexcept {
+    if (a == b) {
+        return 0;
+    }
+    if (std::isnan(a) || std::isnan(b)) {
+        return std::numeric_limits<std::uint32_t>::max();
+    }
+    // Map the sign-magnitude bit patterns onto one monotonic integer line.
+    const auto ordered = [](float x) {
+        const auto bits = static_cast<std::int64_t>(std::bit_cast<std::int32_t>(x));
+        return bits < 0 ? std::int64_t{std::numeric_limits<std::int32_t>::min()} - bits : bits;
+    };
+    const std::int64_t d = ordered(a) - ordered(b);
+    const std::uint64_t magnitude = static_cast<std::uint64_t>(d < 0 ? -d : d);
+    return magnitude > std::numeric_limits<std::uint32_t>::max() ? std::numeric_limits<std::uint32_t>::max()
+                                                                 : static_cast<std::uint32_t>(magnitude);
+}
+
+/// Worst error of a fast path against its reference over a run of samples,
+/// held to an absolute and a ULP budget (a sample passes if it meets
+/// either, so values near zero are judged absolutely). record() adds the
+/// worst case to the JSON report, so test_output.txt shows how much of
+/// each budget a change used, not just whether it passed.
+class ErrorBudget {
+public:
+    ErrorBudget(std::string name, double max_abs, std::uint32_t max_ulp = 0)
+        : name_(std::move(name)), max_abs_budget_(max_abs), max_ulp_budget_(max_ulp) {}
+
+    void add(double reference, float actual) {
+        const double abs_error = std::fabs(static_cast<double>(actual) - reference);
+        const std::uint32_t ulps = ulp_distance(static_cast<float>(reference), actual);
+        ++samples_;
+        if (std::isnan(abs_error) || (abs_error > max_abs_budget_ && ulps > max_ulp_budget_)) {
+            if (violations_++ == 0) {
+                first_violation_ = samples_ - 1;
+            }
+        }
+        max_abs_ = std::isnan(abs_error) || abs_error > max_abs_ ? abs_error : max_abs_;
+        max_ulp_ = ulps > max_ulp_ ? ulps : max_ulp_;
+    }
+
+    bool within() const noexcept { return violations_ == 0; }
+    double max_abs_error() const noexcept { return max_abs_; }
+    std::uint32_t max_ulp() const noexcept { return max_ulp_; }
+
+    void record() const {
+        ::testing::Test::RecordProperty(name_ + "_samples", std::to_string(samples_));
+        ::testing::Test::RecordProperty(name_ + "_max_abs_error", format(max_abs_));
+        ::testing::Test::RecordProperty(name_ + "_max_ulp", std::to_string(max_ulp_));
+        ::testing::Test::RecordProperty(name_ + "_abs_budget", format(max_abs_budget_));
+        ::testing::Test::RecordProperty(name_ + "_ulp_budget", std::to_string(max_ulp_budget_));
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const ErrorBudget& b) {
+        os << b.name_ << ": " << b.violations_ << " of " << b.samples_ << " samples over budget";
+        if (b.violations_ != 0) {
+            os << " (first at " << b.first_violation_ << ")";
+        }
+        return os << ", max error " << b.max_abs_ << " / " << b.max_ulp_ << " ulp, budget "
+                  << b.max_abs_budget_ << " / " << b.max_ulp_budget_ << " ulp";
+    }
+
+private:
+    static std::string format(double value) {
+        std::ostringstream os;
+        os.precision(9);
+        os << value;
+        return os.str();
+    }
+
+    std::string name_;
+    double max_abs_budget_;
+    std::uint32_t max_ulp_budget_;
+    std::uint64_t samples_ = 0;
+    std::uint64_t violations_ = 0;
+    std::uint64_t first_violation_ = 0;
+    double max_abs_ = 0.0;
+    std::uint32_t max_ulp_ = 0;
+};
+
+/// The rig's channel mix: quarter-bridge gauges with a few half and full
+/// bridges, different gains and non-zero offsets, so every branch of the
+/// conversion is exercised.
+inline CaptureInfo test_capture_info(std::size_t channels = 8) {
+    CaptureInfo info;
+    info.sample_rate_hz = 1e6;
+    info.start_time_ns = 1'700'000'000'000'000'000ull;
+    for (std::size_t c = 0; c < channels; ++c) {
+        ChannelInfo ch;
+        ch.name = "sg" + std::to_string(c);
+        ch.amplifier_gain = c % 3 == 2 ? 250.0f : 500.0f;
+        ch.gauge_factor = 2.0f + 0.05f * static_cast<float>(c % 4);
+        ch.zero_offset_counts = static_cast<float>(static_cast<int>(c * 7 % 23) - 11);
+        ch.bridge = c % 4 == 3   ? capture::BridgeConfig::Full
+                    : c % 4 == 1 ? capture::BridgeConfig::Half
+                                 : capture::BridgeConfig::Quarter;
+        info.channels.push_back(ch);
+    }
+    return info;
+}
+
+inline std::vector<ConversionParams> conversion_params(const CaptureInfo& info) {
+    std::vector<ConversionParams> params;
+    for (const ChannelInfo& ch : info.channels) {
+        params.push_back(make_conversion_params(ch));
+    }
+    return params;
+}
+
+/// Raw counts of a synthetic recording of @p info's channels. The default
+/// configuration is loud enough to span most of the ADC range of a
+/// quarter bridge at gain 500.
+inline ChannelBuffer<std::int16_t> synthetic_counts(const CaptureInfo& info, std::size_t samples,
+                                                    SyntheticSrmConfig config = {}) {
+    config.strain_channels = info.channels.size();
+    SyntheticSrm srm(config);
+    ChannelBuffer<std::int16_t> counts(info.channels.size(), samples);
+    srm.generate_counts(conversion_params(info), counts.view());
+    return counts;
+}
+
+inline ChannelBuffer<float> synthetic_strain(std::size_t channels, std::size_t samples,
+                                             SyntheticSrmConfig config = {}) {
+    config.strain_channels = channels;
+    SyntheticSrm srm(config);
+    ChannelBuffer<float> strain(channels, samples);
+    srm.generate(strain.view(), {}, {});
+    return strain;
+}
+
+/// A file name in the temporary directory unique to this process and
+/// test, removed again when the object goes out of scope.
+class ScratchFile {
+public:
+    explicit ScratchFile(const std::string& suffix) {
+        const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        path_ = std::filesystem::temp_directory_path() /
+                ("srm_test_" + std::to_string(::getpid()) + "_" + info->test_suite_name() + "_" +
+                 info->name() + suffix);
+    }
+    ~ScratchFile() {
+        std::error_code ignored;
+        std::filesystem::remove(path_, ignored);
+    }
+
+    ScratchFile(const ScratchFile&) = delete;
+    ScratchFile& operator=(const ScratchFile&) = delete;
+
+    const std::filesystem::path& path() const noexcept { return path_; }
+
+private:
+    std::filesystem::path path_;
+};
+
+/// Recorded capture to replay through the golden checks, from
+/// $SRM_TEST_CAPTURE; the lab points it at a rig recording, and the
+/// checks that need one are skipped without it.
+inline std::optional<std::filesystem::path> recorded_capture() {
+    const char* path = std::getenv("SRM_TEST_CAPTURE");
+    if (path == nullptr || *path == '\0') {
+        return std::nullopt;
+    }
+    return std::filesystem::path(path);
+}
+
+}  // namespace srm::test
@@ -0,0 +1,172 @@
+#include "test_common.hpp"
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/strain_conversion.hpp"
+
+namespace srm::test {
+namespace {
+
+constexpr std::array<SimdPath, 4> kPaths = {SimdPath::Scalar, SimdPath::Avx2, SimdPath::Avx512,
+                                            SimdPath::Neon};
+
+/// The conversion straight from the header metadata, in double precision
+/// and without the folding make_conversion_params() does.
+double reference_strain(const ChannelInfo& ch, std::int16_t counts) {
+    const double r = (static_cast<double>(counts) - ch.zero_offset_counts) * ch.volts_per_count /
+                     (static_cast<double>(ch.amplifier_gain) * ch.excitation_volts);
+    switch (ch.bridge) {
+    case capture::BridgeConfig::Quarter:
+        return -4e6 / ch.gauge_factor * r / (1.0 + 2.0 * r);
+    case capture::BridgeConfig::Half:
+        return -2e6 / ch.gauge_factor * r;
+    default:
+        return -1e6 / ch.gauge_factor * r;
+    }
+}
+
+std::vector<std::int16_t> every_count() {
+    std::vector<std::int16_t> counts;
+    for (int c = std::numeric_limits<std::int16_t>::min(); c <= std::numeric_limits<std::int16_t>::max(); ++c) {
+        counts.push_back(static_cast<std::int16_t>(c));
+    }
+    return counts;
+}
+
+// Every vector path must agree with convert_sample() bit for bit on every
+// possible input of every bridge type, including the odd tail lengths.
+TEST(Conversion, VectorPathsMatchScalarExhaustively) {
+    const CaptureInfo info = test_capture_info(4);
+    const std::vector<std::int16_t> counts = every_count();
+    std::vector<float> out(counts.size());
+    for (const SimdPath path : kPaths) {
+        if (!simd_path_supported(path)) {
+            continue;
+        }
+        SCOPED_TRACE(to_string(path));
+        for (const ChannelInfo& ch : info.channels) {
+            const ConversionParams p = make_conversion_params(ch);
+            for (const std::size_t n : {counts.size(), counts.size() - 1, std::size_t{17}, std::size_t{0}}) {
+                convert_channel(path, p, std::span(counts).first(n), std::span(out).first(n));
+                std::size_t mismatches = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    mismatches += ulp_distance(out[i], convert_sample(p, counts[i])) != 0;
+                }
+                EXPECT_EQ(mismatches, 0u) << ch.name << ", " << n << " samples";
+            }
+        }
+    }
+    RecordProperty("best_simd_path", to_string(best_simd_path()));
+}
+
+TEST(Conversion, ScalarWithinBudgetOfDoubleReference) {
+    const CaptureInfo info = test_capture_info(4);
+    const std::vector<std::int16_t> counts = every_count();
+    // Folding the constants into float costs a few rounding steps; 0.01 ue
+    // is far below the gauge noise floor.
+    ErrorBudget budget("scalar_vs_double", 1e-2, 8);
+    for (const ChannelInfo& ch : info.channels) {
+        const ConversionParams p = make_conversion_params(ch);
+        for (const std::int16_t c : counts) {
+            budget.add(reference_strain(ch, c), convert_sample(p, c));
+        }
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+}
+
+TEST(Conversion, BlockMatchesChannelsOfSyntheticSignal) {
+    const CaptureInfo info = test_capture_info(8);
+    const std::vector<ConversionParams> params = conversion_params(info);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 10007);
+    ChannelBuffer<float> out(info.channels.size(), counts.samples());
+    convert_block(params, counts.view(), out.view());
+    ErrorBudget budget("block_vs_double", 1e-2, 8);
+    for (std::size_t c = 0; c < info.channels.size(); ++c) {
+        for (std::size_t i = 0; i < counts.samples(); ++i) {
+            ASSERT_EQ(ulp_distance(out.channel(c)[i], convert_sample(params[c], counts.channel(c)[i])), 0u)
+                << "channel " << c << " sample " << i;
+            budget.add(reference_strain(info.channels[c], counts.channel(c)[i]), out.channel(c)[i]);
+        }
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+}
+
+TEST(Conversion, BlockRejectsShapeMismatch) {
+    const CaptureInfo info = test_capture_info(4);
+    const std::vector<ConversionParams> params = conversion_params(info);
+    const ChannelBuffer<std::int16_t> counts(4, 16);
+    ChannelBuffer<float> out(3, 16);
+    EXPECT_THROW(convert_block(params, counts.view(), out.view()), std::invalid_argument);
+    EXPECT_THROW(convert_block(std::span(params).first(3), counts.view(), ChannelBuffer<float>(4, 16).view()),
+                 std::invalid_argument);
+}
+
+TEST(Conversion, RejectsInvalidMetadata) {
+    ChannelInfo ch;
+    ch.name = "bad";
+    ch.gauge_factor = 0.0f;
+    EXPECT_THROW(make_conversion_params(ch), std::invalid_argument);
+    ch.gauge_factor = 2.0f;
+    ch.amplifier_gain = -1.0f;
+    EXPECT_THROW(make_conversion_params(ch), std::invalid_argument);
+}
+
+// strain_to_counts() is what synthesises raw signals and turns strain
+// limits into counts, so it has to invert the conversion to within the
+// rounding of one count.
+TEST(Conversion, StrainToCountsInvertsConversion) {
+    const CaptureInfo info = test_capture_info(4);
+    for (const ChannelInfo& ch : info.channels) {
+        const ConversionParams p = make_conversion_params(ch);
+        const double ue_per_count = std::fabs(reference_strain(ch, 1) - reference_strain(ch, 0));
+        for (double ue = -3000.0; ue <= 3000.0; ue += 37.5) {
+            const double counts = strain_to_counts(p, ue);
+            if (std::fabs(counts) > 32767.0) {
+                continue;  // beyond this channel's ADC range
+            }
+            const auto rounded = static_cast<std::int16_t>(std::lround(counts));
+            EXPECT_NEAR(convert_sample(p, rounded), ue, 0.6 * ue_per_count) << ch.name;
+        }
+    }
+}
+
+TEST(Conversion, RecordedCaptureWithinBudget) {
+    const std::optional<std::filesystem::path> path = recorded_capture();
+    if (!path) {
+        GTEST_SKIP() << "set SRM_TEST_CAPTURE to a rig recording to replay it";
+    }
+    const CaptureReader reader(*path);
+    std::vector<ConversionParams> params;
+    for (const ChannelInfo& ch : reader.info().channels) {
+        params.push_back(make_conversion_params(ch));
+    }
+    ErrorBudget budget("recorded_vs_double", 1e-2, 8);
+    std::vector<std::int16_t> counts;
+    std::vector<float> out;
+    std::vector<float> scalar;
+    for (std::size_t k = 0; k < reader.chunk_count(); ++k) {
+        counts.resize(reader.chunks()[k].sample_count);
+        out.resize(counts.size());
+        scalar.resize(counts.size());
+        for (std::size_t c = 0; c < reader.channel_count(); ++c) {
+            reader.read_channel(k, c, counts);
+            convert_channel(SimdPath::Scalar, params[c], counts, scalar);
+            convert_channel(params[c], counts, out);
+            for (std::size_t i = 0; i < counts.size(); ++i) {
+                ASSERT_EQ(ulp_distance(out[i], scalar[i]), 0u) << "chunk " << k << " channel " << c;
+                budget.add(reference_strain(reader.info().channels[c], counts[i]), out[i]);
+            }
+        }
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+}
+
+}  // namespace
+}  // namespace srm::test
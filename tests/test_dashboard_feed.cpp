@@ -0,0 +1,191 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "srm/dashboard_feed.hpp"
+
+namespace srm::test {
+namespace {
+
+/// Every sample of waveform point @p point on channel @p channel: a
+/// torn or misplaced point cannot pass for another.
+float point_value(std::uint64_t point, std::size_t channel) {
+    return static_cast<float>((point % 4096) * 8 + channel);
+}
+
+TEST(DashboardFeed, WaveformMatchesReference) {
+    const ScratchFile file(".srmdash");
+    const std::size_t channels = 3;
+    const DashboardConfig config{.samples_per_point = 100, .waveform_points = 50, .spectrum_points = 16};
+    DashboardPublisher publisher(file.path(), channels, 1e5, config);
+    const DashboardReader reader(file.path());
+    EXPECT_EQ(reader.channels(), channels);
+    EXPECT_EQ(reader.samples_per_point(), 100u);
+    EXPECT_EQ(reader.waveform_capacity(), 100u);
+    EXPECT_EQ(reader.sample_rate_hz(), 1e5);
+
+    WaveformWindow window;
+    EXPECT_EQ(reader.read_waveform(10, window), 0u);
+
+    // Uneven blocks, so points straddle them.
+    const std::size_t total = 20'000;
+    const ChannelBuffer<float> strain = synthetic_strain(channels, total);
+    for (std::size_t pos = 0; pos < total;) {
+        const std::size_t n = std::min<std::size_t>(337, total - pos);
+        publisher.add_waveform(strain.view().subblock(pos, n));
+        pos += n;
+    }
+    EXPECT_EQ(publisher.points_published(), 200u);
+
+    ASSERT_EQ(reader.read_waveform(50, window), 50u);
+    EXPECT_EQ(window.first_point, 150u);
+    ErrorBudget budget("dashboard_waveform_mean", 1e-3, 64);
+    for (std::size_t p = 0; p < window.points; ++p) {
+        for (std::size_t c = 0; c < channels; ++c) {
+            const std::span<const float> x = strain.channel(c).subspan((window.first_point + p) * 100, 100);
+            EXPECT_EQ(window.at(p, c).min, *std::min_element(x.begin(), x.end()));
+            EXPECT_EQ(window.at(p, c).max, *std::max_element(x.begin(), x.end()));
+            double sum = 0.0;
+            for (const float v : x) {
+                sum += v;
+            }
+            budget.add(sum / 100.0, window.at(p, c).mean);
+        }
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+    // Never more than the ring holds.
+    EXPECT_EQ(reader.read_waveform(1000, window), 100u);
+    EXPECT_EQ(window.first_point, 100u);
+
+    const ChannelBuffer<float> two(2, 10);
+    EXPECT_THROW(publisher.add_waveform(two.view()), std::invalid_argument);
+}
+
+TEST(DashboardFeed, SpectrumAndStatisticsSnapshots) {
+    const ScratchFile file(".srmdash");
+    const std::size_t channels = 2;
+    DashboardPublisher publisher(file.path(), channels, 1e5, {.spectrum_points = 100});
+    const DashboardReader reader(file.path());
+    SpectrumSnapshot snapshot;
+    std::vector<ChannelStatistics> summaries;
+    EXPECT_FALSE(reader.read_spectrum(snapshot));
+    EXPECT_FALSE(reader.read_statistics(summaries));
+
+    SpectrumConfig config;
+    config.frame_size = 1024;
+    config.hop = 512;
+    SlidingSpectrum spectrum(config, channels);
+    const ChannelBuffer<float> strain = synthetic_strain(channels, 4096);
+    std::vector<float> last;
+    std::uint64_t last_index = 0;
+    spectrum.push(strain.view(), [&](const SpectrumFrame& frame) {
+        publisher.publish_spectrum(frame);
+        last.assign(frame.amplitude.channel(1).begin(), frame.amplitude.channel(1).end());
+        last_index = frame.index;
+    });
+    ASSERT_TRUE(reader.read_spectrum(snapshot));
+    EXPECT_EQ(snapshot.frame_index, last_index);
+    EXPECT_EQ(snapshot.source_bins, 513u);
+    EXPECT_EQ(snapshot.bins_per_point, 6u);
+    EXPECT_EQ(snapshot.points, 86u);
+    for (std::size_t p = 0; p < snapshot.points; ++p) {
+        const auto begin = last.begin() + static_cast<std::ptrdiff_t>(p * 6);
+        const auto end = last.begin() + static_cast<std::ptrdiff_t>(std::min<std::size_t>(last.size(), p * 6 + 6));
+        EXPECT_EQ(snapshot.channel(1)[p], *std::max_element(begin, end));
+    }
+
+    StrainStatistics statistics(channels);
+    statistics.add(strain.view());
+    publisher.publish_statistics(statistics);
+    ASSERT_TRUE(reader.read_statistics(summaries));
+    ASSERT_EQ(summaries.size(), channels);
+    for (std::size_t c = 0; c < channels; ++c) {
+        EXPECT_EQ(summaries[c].count, 4096u);
+        EXPECT_EQ(summaries[c].rms, statistics.summary(c).rms);
+        EXPECT_EQ(summaries[c].p99, statistics.summary(c).p99);
+    }
+    EXPECT_THROW(publisher.publish_statistics(StrainStatistics(3)), std::invalid_argument);
+}
+
+TEST(DashboardFeed, ReadersNeverSeeTornData) {
+    const ScratchFile file(".srmdash");
+    const std::size_t channels = 8;
+    const std::size_t spp = 64;  // a power of two keeps the means exact
+    const DashboardConfig config{.samples_per_point = spp, .waveform_points = 64, .spectrum_points = 8};
+    DashboardPublisher publisher(file.path(), channels, 1e6, config);
+
+    std::atomic<bool> done{false};
+    std::atomic<std::uint64_t> reads{0};
+    std::atomic<std::uint64_t> bad{0};
+    std::thread viewer([&] {
+        const DashboardReader reader(file.path());
+        WaveformWindow window;
+        while (!done.load(std::memory_order_acquire)) {
+            reader.read_waveform(64, window);
+            for (std::size_t p = 0; p < window.points; ++p) {
+                for (std::size_t c = 0; c < channels; ++c) {
+                    const float expected = point_value(window.first_point + p, c);
+                    const WaveformPoint& w = window.at(p, c);
+                    bad.fetch_add(w.min != expected || w.max != expected || w.mean != expected,
+                                  std::memory_order_relaxed);
+                }
+            }
+            reads.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+    });
+
+    // Blocks of 3.5 points, so points straddle blocks and every block
+    // laps part of what the viewer may be copying.
+    const std::size_t block = spp * 7 / 2;
+    ChannelBuffer<float> strain(channels, block);
+    std::uint64_t sample = 0;
+    for (int b = 0; b < 4000 || reads.load(std::memory_order_relaxed) < 50; ++b) {
+        for (std::size_t c = 0; c < channels; ++c) {
+            for (std::size_t i = 0; i < block; ++i) {
+                strain.channel(c)[i] = point_value((sample + i) / spp, c);
+            }
+        }
+        publisher.add_waveform(std::as_const(strain).view());
+        sample += block;
+    }
+    done.store(true, std::memory_order_release);
+    viewer.join();
+    EXPECT_EQ(bad.load(), 0u);
+    RecordProperty("dashboard_concurrent_reads", std::to_string(reads.load()));
+}
+
+TEST(DashboardFeed, ClosedAndReplacedFeeds) {
+    const ScratchFile file(".srmdash");
+    auto publisher = std::make_unique<DashboardPublisher>(file.path(), 2, 1e5);
+    const DashboardReader old_reader(file.path());
+    EXPECT_FALSE(old_reader.closed());
+    publisher.reset();
+    EXPECT_TRUE(old_reader.closed());
+
+    // The next run's feed is a new file; the old viewer keeps its mapping.
+    publisher = std::make_unique<DashboardPublisher>(file.path(), 4, 1e5);
+    EXPECT_TRUE(old_reader.closed());
+    EXPECT_EQ(old_reader.channels(), 2u);
+    const DashboardReader reader(file.path());
+    EXPECT_FALSE(reader.closed());
+    EXPECT_EQ(reader.channels(), 4u);
+
+    const ScratchFile other(".bin");
+    std::ofstream(other.path()) << std::string(4096, 'x');
+    EXPECT_THROW(DashboardReader{other.path()}, std::runtime_error);
+    EXPECT_THROW(DashboardPublisher(file.path(), 0, 1e5), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace srm::test
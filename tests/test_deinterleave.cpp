@@ -0,0 +1,119 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "srm/deinterleave.hpp"
+
+namespace srm::test {
+namespace {
+
+constexpr std::array<SimdPath, 4> kPaths = {SimdPath::Scalar, SimdPath::Avx2, SimdPath::Avx512,
+                                            SimdPath::Neon};
+
+/// Frames whose every value encodes its channel and sample, so a misplaced
+/// value names where it came from.
+std::vector<std::int16_t> numbered_frames(std::size_t channels, std::size_t samples) {
+    std::vector<std::int16_t> frames(channels * samples);
+    for (std::size_t i = 0; i < samples; ++i) {
+        for (std::size_t c = 0; c < channels; ++c) {
+            frames[i * channels + c] = static_cast<std::int16_t>((i * 37 + c * 1009) % 65536 - 32768);
+        }
+    }
+    return frames;
+}
+
+// Every path must give the scalar transpose for the shuffle channel counts
+// (4, 8, 16, 24) and the fallbacks, with tails of every length, into padded
+// channels whose padding stays untouched.
+TEST(Deinterleave, VectorPathsMatchScalar) {
+    constexpr std::int16_t kGuard = 0x5a5a;
+    for (const SimdPath path : kPaths) {
+        if (!simd_path_supported(path)) {
+            continue;
+        }
+        SCOPED_TRACE(to_string(path));
+        for (const std::size_t channels : {1, 3, 4, 6, 8, 12, 16, 24}) {
+            for (const std::size_t samples : {0, 1, 7, 15, 16, 17, 33, 1000}) {
+                const std::vector<std::int16_t> frames = numbered_frames(channels, samples);
+                ChannelBuffer<std::int16_t> out(channels, samples + 3);
+                for (std::size_t c = 0; c < channels; ++c) {
+                    std::fill(out.channel(c).begin(), out.channel(c).end(), kGuard);
+                }
+                deinterleave(path, frames, out.view().subblock(0, samples));
+                std::size_t mismatches = 0;
+                for (std::size_t c = 0; c < channels; ++c) {
+                    for (std::size_t i = 0; i < samples; ++i) {
+                        mismatches += out.channel(c)[i] != frames[i * channels + c];
+                    }
+                    for (std::size_t i = samples; i < samples + 3; ++i) {
+                        mismatches += out.channel(c)[i] != kGuard;
+                    }
+                }
+                EXPECT_EQ(mismatches, 0u) << channels << " channels, " << samples << " samples";
+            }
+        }
+    }
+
+    ChannelBuffer<std::int16_t> out(8, 16);
+    const std::vector<std::int16_t> short_frames = numbered_frames(8, 15);
+    EXPECT_THROW(deinterleave(short_frames, out.view()), std::invalid_argument);
+}
+
+TEST(Deinterleave, TilesCoverTheStreamInOrder) {
+    EXPECT_EQ(tile_samples(8), 512u);
+    EXPECT_EQ(tile_samples(16), 256u);
+    EXPECT_EQ(tile_samples(4, 2048), 256u);
+    EXPECT_EQ(tile_samples(200), 32u);  // never below one cache line
+    EXPECT_THROW(TileDeinterleaver(0), std::invalid_argument);
+
+    constexpr std::size_t kChannels = 16;
+    const std::size_t samples = 5000;
+    const std::vector<std::int16_t> frames = numbered_frames(kChannels, samples);
+    TileDeinterleaver tiler(kChannels);
+    ASSERT_EQ(tiler.tile_samples(), 256u);
+
+    ChannelBuffer<std::int16_t> joined(kChannels, samples);
+    std::uint64_t expected_first = 1000;
+    std::size_t tiles = 0;
+    bool aligned = true;
+    // Fed in two uneven pieces, as DMA blocks arrive.
+    const std::size_t split = 1234;
+    for (const auto& [begin, count] : {std::pair<std::size_t, std::size_t>{0, split},
+                                       std::pair<std::size_t, std::size_t>{split, samples - split}}) {
+        const std::size_t consumed = tiler.process(
+            std::span(frames).subspan(begin * kChannels, count * kChannels), 1000 + begin,
+            [&](ChannelBlock<const std::int16_t> tile, std::uint64_t first) {
+                EXPECT_EQ(first, expected_first);
+                EXPECT_LE(tile.samples(), tiler.tile_samples());
+                for (std::size_t c = 0; c < kChannels; ++c) {
+                    aligned &= reinterpret_cast<std::uintptr_t>(tile.channel(c).data()) % kCacheLineSize == 0;
+                    std::copy(tile.channel(c).begin(), tile.channel(c).end(),
+                              joined.channel(c).begin() + static_cast<std::ptrdiff_t>(first - 1000));
+                }
+                expected_first += tile.samples();
+                ++tiles;
+            });
+        EXPECT_EQ(consumed, count);
+    }
+    EXPECT_TRUE(aligned);
+    EXPECT_EQ(expected_first, 1000 + samples);
+    EXPECT_EQ(tiles, (split + 255) / 256 + (samples - split + 255) / 256);
+    std::size_t mismatches = 0;
+    for (std::size_t c = 0; c < kChannels; ++c) {
+        for (std::size_t i = 0; i < samples; ++i) {
+            mismatches += joined.channel(c)[i] != frames[i * kChannels + c];
+        }
+    }
+    EXPECT_EQ(mismatches, 0u);
+
+    EXPECT_THROW(tiler.process(std::span(frames).first(kChannels + 1), 0, [](auto, auto) {}),
+                 std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace srm::test
@@ -0,0 +1,172 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "srm/field_reconstruction.hpp"
+
+namespace srm::test {
+namespace {
+
+constexpr std::size_t kRingPoints = 360;
+
+/// Point gauges at the given ring angles (degrees, whole ring points).
+std::vector<GaugePlacement> gauges_at(std::initializer_list<std::size_t> degrees) {
+    std::vector<GaugePlacement> gauges;
+    for (const std::size_t d : degrees) {
+        gauges.push_back({"SG@" + std::to_string(d), {{d * kRingPoints / 360, 1.0}}});
+    }
+    return gauges;
+}
+
+/// Field = sum of basis modes weighted by time-varying coordinates, and the
+/// gauge readings it gives.
+struct Scenario {
+    ChannelBuffer<float> field;
+    ChannelBuffer<float> readings;
+
+    Scenario(const ModalBasis& basis, std::span<const GaugePlacement> gauges, std::size_t samples)
+        : field(basis.outputs(), samples), readings(gauges.size(), samples) {
+        for (std::size_t i = 0; i < samples; ++i) {
+            for (std::size_t o = 0; o < basis.outputs(); ++o) {
+                double value = 0.0;
+                for (std::size_t k = 0; k < basis.modes(); ++k) {
+                    const double coordinate = 100.0 * std::sin(0.01 * static_cast<double>((k + 1) * i) + k);
+                    value += coordinate * basis.mode(k)[o];
+                }
+                field.channel(o)[i] = static_cast<float>(value);
+            }
+            for (std::size_t g = 0; g < gauges.size(); ++g) {
+                double value = 0.0;
+                for (const GaugeTerm& term : gauges[g].terms) {
+                    value += term.weight * field.channel(term.output)[i];
+                }
+                readings.channel(g)[i] = static_cast<float>(value);
+            }
+        }
+    }
+};
+
+TEST(FieldReconstruction, RecoversFieldsInTheBasis) {
+    // Ovalisation up to the triangular mode from nine irregular gauges, one
+    // of them a grid averaged over three nodes.
+    const ModalBasis basis = ModalBasis::thin_ring(kRingPoints, 3);
+    ASSERT_EQ(basis.modes(), 7u);
+    std::vector<GaugePlacement> gauges = gauges_at({0, 35, 80, 130, 170, 200, 250, 290, 330});
+    gauges[4].terms = {{169, 1.0 / 3.0}, {170, 1.0 / 3.0}, {171, 1.0 / 3.0}};
+    const FieldReconstructor reconstructor(basis, gauges);
+    EXPECT_EQ(reconstructor.gauges(), 9u);
+    EXPECT_EQ(reconstructor.outputs(), kRingPoints);
+    EXPECT_LT(reconstructor.condition_estimate(), 10.0);
+    RecordProperty("field_condition_estimate", std::to_string(reconstructor.condition_estimate()));
+
+    // Odd sample count: whole blocks of the kernel plus a tail.
+    const std::size_t samples = 1000;
+    const Scenario scenario(basis, gauges, samples);
+    ChannelBuffer<float> field(kRingPoints, samples);
+    reconstructor.reconstruct(scenario.readings.view(), field.view());
+    ErrorBudget budget("field_reconstruction_ue", 2e-3);
+    for (std::size_t o = 0; o < kRingPoints; ++o) {
+        for (std::size_t i = 0; i < samples; ++i) {
+            budget.add(scenario.field.channel(o)[i], field.channel(o)[i]);
+        }
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+
+    // The product against a double-precision one of the same matrix.
+    const std::span<const float> r = reconstructor.matrix();
+    ASSERT_EQ(r.size(), kRingPoints * gauges.size());
+    std::size_t mismatches = 0;
+    for (std::size_t o = 0; o < kRingPoints; o += 7) {
+        for (std::size_t i = 0; i < samples; i += 13) {
+            double expected = 0.0;
+            for (std::size_t g = 0; g < gauges.size(); ++g) {
+                expected += static_cast<double>(r[o * gauges.size() + g]) * scenario.readings.channel(g)[i];
+            }
+            mismatches += std::fabs(expected - field.channel(o)[i]) > 1e-3;
+        }
+    }
+    EXPECT_EQ(mismatches, 0u);
+
+    EXPECT_THROW(reconstructor.reconstruct(scenario.readings.view(), field.view().subblock(0, 999)),
+                 std::invalid_argument);
+}
+
+TEST(FieldReconstruction, SnapshotBasisKeepsTheLoadCases) {
+    // Forty FE load cases that are combinations of four ring modes: POD
+    // finds exactly four modes carrying all the energy.
+    const ModalBasis ring = ModalBasis::thin_ring(kRingPoints, 2);
+    std::vector<double> snapshots;
+    for (std::size_t s = 0; s < 40; ++s) {
+        for (std::size_t o = 0; o < kRingPoints; ++o) {
+            snapshots.push_back(50.0 * std::cos(0.3 * s) * ring.mode(1)[o] + 20.0 * ring.mode(0)[o] +
+                                (5.0 + s) * ring.mode(3)[o] + 3.0 * std::sin(1.7 * s) * ring.mode(4)[o]);
+        }
+    }
+    const ModalBasis pod = ModalBasis::from_snapshots(snapshots, kRingPoints, 10);
+    ASSERT_EQ(pod.modes(), 4u);
+    ASSERT_EQ(pod.cumulative_energy().size(), 4u);
+    EXPECT_NEAR(pod.cumulative_energy().back(), 1.0, 1e-9);
+    for (std::size_t k = 0; k < pod.modes(); ++k) {
+        double norm = 0.0;
+        for (const double x : pod.mode(k)) {
+            norm += x * x;
+        }
+        EXPECT_NEAR(norm, 1.0, 1e-9);
+    }
+    EXPECT_EQ(ModalBasis::from_snapshots(snapshots, kRingPoints, 2).modes(), 2u);
+
+    // Snapshot fields come back exactly from six gauges.
+    const std::vector<GaugePlacement> gauges = gauges_at({10, 70, 150, 200, 260, 320});
+    const FieldReconstructor reconstructor(pod, gauges);
+    ChannelBuffer<float> readings(gauges.size(), 40);
+    for (std::size_t s = 0; s < 40; ++s) {
+        for (std::size_t g = 0; g < gauges.size(); ++g) {
+            readings.channel(g)[s] = static_cast<float>(snapshots[s * kRingPoints + gauges[g].terms[0].output]);
+        }
+    }
+    ChannelBuffer<float> field(kRingPoints, 40);
+    reconstructor.reconstruct(readings.view(), field.view());
+    double worst = 0.0;
+    for (std::size_t s = 0; s < 40; ++s) {
+        for (std::size_t o = 0; o < kRingPoints; ++o) {
+            worst = std::max(worst, std::fabs(field.channel(o)[s] - snapshots[s * kRingPoints + o]));
+        }
+    }
+    EXPECT_LT(worst, 1e-3);
+}
+
+TEST(FieldReconstruction, LayoutErrors) {
+    const ModalBasis basis = ModalBasis::thin_ring(kRingPoints, 2);  // 5 modes
+    EXPECT_THROW(FieldReconstructor(basis, gauges_at({0, 90, 180, 270})), std::invalid_argument);
+    EXPECT_THROW(FieldReconstructor(basis, gauges_at({})), std::invalid_argument);
+    std::vector<GaugePlacement> outside = gauges_at({0, 60, 120, 180, 240, 300});
+    outside[2].terms[0].output = kRingPoints;
+    EXPECT_THROW(FieldReconstructor(basis, outside), std::invalid_argument);
+
+    // sin 2theta vanishes at every gauge of this layout.
+    const std::vector<GaugePlacement> blind = gauges_at({0, 90, 180, 270, 0, 180});
+    EXPECT_THROW(FieldReconstructor(basis, blind), std::runtime_error);
+    // Regularised, the blind mode simply gets no share of the readings.
+    const FieldReconstructor ridge(basis, blind, {.regularisation = 1e-6});
+    const FieldReconstructor under(basis, gauges_at({0, 90, 180, 270}), {.regularisation = 1e-6});
+    EXPECT_EQ(under.modes(), 5u);
+    const Scenario scenario(basis, blind, 64);
+    ChannelBuffer<float> field(kRingPoints, 64);
+    ridge.reconstruct(scenario.readings.view(), field.view());
+    for (std::size_t i = 0; i < 64; ++i) {
+        EXPECT_NEAR(field.channel(0)[i], scenario.field.channel(0)[i], 1e-2);
+    }
+
+    EXPECT_THROW(ModalBasis(10, std::vector<double>(15, 1.0)), std::invalid_argument);
+    EXPECT_THROW(ModalBasis::thin_ring(6, 3), std::invalid_argument);
+    EXPECT_THROW(ModalBasis::from_snapshots(std::vector<double>(20, 0.0), 10, 4), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace srm::test
@@ -0,0 +1,304 @@
+#include "test_common.hpp"
+
+#include <array>
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "srm/decimator.hpp"
+#include "srm/fft.hpp"
+#include "srm/filter_design.hpp"
+#include "srm/harmonic_notch.hpp"
+#include "srm/synthetic.hpp"
+
+namespace srm::test {
+namespace {
+
+/// y[m] = sum_t taps[t] x[m * factor - t], with x zero before the start:
+/// what FirDecimator and HalfbandDecimator compute, in double precision.
+std::vector<double> reference_decimate(std::span<const float> taps, unsigned factor,
+                                       std::span<const float> x) {
+    std::vector<double> y;
+    for (std::size_t n = 0; n < x.size(); n += factor) {
+        double acc = 0.0;
+        for (std::size_t t = 0; t < taps.size() && t <= n; ++t) {
+            acc += static_cast<double>(taps[t]) * x[n - t];
+        }
+        y.push_back(acc);
+    }
+    return y;
+}
+
+/// Runs @p filter over @p in in blocks of the given lengths (cycled) and
+/// returns everything it produced.
+template <typename Filter, typename Block>
+ChannelBuffer<float> run_in_blocks(Filter& filter, Block in, unsigned factor,
+                                   std::span<const std::size_t> lengths) {
+    ChannelBuffer<float> out(in.channels(), in.samples() / factor + lengths.size() + 1);
+    ChannelBuffer<float> piece(in.channels(), in.samples() / factor + 1);
+    std::size_t produced = 0;
+    std::size_t which = 0;
+    for (std::size_t pos = 0; pos < in.samples(); ++which) {
+        const std::size_t n = std::min(lengths[which % lengths.size()], in.samples() - pos);
+        const std::size_t k = filter.process(in.subblock(pos, n), piece.view());
+        for (std::size_t c = 0; c < in.channels(); ++c) {
+            std::copy_n(piece.channel(c).begin(), k, out.channel(c).begin() + static_cast<std::ptrdiff_t>(produced));
+        }
+        produced += k;
+        pos += n;
+    }
+    ChannelBuffer<float> trimmed(in.channels(), produced);
+    for (std::size_t c = 0; c < in.channels(); ++c) {
+        std::copy_n(out.channel(c).begin(), produced, trimmed.channel(c).begin());
+    }
+    return trimmed;
+}
+
+void expect_identical(const ChannelBuffer<float>& a, const ChannelBuffer<float>& b) {
+    ASSERT_EQ(a.channels(), b.channels());
+    ASSERT_EQ(a.samples(), b.samples());
+    for (std::size_t c = 0; c < a.channels(); ++c) {
+        for (std::size_t i = 0; i < a.samples(); ++i) {
+            ASSERT_EQ(ulp_distance(a.channel(c)[i], b.channel(c)[i]), 0u) << "channel " << c << " sample " << i;
+        }
+    }
+}
+
+constexpr std::size_t kOddBlocks[] = {1, 7, 64, 333, 4096, 2};
+
+TEST(Fft, MatchesDoubleDft) {
+    const ChannelBuffer<float> strain = synthetic_strain(1, 4096);
+    for (const std::size_t size : {std::size_t{8}, std::size_t{64}, std::size_t{1024}}) {
+        const FftPlan plan(size);
+        std::vector<std::complex<float>> out(plan.bins());
+        std::vector<std::complex<float>> scratch(plan.scratch_size());
+        const float* x = strain.channel(0).data();
+        plan.forward(x, out.data(), scratch.data());
+        double energy = 0.0;
+        for (std::size_t i = 0; i < size; ++i) {
+            energy += double(x[i]) * x[i];
+        }
+        // Radix-2 error grows with log2(N) relative to the signal's RMS
+        // spectral magnitude sqrt(N * energy).
+        const double scale = std::sqrt(energy * static_cast<double>(size));
+        ErrorBudget re("fft_" + std::to_string(size) + "_re", 2e-6 * scale);
+        ErrorBudget im("fft_" + std::to_string(size) + "_im", 2e-6 * scale);
+        for (std::size_t k = 0; k < plan.bins(); ++k) {
+            std::complex<double> acc = 0.0;
+            for (std::size_t n = 0; n < size; ++n) {
+                const double w = -2.0 * std::numbers::pi * static_cast<double>(k * n % size) / static_cast<double>(size);
+                acc += double(x[n]) * std::complex<double>(std::cos(w), std::sin(w));
+            }
+            re.add(acc.real(), out[k].real());
+            im.add(acc.imag(), out[k].imag());
+        }
+        re.record();
+        im.record();
+        EXPECT_TRUE(re.within()) << re;
+        EXPECT_TRUE(im.within()) << im;
+    }
+}
+
+TEST(FirDecimator, MatchesDoubleReferenceInAnyBlocking) {
+    const ChannelBuffer<float> strain = synthetic_strain(3, 20000);
+    FirDecimator whole(kCicComp8, 2, strain.channels(), 8192);
+    FirDecimator pieces(kCicComp8, 2, strain.channels(), 100);
+    const ChannelBuffer<float> a = run_in_blocks(whole, strain.view(), 2, std::array{strain.samples()});
+    const ChannelBuffer<float> b = run_in_blocks(pieces, strain.view(), 2, kOddBlocks);
+    expect_identical(a, b);
+    ErrorBudget budget("fir_vs_double", 1e-3, 64);
+    for (std::size_t c = 0; c < strain.channels(); ++c) {
+        const std::vector<double> ref = reference_decimate(kCicComp8, 2, strain.channel(c));
+        ASSERT_EQ(ref.size(), a.samples());
+        for (std::size_t i = 0; i < ref.size(); ++i) {
+            budget.add(ref[i], a.channel(c)[i]);
+        }
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+}
+
+TEST(HalfbandDecimator, MatchesDoubleReferenceInAnyBlocking) {
+    const ChannelBuffer<float> strain = synthetic_strain(2, 20001);
+    HalfbandDecimator whole(kHalfband31, strain.channels(), 8192);
+    HalfbandDecimator pieces(kHalfband31, strain.channels(), 50);
+    const ChannelBuffer<float> a = run_in_blocks(whole, strain.view(), 2, std::array{strain.samples()});
+    const ChannelBuffer<float> b = run_in_blocks(pieces, strain.view(), 2, kOddBlocks);
+    expect_identical(a, b);
+    ErrorBudget budget("halfband_vs_double", 1e-3, 64);
+    for (std::size_t c = 0; c < strain.channels(); ++c) {
+        const std::vector<double> ref = reference_decimate(kHalfband31, 2, strain.channel(c));
+        ASSERT_EQ(ref.size(), a.samples());
+        for (std::size_t i = 0; i < ref.size(); ++i) {
+            budget.add(ref[i], a.channel(c)[i]);
+        }
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+}
+
+// The CIC runs in wrapping integers: a constant settles to exactly the
+// constant, and blocking cannot change a single output bit.
+TEST(CicDecimator, ExactAndBlockingInvariant) {
+    const CaptureInfo info = test_capture_info(3);
+    ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 40000);
+    std::fill(counts.channel(2).begin(), counts.channel(2).end(), std::int16_t{-4321});
+    CicDecimator whole(8, 4, counts.channels());
+    CicDecimator pieces(8, 4, counts.channels());
+    const ChannelBuffer<float> a = run_in_blocks(whole, counts.view(), 8, std::array{counts.samples()});
+    const ChannelBuffer<float> b = run_in_blocks(pieces, counts.view(), 8, kOddBlocks);
+    expect_identical(a, b);
+    for (std::size_t i = 4; i < a.samples(); ++i) {
+        ASSERT_EQ(a.channel(2)[i], -4321.0f) << "sample " << i;
+    }
+}
+
+TEST(DecimationChain, BlockingInvariant) {
+    const CaptureInfo info = test_capture_info(4);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 65536);
+    DecimationChainConfig config;
+    DecimationChain whole(config, counts.channels());
+    config.max_block = 512;
+    DecimationChain pieces(config, counts.channels());
+    const ChannelBuffer<float> a = run_in_blocks(whole, counts.view(), whole.factor(), std::array{counts.samples()});
+    const ChannelBuffer<float> b = run_in_blocks(pieces, counts.view(), pieces.factor(), kOddBlocks);
+    expect_identical(a, b);
+    EXPECT_GE(a.samples(), counts.samples() / whole.factor() - 1);
+}
+
+TEST(DecimationChain, ChannelCountMustMatch) {
+    const CaptureInfo info = test_capture_info(4);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 4096);
+    DecimationChain chain(DecimationChainConfig{}, counts.channels());
+    const std::size_t room = chain.max_output(counts.samples());
+    ChannelBuffer<float> out(counts.channels(), room);
+    ChannelBuffer<float> wide(counts.channels() + 1, room);
+    ChannelBuffer<float> narrow(counts.channels() - 1, room);
+    const ChannelBlock<const std::int16_t> in = counts.view();
+    const ChannelBlock<const std::int16_t> fewer(in.data(), in.channels() - 1, in.samples(), in.stride());
+    EXPECT_THROW(chain.process(fewer, narrow.view()), std::invalid_argument);
+    EXPECT_THROW(chain.process(in, wide.view()), std::invalid_argument);
+    EXPECT_THROW(chain.process(in, narrow.view()), std::invalid_argument);
+    EXPECT_GT(chain.process(in, out.view()), 0u);
+}
+
+double rms(std::span<const float> x) {
+    double sum = 0.0;
+    for (const float v : x) {
+        sum += double(v) * v;
+    }
+    return std::sqrt(sum / static_cast<double>(x.size()));
+}
+
+// At steady speed the stroke harmonics and the PWM carrier must come out
+// at least 60 dB down while a tone between the notches passes.
+TEST(HarmonicNotch, AttenuatesTrackedHarmonicsAndPassesTheRest) {
+    const double fs = 1e6;
+    const double rev_per_s = 50.0;
+    HarmonicNotchConfig config;
+    config.sample_rate_hz = fs;
+    const std::size_t n = 200000;
+    const std::size_t block = 4096;
+    // Channels 0-3: stroke harmonics 1-4, channel 4: PWM, channel 5: pass tone.
+    const std::vector<double> tones = {1200.0, 2400.0, 3600.0, 4800.0, 20e3, 1800.0};
+    ChannelBuffer<float> in(tones.size(), n);
+    for (std::size_t c = 0; c < tones.size(); ++c) {
+        for (std::size_t i = 0; i < n; ++i) {
+            in.channel(c)[i] = static_cast<float>(
+                100.0 * std::sin(2.0 * std::numbers::pi * tones[c] * static_cast<double>(i) / fs));
+        }
+    }
+    HarmonicNotch notch(config, tones.size());
+    ChannelBuffer<float> out(tones.size(), n);
+    for (std::size_t pos = 0; pos < n; pos += block) {
+        const std::size_t len = std::min(block, n - pos);
+        notch.process(in.view().subblock(pos, len), out.view().subblock(pos, len), rev_per_s);
+    }
+    for (std::size_t c = 0; c < tones.size(); ++c) {
+        const double gain_db = 20.0 * std::log10(rms(out.channel(c).subspan(n / 2)) / rms(in.channel(c).subspan(n / 2)));
+        RecordProperty("notch_gain_db_" + std::to_string(static_cast<int>(tones[c])), std::to_string(gain_db));
+        if (c + 1 < tones.size()) {
+            EXPECT_LT(gain_db, -60.0) << tones[c] << " Hz";
+        } else {
+            EXPECT_NEAR(gain_db, 0.0, 0.5) << tones[c] << " Hz";
+        }
+    }
+}
+
+/// Encoder positions of a synthetic run, with the true speed in rev/s at
+/// each sample.
+struct EncoderRun {
+    EncoderRun(const SyntheticSrmConfig& config, std::size_t samples)
+        : position(samples), rev_per_s(samples) {
+        SyntheticSrmConfig one = config;
+        one.strain_channels = 1;
+        SyntheticSrm srm(one);
+        ChannelBuffer<float> strain(1, samples);
+        srm.generate(strain.view(), position, {});
+        for (std::size_t i = 0; i < samples; ++i) {
+            const double t = static_cast<double>(i) / config.sample_rate_hz;
+            rev_per_s[i] = (config.speed_rpm + config.accel_rpm_per_s * t) / 60.0;
+        }
+    }
+
+    std::vector<float> position;
+    std::vector<double> rev_per_s;
+};
+
+// Unsmoothed, the estimate tracks a steady speed and a ramp, forwards or
+// backwards, to the last sample of each block, however the encoder wraps.
+TEST(SpeedEstimator, TracksTheSyntheticSpeed) {
+    EXPECT_THROW(SpeedEstimator(0.0, 1e6), std::invalid_argument);
+    EXPECT_THROW(SpeedEstimator(4096.0, -1.0), std::invalid_argument);
+    EXPECT_THROW(SpeedEstimator(4096.0, 1e6, -0.1), std::invalid_argument);
+
+    const std::size_t n = 400'000;
+    for (const auto& [rpm, accel] : {std::pair{3000.0, 0.0}, std::pair{600.0, 20'000.0}, std::pair{-1500.0, -8000.0}}) {
+        SyntheticSrmConfig config;
+        config.speed_rpm = rpm;
+        config.accel_rpm_per_s = accel;
+        const EncoderRun run(config, n);
+        SpeedEstimator estimator(config.encoder_counts_per_rev, config.sample_rate_hz);
+        EXPECT_EQ(estimator.update({}), 0.0);
+        ErrorBudget budget("speed_estimator_" + std::to_string(static_cast<int>(rpm)) + "rpm", 1e-3);
+        // Uneven blocks, the first a single sample that only primes it.
+        std::size_t pos = 0;
+        for (std::size_t block = 1; pos < n; block = 1000 + (block * 7919) % 4000) {
+            const std::size_t len = std::min(block, n - pos);
+            const double speed = estimator.update(std::span(run.position).subspan(pos, len));
+            pos += len;
+            EXPECT_EQ(speed, estimator.rev_per_s());
+            if (pos > 10'000) {
+                budget.add(run.rev_per_s[pos - 1], static_cast<float>(speed));
+            }
+        }
+        budget.record();
+        EXPECT_TRUE(budget.within()) << budget;
+    }
+}
+
+// Smoothing settles on a steady speed within a few time constants and
+// reset() forgets the history.
+TEST(SpeedEstimator, SmoothingSettlesAndResets) {
+    SyntheticSrmConfig config;
+    config.speed_rpm = 2400.0;
+    const std::size_t n = 200'000;
+    const EncoderRun run(config, n);
+    SpeedEstimator estimator(config.encoder_counts_per_rev, config.sample_rate_hz, 0.01);
+    for (std::size_t pos = 0; pos < n; pos += 2000) {
+        estimator.update(std::span(run.position).subspan(pos, 2000));
+    }
+    EXPECT_NEAR(estimator.rev_per_s(), 40.0, 1e-3);
+
+    estimator.reset();
+    EXPECT_EQ(estimator.rev_per_s(), 0.0);
+    // A jump in position across reset() is not taken for motion.
+    const std::vector<float> stopped(100, 123.0f);
+    EXPECT_EQ(estimator.update(stopped), 0.0);
+}
+
+}  // namespace
+}  // namespace srm::test
@@ -0,0 +1,223 @@
+#include "test_common.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "srm/network_stream.hpp"
+
+namespace srm::test {
+namespace {
+
+using namespace std::chrono_literals;
+
+std::unique_ptr<StreamServer> loopback_server(std::size_t channels) {
+    StreamServerConfig config;
+    config.bind_address = "127.0.0.1";
+    config.port = 0;
+    return std::make_unique<StreamServer>(config, channels);
+}
+
+void subscribe(StreamClient& client, StreamServer& server) {
+    client.subscribe("127.0.0.1", server.port());
+    for (int i = 0; i < 1000 && server.subscriber_count() == 0; ++i) {
+        std::this_thread::sleep_for(1ms);
+        server.poll();
+    }
+    ASSERT_EQ(server.subscriber_count(), 1u);
+}
+
+/// Frames received until the socket stays quiet, and how many restarted.
+struct Drained {
+    std::size_t frames = 0;
+    std::size_t restarted = 0;
+};
+
+Drained drain(StreamClient& client) {
+    Drained d;
+    for (std::size_t got = 1; got != 0;) {
+        const auto frames = client.receive(100ms);
+        got = frames.size();
+        d.frames += got;
+        for (const ReceivedFrame& f : frames) {
+            d.restarted += f.restarted;
+        }
+    }
+    return d;
+}
+
+/// Hand-made rig server on a plain socket, so a test controls exactly
+/// which datagrams the client sees and in what order.
+class FakeRig {
+public:
+    explicit FakeRig(StreamClient& client) {
+        fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (fd_ < 0 || ::bind(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::getsockname(fd_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            ADD_FAILURE() << "cannot open the fake rig's socket";
+            return;
+        }
+        client.subscribe("127.0.0.1", ntohs(address.sin_port));
+        stream::FrameHeader h{};
+        length = sizeof(client_);
+        if (::recvfrom(fd_, &h, sizeof(h), 0, reinterpret_cast<sockaddr*>(&client_), &length) !=
+                static_cast<ssize_t>(sizeof(h)) ||
+            h.kind != stream::MessageKind::Subscribe) {
+            ADD_FAILURE() << "no subscription reached the fake rig";
+        }
+    }
+    ~FakeRig() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    FakeRig(const FakeRig&) = delete;
+    FakeRig& operator=(const FakeRig&) = delete;
+
+    /// A well-formed Data frame of two channels.
+    static std::vector<std::byte> frame(std::uint64_t sequence, std::uint16_t session = 7,
+                                        std::uint16_t samples = 4) {
+        stream::FrameHeader h{};
+        h.magic = stream::kMagic;
+        h.version = stream::kProtocolVersion;
+        h.kind = stream::MessageKind::Data;
+        h.rig_id = 3;
+        h.sequence = sequence;
+        h.first_sample = sequence * samples;
+        h.channel_count = 2;
+        h.sample_count = samples;
+        h.session = session;
+        std::vector<std::byte> bytes(sizeof(h) + 2 * samples * sizeof(std::int16_t));
+        std::memcpy(bytes.data(), &h, sizeof(h));
+        return bytes;
+    }
+
+    void send(const std::vector<std::byte>& datagram) {
+        ASSERT_EQ(::sendto(fd_, datagram.data(), datagram.size(), 0, reinterpret_cast<const sockaddr*>(&client_),
+                           sizeof(client_)),
+                  static_cast<ssize_t>(datagram.size()));
+    }
+
+private:
+    int fd_ = -1;
+    sockaddr_in client_{};
+};
+
+std::vector<std::uint64_t> sequences(StreamClient& client) {
+    std::vector<std::uint64_t> seen;
+    for (std::size_t got = 1; got != 0;) {
+        const auto frames = client.receive(100ms);
+        got = frames.size();
+        for (const ReceivedFrame& f : frames) {
+            seen.push_back(f.sequence);
+        }
+    }
+    return seen;
+}
+
+TEST(NetworkStream, CountsLostAndLateFrames) {
+    StreamClient client;
+    FakeRig rig(client);
+    for (const std::uint64_t sequence : {0, 1, 2, 5, 4, 6, 3, 9}) {
+        rig.send(FakeRig::frame(sequence));
+    }
+    EXPECT_EQ(sequences(client), (std::vector<std::uint64_t>{0, 1, 2, 5, 6, 9}));
+    ASSERT_EQ(client.rig_stats().size(), 1u);
+    const RigStreamStats& stats = client.rig_stats()[0];
+    EXPECT_EQ(stats.rig_id, 3u);
+    EXPECT_EQ(stats.frames, 6u);
+    EXPECT_EQ(stats.frames_lost, 4u);  // 3, 4, 7, 8
+    EXPECT_EQ(stats.gaps, 2u);
+    EXPECT_EQ(stats.frames_late, 2u);
+    EXPECT_EQ(stats.restarts, 0u);
+    EXPECT_EQ(client.malformed(), 0u);
+}
+
+TEST(NetworkStream, RejectsMalformedFrames) {
+    StreamClient client;
+    FakeRig rig(client);
+    std::vector<std::byte> bad = FakeRig::frame(0);
+    bad.pop_back();  // one byte short of the declared samples
+    rig.send(bad);
+    rig.send(FakeRig::frame(0, 7, 0));  // no samples
+    bad = FakeRig::frame(0);
+    bad[offsetof(stream::FrameHeader, channel_count)] = std::byte{0};  // no channels...
+    bad.resize(sizeof(stream::FrameHeader));                          // ...and a size to match
+    rig.send(bad);
+    bad = FakeRig::frame(0);
+    bad[0] = std::byte{0};  // magic
+    rig.send(bad);
+    bad = FakeRig::frame(0);
+    bad[offsetof(stream::FrameHeader, version)] = std::byte{1};  // old protocol
+    rig.send(bad);
+    rig.send(std::vector<std::byte>(8));
+    rig.send(FakeRig::frame(0));
+    EXPECT_EQ(sequences(client), (std::vector<std::uint64_t>{0}));
+    EXPECT_EQ(client.malformed(), 6u);
+}
+
+// A restart just behind the last sequence seen is followed at once, and
+// stragglers of the old session are late, not a second restart.
+TEST(NetworkStream, FollowsANewSessionAtOnce) {
+    StreamClient client;
+    FakeRig rig(client);
+    for (std::uint64_t sequence = 0; sequence < 6; ++sequence) {
+        rig.send(FakeRig::frame(sequence, 7));
+    }
+    rig.send(FakeRig::frame(3, 8));
+    rig.send(FakeRig::frame(5, 7));
+    rig.send(FakeRig::frame(4, 8));
+    EXPECT_EQ(sequences(client), (std::vector<std::uint64_t>{0, 1, 2, 3, 4, 5, 3, 4}));
+    const RigStreamStats& stats = client.rig_stats()[0];
+    EXPECT_EQ(stats.restarts, 1u);
+    EXPECT_EQ(stats.frames_late, 1u);
+    EXPECT_EQ(stats.frames_lost, 0u);
+    EXPECT_EQ(stats.session, 8u);
+    EXPECT_EQ(stats.next_sequence, 5u);
+}
+
+TEST(NetworkStream, FollowsARestartedServer) {
+    const std::size_t channels = 2;
+    StreamClient client;
+
+    auto server = loopback_server(channels);
+    subscribe(client, *server);
+    const std::size_t frame = server->samples_per_frame();
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(test_capture_info(channels), 64 * frame);
+    server->publish(counts.view(), 0, 0);
+    ASSERT_EQ(drain(client).frames, 64u);
+
+    // The rig restarts: same rig id, a new session and sequence numbers
+    // from 0 again.
+    const std::uint16_t session = server->session();
+    server = loopback_server(channels);
+    EXPECT_NE(server->session(), session);
+    subscribe(client, *server);
+    server->publish(counts.view(), 0, 0);
+    const Drained after = drain(client);
+    EXPECT_EQ(after.frames, 64u);
+    EXPECT_EQ(after.restarted, 1u);
+    ASSERT_EQ(client.rig_stats().size(), 1u);
+    const RigStreamStats& stats = client.rig_stats()[0];
+    EXPECT_EQ(stats.restarts, 1u);
+    EXPECT_EQ(stats.frames, 128u);
+    EXPECT_EQ(stats.frames_late, 0u);
+    EXPECT_EQ(stats.frames_lost, 0u);
+    EXPECT_EQ(stats.next_sequence, 64u);
+}
+
+}  // namespace
+}  // namespace srm::test
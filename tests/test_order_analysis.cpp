@@ -0,0 +1,202 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "srm/order_analysis.hpp"
+
+namespace srm::test {
+namespace {
+
+constexpr std::size_t kStrainChannels = 4;
+constexpr std::size_t kChunk = 50000;
+constexpr std::size_t kChunks = 10;
+
+/// Four gauges plus the encoder on the last channel, 0.5 s at 3000 rpm.
+void write_rotor_capture(const std::filesystem::path& path) {
+    CaptureInfo info = test_capture_info(kStrainChannels + 1);
+    info.rotor_position_channel = kStrainChannels;
+    const std::vector<ConversionParams> params = conversion_params(info);
+
+    SyntheticSrmConfig config;
+    config.strain_channels = kStrainChannels;
+    SyntheticSrm srm(config);
+    ChannelBuffer<float> strain(kStrainChannels, kChunk);
+    std::vector<float> position(kChunk);
+    ChannelBuffer<std::int16_t> counts(kStrainChannels + 1, kChunk);
+    CaptureWriter writer(path, info);
+    for (std::size_t k = 0; k < kChunks; ++k) {
+        srm.generate(strain.view(), position, {});
+        for (std::size_t i = 0; i < kChunk; ++i) {
+            for (std::size_t c = 0; c < kStrainChannels; ++c) {
+                counts.channel(c)[i] =
+                    static_cast<std::int16_t>(std::lround(strain_to_counts(params[c], strain.channel(c)[i])));
+            }
+            counts.channel(kStrainChannels)[i] = static_cast<std::int16_t>(std::lround(position[i]) % 4096);
+        }
+        writer.write_chunk(std::as_const(counts).view());
+    }
+    writer.finish();
+}
+
+/// An 8/6 machine: six electrical cycles per revolution and four strokes
+/// per cycle, so the radial-force harmonics sit on orders 4, 8, 12, 16.
+OrderAnalysisConfig rotor_config() {
+    OrderAnalysisConfig config;
+    config.resampler.cycles_per_revolution = 6;
+    config.resampler.points_per_cycle = 64;
+    config.spectrum.frame_size = 1024;
+    config.spectrum.hop = 256;
+    return config;
+}
+
+// Device backends interpolate from locate()'s crossings; with the carried
+// sample in front of each block that must give process()'s output exactly,
+// also when a block ends in the middle of a sample's grid points.
+TEST(OrderAnalysis, LocateMatchesProcess) {
+    SyntheticSrmConfig machine;
+    machine.strain_channels = 1;
+    machine.speed_rpm = 9000.0;
+    SyntheticSrm srm(machine);
+    const std::size_t n = 20000;
+    ChannelBuffer<float> strain(1, n);
+    std::vector<float> position(n);
+    srm.generate(strain.view(), position, {});
+
+    AngleResamplerConfig config;
+    config.cycles_per_revolution = 6;
+    config.points_per_cycle = 4096;  // several grid points per sample
+    AngleResampler reference(config, 1);
+    ChannelBuffer<float> expected(1, n * 8);
+    const std::size_t produced = reference.process(position, std::as_const(strain).view(), expected.view()).produced;
+    ASSERT_GT(produced, 2 * n);
+
+    AngleResampler tracker(config, 1);
+    std::vector<GridCrossing> crossings(37);
+    std::vector<float> actual;
+    float carried = 0.0f;
+    std::size_t pos = 0;
+    while (pos < n) {
+        const std::size_t length = std::min<std::size_t>(1000, n - pos);
+        const AngleResampler::Result step =
+            tracker.locate(std::span<const float>(position).subspan(pos, length), crossings);
+        const std::span<const float> x = strain.channel(0).subspan(pos, length);
+        for (std::size_t g = 0; g < step.produced; ++g) {
+            const GridCrossing c = crossings[g];
+            const float a = c.sample == 0 ? carried : x[c.sample - 1];
+            actual.push_back(a + c.fraction * (x[c.sample] - a));
+        }
+        if (step.consumed != 0) {
+            carried = x[step.consumed - 1];
+        }
+        pos += step.consumed;
+    }
+    ASSERT_EQ(actual.size(), produced);
+    for (std::size_t g = 0; g < produced; ++g) {
+        ASSERT_EQ(ulp_distance(actual[g], expected.channel(0)[g]), 0u) << "grid point " << g;
+    }
+}
+
+TEST(OrderAnalysis, CpuBackendFindsStrokeHarmonics) {
+    const ScratchFile file(".srmcap");
+    write_rotor_capture(file.path());
+    const CaptureReader reader(file.path());
+    const std::unique_ptr<SpectralBackend> backend = make_spectral_backend(rotor_config(), SpectralBackendKind::Cpu);
+    ASSERT_EQ(backend->kind(), SpectralBackendKind::Cpu);
+    const OrderSpectrum orders = backend->analyse(reader, {0, reader.chunk_count()});
+
+    ASSERT_EQ(orders.channels(), kStrainChannels);
+    ASSERT_EQ(orders.bins(), 513u);
+    EXPECT_EQ(orders.order_per_bin(), 1.0 / 16.0);
+    // 0.5 s at 300 Hz electrical is 9600 grid points: frames end at every
+    // multiple of the hop from one full frame on.
+    EXPECT_EQ(orders.frames(), (9600 - 1024) / 256 + 1);
+
+    const double harmonics[] = {40.0, 18.0, 8.0, 3.0};
+    ErrorBudget budget("stroke_harmonic_amplitude", 0.5);
+    for (std::size_t c = 0; c < orders.channels(); ++c) {
+        for (std::size_t h = 0; h < 4; ++h) {
+            const std::size_t bin = (h + 1) * 64;
+            budget.add(harmonics[h], static_cast<float>(orders.mean(c, bin)));
+            EXPECT_GE(orders.peak(c, bin), orders.mean(c, bin));
+        }
+        // Between the harmonics only noise and aliased PWM ripple remain.
+        EXPECT_LT(orders.mean(c, 100), 1.0) << "channel " << c;
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+}
+
+// Chunk ranges restart the resampler and spectrum, so the summary depends
+// on the split but never on the number of workers.
+TEST(OrderAnalysis, CampaignSummaryIndependentOfThreads) {
+    const ScratchFile file(".srmcap");
+    write_rotor_capture(file.path());
+    const std::unique_ptr<SpectralBackend> backend = make_spectral_backend(rotor_config());
+    const std::vector<std::filesystem::path> files = {file.path()};
+
+    CampaignOptions options;
+    options.chunks_per_task = 3;
+    WorkStealingPool one(1);
+    WorkStealingPool three(3);
+    const auto a = analyse_orders(CampaignProcessor(one, options), files, *backend);
+    const auto b = analyse_orders(CampaignProcessor(three, options), files, *backend);
+    ASSERT_TRUE(a[0].ok()) << a[0].error;
+    ASSERT_TRUE(b[0].ok()) << b[0].error;
+    const OrderSpectrum& x = a[0].result;
+    const OrderSpectrum& y = b[0].result;
+    ASSERT_EQ(x.frames(), y.frames());
+    EXPECT_GT(x.frames(), 0u);
+    for (std::size_t c = 0; c < x.channels(); ++c) {
+        for (std::size_t k = 0; k < x.bins(); ++k) {
+            ASSERT_EQ(x.mean(c, k), y.mean(c, k)) << c << "/" << k;
+            ASSERT_EQ(x.peak(c, k), y.peak(c, k)) << c << "/" << k;
+        }
+    }
+    EXPECT_NEAR(x.mean(0, 64), 40.0, 0.5);
+}
+
+TEST(OrderAnalysis, MergeAndBackendSelection) {
+    OrderSpectrum whole(2, 3, 0.5);
+    OrderSpectrum later(2, 3, 0.5);
+    const std::vector<float> amplitudes = {1, 2, 3, 4, 5, 6};
+    later.add_frame(ChannelBlock<const float>(amplitudes.data(), 2, 3));
+    OrderSpectrum merged;
+    merged.merge(later);
+    merged.merge(later);
+    EXPECT_EQ(merged.frames(), 2u);
+    EXPECT_EQ(merged.mean(1, 2), 6.0);
+    EXPECT_EQ(merged.peak(0, 1), 2.0f);
+    EXPECT_THROW(merged.merge(OrderSpectrum(2, 4, 0.5)), std::invalid_argument);
+    EXPECT_THROW(whole.add_frame(ChannelBlock<const float>(amplitudes.data(), 3, 2)), std::invalid_argument);
+
+    EXPECT_TRUE(spectral_backend_available(SpectralBackendKind::Auto));
+    const std::unique_ptr<SpectralBackend> automatic = make_spectral_backend(rotor_config());
+    if (spectral_backend_available(SpectralBackendKind::Cuda)) {
+        EXPECT_EQ(automatic->kind(), SpectralBackendKind::Cuda);
+    } else {
+        EXPECT_EQ(automatic->kind(), SpectralBackendKind::Cpu);
+        EXPECT_THROW(make_spectral_backend(rotor_config(), SpectralBackendKind::Cuda), std::runtime_error);
+    }
+    RecordProperty("spectral_backend", std::string(to_string(automatic->kind())));
+
+    OrderAnalysisConfig bad = rotor_config();
+    bad.spectrum.hop = 0;
+    EXPECT_THROW(make_spectral_backend(bad), std::invalid_argument);
+
+    const ScratchFile file(".srmcap");
+    {
+        const CaptureInfo info = test_capture_info(2);
+        CaptureWriter writer(file.path(), info);
+        const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 100);
+        writer.write_chunk(counts.view());
+        writer.finish();
+    }
+    const CaptureReader reader(file.path());
+    EXPECT_THROW(automatic->analyse(reader, {0, 1}), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace srm::test
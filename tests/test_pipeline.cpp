@@ -0,0 +1,156 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "srm/channel_pipeline.hpp"
+
+namespace srm::test {
+namespace {
+
+constexpr BiquadCoefficients kNotch = design_notch(4.0 * 300.0 / 1e6, 8.0);
+constexpr double kResampleStep = 1.25;
+
+/// The rig's default chain (convert, notch, half-band /2, resample by
+/// 1.25) on one channel in double precision, from the same float
+/// coefficients.
+std::vector<double> reference_chain(const ConversionParams& p, std::span<const std::int16_t> counts) {
+    std::vector<double> converted;
+    double z1 = 0.0;
+    double z2 = 0.0;
+    for (const std::int16_t c : counts) {
+        const double r = (static_cast<double>(c) - p.offset_counts) * p.ratio_per_count;
+        const double ue = p.bridge == capture::BridgeConfig::Quarter ? p.strain_coeff * r / (1.0 + 2.0 * r)
+                                                                     : p.strain_coeff * r;
+        const double y = kNotch.b0 * ue + z1;
+        z1 = kNotch.b1 * ue - kNotch.a1 * y + z2;
+        z2 = kNotch.b2 * ue - kNotch.a2 * y;
+        converted.push_back(y);
+    }
+    // FirDecimateStage emits after every second input: taps[t] * x[n - t]
+    // for n = 1, 3, 5, ...
+    std::vector<double> decimated;
+    for (std::size_t n = 1; n < converted.size(); n += 2) {
+        double acc = 0.0;
+        for (std::size_t t = 0; t < kHalfband31.size() && t <= n; ++t) {
+            acc += static_cast<double>(kHalfband31[t]) * converted[n - t];
+        }
+        decimated.push_back(acc);
+    }
+    std::vector<double> resampled;
+    if (!decimated.empty()) {
+        resampled.push_back(decimated[0]);
+    }
+    double t = kResampleStep;
+    for (std::size_t i = 1; i < decimated.size(); ++i) {
+        while (t <= 1.0) {
+            resampled.push_back(decimated[i - 1] + t * (decimated[i] - decimated[i - 1]));
+            t += kResampleStep;
+        }
+        t -= 1.0;
+    }
+    return resampled;
+}
+
+template <typename Summary>
+void expect_same_summary(const Summary& a, const Summary& b, std::size_t channel) {
+    EXPECT_EQ(a.count, b.count) << "channel " << channel;
+    EXPECT_EQ(ulp_distance(a.min, b.min), 0u) << "channel " << channel;
+    EXPECT_EQ(ulp_distance(a.max, b.max), 0u) << "channel " << channel;
+    EXPECT_EQ(a.mean, b.mean) << "channel " << channel;
+    EXPECT_EQ(a.rms, b.rms) << "channel " << channel;
+}
+
+// The fused chain evaluates exactly the dynamic chain's float operations,
+// four channels per vector, so the two agree bit for bit; both are held
+// to a budget against the double-precision chain.
+TEST(ChannelPipeline, FusedMatchesDynamicAndDoubleReference) {
+    const CaptureInfo info = test_capture_info(7);  // a partial vector group
+    const std::vector<ConversionParams> params = conversion_params(info);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 30011);
+
+    FusedPipeline fused(info.channels.size(), ConvertStage(params), BiquadStage(kNotch),
+                        FirDecimateStage(kHalfband31, 2), LinearResampleStage(kResampleStep), StatsStage{});
+    DynamicPipeline dynamic(info.channels.size());
+    dynamic.add(ConvertStage(params));
+    dynamic.add(BiquadStage(kNotch));
+    dynamic.add(FirDecimateStage(kHalfband31, 2));
+    dynamic.add(LinearResampleStage(kResampleStep));
+    const auto& stats = dynamic.add(StatsStage{});
+    for (std::size_t pos = 0; pos < counts.samples(); pos += 4096) {
+        const std::size_t n = std::min<std::size_t>(4096, counts.samples() - pos);
+        fused.process(counts.view().subblock(pos, n));
+        dynamic.process(counts.view().subblock(pos, n));
+    }
+
+    // The narrow float notch amplifies rounding by roughly 1 / (1 - pole
+    // radius); the budgets are in microstrain, two orders below the noise.
+    ErrorBudget extremes("pipeline_extremes_vs_double", 5e-2);
+    ErrorBudget moments("pipeline_moments_vs_double", 2e-2);
+    for (std::size_t c = 0; c < info.channels.size(); ++c) {
+        const auto f = fused.summary<4>(c);
+        expect_same_summary(f, stats.summary(c), c);
+        const std::vector<double> ref = reference_chain(params[c], counts.channel(c));
+        ASSERT_EQ(f.count, ref.size()) << "channel " << c;
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        for (const double v : ref) {
+            sum += v;
+            sum_sq += v * v;
+        }
+        extremes.add(*std::min_element(ref.begin(), ref.end()), f.min);
+        extremes.add(*std::max_element(ref.begin(), ref.end()), f.max);
+        const double n = static_cast<double>(ref.size());
+        moments.add(sum / n, static_cast<float>(f.mean));
+        moments.add(std::sqrt(sum_sq / n), static_cast<float>(f.rms));
+    }
+    extremes.record();
+    moments.record();
+    EXPECT_TRUE(extremes.within()) << extremes;
+    EXPECT_TRUE(moments.within()) << moments;
+}
+
+// ConvertStage alone must reproduce convert_sample() exactly.
+TEST(ChannelPipeline, ConvertStageIsBitExact) {
+    const CaptureInfo info = test_capture_info(5);
+    const std::vector<ConversionParams> params = conversion_params(info);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 5000);
+    FusedPipeline fused(info.channels.size(), ConvertStage(params), StatsStage{});
+    fused.process(counts.view());
+    for (std::size_t c = 0; c < info.channels.size(); ++c) {
+        float lo = std::numeric_limits<float>::infinity();
+        float hi = -std::numeric_limits<float>::infinity();
+        double sum = 0.0;
+        for (const std::int16_t x : counts.channel(c)) {
+            const float ue = convert_sample(params[c], x);
+            lo = std::min(lo, ue);
+            hi = std::max(hi, ue);
+            sum += ue;
+        }
+        const auto s = fused.summary<1>(c);
+        EXPECT_EQ(ulp_distance(s.min, lo), 0u) << "channel " << c;
+        EXPECT_EQ(ulp_distance(s.max, hi), 0u) << "channel " << c;
+        EXPECT_EQ(s.mean, sum / static_cast<double>(counts.samples())) << "channel " << c;
+    }
+}
+
+// Both pipelines hold per-channel state, so a block of another width is an
+// error rather than something either could quietly pad or truncate.
+TEST(ChannelPipeline, ChannelCountMustMatch) {
+    const CaptureInfo info = test_capture_info(6);
+    const std::vector<ConversionParams> params = conversion_params(info);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 100);
+    FusedPipeline fused(5, ConvertStage(params), StatsStage{});
+    DynamicPipeline dynamic(5);
+    dynamic.add(ConvertStage(params));
+    EXPECT_THROW(fused.process(counts.view()), std::invalid_argument);
+    EXPECT_THROW(dynamic.process(counts.view()), std::invalid_argument);
+    FusedPipeline wide(7, ConvertStage(params), StatsStage{});
+    EXPECT_THROW(wide.process(counts.view()), std::invalid_argument);
+    EXPECT_EQ(wide.summary<1>(0).count, 0u);
+}
+
+}  // namespace
+}  // namespace srm::test
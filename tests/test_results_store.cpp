@@ -0,0 +1,257 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "srm/results_store.hpp"
+
+namespace srm::test {
+namespace {
+
+const std::vector<std::string> kLocations = {"yoke", "pole_a", "pole_b", "tooth"};
+
+/// A campaign summary in sweep order: speed outermost, then current, then
+/// measurement location, repeated per capture chunk.
+struct Campaign {
+    std::vector<double> speed, current, peak;
+    std::vector<std::int64_t> chunk;
+    std::vector<std::string> location;
+
+    Campaign() {
+        std::uint64_t state = 12345;
+        for (int s = 1; s <= 12; ++s) {
+            for (int a = 1; a <= 8; ++a) {
+                for (std::int64_t k = 0; k < 260; ++k) {
+                    for (std::size_t l = 0; l < kLocations.size(); ++l) {
+                        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                        const double noise = static_cast<double>(state >> 40) / static_cast<double>(1 << 24);
+                        speed.push_back(500.0 * s);
+                        current.push_back(5.0 * a);
+                        location.push_back(kLocations[l]);
+                        chunk.push_back(k);
+                        peak.push_back(10.0 * a * (l + 1) + 0.01 * speed.back() + noise);
+                    }
+                }
+            }
+        }
+    }
+
+    std::size_t rows() const noexcept { return speed.size(); }
+
+    void write(const std::filesystem::path& path) const {
+        ResultsWriter writer(path);
+        const std::size_t speed_col = writer.add_column("speed_rpm", ColumnType::Float64);
+        const std::size_t current_col = writer.add_column("current_a", ColumnType::Float64);
+        const std::size_t location_col = writer.add_column("location", ColumnType::Key);
+        const std::size_t chunk_col = writer.add_column("chunk", ColumnType::Int64);
+        const std::size_t peak_col = writer.add_column("peak_ue", ColumnType::Float64);
+        for (std::size_t i = 0; i < rows(); ++i) {
+            writer.set(location_col, location[i]);  // any order
+            writer.set(speed_col, speed[i]);
+            writer.set(current_col, current[i]);
+            writer.set(chunk_col, chunk[i]);
+            writer.set(peak_col, peak[i]);
+            writer.end_row();
+        }
+        writer.finish();
+    }
+};
+
+TEST(ResultsStore, ColumnsZoneMapsAndDictionary) {
+    const Campaign campaign;
+    const ScratchFile file(".srmres");
+    campaign.write(file.path());
+    const ResultsReader store(file.path());
+
+    ASSERT_EQ(store.rows(), campaign.rows());
+    ASSERT_EQ(store.column_count(), 5u);
+    EXPECT_EQ(store.zone_count(), (campaign.rows() + 4095) / 4096);
+    const std::size_t speed = store.column("speed_rpm");
+    const std::size_t location = store.column("location");
+    const std::size_t chunk = store.column("chunk");
+    EXPECT_EQ(store.column_type(location), ColumnType::Key);
+    EXPECT_THROW(static_cast<void>(store.column("torque_nm")), std::out_of_range);
+    EXPECT_THROW(static_cast<void>(store.f64(location)), std::invalid_argument);
+    EXPECT_THROW(static_cast<void>(store.i64(speed)), std::invalid_argument);
+
+    EXPECT_TRUE(std::equal(campaign.speed.begin(), campaign.speed.end(), store.f64(speed).begin()));
+    EXPECT_TRUE(std::equal(campaign.chunk.begin(), campaign.chunk.end(), store.i64(chunk).begin()));
+    // The dictionary is sorted; every code reads back as its row's key.
+    ASSERT_EQ(store.dictionary_size(location), 4u);
+    EXPECT_EQ(store.key(location, 0), "pole_a");
+    EXPECT_EQ(store.key(location, 3), "yoke");
+    EXPECT_EQ(store.find_key(location, "tooth"), 2);
+    EXPECT_EQ(store.find_key(location, "stator"), -1);
+    const std::span<const std::uint32_t> codes = store.codes(location);
+    for (std::size_t i = 0; i < campaign.rows(); ++i) {
+        ASSERT_EQ(store.key(location, codes[i]), campaign.location[i]) << "row " << i;
+    }
+
+    const std::span<const results::Zone<double>> zones = store.f64_zones(speed);
+    for (std::size_t z = 0; z < store.zone_count(); ++z) {
+        const auto first = campaign.speed.begin() + static_cast<std::ptrdiff_t>(z * 4096);
+        const auto last = campaign.speed.begin() +
+                          static_cast<std::ptrdiff_t>(std::min<std::size_t>(campaign.rows(), (z + 1) * 4096));
+        EXPECT_EQ(zones[z].min, *std::min_element(first, last));
+        EXPECT_EQ(zones[z].max, *std::max_element(first, last));
+    }
+    EXPECT_EQ(store.i64_zones(location)[0].max, 3);
+}
+
+TEST(ResultsStore, QueryMatchesRowScan) {
+    const Campaign campaign;
+    const ScratchFile file(".srmres");
+    campaign.write(file.path());
+    const ResultsReader store(file.path());
+
+    // Peak yoke strain against speed at 10 A.
+    const QueryResult r = ResultsQuery(store)
+                              .where("current_a", Compare::Equal, 10.0)
+                              .where_key("location", "yoke")
+                              .group_by("speed_rpm")
+                              .aggregate(Aggregate::Max, "peak_ue")
+                              .aggregate(Aggregate::Mean, "peak_ue")
+                              .aggregate(Aggregate::Count, "")
+                              .run();
+    std::map<double, std::vector<double>> expected;
+    for (std::size_t i = 0; i < campaign.rows(); ++i) {
+        if (campaign.current[i] == 10.0 && campaign.location[i] == "yoke") {
+            expected[campaign.speed[i]].push_back(campaign.peak[i]);
+        }
+    }
+    ASSERT_EQ(r.groups(), expected.size());
+    std::size_t g = 0;
+    for (const auto& [speed, peaks] : expected) {
+        EXPECT_EQ(r.group_values[g], speed);
+        EXPECT_EQ(r.counts[g], peaks.size());
+        EXPECT_EQ(r.values[0][g], *std::max_element(peaks.begin(), peaks.end()));
+        double sum = 0.0;
+        for (const double p : peaks) {
+            sum += p;
+        }
+        EXPECT_NEAR(r.values[1][g], sum / static_cast<double>(peaks.size()), 1e-9);
+        EXPECT_EQ(r.values[2][g], static_cast<double>(peaks.size()));
+        ++g;
+    }
+    EXPECT_EQ(r.rows_matched, 12u * 260u);
+
+    // A speed range rules out most zones before any row is read.
+    const QueryResult fast = ResultsQuery(store)
+                                 .between("speed_rpm", 5500.0, 6000.0)
+                                 .group_by("location")
+                                 .aggregate(Aggregate::Min, "peak_ue")
+                                 .run();
+    EXPECT_GT(fast.zones_skipped, 15u);
+    EXPECT_EQ(fast.zones_scanned + fast.zones_skipped, store.zone_count());
+    RecordProperty("results_zones_skipped", std::to_string(fast.zones_skipped) + "/" +
+                                                std::to_string(store.zone_count()));
+    ASSERT_EQ(fast.group_keys, (std::vector<std::string>{"pole_a", "pole_b", "tooth", "yoke"}));
+    for (std::size_t k = 0; k < 4; ++k) {
+        double lo = std::numeric_limits<double>::infinity();
+        for (std::size_t i = 0; i < campaign.rows(); ++i) {
+            if (campaign.speed[i] >= 5500.0 && campaign.location[i] == fast.group_keys[k]) {
+                lo = std::min(lo, campaign.peak[i]);
+            }
+        }
+        EXPECT_EQ(fast.values[0][k], lo);
+        EXPECT_EQ(fast.counts[k], 2u * 8u * 260u);
+    }
+
+    // Int64 predicates; an ungrouped query always has its one group.
+    const QueryResult first_chunk =
+        ResultsQuery(store).where("chunk", Compare::Less, 1.0).aggregate(Aggregate::Sum, "chunk").run();
+    ASSERT_EQ(first_chunk.groups(), 1u);
+    EXPECT_EQ(first_chunk.counts[0], 12u * 8u * 4u);
+    EXPECT_EQ(first_chunk.values[0][0], 0.0);
+    const QueryResult none = ResultsQuery(store).where_key("location", "stator").aggregate(Aggregate::Max, "peak_ue").run();
+    ASSERT_EQ(none.groups(), 1u);
+    EXPECT_EQ(none.counts[0], 0u);
+    EXPECT_TRUE(std::isnan(none.values[0][0]));
+}
+
+TEST(ResultsStore, NanSemanticsAndErrors) {
+    const ScratchFile file(".srmres");
+    {
+        ResultsWriter writer(file.path());
+        const std::size_t x = writer.add_column("x", ColumnType::Float64);
+        const std::size_t tag = writer.add_column("tag", ColumnType::Key);
+        EXPECT_THROW(writer.add_column("x", ColumnType::Int64), std::invalid_argument);
+        EXPECT_THROW(writer.add_column(std::string(40, 'n'), ColumnType::Int64), std::invalid_argument);
+        const double values[] = {1.0, std::numeric_limits<double>::quiet_NaN(), 3.0, 2.0};
+        const char* tags[] = {"a", "a", "b", "b"};
+        for (std::size_t i = 0; i < 4; ++i) {
+            writer.set(x, values[i]);
+            writer.set(tag, tags[i]);
+            writer.end_row();
+        }
+        EXPECT_THROW(writer.set(x, std::int64_t{1}), std::invalid_argument);
+        writer.set(x, 9.0);
+        EXPECT_THROW(writer.end_row(), std::logic_error);  // tag missing: row dropped
+        EXPECT_THROW(writer.add_column("late", ColumnType::Key), std::logic_error);
+        EXPECT_EQ(writer.rows(), 4u);
+    }
+    const ResultsReader store(file.path());
+    ASSERT_EQ(store.rows(), 4u);
+    EXPECT_EQ(store.f64_zones(0)[0].min, 1.0);
+    EXPECT_EQ(store.f64_zones(0)[0].max, 3.0);
+
+    // NaN matches no comparison, NotEqual included.
+    EXPECT_EQ(ResultsQuery(store).where("x", Compare::NotEqual, 3.0).aggregate(Aggregate::Count, "").run().counts[0],
+              2u);
+    const QueryResult by_tag = ResultsQuery(store)
+                                   .group_by("tag")
+                                   .aggregate(Aggregate::Max, "x")
+                                   .aggregate(Aggregate::Sum, "x")
+                                   .run();
+    EXPECT_EQ(by_tag.values[0][0], 1.0);  // Max skips the NaN
+    EXPECT_TRUE(std::isnan(by_tag.values[1][0]));
+    EXPECT_EQ(by_tag.values[1][1], 5.0);
+    EXPECT_EQ(ResultsQuery(store).group_by("x").aggregate(Aggregate::Count, "").run().group_values,
+              (std::vector<double>{1.0, 2.0, 3.0}));
+
+    EXPECT_THROW(ResultsQuery(store).where("tag", Compare::Equal, 1.0).run(), std::invalid_argument);
+    EXPECT_THROW(ResultsQuery(store).where_key("x", "a").run(), std::invalid_argument);
+    EXPECT_THROW(ResultsQuery(store).aggregate(Aggregate::Max, "tag").run(), std::invalid_argument);
+    EXPECT_THROW(ResultsQuery(store).group_by("y").run(), std::out_of_range);
+
+    const ScratchFile bad(".srmres");
+    {
+        std::ofstream out(bad.path(), std::ios::binary);
+        out << std::string(200, 'x');
+    }
+    EXPECT_THROW(ResultsReader{bad.path()}, std::runtime_error);
+}
+
+TEST(ResultsStore, CorruptKeyCodesAreRejected) {
+    const ScratchFile file(".srmres");
+    {
+        ResultsWriter writer(file.path());
+        const std::size_t tag = writer.add_column("tag", ColumnType::Key);
+        for (const char* t : {"a", "b", "a", "b"}) {
+            writer.set(tag, t);
+            writer.end_row();
+        }
+    }
+    // One code past the two-entry dictionary; its zone still says 0..1.
+    std::fstream io(file.path(), std::ios::binary | std::ios::in | std::ios::out);
+    results::FileTrailer trailer;
+    io.seekg(-static_cast<std::streamoff>(sizeof(trailer)), std::ios::end);
+    io.read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+    results::ColumnDescriptor column;
+    io.seekg(static_cast<std::streamoff>(trailer.columns_offset));
+    io.read(reinterpret_cast<char*>(&column), sizeof(column));
+    const std::uint32_t code = 7;
+    io.seekp(static_cast<std::streamoff>(column.values_offset + 3 * sizeof(code)));
+    io.write(reinterpret_cast<const char*>(&code), sizeof(code));
+    io.close();
+    EXPECT_THROW(ResultsReader{file.path()}, std::runtime_error);
+}
+
+}  // namespace
+}  // namespace srm::test
@@ -0,0 +1,189 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "srm/startup_plans.hpp"
+
+namespace srm::test {
+namespace {
+
+constexpr const char* kRecords =
+    "channel=0 sensor=SG-101 thermocouple=1 zero=3.5 gf_tc=1e-4 reference_c=20 "
+    "thermal=-20:-35,0:-12,20:0,60:18,120:40\n"
+    "channel=1 sensor=SG-102 shunt_expected=1000 shunt_measured=990\n";
+
+/// A cache directory and calibration file unique to the test, removed
+/// again with it.
+class Rig {
+public:
+    Rig() : directory_("_plans"), calibration_(".cal") {
+        write_calibration(kRecords);
+        config.channels = test_capture_info(4).channels;
+        config.calibration_files = {calibration_.path()};
+        config.fft_sizes = {256, 4096};
+        config.windows = {{WindowType::Hann, 4096}, {WindowType::FlatTop, 256}};
+    }
+    ~Rig() {
+        std::error_code ignored;
+        std::filesystem::remove_all(directory_.path(), ignored);
+    }
+
+    void write_calibration(const std::string& text) const {
+        std::ofstream(calibration_.path(), std::ios::binary | std::ios::trunc) << text;
+    }
+
+    StartupPlanCache cache() const { return StartupPlanCache(directory_.path()); }
+
+    RigConfiguration config;
+
+private:
+    ScratchFile directory_;
+    ScratchFile calibration_;
+};
+
+void expect_same_plans(const RigPlans& a, const RigPlans& b, std::size_t channels) {
+    ASSERT_EQ(a.fft.size(), b.fft.size());
+    for (std::size_t p = 0; p < a.fft.size(); ++p) {
+        const std::size_t n = a.fft[p]->size();
+        ASSERT_EQ(b.fft[p]->size(), n);
+        std::vector<float> in(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            in[i] = std::sin(0.37f * static_cast<float>(i)) + 0.25f * static_cast<float>(i % 7);
+        }
+        std::vector<std::complex<float>> out_a(a.fft[p]->bins()), out_b(b.fft[p]->bins());
+        std::vector<std::complex<float>> scratch(a.fft[p]->scratch_size());
+        a.fft[p]->forward(in.data(), out_a.data(), scratch.data());
+        b.fft[p]->forward(in.data(), out_b.data(), scratch.data());
+        EXPECT_EQ(out_a, out_b) << "fft " << n;
+    }
+    ASSERT_EQ(a.windows.size(), b.windows.size());
+    for (std::size_t w = 0; w < a.windows.size(); ++w) {
+        EXPECT_TRUE(std::equal(a.windows[w]->begin(), a.windows[w]->end(), b.windows[w]->begin(),
+                               b.windows[w]->end()));
+    }
+    EXPECT_EQ(a.decimation.compensator, b.decimation.compensator);
+    EXPECT_EQ(a.decimation.halfband, b.decimation.halfband);
+    ASSERT_EQ(b.calibration->channel_count(), channels);
+    for (std::size_t c = 0; c < channels; ++c) {
+        EXPECT_EQ(a.calibration->sensor_id(c), b.calibration->sensor_id(c));
+        for (const float t : {-40.0f, 0.0f, 20.0f, 75.0f, 200.0f}) {
+            const ConversionParams pa = a.calibration->params(c, t);
+            const ConversionParams pb = b.calibration->params(c, t);
+            EXPECT_EQ(pa.offset_counts, pb.offset_counts);
+            EXPECT_EQ(pa.ratio_per_count, pb.ratio_per_count);
+            EXPECT_EQ(pa.strain_coeff, pb.strain_coeff);
+            EXPECT_EQ(pa.bridge, pb.bridge);
+        }
+    }
+}
+
+TEST(StartupPlans, CachedLoadMatchesBuild) {
+    const Rig rig;
+    const StartupPlanCache cache = rig.cache();
+    const RigPlans built = cache.load_or_build(rig.config);
+    EXPECT_FALSE(built.from_cache);
+    EXPECT_EQ(built.cache_error, "");
+    EXPECT_EQ(built.configuration_hash, configuration_hash(rig.config));
+    EXPECT_TRUE(std::filesystem::exists(cache.file_for(built.configuration_hash)));
+
+    PlanCache::instance().clear();
+    const RigPlans cached = cache.load_or_build(rig.config);
+    EXPECT_TRUE(cached.from_cache);
+    EXPECT_EQ(cached.cache_error, "");
+    expect_same_plans(build_rig_plans(rig.config), cached, 4);
+    EXPECT_EQ(cached.calibration->find_sensor("SG-102"), 1);
+    // The spectrum stages find the restored plans.
+    EXPECT_EQ(PlanCache::instance().fft(4096), cached.fft[1]);
+    EXPECT_EQ(PlanCache::instance().window(WindowType::FlatTop, 256), cached.windows[1]);
+}
+
+TEST(StartupPlans, ConfigurationChangesRebuild) {
+    Rig rig;
+    const StartupPlanCache cache = rig.cache();
+    const std::uint64_t original = cache.load_or_build(rig.config).configuration_hash;
+
+    rig.write_calibration(std::string(kRecords) + "channel=3 sensor=SG-104 thermocouple=0 thermal=0:-10,100:10\n");
+    const RigPlans recalibrated = cache.load_or_build(rig.config);
+    EXPECT_FALSE(recalibrated.from_cache);
+    EXPECT_NE(recalibrated.configuration_hash, original);
+    EXPECT_EQ(recalibrated.calibration->sensor_id(3), "SG-104");
+
+    rig.config.fft_sizes.push_back(1024);
+    EXPECT_FALSE(cache.load_or_build(rig.config).from_cache);
+    rig.config.decimation.compensator_taps = 31;
+    EXPECT_FALSE(cache.load_or_build(rig.config).from_cache);
+    EXPECT_TRUE(cache.load_or_build(rig.config).from_cache);
+
+    // Switching back to a known rig reuses its file.
+    rig.write_calibration(kRecords);
+    rig.config.fft_sizes.pop_back();
+    rig.config.decimation.compensator_taps = DecimationChainConfig{}.compensator_taps;
+    const RigPlans back = cache.load_or_build(rig.config);
+    EXPECT_TRUE(back.from_cache);
+    EXPECT_EQ(back.configuration_hash, original);
+}
+
+TEST(StartupPlans, CorruptFilesAreRebuilt) {
+    const Rig rig;
+    const StartupPlanCache cache = rig.cache();
+    const RigPlans built = cache.load_or_build(rig.config);
+    const std::filesystem::path file = cache.file_for(built.configuration_hash);
+    const auto size = std::filesystem::file_size(file);
+
+    {
+        std::fstream f(file, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(static_cast<std::streamoff>(size / 2));
+        f.put('\x5a');
+    }
+    const RigPlans flipped = cache.load_or_build(rig.config);
+    EXPECT_FALSE(flipped.from_cache);
+    EXPECT_NE(flipped.cache_error.find("checksum"), std::string::npos) << flipped.cache_error;
+    expect_same_plans(built, flipped, 4);
+    EXPECT_TRUE(cache.load_or_build(rig.config).from_cache);
+
+    std::filesystem::resize_file(file, size - 100);
+    EXPECT_FALSE(cache.load_or_build(rig.config).from_cache);
+    std::filesystem::resize_file(file, 10);
+    EXPECT_FALSE(cache.load_or_build(rig.config).from_cache);
+    EXPECT_TRUE(cache.load_or_build(rig.config).from_cache);
+
+    // An unusable directory costs the cache, not the start.
+    const StartupPlanCache unwritable(file / "sub");
+    const RigPlans uncached = unwritable.load_or_build(rig.config);
+    EXPECT_FALSE(uncached.from_cache);
+    EXPECT_NE(uncached.cache_error, "");
+    expect_same_plans(built, uncached, 4);
+}
+
+TEST(StartupPlans, RestoredTablesAreValidated) {
+    const DecimationChainConfig config;
+    DecimationTaps taps = design_decimation_taps(config);
+    EXPECT_NO_THROW(DecimationChain(config, 2, taps));
+    taps.halfband.pop_back();
+    EXPECT_THROW(DecimationChain(config, 2, taps), std::invalid_argument);
+
+    const FftPlan plan(64);
+    EXPECT_NO_THROW(FftPlan(64, plan.bit_reversal(), plan.stage_twiddles(), plan.split_twiddles()));
+    EXPECT_THROW(FftPlan(128, plan.bit_reversal(), plan.stage_twiddles(), plan.split_twiddles()),
+                 std::invalid_argument);
+    std::vector<std::uint32_t> bitrev(plan.bit_reversal().begin(), plan.bit_reversal().end());
+    bitrev[5] = 32;  // one past the last complex point
+    EXPECT_THROW(FftPlan(64, bitrev, plan.stage_twiddles(), plan.split_twiddles()), std::invalid_argument);
+    bitrev[5] = bitrev[6];
+    EXPECT_THROW(FftPlan(64, bitrev, plan.stage_twiddles(), plan.split_twiddles()), std::invalid_argument);
+
+    EXPECT_THROW(CalibrationSnapshot::from_image(std::vector<std::byte>(12)), std::runtime_error);
+
+    Rig rig;
+    rig.config.calibration_files.push_back("/nonexistent/srm.cal");
+    EXPECT_THROW(rig.cache().load_or_build(rig.config), std::runtime_error);
+}
+
+}  // namespace
+}  // namespace srm::test
@@ -0,0 +1,169 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#include "srm/streaming_stats.hpp"
+
+namespace srm::test {
+namespace {
+
+/// Cut points splitting @p n samples into random chunks (first 0, last n).
+std::vector<std::size_t> random_cuts(std::size_t n, std::size_t pieces, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::size_t> pick(0, n);
+    std::vector<std::size_t> cuts = {0, n};
+    for (std::size_t i = 1; i < pieces; ++i) {
+        cuts.push_back(pick(rng));
+    }
+    std::sort(cuts.begin(), cuts.end());
+    return cuts;
+}
+
+TEST(MomentAccumulator, MatchesTwoPassDoubleReference) {
+    const ChannelBuffer<float> strain = synthetic_strain(1, 100003);
+    const std::span<const float> x = strain.channel(0);
+    double sum = 0.0;
+    for (const float v : x) {
+        sum += v;
+    }
+    const double mean = sum / static_cast<double>(x.size());
+    double m2 = 0.0;
+    for (const float v : x) {
+        m2 += (v - mean) * (v - mean);
+    }
+
+    MomentAccumulator whole;
+    whole.add(x);
+    EXPECT_EQ(whole.count, x.size());
+    EXPECT_NEAR(whole.mean, mean, 1e-12 * std::fabs(mean) + 1e-12);
+    EXPECT_NEAR(whole.m2, m2, 1e-11 * m2);
+    EXPECT_EQ(whole.min, *std::min_element(x.begin(), x.end()));
+    EXPECT_EQ(whole.max, *std::max_element(x.begin(), x.end()));
+
+    const std::vector<std::size_t> cuts = random_cuts(x.size(), 40, 3);
+    MomentAccumulator merged;
+    for (std::size_t i = 0; i + 1 < cuts.size(); ++i) {
+        MomentAccumulator part;
+        part.add(x.subspan(cuts[i], cuts[i + 1] - cuts[i]));
+        merged.merge(part);
+    }
+    EXPECT_EQ(merged.count, whole.count);
+    EXPECT_EQ(merged.min, whole.min);
+    EXPECT_EQ(merged.max, whole.max);
+    EXPECT_NEAR(merged.mean, whole.mean, 1e-12 * std::fabs(mean) + 1e-12);
+    EXPECT_NEAR(merged.m2, whole.m2, 1e-11 * m2);
+}
+
+TEST(QuantileSketch, WithinRelativeErrorAndMergesExactly) {
+    const ChannelBuffer<float> strain = synthetic_strain(1, 50000);
+    const std::span<const float> x = strain.channel(0);
+    std::vector<float> sorted(x.begin(), x.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    QuantileSketch whole;
+    whole.add(x);
+    // Half a sub-bucket, plus the zero bucket's absolute width.
+    const double relative = std::ldexp(1.0, -static_cast<int>(QuantileSketch::kSubBucketBits) - 1);
+    const double absolute = std::ldexp(1.0, QuantileSketch::kMinExponent);
+    double worst = 0.0;
+    for (const double q : {0.0, 0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999, 1.0}) {
+        const auto rank = static_cast<std::size_t>(std::ceil(q * static_cast<double>(sorted.size())));
+        const double exact = sorted[rank == 0 ? 0 : rank - 1];
+        const double estimate = whole.quantile(q);
+        EXPECT_LE(std::fabs(estimate - exact), relative * std::fabs(exact) + absolute) << "q = " << q;
+        worst = std::max(worst, std::fabs(estimate - exact) / (std::fabs(exact) + absolute));
+    }
+    RecordProperty("quantile_worst_relative_error", std::to_string(worst));
+
+    QuantileSketch merged;
+    const std::vector<std::size_t> cuts = random_cuts(x.size(), 9, 5);
+    for (std::size_t i = 0; i + 1 < cuts.size(); ++i) {
+        QuantileSketch part;
+        part.add(x.subspan(cuts[i], cuts[i + 1] - cuts[i]));
+        merged.merge(part);
+    }
+    for (const double q : {0.0, 0.01, 0.5, 0.99, 1.0}) {
+        EXPECT_EQ(merged.quantile(q), whole.quantile(q)) << "q = " << q;
+    }
+}
+
+TEST(RainflowCounter, CountsSineCyclesAndMergesExactly) {
+    RainflowConfig config;
+    config.lower_ue = -1000.0;
+    config.upper_ue = 1000.0;
+    config.levels = 40;
+    std::vector<float> sine;
+    for (std::size_t i = 0; i < 20 * 1000; ++i) {
+        sine.push_back(static_cast<float>(900.0 * std::sin(2.0 * std::numbers::pi * static_cast<double>(i) / 1000.0)));
+    }
+    RainflowCounter counter(config);
+    counter.add(sine);
+    EXPECT_GE(counter.closed_cycles(), 19u);
+    EXPECT_LE(counter.closed_cycles(), 20u);
+    // Every closed cycle spans the full swing: lowest to highest level hit.
+    std::uint64_t full = 0;
+    for (std::uint32_t low = 0; low < config.levels; ++low) {
+        for (std::uint32_t high = low + 1; high < config.levels; ++high) {
+            if (counter.cycles(low, high) != 0) {
+                EXPECT_NEAR(counter.level_value(high) - counter.level_value(low), 1800.0, 2 * counter.level_width());
+                full += counter.cycles(low, high);
+            }
+        }
+    }
+    EXPECT_EQ(full, counter.closed_cycles());
+
+    const ChannelBuffer<float> strain = synthetic_strain(1, 60000);
+    RainflowCounter whole;
+    whole.add(strain.channel(0));
+    const std::vector<std::size_t> cuts = random_cuts(strain.samples(), 17, 11);
+    RainflowCounter merged;
+    for (std::size_t i = 0; i + 1 < cuts.size(); ++i) {
+        RainflowCounter part;
+        part.add(strain.channel(0).subspan(cuts[i], cuts[i + 1] - cuts[i]));
+        merged.merge(part);
+    }
+    EXPECT_EQ(merged.closed_cycles(), whole.closed_cycles());
+    EXPECT_TRUE(std::equal(merged.residue().begin(), merged.residue().end(), whole.residue().begin(),
+                           whole.residue().end()));
+    for (std::uint32_t low = 0; low < whole.config().levels; ++low) {
+        for (std::uint32_t high = low + 1; high < whole.config().levels; ++high) {
+            ASSERT_EQ(merged.cycles(low, high), whole.cycles(low, high)) << low << "-" << high;
+        }
+    }
+    EXPECT_EQ(merged.damage(5.0), whole.damage(5.0));
+}
+
+TEST(StrainStatistics, ChunkedSummaryMatchesSinglePass) {
+    const ChannelBuffer<float> strain = synthetic_strain(5, 40000);
+    StrainStatistics whole(strain.channels());
+    whole.add(strain.view());
+    StrainStatistics merged;
+    const std::vector<std::size_t> cuts = random_cuts(strain.samples(), 6, 13);
+    for (std::size_t i = 0; i + 1 < cuts.size(); ++i) {
+        StrainStatistics part(strain.channels());
+        part.add(strain.view().subblock(cuts[i], cuts[i + 1] - cuts[i]));
+        merged.merge(part);
+    }
+    ASSERT_EQ(merged.channel_count(), whole.channel_count());
+    for (std::size_t c = 0; c < whole.channel_count(); ++c) {
+        const ChannelStatistics a = whole.summary(c);
+        const ChannelStatistics b = merged.summary(c);
+        EXPECT_EQ(a.count, b.count);
+        EXPECT_NEAR(a.mean, b.mean, 1e-9);
+        EXPECT_NEAR(a.rms, b.rms, 1e-9);
+        EXPECT_EQ(a.min, b.min);
+        EXPECT_EQ(a.max, b.max);
+        EXPECT_EQ(a.p01, b.p01);
+        EXPECT_EQ(a.p50, b.p50);
+        EXPECT_EQ(a.p99, b.p99);
+        EXPECT_EQ(a.rainflow_cycles, b.rainflow_cycles);
+    }
+    EXPECT_THROW(whole.add(ChannelBuffer<float>(4, 10).view()), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace srm::test
@@ -0,0 +1,210 @@
+#include "test_common.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "srm/acquisition.hpp"
+#include "srm/strain_watchdog.hpp"
+
+namespace srm::test {
+namespace {
+
+class RecordingOutput final : public TripOutput {
+public:
+    void trip(const TripEvent& event) noexcept override {
+        last = event;
+        ++trips;
+    }
+
+    TripEvent last;
+    int trips = 0;
+};
+
+std::uint64_t steady_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+std::int16_t counts_for(const ConversionParams& p, double microstrain) {
+    return static_cast<std::int16_t>(std::lround(strain_to_counts(p, microstrain)));
+}
+
+/// A block reading zero strain on every channel.
+ChannelBuffer<std::int16_t> quiet_block(std::span<const ConversionParams> params, std::size_t samples) {
+    ChannelBuffer<std::int16_t> block(params.size(), samples);
+    for (std::size_t c = 0; c < params.size(); ++c) {
+        std::fill_n(block.channel(c).data(), samples, counts_for(params[c], 0.0));
+    }
+    return block;
+}
+
+struct Rig {
+    explicit Rig(StrainLimit limit, std::size_t channels = 4)
+        : params(conversion_params(test_capture_info(channels))),
+          limits(channels, limit),
+          watchdog(WatchdogConfig{}, params, limits, output) {}
+
+    std::vector<ConversionParams> params;
+    std::vector<StrainLimit> limits;
+    RecordingOutput output;
+    StrainWatchdog watchdog;
+};
+
+// The count thresholds are the widest integer range whose every value
+// reads within the limit, on every bridge type.
+TEST(StrainWatchdog, CountLimitsMatchThePeakInStrain) {
+    Rig rig({.peak_ue = 1500.0});
+    for (std::size_t c = 0; c < rig.params.size(); ++c) {
+        const StrainWatchdog::CountLimits lim = rig.watchdog.count_limits(c);
+        const ConversionParams& p = rig.params[c];
+        EXPECT_LE(std::fabs(convert_sample(p, static_cast<std::int16_t>(lim.low))), 1500.0f) << "channel " << c;
+        EXPECT_LE(std::fabs(convert_sample(p, static_cast<std::int16_t>(lim.high))), 1500.0f) << "channel " << c;
+        EXPECT_GT(std::fabs(convert_sample(p, static_cast<std::int16_t>(lim.low - 1))), 1500.0f) << "channel " << c;
+        EXPECT_GT(std::fabs(convert_sample(p, static_cast<std::int16_t>(lim.high + 1))), 1500.0f) << "channel " << c;
+    }
+}
+
+TEST(StrainWatchdog, PeakTripsAtTheFirstViolation) {
+    Rig rig({.peak_ue = 1500.0});
+    ChannelBuffer<std::int16_t> block = quiet_block(rig.params, 256);
+    EXPECT_FALSE(rig.watchdog.check(block.view(), 0, steady_ns()));
+    EXPECT_FALSE(rig.watchdog.tripped());
+
+    block.channel(3)[200] = counts_for(rig.params[3], -1600.0);
+    block.channel(1)[90] = counts_for(rig.params[1], 1600.0);
+    block.channel(2)[91] = counts_for(rig.params[2], 1600.0);
+    EXPECT_TRUE(rig.watchdog.check(block.view(), 256, steady_ns()));
+    ASSERT_TRUE(rig.watchdog.tripped());
+    const TripEvent event = rig.watchdog.trip_event();
+    EXPECT_EQ(event.channel, 1u);
+    EXPECT_EQ(event.sample, 256u + 90u);
+    EXPECT_EQ(event.reason, TripReason::Peak);
+    EXPECT_EQ(event.counts, block.channel(1)[90]);
+    EXPECT_EQ(rig.output.trips, 1);
+    EXPECT_EQ(rig.output.last.sample, event.sample);
+    EXPECT_EQ(rig.watchdog.blocks_checked(), 2u);
+}
+
+// A ramp at exactly the largest admissible step passes; one count more
+// trips.
+TEST(StrainWatchdog, RateTripsOnAStepButNotARamp) {
+    Rig rig({.rate_ue_per_s = 2e8});
+    const std::int32_t step = rig.watchdog.count_limits(0).max_step;
+    ASSERT_GT(step, 0);
+    ASSERT_LT(step, 1000);
+    ChannelBuffer<std::int16_t> block = quiet_block(rig.params, 64);
+    for (std::size_t i = 0; i < block.samples(); ++i) {
+        block.channel(0)[i] = static_cast<std::int16_t>((static_cast<std::int32_t>(i) - 32) * step);
+    }
+    EXPECT_FALSE(rig.watchdog.check(block.view(), 0, steady_ns()));
+
+    block.channel(0)[40] = static_cast<std::int16_t>(block.channel(0)[40] + 1);
+    // After a gap, so only the step inside the block can trip.
+    EXPECT_TRUE(rig.watchdog.check(block.view(), 1000, steady_ns()));
+    const TripEvent event = rig.watchdog.trip_event();
+    EXPECT_EQ(event.channel, 0u);
+    EXPECT_EQ(event.reason, TripReason::Rate);
+    EXPECT_EQ(event.sample, 1040u);
+}
+
+// The rate check only spans blocks that follow on without a gap.
+TEST(StrainWatchdog, RateCheckNeedsAContinuousStream) {
+    Rig rig({.rate_ue_per_s = 2e8});
+    const std::int32_t step = rig.watchdog.count_limits(2).max_step;
+    ChannelBuffer<std::int16_t> low = quiet_block(rig.params, 32);
+    ChannelBuffer<std::int16_t> high = quiet_block(rig.params, 32);
+    std::fill_n(high.channel(2).data(), high.samples(), static_cast<std::int16_t>(low.channel(2)[0] + 4 * step));
+
+    EXPECT_FALSE(rig.watchdog.check(low.view(), 0, steady_ns()));
+    EXPECT_FALSE(rig.watchdog.check(high.view(), 1000, steady_ns()));  // gap: no previous sample
+    EXPECT_FALSE(rig.watchdog.check(high.view(), 1032, steady_ns()));
+    EXPECT_TRUE(rig.watchdog.check(low.view(), 1064, steady_ns()));
+    const TripEvent event = rig.watchdog.trip_event();
+    EXPECT_EQ(event.channel, 2u);
+    EXPECT_EQ(event.sample, 1064u);
+    EXPECT_EQ(event.reason, TripReason::Rate);
+}
+
+TEST(StrainWatchdog, LatchesUntilRearmed) {
+    Rig rig({.peak_ue = 1500.0});
+    ChannelBuffer<std::int16_t> block = quiet_block(rig.params, 16);
+    block.channel(0)[5] = counts_for(rig.params[0], 2000.0);
+    EXPECT_TRUE(rig.watchdog.check(block.view(), 0, steady_ns()));
+    block.channel(0)[5] = counts_for(rig.params[0], 0.0);
+    block.channel(2)[3] = counts_for(rig.params[2], -2000.0);
+    EXPECT_TRUE(rig.watchdog.check(block.view(), 16, steady_ns()));
+    EXPECT_EQ(rig.output.trips, 1);
+    EXPECT_EQ(rig.watchdog.trip_event().sample, 5u);
+
+    rig.watchdog.rearm();
+    EXPECT_FALSE(rig.watchdog.tripped());
+    EXPECT_TRUE(rig.watchdog.check(block.view(), 32, steady_ns()));
+    EXPECT_EQ(rig.output.trips, 2);
+    EXPECT_EQ(rig.watchdog.trip_event().channel, 2u);
+    EXPECT_EQ(rig.watchdog.trip_event().sample, 35u);
+}
+
+// A block narrower (or wider) than the limit table would leave channels
+// unchecked, so it trips instead.
+TEST(StrainWatchdog, ChannelCountMismatchTrips) {
+    Rig rig({.peak_ue = 1500.0});
+    const ChannelBuffer<std::int16_t> narrow = quiet_block(std::span(rig.params).first(3), 16);
+    EXPECT_TRUE(rig.watchdog.check(narrow.view(), 0, steady_ns()));
+    const TripEvent event = rig.watchdog.trip_event();
+    EXPECT_EQ(event.reason, TripReason::ChannelCount);
+    EXPECT_EQ(event.channel, 3u);
+    EXPECT_EQ(rig.output.trips, 1);
+}
+
+// The histogram runs from a block's first sample, so the time taken to
+// acquire the block counts.
+TEST(StrainWatchdog, LatencyIncludesAcquiringTheBlock) {
+    Rig rig({.peak_ue = 1500.0});
+    const ChannelBuffer<std::int16_t> block = quiet_block(rig.params, 2000);  // 2 ms at 1 MS/s
+    EXPECT_FALSE(rig.watchdog.check(block.view(), 0, steady_ns() - 1'000'000));
+    EXPECT_EQ(rig.watchdog.latency().count(), 1u);
+    EXPECT_GE(rig.watchdog.latency().min(), 1'000'000u);
+}
+
+// End to end on the watchdog thread: blocks from the acquisition are
+// checked, returned to the card, and the first violation latches.
+TEST(StrainWatchdog, TripsFromTheWatchdogThread) {
+    const CaptureInfo info = test_capture_info(4);
+    AcquisitionConfig acq;
+    acq.channels = info.channels.size();
+    acq.samples_per_block = 1024;
+    acq.buffer_count = 4;
+    acq.lock_memory = false;
+    SimulatedDmaDriver::Options options;
+    options.info = info;
+    options.signal.strain_channels = info.channels.size();
+    options.real_time = false;
+    DmaAcquisition acquisition(std::make_unique<SimulatedDmaDriver>(options), acq);
+
+    const std::vector<ConversionParams> params = conversion_params(info);
+    const std::vector<StrainLimit> limits(params.size(), StrainLimit{.peak_ue = 1.0});
+    RecordingOutput output;
+    StrainWatchdog watchdog(WatchdogConfig{}, params, limits, output);
+    watchdog.start();
+    acquisition.start();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!watchdog.tripped() && std::chrono::steady_clock::now() < deadline) {
+        if (BlockHandle block = acquisition.next(std::chrono::milliseconds(100))) {
+            watchdog.submit(std::move(block));
+        }
+    }
+    watchdog.stop();
+    acquisition.stop();
+
+    ASSERT_TRUE(watchdog.tripped());
+    EXPECT_EQ(watchdog.trip_event().reason, TripReason::Peak);
+    EXPECT_GE(watchdog.blocks_checked(), 1u);
+    EXPECT_EQ(acquisition.buffers_in_use(), 0u);
+}
+
+}  // namespace
+}  // namespace srm::test
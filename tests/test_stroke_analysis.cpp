@@ -0,0 +1,293 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "srm/capture_file.hpp"
+#include "srm/commutation_index.hpp"
+#include "srm/stroke_analysis.hpp"
+
+namespace srm::test {
+namespace {
+
+/// Phase currents with edges at known samples: phase p conducts for
+/// [start, start + width) of every period, with ripple around the
+/// thresholds that the hysteresis must ride out.
+struct CommutatedCurrents {
+    static constexpr std::size_t kPeriod = 997;
+    static constexpr std::size_t kWidth = 400;
+
+    explicit CommutatedCurrents(std::size_t phases, std::size_t samples) : currents(phases, samples) {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> ripple(-0.3f, 0.3f);
+        on.resize(phases);
+        off.resize(phases);
+        for (std::size_t p = 0; p < phases; ++p) {
+            const std::size_t start = 50 + p * kPeriod / phases;
+            for (std::size_t i = 0; i < samples; ++i) {
+                const bool conducting = i >= start && (i - start) % kPeriod < kWidth;
+                // 0.2..0.8 while off and 1.7..2.3 while on: between the
+                // thresholds the ripple never crosses the far one.
+                currents.channel(p)[i] = (conducting ? 2.0f : 0.5f) + ripple(rng);
+                if (i >= start && (i - start) % kPeriod == 0) {
+                    on[p].push_back(i);
+                }
+                if (i >= start + kWidth && (i - start) % kPeriod == kWidth) {
+                    off[p].push_back(i);
+                }
+            }
+        }
+    }
+
+    ChannelBuffer<float> currents;
+    std::vector<std::vector<std::uint64_t>> on;
+    std::vector<std::vector<std::uint64_t>> off;
+};
+
+TEST(CommutationIndex, EdgesMatchTheConstructionInAnyBlocking) {
+    const std::size_t samples = 20'000;
+    const CommutatedCurrents signal(4, samples);
+    const std::vector<EdgeDetectorConfig> config(4, EdgeDetectorConfig{.on_threshold = 1.2f, .off_threshold = 1.0f});
+    for (const std::size_t block : {std::size_t{1}, std::size_t{333}, samples}) {
+        CommutationIndexBuilder builder(config);
+        for (std::size_t pos = 0; pos < samples; pos += block) {
+            builder.push(signal.currents.view().subblock(pos, std::min(block, samples - pos)));
+        }
+        EXPECT_EQ(builder.samples_seen(), samples);
+        const CommutationIndex& index = builder.index();
+        ASSERT_EQ(index.phase_count(), 4u);
+        for (std::size_t p = 0; p < 4; ++p) {
+            const std::span<const std::uint64_t> on = index.edges(p, EdgeKind::TurnOn);
+            const std::span<const std::uint64_t> off = index.edges(p, EdgeKind::TurnOff);
+            EXPECT_TRUE(std::equal(on.begin(), on.end(), signal.on[p].begin(), signal.on[p].end()))
+                << "phase " << p << ", blocks of " << block;
+            EXPECT_TRUE(std::equal(off.begin(), off.end(), signal.off[p].begin(), signal.off[p].end()))
+                << "phase " << p << ", blocks of " << block;
+        }
+    }
+}
+
+// Without hysteresis the ripple chatters around a single threshold; the
+// dwell time must swallow the chatter and keep the first edge of each
+// burst.
+TEST(CommutationIndex, DwellSuppressesChatter) {
+    ChannelBuffer<float> current(1, 300);
+    std::fill_n(current.channel(0).data(), 300, 0.0f);
+    for (std::size_t i = 100; i < 200; ++i) {
+        current.channel(0)[i] = i < 110 && i % 2 == 1 ? 0.0f : 2.0f;  // chatters 100..109
+    }
+    const EdgeDetectorConfig chatty{.on_threshold = 1.0f, .off_threshold = 1.0f};
+    CommutationIndexBuilder raw(std::span(&chatty, 1));
+    raw.push(current.view());
+    EXPECT_EQ(raw.index().edges(0, EdgeKind::TurnOn).size(), 6u);
+
+    const EdgeDetectorConfig dwell{.on_threshold = 1.0f, .off_threshold = 1.0f, .min_dwell = 20};
+    CommutationIndexBuilder builder(std::span(&dwell, 1));
+    builder.push(current.view().subblock(0, 105));
+    builder.push(current.view().subblock(105, 195));
+    const CommutationIndex index = builder.take();
+    ASSERT_EQ(index.edges(0, EdgeKind::TurnOn).size(), 1u);
+    ASSERT_EQ(index.edges(0, EdgeKind::TurnOff).size(), 1u);
+    EXPECT_EQ(index.edges(0, EdgeKind::TurnOn)[0], 100u);
+    EXPECT_EQ(index.edges(0, EdgeKind::TurnOff)[0], 200u);
+}
+
+TEST(CommutationIndex, RangeQueriesAndValidation) {
+    CommutationIndex index(2);
+    const std::vector<std::uint64_t> edges = {3, 10, 10, 25, 40, 41, 99};
+    for (const std::uint64_t e : edges) {
+        index.append(1, EdgeKind::TurnOff, e);
+    }
+    EXPECT_THROW(index.append(1, EdgeKind::TurnOff, 98), std::invalid_argument);
+    EXPECT_TRUE(index.edges(0, EdgeKind::TurnOff).empty());
+    EXPECT_GE(index.memory_bytes(), edges.size() * sizeof(std::uint64_t));
+    for (std::uint64_t first = 0; first < 105; first += 3) {
+        for (std::uint64_t end = first; end < 110; end += 7) {
+            std::vector<std::uint64_t> expected;
+            std::copy_if(edges.begin(), edges.end(), std::back_inserter(expected),
+                         [&](std::uint64_t e) { return first <= e && e < end; });
+            const std::span<const std::uint64_t> got = index.edges(1, EdgeKind::TurnOff, first, end);
+            ASSERT_TRUE(std::equal(got.begin(), got.end(), expected.begin(), expected.end()))
+                << "[" << first << ", " << end << ")";
+        }
+    }
+
+    const EdgeDetectorConfig inverted{.on_threshold = 1.0f, .off_threshold = 1.5f};
+    EXPECT_THROW(CommutationIndexBuilder(std::span(&inverted, 1)), std::invalid_argument);
+    const std::vector<EdgeDetectorConfig> two(2);
+    CommutationIndexBuilder builder(two);
+    const ChannelBuffer<float> three(3, 10);
+    EXPECT_THROW(builder.push(three.view()), std::invalid_argument);
+}
+
+// Ensemble mean and deviation against a direct double-precision pass over
+// the same windows, the edge at the start being dropped for want of
+// pre-trigger samples.
+TEST(StrokeAnalysis, ProfileMatchesReference) {
+    const std::size_t samples = 20'000;
+    const CommutatedCurrents signal(4, samples);
+    CommutationIndexBuilder builder(
+        std::vector<EdgeDetectorConfig>(4, EdgeDetectorConfig{.on_threshold = 1.2f, .off_threshold = 1.0f}));
+    builder.push(signal.currents.view());
+    const ChannelBuffer<float> strain = synthetic_strain(2, samples);
+    const BlockSource source(strain.view());
+
+    const StrokeWindow window{.pre_samples = 60, .length = 200};
+    const std::uint64_t first = 1000;
+    const std::uint64_t end = 15'000;
+    const StrokeProfile profile =
+        average_stroke_profile(builder.index(), 0, EdgeKind::TurnOn, source, 1, window, 0, end);
+    const StrokeProfile later =
+        average_stroke_profile(builder.index(), 0, EdgeKind::TurnOn, source, 1, window, first, end);
+
+    for (const auto& [got, from] : {std::pair{&profile, std::uint64_t{0}}, std::pair{&later, first}}) {
+        std::vector<std::uint64_t> used;
+        for (const std::uint64_t e : signal.on[0]) {
+            if (from <= e && e < end && e >= window.pre_samples) {
+                used.push_back(e);
+            }
+        }
+        ASSERT_EQ(got->strokes, used.size());
+        ASSERT_EQ(got->mean.size(), window.length);
+        ErrorBudget mean_budget("stroke_profile_mean", 1e-4, 4);
+        ErrorBudget stddev_budget("stroke_profile_stddev", 1e-4, 16);
+        for (std::size_t i = 0; i < window.length; ++i) {
+            double sum = 0.0;
+            for (const std::uint64_t e : used) {
+                sum += strain.channel(1)[e - window.pre_samples + i];
+            }
+            const double mean = sum / static_cast<double>(used.size());
+            double var = 0.0;
+            for (const std::uint64_t e : used) {
+                const double d = strain.channel(1)[e - window.pre_samples + i] - mean;
+                var += d * d;
+            }
+            mean_budget.add(mean, got->mean[i]);
+            stddev_budget.add(std::sqrt(var / static_cast<double>(used.size())), got->stddev[i]);
+        }
+        if (from == 0) {
+            mean_budget.record();
+            stddev_budget.record();
+        }
+        EXPECT_TRUE(mean_budget.within()) << mean_budget;
+        EXPECT_TRUE(stddev_budget.within()) << stddev_budget;
+    }
+
+    // Windows running off the end are skipped; no windows, no strokes.
+    const StrokeProfile tail = average_stroke_profile(builder.index(), 0, EdgeKind::TurnOn, source, 1,
+                                                      {.pre_samples = 0, .length = samples}, 1);
+    EXPECT_EQ(tail.strokes, 0u);
+    EXPECT_EQ(tail.mean.size(), samples);
+    EXPECT_EQ(tail.mean[0], 0.0f);
+    EXPECT_THROW(average_stroke_profile(builder.index(), 4, EdgeKind::TurnOn, source, 1, window),
+                 std::out_of_range);
+}
+
+// Strain that is the current delayed by a known lag, plus noise: the
+// coefficients must match a direct Pearson computation and peak at the
+// lag.
+TEST(StrokeAnalysis, CrossCorrelationMatchesReference) {
+    const std::size_t samples = 20'000;
+    const CommutatedCurrents signal(1, samples);
+    CommutationIndexBuilder builder(std::vector<EdgeDetectorConfig>(1, {.on_threshold = 1.2f, .off_threshold = 1.0f}));
+    builder.push(signal.currents.view());
+
+    constexpr std::size_t kDelay = 7;
+    ChannelBuffer<float> channels(2, samples);
+    std::mt19937 rng(3);
+    std::normal_distribution<float> noise(0.0f, 0.2f);
+    for (std::size_t i = 0; i < samples; ++i) {
+        channels.channel(0)[i] = signal.currents.channel(0)[i];
+        channels.channel(1)[i] = 30.0f * signal.currents.channel(0)[i >= kDelay ? i - kDelay : 0] + noise(rng);
+    }
+    const BlockSource source(channels.view(), 0);
+    const StrokeWindow window{.pre_samples = 20, .length = 64};
+    const std::size_t max_lag = 12;
+    const StrokeCorrelation correlation =
+        stroke_cross_correlation(builder.index(), 0, EdgeKind::TurnOn, source, 0, 1, window, max_lag);
+    // Strokes whose lagged strain window the source holds in full.
+    std::vector<std::uint64_t> used;
+    for (const std::uint64_t e : signal.on[0]) {
+        if (e >= window.pre_samples + max_lag && e - window.pre_samples + window.length + max_lag <= samples) {
+            used.push_back(e);
+        }
+    }
+    ASSERT_LT(used.size(), signal.on[0].size());
+    ASSERT_EQ(correlation.coefficient.size(), 2 * max_lag + 1);
+    EXPECT_EQ(correlation.strokes, used.size());
+    EXPECT_EQ(correlation.peak_lag(), static_cast<std::ptrdiff_t>(kDelay));
+    EXPECT_GT(correlation.coefficient[max_lag + kDelay], 0.95f);
+
+    ErrorBudget budget("stroke_cross_correlation", 1e-5, 16);
+    for (std::size_t l = 0; l < correlation.coefficient.size(); ++l) {
+        double acc = 0.0;
+        for (const std::uint64_t e : used) {
+            const std::size_t start = e - window.pre_samples;
+            const std::ptrdiff_t lag = static_cast<std::ptrdiff_t>(l) - static_cast<std::ptrdiff_t>(max_lag);
+            double mi = 0.0;
+            double ms = 0.0;
+            for (std::size_t t = 0; t < window.length; ++t) {
+                mi += channels.channel(0)[start + t];
+                ms += channels.channel(1)[static_cast<std::size_t>(static_cast<std::ptrdiff_t>(start + t) + lag)];
+            }
+            mi /= static_cast<double>(window.length);
+            ms /= static_cast<double>(window.length);
+            double cov = 0.0;
+            double vi = 0.0;
+            double vs = 0.0;
+            for (std::size_t t = 0; t < window.length; ++t) {
+                const double di = channels.channel(0)[start + t] - mi;
+                const double ds =
+                    channels.channel(1)[static_cast<std::size_t>(static_cast<std::ptrdiff_t>(start + t) + lag)] - ms;
+                cov += di * ds;
+                vi += di * di;
+                vs += ds * ds;
+            }
+            acc += cov / std::sqrt(vi * vs);
+        }
+        budget.add(acc / static_cast<double>(used.size()), correlation.coefficient[l]);
+    }
+    budget.record();
+    EXPECT_TRUE(budget.within()) << budget;
+}
+
+// The capture-backed source reads across chunk boundaries, refuses gaps,
+// and converts to strain only where asked.
+TEST(StrokeAnalysis, CaptureSourceMatchesTheBlock) {
+    const ScratchFile file(".srmcap");
+    const CaptureInfo info = test_capture_info(2);
+    const ChannelBuffer<std::int16_t> counts = synthetic_counts(info, 3000);
+    {
+        CaptureWriter writer(file.path(), info);
+        writer.write_chunk(counts.view().subblock(0, 1000), 0);
+        writer.write_chunk(counts.view().subblock(1000, 1000), 1000);
+        writer.write_chunk(counts.view().subblock(2500, 500), 2500);  // gap 2000..2499
+        writer.finish();
+    }
+    const CaptureReader reader(file.path());
+    CaptureSource source(reader);
+    source.set_strain_conversion(1, make_conversion_params(info.channels[1]));
+    EXPECT_THROW(source.set_strain_conversion(2, {}), std::out_of_range);
+
+    std::vector<float> out(600);
+    ASSERT_TRUE(source.read(0, 700, out));
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        ASSERT_EQ(out[i], static_cast<float>(counts.channel(0)[700 + i])) << i;
+    }
+    ASSERT_TRUE(source.read(1, 700, out));
+    const ConversionParams p = make_conversion_params(info.channels[1]);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        ASSERT_EQ(out[i], convert_sample(p, counts.channel(1)[700 + i])) << i;
+    }
+    EXPECT_FALSE(source.read(0, 1800, out));   // runs into the gap
+    EXPECT_TRUE(source.read(0, 2400 + 100, std::span(out).first(500)));
+    EXPECT_FALSE(source.read(0, 2900, out));   // past the end
+    EXPECT_FALSE(source.read(2, 0, out));
+}
+
+}  // namespace
+}  // namespace srm::test
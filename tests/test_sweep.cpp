@@ -0,0 +1,328 @@
+#include "test_common.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "srm/sweep.hpp"
+
+namespace srm::test {
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = Executor::Clock;
+
+double since(Clock::time_point start, Clock::time_point t) {
+    return std::chrono::duration<double>(t - start).count();
+}
+
+Task<int> add_one(Executor& executor, int x) {
+    co_await executor.sleep_for(1ms);
+    co_return x + 1;
+}
+
+Task<int> add_three(Executor& executor, int x) {
+    const int a = co_await add_one(executor, x);
+    const int b = co_await add_one(executor, a);
+    co_return co_await add_one(executor, b);
+}
+
+Task<> fail(Executor& executor) {
+    co_await executor.yield();
+    throw std::runtime_error("instrument offline");
+}
+
+TEST(Executor, TasksTimersAndPoolJobs) {
+    Executor executor;
+    const Clock::time_point start = Clock::now();
+    EXPECT_EQ(executor.run(add_three(executor, 1)), 4);
+    EXPECT_GE(Clock::now() - start, 3ms);
+    EXPECT_THROW(executor.run(fail(executor)), std::runtime_error);
+
+    WorkStealingPool pool(2);
+    const auto offloaded = [&]() -> Task<int> {
+        PoolJob<int> slow = executor.offload(pool, [] {
+            std::this_thread::sleep_for(20ms);
+            return 20;
+        });
+        PoolJob<int> quick = executor.offload(pool, [] { return 1; });
+        PoolJob<void> broken = executor.offload(pool, [] { throw std::invalid_argument("bad point"); });
+        // The loop keeps timing while both jobs run.
+        const int ticks = co_await add_three(executor, 0);
+        int total = ticks + co_await quick + co_await slow;
+        try {
+            co_await broken;
+        } catch (const std::invalid_argument&) {
+            total += 100;
+        }
+        co_return total;
+    };
+    EXPECT_EQ(executor.run(offloaded()), 124);
+
+    // A coroutine that suspends on something the executor cannot resume.
+    const auto stuck = []() -> Task<> { co_await std::suspend_always{}; };
+    EXPECT_THROW(executor.run(stuck()), std::logic_error);
+    EXPECT_EQ(executor.run(add_one(executor, 41)), 42);  // still usable
+}
+
+TEST(Executor, DescriptorReadiness) {
+    int fds[2];
+    ASSERT_EQ(::pipe2(fds, O_CLOEXEC | O_NONBLOCK), 0);
+    Executor executor;
+    WorkStealingPool pool(1);
+    const auto reply = [&]() -> Task<std::string> {
+        // Nothing arrives: the wait times out.
+        const bool early = co_await executor.readable(fds[0], Clock::now() + 5ms);
+        EXPECT_FALSE(early);
+        PoolJob<void> writer = executor.offload(pool, [&] {
+            std::this_thread::sleep_for(10ms);
+            EXPECT_EQ(::write(fds[1], "OK\n", 3), 3);
+        });
+        const bool ready = co_await executor.readable(fds[0], Clock::now() + 5s);
+        co_await writer;
+        char buffer[8] = {};
+        if (!ready || ::read(fds[0], buffer, sizeof(buffer)) != 3) {
+            co_return std::string();
+        }
+        co_return std::string(buffer);
+    };
+    EXPECT_EQ(executor.run(reply()), "OK\n");
+    EXPECT_TRUE(executor.run([&]() -> Task<bool> { co_return co_await executor.writable(fds[1]); }()));
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST(Sweep, SettlingDetector) {
+    SettlingCriterion criterion;
+    criterion.window = 1s;
+    criterion.band = 0.5;
+    criterion.tolerance = 1.0;
+    SettlingDetector detector(criterion, 100.0);
+    const Clock::time_point t0{};
+    // Converging first-order response, read every 100 ms.
+    std::size_t settled_at = 0;
+    for (std::size_t k = 0; k <= 60 && settled_at == 0; ++k) {
+        const double value = 100.0 - 20.0 * std::exp(-0.1 * static_cast<double>(k));
+        if (detector.add(t0 + k * 100ms, value)) {
+            settled_at = k;
+        }
+    }
+    // Within 1.0 of the target from k = 30, but the 1 s window keeps
+    // spanning more than 0.5 until k = 43 (0.515 back from k = 42).
+    EXPECT_EQ(settled_at, 43u);
+
+    SettlingDetector band_only(criterion);
+    EXPECT_FALSE(band_only.add(t0, 5.0));  // no full window yet
+    EXPECT_FALSE(band_only.add(t0 + 500ms, 5.2));
+    EXPECT_TRUE(band_only.add(t0 + 1s, 5.4));
+    EXPECT_FALSE(band_only.add(t0 + 1100ms, 5.9));
+    EXPECT_THROW(band_only.add(t0, 5.0), std::invalid_argument);
+    criterion.window = 0s;
+    EXPECT_THROW(SettlingDetector{criterion}, std::invalid_argument);
+}
+
+// ---- Simulated rig ----
+//
+// Speed and winding temperature follow first-order lags towards their
+// setpoints; every instrument call costs link latency on the executor.
+
+struct Timeline {
+    std::vector<Clock::time_point> capture_begin, capture_end, analysis_begin, analysis_end;
+    std::mutex mutex;  // analysis times come from pool threads
+};
+
+class SimulatedRig final : public MotorDrive, public Dynamometer, public TemperatureLogger, public DaqRecorder {
+public:
+    explicit SimulatedRig(Executor& executor) : executor_(executor) {}
+
+    Task<> apply(const OperatingPoint& point) override {
+        co_await executor_.sleep_for(1ms);
+        temperature_from_ = temperature_at(Clock::now());
+        heat_start_ = Clock::now();
+        temperature_target_ = 40.0 + 0.5 * point.current_a;
+    }
+    Task<> set_speed(double rpm) override {
+        co_await executor_.sleep_for(1ms);
+        speed_from_ = speed_at(Clock::now());
+        speed_start_ = Clock::now();
+        speed_target_ = rpm;
+    }
+    Task<double> speed_rpm() override {
+        co_await executor_.sleep_for(200us);
+        co_return speed_at(Clock::now());
+    }
+    Task<double> read_celsius() override {
+        co_await executor_.sleep_for(200us);
+        if (timeline.capture_begin.size() >= offline_after_) {
+            throw std::runtime_error("logger offline");
+        }
+        co_return temperature_at(Clock::now()) + (noisy_ ? 2.0 * std::sin(++noise_phase_) : 0.0);
+    }
+    Task<std::filesystem::path> capture(const OperatingPoint&, std::size_t index) override {
+        timeline.capture_begin.push_back(Clock::now());
+        co_await executor_.sleep_for(20ms);
+        timeline.capture_end.push_back(Clock::now());
+        co_return std::filesystem::path("point_" + std::to_string(index) + ".srmcap");
+    }
+
+    SweepRig rig() { return {*this, *this, *this, *this}; }
+
+    Timeline timeline;
+    bool noisy_ = false;
+    std::size_t offline_after_ = std::numeric_limits<std::size_t>::max();  // captures
+
+private:
+    double speed_at(Clock::time_point t) const {
+        return speed_target_ + (speed_from_ - speed_target_) * std::exp(-since(speed_start_, t) / 0.002);
+    }
+    double temperature_at(Clock::time_point t) const {
+        return temperature_target_ +
+               (temperature_from_ - temperature_target_) * std::exp(-since(heat_start_, t) / 0.004);
+    }
+
+    Executor& executor_;
+    double speed_from_ = 0.0, speed_target_ = 0.0;
+    double temperature_from_ = 25.0, temperature_target_ = 25.0;
+    Clock::time_point speed_start_ = Clock::now(), heat_start_ = Clock::now();
+    int noise_phase_ = 0;
+};
+
+SweepOptions fast_options() {
+    SweepOptions options;
+    options.speed.poll_interval = 500us;
+    options.speed.window = 2ms;
+    options.speed.tolerance = 1.0;
+    options.thermal.poll_interval = 500us;
+    options.thermal.window = 3ms;
+    options.thermal.band = 0.05;
+    options.speed.timeout = options.thermal.timeout = 200ms;
+    return options;
+}
+
+const std::vector<OperatingPoint> kPoints = {
+    {1000.0, 10.0, 0.0, 150.0},
+    {2000.0, 20.0, 0.0, 150.0},
+    {3000.0, 30.0, -10.0, 140.0},
+    {4000.0, 40.0, -20.0, 130.0},
+};
+
+TEST(Sweep, AnalysisOverlapsNextPoint) {
+    Executor executor;
+    WorkStealingPool pool(2);
+    SimulatedRig sim(executor);
+    Timeline& timeline = sim.timeline;
+    const auto analyse = [&](const OperatingPoint& point, const std::filesystem::path& path) {
+        {
+            std::lock_guard lock(timeline.mutex);
+            timeline.analysis_begin.push_back(Clock::now());
+        }
+        std::this_thread::sleep_for(40ms);
+        {
+            std::lock_guard lock(timeline.mutex);
+            timeline.analysis_end.push_back(Clock::now());
+        }
+        return path.string() + "@" + std::to_string(static_cast<int>(point.current_a));
+    };
+
+    const Clock::time_point start = Clock::now();
+    const auto rows = executor.run(run_sweep(executor, pool, sim.rig(), kPoints, analyse, fast_options()));
+    const double wall = since(start, Clock::now());
+
+    ASSERT_EQ(rows.size(), kPoints.size());
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        ASSERT_TRUE(rows[i].ok()) << rows[i].error;
+        EXPECT_TRUE(rows[i].speed.settled);
+        EXPECT_TRUE(rows[i].thermal.settled);
+        EXPECT_NEAR(rows[i].speed.value, kPoints[i].speed_rpm, 1.0);
+        EXPECT_NEAR(rows[i].thermal.value, 40.0 + 0.5 * kPoints[i].current_a, 0.05);
+        EXPECT_EQ(rows[i].result, "point_" + std::to_string(i) + ".srmcap@" + std::to_string(10 * (i + 1)));
+    }
+    // Each analysis was still running when the next capture started.
+    ASSERT_EQ(timeline.analysis_end.size(), kPoints.size());
+    for (std::size_t i = 0; i + 1 < kPoints.size(); ++i) {
+        EXPECT_GT(timeline.analysis_end[i], timeline.capture_begin[i + 1]) << "point " << i;
+        EXPECT_GE(timeline.analysis_begin[i], timeline.capture_end[i]) << "point " << i;
+    }
+    double sequential = 0.0;
+    for (std::size_t i = 0; i < kPoints.size(); ++i) {
+        sequential += since(timeline.analysis_begin[i], timeline.analysis_end[i]);
+    }
+    sequential += since(start, timeline.capture_end.back());
+    RecordProperty("sweep_wall_fraction", std::to_string(wall / sequential));
+    EXPECT_LT(wall, sequential);
+}
+
+TEST(Sweep, UnsettledPointsAndFailures) {
+    Executor executor;
+    WorkStealingPool pool(1);
+    const auto analyse = [](const OperatingPoint& point, const std::filesystem::path&) {
+        if (point.current_a == 20.0) {
+            throw std::domain_error("no commutation edges");
+        }
+        return point.current_a;
+    };
+    {
+        SimulatedRig sim(executor);
+        const auto rows = executor.run(run_sweep(executor, pool, sim.rig(), kPoints, analyse, fast_options()));
+        EXPECT_TRUE(rows[0].ok());
+        EXPECT_EQ(rows[0].result, 10.0);
+        EXPECT_TRUE(rows[1].captured);
+        EXPECT_EQ(rows[1].error, "no commutation edges");
+        EXPECT_TRUE(rows[3].ok());
+    }
+
+    SweepOptions options = fast_options();
+    options.thermal.timeout = 10ms;
+    {
+        SimulatedRig sim(executor);
+        sim.noisy_ = true;
+        const auto rows = executor.run(run_sweep(executor, pool, sim.rig(), kPoints, analyse, options));
+        for (const auto& row : rows) {
+            EXPECT_TRUE(row.speed.settled);
+            EXPECT_FALSE(row.thermal.settled);
+            EXPECT_FALSE(row.captured);
+        }
+        EXPECT_TRUE(sim.timeline.capture_begin.empty());
+
+        options.unsettled = UnsettledPolicy::Capture;
+        const auto anyway = executor.run(run_sweep(executor, pool, sim.rig(), kPoints, analyse, options));
+        EXPECT_TRUE(anyway[0].ok());
+        EXPECT_FALSE(anyway[0].thermal.settled);
+
+        options.unsettled = UnsettledPolicy::Abort;
+        EXPECT_THROW(executor.run(run_sweep(executor, pool, sim.rig(), kPoints, analyse, options)),
+                     std::runtime_error);
+    }
+
+    // An instrument fault ends the sweep only after the analyses started
+    // before it have finished.
+    SimulatedRig sim(executor);
+    sim.offline_after_ = 2;
+    std::atomic<int> finished{0};
+    const auto slow = [&](const OperatingPoint& point, const std::filesystem::path&) {
+        std::this_thread::sleep_for(30ms);
+        ++finished;
+        return point.current_a;
+    };
+    const auto faulty = [&]() -> Task<int> {
+        try {
+            co_await run_sweep(executor, pool, sim.rig(), kPoints, slow, fast_options());
+        } catch (const std::runtime_error&) {
+            co_return finished.load();
+        }
+        co_return -1;
+    };
+    EXPECT_EQ(executor.run(faulty()), 2);
+}
+
+}  // namespace
+}  // namespace srm::test
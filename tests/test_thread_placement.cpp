@@ -0,0 +1,179 @@
+#include "test_common.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "srm/arena.hpp"
+#include "srm/instrumentation.hpp"
+#include "srm/thread_placement.hpp"
+
+namespace srm::test {
+namespace {
+
+/// sysfs and procfs trees of a dual-socket server: four cores per socket
+/// with SMT (cpus 0-3 and 8-11 on node 0, 4-7 and 12-15 on node 1), the DAQ
+/// card on node 1 with two MSI vectors and the NVMe controller on node 0.
+class FakeServer {
+public:
+    FakeServer() : root_("_root") {
+        write("sys/devices/system/cpu/online", "0-15\n");
+        write("sys/devices/system/node/node0/cpulist", "0-3,8-11\n");
+        write("sys/devices/system/node/node1/cpulist", "4-7,12-15\n");
+        write("sys/devices/system/node/node2/cpulist", "\n");  // memory only
+        for (int cpu = 0; cpu < 16; ++cpu) {
+            const std::string dir = "sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            write(dir + "physical_package_id", std::to_string(cpu / 4 % 2) + "\n");
+            write(dir + "core_id", std::to_string(cpu % 4) + "\n");
+        }
+        write("sys/bus/pci/devices/0000:b3:00.0/numa_node", "1\n");
+        write("sys/bus/pci/devices/0000:b3:00.0/irq", "16\n");
+        write("sys/bus/pci/devices/0000:b3:00.0/msi_irqs/141", "msix\n");
+        write("sys/bus/pci/devices/0000:b3:00.0/msi_irqs/140", "msix\n");
+        write("sys/bus/pci/devices/0000:17:00.0/numa_node", "0\n");
+        write("proc/irq/140/smp_affinity_list", "0-15\n");
+    }
+    ~FakeServer() {
+        std::error_code ignored;
+        std::filesystem::remove_all(root_.path(), ignored);
+    }
+
+    std::filesystem::path path(const std::string& relative) const { return root_.path() / relative; }
+
+    PlacementConfig config() const {
+        PlacementConfig config;
+        config.daq_device = path("sys/bus/pci/devices/0000:b3:00.0");
+        config.storage_device = path("sys/bus/pci/devices/0000:17:00.0");
+        config.procfs = path("proc");
+        return config;
+    }
+
+private:
+    void write(const std::string& relative, const std::string& text) const {
+        std::filesystem::create_directories(path(relative).parent_path());
+        std::ofstream(path(relative)) << text;
+    }
+
+    ScratchFile root_;
+};
+
+const PlacementStats* find_placement(const InstrumentationSnapshot& snapshot, const std::string& name) {
+    for (const PlacementStats& p : snapshot.placements) {
+        if (p.name == name) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+TEST(ThreadPlacement, CpuLists) {
+    EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(parse_cpu_list(" 5 , 2,2 "), (std::vector<int>{2, 5}));
+    EXPECT_TRUE(parse_cpu_list("\n").empty());
+    EXPECT_EQ(format_cpu_list(std::vector<int>{11, 0, 1, 2, 3, 8, 10}), "0-3,8,10-11");
+    EXPECT_EQ(format_cpu_list(std::vector<int>{}), "");
+    EXPECT_THROW(parse_cpu_list("3-1"), std::invalid_argument);
+    EXPECT_THROW(parse_cpu_list("0,,x"), std::invalid_argument);
+}
+
+TEST(ThreadPlacement, DualSocketLayout) {
+    const FakeServer server;
+    const CpuTopology topology = CpuTopology::detect(server.path("sys"));
+    EXPECT_EQ(topology.cpus().size(), 16u);
+    EXPECT_EQ(topology.node_count(), 2);
+    EXPECT_EQ(topology.node_of(12), 1);
+    EXPECT_EQ(topology.node_of(16), -1);
+    EXPECT_EQ(topology.cpus_of_node(1), (std::vector<int>{4, 5, 6, 7, 12, 13, 14, 15}));
+
+    const DeviceLocality daq = device_locality(server.path("sys/bus/pci/devices/0000:b3:00.0"));
+    EXPECT_EQ(daq.node, 1);
+    EXPECT_EQ(daq.irqs, (std::vector<unsigned>{140, 141}));
+
+    ThreadPlacement placement(topology, server.config());
+    // Dedicated physical cores on the DAQ's socket, their siblings idle.
+    EXPECT_EQ(placement.stage(PipelineStage::Acquisition).cpus, std::vector<int>{4});
+    EXPECT_EQ(placement.stage(PipelineStage::Watchdog).cpus, std::vector<int>{5});
+    EXPECT_EQ(placement.stage(PipelineStage::Processing).cpus, (std::vector<int>{6, 7, 14, 15}));
+    EXPECT_EQ(placement.node(PipelineStage::Processing), 1);
+    // The writer next to its disk, past the housekeeping core.
+    EXPECT_EQ(placement.cpu(PipelineStage::Writer), 1);
+    EXPECT_EQ(placement.node(PipelineStage::Writer), 0);
+    EXPECT_EQ(placement.stage(PipelineStage::Network).cpus, std::vector<int>{1});
+
+    ASSERT_EQ(placement.irqs().size(), 2u);
+    EXPECT_EQ(placement.steer_irqs(), 1u);
+    std::ifstream steered(server.path("proc/irq/140/smp_affinity_list"));
+    std::string list;
+    steered >> list;
+    EXPECT_EQ(list, "4");
+    EXPECT_TRUE(placement.irqs()[0].applied);
+    EXPECT_FALSE(placement.irqs()[1].applied);
+    EXPECT_NE(placement.irqs()[1].detail, "");
+
+    const InstrumentationSnapshot snapshot = Instrumentation::instance().snapshot();
+    const PlacementStats* irq = find_placement(snapshot, "irq 141");
+    ASSERT_NE(irq, nullptr);
+    EXPECT_EQ(irq->cpus, "4");
+    EXPECT_FALSE(irq->applied);
+    const PlacementStats* processing = find_placement(snapshot, "processing");
+    ASSERT_NE(processing, nullptr);
+    EXPECT_EQ(processing->cpus, "6-7,14-15");
+    EXPECT_EQ(processing->node, 1);
+    EXPECT_NE(to_json(snapshot).find("\"placements\":[{\"name\":"), std::string::npos);
+}
+
+TEST(ThreadPlacement, ExplicitCpusAndSmallMachines) {
+    const FakeServer server;
+    PlacementConfig config = server.config();
+    config.cpus[static_cast<std::size_t>(PipelineStage::Acquisition)] = {13};
+    config.cpus[static_cast<std::size_t>(PipelineStage::Processing)] = {0, 4};
+    const ThreadPlacement placement(CpuTopology::detect(server.path("sys")), config);
+    EXPECT_EQ(placement.stage(PipelineStage::Acquisition).cpus, std::vector<int>{13});
+    // cpu 13 is cpu 5's sibling: that core is taken.
+    EXPECT_EQ(placement.cpu(PipelineStage::Watchdog), 6);
+    EXPECT_EQ(placement.node(PipelineStage::Processing), -1);
+    EXPECT_EQ(placement.irqs()[0].cpus, std::vector<int>{13});
+
+    config.cpus[static_cast<std::size_t>(PipelineStage::Writer)] = {16};
+    EXPECT_THROW(ThreadPlacement(CpuTopology::detect(server.path("sys")), config), std::invalid_argument);
+    config = server.config();
+    config.daq_device = server.path("sys/bus/pci/devices/0000:00:00.0");
+    EXPECT_THROW(ThreadPlacement(CpuTopology::detect(server.path("sys")), config), std::runtime_error);
+
+    // Two cores: every stage still gets somewhere to run.
+    const ThreadPlacement small(CpuTopology({{0, 0, 0, 0}, {1, 0, 0, 1}}), PlacementConfig{});
+    EXPECT_EQ(small.stage(PipelineStage::Acquisition).cpus, std::vector<int>{0});
+    EXPECT_EQ(small.stage(PipelineStage::Watchdog).cpus, std::vector<int>{1});
+    EXPECT_EQ(small.stage(PipelineStage::Processing).cpus, (std::vector<int>{0, 1}));
+    EXPECT_EQ(small.stage(PipelineStage::Writer).cpus, (std::vector<int>{0, 1}));
+    EXPECT_TRUE(small.irqs().empty());
+}
+
+TEST(ThreadPlacement, PinsAndBindsOnThisMachine) {
+    const ThreadPlacement placement(CpuTopology::detect(), PlacementConfig{});
+    bool pinned = false;
+    std::thread worker([&] { pinned = placement.pin_current_thread(PipelineStage::Processing); });
+    worker.join();
+    EXPECT_TRUE(pinned);
+    const PlacementStats* stats = find_placement(Instrumentation::instance().snapshot(), "processing");
+    ASSERT_NE(stats, nullptr);
+    EXPECT_TRUE(stats->applied);
+
+    // Node memory works whether or not the kernel can bind it.
+    NodeMemoryResource node(placement.node(PipelineStage::Processing));
+    RunArena arena(std::size_t{1} << 16, &node);
+    auto* p = static_cast<std::uint64_t*>(arena.allocate(std::size_t{1} << 18, 64));
+    p[0] = 1;
+    p[(std::size_t{1} << 15) - 1] = 2;
+    EXPECT_EQ(p[0] + p[(std::size_t{1} << 15) - 1], 3u);
+    std::vector<std::byte> buffer(std::size_t{1} << 20);
+    bind_to_node(buffer.data(), buffer.size(), placement.node(PipelineStage::Processing));
+    EXPECT_TRUE(bind_to_node(buffer.data(), buffer.size(), -1));
+    RecordProperty("numa_bind_supported",
+                   bind_to_node(buffer.data(), buffer.size(), 0) ? "true" : "false");
+}
+
+}  // namespace
+}  // namespace srm::test
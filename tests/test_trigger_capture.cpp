@@ -0,0 +1,209 @@
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "srm/trigger_capture.hpp"
+
+namespace srm::test {
+namespace {
+
+constexpr std::size_t kBlock = 8192;
+constexpr CurrentScale kCurrentScale{0.01, 0.0};  // channel 3 carries a phase current
+
+/// A quiet endurance recording (channel 3 a phase current at 10 A) with
+/// transients at known samples: a 500 ue step on channel 1 and a 50 A
+/// spike on channel 3.
+struct Recording {
+    CaptureInfo info = test_capture_info(4);
+    ChannelBuffer<std::int16_t> counts;
+
+    explicit Recording(std::size_t samples) {
+        SyntheticSrmConfig quiet;
+        quiet.harmonic_ue = {20.0, 5.0};
+        counts = synthetic_counts(info, samples, quiet);
+        std::fill(counts.channel(3).begin(), counts.channel(3).end(), static_cast<std::int16_t>(1000));
+    }
+
+    void strain_step(std::size_t channel, std::size_t first, std::size_t length, double ue) {
+        const ConversionParams p = make_conversion_params(info.channels[channel]);
+        for (std::size_t i = first; i < first + length; ++i) {
+            counts.channel(channel)[i] = static_cast<std::int16_t>(std::lround(strain_to_counts(p, ue)));
+        }
+    }
+
+    void current_spike(std::size_t first, std::size_t length, double amps) {
+        for (std::size_t i = first; i < first + length; ++i) {
+            counts.channel(3)[i] = static_cast<std::int16_t>(std::lround(amps / kCurrentScale.amps_per_count));
+        }
+    }
+};
+
+/// Feeds @p recording block by block and writes what the trigger passes on.
+void run(TriggeredCapture& trigger, const Recording& recording, const std::filesystem::path& path) {
+    CaptureWriter writer(path, recording.info);
+    const auto sink = [&](ChannelBlock<const std::int16_t> block, std::uint64_t first) {
+        writer.write_chunk(block, first);
+    };
+    const ChannelBlock<const std::int16_t> all = recording.counts.view();
+    for (std::size_t pos = 0; pos < all.samples(); pos += kBlock) {
+        trigger.process(all.subblock(pos, std::min(kBlock, all.samples() - pos)), pos, sink);
+    }
+    trigger.finish();
+    writer.finish();
+}
+
+/// Every stored chunk must hold exactly the input samples at its index.
+void expect_chunks_match(const CaptureReader& reader, const Recording& recording) {
+    for (std::size_t k = 0; k < reader.chunk_count(); ++k) {
+        const std::uint64_t first = reader.chunks()[k].first_sample;
+        const ChannelBlock<const std::int16_t> block = reader.chunk_block(k);
+        for (std::size_t c = 0; c < block.channels(); ++c) {
+            ASSERT_TRUE(std::equal(block.channel(c).begin(), block.channel(c).end(),
+                                   recording.counts.channel(c).begin() + static_cast<std::ptrdiff_t>(first)))
+                << "chunk " << k << " channel " << c;
+        }
+    }
+}
+
+TEST(TriggeredCapture, WritesOnlyThePrePostWindow) {
+    Recording recording(400000);
+    recording.strain_step(1, 150001, 3000, 500.0);
+    const ScratchFile file(".srmcap");
+    TriggerConfig config;
+    config.pre_samples = 10000;
+    config.post_samples = 20000;
+    config.max_chunk_samples = 4096;
+    const std::vector<TriggerCondition> conditions = {TriggerCondition::level_crossing(1, 300.0)};
+    TriggeredCapture trigger(recording.info, config, conditions);
+    run(trigger, recording, file.path());
+
+    ASSERT_EQ(trigger.events(), 1u);
+    ASSERT_EQ(trigger.event_log().size(), 1u);
+    const TriggerEvent& event = trigger.event_log()[0];
+    EXPECT_EQ(event.condition, 0u);
+    EXPECT_EQ(event.sample, 150001u);
+    EXPECT_EQ(event.first_sample, 140001u);
+    EXPECT_EQ(event.end_sample, 170001u);
+    EXPECT_EQ(trigger.samples_written(), 30000u);
+    RecordProperty("trigger_storage_fraction",
+                   std::to_string(static_cast<double>(trigger.samples_written()) /
+                                  static_cast<double>(trigger.samples_seen())));
+
+    const CaptureReader reader(file.path());
+    EXPECT_EQ(reader.total_samples(), 30000u);
+    EXPECT_EQ(reader.chunks()[0].first_sample, 140001u);
+    for (std::size_t k = 0; k < reader.chunk_count(); ++k) {
+        EXPECT_LE(reader.chunks()[k].sample_count, 4096u);
+    }
+    expect_chunks_match(reader, recording);
+}
+
+// A second transient inside the window extends it; one after it closes
+// starts a new event whose history stops where the first one ended.
+TEST(TriggeredCapture, RetriggersAndNeverRewritesSamples) {
+    Recording recording(300000);
+    recording.strain_step(1, 50000, 100, 500.0);
+    recording.strain_step(1, 60000, 100, 500.0);   // inside the first window
+    recording.current_spike(95000, 50, 50.0);      // 5000 after it closes
+    const ScratchFile file(".srmcap");
+    TriggerConfig config;
+    config.pre_samples = 20000;
+    config.post_samples = 30000;
+    const std::vector<TriggerCondition> conditions = {
+        TriggerCondition::level_crossing(1, 300.0),
+        TriggerCondition::phase_current(3, 30.0, kCurrentScale, TriggerEdge::Rising),
+    };
+    TriggeredCapture trigger(recording.info, config, conditions);
+    run(trigger, recording, file.path());
+
+    ASSERT_EQ(trigger.event_log().size(), 2u);
+    const TriggerEvent first = trigger.event_log()[0];
+    const TriggerEvent second = trigger.event_log()[1];
+    EXPECT_EQ(first.first_sample, 30000u);
+    EXPECT_EQ(first.retriggers, 1u);
+    EXPECT_EQ(first.end_sample, 90000u);
+    EXPECT_EQ(second.condition, 1u);
+    EXPECT_EQ(second.sample, 95000u);
+    EXPECT_EQ(second.first_sample, 90000u);  // only 5000 samples of history
+    EXPECT_EQ(second.end_sample, 125000u);
+
+    const CaptureReader reader(file.path());
+    EXPECT_EQ(reader.total_samples(), 95000u);
+    expect_chunks_match(reader, recording);
+
+    config.retrigger = false;
+    config.holdoff_samples = 20000;
+    TriggeredCapture strict(recording.info, config, conditions);
+    const ScratchFile other(".srmcap");
+    run(strict, recording, other.path());
+    ASSERT_EQ(strict.event_log().size(), 1u);  // the spike falls into the holdoff
+    EXPECT_EQ(strict.event_log()[0].end_sample, 80000u);
+    EXPECT_EQ(strict.event_log()[0].retriggers, 0u);
+}
+
+TEST(TriggeredCapture, SlopePatternAndEdges) {
+    Recording recording(120000);
+    // Two channels high together at 40000; channel 0 alone at 20000.
+    recording.strain_step(0, 20000, 2000, 400.0);
+    recording.strain_step(0, 40000, 2000, 400.0);
+    recording.strain_step(2, 40000, 2000, -400.0);
+    TriggerConfig config;
+    config.pre_samples = 100;
+    config.post_samples = 100;
+    const auto events_of = [&](const TriggerCondition& condition) {
+        TriggeredCapture trigger(recording.info, config, std::span(&condition, 1));
+        const ScratchFile file(".srmcap");
+        run(trigger, recording, file.path());
+        std::vector<std::uint64_t> samples;
+        for (const TriggerEvent& e : trigger.event_log()) {
+            samples.push_back(e.sample);
+        }
+        return samples;
+    };
+
+    EXPECT_EQ(events_of(TriggerCondition::all_of({{0, 300.0, true}, {2, -300.0, false}})),
+              (std::vector<std::uint64_t>{40000}));
+    EXPECT_EQ(events_of(TriggerCondition::level_crossing(0, 300.0, TriggerEdge::Falling)),
+              (std::vector<std::uint64_t>{22000, 42000}));
+    // A 400 ue jump in one sample is 4e8 ue/s; the signal itself stays
+    // below 2e7 ue/s at 1 MS/s.
+    EXPECT_EQ(events_of(TriggerCondition::slope(2, 1e8, TriggerEdge::Falling)),
+              (std::vector<std::uint64_t>{40000}));
+    EXPECT_EQ(events_of(TriggerCondition::slope(2, 1e8, TriggerEdge::Either)),
+              (std::vector<std::uint64_t>{40000, 42000}));
+}
+
+TEST(TriggeredCapture, GapsAndInvalidInput) {
+    Recording recording(40000);
+    recording.strain_step(1, 0, 40000, 500.0);  // high throughout: no crossing
+    TriggerConfig config;
+    config.pre_samples = 1000;
+    config.post_samples = 1000;
+    const std::vector<TriggerCondition> conditions = {TriggerCondition::level_crossing(1, 300.0)};
+    TriggeredCapture trigger(recording.info, config, conditions);
+    std::uint64_t written = 0;
+    const auto sink = [&](ChannelBlock<const std::int16_t> block, std::uint64_t) { written += block.samples(); };
+    trigger.process(recording.counts.view().subblock(0, 10000), 0, sink);
+    // After a gap the first sample has no predecessor, so it cannot cross.
+    trigger.process(recording.counts.view().subblock(10000, 10000), 50000, sink);
+    EXPECT_EQ(trigger.events(), 0u);
+    EXPECT_EQ(written, 0u);
+    EXPECT_THROW(trigger.process(recording.counts.view().subblock(0, 10), 100, sink), std::invalid_argument);
+    EXPECT_THROW(trigger.process(ChannelBuffer<std::int16_t>(3, 10).view(), 70000, sink), std::invalid_argument);
+
+    EXPECT_THROW(TriggeredCapture(recording.info, config, std::vector{TriggerCondition::level_crossing(4, 1.0)}),
+                 std::invalid_argument);
+    EXPECT_THROW(TriggeredCapture(recording.info, config, std::vector{TriggerCondition::slope(0, 0.0)}),
+                 std::invalid_argument);
+    EXPECT_THROW(TriggeredCapture(recording.info, config, std::vector{TriggerCondition::all_of({})}),
+                 std::invalid_argument);
+    EXPECT_THROW(TriggeredCapture(recording.info, config,
+                                  std::vector{TriggerCondition::phase_current(3, 1.0, {0.0, 0.0})}),
+                 std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace srm::test